@@ -31,6 +31,7 @@
 #include <cvt/cl/CLException.h>
 #include <cvt/cl/CLLocalSpace.h>
 #include <cvt/cl/CLProgram.h>
+#include <cvt/cl/CLProgramCache.h>
 #include <cvt/cl/CLBuffer.h>
 #include <cvt/cl/CLImage2D.h>
 #include <cvt/cl/CLNDRange.h>
@@ -95,8 +96,9 @@ namespace cvt {
     {
         //std::cerr << name << std::endl;
 
-        CLProgram prog( *CL::defaultContext(), source );
-        if( ! prog.build( *CL::defaultDevice() , ( options + " -Werror" ).c_str() ) ) {
+        CLProgram prog;
+        const char* str = source.c_str();
+        if( ! CLProgramCache::build( prog, *CL::defaultContext(), *CL::defaultDevice(), &str, 1, ( options + " -Werror" ).c_str() ) ) {
             /*, "-cl-single-precision-constant -cl-denorms-are-zero -cl-mad-enable -cl-fast-relaxed-math"*/
             String log;
             prog.buildLog( *CL::defaultDevice(), log );
@@ -118,8 +120,8 @@ namespace cvt {
     {
         //std::cerr << name << std::endl;
 
-        CLProgram prog( *CL::defaultContext(), strings, count );
-        if( ! prog.build( *CL::defaultDevice() , ( options + " -Werror" ).c_str() ) ) {
+        CLProgram prog;
+        if( ! CLProgramCache::build( prog, *CL::defaultContext(), *CL::defaultDevice(), strings, count, ( options + " -Werror" ).c_str() ) ) {
             /*, "-cl-single-precision-constant -cl-denorms-are-zero -cl-mad-enable -cl-fast-relaxed-math"*/
             String log;
             prog.buildLog( *CL::defaultDevice(), log );
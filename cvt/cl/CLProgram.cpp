@@ -25,6 +25,7 @@
 
 #include <cvt/cl/CLProgram.h>
 #include <cvt/cl/CLContext.h>
+#include <cvt/util/Exception.h>
 
 namespace cvt {
 
@@ -53,4 +54,55 @@ namespace cvt {
             throw CLException( err );
     }
 
+    CLProgram::CLProgram( const CLContext& context, const CLDevice& dev, const Data& binary )
+    {
+        cl_int err, status;
+        size_t size = binary.size();
+        const unsigned char* ptr = binary.ptr();
+        _object = ::clCreateProgramWithBinary( context, 1, ( cl_device_id* ) &dev, &size, &ptr, &status, &err );
+        if( err != CL_SUCCESS )
+            throw CLException( err );
+        if( status != CL_SUCCESS ) {
+            release();
+            _object = NULL;
+            throw CLException( status );
+        }
+    }
+
+    void CLProgram::binary( const CLDevice& dev, Data& binary ) const
+    {
+        cl_int err;
+        cl_uint ndev;
+        err = ::clGetProgramInfo( _object, CL_PROGRAM_NUM_DEVICES, sizeof( cl_uint ), &ndev, NULL );
+        if( err != CL_SUCCESS )
+            throw CLException( __PRETTY_FUNCTION__, err );
+
+        std::vector<cl_device_id> devs( ndev );
+        std::vector<size_t> sizes( ndev );
+        err = ::clGetProgramInfo( _object, CL_PROGRAM_DEVICES, sizeof( cl_device_id ) * ndev, &devs[ 0 ], NULL );
+        if( err != CL_SUCCESS )
+            throw CLException( __PRETTY_FUNCTION__, err );
+        err = ::clGetProgramInfo( _object, CL_PROGRAM_BINARY_SIZES, sizeof( size_t ) * ndev, &sizes[ 0 ], NULL );
+        if( err != CL_SUCCESS )
+            throw CLException( __PRETTY_FUNCTION__, err );
+
+        /* the runtime fills the binaries of all devices, only the one for dev is kept */
+        std::vector<Data> bins( ndev );
+        std::vector<unsigned char*> ptrs( ndev );
+        size_t idx = ndev;
+        for( size_t i = 0; i < ndev; i++ ) {
+            bins[ i ].allocate( sizes[ i ] );
+            ptrs[ i ] = bins[ i ].ptr();
+            if( devs[ i ] == ( cl_device_id ) dev )
+                idx = i;
+        }
+        if( idx == ndev )
+            throw CVTException( "CLProgram: program is not built for the device" );
+
+        err = ::clGetProgramInfo( _object, CL_PROGRAM_BINARIES, sizeof( unsigned char* ) * ndev, &ptrs[ 0 ], NULL );
+        if( err != CL_SUCCESS )
+            throw CLException( __PRETTY_FUNCTION__, err );
+        binary = bins[ idx ];
+    }
+
 }
@@ -30,6 +30,7 @@
 #include <cvt/cl/CLUtil.h>
 #include <cvt/cl/CLException.h>
 #include <cvt/cl/CLDevice.h>
+#include <cvt/util/Data.h>
 #include <vector>
 
 namespace cvt {
@@ -43,11 +44,13 @@ namespace cvt {
             CLProgram( const CLContext& context, const char* prog );
             CLProgram( const CLContext& context, const char** strings, int count );
             CLProgram( const CLContext& context, const String& prog );
+            CLProgram( const CLContext& context, const CLDevice& dev, const Data& binary );
             bool build( const CLDevice& dev, const char* options = NULL );
             bool build( const std::vector<CLDevice>& devices, const char* options = NULL );
 
             CLUTIL_GETINFOSTRING( source, CL_PROGRAM_SOURCE, _object, ::clGetProgramInfo )
             void buildLog( const CLDevice& dev, String& log );
+            void binary( const CLDevice& dev, Data& binary ) const;
 
     };
 
@@ -0,0 +1,243 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/cl/CLProgramCache.h>
+#include <cvt/cl/CLContext.h>
+#include <cvt/cl/CLPlatform.h>
+#include <cvt/io/FileSystem.h>
+#include <cvt/util/Data.h>
+#include <cvt/util/Mutex.h>
+#include <cvt/util/Util.h>
+#include <cvt/util/Exception.h>
+
+#include <string.h>
+#include <unistd.h>
+
+namespace cvt {
+
+    /* bump if the file layout changes */
+    static const uint32_t _cacheVersion = 1;
+    static const char     _cacheMagic[ 8 ] = { 'C', 'V', 'T', 'C', 'L', 'B', 'I', 'N' };
+
+    static Mutex  _cacheMutex;
+    static String _cacheDir;
+    static bool   _cacheEnabled = true;
+    static bool   _cacheInit = false;
+    static size_t _cacheTmpCounter = 0;
+
+    static uint64_t _fnv1a( uint64_t hash, const void* data, size_t size )
+    {
+        const uint8_t* ptr = ( const uint8_t* ) data;
+        while( size-- ) {
+            hash ^= *ptr++;
+            hash *= 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    /* create all missing directories of path, a directory created concurrently by someone else is fine */
+    static bool _mkdirs( const String& path )
+    {
+        for( size_t i = 1; i <= path.length(); i++ ) {
+            if( i != path.length() && path[ i ] != '/' )
+                continue;
+            String sub = path.substring( 0, i );
+            if( FileSystem::exists( sub ) )
+                continue;
+            try {
+                FileSystem::mkdir( sub );
+            } catch( const Exception& ) {
+                if( !FileSystem::exists( sub ) )
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    void CLProgramCache::init()
+    {
+        if( _cacheInit )
+            return;
+        _cacheInit = true;
+
+        String env;
+        if( Util::getEnv( env, "CVT_CL_CACHE" ) && env == "0" )
+            _cacheEnabled = false;
+
+        if( Util::getEnv( env, "CVT_CL_CACHE_DIR" ) && env.length() ) {
+            _cacheDir = env;
+        } else if( Util::getEnv( env, "XDG_CACHE_HOME" ) && env.length() ) {
+            _cacheDir = env;
+            _cacheDir += "/cvt/opencl";
+        } else if( Util::getEnv( env, "HOME" ) && env.length() ) {
+            _cacheDir = env;
+            _cacheDir += "/.cache/cvt/opencl";
+        } else
+            _cacheEnabled = false;
+    }
+
+    void CLProgramCache::setDirectory( const String& dir )
+    {
+        ScopeLock lock( &_cacheMutex );
+        init();
+        _cacheDir = dir;
+    }
+
+    String CLProgramCache::directory()
+    {
+        ScopeLock lock( &_cacheMutex );
+        init();
+        return _cacheDir;
+    }
+
+    void CLProgramCache::setEnabled( bool enable )
+    {
+        ScopeLock lock( &_cacheMutex );
+        init();
+        _cacheEnabled = enable;
+    }
+
+    bool CLProgramCache::enabled()
+    {
+        ScopeLock lock( &_cacheMutex );
+        init();
+        return _cacheEnabled && _cacheDir.length();
+    }
+
+    bool CLProgramCache::build( CLProgram& prog, const CLContext& context, const CLDevice& dev, const char** strings, int count, const char* options )
+    {
+        String dir;
+        bool enable;
+        {
+            ScopeLock lock( &_cacheMutex );
+            init();
+            dir = _cacheDir;
+            enable = _cacheEnabled && dir.length();
+        }
+
+        String key, path;
+        if( enable ) {
+            try {
+                /* two independent source hashes, the file name is derived from the complete key */
+                uint64_t h0 = 0xcbf29ce484222325ULL;
+                uint64_t h1 = 0x84222325cbf29ce4ULL;
+                size_t len = 0;
+                for( int i = 0; i < count; i++ ) {
+                    size_t n = strlen( strings[ i ] );
+                    h0 = _fnv1a( h0, strings[ i ], n );
+                    h1 = _fnv1a( h1, strings[ i ], n );
+                    len += n;
+                }
+
+                String pname, dname, dversion, drvversion;
+                dev.platform().name( pname );
+                dev.name( dname );
+                dev.version( dversion );
+                dev.driverVersion( drvversion );
+
+                key.sprintf( "version %u\nplatform %s\ndevice %s\ndevice version %s\ndriver %s\noptions %s\nsource %zu %016llx %016llx\n",
+                             _cacheVersion, pname.c_str(), dname.c_str(), dversion.c_str(), drvversion.c_str(), options ? options : "",
+                             len, ( unsigned long long ) h0, ( unsigned long long ) h1 );
+
+                path.sprintf( "%s/%016llx.clbin", dir.c_str(), ( unsigned long long ) _fnv1a( 0xcbf29ce484222325ULL, key.c_str(), key.length() ) );
+
+                if( load( prog, context, dev, path, key, options ) )
+                    return true;
+            } catch( const Exception& ) {
+                enable = false;
+            }
+        }
+
+        prog = CLProgram( context, strings, count );
+        if( !prog.build( dev, options ) )
+            return false;
+
+        if( enable )
+            store( prog, dev, path, key );
+        return true;
+    }
+
+    bool CLProgramCache::load( CLProgram& prog, const CLContext& context, const CLDevice& dev, const String& path, const String& key, const char* options )
+    {
+        Data file;
+        if( !FileSystem::exists( path ) || !FileSystem::load( file, path ) )
+            return false;
+
+        const size_t header = sizeof( _cacheMagic ) + sizeof( uint32_t );
+        if( file.size() < header || memcmp( file.ptr(), _cacheMagic, sizeof( _cacheMagic ) ) )
+            return false;
+
+        uint32_t keylen;
+        memcpy( &keylen, file.ptr() + sizeof( _cacheMagic ), sizeof( uint32_t ) );
+        if( keylen != key.length() || file.size() <= header + keylen || memcmp( file.ptr() + header, key.c_str(), keylen ) )
+            return false;
+
+        Data binary( file.ptr() + header + keylen, file.size() - header - keylen, false );
+        try {
+            CLProgram bin( context, dev, binary );
+            if( !bin.build( dev, options ) )
+                return false;
+            prog = bin;
+        } catch( const Exception& ) {
+            return false;
+        }
+        return true;
+    }
+
+    void CLProgramCache::store( const CLProgram& prog, const CLDevice& dev, const String& path, const String& key )
+    {
+        String tmp;
+        try {
+            Data binary;
+            prog.binary( dev, binary );
+            if( !binary.size() )
+                return;
+
+            const size_t header = sizeof( _cacheMagic ) + sizeof( uint32_t );
+            uint32_t keylen = key.length();
+            Data file( header + keylen + binary.size() );
+            memcpy( file.ptr(), _cacheMagic, sizeof( _cacheMagic ) );
+            memcpy( file.ptr() + sizeof( _cacheMagic ), &keylen, sizeof( uint32_t ) );
+            memcpy( file.ptr() + header, key.c_str(), keylen );
+            memcpy( file.ptr() + header + keylen, binary.ptr(), binary.size() );
+
+            if( !_mkdirs( Util::getDirectoryFromPath( path ) ) )
+                return;
+
+            {
+                ScopeLock lock( &_cacheMutex );
+                tmp.sprintf( "%s.%d.%zu.tmp", path.c_str(), ( int ) getpid(), _cacheTmpCounter++ );
+            }
+            /* readers only ever see complete files */
+            if( FileSystem::save( tmp, file ) )
+                FileSystem::rename( tmp, path );
+            else
+                unlink( tmp.c_str() );
+        } catch( const Exception& ) {
+            if( tmp.length() )
+                unlink( tmp.c_str() );
+        }
+    }
+
+}
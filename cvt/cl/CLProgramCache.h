@@ -0,0 +1,67 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_CLPROGRAMCACHE_H
+#define CVT_CLPROGRAMCACHE_H
+
+#include <cvt/cl/CLProgram.h>
+#include <cvt/util/String.h>
+
+namespace cvt {
+    class CLContext;
+
+    /**
+      On-disk cache for OpenCL program binaries.
+
+      Programs are stored per device in the cache directory, keyed by the source, the build options,
+      the platform, the device and the driver version. A missing, stale or rejected binary silently
+      falls back to building from source, the fresh binary then replaces the cache entry.
+      Entries are written to a temporary file and renamed, so several processes or threads may build
+      and populate the cache at the same time.
+
+      The directory is taken from CVT_CL_CACHE_DIR, then $XDG_CACHE_HOME/cvt/opencl and $HOME/.cache/cvt/opencl.
+      Setting CVT_CL_CACHE=0 disables the cache.
+     */
+    class CLProgramCache
+    {
+        public:
+            /* build prog for dev from the sources, returns false on a build failure and prog holds the source program for the build log */
+            static bool build( CLProgram& prog, const CLContext& context, const CLDevice& dev, const char** strings, int count, const char* options = NULL );
+
+            static void   setDirectory( const String& dir );
+            static String directory();
+            static void   setEnabled( bool enable );
+            static bool   enabled();
+
+        private:
+            CLProgramCache();
+            CLProgramCache( const CLProgramCache& );
+
+            static void init();
+            static bool load( CLProgram& prog, const CLContext& context, const CLDevice& dev, const String& path, const String& key, const char* options );
+            static void store( const CLProgram& prog, const CLDevice& dev, const String& path, const String& key );
+    };
+}
+
+#endif
@@ -0,0 +1,392 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/com/SharedImageRing.h>
+#include <cvt/util/Exception.h>
+#include <cvt/util/SIMD.h>
+#include <cvt/math/Math.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <new>
+
+namespace cvt
+{
+	static const uint32_t SHAREDIMAGERING_MAGIC	  = 0x52495643; /* "CVIR" */
+	static const uint32_t SHAREDIMAGERING_VERSION = 1;
+	static const size_t	  SHAREDIMAGERING_PAGE	  = 4096;
+
+	/* producer and consumer positions on separate cache lines */
+	struct SharedImageRing::RingHeader
+	{
+		std::atomic<uint32_t>	magic;
+		uint32_t				version;
+		uint64_t				numSlots;
+		uint64_t				slotSize;
+		uint64_t				slotStride;
+		uint64_t				dataOffset;
+		uint64_t				size;
+		std::atomic<uint32_t>	attached;
+		alignas( 64 ) std::atomic<uint64_t> writePos;
+		alignas( 64 ) std::atomic<uint64_t> readPos;
+	};
+
+	/* state is the slot sequence of the bounded queue: pos is free for writing, pos + 1 is readable
+	   and pos + numSlots is free for the next round */
+	struct alignas( 64 ) SharedImageRing::SlotHeader
+	{
+		std::atomic<uint64_t>	state;
+		uint64_t				sequence;
+		double					timestamp;
+		uint32_t				formatID;
+		uint32_t				width;
+		uint32_t				height;
+		uint32_t				stride;
+	};
+
+	SharedImageRing::Frame::Frame() :
+		_ring( NULL ),
+		_image( NULL ),
+		_timestamp( 0.0 ),
+		_sequence( 0 ),
+		_write( false )
+	{
+	}
+
+	SharedImageRing::Frame::~Frame()
+	{
+		if( _ring )
+			_ring->returnSlot( *this );
+	}
+
+	SharedImageRing::SharedImageRing( const String& name, size_t numSlots, size_t slotSize ) :
+		_fd( -1 ),
+		_base( NULL ),
+		_size( 0 ),
+		_header( NULL )
+	{
+		if( !numSlots || !slotSize )
+			throw CVTException( "SharedImageRing: invalid ring geometry" );
+
+		_name = name;
+		if( _name[ 0 ] != '/' )
+			_name = String( "/" ) + name;
+		try {
+			create( numSlots, slotSize );
+		} catch( ... ) {
+			close();
+			throw;
+		}
+	}
+
+	SharedImageRing::SharedImageRing( const String& name ) :
+		_fd( -1 ),
+		_base( NULL ),
+		_size( 0 ),
+		_header( NULL )
+	{
+		_name = name;
+		if( _name[ 0 ] != '/' )
+			_name = String( "/" ) + name;
+		try {
+			attach();
+		} catch( ... ) {
+			close();
+			throw;
+		}
+	}
+
+	SharedImageRing::~SharedImageRing()
+	{
+		/* remove the segment if this was the last connected instance */
+		if( _header && _header->attached.fetch_sub( 1 ) == 1 )
+			shm_unlink( _name.c_str() );
+		close();
+	}
+
+	void SharedImageRing::close()
+	{
+		if( _base )
+			munmap( _base, _size );
+		if( _fd >= 0 )
+			::close( _fd );
+		_base = NULL;
+		_header = NULL;
+		_fd = -1;
+	}
+
+	void SharedImageRing::map( size_t size )
+	{
+		void* ptr = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0 );
+		if( ptr == MAP_FAILED ){
+			String msg( "SharedImageRing mmap: " );
+			msg += strerror( errno );
+			throw CVTException( msg.c_str() );
+		}
+		_base = ( uint8_t* ) ptr;
+		_size = size;
+		_header = ( RingHeader* ) _base;
+	}
+
+	void SharedImageRing::create( size_t numSlots, size_t slotSize )
+	{
+		std::atomic<uint64_t> test;
+		if( !test.is_lock_free() )
+			throw CVTException( "SharedImageRing: 64 bit atomics are not lock-free on this platform" );
+
+		_fd = shm_open( _name.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP );
+		if( _fd < 0 ){
+			if( errno != EEXIST ){
+				String msg( "SharedImageRing shm_open: " );
+				msg += strerror( errno );
+				throw CVTException( msg.c_str() );
+			}
+			attach();
+			if( _header->numSlots != numSlots || _header->slotSize != slotSize ){
+				_header->attached.fetch_sub( 1 );
+				throw CVTException( "SharedImageRing: existing ring has a different geometry" );
+			}
+			return;
+		}
+
+		size_t slotStride = Math::pad( slotSize, SHAREDIMAGERING_PAGE );
+		size_t dataOffset = Math::pad( sizeof( RingHeader ) + numSlots * sizeof( SlotHeader ), SHAREDIMAGERING_PAGE );
+		size_t size = dataOffset + numSlots * slotStride;
+
+		if( ftruncate( _fd, size ) != 0 ){
+			String msg( "SharedImageRing ftruncate: " );
+			msg += strerror( errno );
+			shm_unlink( _name.c_str() );
+			throw CVTException( msg.c_str() );
+		}
+		map( size );
+
+		new( _header ) RingHeader();
+		_header->version	= SHAREDIMAGERING_VERSION;
+		_header->numSlots	= numSlots;
+		_header->slotSize	= slotSize;
+		_header->slotStride = slotStride;
+		_header->dataOffset = dataOffset;
+		_header->size		= size;
+		_header->attached.store( 1 );
+		_header->writePos.store( 0 );
+		_header->readPos.store( 0 );
+
+		for( size_t i = 0; i < numSlots; i++ ){
+			SlotHeader* s = new( slot( i ) ) SlotHeader();
+			s->state.store( i );
+		}
+
+		/* attaching instances wait for the magic */
+		_header->magic.store( SHAREDIMAGERING_MAGIC, std::memory_order_release );
+	}
+
+	void SharedImageRing::attach()
+	{
+		_fd = shm_open( _name.c_str(), O_RDWR, 0 );
+		if( _fd < 0 ){
+			String msg( "SharedImageRing shm_open: " );
+			msg += strerror( errno );
+			throw CVTException( msg.c_str() );
+		}
+
+		/* the creator may not have sized and initialized the segment yet, wait up to a second */
+		struct stat st;
+		size_t tries = 0;
+		while( fstat( _fd, &st ) == 0 && ( size_t ) st.st_size < sizeof( RingHeader ) && tries++ < 1000 )
+			usleep( 1000 );
+		if( ( size_t ) st.st_size < sizeof( RingHeader ) )
+			throw CVTException( "SharedImageRing: ring was not initialized" );
+
+		map( st.st_size );
+		while( _header->magic.load( std::memory_order_acquire ) != SHAREDIMAGERING_MAGIC && tries++ < 1000 )
+			usleep( 1000 );
+		if( _header->magic.load( std::memory_order_acquire ) != SHAREDIMAGERING_MAGIC )
+			throw CVTException( "SharedImageRing: ring was not initialized" );
+		if( _header->version != SHAREDIMAGERING_VERSION || _header->size != _size )
+			throw CVTException( "SharedImageRing: incompatible ring" );
+		_header->attached.fetch_add( 1 );
+	}
+
+	size_t SharedImageRing::numSlots() const
+	{
+		return _header->numSlots;
+	}
+
+	size_t SharedImageRing::slotSize() const
+	{
+		return _header->slotSize;
+	}
+
+	size_t SharedImageRing::imageSize( size_t width, size_t height, const IFormat& format )
+	{
+		return Math::pad16( width * format.bpp ) * height;
+	}
+
+	inline SharedImageRing::SlotHeader* SharedImageRing::slot( uint64_t pos ) const
+	{
+		return ( SlotHeader* ) ( _base + sizeof( RingHeader ) ) + pos % _header->numSlots;
+	}
+
+	inline uint8_t* SharedImageRing::slotData( uint64_t pos ) const
+	{
+		return _base + _header->dataOffset + ( pos % _header->numSlots ) * _header->slotStride;
+	}
+
+	bool SharedImageRing::acquireWrite( Frame& frame, size_t width, size_t height, const IFormat& format )
+	{
+		if( imageSize( width, height, format ) > _header->slotSize )
+			throw CVTException( "SharedImageRing: image exceeds the slot size" );
+
+		if( frame._ring )
+			frame._ring->returnSlot( frame );
+
+		uint64_t pos = _header->writePos.load( std::memory_order_relaxed );
+		SlotHeader* s;
+		for( ;; ){
+			s = slot( pos );
+			int64_t diff = ( int64_t ) ( s->state.load( std::memory_order_acquire ) - pos );
+			if( diff == 0 ){
+				if( _header->writePos.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) )
+					break;
+			} else if( diff < 0 ){
+				/* the slot of the previous round is not consumed yet */
+				return false;
+			} else {
+				pos = _header->writePos.load( std::memory_order_relaxed );
+			}
+		}
+
+		size_t stride = Math::pad16( width * format.bpp );
+		s->formatID = format.formatID;
+		s->width	= width;
+		s->height	= height;
+		s->stride	= stride;
+
+		frame._ring		 = this;
+		frame._image	 = new Image( width, height, format, slotData( pos ), stride );
+		frame._timestamp = 0.0;
+		frame._sequence	 = pos;
+		frame._write	 = true;
+		return true;
+	}
+
+	void SharedImageRing::publish( Frame& frame, double timestamp )
+	{
+		if( frame._ring != this || !frame._write )
+			throw CVTException( "SharedImageRing: frame was not acquired for writing from this ring" );
+
+		SlotHeader* s = slot( frame._sequence );
+		s->timestamp = timestamp;
+		s->sequence	 = frame._sequence;
+		s->state.store( frame._sequence + 1, std::memory_order_release );
+
+		delete frame._image;
+		frame._image = NULL;
+		frame._ring	 = NULL;
+	}
+
+	bool SharedImageRing::write( const Image& img, double timestamp )
+	{
+		Frame frame;
+		if( !acquireWrite( frame, img.width(), img.height(), img.format() ) )
+			return false;
+
+		SIMD* simd = SIMD::instance();
+		size_t sstride, dstride;
+		const uint8_t* src = img.map( &sstride );
+		uint8_t* dst = frame._image->map( &dstride );
+		size_t n = img.width() * img.bpp();
+		for( size_t y = 0; y < img.height(); y++ )
+			simd->Memcpy( dst + y * dstride, src + y * sstride, n );
+		frame._image->unmap( dst );
+		img.unmap( src );
+
+		publish( frame, timestamp );
+		return true;
+	}
+
+	bool SharedImageRing::acquireRead( Frame& frame )
+	{
+		if( frame._ring )
+			frame._ring->returnSlot( frame );
+
+		for( ;; ){
+			uint64_t pos = _header->readPos.load( std::memory_order_relaxed );
+			SlotHeader* s;
+			for( ;; ){
+				s = slot( pos );
+				int64_t diff = ( int64_t ) ( s->state.load( std::memory_order_acquire ) - ( pos + 1 ) );
+				if( diff == 0 ){
+					if( _header->readPos.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) )
+						break;
+				} else if( diff < 0 ){
+					return false;
+				} else {
+					pos = _header->readPos.load( std::memory_order_relaxed );
+				}
+			}
+
+			/* dropped frames are skipped */
+			if( !s->width ){
+				s->state.store( pos + _header->numSlots, std::memory_order_release );
+				continue;
+			}
+
+			frame._ring		 = this;
+			frame._image	 = new Image( s->width, s->height, IFormat::formatForId( ( IFormatID ) s->formatID ), slotData( pos ), s->stride );
+			frame._timestamp = s->timestamp;
+			frame._sequence	 = s->sequence;
+			frame._write	 = false;
+			return true;
+		}
+	}
+
+	void SharedImageRing::release( Frame& frame )
+	{
+		if( frame._ring != this || frame._write )
+			throw CVTException( "SharedImageRing: frame was not acquired for reading from this ring" );
+		returnSlot( frame );
+	}
+
+	void SharedImageRing::returnSlot( Frame& frame )
+	{
+		SlotHeader* s = slot( frame._sequence );
+		if( frame._write ){
+			/* publish an empty frame, the consumers skip it */
+			s->width = 0;
+			s->state.store( frame._sequence + 1, std::memory_order_release );
+		} else {
+			s->state.store( frame._sequence + _header->numSlots, std::memory_order_release );
+		}
+
+		delete frame._image;
+		frame._image = NULL;
+		frame._ring	 = NULL;
+	}
+}
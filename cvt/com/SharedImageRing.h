@@ -0,0 +1,124 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_SHAREDIMAGERING_H
+#define CVT_SHAREDIMAGERING_H
+
+#include <stdint.h>
+#include <atomic>
+
+#include <cvt/util/String.h>
+#include <cvt/gfx/Image.h>
+
+namespace cvt
+{
+	/**
+	  @brief Ring of image slots in POSIX shared memory for zero-copy frame transport between processes
+
+	  Producers and consumers claim slots lock-free (bounded MPMC queue, one atomic sequence per slot),
+	  so any number of producers and consumers in any number of processes can share the ring. Every
+	  frame is delivered to exactly one consumer.
+	  Frames are handed out as images wrapping the slot memory: a producer can render or copy directly
+	  into the slot and a consumer reads the frame without copying it. The slot is returned to the
+	  ring by publish()/release(), the image must not be used afterwards. While a consumer holds a
+	  frame the producers cannot lap that slot, acquireWrite() returns false if the ring is full.
+
+	  The segment is created by the first instance and removed when the last instance is destroyed.
+	 */
+	class SharedImageRing
+	{
+		public:
+			class Frame
+			{
+				friend class SharedImageRing;
+				public:
+					Frame();
+					/* frames still held are returned to the ring, unpublished write frames are dropped */
+					~Frame();
+
+					bool			valid() const { return _image != NULL; }
+					Image&			image() { return *_image; }
+					const Image&	image() const { return *_image; }
+					double			timestamp() const { return _timestamp; }
+					/* running number of the frame in the ring */
+					uint64_t		sequence() const { return _sequence; }
+
+				private:
+					Frame( const Frame& );
+					Frame& operator=( const Frame& );
+
+					SharedImageRing*	_ring;
+					Image*				_image;
+					double				_timestamp;
+					uint64_t			_sequence;
+					bool				_write;
+			};
+
+			/* create the ring or attach to an existing one with the same geometry */
+			SharedImageRing( const String& name, size_t numSlots, size_t slotSize );
+			/* attach to an existing ring */
+			SharedImageRing( const String& name );
+			~SharedImageRing();
+
+			size_t	numSlots() const;
+			/* maximum image size in bytes of a slot */
+			size_t	slotSize() const;
+			/* bytes needed to store an image of the given size in a slot */
+			static size_t imageSize( size_t width, size_t height, const IFormat& format );
+
+			/* claim a free slot for an image of the given size, returns false if the ring is full */
+			bool	acquireWrite( Frame& frame, size_t width, size_t height, const IFormat& format );
+			void	publish( Frame& frame, double timestamp );
+			/* copy the image into a free slot and publish it, returns false if the ring is full */
+			bool	write( const Image& img, double timestamp );
+
+			/* take the oldest published frame, returns false if the ring is empty */
+			bool	acquireRead( Frame& frame );
+			void	release( Frame& frame );
+
+		private:
+			SharedImageRing( const SharedImageRing& );
+			SharedImageRing& operator=( const SharedImageRing& );
+
+			struct RingHeader;
+			struct SlotHeader;
+
+			void		create( size_t numSlots, size_t slotSize );
+			void		attach();
+			void		map( size_t size );
+			void		close();
+			SlotHeader*	slot( uint64_t pos ) const;
+			uint8_t*	slotData( uint64_t pos ) const;
+			void		returnSlot( Frame& frame );
+
+			String			_name;
+			int				_fd;
+			uint8_t*		_base;
+			size_t			_size;
+			RingHeader*		_header;
+	};
+
+}
+
+#endif
@@ -0,0 +1,222 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/com/SharedImageRing.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/util/Thread.h>
+#include <cvt/util/Exception.h>
+#include <cvt/util/CVTTest.h>
+
+#include <atomic>
+#include <vector>
+#include <sched.h>
+#include <unistd.h>
+
+using namespace cvt;
+
+static const size_t SHAREDIMAGERINGTEST_FRAMES = 2000;
+
+/* the pixels of frame i */
+static inline uint8_t _pixel( size_t i, size_t x, size_t y )
+{
+    return ( uint8_t ) ( i + 3 * x + 5 * y );
+}
+
+static void _fill( Image& img, size_t i )
+{
+    IMapScoped<uint8_t> map( img );
+    for( size_t y = 0; y < img.height(); y++ ) {
+        uint8_t* line = map.line( y );
+        for( size_t x = 0; x < img.width(); x++ )
+            line[ x ] = _pixel( i, x, y );
+    }
+}
+
+static bool _check( const Image& img, size_t i )
+{
+    if( img.width() != 16 || img.height() != 8 || img.format() != IFormat::GRAY_UINT8 )
+        return false;
+    IMapScoped<const uint8_t> map( img );
+    for( size_t y = 0; y < img.height(); y++ ) {
+        const uint8_t* line = map.line( y );
+        for( size_t x = 0; x < img.width(); x++ ) {
+            if( line[ x ] != _pixel( i, x, y ) )
+                return false;
+        }
+    }
+    return true;
+}
+
+/* writes the frames alternately by copy and in place, retries while the ring is full */
+class SharedImageRingWriter : public Thread<SharedImageRing>
+{
+    public:
+        void execute( SharedImageRing* ring )
+        {
+            Image img( 16, 8, IFormat::GRAY_UINT8 );
+            for( size_t i = 0; i < SHAREDIMAGERINGTEST_FRAMES; i++ ) {
+                if( i & 1 ) {
+                    SharedImageRing::Frame frame;
+                    while( !ring->acquireWrite( frame, 16, 8, IFormat::GRAY_UINT8 ) )
+                        sched_yield();
+                    _fill( frame.image(), i );
+                    ring->publish( frame, ( double ) i );
+                } else {
+                    _fill( img, i );
+                    while( !ring->write( img, ( double ) i ) )
+                        sched_yield();
+                }
+            }
+        }
+};
+
+/* every reader attaches its own instance like a consumer in another process would */
+class SharedImageRingReader : public Thread<SharedImageRing>
+{
+    public:
+        SharedImageRingReader( std::atomic<size_t>* consumed ) : _consumed( consumed ), _valid( true ) {}
+
+        void execute( SharedImageRing* ring )
+        {
+            SharedImageRing::Frame frame;
+            while( _consumed->load() < SHAREDIMAGERINGTEST_FRAMES ) {
+                if( !ring->acquireRead( frame ) ) {
+                    sched_yield();
+                    continue;
+                }
+                size_t i = ( size_t ) frame.timestamp();
+                /* a single consumer gets the frames in order */
+                if( !_frames.empty() && i <= _frames.back() )
+                    _valid = false;
+                _valid &= frame.sequence() == i && _check( frame.image(), i );
+                _frames.push_back( i );
+                ring->release( frame );
+                _consumed->fetch_add( 1 );
+            }
+        }
+
+        bool                        valid() const { return _valid; }
+        const std::vector<size_t>&  frames() const { return _frames; }
+
+    private:
+        std::atomic<size_t>*    _consumed;
+        bool                    _valid;
+        std::vector<size_t>     _frames;
+};
+
+BEGIN_CVTTEST( SharedImageRing )
+    bool result = true;
+    bool b;
+
+    String name;
+    name.sprintf( "cvtringtest%d", ( int ) getpid() );
+
+    try {
+        SharedImageRing ring( name, 4, SharedImageRing::imageSize( 16, 8, IFormat::GRAY_UINT8 ) );
+        Image img( 16, 8, IFormat::GRAY_UINT8 );
+
+        /* a held frame keeps the writer from lapping its slot */
+        b = ring.numSlots() == 4;
+        for( size_t i = 0; i < 4; i++ ) {
+            _fill( img, i );
+            b &= ring.write( img, ( double ) i );
+        }
+        _fill( img, 4 );
+        b &= !ring.write( img, 4.0 );
+        {
+            SharedImageRing::Frame frame;
+            b &= ring.acquireRead( frame ) && frame.sequence() == 0 && _check( frame.image(), 0 );
+            b &= !ring.write( img, 4.0 );
+            ring.release( frame );
+            b &= ring.write( img, 4.0 );
+            b &= !ring.write( img, 5.0 );
+        }
+        {
+            SharedImageRing reader( name );
+            SharedImageRing::Frame frame;
+            for( size_t i = 1; i <= 4; i++ )
+                b &= reader.acquireRead( frame ) && frame.sequence() == i && frame.timestamp() == ( double ) i && _check( frame.image(), i );
+            reader.release( frame );
+            b &= !reader.acquireRead( frame );
+        }
+        CVTTEST_PRINT( "full ring", b );
+        result &= b;
+
+        /* an unpublished frame is skipped by the readers */
+        {
+            SharedImageRing::Frame frame;
+            b = ring.acquireWrite( frame, 16, 8, IFormat::GRAY_UINT8 );
+        }
+        _fill( img, 6 );
+        b &= ring.write( img, 6.0 );
+        {
+            SharedImageRing::Frame frame;
+            b &= ring.acquireRead( frame ) && frame.sequence() == 6 && _check( frame.image(), 6 );
+            ring.release( frame );
+        }
+        CVTTEST_PRINT( "dropped frame", b );
+        result &= b;
+    } catch( const Exception& e ) {
+        CVTTEST_PRINT( "full ring", false );
+        result = false;
+    }
+
+    /* one writer and three readers, the frames wrap around the ring many times */
+    try {
+        SharedImageRing ring( name, 4, SharedImageRing::imageSize( 16, 8, IFormat::GRAY_UINT8 ) );
+        std::atomic<size_t> consumed( 0 );
+        std::vector<SharedImageRing*> rings;
+        std::vector<SharedImageRingReader*> readers;
+        for( size_t i = 0; i < 3; i++ ) {
+            rings.push_back( new SharedImageRing( name ) );
+            readers.push_back( new SharedImageRingReader( &consumed ) );
+            readers.back()->run( rings.back() );
+        }
+        SharedImageRingWriter writer;
+        writer.run( &ring );
+        writer.join();
+
+        std::vector<size_t> count( SHAREDIMAGERINGTEST_FRAMES, 0 );
+        b = true;
+        for( size_t i = 0; i < readers.size(); i++ ) {
+            readers[ i ]->join();
+            b &= readers[ i ]->valid();
+            for( size_t k = 0; k < readers[ i ]->frames().size(); k++ )
+                count[ readers[ i ]->frames()[ k ] ]++;
+            delete readers[ i ];
+            delete rings[ i ];
+        }
+        /* every frame is delivered to exactly one reader */
+        for( size_t i = 0; i < count.size(); i++ )
+            b &= count[ i ] == 1;
+        b &= consumed.load() == SHAREDIMAGERINGTEST_FRAMES;
+    } catch( const Exception& e ) {
+        b = false;
+    }
+    CVTTEST_PRINT( "one writer, three readers", b );
+    result &= b;
+
+    return result;
+END_CVTTEST
@@ -25,6 +25,8 @@
 
 #include "MarchingCubes.h"
 #include <cvt/math/Math.h>
+#include <cvt/util/ThreadPool.h>
+#include <algorithm>
 
 namespace cvt {
 
@@ -320,485 +322,288 @@ namespace cvt {
         {0, 3, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
         {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}};
 
-    void MarchingCubes::extractVolumeValues( float* gridvalues, size_t x, size_t y, size_t z ) const
-    {
-#define VOLUME( x, y, z ) _volume[ ( ( ( z ) * _height + ( y ) ) * _width + ( x ) ) * _channels ]
-
-        /* get the values of the current grid voxel */
-        gridvalues[ 0 ] = VOLUME( x, y, z );
-        gridvalues[ 1 ] = VOLUME( x + 1, y, z );
-        gridvalues[ 2 ] = VOLUME( x + 1, y + 1, z );
-        gridvalues[ 3 ] = VOLUME( x, y + 1, z );
-        gridvalues[ 4 ] = VOLUME( x, y, z + 1 );
-        gridvalues[ 5 ] = VOLUME( x + 1, y, z + 1 );
-        gridvalues[ 6 ] = VOLUME( x + 1, y + 1, z + 1);
-        gridvalues[ 7 ] = VOLUME( x, y + 1, z + 1 );
-#undef VOLUME
-    }
+    /* the corners of the cube relative to ( x, y, z ) */
+    static const size_t _cornerX[ 8 ] = { 0, 1, 1, 0, 0, 1, 1, 0 };
+    static const size_t _cornerY[ 8 ] = { 0, 0, 1, 1, 0, 0, 1, 1 };
+    static const size_t _cornerZ[ 8 ] = { 0, 0, 0, 0, 1, 1, 1, 1 };
 
-    bool MarchingCubes::extractVolumeValuesWithWeightCheck( float* gridvalues, size_t x, size_t y, size_t z, float minWeight ) const
-    {
-#define VOLUME( x, y, z ) _volume[ ( ( ( z ) * _height + ( y ) ) * _width + ( x ) ) * _channels ]
-#define VOLUMEWEIGHT( x, y, z ) _volume[ ( ( ( z ) * _height + ( y ) ) * _width + ( x ) ) * _channels + 1 ]
-
-        /* get the values of the current grid voxel and check for a minium weight*/
-        gridvalues[ 0 ] = VOLUME( x, y, z );
-        if( VOLUMEWEIGHT( x, y, z ) <= minWeight ) return false;
-        gridvalues[ 1 ] = VOLUME( x + 1, y, z );
-        if( VOLUMEWEIGHT( x + 1, y, z ) <= minWeight ) return false;
-        gridvalues[ 2 ] = VOLUME( x + 1, y + 1, z );
-        if( VOLUMEWEIGHT( x + 1, y + 1, z ) <= minWeight ) return false;
-        gridvalues[ 3 ] = VOLUME( x, y + 1, z );
-        if( VOLUMEWEIGHT( x, y + 1, z ) <= minWeight ) return false;
-        gridvalues[ 4 ] = VOLUME( x, y, z + 1 );
-        if( VOLUMEWEIGHT( x, y, z + 1 ) <= minWeight ) return false;
-        gridvalues[ 5 ] = VOLUME( x + 1, y, z + 1 );
-        if( VOLUMEWEIGHT( x + 1, y, z + 1 ) <= minWeight ) return false;
-        gridvalues[ 6 ] = VOLUME( x + 1, y + 1, z + 1);
-        if( VOLUMEWEIGHT( x + 1, y + 1, z + 1 ) <= minWeight ) return false;
-        gridvalues[ 7 ] = VOLUME( x, y + 1, z + 1 );
-        if( VOLUMEWEIGHT( x, y + 1, z + 1 ) <= minWeight ) return false;
-#undef VOLUME
-#undef VOLUMEWEIGHT
-        return true;
-    }
+    /* the corners of the 12 edges, ordered from the lower to the higher grid coordinate so that
+       neighbouring cubes interpolate a shared edge identically */
+    static const int _edgeCorners[ 12 ][ 2 ] = {
+        { 0, 1 }, { 1, 2 }, { 3, 2 }, { 0, 3 },
+        { 4, 5 }, { 5, 6 }, { 7, 6 }, { 4, 7 },
+        { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 }
+    };
 
-    void MarchingCubes::extractVolumeNormals( Vector3f* gridnormal, size_t x, size_t y, size_t z ) const
-    {
-#define VOLUME( x, y, z ) _volume[ ( ( ( z ) * _height + ( y ) ) * _width + ( x ) ) * _channels ]
-#define VOLNORMAL( x, y, z )   -Vector3f( VOLUME( ( x ) + 1, ( y ), ( z ) ) - VOLUME( ( x ) - 1, ( y ), ( z ) ),  \
-                                          VOLUME( ( x ), ( y ) + 1, ( z ) ) - VOLUME( ( x ) , ( y ) - 1, ( z ) ), \
-                                          VOLUME( ( x ), ( y ), ( z ) + 1 ) - VOLUME( ( x ) , ( y ), ( z ) - 1 ) )
-
-        gridnormal[ 0 ] = VOLNORMAL( x, y, z );
-        gridnormal[ 1 ] = VOLNORMAL( x + 1, y, z );
-        gridnormal[ 2 ] = VOLNORMAL( x + 1, y + 1, z );
-        gridnormal[ 3 ] = VOLNORMAL( x, y + 1, z );
-        gridnormal[ 4 ] = VOLNORMAL( x, y, z + 1 );
-        gridnormal[ 5 ] = VOLNORMAL( x + 1, y, z + 1 );
-        gridnormal[ 6 ] = VOLNORMAL( x + 1, y + 1, z + 1);
-        gridnormal[ 7 ] = VOLNORMAL( x, y + 1, z + 1 );
-
-#undef VOLNORMAL
-#undef VOLUME
-    }
-
-    unsigned int MarchingCubes::cubeIndexFromValues( float* gridvalues, float isolevel ) const
-    {
-        unsigned int cubeindex = 0;
-        if( gridvalues[ 0 ] < isolevel ) cubeindex |= 1;
-        if( gridvalues[ 1 ] < isolevel ) cubeindex |= 2;
-        if( gridvalues[ 2 ] < isolevel ) cubeindex |= 4;
-        if( gridvalues[ 3 ] < isolevel ) cubeindex |= 8;
-        if( gridvalues[ 4 ] < isolevel ) cubeindex |= 16;
-        if( gridvalues[ 5 ] < isolevel ) cubeindex |= 32;
-        if( gridvalues[ 6 ] < isolevel ) cubeindex |= 64;
-        if( gridvalues[ 7 ] < isolevel ) cubeindex |= 128;
-        return cubeindex;
-    }
+    static const unsigned int NOVERTEX = ~0u;
 
-    void MarchingCubes::setGridVertices( Vector3f* gridvtx, size_t x, size_t y, size_t z ) const
+    inline Vector3f MarchingCubes::gridNormal( size_t x, size_t y, size_t z ) const
     {
-        gridvtx[ 0 ].set( x, y, z );
-        gridvtx[ 1 ].set( x + 1, y, z );
-        gridvtx[ 2 ].set( x + 1, y + 1, z );
-        gridvtx[ 3 ].set( x, y + 1, z );
-        gridvtx[ 4 ].set( x, y, z + 1 );
-        gridvtx[ 5 ].set( x + 1, y, z + 1 );
-        gridvtx[ 6 ].set( x + 1, y + 1, z + 1);
-        gridvtx[ 7 ].set( x, y + 1, z + 1 );
-    }
-
-    void MarchingCubes::interpolateVertices( Vector3f* vertlist, const Vector3f* gridvtx, const float* gridval, unsigned int cubeindex, float isolevel ) const
-    {
-        if ( _edgeTable[ cubeindex ] & 1)
-            vertexInterp( vertlist[ 0 ], gridvtx[ 0 ], gridvtx[ 1 ], gridval[ 0 ], gridval[ 1 ], isolevel );
-        if ( _edgeTable[ cubeindex ] & 2)
-            vertexInterp( vertlist[ 1 ], gridvtx[ 1 ], gridvtx[ 2 ], gridval[ 1 ], gridval[ 2 ], isolevel );
-        if ( _edgeTable[ cubeindex ] & 4)
-            vertexInterp( vertlist[ 2 ], gridvtx[ 2 ], gridvtx[ 3 ], gridval[ 2 ], gridval[ 3 ], isolevel );
-        if ( _edgeTable[ cubeindex ] & 8)
-            vertexInterp( vertlist[ 3 ], gridvtx[ 3 ], gridvtx[ 0 ], gridval[ 3 ], gridval[ 0 ], isolevel );
-        if ( _edgeTable[ cubeindex ] & 16)
-            vertexInterp( vertlist[ 4 ], gridvtx[ 4 ], gridvtx[ 5 ], gridval[ 4 ], gridval[ 5 ], isolevel );
-        if ( _edgeTable[ cubeindex ] & 32)
-            vertexInterp( vertlist[ 5 ], gridvtx[ 5 ], gridvtx[ 6 ], gridval[ 5 ], gridval[ 6 ], isolevel );
-        if ( _edgeTable[ cubeindex ] & 64)
-            vertexInterp( vertlist[ 6 ], gridvtx[ 6 ], gridvtx[ 7 ], gridval[ 6 ], gridval[ 7 ], isolevel );
-        if ( _edgeTable[ cubeindex ] & 128)
-            vertexInterp( vertlist[ 7 ], gridvtx[ 7 ], gridvtx[ 4 ], gridval[ 7 ], gridval[ 4 ], isolevel );
-        if ( _edgeTable[ cubeindex ] & 256)
-            vertexInterp( vertlist[ 8 ], gridvtx[ 0 ], gridvtx[ 4 ], gridval[ 0 ], gridval[ 4 ], isolevel );
-        if ( _edgeTable[ cubeindex ] & 512)
-            vertexInterp( vertlist[ 9 ], gridvtx[ 1 ], gridvtx[ 5 ], gridval[ 1 ], gridval[ 5 ], isolevel );
-        if ( _edgeTable[ cubeindex ] & 1024)
-            vertexInterp( vertlist[ 10 ], gridvtx[ 2 ], gridvtx[ 6 ], gridval[ 2 ], gridval[ 6 ], isolevel );
-        if ( _edgeTable[ cubeindex ] & 2048)
-            vertexInterp( vertlist[ 11 ], gridvtx[ 3 ], gridvtx[ 7 ], gridval[ 3 ], gridval[ 7 ], isolevel );
-    }
-
-    void MarchingCubes::interpolateVerticesAndNormals( Vector3f* vertlist, Vector3f* normlist, const Vector3f* gridvtx, const Vector3f* gridnormal, const float* gridval, unsigned int cubeindex, float isolevel ) const
-    {
-        if ( _edgeTable[ cubeindex ] & 1 )
-            vertexNormalInterp( vertlist[ 0 ], gridvtx[ 0 ], gridvtx[ 1 ],
-                               normlist[ 0 ], gridnormal[ 0 ], gridnormal[ 1 ],
-                               gridval[ 0 ], gridval[ 1 ], isolevel );
-        if ( _edgeTable[ cubeindex ] & 2 )
-            vertexNormalInterp( vertlist[ 1 ], gridvtx[ 1 ], gridvtx[ 2 ],
-                               normlist[ 1 ], gridnormal[ 1 ], gridnormal[ 2 ],
-                               gridval[ 1 ], gridval[ 2 ], isolevel );
-        if ( _edgeTable[ cubeindex ] & 4 )
-            vertexNormalInterp( vertlist[ 2 ], gridvtx[ 2 ], gridvtx[ 3 ],
-                               normlist[ 2 ], gridnormal[ 2 ], gridnormal[ 3 ],
-                               gridval[ 2 ], gridval[ 3 ], isolevel );
-        if ( _edgeTable[ cubeindex ] & 8 )
-            vertexNormalInterp( vertlist[ 3 ], gridvtx[ 3 ], gridvtx[ 0 ],
-                               normlist[ 3 ], gridnormal[ 3 ], gridnormal[ 0 ],
-                               gridval[ 3 ], gridval[ 0 ], isolevel );
-        if ( _edgeTable[ cubeindex ] & 16 )
-            vertexNormalInterp( vertlist[ 4 ], gridvtx[ 4 ], gridvtx[ 5 ],
-                               normlist[ 4 ], gridnormal[ 4 ], gridnormal[ 5 ],
-                               gridval[ 4 ], gridval[ 5 ], isolevel );
-        if ( _edgeTable[ cubeindex ] & 32 )
-            vertexNormalInterp( vertlist[ 5 ], gridvtx[ 5 ], gridvtx[ 6 ],
-                               normlist[ 5 ], gridnormal[ 5 ], gridnormal[ 6 ],
-                               gridval[ 5 ], gridval[ 6 ], isolevel );
-        if ( _edgeTable[ cubeindex ] & 64 )
-            vertexNormalInterp( vertlist[ 6 ], gridvtx[ 6 ], gridvtx[ 7 ],
-                               normlist[ 6 ], gridnormal[ 6 ], gridnormal[ 7 ],
-                               gridval[ 6 ], gridval[ 7 ], isolevel );
-        if ( _edgeTable[ cubeindex ] & 128 )
-            vertexNormalInterp( vertlist[ 7 ], gridvtx[ 7 ], gridvtx[ 4 ],
-                               normlist[ 7 ], gridnormal[ 7 ], gridnormal[ 4 ],
-                               gridval[ 7 ], gridval[ 4 ], isolevel );
-        if ( _edgeTable[ cubeindex ] & 256 )
-            vertexNormalInterp( vertlist[ 8 ], gridvtx[ 0 ], gridvtx[ 4 ],
-                               normlist[ 8 ], gridnormal[ 0 ], gridnormal[ 4 ],
-                               gridval[ 0 ], gridval[ 4 ], isolevel );
-        if ( _edgeTable[ cubeindex ] & 512 )
-            vertexNormalInterp( vertlist[ 9 ], gridvtx[ 1 ], gridvtx[ 5 ],
-                               normlist[ 9 ], gridnormal[ 1 ], gridnormal[ 5 ],
-                               gridval[ 1 ], gridval[ 5 ], isolevel );
-        if ( _edgeTable[ cubeindex ] & 1024 )
-            vertexNormalInterp( vertlist[ 10 ], gridvtx[ 2 ], gridvtx[ 6 ],
-                               normlist[ 10 ], gridnormal[ 2 ], gridnormal[ 6 ],
-                               gridval[ 2 ], gridval[ 6 ], isolevel );
-        if ( _edgeTable[ cubeindex ] & 2048 )
-            vertexNormalInterp( vertlist[ 11 ], gridvtx[ 3 ], gridvtx[ 7 ],
-                               normlist[ 11 ], gridnormal[ 3 ], gridnormal[ 7 ],
-                               gridval[ 3 ], gridval[ 7 ], isolevel );
+#define VOLUME( x, y, z ) _volume[ voxelOffset( x, y, z ) ]
+        return -Vector3f( VOLUME( x + 1, y, z ) - VOLUME( x - 1, y, z ),
+                          VOLUME( x, y + 1, z ) - VOLUME( x, y - 1, z ),
+                          VOLUME( x, y, z + 1 ) - VOLUME( x, y, z - 1 ) );
+#undef VOLUME
     }
 
-
-    void MarchingCubes::triangulateDistance( SceneMesh& mesh, float isolevel ) const
+    void MarchingCubes::loadPlane( float* values, uint8_t* valid, size_t z, bool EM ) const
     {
-        float gridval[ 8 ];
-        Vector3f gridvtx[ 8 ];
-        int cubeindex;
-        Vector3f vertlist[ 12 ];
-        size_t vtxIdx = 0;
-        std::vector<Vector3f> vertices;
-        std::vector<unsigned int> faces;
-
-        size_t xend = _width - 1;
-        size_t yend = _height - 1;
-        size_t zend = _depth - 1;
-
-        for( size_t z = 0; z < zend; z++  ) {
-            for( size_t y = 0; y < yend; y++ ) {
-                for( size_t x = 0; x < xend; x++ ) {
-
-                    /* Extract the data from the volume at (x,y,z) */
-                    extractVolumeValues( gridval, x, y, z );
-
-                    /* Determine the index into the edge table which
-                       tells us which vertices are inside of the surface */
-                    cubeindex = cubeIndexFromValues( gridval, isolevel );
-
-                    /* Cube is entirely in/out of the surface */
-                    if ( _edgeTable[ cubeindex ] == 0)
-                        continue;
-
-                    /* set the vertex positions of the current cell */
-                    setGridVertices( gridvtx, x, y, z );
-
-                    /* Find the vertices where the surface intersects the cube */
-                    interpolateVertices( vertlist, gridvtx, gridval, cubeindex, isolevel );
-
-                    /* Create the triangle */
-                    for( int i = 0; _triTable[ cubeindex ][ i ] !=-1; i += 3 ) {
-                        vertices.push_back( vertlist[ _triTable[ cubeindex ][ i     ] ] );
-                        faces.push_back( vtxIdx++ );
-                        vertices.push_back( vertlist[ _triTable[ cubeindex ][ i + 1 ] ] );
-                        faces.push_back( vtxIdx++ );
-                        vertices.push_back( vertlist[ _triTable[ cubeindex ][ i + 2 ] ] );
-                        faces.push_back( vtxIdx++ );
-                    }
+        for( size_t y = 0; y < _height; y++ ) {
+            if( EM ) {
+                /* the EM volume is always in the linear layout */
+                const float* voxel = _volume + ( z * _height + y ) * _width * _channels;
+                for( size_t x = 0; x < _width; x++, voxel += _channels ) {
+                    *values++ = voxel[ 0 ];
+                    *valid++  = ( voxel[ 1 ] / ( voxel[ 3 ] + 1e-8f ) ) > _minweight;
+                }
+            } else if( !_blockshift ) {
+                const float* voxel = _volume + voxelOffset( 0, y, z );
+                for( size_t x = 0; x < _width; x++, voxel += _channels ) {
+                    *values++ = voxel[ 0 ];
+                    *valid++  = !_weighted || voxel[ _weightoffset ] > _minweight;
+                }
+            } else {
+                for( size_t x = 0; x < _width; x++ ) {
+                    size_t offset = voxelOffset( x, y, z );
+                    *values++ = _volume[ offset ];
+                    *valid++  = !_weighted || _volume[ offset + _weightoffset ] > _minweight;
                 }
             }
         }
-        mesh.clear();
-        mesh.setVertices( &vertices[ 0 ], vertices.size() );
-        mesh.setFaces( &faces[ 0 ], faces.size(), SCENEMESH_TRIANGLES );
     }
 
-    void MarchingCubes::triangulateWithNormalsDistance( SceneMesh& mesh, float isolevel ) const
+    void MarchingCubes::triangulateSlab( Slab& slab, size_t zbegin, size_t zend, float isolevel, bool normals, bool EM ) const
     {
-        float gridval[ 8 ];
-        Vector3f gridvtx[ 8 ];
-        Vector3f gridnormal[ 8 ];
-        int cubeindex;
-        Vector3f vertlist[ 12 ];
-        Vector3f normlist[ 12 ];
-        size_t vtxIdx = 0;
-        std::vector<Vector3f> vertices;
-        std::vector<Vector3f> normals;
-        std::vector<unsigned int> faces;
-
-        size_t xend = _width - 2;
-        size_t yend = _height - 2;
-        size_t zend = _depth - 2;
-        for( size_t z = 1; z < zend; z++  ) {
-            for( size_t y = 1; y < yend; y++ ) {
-                for( size_t x = 1; x < xend; x++ ) {
-
-                    /* Extract the data from the volume around (x,y,z) */
-                    extractVolumeValues( gridval, x, y, z );
+        /* with normals the border voxels are skipped, the normals are central differences */
+        const size_t border = normals ? 1 : 0;
+        const size_t xend   = _width - 1 - border;
+        const size_t yend   = _height - 1 - border;
+        const size_t plane  = _width * _height;
+
+        /* the values and the vertex indices of the x- and y-edges of the planes z and z + 1, the
+           vertex indices of the z-edges in between. Every edge vertex is computed once per slab */
+        std::vector<float>          values( 2 * plane );
+        std::vector<uint8_t>        valid( 2 * plane );
+        std::vector<unsigned int>   edgesX( 2 * plane, NOVERTEX );
+        std::vector<unsigned int>   edgesY( 2 * plane, NOVERTEX );
+        std::vector<unsigned int>   edgesZ( plane );
+
+        loadPlane( &values[ 0 ], &valid[ 0 ], zbegin, EM );
+
+        for( size_t z = zbegin; z < zend; z++ ) {
+            const size_t cur  = ( ( z - zbegin ) & 1 ) * plane;
+            const size_t next = plane - cur;
+
+            loadPlane( &values[ next ], &valid[ next ], z + 1, EM );
+            std::fill( edgesX.begin() + next, edgesX.begin() + next + plane, NOVERTEX );
+            std::fill( edgesY.begin() + next, edgesY.begin() + next + plane, NOVERTEX );
+            std::fill( edgesZ.begin(), edgesZ.end(), NOVERTEX );
+
+            for( size_t y = border; y < yend; y++ ) {
+                const float* v0 = &values[ cur + y * _width ];
+                const float* v1 = &values[ next + y * _width ];
+                for( size_t x = border; x < xend; x++ ) {
+                    const size_t i = y * _width + x;
 
                     /* Determine the index into the edge table which
                        tells us which vertices are inside of the surface */
-                    cubeindex = cubeIndexFromValues( gridval, isolevel );
+                    unsigned int cubeindex = ( v0[ x ] < isolevel )
+                                           | ( v0[ x + 1 ] < isolevel ) << 1
+                                           | ( v0[ x + _width + 1 ] < isolevel ) << 2
+                                           | ( v0[ x + _width ] < isolevel ) << 3
+                                           | ( v1[ x ] < isolevel ) << 4
+                                           | ( v1[ x + 1 ] < isolevel ) << 5
+                                           | ( v1[ x + _width + 1 ] < isolevel ) << 6
+                                           | ( v1[ x + _width ] < isolevel ) << 7;
 
                     /* Cube is entirely in/out of the surface */
-                    if ( _edgeTable[ cubeindex ] == 0)
+                    int edges = _edgeTable[ cubeindex ];
+                    if( !edges )
                         continue;
 
-                    /* set the vertex positions of the current cell */
-                    setGridVertices( gridvtx, x, y, z );
+                    const size_t corner[ 8 ] = { cur + i, cur + i + 1, cur + i + _width + 1, cur + i + _width,
+                                                 next + i, next + i + 1, next + i + _width + 1, next + i + _width };
 
-                    /* Extract the normals from the volume around (x,y,z) */
-                    extractVolumeNormals( gridnormal, x, y, z );
+                    /* Cube is not observed */
+                    bool inside = true;
+                    for( int c = 0; c < 8; c++ )
+                        inside = inside && valid[ corner[ c ] ];
+                    if( !inside )
+                        continue;
 
-                    /* Find the vertices and normals where the surface intersects the cube */
-                    interpolateVerticesAndNormals( vertlist, normlist, gridvtx, gridnormal, gridval, cubeindex, isolevel );
+                    /* Find the vertices where the surface intersects the cube, reuse the ones of the neighbours */
+                    unsigned int vertlist[ 12 ];
+                    for( int e = 0; e < 12; e++ ) {
+                        if( !( edges & ( 1 << e ) ) )
+                            continue;
+
+                        const int c1 = _edgeCorners[ e ][ 0 ];
+                        const int c2 = _edgeCorners[ e ][ 1 ];
+                        const size_t pi = i + _cornerX[ c1 ] + _cornerY[ c1 ] * _width;
+                        unsigned int* edge;
+                        if( _cornerZ[ c1 ] != _cornerZ[ c2 ] )
+                            edge = &edgesZ[ pi ];
+                        else
+                            edge = &( _cornerX[ c1 ] != _cornerX[ c2 ] ? edgesX : edgesY )[ ( _cornerZ[ c1 ] ? next : cur ) + pi ];
+
+                        if( *edge == NOVERTEX ) {
+                            Vector3f p1( x + _cornerX[ c1 ], y + _cornerY[ c1 ], z + _cornerZ[ c1 ] );
+                            Vector3f p2( x + _cornerX[ c2 ], y + _cornerY[ c2 ], z + _cornerZ[ c2 ] );
+                            Vector3f vtx;
+                            if( normals ) {
+                                Vector3f norm;
+                                vertexNormalInterp( vtx, p1, p2, norm,
+                                                    gridNormal( x + _cornerX[ c1 ], y + _cornerY[ c1 ], z + _cornerZ[ c1 ] ),
+                                                    gridNormal( x + _cornerX[ c2 ], y + _cornerY[ c2 ], z + _cornerZ[ c2 ] ),
+                                                    values[ corner[ c1 ] ], values[ corner[ c2 ] ], isolevel );
+                                slab.normals.push_back( norm );
+                            } else {
+                                vertexInterp( vtx, p1, p2, values[ corner[ c1 ] ], values[ corner[ c2 ] ], isolevel );
+                            }
+                            *edge = slab.vertices.size();
+                            slab.vertices.push_back( vtx );
+                        }
+                        vertlist[ e ] = *edge;
+                    }
 
                     /* Create the triangle */
-                    for( int i = 0; _triTable[ cubeindex ][ i ] !=-1; i += 3 ) {
-                        vertices.push_back( vertlist[ _triTable[ cubeindex ][ i     ] ] );
-                        normals.push_back( normlist[ _triTable[ cubeindex ][ i     ] ] );
-                        faces.push_back( vtxIdx++ );
-                        vertices.push_back( vertlist[ _triTable[ cubeindex ][ i + 1 ] ] );
-                        normals.push_back( normlist[ _triTable[ cubeindex ][ i + 1 ] ] );
-                        faces.push_back( vtxIdx++ );
-                        vertices.push_back( vertlist[ _triTable[ cubeindex ][ i + 2 ] ] );
-                        normals.push_back( normlist[ _triTable[ cubeindex ][ i + 2 ] ] );
-                        faces.push_back( vtxIdx++ );
-                    }
+                    for( int t = 0; _triTable[ cubeindex ][ t ] != -1; t++ )
+                        slab.faces.push_back( vertlist[ _triTable[ cubeindex ][ t ] ] );
                 }
             }
-        }
-        mesh.clear();
-        mesh.setVertices( &vertices[ 0 ], vertices.size() );
-        mesh.setNormals( &normals[ 0 ], normals.size() );
-        mesh.setFaces( &faces[ 0 ], faces.size(), SCENEMESH_TRIANGLES );
-    }
-
-    void MarchingCubes::triangulateWeightedDistance( SceneMesh& mesh, float isolevel ) const
-    {
-        float gridval[ 8 ];
-        Vector3f gridvtx[ 8 ];
-        int cubeindex;
-        Vector3f vertlist[ 12 ];
-        size_t vtxIdx = 0;
-        std::vector<Vector3f> vertices;
-        std::vector<unsigned int> faces;
-
-        size_t xend = _width - 1;
-        size_t yend = _height - 1;
-        size_t zend = _depth - 1;
-
-        for( size_t z = 0; z < zend; z++  ) {
-            for( size_t y = 0; y < yend; y++ ) {
-                for( size_t x = 0; x < xend; x++ ) {
-
-                    if( !extractVolumeValuesWithWeightCheck(gridval, x, y, z, _minweight ) )
-                        continue;
 
-                    /* Determine the index into the edge table which
-                       tells us which vertices are inside of the surface */
-                    cubeindex = cubeIndexFromValues( gridval, isolevel );
-
-                    /* Cube is entirely in/out of the surface */
-                    if ( _edgeTable[ cubeindex ] == 0)
-                        continue;
-
-                    /* set the vertex positions of the current cell */
-                    setGridVertices( gridvtx, x, y, z );
-
-                    /* Find the vertices where the surface intersects the cube */
-                    interpolateVertices( vertlist, gridvtx, gridval, cubeindex, isolevel );
-
-                    /* Create the triangle */
-                    for( int i = 0; _triTable[ cubeindex ][ i ] !=-1; i += 3 ) {
-                        vertices.push_back( vertlist[ _triTable[ cubeindex ][ i     ] ] );
-                        faces.push_back( vtxIdx++ );
-                        vertices.push_back( vertlist[ _triTable[ cubeindex ][ i + 1 ] ] );
-                        faces.push_back( vtxIdx++ );
-                        vertices.push_back( vertlist[ _triTable[ cubeindex ][ i + 2 ] ] );
-                        faces.push_back( vtxIdx++ );
+            /* the vertices on the first and last plane are shared with the neighbouring slabs */
+            if( z == zbegin || z + 1 == zend ) {
+                size_t p = z == zbegin ? cur : next;
+                std::vector<std::pair<size_t, unsigned int> >& shared = z == zbegin ? slab.bottom : slab.top;
+                for( size_t k = 0; k < plane; k++ ) {
+                    if( edgesX[ p + k ] != NOVERTEX )
+                        shared.push_back( std::make_pair( k, edgesX[ p + k ] ) );
+                    if( edgesY[ p + k ] != NOVERTEX )
+                        shared.push_back( std::make_pair( plane + k, edgesY[ p + k ] ) );
+                }
+                if( z == zbegin && z + 1 == zend ) {
+                    for( size_t k = 0; k < plane; k++ ) {
+                        if( edgesX[ next + k ] != NOVERTEX )
+                            slab.top.push_back( std::make_pair( k, edgesX[ next + k ] ) );
+                        if( edgesY[ next + k ] != NOVERTEX )
+                            slab.top.push_back( std::make_pair( plane + k, edgesY[ next + k ] ) );
                     }
                 }
             }
         }
-        mesh.clear();
-        mesh.setVertices( &vertices[ 0 ], vertices.size() );
-        mesh.setFaces( &faces[ 0 ], faces.size(), SCENEMESH_TRIANGLES );
     }
 
-    void MarchingCubes::triangulateWithNormalsWeightedDistance( SceneMesh& mesh, float isolevel ) const
+    void MarchingCubes::triangulateVolume( SceneMesh& mesh, float isolevel, bool normals, bool EM ) const
     {
-        float gridval[ 8 ];
-        Vector3f gridvtx[ 8 ];
-        Vector3f gridnormal[ 8 ];
-        int cubeindex;
-        Vector3f vertlist[ 12 ];
-        Vector3f normlist[ 12 ];
-        size_t vtxIdx = 0;
-        std::vector<Vector3f> vertices;
-        std::vector<Vector3f> normals;
-        std::vector<unsigned int> faces;
-
-        size_t xend = _width - 2;
-        size_t yend = _height - 2;
-        size_t zend = _depth - 2;
-        for( size_t z = 1; z < zend; z++  ) {
-            for( size_t y = 1; y < yend; y++ ) {
-                for( size_t x = 1; x < xend; x++ ) {
-
-                    if( !extractVolumeValuesWithWeightCheck(gridval, x, y, z, _minweight ) )
-                        continue;
-
-                    /* Determine the index into the edge table which
-                       tells us which vertices are inside of the surface */
-                    cubeindex = cubeIndexFromValues( gridval, isolevel );
-
-                    /* Cube is entirely in/out of the surface */
-                    if ( _edgeTable[ cubeindex ] == 0)
-                        continue;
+        const size_t border = normals ? 1 : 0;
+        mesh.clear();
+        if( _width < 2 + 2 * border || _height < 2 + 2 * border || _depth < 2 + 2 * border )
+            return;
+
+        /* a few slabs per thread to balance the load, the slabs are triangulated independently */
+        const size_t zbegin = border;
+        const size_t zend   = _depth - 1 - border;
+        const size_t tasks  = 4 * ( ThreadPool::instance().numThreads() + 1 );
+        const size_t depth  = Math::max<size_t>( 8, ( zend - zbegin + tasks - 1 ) / tasks );
+        const size_t nslabs = ( zend - zbegin + depth - 1 ) / depth;
+
+        std::vector<Slab> slabs( nslabs );
+        ThreadPool::instance().parallelFor( 0, nslabs, 1, [ & ]( size_t begin, size_t end ) {
+            for( size_t s = begin; s < end; s++ ) {
+                size_t z = zbegin + s * depth;
+                triangulateSlab( slabs[ s ], z, Math::min( z + depth, zend ), isolevel, normals, EM );
+            }
+        } );
+
+        /* concatenate the slabs, the vertices on the bottom plane of a slab that are already
+           part of the top plane of the previous slab are replaced by the previous ones */
+        size_t nvertices = 0, nfaces = 0;
+        for( size_t s = 0; s < nslabs; s++ ) {
+            nvertices += slabs[ s ].vertices.size();
+            nfaces += slabs[ s ].faces.size();
+        }
 
-                    /* set the vertex positions of the current cell */
-                    setGridVertices( gridvtx, x, y, z );
+        std::vector<Vector3f>       vertices;
+        std::vector<Vector3f>       vnormals;
+        std::vector<unsigned int>   faces;
+        std::vector<unsigned int>   shared( 2 * _width * _height, NOVERTEX );
+        std::vector<unsigned int>   remap;
+        vertices.reserve( nvertices );
+        vnormals.reserve( normals ? nvertices : 0 );
+        faces.reserve( nfaces );
+
+        for( size_t s = 0; s < nslabs; s++ ) {
+            Slab& slab = slabs[ s ];
+
+            remap.assign( slab.vertices.size(), NOVERTEX );
+            for( size_t k = 0; k < slab.bottom.size(); k++ )
+                remap[ slab.bottom[ k ].second ] = shared[ slab.bottom[ k ].first ];
+            if( s ) {
+                for( size_t k = 0; k < slabs[ s - 1 ].top.size(); k++ )
+                    shared[ slabs[ s - 1 ].top[ k ].first ] = NOVERTEX;
+            }
 
+            for( size_t v = 0; v < slab.vertices.size(); v++ ) {
+                if( remap[ v ] != NOVERTEX )
+                    continue;
+                remap[ v ] = vertices.size();
+                vertices.push_back( slab.vertices[ v ] );
+                if( normals )
+                    vnormals.push_back( slab.normals[ v ] );
+            }
 
-                    /* Extract the normals from the volume around (x,y,z) */
-                    extractVolumeNormals( gridnormal, x, y, z );
+            for( size_t f = 0; f < slab.faces.size(); f++ )
+                faces.push_back( remap[ slab.faces[ f ] ] );
 
-                    /* Find the vertices and normals where the surface intersects the cube */
-                    interpolateVerticesAndNormals( vertlist, normlist, gridvtx, gridnormal, gridval, cubeindex, isolevel );
+            for( size_t k = 0; k < slab.top.size(); k++ )
+                shared[ slab.top[ k ].first ] = remap[ slab.top[ k ].second ];
 
-                    /* Create the triangle */
-                    for( int i = 0; _triTable[ cubeindex ][ i ] !=-1; i += 3 ) {
-                        vertices.push_back( vertlist[ _triTable[ cubeindex ][ i     ] ] );
-                        normals.push_back( normlist[ _triTable[ cubeindex ][ i     ] ] );
-                        faces.push_back( vtxIdx++ );
-                        vertices.push_back( vertlist[ _triTable[ cubeindex ][ i + 1 ] ] );
-                        normals.push_back( normlist[ _triTable[ cubeindex ][ i + 1 ] ] );
-                        faces.push_back( vtxIdx++ );
-                        vertices.push_back( vertlist[ _triTable[ cubeindex ][ i + 2 ] ] );
-                        normals.push_back( normlist[ _triTable[ cubeindex ][ i + 2 ] ] );
-                        faces.push_back( vtxIdx++ );
-                    }
-                }
-            }
+            /* release the slab early, the merged mesh is as large */
+            std::vector<Vector3f>().swap( slab.vertices );
+            std::vector<Vector3f>().swap( slab.normals );
+            std::vector<unsigned int>().swap( slab.faces );
         }
-        mesh.clear();
+
+        if( vertices.empty() )
+            return;
         mesh.setVertices( &vertices[ 0 ], vertices.size() );
-        mesh.setNormals( &normals[ 0 ], normals.size() );
+        if( normals )
+            mesh.setNormals( &vnormals[ 0 ], vnormals.size() );
         mesh.setFaces( &faces[ 0 ], faces.size(), SCENEMESH_TRIANGLES );
     }
 
-    void MarchingCubes::triangulateWithNormalsEMWeightedDistance( SceneMesh& mesh, float isolevel ) const
+    void MarchingCubes::triangulateSlabs( const Delegate<void ( const SceneMesh& )>& chunk, float isolevel, bool normals, bool EM, size_t slabdepth ) const
     {
-        const float WEIGHT_EPSILON = _minweight;
-        float gridval[ 8 ];
-        Vector3f gridvtx[ 8 ];
-        Vector3f gridnormal[ 8 ];
-        int cubeindex;
-        Vector3f vertlist[ 12 ];
-        Vector3f normlist[ 12 ];
-        size_t vtxIdx = 0;
-        std::vector<Vector3f> vertices;
-        std::vector<Vector3f> normals;
-        std::vector<unsigned int> faces;
-
-        size_t xend = _width - 2;
-        size_t yend = _height - 2;
-        size_t zend = _depth - 2;
-        for( size_t z = 1; z < zend; z++  ) {
-            for( size_t y = 1; y < yend; y++ ) {
-                for( size_t x = 1; x < xend; x++ ) {
-
-#define VOLUME( x, y, z ) _volume[ ( ( ( z ) * _height + ( y ) ) * _width + ( x ) ) * _channels ]
-#define VOLUMEWEIGHT( x, y, z ) ( ( _volume[ ( ( ( z ) * _height + ( y ) ) * _width + ( x ) ) * _channels + 1 ] ) / ( ( _volume[ ( ( ( z ) * _height + ( y ) ) * _width + ( x ) ) * _channels + 3 ] ) + 1e-8f ) )
-
-                    /* get the values of the current grid voxel */
-                    gridval[ 0 ] = VOLUME( x, y, z );
-                    if( VOLUMEWEIGHT( x, y, z ) <= WEIGHT_EPSILON ) continue;
-                    gridval[ 1 ] = VOLUME( x + 1, y, z );
-                    if( VOLUMEWEIGHT( x + 1, y, z ) <= WEIGHT_EPSILON ) continue;
-                    gridval[ 2 ] = VOLUME( x + 1, y + 1, z );
-                    if( VOLUMEWEIGHT( x + 1, y + 1, z ) <= WEIGHT_EPSILON ) continue;
-                    gridval[ 3 ] = VOLUME( x, y + 1, z );
-                    if( VOLUMEWEIGHT( x, y + 1, z ) <= WEIGHT_EPSILON ) continue;
-                    gridval[ 4 ] = VOLUME( x, y, z + 1 );
-                    if( VOLUMEWEIGHT( x, y, z + 1 ) <= WEIGHT_EPSILON ) continue;
-                    gridval[ 5 ] = VOLUME( x + 1, y, z + 1 );
-                    if( VOLUMEWEIGHT( x + 1, y, z + 1 ) <= WEIGHT_EPSILON ) continue;
-                    gridval[ 6 ] = VOLUME( x + 1, y + 1, z + 1);
-                    if( VOLUMEWEIGHT( x + 1, y + 1, z + 1 ) <= WEIGHT_EPSILON ) continue;
-                    gridval[ 7 ] = VOLUME( x, y + 1, z + 1 );
-                    if( VOLUMEWEIGHT( x, y + 1, z + 1 ) <= WEIGHT_EPSILON ) continue;
-
-#undef VOLUMEWEIGHT
-#undef VOLUME
-                    /* Determine the index into the edge table which
-                       tells us which vertices are inside of the surface */
-                    cubeindex = cubeIndexFromValues( gridval, isolevel );
-
-                    /* Cube is entirely in/out of the surface */
-                    if ( _edgeTable[ cubeindex ] == 0)
-                        continue;
-
-                    /* set the vertex positions of the current cell */
-                    setGridVertices( gridvtx, x, y, z );
-
-                    /* Extract the normals from the volume around (x,y,z) */
-                    extractVolumeNormals( gridnormal, x, y, z );
-
-                    /* Find the vertices and normals where the surface intersects the cube */
-                    interpolateVerticesAndNormals( vertlist, normlist, gridvtx, gridnormal, gridval, cubeindex, isolevel );
-
-                    /* Create the triangle */
-                    for( int i = 0; _triTable[ cubeindex ][ i ] !=-1; i += 3 ) {
-                        vertices.push_back( vertlist[ _triTable[ cubeindex ][ i     ] ] );
-                        normals.push_back( normlist[ _triTable[ cubeindex ][ i     ] ] );
-                        faces.push_back( vtxIdx++ );
-                        vertices.push_back( vertlist[ _triTable[ cubeindex ][ i + 1 ] ] );
-                        normals.push_back( normlist[ _triTable[ cubeindex ][ i + 1 ] ] );
-                        faces.push_back( vtxIdx++ );
-                        vertices.push_back( vertlist[ _triTable[ cubeindex ][ i + 2 ] ] );
-                        normals.push_back( normlist[ _triTable[ cubeindex ][ i + 2 ] ] );
-                        faces.push_back( vtxIdx++ );
-                    }
+        const size_t border = normals ? 1 : 0;
+        if( _width < 2 + 2 * border || _height < 2 + 2 * border || _depth < 2 + 2 * border )
+            return;
+
+        const size_t zbegin = border;
+        const size_t zend   = _depth - 1 - border;
+        const size_t depth  = Math::max<size_t>( slabdepth, 1 );
+        const size_t nslabs = ( zend - zbegin + depth - 1 ) / depth;
+        const size_t group  = ThreadPool::instance().numThreads() + 1;
+
+        for( size_t first = 0; first < nslabs; first += group ) {
+            std::vector<Slab> slabs( Math::min( group, nslabs - first ) );
+            ThreadPool::instance().parallelFor( 0, slabs.size(), 1, [ & ]( size_t begin, size_t end ) {
+                for( size_t s = begin; s < end; s++ ) {
+                    size_t z = zbegin + ( first + s ) * depth;
+                    triangulateSlab( slabs[ s ], z, Math::min( z + depth, zend ), isolevel, normals, EM );
                 }
+            } );
+
+            for( size_t s = 0; s < slabs.size(); s++ ) {
+                if( slabs[ s ].faces.empty() )
+                    continue;
+                SceneMesh mesh( "MarchingCubes" );
+                mesh.setVertices( &slabs[ s ].vertices[ 0 ], slabs[ s ].vertices.size() );
+                if( normals )
+                    mesh.setNormals( &slabs[ s ].normals[ 0 ], slabs[ s ].normals.size() );
+                mesh.setFaces( &slabs[ s ].faces[ 0 ], slabs[ s ].faces.size(), SCENEMESH_TRIANGLES );
+                chunk( mesh );
             }
         }
-        mesh.clear();
-        mesh.setVertices( &vertices[ 0 ], vertices.size() );
-        mesh.setNormals( &normals[ 0 ], normals.size() );
-        mesh.setFaces( &faces[ 0 ], faces.size(), SCENEMESH_TRIANGLES );
     }
 }
-
-
-
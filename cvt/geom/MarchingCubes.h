@@ -28,6 +28,8 @@
 
 #include <cvt/geom/scene/SceneMesh.h>
 #include <cvt/math/Vector.h>
+#include <cvt/util/Delegate.h>
+#include <utility>
 
 namespace cvt {
 
@@ -40,29 +42,48 @@ namespace cvt {
             void  triangulate( SceneMesh& mesh, float isolevel = 0.0f ) const;
             void  triangulateWithNormals( SceneMesh& mesh, float isolevel = 0.0f, bool EM = false ) const;
 
+            /**
+              @brief Triangulate the volume in slabs of slabdepth cell layers along z and pass every slab as a separate mesh
+
+              Only the slabs processed concurrently are kept in memory. The chunks are passed on the calling thread
+              in z order, the vertices on the plane between two slabs are contained in both chunks.
+             */
+            void  triangulateSlabs( const Delegate<void ( const SceneMesh& )>& chunk, float isolevel = 0.0f,
+                                    bool normals = false, bool EM = false, size_t slabdepth = 32 ) const;
+
             void  setMinimumWeight( float weight );
             float minimumWeight() const;
 
-        private:
-            void triangulateDistance( SceneMesh& mesh, float isolevel ) const;
-            void triangulateWithNormalsDistance( SceneMesh& mesh, float isolevel ) const;
+            /**
+              @brief Read the volume in a blocked layout
 
-            void triangulateWeightedDistance( SceneMesh& mesh, float isolevel ) const;
-            void triangulateWithNormalsWeightedDistance( SceneMesh& mesh, float isolevel ) const;
+              The volume is stored in cubic blocks of ( 1 << blockshift ) voxels per dimension, the blocks are
+              ordered in x, y, z with the volume dimensions padded to a multiple of the block size.
+              Every block holds the values of its voxels ordered in x, y, z followed by the weights in the same order.
+              A blockshift of 0 selects the default linear layout with interleaved channels.
+             */
+            void  setBlockLayout( size_t blockshift );
 
-            void triangulateWithNormalsEMWeightedDistance( SceneMesh& mesh, float isolevel ) const;
+        private:
+            /* vertices, normals and faces of a slab, the face indices refer to the slab vertices */
+            struct Slab {
+                std::vector<Vector3f>       vertices;
+                std::vector<Vector3f>       normals;
+                std::vector<unsigned int>   faces;
+                /* the vertices on the x- and y-edges of the first and the last plane of the slab as ( edge, vertex ) */
+                std::vector<std::pair<size_t, unsigned int> > bottom;
+                std::vector<std::pair<size_t, unsigned int> > top;
+            };
+
+            void triangulateVolume( SceneMesh& mesh, float isolevel, bool normals, bool EM ) const;
+            void triangulateSlab( Slab& slab, size_t zbegin, size_t zend, float isolevel, bool normals, bool EM ) const;
+            void loadPlane( float* values, uint8_t* valid, size_t z, bool EM ) const;
+            Vector3f gridNormal( size_t x, size_t y, size_t z ) const;
 
             void vertexInterp( Vector3f& vtx, const Vector3f& p1, const Vector3f& p2, float val1, float val2, float isolevel ) const;
             void vertexNormalInterp( Vector3f& vtx, const Vector3f& p1, const Vector3f& p2, Vector3f& norm, const Vector3f& n1, const Vector3f& n2, float val1, float val2, float isolevel ) const;
 
-            void extractVolumeValues( float* gridvalues, size_t x, size_t y, size_t z ) const;
-            bool extractVolumeValuesWithWeightCheck( float* gridvalues, size_t x, size_t y, size_t z, float minWeight ) const;
-            void extractVolumeNormals( Vector3f* normal, size_t x, size_t y, size_t z ) const;
-            unsigned int cubeIndexFromValues( float* gridvalues, float isolevel ) const;
-            void setGridVertices( Vector3f* vtx, size_t x, size_t y, size_t z ) const;
-            void interpolateVertices( Vector3f* vertlist, const Vector3f* gridvtx, const float* gridval, unsigned int cubeindex, float isolevel ) const;
-            void interpolateVerticesAndNormals( Vector3f* vertlist, Vector3f* normlist, const Vector3f* gridvtx, const Vector3f* gridnormal,
-                                                const float* gridval, unsigned int cubeindex, float isolevel ) const;
+            size_t voxelOffset( size_t x, size_t y, size_t z ) const;
 
             const float* _volume;
             size_t       _width;
@@ -71,6 +92,10 @@ namespace cvt {
             bool         _weighted;
             float        _minweight;
             size_t      _channels;
+            size_t      _blockshift;
+            size_t      _blockwidth;
+            size_t      _blockheight;
+            size_t      _weightoffset;
     };
 
     inline MarchingCubes::MarchingCubes( const float* volume, size_t width, size_t height, size_t depth, bool weighted, float minweight, ssize_t channels ) :
@@ -79,7 +104,11 @@ namespace cvt {
         _height( height ),
         _depth( depth ),
         _weighted( weighted ),
-        _minweight( minweight )
+        _minweight( minweight ),
+        _blockshift( 0 ),
+        _blockwidth( 0 ),
+        _blockheight( 0 ),
+        _weightoffset( 1 )
     {
         if( channels < 0 )
             _channels = _weighted ? 2 : 1;
@@ -93,22 +122,12 @@ namespace cvt {
 
     inline void MarchingCubes::triangulate( SceneMesh& mesh, float isolevel ) const
     {
-        if( _weighted )
-            triangulateWeightedDistance( mesh, isolevel );
-        else
-            triangulateDistance( mesh, isolevel );
+        triangulateVolume( mesh, isolevel, false, false );
     }
 
     inline void MarchingCubes::triangulateWithNormals( SceneMesh& mesh, float isolevel, bool EM ) const
     {
-        if( EM ) {
-            triangulateWithNormalsEMWeightedDistance( mesh, isolevel );
-        } else {
-            if( _weighted )
-                triangulateWithNormalsWeightedDistance( mesh, isolevel );
-            else
-                triangulateWithNormalsDistance( mesh, isolevel );
-        }
+        triangulateVolume( mesh, isolevel, true, EM );
     }
 
     inline void MarchingCubes::setMinimumWeight( float weight )
@@ -121,6 +140,26 @@ namespace cvt {
         return _minweight;
     }
 
+    inline void MarchingCubes::setBlockLayout( size_t blockshift )
+    {
+        size_t bmask = ( ( size_t ) 1 << blockshift ) - 1;
+        _blockshift   = blockshift;
+        _blockwidth   = ( _width + bmask ) >> blockshift;
+        _blockheight  = ( _height + bmask ) >> blockshift;
+        _weightoffset = blockshift ? ( ( size_t ) 1 << ( 3 * blockshift ) ) : 1;
+    }
+
+    inline size_t MarchingCubes::voxelOffset( size_t x, size_t y, size_t z ) const
+    {
+        if( !_blockshift )
+            return ( ( z * _height + y ) * _width + x ) * _channels;
+
+        size_t bmask  = ( ( size_t ) 1 << _blockshift ) - 1;
+        size_t block  = ( ( z >> _blockshift ) * _blockheight + ( y >> _blockshift ) ) * _blockwidth + ( x >> _blockshift );
+        size_t local  = ( ( ( ( z & bmask ) << _blockshift ) + ( y & bmask ) ) << _blockshift ) + ( x & bmask );
+        return ( block << ( 3 * _blockshift + 1 ) ) + local;
+    }
+
     inline void MarchingCubes::vertexInterp( Vector3f& vtx, const Vector3f& p1, const Vector3f& p2, float val1, float val2, float isolevel ) const
     {
         const float ISO_EPSILON = 1e-8f;
@@ -0,0 +1,205 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/geom/MarchingCubes.h>
+#include <cvt/util/CVTTest.h>
+
+#include <map>
+#include <vector>
+
+using namespace cvt;
+
+/* sphere not centered on the grid, the volume spans several slabs along z */
+static const size_t     _width  = 48;
+static const size_t     _height = 40;
+static const size_t     _depth  = 56;
+static const Vector3f   _center( 23.6f, 19.45f, 27.8f );
+static const float      _radius = 17.3f;
+
+/* signed distance to the sphere in the first channel, the voxels left of x = 24 get the weight in the channel
+   weightchannel, the others stay unobserved */
+static void _sphereVolume( std::vector<float>& volume, size_t channels, size_t weightchannel, float weight )
+{
+    volume.assign( _width * _height * _depth * channels, 0.0f );
+    float* voxel = &volume[ 0 ];
+    for( size_t z = 0; z < _depth; z++ ) {
+        for( size_t y = 0; y < _height; y++ ) {
+            for( size_t x = 0; x < _width; x++, voxel += channels ) {
+                voxel[ 0 ] = ( Vector3f( x, y, z ) - _center ).length() - _radius;
+                if( channels > 1 && x < 24 )
+                    voxel[ weightchannel ] = weight;
+                if( channels > 3 )
+                    voxel[ 3 ] = 2.0f;
+            }
+        }
+    }
+}
+
+/* every edge of a closed mesh is shared by exactly two faces, a vertex duplicated at a slab seam opens the mesh */
+static bool _closed( const SceneMesh& mesh )
+{
+    std::map<std::pair<unsigned int, unsigned int>, size_t> edges;
+    const unsigned int* faces = mesh.faces();
+    for( size_t f = 0; f < mesh.faceSize(); f++ ) {
+        for( size_t k = 0; k < 3; k++ ) {
+            unsigned int a = faces[ 3 * f + k ];
+            unsigned int b = faces[ 3 * f + ( k + 1 ) % 3 ];
+            edges[ std::make_pair( Math::min( a, b ), Math::max( a, b ) ) ]++;
+        }
+    }
+
+    for( std::map<std::pair<unsigned int, unsigned int>, size_t>::const_iterator it = edges.begin(); it != edges.end(); ++it ) {
+        if( it->second != 2 )
+            return false;
+    }
+    return !edges.empty();
+}
+
+/* no two vertices share a position */
+static bool _unique( const SceneMesh& mesh )
+{
+    SceneMesh copy( mesh );
+    copy.removeDuplicateVertices();
+    return copy.vertexSize() == mesh.vertexSize();
+}
+
+class MarchingCubesChunks {
+    public:
+        MarchingCubesChunks() : faces( 0 ), vertices( 0 ), chunks( 0 ) {}
+
+        void add( const SceneMesh& mesh )
+        {
+            faces += mesh.faceSize();
+            vertices += mesh.vertexSize();
+            chunks++;
+        }
+
+        size_t faces;
+        size_t vertices;
+        size_t chunks;
+};
+
+/* triangle and vertex counts of the serial implementation, which stored three vertices per triangle and
+   computed the vertices of an edge once per cube, the vertex counts are the ones of the merged positions */
+static const size_t _sphereFaces            = 11260;
+static const size_t _sphereVertices         = 5632;
+static const size_t _sphereNormalFaces      = 11260;
+static const size_t _sphereNormalVertices   = 5632;
+static const size_t _weightedFaces          = 5472;
+static const size_t _weightedVertices       = 2806;
+static const size_t _emFaces                = 5472;
+static const size_t _emVertices             = 2806;
+
+BEGIN_CVTTEST( MarchingCubes )
+    bool result = true;
+    bool b;
+
+    std::vector<float> volume;
+    _sphereVolume( volume, 1, 0, 0.0f );
+
+    SceneMesh mesh( "mc" );
+    MarchingCubes mc( &volume[ 0 ], _width, _height, _depth );
+    mc.triangulate( mesh );
+    b = mesh.faceSize() == _sphereFaces && mesh.vertexSize() == _sphereVertices;
+    for( size_t i = 0; b && i < mesh.vertexSize(); i++ )
+        b &= Math::abs( ( mesh.vertices()[ i ] - _center ).length() - _radius ) < 0.1f;
+    CVTTEST_PRINT( "sphere", b );
+    result &= b;
+
+    b = _closed( mesh ) && _unique( mesh );
+    CVTTEST_PRINT( "slab seams", b );
+    result &= b;
+
+    {
+        MarchingCubesChunks chunks;
+        mc.triangulateSlabs( Delegate<void ( const SceneMesh& )>( &chunks, &MarchingCubesChunks::add ), 0.0f, false, false, 5 );
+        b = chunks.chunks > 1 && chunks.faces == mesh.faceSize() && chunks.vertices > mesh.vertexSize();
+    }
+    CVTTEST_PRINT( "triangulateSlabs", b );
+    result &= b;
+
+    mc.triangulateWithNormals( mesh );
+    b = mesh.faceSize() == _sphereNormalFaces && mesh.vertexSize() == _sphereNormalVertices &&
+        mesh.normalSize() == mesh.vertexSize() && _closed( mesh );
+    for( size_t i = 0; b && i < mesh.vertexSize(); i++ ) {
+        /* the normals point against the gradient of the distance, into the sphere */
+        Vector3f dir = _center - mesh.vertices()[ i ];
+        dir.normalize();
+        b &= Math::abs( mesh.normals()[ i ].length() - 1.0f ) < 1e-4f && mesh.normals()[ i ] * dir > 0.99f;
+    }
+    CVTTEST_PRINT( "normals", b );
+    result &= b;
+
+    /* only the left half of the sphere is observed */
+    _sphereVolume( volume, 2, 1, 30.0f );
+    MarchingCubes mcw( &volume[ 0 ], _width, _height, _depth, true, 20.0f );
+    mcw.triangulate( mesh );
+    b = mesh.faceSize() == _weightedFaces && mesh.vertexSize() == _weightedVertices && _unique( mesh );
+    for( size_t i = 0; b && i < mesh.vertexSize(); i++ )
+        b &= mesh.vertices()[ i ].x <= 23.0f;
+    CVTTEST_PRINT( "weighted", b );
+    result &= b;
+
+    /* the same volume in blocks of 8^3 voxels */
+    {
+        const size_t bw = ( _width + 7 ) / 8, bh = ( _height + 7 ) / 8, bd = ( _depth + 7 ) / 8;
+        std::vector<float> blocked( bw * bh * bd * 1024, 0.0f );
+        for( size_t z = 0; z < _depth; z++ ) {
+            for( size_t y = 0; y < _height; y++ ) {
+                for( size_t x = 0; x < _width; x++ ) {
+                    size_t block = ( ( z / 8 ) * bh + y / 8 ) * bw + x / 8;
+                    size_t local = ( ( z % 8 ) * 8 + y % 8 ) * 8 + x % 8;
+                    const float* voxel = &volume[ ( ( z * _height + y ) * _width + x ) * 2 ];
+                    blocked[ block * 1024 + local ] = voxel[ 0 ];
+                    blocked[ block * 1024 + 512 + local ] = voxel[ 1 ];
+                }
+            }
+        }
+
+        SceneMesh bmesh( "mcblocked" );
+        MarchingCubes mcb( &blocked[ 0 ], _width, _height, _depth, true, 20.0f );
+        mcb.setBlockLayout( 3 );
+        mcb.triangulate( bmesh );
+        b = bmesh.faceSize() == mesh.faceSize() && bmesh.vertexSize() == mesh.vertexSize();
+        for( size_t i = 0; b && i < mesh.vertexSize(); i++ )
+            b &= bmesh.vertices()[ i ] == mesh.vertices()[ i ];
+        for( size_t i = 0; b && i < mesh.faceSize() * 3; i++ )
+            b &= bmesh.faces()[ i ] == mesh.faces()[ i ];
+    }
+    CVTTEST_PRINT( "block layout", b );
+    result &= b;
+
+    /* EM volume, the weight is the ratio of the second and the fourth channel */
+    _sphereVolume( volume, 4, 1, 60.0f );
+    MarchingCubes mcem( &volume[ 0 ], _width, _height, _depth, true, 20.0f, 4 );
+    mcem.triangulateWithNormals( mesh, 0.0f, true );
+    b = mesh.faceSize() == _emFaces && mesh.vertexSize() == _emVertices && mesh.normalSize() == mesh.vertexSize() && _unique( mesh );
+    for( size_t i = 0; b && i < mesh.vertexSize(); i++ )
+        b &= mesh.vertices()[ i ].x <= 23.0f;
+    CVTTEST_PRINT( "EM", b );
+    result &= b;
+
+    return result;
+END_CVTTEST
@@ -39,4 +39,17 @@ namespace cvt {
 		}
 		loader->load( *this, path );
 	}
+
+	void Scene::save( const String& path, SceneSaver* saver ) const
+	{
+		if( !saver ) {
+			saver = PluginManager::instance().getSceneSaverForFilename( path );
+			if( !saver ){
+                String message( "No SceneSaver for file available: " );
+                message += path;
+				throw CVTException( message.c_str() );
+            }
+		}
+		saver->save( path, *this );
+	}
 }
@@ -32,6 +32,7 @@
 namespace cvt {
 
 	class SceneLoader;
+	class SceneSaver;
 
 	class Scene {
 		public:
@@ -59,6 +60,7 @@ namespace cvt {
 
 
 			void					load( const String& path, SceneLoader* loader = NULL );
+			void					save( const String& path, SceneSaver* saver = NULL ) const;
 
 		private:
 			std::vector<SceneGeometry*> _geometries;
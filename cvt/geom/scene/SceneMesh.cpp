@@ -26,6 +26,7 @@
 #include <cvt/geom/scene/SceneMesh.h>
 #include <cvt/math/Vector.h>
 #include <cvt/container/List.h>
+#include <cvt/util/ThreadPool.h>
 #include <stack>
 
 namespace cvt {
@@ -91,180 +92,211 @@ namespace cvt {
             size_t _N;
     };
 
-    template<typename T>
-    class VertexHash {
+    /* uniform grid over the vertex positions, hashed into a table sized by the vertex count.
+       The cells are at least epsilon wide, so the vertices within epsilon of a point are found
+       in at most two cells per axis */
+    class VertexGrid {
         public:
+            static const unsigned int NONE = ~0u;
 
-            VertexHash( size_t N ) : _N( N )
+            VertexGrid( const std::vector<Vector3f>& vertices, float epsilon ) : _epsilon( epsilon )
             {
-                _buckets = new std::vector<Entry>[ _N ];
+                Vector3f min( 0.0f ), max( 0.0f );
+                if( vertices.size() ) {
+                    min = max = vertices[ 0 ];
+                    for( size_t i = 1; i < vertices.size(); i++ ) {
+                        min.x = Math::min( min.x, vertices[ i ].x );
+                        min.y = Math::min( min.y, vertices[ i ].y );
+                        min.z = Math::min( min.z, vertices[ i ].z );
+                        max.x = Math::max( max.x, vertices[ i ].x );
+                        max.y = Math::max( max.y, vertices[ i ].y );
+                        max.z = Math::max( max.z, vertices[ i ].z );
+                    }
+                }
+                /* at most 2^20 cells per axis, the cell coordinates are packed into 21 bits each */
+                float extent = Math::max( max.x - min.x, Math::max( max.y - min.y, max.z - min.z ) );
+                float cell = Math::max( epsilon, extent / ( float ) ( 1 << 20 ) );
+                if( cell <= 0.0f )
+                    cell = 1.0f;
+                _min = min;
+                _scale = 1.0f / cell;
+
+                size_t n = 16;
+                while( n < 2 * vertices.size() )
+                    n <<= 1;
+                _keys.assign( n, EMPTY );
+                _heads.resize( n );
+                _mask = n - 1;
+                _next.reserve( vertices.size() );
             }
 
-            ~VertexHash()
+            /* idx has to be the number of vertices added before */
+            void add( const Vector3f& v, unsigned int idx )
             {
-                delete[] _buckets;
+                uint64_t k = key( cellOf( v.x, _min.x ), cellOf( v.y, _min.y ), cellOf( v.z, _min.z ) );
+                size_t i = slot( k );
+                if( _keys[ i ] == EMPTY ) {
+                    _keys[ i ] = k;
+                    _heads[ i ] = NONE;
+                }
+                _next.push_back( _heads[ i ] );
+                _heads[ i ] = idx;
             }
 
-            void add( const Vector3f& k, T v )
+            /* the smallest index of the added vertices within epsilon of v accepted by match, NONE if there is none */
+            template<typename MATCH>
+            unsigned int find( const Vector3f& v, MATCH match ) const
             {
-                size_t bucket = hash( k );
-                _buckets[ bucket ].push_back( Entry( k, v ) );
+                unsigned int best = NONE;
+                uint64_t x0 = cellOf( v.x - _epsilon, _min.x ), x1 = cellOf( v.x + _epsilon, _min.x );
+                uint64_t y0 = cellOf( v.y - _epsilon, _min.y ), y1 = cellOf( v.y + _epsilon, _min.y );
+                uint64_t z0 = cellOf( v.z - _epsilon, _min.z ), z1 = cellOf( v.z + _epsilon, _min.z );
+                for( uint64_t z = z0; z <= z1; z++ ) {
+                    for( uint64_t y = y0; y <= y1; y++ ) {
+                        for( uint64_t x = x0; x <= x1; x++ ) {
+                            size_t i = slot( key( x, y, z ) );
+                            if( _keys[ i ] == EMPTY )
+                                continue;
+                            for( unsigned int idx = _heads[ i ]; idx != NONE; idx = _next[ idx ] ) {
+                                if( idx < best && match( idx ) )
+                                    best = idx;
+                            }
+                        }
+                    }
+                }
+                return best;
             }
 
-            const T* contains( const Vector3f& k ) const
+        private:
+            static const uint64_t EMPTY = ~( uint64_t ) 0;
+
+            /* offset by one, so the neighbours of the border cells stay positive */
+            uint64_t cellOf( float x, float min ) const
             {
-                size_t bucket = hash( k );
-                Entry* e = bucketContains( bucket, k );
-                if( e )
-                    return &( e->value );
-                return NULL;
+                float c = Math::floor( ( x - min ) * _scale ) + 1.0f;
+                return ( uint64_t ) Math::clamp( c, 0.0f, ( float ) ( ( 1 << 21 ) - 1 ) );
             }
 
-            size_t hash( const Vector3f& v ) const
+            static uint64_t key( uint64_t x, uint64_t y, uint64_t z )
             {
-                const size_t PRIME1 = 3;
-                const size_t PRIME2 = 7;
-                const size_t PRIME3 = 11;
-                size_t ret;
-
-                Math::_flint32 flint;
-                flint.f = v.x;
-                ret  = PRIME1 * ( size_t ) ( ( flint.i & 0x7ffffff0 ) >> 4 );
-                flint.f = v.y;
-                ret += PRIME2 * ( size_t ) ( ( flint.i & 0x7ffffff0 ) >> 4 );
-                flint.f = v.z;
-                ret += PRIME3 * ( size_t ) ( ( flint.i & 0x7ffffff0 ) >> 4 );
-                return ret % _N;
+                return x | ( y << 21 ) | ( z << 42 );
             }
 
-        private:
-            struct Entry {
-                Entry( const Vector3f& k, const T& v ) : key( k ), value( v )
-                {
-                }
-
-                Vector3f key;
-                T        value;
-            };
-
-            Entry* bucketContains( size_t bucket, const Vector3f& v ) const
+            size_t slot( uint64_t k ) const
             {
-                Vector3f tmp;
-                size_t size = _buckets[ bucket ].size();
-                for( size_t i = 0; i < size; i++ ) {
-                    tmp = _buckets[ bucket ][ i ].key;
-                    if( v.isEqual( tmp, Math::EPSILONF ) ) {
-                        return &_buckets[ bucket ][ i ];
-                    }
-                }
-
-                return NULL;
+                size_t i = ( size_t ) ( ( k * 0x9e3779b97f4a7c15ULL ) >> 32 ) & _mask;
+                while( _keys[ i ] != EMPTY && _keys[ i ] != k )
+                    i = ( i + 1 ) & _mask;
+                return i;
             }
 
-            std::vector<Entry>* _buckets;
-            size_t _N;
+            float                       _epsilon;
+            Vector3f                    _min;
+            float                       _scale;
+            std::vector<uint64_t>       _keys;
+            std::vector<unsigned int>   _heads;
+            size_t                      _mask;
+            std::vector<unsigned int>   _next;
     };
 
+    const unsigned int VertexGrid::NONE;
+    const uint64_t VertexGrid::EMPTY;
+
+    /* the corners of all faces grouped by vertex, the corners of vertex i are
+       corners[ start[ i ] ] ... corners[ start[ i + 1 ] - 1 ] in ascending order */
+    static void vertexCorners( std::vector<unsigned int>& start, std::vector<unsigned int>& corners, const std::vector<unsigned int>& vindices, size_t numVertices )
+    {
+        start.assign( numVertices + 1, 0 );
+        for( size_t i = 0; i < vindices.size(); i++ )
+            start[ vindices[ i ] + 1 ]++;
+        for( size_t i = 0; i < numVertices; i++ )
+            start[ i + 1 ] += start[ i ];
+
+        std::vector<unsigned int> pos( start.begin(), start.end() - 1 );
+        corners.resize( vindices.size() );
+        for( size_t i = 0; i < vindices.size(); i++ )
+            corners[ pos[ vindices[ i ] ]++ ] = i;
+    }
+
     void SceneMesh::removeRedundancy( float vepsilon, float nepsilon, float tepsilon )
     {
         std::vector<Vector3f>       nvertices;
         std::vector<Vector3f>       nnormals;
         std::vector<Vector2f>       ntexcoords;
-        std::vector<unsigned int>   indexold2new;
-        std::vector<unsigned int>   nvindices;
+        std::vector<unsigned int>   indexold2new( _vertices.size() );
+        std::vector<unsigned int>   nvindices( _vindices.size() );
+        VertexGrid                  grid( _vertices, vepsilon );
 
         for( size_t idx = 0; idx < _vertices.size(); idx++ ) {
-            Vector3f v( _vertices[ idx ] );
-            bool added = false;
-
-            for( size_t i = 0; i < nvertices.size() && !added; i++ ) {
-                if( v.isEqual( nvertices[ i ], vepsilon ) ) {
-                    if( hasNormals() ) {
-                        Vector3f n( _normals[ idx ] );
-                        if( !n.isEqual( nnormals[ i ], nepsilon ) )
-                            continue;
-                    }
-                    if( hasTexcoords() ) {
-                        Vector2f t = _texcoords[ idx ];
-                        if( !t.isEqual( ntexcoords[ i ], tepsilon ) )
-                            continue;
-                    }
-                    added = true;
-                    indexold2new.push_back( i );
-                }
-            }
-            if( !added ) {
+            const Vector3f& v = _vertices[ idx ];
+
+            // the first kept vertex matching in all attributes
+            unsigned int i = grid.find( v, [ & ]( unsigned int k ) {
+                if( !v.isEqual( nvertices[ k ], vepsilon ) )
+                    return false;
+                if( hasNormals() && !_normals[ idx ].isEqual( nnormals[ k ], nepsilon ) )
+                    return false;
+                if( hasTexcoords() && !_texcoords[ idx ].isEqual( ntexcoords[ k ], tepsilon ) )
+                    return false;
+                return true;
+            } );
+
+            if( i == VertexGrid::NONE ) {
+                i = nvertices.size();
                 nvertices.push_back( v );
                 if( hasNormals() )
                     nnormals.push_back( _normals[ idx ] );
                 if( hasTexcoords() )
                     ntexcoords.push_back( _texcoords[ idx ] );
-                indexold2new.push_back( nvertices.size() - 1 );
+                grid.add( v, i );
             }
+            indexold2new[ idx ] = i;
         }
 
-
         for( size_t idx = 0; idx < _vindices.size(); idx++ ) {
-            nvindices.push_back( indexold2new[ _vindices[ idx ] ] );
+            nvindices[ idx ] = indexold2new[ _vindices[ idx ] ];
         }
 
-        _vertices = nvertices;
-        _normals = nnormals;
-        _texcoords = ntexcoords;
-        _vindices = nvindices;
+        _vertices.swap( nvertices );
+        _normals.swap( nnormals );
+        _texcoords.swap( ntexcoords );
+        _vindices.swap( nvindices );
+        _adjacency.clear();
     }
 
 
     void SceneMesh::removeDuplicateVertices()
     {
-        VertexHash<size_t> vhash( 31357 ); //arbitrary huge prime - FIXME: consider number vertices when choosing prime number
-
         std::vector<Vector3f>       nvertices;
         std::vector<Vector3f>       nnormals;
         std::vector<Vector2f>       ntexcoords;
         std::vector<Vector3f>       ncolors;
         std::vector<Vector3f>       ntangents;
-        std::vector<unsigned int>   indexold2new;
-        std::vector<unsigned int>   nvindices;
+        std::vector<unsigned int>   indexold2new( _vertices.size() );
+        std::vector<unsigned int>   nvindices( _vindices.size() );
+        VertexGrid                  grid( _vertices, Math::EPSILONF );
 
         for( size_t idx = 0; idx < _vertices.size(); idx++ ) {
-            const size_t* entry;
-
-            bool found = false;
-            size_t idxFound;
-            // we only check one match
-            if( ( entry = vhash.contains( _vertices[ idx ] ) ) != NULL ) {
-                idxFound = *entry;
-                found = true;
-
-                /* check if also the other attributes match */
-                if( hasNormals() ) {
-                    Vector3f n( _normals[ idx ] );
-                    if( !n.isEqual( nnormals[ idxFound ], Math::EPSILONF ) )
-                        found = false;
-                }
-                if( hasTexcoords() ) {
-                    Vector2f t( _texcoords[ idx ] );
-                    if( !t.isEqual( ntexcoords[ idxFound ], Math::EPSILONF ) )
-                        found = false;
-                }
-                if( hasColors() ) {
-                    Vector3f col( _colors[ idx ] );
-                    if( !col.isEqual( ncolors[ idxFound ], Math::EPSILONF ) )
-                        found = false;
-                }
-                if( hasTangents() ) {
-                    Vector3f tan( _tangents[ idx ] );
-                    if( !tan.isEqual( ntangents[ idxFound ], Math::EPSILONF ) )
-                        found = false;
-                }
-            }
-
-            // already found so only push back the position
-            if( found ) {
-                indexold2new.push_back( idxFound );
-            } else {
-                nvertices.push_back( _vertices[ idx ] );
+            const Vector3f& v = _vertices[ idx ];
+
+            /* check if also the other attributes match */
+            unsigned int i = grid.find( v, [ & ]( unsigned int k ) {
+                if( !v.isEqual( nvertices[ k ], Math::EPSILONF ) )
+                    return false;
+                if( hasNormals() && !_normals[ idx ].isEqual( nnormals[ k ], Math::EPSILONF ) )
+                    return false;
+                if( hasTexcoords() && !_texcoords[ idx ].isEqual( ntexcoords[ k ], Math::EPSILONF ) )
+                    return false;
+                if( hasColors() && !_colors[ idx ].isEqual( ncolors[ k ], Math::EPSILONF ) )
+                    return false;
+                if( hasTangents() && !_tangents[ idx ].isEqual( ntangents[ k ], Math::EPSILONF ) )
+                    return false;
+                return true;
+            } );
+
+            if( i == VertexGrid::NONE ) {
+                i = nvertices.size();
+                nvertices.push_back( v );
                 if( hasNormals() )
                     nnormals.push_back( _normals[ idx ] );
                 if( hasTexcoords() )
@@ -273,21 +305,22 @@ namespace cvt {
                     ncolors.push_back( _colors[ idx ] );
                 if( hasTangents() )
                     ntangents.push_back( _tangents[ idx ] );
-                indexold2new.push_back( nvertices.size() - 1 );
-                vhash.add( _vertices[ idx ], nvertices.size() - 1 );
+                grid.add( v, i );
             }
+            indexold2new[ idx ] = i;
         }
 
         for( size_t idx = 0; idx < _vindices.size(); idx++ ) {
-            nvindices.push_back( indexold2new[ _vindices[ idx ] ] );
+            nvindices[ idx ] = indexold2new[ _vindices[ idx ] ];
         }
 
-        _vertices = nvertices;
-        _normals = nnormals;
-        _texcoords = ntexcoords;
-        _colors = ncolors;
-        _tangents = ntangents;
-        _vindices = nvindices;
+        _vertices.swap( nvertices );
+        _normals.swap( nnormals );
+        _texcoords.swap( ntexcoords );
+        _colors.swap( ncolors );
+        _tangents.swap( ntangents );
+        _vindices.swap( nvindices );
+        _adjacency.clear();
     }
 
 
@@ -309,6 +342,7 @@ namespace cvt {
         }
 
         _vindices = nvindices;
+        _adjacency.clear();
     }
 
     void SceneMesh::removeIsolatedComponents()
@@ -372,6 +406,7 @@ namespace cvt {
         }
 
         _vindices = components[ maxcomp ];
+        _adjacency.clear();
     }
 
     void SceneMesh::quadsToTriangles()
@@ -391,6 +426,7 @@ namespace cvt {
         }
 
         _vindices = nvindices;
+        _adjacency.clear();
         _meshtype = SCENEMESH_TRIANGLES;
     }
 
@@ -416,58 +452,154 @@ namespace cvt {
 
     void SceneMesh::calculateNormals( float angleweight, float areaweight )
     {
-        _normals.clear();
-        _normals.resize( _vertices.size(), Vector3f( 0.0f, 0.0f, 0.0f ) );
+        /* the weighted face normal of every corner is computed per face, the vertex normals
+           then sum their corners in face order, so no two tasks write the same normal */
+        const size_t nface = _meshtype == SCENEMESH_TRIANGLES ? 3 : 4;
+        const size_t nfaces = _vindices.size() / nface;
+        std::vector<Vector3f> cornerNormals( nfaces * nface );
 
         if( _meshtype == SCENEMESH_TRIANGLES ) {
-            size_t size = _vindices.size();
-            for( size_t n = 0; n < size; n += 3 ) {
-                Vector3f v[ 3 ];
-                v[ 0 ] = _vertices[ _vindices[ n + 0 ] ];
-                v[ 1 ] = _vertices[ _vindices[ n + 1 ] ];
-                v[ 2 ] = _vertices[ _vindices[ n + 2 ] ];
-                Vector3f normal;
-                normal.cross( v[ 1 ] - v[ 0 ], v[ 2 ] - v[ 0 ] );
-                float area = 1.0f;//normal.normalize();
-                area = Math::sqrt( area ) * 0.5f;
-                for (int k = 0; k < 3; k++ ) {
-                    Vector3f a = v[ ( k + 1 ) % 3 ] - v[ k ];
-                    Vector3f b = v[ ( k + 2 ) % 3 ] - v[ k ];
-                    float angle = 1.0f;// Math::acos( ( a * b ) / ( a.length() * b.length() ) );
-                    _normals[ _vindices[ n + k ] ] += ( 1.0f +  angleweight * angle + areaweight * area ) * normal;
+            ThreadPool::instance().parallelFor( 0, nfaces, 4096, [ & ]( size_t begin, size_t end ) {
+                for( size_t f = begin; f < end; f++ ) {
+                    size_t n = f * 3;
+                    Vector3f v[ 3 ];
+                    v[ 0 ] = _vertices[ _vindices[ n + 0 ] ];
+                    v[ 1 ] = _vertices[ _vindices[ n + 1 ] ];
+                    v[ 2 ] = _vertices[ _vindices[ n + 2 ] ];
+                    Vector3f normal;
+                    normal.cross( v[ 1 ] - v[ 0 ], v[ 2 ] - v[ 0 ] );
+                    float area = 1.0f;//normal.normalize();
+                    area = Math::sqrt( area ) * 0.5f;
+                    for (int k = 0; k < 3; k++ ) {
+                        float angle = 1.0f;// Math::acos( ( a * b ) / ( a.length() * b.length() ) );
+                        cornerNormals[ n + k ] = ( 1.0f +  angleweight * angle + areaweight * area ) * normal;
+                    }
                 }
-            }
+            } );
         } else if( _meshtype == SCENEMESH_QUADS ) {
-            size_t size = _vindices.size();
-            for( size_t n = 0; n < size; n += 4 ) {
-                Vector3f v[ 4 ];
-                v[ 0 ] = _vertices[ _vindices[ n + 0 ] ];
-                v[ 1 ] = _vertices[ _vindices[ n + 1 ] ];
-                v[ 2 ] = _vertices[ _vindices[ n + 2 ] ];
-                v[ 3 ] = _vertices[ _vindices[ n + 3 ] ];
-                Vector3f normal;
-                normal.cross( v[ 1 ] - v[ 0 ], v[ 2 ] - v[ 0 ] );
-                float area = normal.normalize();
-                area = Math::sqrt( area );
-                area = 0.5f * ( area + ( v[ 1 ] - v[ 3 ] ).cross( v[ 2 ] - v[ 3 ] ).length() );
-                for (int k = 0; k < 4; k++ ) {
-                    int lower = ( k - 1 );
-                    if( lower < 0 )
-                        lower = 3;
-                    Vector3f a = v[ lower ] - v[ k ];
-                    Vector3f b = v[ ( k + 1 ) % 4 ] - v[ k ];
-                    float angle = Math::acos( ( a * b ) / ( a.length() * b.length() ) );
-                    _normals[ _vindices[ n + k ] ] += ( 1.0f +  angleweight * angle + areaweight * area ) * normal;
+            ThreadPool::instance().parallelFor( 0, nfaces, 4096, [ & ]( size_t begin, size_t end ) {
+                for( size_t f = begin; f < end; f++ ) {
+                    size_t n = f * 4;
+                    Vector3f v[ 4 ];
+                    v[ 0 ] = _vertices[ _vindices[ n + 0 ] ];
+                    v[ 1 ] = _vertices[ _vindices[ n + 1 ] ];
+                    v[ 2 ] = _vertices[ _vindices[ n + 2 ] ];
+                    v[ 3 ] = _vertices[ _vindices[ n + 3 ] ];
+                    Vector3f normal;
+                    normal.cross( v[ 1 ] - v[ 0 ], v[ 2 ] - v[ 0 ] );
+                    float area = normal.normalize();
+                    area = Math::sqrt( area );
+                    area = 0.5f * ( area + ( v[ 1 ] - v[ 3 ] ).cross( v[ 2 ] - v[ 3 ] ).length() );
+                    for (int k = 0; k < 4; k++ ) {
+                        int lower = ( k - 1 );
+                        if( lower < 0 )
+                            lower = 3;
+                        Vector3f a = v[ lower ] - v[ k ];
+                        Vector3f b = v[ ( k + 1 ) % 4 ] - v[ k ];
+                        float angle = Math::acos( ( a * b ) / ( a.length() * b.length() ) );
+                        cornerNormals[ n + k ] = ( 1.0f +  angleweight * angle + areaweight * area ) * normal;
+                    }
                 }
-            }
+            } );
         }
-        size_t size = _normals.size();
-        for( size_t n = 0; n < size; n++ )
-            _normals[ n ].normalize();
+
+        std::vector<unsigned int> start, corners;
+        vertexCorners( start, corners, _vindices, _vertices.size() );
+
+        _normals.resize( _vertices.size() );
+        ThreadPool::instance().parallelFor( 0, _vertices.size(), 4096, [ & ]( size_t begin, size_t end ) {
+            for( size_t i = begin; i < end; i++ ) {
+                Vector3f normal( 0.0f, 0.0f, 0.0f );
+                for( size_t c = start[ i ]; c < start[ i + 1 ] && corners[ c ] < cornerNormals.size(); c++ )
+                    normal += cornerNormals[ corners[ c ] ];
+                normal.normalize();
+                _normals[ i ] = normal;
+            }
+        } );
     }
 
     void SceneMesh::calculateTangents()
     {
+        /* tangents along the first texture coordinate, orthogonalized against the normals */
+        if( !hasTexcoords() ) {
+            _tangents.clear();
+            return;
+        }
+        if( !hasNormals() )
+            calculateNormals();
+
+        const size_t nface = _meshtype == SCENEMESH_TRIANGLES ? 3 : 4;
+        const size_t nfaces = _vindices.size() / nface;
+        std::vector<Vector3f> cornerTangents( nfaces * nface );
+
+        ThreadPool::instance().parallelFor( 0, nfaces, 4096, [ & ]( size_t begin, size_t end ) {
+            for( size_t f = begin; f < end; f++ ) {
+                const unsigned int* face = &_vindices[ f * nface ];
+                for( size_t k = 0; k < nface; k++ ) {
+                    unsigned int i0 = face[ k ];
+                    unsigned int i1 = face[ ( k + 1 ) % nface ];
+                    unsigned int i2 = face[ ( k + nface - 1 ) % nface ];
+                    Vector3f e1 = _vertices[ i1 ] - _vertices[ i0 ];
+                    Vector3f e2 = _vertices[ i2 ] - _vertices[ i0 ];
+                    Vector2f t1 = _texcoords[ i1 ] - _texcoords[ i0 ];
+                    Vector2f t2 = _texcoords[ i2 ] - _texcoords[ i0 ];
+                    float det = t1.x * t2.y - t2.x * t1.y;
+                    if( Math::abs( det ) > Math::EPSILONF )
+                        cornerTangents[ f * nface + k ] = ( t2.y * e1 - t1.y * e2 ) * ( 1.0f / det );
+                    else
+                        cornerTangents[ f * nface + k ].setZero();
+                }
+            }
+        } );
+
+        std::vector<unsigned int> start, corners;
+        vertexCorners( start, corners, _vindices, _vertices.size() );
+
+        _tangents.resize( _vertices.size() );
+        ThreadPool::instance().parallelFor( 0, _vertices.size(), 4096, [ & ]( size_t begin, size_t end ) {
+            for( size_t i = begin; i < end; i++ ) {
+                Vector3f tangent( 0.0f, 0.0f, 0.0f );
+                for( size_t c = start[ i ]; c < start[ i + 1 ] && corners[ c ] < cornerTangents.size(); c++ )
+                    tangent += cornerTangents[ corners[ c ] ];
+                const Vector3f& n = _normals[ i ];
+                tangent -= ( n * tangent ) * n;
+                tangent.normalize();
+                _tangents[ i ] = tangent;
+            }
+        } );
+    }
+
+    void SceneMesh::calculateAdjacency()
+    {
+        const size_t nface = _meshtype == SCENEMESH_TRIANGLES ? 3 : 4;
+        const size_t nfaces = _vindices.size() / nface;
+
+        std::vector<unsigned int> start, corners;
+        vertexCorners( start, corners, _vindices, _vertices.size() );
+
+        /* the face sharing the edge from corner c to the next corner has the reversed edge,
+           it is searched among the corners of the edge end point */
+        _adjacency.resize( nfaces * nface );
+        ThreadPool::instance().parallelFor( 0, nfaces, 4096, [ & ]( size_t begin, size_t end ) {
+            for( size_t f = begin; f < end; f++ ) {
+                for( size_t k = 0; k < nface; k++ ) {
+                    unsigned int a = _vindices[ f * nface + k ];
+                    unsigned int b = _vindices[ f * nface + ( k + 1 ) % nface ];
+                    unsigned int adj = SCENEMESH_NOADJACENCY;
+                    for( size_t c = start[ b ]; c < start[ b + 1 ]; c++ ) {
+                        size_t g = corners[ c ] / nface;
+                        if( g == f || g >= nfaces )
+                            continue;
+                        size_t next = g * nface + ( corners[ c ] % nface + 1 ) % nface;
+                        if( _vindices[ next ] == a ) {
+                            adj = g;
+                            break;
+                        }
+                    }
+                    _adjacency[ f * nface + k ] = adj;
+                }
+            }
+        } );
     }
 
 }
@@ -37,6 +37,9 @@ namespace cvt {
         SCENEMESH_QUADS
     };
 
+    /* adjacency entry of a border edge */
+    static const unsigned int SCENEMESH_NOADJACENCY = ~0u;
+
     class SceneMesh : public SceneGeometry {
     public:
                                 SceneMesh( const String& name );
@@ -79,6 +82,11 @@ namespace cvt {
             const Vector3f*     colors() const;
             const unsigned int* faces() const;
             void                facesTriangles( std::vector<unsigned int>& output ) const;
+            /* for every edge of every face the index of the face sharing it or SCENEMESH_NOADJACENCY,
+               edge k of a face goes from its vertex k to k + 1. Valid after calculateAdjacency(), changes of
+               the vertices or faces discard it and adjacency() returns NULL until it is calculated again */
+            const unsigned int* adjacency() const;
+            size_t              adjacencySize() const;
 
             Vector3f            centroid() const;
             Boxf                boundingBox() const;
@@ -110,6 +118,7 @@ namespace cvt {
             std::vector<Vector2f>       _texcoords;
             std::vector<Vector3f>       _colors;
             std::vector<unsigned int>   _vindices;
+            std::vector<unsigned int>   _adjacency;
             SceneMeshType               _meshtype;
     };
 
@@ -132,7 +141,9 @@ namespace cvt {
         _normals.clear();
         _texcoords.clear();
         _colors.clear();
+        _tangents.clear();
         _vindices.clear();
+        _adjacency.clear();
         _meshtype = SCENEMESH_TRIANGLES;
     }
 
@@ -220,6 +231,7 @@ namespace cvt {
     inline void SceneMesh::setVertices( const Vector3f* data, size_t size )
     {
         _vertices.assign( data, data + size );
+        _adjacency.clear();
     }
 
     inline void SceneMesh::setNormals( const Vector3f* data, size_t size )
@@ -246,6 +258,7 @@ namespace cvt {
     {
         _meshtype = meshtype;
         _vindices.assign( data, data + size );
+        _adjacency.clear();
     }
 
     inline const Vector3f* SceneMesh::vertices() const
@@ -278,6 +291,16 @@ namespace cvt {
         return &_vindices[ 0 ];
     }
 
+    inline const unsigned int* SceneMesh::adjacency() const
+    {
+        return _adjacency.empty() ? NULL : &_adjacency[ 0 ];
+    }
+
+    inline size_t SceneMesh::adjacencySize() const
+    {
+        return _adjacency.size();
+    }
+
     inline Vector3f SceneMesh::centroid( ) const
     {
         size_t n = _vertices.size();
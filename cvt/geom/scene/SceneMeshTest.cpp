@@ -0,0 +1,111 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/geom/scene/SceneMesh.h>
+#include <cvt/util/CVTTest.h>
+
+using namespace cvt;
+
+/* every edge of a closed mesh has exactly one neighbour, which has the reversed edge */
+static bool _closedAdjacency( const SceneMesh& mesh )
+{
+    const unsigned int* adj = mesh.adjacency();
+    const unsigned int* faces = mesh.faces();
+    size_t nfaces = mesh.faceSize();
+    if( !adj || mesh.adjacencySize() != nfaces * 3 )
+        return false;
+
+    for( size_t f = 0; f < nfaces; f++ ) {
+        for( size_t k = 0; k < 3; k++ ) {
+            unsigned int g = adj[ f * 3 + k ];
+            if( g == SCENEMESH_NOADJACENCY || g >= nfaces || g == f )
+                return false;
+            unsigned int a = faces[ f * 3 + k ];
+            unsigned int b = faces[ f * 3 + ( k + 1 ) % 3 ];
+            bool found = false;
+            for( size_t l = 0; l < 3; l++ )
+                found |= faces[ g * 3 + l ] == b && faces[ g * 3 + ( l + 1 ) % 3 ] == a && adj[ g * 3 + l ] == f;
+            if( !found )
+                return false;
+        }
+    }
+    return true;
+}
+
+BEGIN_CVTTEST( SceneMesh )
+    bool result = true;
+    bool b;
+
+    /* tetrahedron with consistently oriented faces */
+    const Vector3f vertices[ 4 ] = { Vector3f( 0.0f, 0.0f, 0.0f ), Vector3f( 1.0f, 0.0f, 0.0f ),
+                                     Vector3f( 0.0f, 1.0f, 0.0f ), Vector3f( 0.0f, 0.0f, 1.0f ) };
+    const unsigned int faces[ 12 ] = { 0, 2, 1,  0, 1, 3,  0, 3, 2,  1, 2, 3 };
+
+    SceneMesh mesh( "tetrahedron" );
+    mesh.setVertices( vertices, 4 );
+    mesh.setFaces( faces, 12, SCENEMESH_TRIANGLES );
+    b = mesh.adjacency() == NULL && mesh.adjacencySize() == 0;
+    mesh.calculateAdjacency();
+    b &= _closedAdjacency( mesh );
+    CVTTEST_PRINT( "calculateAdjacency", b );
+    result &= b;
+
+    mesh.setFaces( faces, 12, SCENEMESH_TRIANGLES );
+    b = mesh.adjacency() == NULL;
+    CVTTEST_PRINT( "setFaces discards adjacency", b );
+    result &= b;
+
+    /* one vertex per corner, the faces only connect after welding */
+    Vector3f soup[ 12 ];
+    unsigned int soupfaces[ 12 ];
+    for( size_t i = 0; i < 12; i++ ) {
+        soup[ i ] = vertices[ faces[ i ] ];
+        soupfaces[ i ] = i;
+    }
+    mesh.setVertices( soup, 12 );
+    mesh.setFaces( soupfaces, 12, SCENEMESH_TRIANGLES );
+    mesh.calculateAdjacency();
+    b = mesh.adjacencySize() == 12;
+    for( size_t i = 0; b && i < 12; i++ )
+        b &= mesh.adjacency()[ i ] == SCENEMESH_NOADJACENCY;
+    mesh.removeDuplicateVertices();
+    b &= mesh.vertexSize() == 4 && mesh.adjacency() == NULL;
+    mesh.calculateAdjacency();
+    b &= _closedAdjacency( mesh );
+    CVTTEST_PRINT( "removeDuplicateVertices", b );
+    result &= b;
+
+    mesh.setVertices( soup, 12 );
+    mesh.setFaces( soupfaces, 12, SCENEMESH_TRIANGLES );
+    mesh.calculateAdjacency();
+    mesh.removeRedundancy( 1e-5f );
+    b = mesh.vertexSize() == 4 && mesh.adjacency() == NULL;
+    mesh.calculateAdjacency();
+    b &= _closedAdjacency( mesh );
+    CVTTEST_PRINT( "removeRedundancy", b );
+    result &= b;
+
+    return result;
+END_CVTTEST
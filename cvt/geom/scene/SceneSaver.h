@@ -0,0 +1,55 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_SCENESAVER_H
+#define CVT_SCENESAVER_H
+
+#include <cvt/util/Plugin.h>
+#include <cvt/util/String.h>
+#include <cvt/geom/scene/Scene.h>
+
+namespace cvt {
+	class SceneSaver : public Plugin
+	{
+		public:
+			SceneSaver() : Plugin( PLUGIN_SCENESAVER ) {};
+
+			virtual void save( const String& file, const Scene& src ) = 0;
+			virtual const String& extension( size_t n ) const = 0;
+			virtual size_t sizeExtensions() const = 0;
+			virtual const String& name() const = 0;
+			bool isExtensionSupported( const String& suffix ) const;
+	};
+
+	inline bool SceneSaver::isExtensionSupported( const String& suffix ) const
+	{
+		for( size_t i = 0, end = sizeExtensions(); i < end; i++ ) {
+			if( suffix == extension( i ) )
+				return true;
+		}
+        return false;
+	}
+}
+
+#endif
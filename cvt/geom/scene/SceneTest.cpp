@@ -0,0 +1,122 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/geom/scene/Scene.h>
+#include <cvt/geom/scene/SceneMesh.h>
+#include <cvt/util/CVTTest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace cvt;
+
+static bool _writeTemp( String& path, const char* suffix, const char* content )
+{
+    char name[ 64 ];
+    snprintf( name, sizeof( name ), "/tmp/cvtsceneXXXXXX%s", suffix );
+    int fd = mkstemps( name, strlen( suffix ) );
+    if( fd < 0 )
+        return false;
+    size_t len = strlen( content );
+    bool ret = write( fd, content, len ) == ( ssize_t ) len;
+    close( fd );
+    path = name;
+    return ret;
+}
+
+static bool _loadObj( Scene& scene, const char* content )
+{
+    String path;
+    if( !_writeTemp( path, ".obj", content ) )
+        return false;
+    scene.clear();
+    scene.load( path );
+    unlink( path.c_str() );
+    return true;
+}
+
+static bool _plyRoundTrip()
+{
+    const Vector3f vertices[ 4 ] = { Vector3f( 0.0f, 0.0f, 0.0f ), Vector3f( 1.0f, 0.0f, 0.0f ),
+                                     Vector3f( 1.0f, 1.0f, 0.5f ), Vector3f( 0.0f, 1.0f, -0.25f ) };
+    const unsigned int faces[ 6 ] = { 0, 1, 2, 0, 2, 3 };
+
+    Scene scene;
+    SceneMesh* mesh = new SceneMesh( "plyroundtrip" );
+    mesh->setVertices( vertices, 4 );
+    mesh->setFaces( faces, 6, SCENEMESH_TRIANGLES );
+    mesh->calculateNormals();
+    scene.addGeometry( mesh );
+
+    String path;
+    if( !_writeTemp( path, ".ply", "" ) )
+        return false;
+    scene.save( path );
+    Scene loaded;
+    loaded.load( path );
+    unlink( path.c_str() );
+
+    if( loaded.geometrySize() != 1 || loaded.geometry( 0 )->type() != SCENEGEOMETRY_MESH )
+        return false;
+    const SceneMesh* lmesh = ( const SceneMesh* ) loaded.geometry( 0 );
+    if( lmesh->vertexSize() != 4 || lmesh->faceSize() != 2 || lmesh->normalSize() != 4 )
+        return false;
+    for( size_t i = 0; i < 4; i++ ) {
+        if( lmesh->vertex( i ) != mesh->vertex( i ) || lmesh->normal( i ) != mesh->normal( i ) )
+            return false;
+    }
+    return memcmp( lmesh->faces(), faces, sizeof( faces ) ) == 0;
+}
+
+BEGIN_CVTTEST( Scene )
+    bool result = true;
+    bool b;
+    Scene scene;
+
+    b = _loadObj( scene, "v 0 0 0\nv\t1 0 0\n  v 1 1 0\nv 0 1 0\nvn 0 0 1\nf 1//1 2//1 3//1 4//1\n" ) &&
+        scene.geometrySize() == 1;
+    if( b ) {
+        const SceneMesh* mesh = ( const SceneMesh* ) scene.geometry( 0 );
+        b = mesh->faceSize() == 2 && mesh->vertexSize() == 6 && mesh->normalSize() == 6 &&
+            mesh->vertex( 1 ) == Vector3f( 1.0f, 0.0f, 0.0f ) &&
+            mesh->vertex( 5 ) == Vector3f( 0.0f, 1.0f, 0.0f );
+    }
+    CVTTEST_PRINT( "OBJ load", b );
+    result &= b;
+
+    /* a bare "v" is a vertex without coordinates, counted and parsed alike the load fails */
+    b = _loadObj( scene, "v 0 0 0\nv\nv 1 0 0\nv 0 1 0\nf 1 3 4\n" ) && scene.geometrySize() == 0;
+    b &= _loadObj( scene, "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\nv" ) && scene.geometrySize() == 0;
+    CVTTEST_PRINT( "OBJ bare vertex", b );
+    result &= b;
+
+    b = _plyRoundTrip();
+    CVTTEST_PRINT( "PLY save/load", b );
+    result &= b;
+
+    return result;
+END_CVTTEST
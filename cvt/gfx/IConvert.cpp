@@ -26,6 +26,7 @@
 #include <cvt/gfx/IConvert.h>
 #include <cvt/gfx/Image.h>
 #include <cvt/gfx/IMapScoped.h>
+#include <cvt/gfx/IParallel.h>
 #include <cvt/util/SIMD.h>
 
 namespace cvt {
@@ -35,24 +36,20 @@ namespace cvt {
     {                                                                               \
         SIMD* simd = SIMD::instance();                                              \
         const uint8_t* src;                                                         \
-        const uint8_t* sbase;                                                       \
         size_t sstride;                                                             \
         size_t dstride;                                                             \
         uint8_t* dst;                                                               \
-        uint8_t* dbase;                                                             \
-        size_t h;                                                                   \
         const size_t w = width;                                                     \
                                                                                     \
-        sbase = src = sourceImage.map( &sstride );                                  \
-        dbase = dst = dstImage.map( &dstride );                                     \
-        h = sourceImage.height();                                                   \
-        while( h-- ) {                                                              \
-            simd->func( ( dsttype ) dst, ( const srctype ) src, w );                \
-            src += sstride;                                                         \
-            dst += dstride;                                                         \
-        }                                                                           \
-        sourceImage.unmap( sbase );                                                 \
-        dstImage.unmap( dbase );                                                    \
+        src = sourceImage.map( &sstride );                                          \
+        dst = dstImage.map( &dstride );                                             \
+        parallelForRows( sourceImage, [&]( size_t ystart, size_t yend ) {           \
+            for( size_t y = ystart; y < yend; y++ )                                 \
+                simd->func( ( dsttype ) ( dst + y * dstride ),                      \
+                            ( const srctype ) ( src + y * sstride ), w );           \
+        } );                                                                        \
+        sourceImage.unmap( src );                                                   \
+        dstImage.unmap( dst );                                                      \
         return;                                                                     \
     }
 
@@ -26,6 +26,7 @@
 #include <cvt/gfx/Image.h>
 #include <cvt/gfx/IMapScoped.h>
 #include <cvt/gfx/IBorder.h>
+#include <cvt/gfx/IParallel.h>
 #include <cvt/util/SIMD.h>
 #include <cvt/util/ScopedBuffer.h>
 
@@ -44,8 +45,6 @@ namespace cvt {
 		ssize_t h = src.height();
 		size_t widthchannels = w * src.channels();
 		size_t bstride = Math::pad16( sizeof( BUFTYPE ) * widthchannels ) / sizeof( BUFTYPE ); //FIXME: does this always work - it should
-		BUFTYPE** buf;
-		ssize_t cy;
 
 		IMapScoped<DSTTYPE> mapdst( dst );
 		IMapScoped<const SRCTYPE> mapsrc( src );
@@ -53,50 +52,33 @@ namespace cvt {
 		ssize_t b1 = ( kh >> 1 );
 		ssize_t b2 = kh - b1 - 1;
 
-		/* allocate buffers and fill buffer*/
-		ScopedBuffer<BUFTYPE,true> bufmem( bstride * kh );
-		ScopedBuffer<BUFTYPE*,true> bufptr( kh );
+		/* every band keeps its own ring of kh horizontally filtered lines */
+		parallelForRows( src, [&]( size_t ystart, size_t yend ) {
+			ScopedBuffer<BUFTYPE,true> bufmem( bstride * kh );
+			ScopedBuffer<BUFTYPE*,true> bufptr( kh );
 
-		buf = bufptr.ptr();
-		buf[ 0 ] = bufmem.ptr();
-		for( size_t i = 1; i < kh; i++ )
-			buf[ i ] = buf[ i - 1 ] + bstride;
+			BUFTYPE** buf = bufptr.ptr();
+			buf[ 0 ] = bufmem.ptr();
+			for( size_t i = 1; i < kh; i++ )
+				buf[ i ] = buf[ i - 1 ] + bstride;
 
-		for( ssize_t k = -b1; k <= b2; k++ ) {
-			ssize_t y = IBorder::value( k, h, btype );
-			( simd->*hconv )( buf[ k + b1 ], mapsrc.line( y ), w, hkern, kw, btype );
-		}
-		/* process first line */
-		( simd->*vconv )( mapdst.ptr(), ( const BUFTYPE** ) buf, vkern, kh, widthchannels );
-		mapdst++;
+			for( ssize_t k = -b1; k <= b2; k++ ) {
+				ssize_t y = IBorder::value<ssize_t>( ystart + k, h, btype );
+				( simd->*hconv )( buf[ k + b1 ], mapsrc.line( y ), w, hkern, kw, btype );
+			}
+			/* process first line */
+			( simd->*vconv )( mapdst.line( ystart ), ( const BUFTYPE** ) buf, vkern, kh, widthchannels );
 
-		mapsrc.setLine( b2 + 1 );
-		/* main part */
-		for( cy = 1; cy < h - b2; cy++ )
-		{
+			for( ssize_t cy = ystart + 1; cy < ( ssize_t ) yend; cy++ ) {
 				BUFTYPE* tmp = buf[ 0 ];
 				for( size_t k = 0; k < kh - 1; k++ )
 					buf[ k ] = buf[ k + 1 ];
 				buf[ kh - 1 ] = tmp;
-				( simd->*hconv )( tmp, mapsrc.ptr(), w, hkern, kw, btype );
-				( simd->*vconv )( mapdst.ptr(), ( const BUFTYPE** ) buf, vkern, kh, widthchannels );
-				mapdst++;
-				mapsrc++;
-
-		}
-
-		/* lower border */
-		for( ; cy < h; cy++ ) {
-			BUFTYPE* tmp = buf[ 0 ];
-			for( size_t k = 0; k < kh - 1; k++ )
-				buf[ k ] = buf[ k + 1 ];
-			buf[ kh - 1 ] = tmp;
-			ssize_t y = IBorder::value( cy + b2, h, btype );
-			( simd->*hconv )( tmp, mapsrc.line( y ), w, hkern, kw, btype );
-			( simd->*vconv )( mapdst.ptr(), ( const BUFTYPE** ) buf, vkern, kh, widthchannels );
-			mapdst++;
-		}
-
+				ssize_t y = IBorder::value<ssize_t>( cy + b2, h, btype );
+				( simd->*hconv )( tmp, mapsrc.line( y ), w, hkern, kw, btype );
+				( simd->*vconv )( mapdst.line( cy ), ( const BUFTYPE** ) buf, vkern, kh, widthchannels );
+			}
+		}, 4 * kh );
 	}
 
 	/* general template use for convolution ( except the constant border case ) */
@@ -112,55 +94,30 @@ namespace cvt {
 		ssize_t h = src.height();
 		size_t widthchannels = w * src.channels();
 		size_t bstride = Math::pad16( sizeof( BUFTYPE ) * widthchannels ) / sizeof( BUFTYPE ); //FIXME: does this always work - it should
-		BUFTYPE** buf;
-		ssize_t cy;
 
 		IMapScoped<DSTTYPE> mapdst( dst );
 		IMapScoped<const SRCTYPE> mapsrc( src );
 
 		ssize_t b1 = ( kh >> 1 );
-		ssize_t b2 = kh - b1 - 1;
-
-		/* allocate buffers and fill buffer*/
-		ScopedBuffer<BUFTYPE,true> bufmem( bstride * kh );
-		ScopedBuffer<BUFTYPE*,true> bufptr( kh );
 
-		buf = bufptr.ptr();
-		buf[ 0 ] = bufmem.ptr();
-		for( ssize_t i = 1; i < kh; i++ )
-			buf[ i ] = buf[ i - 1 ] + bstride;
-
-
-		/* upper border */
-		for( cy = 0; cy < b1; cy++ ) {
-			for( ssize_t k = 0; k < kh; k++ ) {
-				ssize_t y = IBorder::value( cy - b1 + k, h, btype );
-				( simd->*conv )( buf[ k ], mapsrc.line( y ), w, kern + kw * k, kw, btype );
-			}
-			( simd->*avg )( mapdst.ptr(), ( const BUFTYPE** ) buf, kh, widthchannels );
-			mapdst++;
-		}
-
-		/* main part */
-		for( ; cy < h - b2; cy++ )
-		{
-			for( ssize_t k = 0; k < kh; k++ ) {
-				( simd->*conv )( buf[ k ], mapsrc.line( cy - b1 + k ), w, kern + kw * k, kw, btype );
+		/* every output line is independent, bands only need their own buffers */
+		parallelForRows( src, [&]( size_t ystart, size_t yend ) {
+			ScopedBuffer<BUFTYPE,true> bufmem( bstride * kh );
+			ScopedBuffer<BUFTYPE*,true> bufptr( kh );
+
+			BUFTYPE** buf = bufptr.ptr();
+			buf[ 0 ] = bufmem.ptr();
+			for( ssize_t i = 1; i < kh; i++ )
+				buf[ i ] = buf[ i - 1 ] + bstride;
+
+			for( ssize_t cy = ystart; cy < ( ssize_t ) yend; cy++ ) {
+				for( ssize_t k = 0; k < kh; k++ ) {
+					ssize_t y = IBorder::value<ssize_t>( cy - b1 + k, h, btype );
+					( simd->*conv )( buf[ k ], mapsrc.line( y ), w, kern + kw * k, kw, btype );
+				}
+				( simd->*avg )( mapdst.line( cy ), ( const BUFTYPE** ) buf, kh, widthchannels );
 			}
-			( simd->*avg )( mapdst.ptr(), ( const BUFTYPE** ) buf, kh, widthchannels );
-			mapdst++;
-		}
-
-		/* lower border */
-		for( ; cy < h; cy++ ) {
-			for( ssize_t k = 0; k < kh; k++ ) {
-				ssize_t y = IBorder::value( cy - b1 + k, h, btype );
-				( simd->*conv )( buf[ k ], mapsrc.line( y ), w, kern + kw * k, kw, btype );
-			}
-			( simd->*avg )( mapdst.ptr(), ( const BUFTYPE** ) buf, kh, widthchannels );
-			mapdst++;
-		}
-
+		} );
 	}
 
 	void IConvolve::convolve( Image& dst, const Image& src, const IKernel& kernel, IBorderType btype, const Color& )
@@ -0,0 +1,86 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_IPARALLEL_H
+#define CVT_IPARALLEL_H
+
+#include <cvt/gfx/Image.h>
+#include <cvt/util/ThreadPool.h>
+
+#include <atomic>
+
+namespace cvt {
+
+	/**
+	  @brief Row band parallelisation of image operations
+
+	  Images with at least pixelThreshold() pixels are split into horizontal bands
+	  which are processed by the ThreadPool. Smaller images are processed on the calling thread,
+	  where the synchronisation overhead would outweigh the gain.
+	 */
+	class IParallel {
+		public:
+			static size_t pixelThreshold();
+
+			/**
+			  @brief Set the minimal image size for the band split, safe to call while other threads process images
+			 */
+			static void	  setPixelThreshold( size_t pixels );
+
+			/**
+			  @brief Call func( ystart, yend ) for disjoint row bands covering [0, height)
+			  @param minRows minimal height of a band, operations with a vertical support of k rows should use a multiple of k
+			 */
+			template<typename FUNC>
+			static void forRows( size_t width, size_t height, FUNC func, size_t minRows = 8 );
+
+		private:
+			static std::atomic<size_t> _pixelThreshold;
+	};
+
+	template<typename FUNC>
+	inline void IParallel::forRows( size_t width, size_t height, FUNC func, size_t minRows )
+	{
+		if( !height )
+			return;
+
+		ThreadPool& pool = ThreadPool::instance();
+		if( width * height < _pixelThreshold.load( std::memory_order_relaxed ) || !pool.numThreads() || height < 2 * minRows ) {
+			func( ( size_t ) 0, height );
+			return;
+		}
+		pool.parallelFor( 0, height, minRows, func );
+	}
+
+	/**
+	  @brief Process the rows of img in parallel bands, func is called as func( ystart, yend )
+	 */
+	template<typename FUNC>
+	inline void parallelForRows( const Image& img, FUNC func, size_t minRows = 8 )
+	{
+		IParallel::forRows( img.width(), img.height(), func, minRows );
+	}
+}
+
+#endif
@@ -54,6 +54,9 @@ namespace cvt {
 			size_t getAdaptiveConvolutionWeights( size_t dst, size_t src, IConvolveAdaptivef& conva, bool nonegincr = true ) const;
 			size_t getAdaptiveConvolutionWeights( size_t dst, size_t src, IConvolveAdaptiveFixed& conva, bool nonegincr = true ) const;
 
+			float support() const { return _support; }
+			float sharpSmooth() const { return _sharpsmooth; }
+
 		protected:
 			float _support;
 			float _sharpsmooth;
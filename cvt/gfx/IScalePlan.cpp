@@ -0,0 +1,372 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/gfx/IScalePlan.h>
+#include <cvt/gfx/IParallel.h>
+#include <cvt/math/Math.h>
+#include <cvt/util/SIMD.h>
+#include <cvt/util/Exception.h>
+
+#include <stdlib.h>
+
+namespace cvt {
+
+	IScalePlan::IScalePlan() :
+		_swidth( 0 ),
+		_sheight( 0 ),
+		_dwidth( 0 ),
+		_dheight( 0 ),
+		_type( IFORMAT_TYPE_OTHER ),
+		_channels( 0 ),
+		_filterSupport( 0.0f ),
+		_filterSharpSmooth( 0.0f ),
+		_valid( false ),
+		_bufsize( 0 ),
+		_bufbytes( 0 )
+	{
+		_scalexf.size = _scaleyf.size = NULL;
+		_scalexf.weights = _scaleyf.weights = NULL;
+		_scalexfx.size = _scaleyfx.size = NULL;
+		_scalexfx.weights = _scaleyfx.weights = NULL;
+	}
+
+	IScalePlan::IScalePlan( const IScalePlan& ) :
+		_swidth( 0 ),
+		_sheight( 0 ),
+		_dwidth( 0 ),
+		_dheight( 0 ),
+		_type( IFORMAT_TYPE_OTHER ),
+		_channels( 0 ),
+		_filterSupport( 0.0f ),
+		_filterSharpSmooth( 0.0f ),
+		_valid( false ),
+		_bufsize( 0 ),
+		_bufbytes( 0 )
+	{
+		_scalexf.size = _scaleyf.size = NULL;
+		_scalexf.weights = _scaleyf.weights = NULL;
+		_scalexfx.size = _scaleyfx.size = NULL;
+		_scalexfx.weights = _scaleyfx.weights = NULL;
+	}
+
+	IScalePlan::~IScalePlan()
+	{
+		clear();
+	}
+
+	IScalePlan& IScalePlan::operator=( const IScalePlan& other )
+	{
+		if( this != &other )
+			clear();
+		return *this;
+	}
+
+	void IScalePlan::clear()
+	{
+		delete[] _scalexf.size;
+		delete[] _scalexf.weights;
+		delete[] _scaleyf.size;
+		delete[] _scaleyf.weights;
+		delete[] _scalexfx.size;
+		delete[] _scalexfx.weights;
+		delete[] _scaleyfx.size;
+		delete[] _scaleyfx.weights;
+		_scalexf.size = _scaleyf.size = NULL;
+		_scalexf.weights = _scaleyf.weights = NULL;
+		_scalexfx.size = _scaleyfx.size = NULL;
+		_scalexfx.weights = _scaleyfx.weights = NULL;
+
+		_srcstart.clear();
+		_woffset.clear();
+		clearBuffers();
+		_valid = false;
+	}
+
+	void IScalePlan::clearBuffers()
+	{
+		for( size_t i = 0; i < _buffers.size(); i++ )
+			free( _buffers[ i ] );
+		_buffers.clear();
+		_freebuffers.clear();
+		_bufbytes = 0;
+	}
+
+	bool IScalePlan::matches( const Image& src, size_t width, size_t height, const IScaleFilter& filter ) const
+	{
+		return _valid &&
+			   _swidth == src.width() && _sheight == src.height() &&
+			   _dwidth == width && _dheight == height &&
+			   _type == src.format().type && _channels == src.channels() &&
+			   _filterSupport == filter.support() && _filterSharpSmooth == filter.sharpSmooth() &&
+			   _filterName == filter.name();
+	}
+
+	void IScalePlan::update( const Image& src, size_t width, size_t height, const IScaleFilter& filter )
+	{
+		clear();
+
+		if( src.format().type == IFORMAT_TYPE_FLOAT ) {
+			_bufsize = filter.getAdaptiveConvolutionWeights( height, src.height(), _scaleyf, true );
+			filter.getAdaptiveConvolutionWeights( width, src.width(), _scalexf, false );
+		} else {
+			_bufsize = filter.getAdaptiveConvolutionWeights( height, src.height(), _scaleyfx, true );
+			filter.getAdaptiveConvolutionWeights( width, src.width(), _scalexfx, false );
+		}
+
+		/*
+		   Vertical ring buffer state at every output line: the first source line inside the
+		   filter window and the offset of the line's weights. Allows a band to start at any
+		   destination line.
+		 */
+		const IConvolveAdaptiveSize* sizes = src.format().type == IFORMAT_TYPE_FLOAT ? _scaleyf.size : _scaleyfx.size;
+		size_t sy = 0, off = 0;
+		_srcstart.resize( height );
+		_woffset.resize( height );
+		for( size_t y = 0; y < height; y++ ) {
+			sy += sizes[ y ].incr;
+			_srcstart[ y ] = sy;
+			_woffset[ y ] = off;
+			off += sizes[ y ].numw;
+		}
+
+		/* ring buffer rows plus one accumulation row for the fixed point path */
+		size_t nalign = Math::pad16( width * src.channels() );
+		_bufbytes = nalign * ( _bufsize + 1 ) * Math::max( sizeof( float ), sizeof( Fixed ) );
+
+		_swidth = src.width();
+		_sheight = src.height();
+		_dwidth = width;
+		_dheight = height;
+		_type = src.format().type;
+		_channels = src.channels();
+		_filterName = filter.name();
+		_filterSupport = filter.support();
+		_filterSharpSmooth = filter.sharpSmooth();
+		_valid = true;
+	}
+
+	uint8_t* IScalePlan::acquireBuffer()
+	{
+		uint8_t* buf = NULL;
+
+		_bufmutex.lock();
+		if( !_freebuffers.empty() ) {
+			buf = _freebuffers.back();
+			_freebuffers.pop_back();
+		}
+		_bufmutex.unlock();
+
+		if( buf )
+			return buf;
+
+		if( posix_memalign( ( void** ) &buf, 16, _bufbytes ) )
+			throw CVTException( "Out of memory" );
+
+		_bufmutex.lock();
+		_buffers.push_back( buf );
+		_bufmutex.unlock();
+		return buf;
+	}
+
+	void IScalePlan::releaseBuffer( uint8_t* buf )
+	{
+		_bufmutex.lock();
+		_freebuffers.push_back( buf );
+		_bufmutex.unlock();
+	}
+
+	void IScalePlan::apply( Image& dst, const Image& src, size_t width, size_t height, const IScaleFilter& filter )
+	{
+		if( src.format().type != IFORMAT_TYPE_FLOAT && src.format().type != IFORMAT_TYPE_UINT8 )
+			throw CVTException( "Unimplemented" );
+
+		if( !matches( src, width, height, filter ) )
+			update( src, width, height, filter );
+
+		dst.reallocate( width, height, src.format() );
+
+		if( _type == IFORMAT_TYPE_FLOAT )
+			scaleFloat( dst, src );
+		else
+			scaleU8( dst, src );
+	}
+
+	void IScalePlan::scaleFloat( Image& idst, const Image& isrc )
+	{
+		void (SIMD::*scalex_func)( float* _dst, float const* _src, const size_t width, IConvolveAdaptivef* conva ) const;
+		SIMD* simd = SIMD::instance();
+		size_t sstride, dstride;
+
+		if( _channels == 1 ) {
+			scalex_func = &SIMD::ConvolveAdaptiveClamp1f;
+		} else if( _channels == 2 ) {
+			scalex_func = &SIMD::ConvolveAdaptiveClamp2f;
+		} else {
+			scalex_func = &SIMD::ConvolveAdaptiveClamp4f;
+		}
+
+		const uint8_t* src = isrc.map( &sstride );
+		uint8_t* dst = idst.map( &dstride );
+
+		const size_t width = _dwidth;
+		const size_t sheight = _sheight;
+		const size_t bufsize = _bufsize;
+		const size_t n = width * _channels;
+		const size_t nalign = Math::pad16( n );
+
+		IParallel::forRows( width, _dheight, [&]( size_t ystart, size_t yend ) {
+			float* bufmem = ( float* ) acquireBuffer();
+			IConvolveAdaptivef hscaler = _scalexf;
+			size_t i, l;
+			ssize_t k;
+
+			/* fill buffer with the window of the first line of the band */
+			size_t sy = _srcstart[ ystart ];
+			for( i = 0; i < bufsize; i++ ) {
+				if( sy < sheight ) {
+					( simd->*scalex_func )( bufmem + i * nalign, ( const float* ) ( src + sy * sstride ), width, &hscaler );
+					sy++;
+				}
+			}
+			size_t curbuf = 0;
+
+			const IConvolveAdaptiveSize* pysw = _scaleyf.size + ystart;
+			const float* pyw = _scaleyf.weights + _woffset[ ystart ];
+
+			for( size_t y = ystart; y < yend; y++ ) {
+				float* pdst = ( float* ) ( dst + y * dstride );
+
+				if( y != ystart && pysw->incr ) {
+					for( k = 0; k < pysw->incr && sy < sheight; k++ ) {
+						( simd->*scalex_func )( bufmem + ( ( curbuf + k ) % bufsize ) * nalign, ( const float* ) ( src + sy * sstride ), width, &hscaler );
+						sy++;
+					}
+					curbuf = ( curbuf + pysw->incr ) % bufsize;
+				}
+
+				l = 0;
+				while( Math::abs( *pyw ) < Math::EPSILONF ) {
+					l++;
+					pyw++;
+				}
+				simd->MulValue1f( pdst, bufmem + ( ( curbuf + l ) % bufsize ) * nalign, *pyw++, n );
+				l++;
+				for( ; l < pysw->numw; l++ ) {
+					if( Math::abs( *pyw ) > Math::EPSILONF )
+						simd->MulAddValue1f( pdst, bufmem + ( ( curbuf + l ) % bufsize ) * nalign, *pyw, n );
+					pyw++;
+				}
+				pysw++;
+			}
+
+			releaseBuffer( ( uint8_t* ) bufmem );
+		}, 2 * bufsize );
+
+		idst.unmap( dst );
+		isrc.unmap( src );
+	}
+
+	void IScalePlan::scaleU8( Image& idst, const Image& isrc )
+	{
+		void (SIMD::*scalex_func)( Fixed* _dst, uint8_t const* _src, const size_t width, IConvolveAdaptiveFixed* conva ) const;
+		SIMD* simd = SIMD::instance();
+		size_t sstride, dstride;
+
+		if( _channels == 1 ) {
+			scalex_func = &SIMD::ConvolveAdaptive1Fixed;
+		} else if( _channels == 2 ) {
+			scalex_func = &SIMD::ConvolveAdaptive2Fixed;
+		} else {
+			scalex_func = &SIMD::ConvolveAdaptive4Fixed;
+		}
+
+		const uint8_t* src = isrc.map( &sstride );
+		uint8_t* dst = idst.map( &dstride );
+
+		const size_t width = _dwidth;
+		const size_t sheight = _sheight;
+		const size_t bufsize = _bufsize;
+		const size_t n = width * _channels;
+		const size_t nalign = Math::pad16( n );
+
+		IParallel::forRows( width, _dheight, [&]( size_t ystart, size_t yend ) {
+			Fixed* bufmem = ( Fixed* ) acquireBuffer();
+			Fixed* accumBuf = bufmem + nalign * bufsize;
+			IConvolveAdaptiveFixed hscaler = _scalexfx;
+			size_t i, l;
+			ssize_t k;
+
+			// fill buffer with the window of the first line of the band
+			size_t sy = _srcstart[ ystart ];
+			for( i = 0; i < bufsize; i++ ) {
+				if( sy < sheight ) {
+					( simd->*scalex_func )( bufmem + i * nalign, src + sy * sstride, width, &hscaler );
+					sy++;
+				}
+			}
+			size_t curbuf = 0;
+
+			const IConvolveAdaptiveSize* pysw = _scaleyfx.size + ystart;
+			const Fixed* pyw = _scaleyfx.weights + _woffset[ ystart ];
+
+			for( size_t y = ystart; y < yend; y++ ) {
+				uint8_t* pdst = dst + y * dstride;
+
+				if( y != ystart && pysw->incr ) {
+					for( k = 0; k < pysw->incr && sy < sheight; k++ ) {
+						( simd->*scalex_func )( bufmem + ( ( curbuf + k ) % bufsize ) * nalign, src + sy * sstride, width, &hscaler );
+						sy++;
+					}
+					curbuf = ( curbuf + pysw->incr ) % bufsize;
+				}
+
+				l = 0;
+				while( *pyw == ( Fixed )0.0f ) {
+					l++;
+					pyw++;
+				}
+				simd->MulValue1fx( accumBuf, bufmem + ( ( curbuf + l ) % bufsize ) * nalign, *pyw++, n );
+				l++;
+				for( ; l < pysw->numw; l++ ) {
+					if( *pyw != ( Fixed )0.0f )
+						simd->MulAddValue1fx( accumBuf, bufmem + ( ( curbuf + l ) % bufsize ) * nalign, *pyw, n );
+					pyw++;
+				}
+
+				for( size_t w = 0;  w < n; w++ ){
+					pdst[ w ] = Math::clamp( accumBuf[ w ].round(), 0, 255 );
+				}
+
+				pysw++;
+			}
+
+			releaseBuffer( ( uint8_t* ) bufmem );
+		}, 2 * bufsize );
+
+		idst.unmap( dst );
+		isrc.unmap( src );
+	}
+
+}
@@ -0,0 +1,104 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_ISCALEPLAN_H
+#define CVT_ISCALEPLAN_H
+
+#include <cvt/gfx/Image.h>
+#include <cvt/gfx/IScaleFilter.h>
+#include <cvt/util/Mutex.h>
+
+#include <string>
+#include <vector>
+
+namespace cvt {
+
+	/**
+	  @brief Reusable state for scaling images of a fixed geometry
+
+	  Keeps the adaptive convolution weights and the row buffers of the band parallel scaler
+	  for one combination of source size, destination size, format and filter. Repeated calls
+	  with the same parameters neither recompute weights nor allocate memory, any change
+	  rebuilds the plan on the next call.
+	  A plan must not be applied from several threads at the same time, copies do not share
+	  the cached state.
+	 */
+	class IScalePlan {
+		public:
+			IScalePlan();
+			IScalePlan( const IScalePlan& other );
+			~IScalePlan();
+
+			IScalePlan& operator=( const IScalePlan& other );
+
+			/**
+			  @brief Scale src to width x height using filter and store the result in dst
+			  Supports the float and uint8 formats with 1, 2 or 4 channels.
+			 */
+			void apply( Image& dst, const Image& src, size_t width, size_t height, const IScaleFilter& filter );
+
+			/**
+			  @brief Release the cached weights and buffers
+			 */
+			void clear();
+
+		private:
+			bool matches( const Image& src, size_t width, size_t height, const IScaleFilter& filter ) const;
+			void update( const Image& src, size_t width, size_t height, const IScaleFilter& filter );
+			void clearBuffers();
+
+			uint8_t* acquireBuffer();
+			void	 releaseBuffer( uint8_t* buf );
+
+			void scaleFloat( Image& dst, const Image& src );
+			void scaleU8( Image& dst, const Image& src );
+
+			size_t					_swidth, _sheight;
+			size_t					_dwidth, _dheight;
+			IFormatType				_type;
+			size_t					_channels;
+			std::string				_filterName;
+			float					_filterSupport;
+			float					_filterSharpSmooth;
+			bool					_valid;
+
+			IConvolveAdaptivef		_scalexf, _scaleyf;
+			IConvolveAdaptiveFixed	_scalexfx, _scaleyfx;
+
+			/* number of buffered rows, first source row and weight offset of every destination row */
+			size_t					_bufsize;
+			std::vector<size_t>		_srcstart;
+			std::vector<size_t>		_woffset;
+
+			/* size of a row buffer block in bytes and the allocated/unused blocks */
+			size_t					_bufbytes;
+			Mutex					_bufmutex;
+			std::vector<uint8_t*>	_buffers;
+			std::vector<uint8_t*>	_freebuffers;
+	};
+
+}
+
+#endif
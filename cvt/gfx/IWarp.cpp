@@ -24,6 +24,7 @@
 */
 
 #include <cvt/gfx/IWarp.h>
+#include <cvt/gfx/IParallel.h>
 #include <cvt/math/Vector.h>
 
 namespace cvt {
@@ -270,12 +271,10 @@ namespace cvt {
         const uint8_t* src;
         uint8_t* dst;
         const uint8_t* wrp;
-        uint8_t* pdst;
-        const uint8_t* pwrp;
-        size_t sstride, dstride, wstride, w, h, sw, sh;
+        size_t sstride, dstride, wstride, w, sw, sh;
 
-        pdst = dst = idst.map( &dstride );
-        pwrp = wrp = iwarp.map( &wstride );
+        dst = idst.map( &dstride );
+        wrp = iwarp.map( &wstride );
         src = isrc.map( &sstride );
 
         SIMD* simd = SIMD::instance();
@@ -283,12 +282,10 @@ namespace cvt {
         sw = isrc.width();
         sh = isrc.height();
         w = iwarp.width();
-        h = iwarp.height();
-        while( h-- ) {
-            simd->warpBilinear1f( ( float* ) pdst, ( const float* ) pwrp, ( const float* ) src, sstride, sw, sh, 0.0f, w );
-            pdst += dstride;
-            pwrp += wstride;
-        }
+        parallelForRows( iwarp, [&]( size_t ystart, size_t yend ) {
+            for( size_t y = ystart; y < yend; y++ )
+                simd->warpBilinear1f( ( float* ) ( dst + y * dstride ), ( const float* ) ( wrp + y * wstride ), ( const float* ) src, sstride, sw, sh, 0.0f, w );
+        } );
 
         idst.unmap( dst );
         isrc.unmap( src );
@@ -300,13 +297,11 @@ namespace cvt {
         const uint8_t* src;
         uint8_t* dst;
         const uint8_t* wrp;
-        uint8_t* pdst;
-        const uint8_t* pwrp;
-        size_t sstride, dstride, wstride, w, h, sw, sh;
+        size_t sstride, dstride, wstride, w, sw, sh;
         float black[ ] = { 0.0f, 0.0f, 0.0f, 1.0f };
 
-        pdst = dst = idst.map( &dstride );
-        pwrp = wrp = iwarp.map( &wstride );
+        dst = idst.map( &dstride );
+        wrp = iwarp.map( &wstride );
         src = isrc.map( &sstride );
 
         SIMD* simd = SIMD::instance();
@@ -314,12 +309,10 @@ namespace cvt {
         sw = isrc.width();
         sh = isrc.height();
         w = iwarp.width();
-        h = iwarp.height();
-        while( h-- ) {
-            simd->warpBilinear4f( ( float* ) pdst, ( const float* ) pwrp, ( const float* ) src, sstride, sw, sh, black, w );
-            pdst += dstride;
-            pwrp += wstride;
-        }
+        parallelForRows( iwarp, [&]( size_t ystart, size_t yend ) {
+            for( size_t y = ystart; y < yend; y++ )
+                simd->warpBilinear4f( ( float* ) ( dst + y * dstride ), ( const float* ) ( wrp + y * wstride ), ( const float* ) src, sstride, sw, sh, black, w );
+        } );
 
         idst.unmap( dst );
         isrc.unmap( src );
@@ -331,12 +324,10 @@ namespace cvt {
         const uint8_t* src;
         uint8_t* dst;
         const uint8_t* wrp;
-        uint8_t* pdst;
-        const uint8_t* pwrp;
-        size_t sstride, dstride, wstride, w, h, sw, sh;
+        size_t sstride, dstride, wstride, w, sw, sh;
 
-        pdst = dst = idst.map( &dstride );
-        pwrp = wrp = iwarp.map( &wstride );
+        dst = idst.map( &dstride );
+        wrp = iwarp.map( &wstride );
         src = isrc.map( &sstride );
 
         SIMD* simd = SIMD::instance();
@@ -344,12 +335,10 @@ namespace cvt {
         sw = isrc.width();
         sh = isrc.height();
         w = iwarp.width();
-        h = iwarp.height();
-        while( h-- ) {
-            simd->warpBilinear1u8( pdst, ( const float* ) pwrp, src, sstride, sw, sh, 0, w );
-            pdst += dstride;
-            pwrp += wstride;
-        }
+        parallelForRows( iwarp, [&]( size_t ystart, size_t yend ) {
+            for( size_t y = ystart; y < yend; y++ )
+                simd->warpBilinear1u8( dst + y * dstride, ( const float* ) ( wrp + y * wstride ), src, sstride, sw, sh, 0, w );
+        } );
 
         idst.unmap( dst );
         isrc.unmap( src );
@@ -361,13 +350,11 @@ namespace cvt {
         const uint8_t* src;
         uint8_t* dst;
         const uint8_t* wrp;
-        uint8_t* pdst;
-        const uint8_t* pwrp;
-        size_t sstride, dstride, wstride, w, h, sw, sh;
+        size_t sstride, dstride, wstride, w, sw, sh;
         uint32_t black = 0xff000000;
 
-        pdst = dst = idst.map( &dstride );
-        pwrp = wrp = iwarp.map( &wstride );
+        dst = idst.map( &dstride );
+        wrp = iwarp.map( &wstride );
         src = isrc.map( &sstride );
 
         SIMD* simd = SIMD::instance();
@@ -375,12 +362,10 @@ namespace cvt {
         sw = isrc.width();
         sh = isrc.height();
         w = iwarp.width();
-        h = iwarp.height();
-        while( h-- ) {
-            simd->warpBilinear4u8( pdst, ( const float* ) pwrp, src, sstride, sw, sh, black, w );
-            pdst += dstride;
-            pwrp += wstride;
-        }
+        parallelForRows( iwarp, [&]( size_t ystart, size_t yend ) {
+            for( size_t y = ystart; y < yend; y++ )
+                simd->warpBilinear4u8( dst + y * dstride, ( const float* ) ( wrp + y * wstride ), src, sstride, sw, sh, black, w );
+        } );
 
         idst.unmap( dst );
         isrc.unmap( src );
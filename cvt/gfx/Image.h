@@ -89,6 +89,8 @@ namespace cvt {
 
 			void reallocate( size_t w, size_t h, const IFormat & format = IFormat::RGBA_UINT8, IAllocatorType memtype = IALLOCATOR_MEM );
 			void reallocate( const Image& i, IAllocatorType memtype = IALLOCATOR_MEM );
+			/* exchange the image memory without copying */
+			void swap( Image& other );
 
 			void copyRect( int x, int y, const Image& i, const Recti & roi );
 
@@ -172,15 +174,10 @@ namespace cvt {
             GFXEngine* gfxEngine();
 
 		private:
-			void scaleFloat( Image& idst, size_t width, size_t height, const IScaleFilter& filter ) const;
-			void scaleU8( Image& idst, size_t width, size_t height, const IScaleFilter& filter ) const;
-
 			void checkFormat( const Image & img, const char* func, size_t lineNum, const IFormat & format ) const;
 			void checkSize( const Image & img, const char* func, size_t lineNum, size_t w, size_t h ) const;
 			void checkFormatAndSize( const Image & img, const char* func, size_t lineNum ) const;
 
-			void pyrdown1U8( Image& dst ) const;
-
 			ImageAllocator* _mem;
 	};
 
@@ -191,6 +188,13 @@ namespace cvt {
 		return new Image( *this );
 	}
 
+	inline void Image::swap( Image& other )
+	{
+		ImageAllocator* tmp = _mem;
+		_mem = other._mem;
+		other._mem = tmp;
+	}
+
 	const inline IFormat & Image::format() const
 	{
 		return _mem->_format;
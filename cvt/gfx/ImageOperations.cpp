@@ -28,8 +28,11 @@
 #include <cvt/util/Exception.h>
 #include <cvt/util/ScopedBuffer.h>
 #include <cvt/gfx/IMapScoped.h>
+#include <cvt/gfx/IParallel.h>
+#include <cvt/gfx/IScalePlan.h>
 
 #include <iomanip>
+#include <vector>
 
 namespace cvt {
 
@@ -42,11 +45,10 @@ namespace cvt {
 					size_t stride;
 					uint8_t* dst = map( &stride );
 					uint8_t* dbase = dst;
-					size_t h = _mem->_height;
-					while( h-- ) {
-						simd->AddValue1f( ( float* ) dst, ( float* ) dst, alpha, _mem->_width * _mem->_format.channels );
-						dst += stride;
-					}
+					parallelForRows( *this, [&]( size_t ystart, size_t yend ) {
+						for( size_t y = ystart; y < yend; y++ )
+							simd->AddValue1f( ( float* ) ( dst + y * stride ), ( float* ) ( dst + y * stride ), alpha, _mem->_width * _mem->_format.channels );
+					} );
 					unmap( dbase );
 				}
 				break;
@@ -66,12 +68,10 @@ namespace cvt {
 					size_t stride;
 					uint8_t* dst = map( & stride );
 					uint8_t* dbase = dst;
-					size_t h = _mem->_height;
-
-					while( h-- ) {
-						simd->AddValue1f( ( float* ) dst, ( float* ) dst, c.gray(), _mem->_width );
-						dst += stride;
-					}
+					parallelForRows( *this, [&]( size_t ystart, size_t yend ) {
+						for( size_t y = ystart; y < yend; y++ )
+							simd->AddValue1f( ( float* ) ( dst + y * stride ), ( float* ) ( dst + y * stride ), c.gray(), _mem->_width );
+					} );
 					unmap( dbase );
 				}
 				break;
@@ -81,12 +81,10 @@ namespace cvt {
 					size_t stride;
 					uint8_t* dst = map( &stride );
 					uint8_t* dbase = dst;
-					size_t h = _mem->_height;
-
-					while( h-- ) {
-						simd->AddValue4f( ( float* ) dst, ( float* ) dst, v, _mem->_width * _mem->_format.channels );
-						dst += stride;
-					}
+					parallelForRows( *this, [&]( size_t ystart, size_t yend ) {
+						for( size_t y = ystart; y < yend; y++ )
+							simd->AddValue4f( ( float* ) ( dst + y * stride ), ( float* ) ( dst + y * stride ), v, _mem->_width * _mem->_format.channels );
+					} );
 					unmap( dbase );
 				}
 				break;
@@ -96,12 +94,10 @@ namespace cvt {
 					size_t stride;
 					uint8_t* dst = map( &stride );
 					uint8_t* dbase = dst;
-					size_t h = _mem->_height;
-
-					while( h-- ) {
-						simd->AddValue4f( ( float* ) dst, ( float* ) dst, v, _mem->_width * _mem->_format.channels );
-						dst += stride;
-					}
+					parallelForRows( *this, [&]( size_t ystart, size_t yend ) {
+						for( size_t y = ystart; y < yend; y++ )
+							simd->AddValue4f( ( float* ) ( dst + y * stride ), ( float* ) ( dst + y * stride ), v, _mem->_width * _mem->_format.channels );
+					} );
 					unmap( dbase );
 				}
 				break;
@@ -120,11 +116,10 @@ namespace cvt {
 					size_t stride;
 					uint8_t* dst = map( &stride );
 					uint8_t* dbase = dst;
-					size_t h = _mem->_height;
-					while( h-- ) {
-						simd->SubValue1f( ( float* ) dst, ( float* ) dst, alpha, _mem->_width * _mem->_format.channels );
-						dst += stride;
-					}
+					parallelForRows( *this, [&]( size_t ystart, size_t yend ) {
+						for( size_t y = ystart; y < yend; y++ )
+							simd->SubValue1f( ( float* ) ( dst + y * stride ), ( float* ) ( dst + y * stride ), alpha, _mem->_width * _mem->_format.channels );
+					} );
 					unmap( dbase );
 				}
 				break;
@@ -143,12 +138,10 @@ namespace cvt {
 					size_t stride;
 					uint8_t* dst = map( &stride );
 					uint8_t* dbase = dst;
-					size_t h = _mem->_height;
-
-					while( h-- ) {
-						simd->SubValue1f( ( float* ) dst, ( float* ) dst, c.gray(), _mem->_width );
-						dst += stride;
-					}
+					parallelForRows( *this, [&]( size_t ystart, size_t yend ) {
+						for( size_t y = ystart; y < yend; y++ )
+							simd->SubValue1f( ( float* ) ( dst + y * stride ), ( float* ) ( dst + y * stride ), c.gray(), _mem->_width );
+					} );
 					unmap( dbase );
 				}
 				break;
@@ -158,12 +151,10 @@ namespace cvt {
 					size_t stride;
 					uint8_t* dst = map( &stride );
 					uint8_t* dbase = dst;
-					size_t h = _mem->_height;
-
-					while( h-- ) {
-						simd->SubValue4f( ( float* ) dst, ( float* ) dst, v, _mem->_width * _mem->_format.channels );
-						dst += stride;
-					}
+					parallelForRows( *this, [&]( size_t ystart, size_t yend ) {
+						for( size_t y = ystart; y < yend; y++ )
+							simd->SubValue4f( ( float* ) ( dst + y * stride ), ( float* ) ( dst + y * stride ), v, _mem->_width * _mem->_format.channels );
+					} );
 					unmap( dbase );
 				}
 				break;
@@ -173,12 +164,10 @@ namespace cvt {
 					size_t stride;
 					uint8_t* dst = map( &stride );
 					uint8_t* dbase = dst;
-					size_t h = _mem->_height;
-
-					while( h-- ) {
-						simd->SubValue4f( ( float* ) dst, ( float* ) dst, v, _mem->_width * _mem->_format.channels );
-						dst += stride;
-					}
+					parallelForRows( *this, [&]( size_t ystart, size_t yend ) {
+						for( size_t y = ystart; y < yend; y++ )
+							simd->SubValue4f( ( float* ) ( dst + y * stride ), ( float* ) ( dst + y * stride ), v, _mem->_width * _mem->_format.channels );
+					} );
 					unmap( dbase );
 				}
 				break;
@@ -200,12 +189,10 @@ namespace cvt {
 					size_t stride;
 					uint8_t* dst = map( &stride );
 					uint8_t* dbase = dst;
-					size_t h = _mem->_height;
-
-					while( h-- ) {
-						simd->MulValue1f( ( float* ) dst, ( float* ) dst, alpha, _mem->_width * _mem->_format.channels );
-						dst += stride;
-					}
+					parallelForRows( *this, [&]( size_t ystart, size_t yend ) {
+						for( size_t y = ystart; y < yend; y++ )
+							simd->MulValue1f( ( float* ) ( dst + y * stride ), ( float* ) ( dst + y * stride ), alpha, _mem->_width * _mem->_format.channels );
+					} );
 					unmap( dbase );
 				}
 				break;
@@ -214,12 +201,10 @@ namespace cvt {
 					size_t stride;
 					uint16_t* dst = map<uint16_t>( &stride );
 					uint16_t* dbase = dst;
-					size_t h = _mem->_height;
-
-					while( h-- ) {
-						simd->MulValue1ui16( dst, dst, alpha, _mem->_width * _mem->_format.channels );
-						dst += stride;
-					}
+					parallelForRows( *this, [&]( size_t ystart, size_t yend ) {
+						for( size_t y = ystart; y < yend; y++ )
+							simd->MulValue1ui16( dst + y * stride, dst + y * stride, alpha, _mem->_width * _mem->_format.channels );
+					} );
 					unmap( dbase );
 				}
 				break;
@@ -238,12 +223,10 @@ namespace cvt {
 					size_t stride;
 					uint8_t* dst = map( &stride );
 					uint8_t* dbase = dst;
-					size_t h = _mem->_height;
-
-					while( h-- ) {
-						simd->MulValue1f( ( float* ) dst, ( float* ) dst, c.gray(), _mem->_width );
-						dst += stride;
-					}
+					parallelForRows( *this, [&]( size_t ystart, size_t yend ) {
+						for( size_t y = ystart; y < yend; y++ )
+							simd->MulValue1f( ( float* ) ( dst + y * stride ), ( float* ) ( dst + y * stride ), c.gray(), _mem->_width );
+					} );
 					unmap( dbase );
 				}
 				break;
@@ -253,12 +236,10 @@ namespace cvt {
 					size_t stride;
 					uint8_t* dst = map( &stride );
 					uint8_t* dbase = dst;
-					size_t h = _mem->_height;
-
-					while( h-- ) {
-						simd->MulValue4f( ( float* ) dst, ( float* ) dst, v, _mem->_width * _mem->_format.channels );
-						dst += stride;
-					}
+					parallelForRows( *this, [&]( size_t ystart, size_t yend ) {
+						for( size_t y = ystart; y < yend; y++ )
+							simd->MulValue4f( ( float* ) ( dst + y * stride ), ( float* ) ( dst + y * stride ), v, _mem->_width * _mem->_format.channels );
+					} );
 					unmap( dbase );
 				}
 				break;
@@ -268,12 +249,10 @@ namespace cvt {
 					size_t stride;
 					uint8_t* dst = map( &stride );
 					uint8_t* dbase = dst;
-					size_t h = _mem->_height;
-
-					while( h-- ) {
-						simd->MulValue4f( ( float* ) dst, ( float* ) dst, v, _mem->_width * _mem->_format.channels );
-						dst += stride;
-					}
+					parallelForRows( *this, [&]( size_t ystart, size_t yend ) {
+						for( size_t y = ystart; y < yend; y++ )
+							simd->MulValue4f( ( float* ) ( dst + y * stride ), ( float* ) ( dst + y * stride ), v, _mem->_width * _mem->_format.channels );
+					} );
 					unmap( dbase );
 				}
 				break;
@@ -300,12 +279,10 @@ namespace cvt {
 					uint8_t* dst = map( &dstride );
 					uint8_t* dbase = dst;
 
-					size_t h = _mem->_height;
-					while( h-- ) {
-						simd->Add( ( float* ) dst, ( float* ) dst, ( float* ) src, _mem->_width * _mem->_format.channels );
-						src += sstride;
-						dst += dstride;
-					}
+					parallelForRows( *this, [&]( size_t ystart, size_t yend ) {
+						for( size_t y = ystart; y < yend; y++ )
+							simd->Add( ( float* ) ( dst + y * dstride ), ( float* ) ( dst + y * dstride ), ( const float* ) ( src + y * sstride ), _mem->_width * _mem->_format.channels );
+					} );
 					unmap( dbase );
 					i.unmap( sbase );
 				}
@@ -333,12 +310,10 @@ namespace cvt {
 					uint8_t* dst = map( &dstride );
 					uint8_t* dbase = dst;
 
-					size_t h = _mem->_height;
-					while( h-- ) {
-						simd->Sub( ( float* ) dst, ( float* ) dst, ( float* ) src, _mem->_width * _mem->_format.channels );
-						src += sstride;
-						dst += dstride;
-					}
+					parallelForRows( *this, [&]( size_t ystart, size_t yend ) {
+						for( size_t y = ystart; y < yend; y++ )
+							simd->Sub( ( float* ) ( dst + y * dstride ), ( float* ) ( dst + y * dstride ), ( const float* ) ( src + y * sstride ), _mem->_width * _mem->_format.channels );
+					} );
 					unmap( dbase );
 					i.unmap( sbase );
 				}
@@ -366,12 +341,10 @@ namespace cvt {
 					uint8_t* dst = map( &dstride );
 					uint8_t* dbase = dst;
 
-					size_t h = _mem->_height;
-					while( h-- ) {
-						simd->Mul(( float* ) dst, ( float* ) dst, ( float* ) src, _mem->_width * _mem->_format.channels );
-						src += sstride;
-						dst += dstride;
-					}
+					parallelForRows( *this, [&]( size_t ystart, size_t yend ) {
+						for( size_t y = ystart; y < yend; y++ )
+							simd->Mul( ( float* ) ( dst + y * dstride ), ( float* ) ( dst + y * dstride ), ( const float* ) ( src + y * sstride ), _mem->_width * _mem->_format.channels );
+					} );
 					unmap( dbase);
 					i.unmap( sbase );
 				}
@@ -396,12 +369,11 @@ namespace cvt {
 					IMapScoped<const float> srcmap( i );
 					IMapScoped<float> dstmap( *this );
 
-					size_t h = height();
-					while( h-- ) {
-						simd->MulAddValue1f( dstmap.ptr(), srcmap.ptr(), alpha, width() * _mem->_format.channels );
-						srcmap++;
-						dstmap++;
-					}
+					size_t n = width() * _mem->_format.channels;
+					parallelForRows( *this, [&]( size_t ystart, size_t yend ) {
+						for( size_t y = ystart; y < yend; y++ )
+							simd->MulAddValue1f( dstmap.line( y ), srcmap.line( y ), alpha, n );
+					} );
 				}
 				break;
 			default:
@@ -523,211 +495,13 @@ namespace cvt {
 
 	void Image::scale( Image& idst, size_t width, size_t height, const IScaleFilter& filter ) const
 	{
-		switch ( _mem->_format.type ) {
-			case IFORMAT_TYPE_FLOAT:
-				scaleFloat( idst, width, height, filter );
-				break;
-			case IFORMAT_TYPE_UINT8:
-				scaleU8( idst, width, height, filter );
-				break;
-			default:
-				throw CVTException("Unimplemented");
-				break;
-		}
-	}
-
-	void Image::scaleFloat( Image& idst, size_t width, size_t height, const IScaleFilter& filter ) const
-	{
-		IConvolveAdaptivef scalerx;
-		IConvolveAdaptivef scalery;
-		IConvolveAdaptiveSize* pysw;
-		float* pyw;
-		const uint8_t* src;
-		const uint8_t* osrc;
-		const uint8_t* send;
-		uint8_t* dst;
-		uint8_t* odst;
-		size_t sstride, dstride;
-		size_t i, l;
-		int32_t k;
-		float** buf;
-		size_t bufsize;
-		size_t curbuf;
-		void (SIMD::*scalex_func)( float* _dst, float const* _src, const size_t width, IConvolveAdaptivef* conva ) const;
-		SIMD* simd = SIMD::instance();
-
-
-		if( _mem->_format.channels == 1 ) {
-			scalex_func = &SIMD::ConvolveAdaptiveClamp1f;
-		} else if( _mem->_format.channels == 2 ) {
-			scalex_func = &SIMD::ConvolveAdaptiveClamp2f;
-		} else {
-			scalex_func = &SIMD::ConvolveAdaptiveClamp4f;
-		}
-
-		//checkFormat( idst, __PRETTY_FUNCTION__, __LINE__, _mem->_format );
-		//checkSize( idst, __PRETTY_FUNCTION__, __LINE__, width, height );
-		idst.reallocate( width, height, this->format() );
-
-		osrc = src = map( &sstride );
-		odst = dst = idst.map( &dstride );
-		send = src + sstride * _mem->_height;
-
-		bufsize = filter.getAdaptiveConvolutionWeights( height, _mem->_height, scalery, true );
-		filter.getAdaptiveConvolutionWeights( width, _mem->_width, scalerx, false );
-
-		buf = new float*[ bufsize ];
-		/* allocate and fill buffer */
-		for( i = 0; i < bufsize; i++ ) {
-			if( posix_memalign( ( void** ) &buf[ i ], 16, sizeof( float ) * width * _mem->_format.channels) )
-				throw CVTException("Out of memory");
-			( simd->*scalex_func )( ( float* ) buf[ i ], ( float* ) src, width, &scalerx );
-			src += sstride;
-		}
-		curbuf = 0;
-
-		pysw = scalery.size;
-		pyw = scalery.weights;
-
-		while( height-- ) {
-			if( pysw->incr ) {
-				for( k = 0; k < pysw->incr && src < send ; k++ ) {
-					( simd->*scalex_func )( ( float* ) buf[ ( curbuf + k ) % bufsize ], ( float* ) src, width, &scalerx );
-					src += sstride;
-				}
-				curbuf = ( curbuf + pysw->incr ) % bufsize;
-			}
-
-			l = 0;
-			while( Math::abs( *pyw ) < Math::EPSILONF ) {
-				l++;
-				pyw++;
-			}
-			simd->MulValue1f( ( float* ) dst, buf[ ( curbuf + l ) % bufsize ], *pyw++, width * _mem->_format.channels );
-			l++;
-			for( ; l < pysw->numw; l++ ) {
-				if( Math::abs( *pyw ) > Math::EPSILONF )
-					simd->MulAddValue1f( ( float* ) dst, buf[ ( curbuf + l ) % bufsize ], *pyw, width * _mem->_format.channels );
-				pyw++;
-			}
-			pysw++;
-			dst += dstride;
-		}
-
-		idst.unmap( odst );
-		unmap( osrc );
-
-		for( i = 0; i < bufsize; i++ )
-			free( buf[ i ] );
-		delete[] buf;
-		delete[] scalerx.size;
-		delete[] scalerx.weights;
-		delete[] scalery.size;
-		delete[] scalery.weights;
-	}
-
-	void Image::scaleU8( Image& idst, size_t width, size_t height, const IScaleFilter& filter ) const
-	{
-		IConvolveAdaptiveFixed scalerx;
-		IConvolveAdaptiveFixed scalery;
-
-		IConvolveAdaptiveSize* pysw;
-		Fixed* pyw;
-
-		const uint8_t* src;
-		const uint8_t* osrc;
-		const uint8_t* send;
-		uint8_t* dst;
-		uint8_t* odst;
-		size_t sstride, dstride;
-		size_t i, l;
-		int32_t k;
-		Fixed** buf;
-		Fixed* accumBuf;
-		size_t bufsize;
-		size_t curbuf;
-		void (SIMD::*scalex_func)( Fixed* _dst, uint8_t const* _src, const size_t width, IConvolveAdaptiveFixed* conva ) const;
-		SIMD* simd = SIMD::instance();
-
-		if( _mem->_format.channels == 1 ) {
-			scalex_func = &SIMD::ConvolveAdaptive1Fixed;
-		} else if( _mem->_format.channels == 2 ) {
-			scalex_func = &SIMD::ConvolveAdaptive2Fixed;
-		} else {
-			scalex_func = &SIMD::ConvolveAdaptive4Fixed;
-		}
-
-		idst.reallocate( width, height, this->format() );
-
-		osrc = src = map( &sstride );
-		odst = dst = idst.map( &dstride );
-		send = src + sstride * _mem->_height;
-
-		bufsize = filter.getAdaptiveConvolutionWeights( height, _mem->_height, scalery, true );
-		filter.getAdaptiveConvolutionWeights( width, _mem->_width, scalerx, false );
-
-		buf = new Fixed*[ bufsize ];
-		// allocate and fill buffer
-		for( i = 0; i < bufsize; i++ ) {
-			if( posix_memalign( ( void** ) &buf[ i ], 16, sizeof( Fixed ) * width * _mem->_format.channels) )
-				throw CVTException("Out of memory");
-			( simd->*scalex_func )( buf[ i ], src, width, &scalerx );
-			src += sstride;
-		}
-		curbuf = 0;
-
-		pysw = scalery.size;
-		pyw = scalery.weights;
-
-		if( posix_memalign( ( void** ) &accumBuf, 16, sizeof( Fixed ) * width * _mem->_format.channels ) )
-			throw CVTException("Out of memory");
-
-		while( height-- ) {
-			if( pysw->incr ) {
-				for( k = 0; k < pysw->incr && src < send ; k++ ) {
-					( simd->*scalex_func )( buf[ ( curbuf + k ) % bufsize ], src, width, &scalerx );
-					src += sstride;
-				}
-				curbuf = ( curbuf + pysw->incr ) % bufsize;
-			}
-
-			l = 0;
-			while( *pyw == ( Fixed )0.0f ) {
-				l++;
-				pyw++;
-			}
-			simd->MulValue1fx( accumBuf, buf[ ( curbuf + l ) % bufsize ], *pyw++, width * _mem->_format.channels );
-			l++;
-			for( ; l < pysw->numw; l++ ) {
-				if( *pyw != ( Fixed )0.0f )
-					simd->MulAddValue1fx( accumBuf, buf[ ( curbuf + l ) % bufsize ], *pyw, width * _mem->_format.channels );
-				pyw++;
-			}
-
-			for( size_t w = 0;  w < width * _mem->_format.channels; w++ ){
-				dst[ w ] = Math::clamp( accumBuf[ w ].round(), 0, 255 );
-			}
-
-			pysw++;
-			dst += dstride;
-		}
-
-		idst.unmap( odst );
-		unmap( osrc );
-
-		free( accumBuf );
-		for( i = 0; i < bufsize; i++ )
-			free( buf[ i ] );
-		delete[] buf;
-		delete[] scalerx.size;
-		delete[] scalerx.weights;
-		delete[] scalery.size;
-		delete[] scalery.weights;
+		IScalePlan plan;
+		plan.apply( idst, *this, width, height, filter );
 	}
 
 	void Image::warpBilinear( Image& idst, const Image& warp ) const
 	{
-		size_t m, n, k, K;
+		size_t K;
 		size_t sstride, dstride, wstride;
 
 		if( _mem->_format.type == IFORMAT_TYPE_FLOAT &&
@@ -738,9 +512,6 @@ namespace cvt {
 			uint8_t* odst;
 			const uint8_t* wrp;
 			const uint8_t* owrp;
-			float* pdst;
-			const float* pwrp;
-			float data[ 4 ];
 
 			checkFormatAndSize( idst, __PRETTY_FUNCTION__, __LINE__ );
 
@@ -749,33 +520,34 @@ namespace cvt {
 			owrp = wrp = warp.map( &wstride );
 			K = channels();
 
-			for( n = 0; n < warp._mem->_height; n++ ) {
-				pdst = ( float* ) dst;
-				pwrp = ( float* ) wrp;
-				for( m = 0; m < warp._mem->_width; m++ ) {
-					float x, y, alpha, beta;
-					size_t ix[ 2 ], iy[ 2 ];
-					x = *pwrp++;
-					y = *pwrp++;
-					alpha = x - Math::floor( x );
-					beta  = y - Math::floor( y );
-					ix[ 0 ] = ( size_t ) Math::clamp( ( float ) m + x, 0.0f, ( float ) ( _mem->_width - 1 ) );
-					iy[ 0 ] = ( size_t ) Math::clamp( ( float ) n + y, 0.0f, ( float ) ( _mem->_height - 1 ) );
-					ix[ 1 ] = Math::min( ix[ 0 ] + 1, _mem->_width - 1 );
-					iy[ 1 ] = Math::min( iy[ 0 ] + 1, _mem->_height - 1 );
-					for( k = 0; k < K; k++ ) {
-						data[ 0 ] = *( ( float* ) ( src + sstride * iy[ 0 ] + ( ix[ 0 ] * K + k ) * sizeof( float ) ) );
-						data[ 1 ] = *( ( float* ) ( src + sstride * iy[ 0 ] + ( ix[ 1 ] * K + k ) * sizeof( float ) ) );
-						data[ 2 ] = *( ( float* ) ( src + sstride * iy[ 1 ] + ( ix[ 0 ] * K + k ) * sizeof( float ) ) );
-						data[ 3 ] = *( ( float* ) ( src + sstride * iy[ 1 ] + ( ix[ 1 ] * K + k ) * sizeof( float ) ) );
-						data[ 0 ] = Math::mix( data[ 0 ], data[ 1 ], alpha );
-						data[ 2 ] = Math::mix( data[ 2 ], data[ 3 ], alpha );
-						*pdst++ = Math::mix( data[ 0 ], data[ 2 ], beta );
+			parallelForRows( warp, [&]( size_t ystart, size_t yend ) {
+				for( size_t n = ystart; n < yend; n++ ) {
+					float* pdst = ( float* ) ( dst + n * dstride );
+					const float* pwrp = ( const float* ) ( wrp + n * wstride );
+					float data[ 4 ];
+					for( size_t m = 0; m < warp._mem->_width; m++ ) {
+						float x, y, alpha, beta;
+						size_t ix[ 2 ], iy[ 2 ];
+						x = *pwrp++;
+						y = *pwrp++;
+						alpha = x - Math::floor( x );
+						beta  = y - Math::floor( y );
+						ix[ 0 ] = ( size_t ) Math::clamp( ( float ) m + x, 0.0f, ( float ) ( _mem->_width - 1 ) );
+						iy[ 0 ] = ( size_t ) Math::clamp( ( float ) n + y, 0.0f, ( float ) ( _mem->_height - 1 ) );
+						ix[ 1 ] = Math::min( ix[ 0 ] + 1, _mem->_width - 1 );
+						iy[ 1 ] = Math::min( iy[ 0 ] + 1, _mem->_height - 1 );
+						for( size_t k = 0; k < K; k++ ) {
+							data[ 0 ] = *( ( float* ) ( src + sstride * iy[ 0 ] + ( ix[ 0 ] * K + k ) * sizeof( float ) ) );
+							data[ 1 ] = *( ( float* ) ( src + sstride * iy[ 0 ] + ( ix[ 1 ] * K + k ) * sizeof( float ) ) );
+							data[ 2 ] = *( ( float* ) ( src + sstride * iy[ 1 ] + ( ix[ 0 ] * K + k ) * sizeof( float ) ) );
+							data[ 3 ] = *( ( float* ) ( src + sstride * iy[ 1 ] + ( ix[ 1 ] * K + k ) * sizeof( float ) ) );
+							data[ 0 ] = Math::mix( data[ 0 ], data[ 1 ], alpha );
+							data[ 2 ] = Math::mix( data[ 2 ], data[ 3 ], alpha );
+							*pdst++ = Math::mix( data[ 0 ], data[ 2 ], beta );
+						}
 					}
 				}
-				dst += dstride;
-				wrp += wstride;
-			}
+			} );
 			warp.unmap( owrp );
 			idst.unmap( odst );
 			unmap( osrc );
@@ -865,94 +637,85 @@ namespace cvt {
     }
 
 
-	void Image::pyrdown( Image& dst ) const
+	/*
+	   Band parallel [ 1 4 6 4 1 ] pyramid downsampling. Output row y filters the horizontally
+	   downsampled source rows 2y-1 ... 2y+3, clamped to the image. Source row r is kept in the
+	   ring slot r % 5, so every band can start at an arbitrary output row.
+	 */
+	template<typename TSRC, typename TBUF, typename TDST>
+	static void pyrdownRows( Image& out, const Image& in,
+							 void ( SIMD::*hfunc )( TBUF*, const TSRC*, size_t ) const,
+							 void ( SIMD::*vfunc )( TDST*, TBUF**, size_t ) const )
 	{
-		dst.reallocate( width() / 2, height() / 2, format(), _mem->type() );
+		size_t sstride, dstride;
+		const uint8_t* src = in.map( &sstride );
+		uint8_t* dst = out.map( &dstride );
+		const size_t swidth = in.width();
+		const ssize_t sheight = in.height();
+		const size_t n = out.width() * out.channels();
+		const size_t bstride = Math::pad16( n );
+		SIMD* simd = SIMD::instance();
+
+		IParallel::forRows( out.width(), out.height(), [&]( size_t ystart, size_t yend ) {
+			ScopedBuffer<TBUF, true> scopebuf( bstride * 5 );
+			TBUF* buf = scopebuf.ptr();
+			ssize_t slotrow[ 5 ] = { -1, -1, -1, -1, -1 };
+			TBUF* rows[ 5 ];
+
+			for( size_t y = ystart; y < yend; y++ ) {
+				for( size_t k = 0; k < 5; k++ ) {
+					ssize_t r = Math::clamp<ssize_t>( 2 * ( ssize_t ) y - 1 + ( ssize_t ) k, 0, sheight - 1 );
+					size_t slot = r % 5;
+					if( slotrow[ slot ] != r ) {
+						( simd->*hfunc )( buf + slot * bstride, ( const TSRC* ) ( src + r * sstride ), swidth );
+						slotrow[ slot ] = r;
+					}
+					rows[ k ] = buf + slot * bstride;
+				}
+				( simd->*vfunc )( ( TDST* ) ( dst + y * dstride ), rows, n );
+			}
+		}, 4 );
 
+		in.unmap( src );
+		out.unmap( dst );
+	}
+
+	void Image::pyrdown( Image& dst ) const
+	{
 		IFormatID fId = this->format().formatID;
 		switch( fId ) {
-			case IFORMAT_GRAY_UINT8: return pyrdown1U8( dst );
+			case IFORMAT_GRAY_UINT8:
+			case IFORMAT_RGBA_UINT8:
+			case IFORMAT_BGRA_UINT8:
+			case IFORMAT_GRAY_FLOAT:
+			case IFORMAT_RGBA_FLOAT:
+			case IFORMAT_BGRA_FLOAT:
+				break;
 			default:
 				String msg;
 				msg.sprintf( "Pyrdown not implemented for type: %s", fId );
 				throw CVTException( msg.c_str() );
 		}
-	}
-
-	void Image::pyrdown1U8( Image& out ) const
-	{
-		size_t bstride = Math::pad16( out.width() );
-		uint16_t* buf;
-		size_t sstride, dstride;
-		const uint8_t* src = map( &sstride );
-		uint8_t* dst = out.map( &dstride );
-		const uint8_t* psrc = src;
-		uint8_t* pdst = dst;
-		uint16_t* rows[ 5 ];
 
-		SIMD* simd = SIMD::instance();
+		dst.reallocate( width() / 2, height() / 2, format(), _mem->type() );
 
-		ScopedBuffer<uint16_t, true> scopebuf( bstride * 5 );
-		buf = scopebuf.ptr();
-//		if( posix_memalign( ( void** ) &buf, 16, sizeof( uint16_t ) * bstride * 5 ) )
-//			throw CVTException("Out of memory");
-
-		simd->pyrdownHalfHorizontal_1u8_to_1u16( buf, psrc, width() );
-		psrc += sstride;
-		simd->pyrdownHalfHorizontal_1u8_to_1u16( buf + bstride, psrc, width() );
-		psrc += sstride;
-		simd->pyrdownHalfHorizontal_1u8_to_1u16( buf + 2 * bstride, psrc, width() );
-		psrc += sstride;
-		simd->pyrdownHalfHorizontal_1u8_to_1u16( buf + 3 * bstride, psrc, width() );
-		psrc += sstride;
-
-		rows[ 0 ] = buf;
-		rows[ 1 ] = buf;
-		rows[ 2 ] = buf + bstride;
-		rows[ 3 ] = buf + 2 * bstride;
-		rows[ 4 ] = buf + 3 * bstride;
-
-		simd->pyrdownHalfVertical_1u16_to_1u8( pdst, rows, out.width() );
-		pdst += dstride;
-
-		rows[ 0 ] = buf + 4 * bstride;
-		size_t h = out.height() - 2;
-		while( h-- ) {
-			uint16_t* tmp1 = rows[ 0 ];
-			simd->pyrdownHalfHorizontal_1u8_to_1u16( tmp1, psrc, width() );
-			psrc += sstride;
-			uint16_t* tmp2 = rows[ 1 ];
-			simd->pyrdownHalfHorizontal_1u8_to_1u16( tmp2, psrc, width() );
-			psrc += sstride;
-
-			rows[ 0 ] = rows[ 2 ];
-			rows[ 1 ] = rows[ 3 ];
-			rows[ 2 ] = rows[ 4 ];
-			rows[ 3 ] = tmp1;
-			rows[ 4 ] = tmp2;
-
-			simd->pyrdownHalfVertical_1u16_to_1u8( pdst, rows, out.width() );
-			pdst += dstride;
+		switch( fId ) {
+			case IFORMAT_GRAY_UINT8:
+				pyrdownRows<uint8_t, uint16_t, uint8_t>( dst, *this, &SIMD::pyrdownHalfHorizontal_1u8_to_1u16, &SIMD::pyrdownHalfVertical_1u16_to_1u8 );
+				break;
+			case IFORMAT_RGBA_UINT8:
+			case IFORMAT_BGRA_UINT8:
+				pyrdownRows<uint8_t, uint16_t, uint8_t>( dst, *this, &SIMD::pyrdownHalfHorizontal_4u8_to_4u16, &SIMD::pyrdownHalfVertical_1u16_to_1u8 );
+				break;
+			case IFORMAT_GRAY_FLOAT:
+				pyrdownRows<float, float, float>( dst, *this, &SIMD::pyrdownHalfHorizontal_1f, &SIMD::pyrdownHalfVertical_1f );
+				break;
+			default:
+				pyrdownRows<float, float, float>( dst, *this, &SIMD::pyrdownHalfHorizontal_4f, &SIMD::pyrdownHalfVertical_1f );
+				break;
 		}
-
-		uint16_t* tmp1 = rows[ 0 ];
-		if( height() & 1 )
-			simd->pyrdownHalfHorizontal_1u8_to_1u16( tmp1, psrc, width() );
-		else
-			tmp1 = rows[ 4 ];
-
-		rows[ 0 ] = rows[ 2 ];
-		rows[ 1 ] = rows[ 3 ];
-		rows[ 2 ] = rows[ 4 ];
-		rows[ 3 ] = tmp1;
-		rows[ 4 ] = tmp1;
-		simd->pyrdownHalfVertical_1u16_to_1u8( pdst, rows, out.width() );
-
-		unmap( src );
-		out.unmap( dst );
 	}
 
-
 	void Image::printValues( std::ostream& o, const Recti& _rect ) const
 	{
 		size_t w, h, stride;
@@ -30,6 +30,14 @@
 #include <cvt/cl/kernel/guidedfilter/guidedfilter_applyab_gc_outer.h>
 #include <cvt/cl/kernel/guidedfilter/guidedfilter_applyab_cc.h>
 
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/gfx/IParallel.h>
+#include <cvt/util/ThreadPool.h>
+#include <cvt/util/SIMD.h>
+#include <cvt/util/Exception.h>
+
+#include <stdlib.h>
+
 namespace cvt {
 	static ParamInfoTyped<Image*> pin( "Input", true );
 	static ParamInfoTyped<Image*> pinguide( "Guide", true );
@@ -47,18 +55,54 @@ namespace cvt {
 
 	GuidedFilter::GuidedFilter() :
 		IFilter( "GuidedFilter", _params, 5, IFILTER_CPU | IFILTER_OPENCL ),
-		_clguidedfilter_calcab( _guidedfilter_calcab_source, "guidedfilter_calcab" ),
-		_clguidedfilter_calcab_outerrgb( _guidedfilter_calcab_outerrgb_source, "guidedfilter_calcab_outerrgb" ),
-		_clguidedfilter_applyab_gc( _guidedfilter_applyab_gc_source, "guidedfilter_applyab_gc" ),
-		_clguidedfilter_applyab_gc_outer( _guidedfilter_applyab_gc_outer_source, "guidedfilter_applyab_gc_outer" ),
-		_clguidedfilter_applyab_cc( _guidedfilter_applyab_cc_source, "guidedfilter_applyab_cc" )
+		_clguidedfilter_calcab( 0 ),
+		_clguidedfilter_calcab_outerrgb( 0 ),
+		_clguidedfilter_applyab_gc( 0 ),
+		_clguidedfilter_applyab_gc_outer( 0 ),
+		_clguidedfilter_applyab_cc( 0 ),
+		_intfilter( 0 ),
+		_boxfilter( 0 ),
+		_cpumem( 0 ),
+		_cpusize( 0 )
+	{
+	}
+
+	GuidedFilter::~GuidedFilter()
+	{
+		delete _clguidedfilter_calcab;
+		delete _clguidedfilter_calcab_outerrgb;
+		delete _clguidedfilter_applyab_gc;
+		delete _clguidedfilter_applyab_gc_outer;
+		delete _clguidedfilter_applyab_cc;
+		delete _intfilter;
+		delete _boxfilter;
+		free( _cpumem );
+	}
+
+	void GuidedFilter::initCL() const
 	{
+		ScopeLock lock( &_clmutex );
+		if( _clguidedfilter_calcab )
+			return;
+		_clguidedfilter_calcab = new CLKernel( _guidedfilter_calcab_source, "guidedfilter_calcab" );
+		_clguidedfilter_calcab_outerrgb = new CLKernel( _guidedfilter_calcab_outerrgb_source, "guidedfilter_calcab_outerrgb" );
+		_clguidedfilter_applyab_gc = new CLKernel( _guidedfilter_applyab_gc_source, "guidedfilter_applyab_gc" );
+		_clguidedfilter_applyab_gc_outer = new CLKernel( _guidedfilter_applyab_gc_outer_source, "guidedfilter_applyab_gc_outer" );
+		_clguidedfilter_applyab_cc = new CLKernel( _guidedfilter_applyab_cc_source, "guidedfilter_applyab_cc" );
+		_intfilter = new IntegralFilter();
+		_boxfilter = new BoxFilter();
 	}
 
-	void GuidedFilter::apply( Image& dst, const Image& src, const Image& guide, const int radius, const float epsilon, bool rgbcovariance ) const
+	void GuidedFilter::apply( Image& dst, const Image& src, const Image& guide, const int radius, const float epsilon, bool rgbcovariance, IFilterType iftype ) const
 	{
 		// G guidance image, S source image
 
+		if( iftype == IFILTER_CPU ) {
+			applyCPU( dst, src, guide, radius, epsilon, rgbcovariance );
+			return;
+		}
+
+		initCL();
 		if( rgbcovariance ) {
 			applyGC_COV( dst, src, guide, radius, epsilon );
 		} else if( src.format().channels <= 2 ) {
@@ -78,38 +122,38 @@ namespace cvt {
 		Image imeanGS( src.width(), src.height(), IFormat::RGBA_FLOAT, IALLOCATOR_CL ); // FIXME: use only RGBA/GRAY/GRAYALPHA for SRC * GUIDE
 		Image imeanGG( src.width(), src.height(), IFormat::floatEquivalent( guide.format() ), IALLOCATOR_CL );
 
-		_intfilter.apply( iint, guide );
-		_boxfilter.apply( imeanG, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, src );
-		_boxfilter.apply( imeanS, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, guide, &src );
-		_boxfilter.apply( imeanGS, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, guide, &guide );
-		_boxfilter.apply( imeanGG, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, guide );
+		_boxfilter->apply( imeanG, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, src );
+		_boxfilter->apply( imeanS, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, guide, &src );
+		_boxfilter->apply( imeanGS, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, guide, &guide );
+		_boxfilter->apply( imeanGG, iint, radius, IFILTER_OPENCL );
 
 		CLNDRange global( Math::pad16( src.width() ), Math::pad16( src.height() ) );
 		CLNDRange local( 16, 16 );
 
-		_clguidedfilter_calcab.setArg( 0, ia );
-		_clguidedfilter_calcab.setArg( 1, ib );
-		_clguidedfilter_calcab.setArg( 2, imeanG );
-		_clguidedfilter_calcab.setArg( 3, imeanS );
-		_clguidedfilter_calcab.setArg( 4, imeanGS );
-		_clguidedfilter_calcab.setArg( 5, imeanGG );
-		_clguidedfilter_calcab.setArg( 6, epsilon );
-		_clguidedfilter_calcab.run( global, local);
+		_clguidedfilter_calcab->setArg( 0, ia );
+		_clguidedfilter_calcab->setArg( 1, ib );
+		_clguidedfilter_calcab->setArg( 2, imeanG );
+		_clguidedfilter_calcab->setArg( 3, imeanS );
+		_clguidedfilter_calcab->setArg( 4, imeanGS );
+		_clguidedfilter_calcab->setArg( 5, imeanGG );
+		_clguidedfilter_calcab->setArg( 6, epsilon );
+		_clguidedfilter_calcab->run( global, local);
 
-		_intfilter.apply( iint, ia );
-		_boxfilter.apply( ia, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, ib );
-		_boxfilter.apply( ib, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, ia );
+		_boxfilter->apply( ia, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, ib );
+		_boxfilter->apply( ib, iint, radius, IFILTER_OPENCL );
 
 		dst.reallocate( src.width(), src.height(), src.format(), IALLOCATOR_CL );
-		_clguidedfilter_applyab_gc.setArg( 0, dst );
-		_clguidedfilter_applyab_gc.setArg( 1, guide );
-		_clguidedfilter_applyab_gc.setArg( 2, ia );
-		_clguidedfilter_applyab_gc.setArg( 3, ib );
-		_clguidedfilter_applyab_gc.run( global, local );
+		_clguidedfilter_applyab_gc->setArg( 0, dst );
+		_clguidedfilter_applyab_gc->setArg( 1, guide );
+		_clguidedfilter_applyab_gc->setArg( 2, ia );
+		_clguidedfilter_applyab_gc->setArg( 3, ib );
+		_clguidedfilter_applyab_gc->run( global, local );
 	}
 
 	void GuidedFilter::applyGC_COV( Image& dst, const Image& src, const Image& guide, const int radius, const float epsilon ) const
@@ -125,41 +169,41 @@ namespace cvt {
 		Image imean_RR_RG_RB( src.width(), src.height(), IFormat::RGBA_FLOAT, IALLOCATOR_CL );
 		Image imean_GG_GB_BB( src.width(), src.height(), IFormat::RGBA_FLOAT, IALLOCATOR_CL );
 
-		_intfilter.apply( iint, guide );
-		_boxfilter.apply( imeanG, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, src );
-		_boxfilter.apply( imeanS, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, guide, &src );
-		_boxfilter.apply( imeanGS, iint, radius, IFILTER_OPENCL );
-		_intfilter.applyOuterRGB( iint, iint2, guide );
-		_boxfilter.apply( imean_RR_RG_RB, iint, radius, IFILTER_OPENCL );
-		_boxfilter.apply( imean_GG_GB_BB, iint2, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, guide );
+		_boxfilter->apply( imeanG, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, src );
+		_boxfilter->apply( imeanS, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, guide, &src );
+		_boxfilter->apply( imeanGS, iint, radius, IFILTER_OPENCL );
+		_intfilter->applyOuterRGB( iint, iint2, guide );
+		_boxfilter->apply( imean_RR_RG_RB, iint, radius, IFILTER_OPENCL );
+		_boxfilter->apply( imean_GG_GB_BB, iint2, radius, IFILTER_OPENCL );
 
 
 		CLNDRange global( Math::pad16( src.width() ), Math::pad16( src.height() ) );
 		CLNDRange local( 16, 16 );
 
-		_clguidedfilter_calcab_outerrgb.setArg( 0, ia );
-		_clguidedfilter_calcab_outerrgb.setArg( 1, ib );
-		_clguidedfilter_calcab_outerrgb.setArg( 2, imeanG );
-		_clguidedfilter_calcab_outerrgb.setArg( 3, imeanS );
-		_clguidedfilter_calcab_outerrgb.setArg( 4, imeanGS );
-		_clguidedfilter_calcab_outerrgb.setArg( 5, imean_RR_RG_RB );
-		_clguidedfilter_calcab_outerrgb.setArg( 6, imean_GG_GB_BB );
-		_clguidedfilter_calcab_outerrgb.setArg( 7, epsilon );
-		_clguidedfilter_calcab_outerrgb.run( global, local );
-
-		_intfilter.apply( iint, ia );
-		_boxfilter.apply( ia, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, ib );
-		_boxfilter.apply( ib, iint, radius, IFILTER_OPENCL );
+		_clguidedfilter_calcab_outerrgb->setArg( 0, ia );
+		_clguidedfilter_calcab_outerrgb->setArg( 1, ib );
+		_clguidedfilter_calcab_outerrgb->setArg( 2, imeanG );
+		_clguidedfilter_calcab_outerrgb->setArg( 3, imeanS );
+		_clguidedfilter_calcab_outerrgb->setArg( 4, imeanGS );
+		_clguidedfilter_calcab_outerrgb->setArg( 5, imean_RR_RG_RB );
+		_clguidedfilter_calcab_outerrgb->setArg( 6, imean_GG_GB_BB );
+		_clguidedfilter_calcab_outerrgb->setArg( 7, epsilon );
+		_clguidedfilter_calcab_outerrgb->run( global, local );
+
+		_intfilter->apply( iint, ia );
+		_boxfilter->apply( ia, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, ib );
+		_boxfilter->apply( ib, iint, radius, IFILTER_OPENCL );
 
 		dst.reallocate( src.width(), src.height(), src.format(), IALLOCATOR_CL );
-		_clguidedfilter_applyab_gc_outer.setArg( 0, dst );
-		_clguidedfilter_applyab_gc_outer.setArg( 1, guide );
-		_clguidedfilter_applyab_gc_outer.setArg( 2, ia );
-		_clguidedfilter_applyab_gc_outer.setArg( 3, ib );
-		_clguidedfilter_applyab_gc_outer.run( global, local );
+		_clguidedfilter_applyab_gc_outer->setArg( 0, dst );
+		_clguidedfilter_applyab_gc_outer->setArg( 1, guide );
+		_clguidedfilter_applyab_gc_outer->setArg( 2, ia );
+		_clguidedfilter_applyab_gc_outer->setArg( 3, ib );
+		_clguidedfilter_applyab_gc_outer->run( global, local );
 	}
 
 	void GuidedFilter::applyCC( Image& dst, const Image& src, const Image& guide, const int radius, const float epsilon ) const
@@ -173,38 +217,258 @@ namespace cvt {
 		Image imeanGS( src.width(), src.height(), IFormat::RGBA_FLOAT, IALLOCATOR_CL );
 		Image imeanGG( src.width(), src.height(), IFormat::RGBA_FLOAT, IALLOCATOR_CL );
 
-		_intfilter.apply( iint, guide );
-		_boxfilter.apply( imeanG, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, src );
-		_boxfilter.apply( imeanS, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, guide, &src );
-		_boxfilter.apply( imeanGS, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, guide, &guide );
-		_boxfilter.apply( imeanGG, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, guide );
+		_boxfilter->apply( imeanG, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, src );
+		_boxfilter->apply( imeanS, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, guide, &src );
+		_boxfilter->apply( imeanGS, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, guide, &guide );
+		_boxfilter->apply( imeanGG, iint, radius, IFILTER_OPENCL );
 
 		CLNDRange global( Math::pad16( src.width() ), Math::pad16( src.height() ) );
 		CLNDRange local( 16, 16 );
 
-		_clguidedfilter_calcab.setArg( 0, ia );
-		_clguidedfilter_calcab.setArg( 1, ib );
-		_clguidedfilter_calcab.setArg( 2, imeanG );
-		_clguidedfilter_calcab.setArg( 3, imeanS );
-		_clguidedfilter_calcab.setArg( 4, imeanGS );
-		_clguidedfilter_calcab.setArg( 5, imeanGG );
-		_clguidedfilter_calcab.setArg( 6, epsilon );
-		_clguidedfilter_calcab.run( global, local );
+		_clguidedfilter_calcab->setArg( 0, ia );
+		_clguidedfilter_calcab->setArg( 1, ib );
+		_clguidedfilter_calcab->setArg( 2, imeanG );
+		_clguidedfilter_calcab->setArg( 3, imeanS );
+		_clguidedfilter_calcab->setArg( 4, imeanGS );
+		_clguidedfilter_calcab->setArg( 5, imeanGG );
+		_clguidedfilter_calcab->setArg( 6, epsilon );
+		_clguidedfilter_calcab->run( global, local );
 
-		_intfilter.apply( iint, ia );
-		_boxfilter.apply( ia, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, ib );
-		_boxfilter.apply( ib, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, ia );
+		_boxfilter->apply( ia, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, ib );
+		_boxfilter->apply( ib, iint, radius, IFILTER_OPENCL );
 
 		dst.reallocate( src.width(), src.height(), src.format(), IALLOCATOR_CL );
-		_clguidedfilter_applyab_cc.setArg( 0, dst );
-		_clguidedfilter_applyab_cc.setArg( 1, guide );
-		_clguidedfilter_applyab_cc.setArg( 2, ia );
-		_clguidedfilter_applyab_cc.setArg( 3, ib );
-		_clguidedfilter_applyab_cc.run( global, local );
+		_clguidedfilter_applyab_cc->setArg( 0, dst );
+		_clguidedfilter_applyab_cc->setArg( 1, guide );
+		_clguidedfilter_applyab_cc->setArg( 2, ia );
+		_clguidedfilter_applyab_cc->setArg( 3, ib );
+		_clguidedfilter_applyab_cc->run( global, local );
+	}
+
+
+	float* GuidedFilter::cpuWorkspace( size_t nplanes, size_t planesize ) const
+	{
+		size_t size = nplanes * planesize;
+		if( size > _cpusize ) {
+			free( _cpumem );
+			_cpumem = 0;
+			_cpusize = 0;
+			if( posix_memalign( ( void** ) &_cpumem, 16, sizeof( float ) * size ) )
+				throw CVTException( "GuidedFilter: workspace allocation failed" );
+			_cpusize = size;
+		}
+		return _cpumem;
+	}
+
+	/* replace each of the n consecutive planes by its box mean, every plane in flight uses its own scratch plane for the integral image */
+	static void _boxMeans( float* planes, size_t n, float* scratch, size_t nscratch, size_t planesize, size_t stride, size_t width, size_t height, int radius )
+	{
+		SIMD* simd = SIMD::instance();
+		const size_t box = 2 * radius + 1;
+
+		for( size_t g = 0; g < n; g += nscratch ) {
+			ThreadPool::instance().parallelFor( g, Math::min( g + nscratch, n ), 1, [&]( size_t pstart, size_t pend ) {
+				for( size_t p = pstart; p < pend; p++ ) {
+					float* plane = planes + p * planesize;
+					float* integral = scratch + ( p - g ) * planesize;
+					simd->prefixSum1_f_to_f( integral, stride, plane, stride, width, height );
+					simd->boxFilterPrefixSum1_f_to_f( plane, stride * sizeof( float ), integral, stride * sizeof( float ), width, height, box, box );
+				}
+			} );
+		}
+	}
+
+	void GuidedFilter::applyCPU( Image& dst, const Image& src, const Image& guide, int radius, const float epsilon, bool rgbcovariance ) const
+	{
+		if( src.width() != guide.width() || src.height() != guide.height() )
+			throw CVTException( "GuidedFilter: source and guide size differ" );
+
+		const size_t width = src.width();
+		const size_t height = src.height();
+		// the prefix sum box filter needs the box to fit into the image
+		radius = Math::clamp<int>( radius, 0, ( ( int ) Math::min( width, height ) - 1 ) / 2 );
+
+		ScopeLock lock( &_cpumutex );
+
+		const Image* simg = &src;
+		if( src.format().type != IFORMAT_TYPE_FLOAT ) {
+			src.convert( _cpusrc, IFormat::floatEquivalent( src.format() ) );
+			simg = &_cpusrc;
+		}
+		const size_t cs = simg->format().channels;
+		// the alpha channel of GRAYALPHA/RGBA/BGRA is copied and not filtered
+		const size_t nf = ( cs == 2 || cs == 4 ) ? cs - 1 : cs;
+
+		/* colour guide: either the full RGB covariance or channel-wise for colour sources,
+		   every other combination uses the gray guide for all source channels */
+		const Image* gimg = &guide;
+		bool colour = guide.format().channels >= 3;
+		const bool cov = colour && rgbcovariance;
+		if( colour && !cov && nf != 3 ) {
+			guide.convert( _cpuguide, IFormat::GRAY_FLOAT );
+			gimg = &_cpuguide;
+			colour = false;
+		} else if( guide.format().type != IFORMAT_TYPE_FLOAT ) {
+			guide.convert( _cpuguide, IFormat::floatEquivalent( guide.format() ) );
+			gimg = &_cpuguide;
+		}
+		const size_t cg = gimg->format().channels;
+
+		// planes: mean G, mean GG ( RR RG RB GG GB BB with covariance ), mean S, mean GS, integral scratch
+		const size_t ng = colour ? 3 : 1;
+		const size_t ngg = cov ? 6 : ng;
+		const size_t ngs = cov ? 3 : 1;
+		const size_t nplanes = ng + ngg + 1 + ngs;
+		const size_t nscratch = Math::min( ThreadPool::instance().numThreads() + 1, Math::max( ng + ngg, 1 + ngs ) );
+		const size_t stride = ( width + 3 ) & ~( ( size_t ) 3 );
+		const size_t planesize = stride * height;
+
+		float* mem = cpuWorkspace( nplanes + nscratch, planesize );
+		float* meanG = mem;
+		float* meanGG = meanG + ng * planesize;
+		float* meanS = meanGG + ngg * planesize;
+		float* meanGS = meanS + planesize;
+		float* scratch = meanGS + ngs * planesize;
+
+		// the channels are written one after another, filtering in place needs a separate output
+		const bool inplace = ( &dst == simg || &dst == gimg );
+		Image& out = inplace ? _cpudst : dst;
+		out.reallocate( width, height, IFormat::floatEquivalent( src.format() ) );
+
+		{
+			IMapScoped<const float> maps( *simg );
+			IMapScoped<const float> mapg( *gimg );
+			IMapScoped<float> mapd( out );
+
+			parallelForRows( out, [&]( size_t ystart, size_t yend ) {
+				for( size_t y = ystart; y < yend; y++ ) {
+					const float* gp = mapg.line( y );
+					size_t off = y * stride;
+					for( size_t x = 0; x < width; x++, off++, gp += cg ) {
+						if( cov ) {
+							meanG[ off ] = gp[ 0 ];
+							meanG[ off + planesize ] = gp[ 1 ];
+							meanG[ off + 2 * planesize ] = gp[ 2 ];
+							meanGG[ off ] = gp[ 0 ] * gp[ 0 ];
+							meanGG[ off + planesize ] = gp[ 0 ] * gp[ 1 ];
+							meanGG[ off + 2 * planesize ] = gp[ 0 ] * gp[ 2 ];
+							meanGG[ off + 3 * planesize ] = gp[ 1 ] * gp[ 1 ];
+							meanGG[ off + 4 * planesize ] = gp[ 1 ] * gp[ 2 ];
+							meanGG[ off + 5 * planesize ] = gp[ 2 ] * gp[ 2 ];
+						} else {
+							for( size_t j = 0; j < ng; j++ ) {
+								meanG[ off + j * planesize ] = gp[ j ];
+								meanGG[ off + j * planesize ] = gp[ j ] * gp[ j ];
+							}
+						}
+					}
+				}
+			} );
+			_boxMeans( meanG, ng + ngg, scratch, nscratch, planesize, stride, width, height, radius );
+
+			for( size_t k = 0; k < nf; k++ ) {
+				// guide channel for the gray/channel-wise case
+				const size_t gk = ( ng == 3 ) ? k : 0;
+
+				parallelForRows( out, [&]( size_t ystart, size_t yend ) {
+					for( size_t y = ystart; y < yend; y++ ) {
+						const float* sp = maps.line( y ) + k;
+						const float* gp = mapg.line( y );
+						size_t off = y * stride;
+						for( size_t x = 0; x < width; x++, off++, sp += cs, gp += cg ) {
+							meanS[ off ] = *sp;
+							if( cov ) {
+								meanGS[ off ] = gp[ 0 ] * *sp;
+								meanGS[ off + planesize ] = gp[ 1 ] * *sp;
+								meanGS[ off + 2 * planesize ] = gp[ 2 ] * *sp;
+							} else
+								meanGS[ off ] = gp[ gk ] * *sp;
+						}
+					}
+				} );
+				_boxMeans( meanS, 1 + ngs, scratch, nscratch, planesize, stride, width, height, radius );
+
+				// a replaces mean GS, b replaces mean S
+				parallelForRows( out, [&]( size_t ystart, size_t yend ) {
+					for( size_t y = ystart; y < yend; y++ ) {
+						size_t off = y * stride;
+						for( size_t x = 0; x < width; x++, off++ ) {
+							if( cov ) {
+								const float m0 = meanG[ off ];
+								const float m1 = meanG[ off + planesize ];
+								const float m2 = meanG[ off + 2 * planesize ];
+								const float ms = meanS[ off ];
+								const float v0 = meanGS[ off ] - m0 * ms;
+								const float v1 = meanGS[ off + planesize ] - m1 * ms;
+								const float v2 = meanGS[ off + 2 * planesize ] - m2 * ms;
+
+								const float s00 = meanGG[ off ] - m0 * m0 + epsilon;
+								const float s01 = meanGG[ off + planesize ] - m0 * m1;
+								const float s02 = meanGG[ off + 2 * planesize ] - m0 * m2;
+								const float s11 = meanGG[ off + 3 * planesize ] - m1 * m1 + epsilon;
+								const float s12 = meanGG[ off + 4 * planesize ] - m1 * m2;
+								const float s22 = meanGG[ off + 5 * planesize ] - m2 * m2 + epsilon;
+
+								// symmetric adjugate
+								const float i00 = s11 * s22 - s12 * s12;
+								const float i01 = s02 * s12 - s01 * s22;
+								const float i02 = s01 * s12 - s02 * s11;
+								const float i11 = s00 * s22 - s02 * s02;
+								const float i12 = s01 * s02 - s00 * s12;
+								const float i22 = s00 * s11 - s01 * s01;
+								const float det = s00 * i00 + s01 * i01 + s02 * i02;
+
+								float a0 = 0.0f, a1 = 0.0f, a2 = 0.0f;
+								if( det > 0.0f ) {
+									const float idet = 1.0f / det;
+									a0 = ( i00 * v0 + i01 * v1 + i02 * v2 ) * idet;
+									a1 = ( i01 * v0 + i11 * v1 + i12 * v2 ) * idet;
+									a2 = ( i02 * v0 + i12 * v1 + i22 * v2 ) * idet;
+								}
+								meanGS[ off ] = a0;
+								meanGS[ off + planesize ] = a1;
+								meanGS[ off + 2 * planesize ] = a2;
+								meanS[ off ] = ms - ( a0 * m0 + a1 * m1 + a2 * m2 );
+							} else {
+								const float mg = meanG[ off + gk * planesize ];
+								const float ms = meanS[ off ];
+								const float var = meanGG[ off + gk * planesize ] - mg * mg;
+								const float a = ( meanGS[ off ] - mg * ms ) / ( var + epsilon );
+								meanGS[ off ] = a;
+								meanS[ off ] = ms - a * mg;
+							}
+						}
+					}
+				} );
+				_boxMeans( meanS, 1 + ngs, scratch, nscratch, planesize, stride, width, height, radius );
+
+				parallelForRows( out, [&]( size_t ystart, size_t yend ) {
+					for( size_t y = ystart; y < yend; y++ ) {
+						const float* sp = maps.line( y );
+						const float* gp = mapg.line( y );
+						float* dp = mapd.line( y );
+						size_t off = y * stride;
+						for( size_t x = 0; x < width; x++, off++, sp += cs, gp += cg, dp += cs ) {
+							if( cov )
+								dp[ k ] = meanGS[ off ] * gp[ 0 ] + meanGS[ off + planesize ] * gp[ 1 ] + meanGS[ off + 2 * planesize ] * gp[ 2 ] + meanS[ off ];
+							else
+								dp[ k ] = meanGS[ off ] * gp[ gk ] + meanS[ off ];
+							if( k == 0 && nf < cs )
+								dp[ cs - 1 ] = sp[ cs - 1 ];
+						}
+					}
+				} );
+			}
+		}
+
+		if( inplace )
+			dst.swap( _cpudst );
 	}
 
 
@@ -221,6 +485,9 @@ namespace cvt {
 			case IFILTER_OPENCL:
 				this->apply( *out, *in, guide?*guide:*in, radius, epsilon );
 				break;
+			case IFILTER_CPU:
+				this->apply( *out, *in, guide?*guide:*in, radius, epsilon, false, IFILTER_CPU );
+				break;
 			default:
 				throw CVTException( "Not implemented" );
 		}
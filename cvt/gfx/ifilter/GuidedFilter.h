@@ -29,6 +29,7 @@
 #include <cvt/util/Plugin.h>
 #include <cvt/util/PluginManager.h>
 #include <cvt/cl/CLKernel.h>
+#include <cvt/util/Mutex.h>
 
 #include <cvt/gfx/ifilter/IntegralFilter.h>
 #include <cvt/gfx/ifilter/BoxFilter.h>
@@ -37,9 +38,14 @@ namespace cvt {
 	class GuidedFilter : public IFilter {
 		public:
 			GuidedFilter();
-			~GuidedFilter() {};
+			~GuidedFilter();
 
-			void apply( Image& dst, const Image& src, const Image& guide, const int radius, const float epsilon, bool rgbcovariance = false ) const;
+			/**
+			  Guided filter of src with respect to guide.
+			  With IFILTER_CPU the result is float, colour/alpha channels of src are filtered/copied.
+			  The CPU workspace is kept between calls and only grows if the image size increases.
+			 */
+			void apply( Image& dst, const Image& src, const Image& guide, const int radius, const float epsilon, bool rgbcovariance = false, IFilterType iftype = IFILTER_OPENCL ) const;
 
 			void apply( const ParamSet* attribs, IFilterType iftype ) const;
 
@@ -47,16 +53,29 @@ namespace cvt {
 			void applyGC( Image& dst, const Image& src, const Image& guide, const int radius, const float epsilon ) const;
 			void applyGC_COV( Image& dst, const Image& src, const Image& guide, const int radius, const float epsilon ) const;
 			void applyCC( Image& dst, const Image& src, const Image& guide, const int radius, const float epsilon ) const;
+			void applyCPU( Image& dst, const Image& src, const Image& guide, int radius, const float epsilon, bool rgbcovariance ) const;
+
+			void initCL() const;
+			float* cpuWorkspace( size_t nplanes, size_t planesize ) const;
 
 			GuidedFilter( const GuidedFilter& t );
 
-			CLKernel	   _clguidedfilter_calcab;
-			CLKernel	   _clguidedfilter_calcab_outerrgb;
-			CLKernel	   _clguidedfilter_applyab_gc;
-			CLKernel	   _clguidedfilter_applyab_gc_outer;
-			CLKernel	   _clguidedfilter_applyab_cc;
-			IntegralFilter _intfilter;
-			BoxFilter	   _boxfilter;
+			/* the OpenCL objects are created on first use under _clmutex, the CPU path does not need a CL context */
+			mutable Mutex			_clmutex;
+			mutable CLKernel*	    _clguidedfilter_calcab;
+			mutable CLKernel*	    _clguidedfilter_calcab_outerrgb;
+			mutable CLKernel*	    _clguidedfilter_applyab_gc;
+			mutable CLKernel*	    _clguidedfilter_applyab_gc_outer;
+			mutable CLKernel*	    _clguidedfilter_applyab_cc;
+			mutable IntegralFilter* _intfilter;
+			mutable BoxFilter*	    _boxfilter;
+
+			mutable Mutex			_cpumutex;
+			mutable float*			_cpumem;
+			mutable size_t			_cpusize;
+			mutable Image			_cpusrc;
+			mutable Image			_cpuguide;
+			mutable Image			_cpudst;
 	};
 }
 
@@ -0,0 +1,200 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/gfx/ifilter/GuidedFilter.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/util/CVTTest.h>
+
+#include <vector>
+
+using namespace cvt;
+
+static void _randomImage( Image& img, size_t w, size_t h, const IFormat& format )
+{
+    img.reallocate( w, h, format );
+    IMapScoped<float> map( img );
+    for( size_t y = 0; y < h; y++ ) {
+        for( size_t x = 0; x < w * format.channels; x++ )
+            map.ptr()[ x ] = Math::rand( 0.0f, 1.0f );
+        map++;
+    }
+}
+
+static void _channel( Image& dst, const Image& src, size_t c )
+{
+    dst.reallocate( src.width(), src.height(), IFormat::GRAY_FLOAT );
+    IMapScoped<float> mapd( dst );
+    IMapScoped<const float> maps( src );
+    for( size_t y = 0; y < src.height(); y++ )
+        for( size_t x = 0; x < src.width(); x++ )
+            mapd( x, y ) = maps( x, y, c );
+}
+
+/* mean over the box clipped to the image, the same border handling as the prefix sum box filter */
+static void _boxMean( std::vector<float>& dst, const std::vector<float>& src, int w, int h, int r )
+{
+    dst.resize( w * h );
+    for( int y = 0; y < h; y++ ) {
+        for( int x = 0; x < w; x++ ) {
+            float sum = 0.0f;
+            int n = 0;
+            for( int yy = Math::max( y - r, 0 ); yy <= Math::min( y + r, h - 1 ); yy++ ) {
+                for( int xx = Math::max( x - r, 0 ); xx <= Math::min( x + r, w - 1 ); xx++ ) {
+                    sum += src[ yy * w + xx ];
+                    n++;
+                }
+            }
+            dst[ y * w + x ] = sum / ( float ) n;
+        }
+    }
+}
+
+static float _maxDiffGray( const Image& out, const Image& src, const Image& guide, int r, float eps )
+{
+    const int w = src.width();
+    const int h = src.height();
+    std::vector<float> S( w * h ), G( w * h ), GS( w * h ), GG( w * h );
+    std::vector<float> mS, mG, mGS, mGG, ma, mb;
+    {
+        IMapScoped<const float> maps( src );
+        IMapScoped<const float> mapg( guide );
+        for( int y = 0; y < h; y++ ) {
+            for( int x = 0; x < w; x++ ) {
+                S[ y * w + x ] = maps( x, y );
+                G[ y * w + x ] = mapg( x, y );
+                GS[ y * w + x ] = S[ y * w + x ] * G[ y * w + x ];
+                GG[ y * w + x ] = G[ y * w + x ] * G[ y * w + x ];
+            }
+        }
+    }
+    _boxMean( mS, S, w, h, r );
+    _boxMean( mG, G, w, h, r );
+    _boxMean( mGS, GS, w, h, r );
+    _boxMean( mGG, GG, w, h, r );
+
+    std::vector<float> a( w * h ), b( w * h );
+    for( int i = 0; i < w * h; i++ ) {
+        a[ i ] = ( mGS[ i ] - mG[ i ] * mS[ i ] ) / ( mGG[ i ] - mG[ i ] * mG[ i ] + eps );
+        b[ i ] = mS[ i ] - a[ i ] * mG[ i ];
+    }
+    _boxMean( ma, a, w, h, r );
+    _boxMean( mb, b, w, h, r );
+
+    float maxdiff = 0.0f;
+    IMapScoped<const float> mapo( out );
+    for( int y = 0; y < h; y++ ) {
+        for( int x = 0; x < w; x++ ) {
+            float ref = ma[ y * w + x ] * G[ y * w + x ] + mb[ y * w + x ];
+            maxdiff = Math::max( maxdiff, Math::abs( mapo( x, y ) - ref ) );
+        }
+    }
+    return maxdiff;
+}
+
+/* with a tiny epsilon a guide channel filtered with the full covariance guided filter reproduces itself */
+static float _maxDiffCovIdentity( const Image& out, const Image& guide, size_t channel )
+{
+    float maxdiff = 0.0f;
+    IMapScoped<const float> mapo( out );
+    IMapScoped<const float> mapg( guide );
+    for( size_t y = 0; y < out.height(); y++ ) {
+        for( size_t x = 0; x < out.width(); x++ )
+            maxdiff = Math::max( maxdiff, Math::abs( mapo( x, y ) - mapg( x, y, channel ) ) );
+    }
+    return maxdiff;
+}
+
+BEGIN_CVTTEST( GuidedFilter )
+    bool result = true;
+    bool b;
+    GuidedFilter gf;
+    Image src, guide, out;
+
+    _randomImage( src, 61, 47, IFormat::GRAY_FLOAT );
+    _randomImage( guide, 61, 47, IFormat::GRAY_FLOAT );
+    gf.apply( out, src, guide, 3, 0.01f, false, IFILTER_CPU );
+    b = out.format() == IFormat::GRAY_FLOAT && _maxDiffGray( out, src, guide, 3, 0.01f ) < 1e-4f;
+    CVTTEST_PRINT( "gray guide", b );
+    result &= b;
+
+    /* same size again, reusing the workspace */
+    _randomImage( src, 61, 47, IFormat::GRAY_FLOAT );
+    gf.apply( out, src, guide, 5, 0.1f, false, IFILTER_CPU );
+    b = _maxDiffGray( out, src, guide, 5, 0.1f ) < 1e-4f;
+    CVTTEST_PRINT( "workspace reuse", b );
+    result &= b;
+
+    /* larger size, the workspace has to grow */
+    _randomImage( src, 130, 71, IFormat::GRAY_FLOAT );
+    _randomImage( guide, 130, 71, IFormat::GRAY_FLOAT );
+    gf.apply( out, src, guide, 4, 0.05f, false, IFILTER_CPU );
+    b = _maxDiffGray( out, src, guide, 4, 0.05f ) < 1e-4f;
+    CVTTEST_PRINT( "workspace growth", b );
+    result &= b;
+
+    /* in place */
+    Image inplace( src );
+    gf.apply( inplace, inplace, guide, 4, 0.05f, false, IFILTER_CPU );
+    b = _maxDiffGray( inplace, src, guide, 4, 0.05f ) < 1e-4f;
+    CVTTEST_PRINT( "in place", b );
+    result &= b;
+
+    Image rgbguide, gray;
+    _randomImage( rgbguide, 80, 60, IFormat::RGBA_FLOAT );
+    rgbguide.convert( gray, IFormat::GRAY_FLOAT );
+    _randomImage( src, 80, 60, IFormat::GRAY_FLOAT );
+    for( size_t c = 0; c < 3; c++ ) {
+        _channel( src, rgbguide, c );
+        gf.apply( out, src, rgbguide, 2, 1e-6f, true, IFILTER_CPU );
+        b = _maxDiffCovIdentity( out, rgbguide, c ) < 1e-2f;
+        CVTTEST_PRINT( "rgb covariance", b );
+        result &= b;
+    }
+
+    /* colour guide without covariance on a gray source uses the gray version of the guide */
+    gf.apply( out, src, rgbguide, 3, 0.01f, false, IFILTER_CPU );
+    b = _maxDiffGray( out, src, gray, 3, 0.01f ) < 1e-4f;
+    CVTTEST_PRINT( "colour guide, gray source", b );
+    result &= b;
+
+    /* colour source and guide, channel-wise with the alpha channel copied */
+    Image rgbsrc, outc, srcc, guidec;
+    _randomImage( rgbsrc, 80, 60, IFormat::RGBA_FLOAT );
+    gf.apply( out, rgbsrc, rgbguide, 3, 0.01f, false, IFILTER_CPU );
+    b = out.format() == IFormat::RGBA_FLOAT;
+    for( size_t c = 0; c < 3; c++ ) {
+        _channel( outc, out, c );
+        _channel( srcc, rgbsrc, c );
+        _channel( guidec, rgbguide, c );
+        b &= _maxDiffGray( outc, srcc, guidec, 3, 0.01f ) < 1e-4f;
+    }
+    _channel( outc, out, 3 );
+    _channel( srcc, rgbsrc, 3 );
+    b &= _maxDiffCovIdentity( outc, srcc, 0 ) == 0.0f;
+    CVTTEST_PRINT( "colour guide, colour source", b );
+    result &= b;
+
+    return result;
+END_CVTTEST
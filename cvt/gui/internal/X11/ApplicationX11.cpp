@@ -98,7 +98,7 @@ namespace cvt {
 	{
 		int timeout;
 		X11Handler x11handler( dpy, &windows );
-		_ioselect.registerIOHandler( &x11handler );
+		_ioepoll.registerIOHandler( &x11handler );
 
 		run = true;
 
@@ -109,7 +109,7 @@ namespace cvt {
 			timeout = _timers.nextTimeout();
 
 			x11handler.handleQueued();
-			_ioselect.handleIO( timeout );
+			_ioepoll.handleIO( timeout );
 
 			if( !updates.empty() ) {
 				PaintEvent pe( 0, 0, 0, 0 );
@@ -124,7 +124,7 @@ namespace cvt {
 			}
 		}
 
-		_ioselect.unregisterIOHandler( &x11handler );
+		_ioepoll.unregisterIOHandler( &x11handler );
 
 		/* FIXME: do cleanup afterwards */
 	}
@@ -33,7 +33,7 @@
 #include <cvt/gui/TimeoutHandler.h>
 #include <cvt/gui/internal/TimerInfoList.h>
 #include <cvt/gl/OpenGL.h>
-#include <cvt/io/IOSelect.h>
+#include <cvt/io/IOEpoll.h>
 #include <map>
 #include <deque>
 
@@ -69,7 +69,7 @@ namespace cvt {
 			bool run;
 			std::map< ::Window, WidgetImplWinGLX11*> windows;
 			std::deque< WidgetImplWinGLX11*> updates;
-			IOSelect _ioselect;
+			IOEpoll _ioepoll;
 			TimerInfoList _timers;
 			bool _clsupport;
 	};
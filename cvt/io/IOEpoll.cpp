@@ -0,0 +1,309 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/io/IOEpoll.h>
+#include <cvt/io/IOHandler.h>
+#include <cvt/gui/TimeoutHandler.h>
+#include <cvt/util/Exception.h>
+#include <cvt/util/String.h>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+namespace cvt {
+
+	IOEpoll::IOEpoll() :
+		_events( 64 ),
+		_numEvents( 0 ),
+		_current( 0 ),
+		_nextTimerId( 1 )
+	{
+		_epfd = epoll_create1( EPOLL_CLOEXEC );
+		if( _epfd < 0 ) {
+			String msg( "epoll_create: " );
+			msg += strerror( errno );
+			throw CVTException( msg.c_str() );
+		}
+
+		_wakefd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+		if( _wakefd < 0 ) {
+			String msg( "eventfd: " );
+			msg += strerror( errno );
+			::close( _epfd );
+			throw CVTException( msg.c_str() );
+		}
+
+		/* the loop itself marks the wakeup event */
+		struct epoll_event ev;
+		ev.events = EPOLLIN;
+		ev.data.ptr = this;
+		if( epoll_ctl( _epfd, EPOLL_CTL_ADD, _wakefd, &ev ) < 0 ) {
+			String msg( "epoll_ctl: " );
+			msg += strerror( errno );
+			::close( _wakefd );
+			::close( _epfd );
+			throw CVTException( msg.c_str() );
+		}
+	}
+
+	IOEpoll::~IOEpoll()
+	{
+		::close( _wakefd );
+		::close( _epfd );
+	}
+
+	uint64_t IOEpoll::now()
+	{
+		struct timespec ts;
+		clock_gettime( CLOCK_MONOTONIC, &ts );
+		return ( uint64_t ) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+	}
+
+	void IOEpoll::registerIOHandler( IOHandler* ioh, bool edgeTriggered )
+	{
+		ioh->_changes = &_changes;
+		ioh->_changed = false;
+		ioh->_edgeTriggered = edgeTriggered;
+		ioh->_epollEvents = 0;
+		updateInterest( ioh );
+	}
+
+	void IOEpoll::unregisterIOHandler( IOHandler* ioh )
+	{
+		if( ioh->_epollEvents ) {
+			/* the fd may already be closed, in which case the kernel dropped it itself */
+			struct epoll_event ev;
+			epoll_ctl( _epfd, EPOLL_CTL_DEL, ioh->_fd, &ev );
+		}
+
+		if( ioh->_changed ) {
+			for( std::vector<IOHandler*>::iterator it = _changes.begin(); it != _changes.end(); ++it ) {
+				if( *it == ioh ) {
+					_changes.erase( it );
+					break;
+				}
+			}
+		}
+
+		/* remove pending events of the current batch, unregistering from a callback is allowed */
+		for( int i = _current; i < _numEvents; i++ ) {
+			if( _events[ i ].data.ptr == ioh )
+				_events[ i ].data.ptr = NULL;
+		}
+
+		ioh->_changes = NULL;
+		ioh->_changed = false;
+		ioh->_epollEvents = 0;
+	}
+
+	void IOEpoll::updateInterest( IOHandler* ioh )
+	{
+		uint32_t events = 0;
+
+		ioh->_changed = false;
+
+		if( ioh->_read )
+			events |= EPOLLIN;
+		if( ioh->_write )
+			events |= EPOLLOUT;
+		if( ioh->_except )
+			events |= EPOLLPRI;
+		if( events && ioh->_edgeTriggered )
+			events |= EPOLLET;
+
+		if( events == ioh->_epollEvents )
+			return;
+
+		/* handlers without interest are removed from the kernel set, otherwise a hangup would be
+		   reported over and over again */
+		int op;
+		if( !events )
+			op = EPOLL_CTL_DEL;
+		else if( !ioh->_epollEvents )
+			op = EPOLL_CTL_ADD;
+		else
+			op = EPOLL_CTL_MOD;
+
+		struct epoll_event ev;
+		ev.events = events;
+		ev.data.ptr = ioh;
+		if( epoll_ctl( _epfd, op, ioh->_fd, &ev ) < 0 ) {
+			String msg( "epoll_ctl: " );
+			msg += strerror( errno );
+			throw CVTException( msg.c_str() );
+		}
+		ioh->_epollEvents = events;
+	}
+
+	void IOEpoll::applyChanges()
+	{
+		/* updateInterest does not modify the change list */
+		for( size_t i = 0; i < _changes.size(); i++ )
+			updateInterest( _changes[ i ] );
+		_changes.clear();
+	}
+
+	uint32_t IOEpoll::registerTimer( size_t intervalms, TimeoutHandler* th )
+	{
+		uint32_t id = _nextTimerId++;
+		if( !_nextTimerId )
+			_nextTimerId = 1;
+
+		TimerInfo& t = _timers[ id ];
+		t.interval = intervalms ? intervalms : 1;
+		t.deadline = now() + t.interval;
+		t.handler = th;
+		_timerQueue.push( TimerEntry( t.deadline, id ) );
+		return id;
+	}
+
+	void IOEpoll::unregisterTimer( uint32_t id )
+	{
+		/* the queue entry is dropped lazily when it expires */
+		_timers.erase( id );
+	}
+
+	int IOEpoll::nextTimeout() const
+	{
+		if( _timers.empty() )
+			return -1;
+
+		/* stale entries of removed timers only cause an early wakeup */
+		uint64_t current = now();
+		uint64_t deadline = _timerQueue.top().first;
+		return deadline > current ? ( int ) ( deadline - current ) : 0;
+	}
+
+	int IOEpoll::handleTimers()
+	{
+		int dispatched = 0;
+		uint64_t current = now();
+
+		while( !_timerQueue.empty() && _timerQueue.top().first <= current ) {
+			TimerEntry e = _timerQueue.top();
+			_timerQueue.pop();
+
+			std::map<uint32_t, TimerInfo>::iterator it = _timers.find( e.second );
+			if( it == _timers.end() || it->second.deadline != e.first )
+				continue;
+
+			/* rearm before the callback, the handler may unregister its own timer */
+			TimerInfo& t = it->second;
+			t.deadline = current + t.interval;
+			_timerQueue.push( TimerEntry( t.deadline, e.second ) );
+			t.handler->onTimeout();
+			dispatched++;
+		}
+
+		if( _timers.empty() ) {
+			while( !_timerQueue.empty() )
+				_timerQueue.pop();
+		}
+		return dispatched;
+	}
+
+	void IOEpoll::wakeup()
+	{
+		uint64_t one = 1;
+		ssize_t ret;
+		do {
+			ret = ::write( _wakefd, &one, sizeof( one ) );
+		} while( ret < 0 && errno == EINTR );
+		/* EAGAIN: the counter is saturated, the loop is woken up anyway */
+	}
+
+	void IOEpoll::drainWakeup()
+	{
+		uint64_t value;
+		ssize_t ret;
+		do {
+			ret = ::read( _wakefd, &value, sizeof( value ) );
+		} while( ret < 0 && errno == EINTR );
+	}
+
+	int IOEpoll::handleIO( ssize_t ms )
+	{
+		int dispatched = 0;
+
+		applyChanges();
+
+		int timeout = nextTimeout();
+		if( timeout < 0 || ( ms >= 0 && ms < timeout ) )
+			timeout = ms < 0 ? -1 : ( int ) ms;
+
+		int ret = epoll_wait( _epfd, &_events[ 0 ], ( int ) _events.size(), timeout );
+		if( ret < 0 ) {
+			if( errno != EINTR ) {
+				String msg( "epoll_wait: " );
+				msg += strerror( errno );
+				throw CVTException( msg.c_str() );
+			}
+			ret = 0;
+		}
+
+		_numEvents = ret;
+		for( _current = 0; _current < _numEvents; _current++ ) {
+			const struct epoll_event& ev = _events[ _current ];
+
+			if( ev.data.ptr == this ) {
+				drainWakeup();
+				continue;
+			}
+
+			/* callbacks may unregister handlers, recheck the entry after every callback */
+			IOHandler* ioh = ( IOHandler* ) ev.data.ptr;
+			if( !ioh )
+				continue;
+
+			uint32_t events = ev.events;
+			bool active = false;
+			if( ioh->_read && ( events & ( EPOLLIN | EPOLLHUP | EPOLLERR ) ) ) {
+				ioh->onDataReadable();
+				active = true;
+			}
+			if( _events[ _current ].data.ptr == ioh && ioh->_write && ( events & ( EPOLLOUT | EPOLLHUP | EPOLLERR ) ) ) {
+				ioh->onDataWriteable();
+				active = true;
+			}
+			if( _events[ _current ].data.ptr == ioh && ioh->_except && ( events & EPOLLPRI ) ) {
+				ioh->onException();
+				active = true;
+			}
+			if( active )
+				dispatched++;
+		}
+
+		/* a full batch hints at more ready handlers, grow the buffer for the next call */
+		if( _numEvents == ( int ) _events.size() )
+			_events.resize( _events.size() * 2 );
+		_numEvents = 0;
+		_current = 0;
+
+		dispatched += handleTimers();
+		return dispatched;
+	}
+}
@@ -0,0 +1,105 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_IOEPOLL_H
+#define CVT_IOEPOLL_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+
+#include <vector>
+#include <queue>
+#include <map>
+#include <functional>
+
+namespace cvt {
+	class IOHandler;
+	class TimeoutHandler;
+
+	/**
+	  @brief epoll based event loop, drop-in replacement for IOSelect on Linux
+
+	  Registering and unregistering handlers is O(1) and changes of the handler interest
+	  (notifyReadable etc.) are forwarded lazily to the kernel at the next handleIO call.
+	  Handlers are level-triggered by default, matching the IOSelect semantics. Handlers that
+	  read/write until EAGAIN can be registered edge-triggered to avoid repeated wakeups.
+
+	  Periodic timers are dispatched by handleIO as well, the timeout passed to handleIO is
+	  shortened to the next timer deadline.
+
+	  An IOEpoll instance is meant to be driven by a single thread, for multiple cores use one
+	  loop per thread. wakeup() is the only method that may be called from other threads, it
+	  interrupts a blocking handleIO call.
+	  Handlers have to be unregistered before they or the loop are destroyed.
+	 */
+	class IOEpoll {
+		public:
+			IOEpoll();
+			~IOEpoll();
+
+			/* waits at most timeout_ms (-1 infinite) and returns the number of dispatched handlers and timers */
+			int handleIO( ssize_t timeout_ms );
+			void registerIOHandler( IOHandler* ioh, bool edgeTriggered = false );
+			void unregisterIOHandler( IOHandler* ioh );
+
+			uint32_t registerTimer( size_t intervalms, TimeoutHandler* th );
+			void unregisterTimer( uint32_t id );
+			/* ms until the next timer expires, -1 if there is no timer */
+			int nextTimeout() const;
+
+			void wakeup();
+
+		private:
+			IOEpoll( const IOEpoll& );
+			IOEpoll& operator=( const IOEpoll& );
+
+			struct TimerInfo {
+				uint64_t		deadline;
+				size_t			interval;
+				TimeoutHandler* handler;
+			};
+			typedef std::pair<uint64_t, uint32_t> TimerEntry;
+
+			static uint64_t now();
+			void updateInterest( IOHandler* ioh );
+			void applyChanges();
+			int	 handleTimers();
+			void drainWakeup();
+
+			int								 _epfd;
+			int								 _wakefd;
+			std::vector<struct epoll_event>	 _events;
+			int								 _numEvents;
+			int								 _current;
+			std::vector<IOHandler*>			 _changes;
+
+			std::priority_queue<TimerEntry, std::vector<TimerEntry>, std::greater<TimerEntry> > _timerQueue;
+			std::map<uint32_t, TimerInfo>	 _timers;
+			uint32_t						 _nextTimerId;
+	};
+
+}
+
+#endif
@@ -0,0 +1,195 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/io/IOEpoll.h>
+#include <cvt/io/IOHandler.h>
+#include <cvt/gui/TimeoutHandler.h>
+#include <cvt/util/Exception.h>
+#include <cvt/util/Time.h>
+#include <cvt/util/CVTTest.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+using namespace cvt;
+
+/* counts the callbacks, reads the pending data only if asked to */
+class IOEpollTestHandler : public IOHandler
+{
+    public:
+        IOEpollTestHandler( int fd ) : IOHandler( fd ), readable( 0 ), writeable( 0 ), drain( false ),
+            loop( NULL ), other( NULL ) {}
+
+        void onDataReadable()
+        {
+            readable++;
+            if( drain ) {
+                char buf[ 64 ];
+                while( ::read( _fd, buf, sizeof( buf ) ) > 0 )
+                    ;
+            }
+            if( loop && other )
+                loop->unregisterIOHandler( other );
+        }
+
+        void onDataWriteable()
+        {
+            writeable++;
+        }
+
+        size_t              readable;
+        size_t              writeable;
+        bool                drain;
+        /* unregister other from the callback */
+        IOEpoll*            loop;
+        IOEpollTestHandler* other;
+};
+
+class IOEpollTestTimer : public TimeoutHandler
+{
+    public:
+        IOEpollTestTimer() : count( 0 ) {}
+        void onTimeout() { count++; }
+
+        size_t count;
+};
+
+static void _send( int fd, size_t n = 1 )
+{
+    char buf[ 64 ] = { 0 };
+    if( ::write( fd, buf, n ) != ( ssize_t ) n )
+        throw CVTException( "write failed" );
+}
+
+BEGIN_CVTTEST( IOEpoll )
+    bool result = true;
+    bool b;
+
+    int fds[ 2 ];
+    if( socketpair( AF_UNIX, SOCK_STREAM, 0, fds ) < 0 )
+        return false;
+    fcntl( fds[ 0 ], F_SETFL, O_NONBLOCK );
+    fcntl( fds[ 1 ], F_SETFL, O_NONBLOCK );
+
+    try {
+        IOEpoll loop;
+        IOEpollTestHandler h( fds[ 0 ] );
+
+        /* level-triggered readiness is reported until the data is read */
+        h.notifyReadable( true );
+        loop.registerIOHandler( &h );
+        b = loop.handleIO( 0 ) == 0 && h.readable == 0;
+        _send( fds[ 1 ] );
+        b &= loop.handleIO( 0 ) == 1 && h.readable == 1;
+        b &= loop.handleIO( 0 ) == 1 && h.readable == 2;
+        h.drain = true;
+        b &= loop.handleIO( 0 ) == 1 && h.readable == 3;
+        b &= loop.handleIO( 0 ) == 0 && h.readable == 3 && h.writeable == 0;
+        CVTTEST_PRINT( "add and readable", b );
+        result &= b;
+
+        /* interest changes are applied by the next handleIO */
+        h.notifyWriteable( true );
+        b = loop.handleIO( 0 ) == 1 && h.writeable == 1 && h.readable == 3;
+        _send( fds[ 1 ] );
+        b &= loop.handleIO( 0 ) == 1 && h.writeable == 2 && h.readable == 4;
+        h.notifyWriteable( false );
+        h.notifyReadable( false );
+        _send( fds[ 1 ] );
+        b &= loop.handleIO( 0 ) == 0 && h.writeable == 2 && h.readable == 4;
+        h.notifyReadable( true );
+        b &= loop.handleIO( 0 ) == 1 && h.readable == 5 && h.writeable == 2;
+        CVTTEST_PRINT( "modify", b );
+        result &= b;
+
+        /* removed handlers get no callbacks */
+        loop.unregisterIOHandler( &h );
+        _send( fds[ 1 ] );
+        b = loop.handleIO( 0 ) == 0 && h.readable == 5;
+        h.notifyWriteable( true );
+        b &= loop.handleIO( 0 ) == 0 && h.writeable == 2;
+        h.notifyWriteable( false );
+        h.drain = false;
+        CVTTEST_PRINT( "remove", b );
+        result &= b;
+
+        /* edge-triggered handlers are reported once per arriving data */
+        loop.registerIOHandler( &h, true );
+        b = loop.handleIO( 0 ) == 1 && h.readable == 6;
+        b &= loop.handleIO( 0 ) == 0 && h.readable == 6;
+        _send( fds[ 1 ] );
+        b &= loop.handleIO( 0 ) == 1 && h.readable == 7;
+        loop.unregisterIOHandler( &h );
+        CVTTEST_PRINT( "edge triggered", b );
+        result &= b;
+
+        /* both ends are ready, the handler dispatched first removes the other one */
+        {
+            IOEpollTestHandler h0( fds[ 0 ] );
+            IOEpollTestHandler h1( fds[ 1 ] );
+            h0.loop = h1.loop = &loop;
+            h0.other = &h1;
+            h1.other = &h0;
+            h0.drain = h1.drain = true;
+            h0.notifyReadable( true );
+            h1.notifyReadable( true );
+            loop.registerIOHandler( &h0 );
+            loop.registerIOHandler( &h1 );
+            _send( fds[ 0 ] );
+            b = loop.handleIO( 0 ) == 1 && h0.readable + h1.readable == 1;
+            loop.unregisterIOHandler( &h0 );
+            loop.unregisterIOHandler( &h1 );
+        }
+        CVTTEST_PRINT( "remove from callback", b );
+        result &= b;
+
+        /* a pending wakeup interrupts the wait, timers shorten it */
+        {
+            Time t;
+            loop.wakeup();
+            b = loop.handleIO( 2000 ) == 0 && t.elapsedMilliSeconds() < 1000.0;
+
+            IOEpollTestTimer timer;
+            uint32_t id = loop.registerTimer( 20, &timer );
+            t.reset();
+            while( !timer.count && t.elapsedMilliSeconds() < 2000.0 )
+                loop.handleIO( -1 );
+            b &= timer.count == 1 && t.elapsedMilliSeconds() >= 15.0 && t.elapsedMilliSeconds() < 1000.0;
+            loop.unregisterTimer( id );
+            b &= loop.nextTimeout() == -1;
+        }
+        CVTTEST_PRINT( "wakeup and timer", b );
+        result &= b;
+    } catch( const Exception& e ) {
+        CVTTEST_PRINT( "IOEpoll", false );
+        result = false;
+    }
+
+    ::close( fds[ 0 ] );
+    ::close( fds[ 1 ] );
+
+    return result;
+END_CVTTEST
@@ -26,11 +26,14 @@
 #define CVT_IOHANDLER_H
 
 #include <cvt/io/IOSelect.h>
+#include <vector>
+#include <stdint.h>
 
 namespace cvt {
 
 	class IOHandler {
 		friend class IOSelect;
+		friend class IOEpoll;
 
 		public:
 			IOHandler( int fd = -1 );
@@ -44,15 +47,23 @@ namespace cvt {
 
 		private:
 			IOHandler( const IOHandler& );
+			void interestChanged();
 
 			bool _read;
 			bool _write;
 			bool _except;
+
+			/* IOEpoll bookkeeping: pending interest changes and the event mask known to the kernel */
+			std::vector<IOHandler*>* _changes;
+			bool	 _changed;
+			bool	 _edgeTriggered;
+			uint32_t _epollEvents;
 		protected:
 			int _fd;
 	};
 
-	inline IOHandler::IOHandler( int fd ) : _read( false ), _write( false ), _except( false ), _fd( fd )
+	inline IOHandler::IOHandler( int fd ) : _read( false ), _write( false ), _except( false ),
+		_changes( NULL ), _changed( false ), _edgeTriggered( false ), _epollEvents( 0 ), _fd( fd )
 	{
 	}
 
@@ -62,20 +73,34 @@ namespace cvt {
 
 	inline void IOHandler::notifyReadable( bool b )
 	{
-		if( _fd >= 0 )
+		if( _fd >= 0 && _read != b ) {
 			_read = b;
+			interestChanged();
+		}
 	}
 
 	inline void IOHandler::notifyWriteable( bool b )
 	{
-		if( _fd >= 0 )
+		if( _fd >= 0 && _write != b ) {
 			_write = b;
+			interestChanged();
+		}
 	}
 
 	inline void IOHandler::notifyException( bool b )
 	{
-		if( _fd >= 0 )
+		if( _fd >= 0 && _except != b ) {
 			_except = b;
+			interestChanged();
+		}
+	}
+
+	inline void IOHandler::interestChanged()
+	{
+		if( _changes && !_changed ) {
+			_changed = true;
+			_changes->push_back( this );
+		}
 	}
 
 	inline void IOHandler::onDataReadable()
@@ -0,0 +1,172 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/io/ImagePrefetcher.h>
+#include <cvt/util/PluginManager.h>
+#include <cvt/util/Exception.h>
+#include <cvt/math/Math.h>
+
+namespace cvt
+{
+	ImagePrefetcher::ImagePrefetcher( const std::vector<String>& files, size_t imagesPerFrame, size_t ahead, size_t numThreads ) :
+		_files( files ),
+		_imagesPerFrame( Math::max( imagesPerFrame, ( size_t ) 1 ) ),
+		_next( 0 ),
+		_scheduled( 0 ),
+		_generation( 0 ),
+		_stop( false )
+	{
+		_numFrames = _files.size() / _imagesPerFrame;
+
+		_slots.resize( Math::max( ahead, ( size_t ) 1 ) );
+		for( size_t i = 0; i < _slots.size(); i++ ){
+			_slots[ i ].images.resize( _imagesPerFrame );
+			_slots[ i ].state = SLOT_EMPTY;
+		}
+
+		/* load the plugins before the decoders look up the loaders concurrently */
+		PluginManager::instance();
+
+		numThreads = Math::max( numThreads, ( size_t ) 1 );
+		for( size_t i = 0; i < numThreads; i++ ){
+			Decoder* d = new Decoder();
+			d->run( this );
+			_decoders.push_back( d );
+		}
+	}
+
+	ImagePrefetcher::~ImagePrefetcher()
+	{
+		_mutex.lock();
+		_stop = true;
+		_cond.notifyAll();
+		_mutex.unlock();
+
+		for( size_t i = 0; i < _decoders.size(); i++ ){
+			_decoders[ i ]->join();
+			delete _decoders[ i ];
+		}
+	}
+
+	size_t ImagePrefetcher::position() const
+	{
+		ScopeLock lock( &_mutex );
+		return _next;
+	}
+
+	inline size_t ImagePrefetcher::scheduleEnd() const
+	{
+		return Math::min( _next + _slots.size(), _numFrames );
+	}
+
+	void ImagePrefetcher::seek( size_t frame )
+	{
+		ScopeLock lock( &_mutex );
+		/* frames still decoded for the old position are discarded by the decoders */
+		_generation++;
+		_next = _scheduled = Math::min( frame, _numFrames );
+		for( size_t i = 0; i < _slots.size(); i++ )
+			_slots[ i ].state = SLOT_EMPTY;
+		_cond.notifyAll();
+	}
+
+	void ImagePrefetcher::decode()
+	{
+		/* decode into thread local images, finished frames are swapped into their slot */
+		std::vector<Image> images( _imagesPerFrame );
+
+		_mutex.lock();
+		for( ;; ){
+			while( !_stop && _scheduled >= scheduleEnd() )
+				_cond.wait( _mutex );
+			if( _stop )
+				break;
+
+			size_t frame = _scheduled++;
+			size_t generation = _generation;
+			_mutex.unlock();
+
+			String error;
+			bool failed = false;
+			try {
+				for( size_t i = 0; i < _imagesPerFrame; i++ )
+					images[ i ].load( _files[ frame * _imagesPerFrame + i ] );
+			} catch( const Exception& e ) {
+				error = e.what();
+				failed = true;
+			}
+
+			_mutex.lock();
+			if( generation == _generation ){
+				/* the slot of frame - ahead has already been consumed, frame < _next + ahead */
+				Slot& slot = _slots[ frame % _slots.size() ];
+				for( size_t i = 0; i < _imagesPerFrame; i++ )
+					slot.images[ i ].swap( images[ i ] );
+				slot.state = failed ? SLOT_FAILED : SLOT_READY;
+				slot.error = error;
+				_cond.notifyAll();
+			}
+		}
+		_mutex.unlock();
+	}
+
+	bool ImagePrefetcher::next( Image** images )
+	{
+		ScopeLock lock( &_mutex );
+		if( _next >= _numFrames )
+			return false;
+
+		Slot& slot = _slots[ _next % _slots.size() ];
+		while( slot.state == SLOT_EMPTY )
+			_cond.wait( _mutex );
+
+		bool failed = slot.state == SLOT_FAILED;
+		slot.state = SLOT_EMPTY;
+		_next++;
+		_cond.notifyAll();
+
+		if( failed )
+			throw CVTException( slot.error.c_str() );
+
+		for( size_t i = 0; i < _imagesPerFrame; i++ )
+			images[ i ]->swap( slot.images[ i ] );
+		return true;
+	}
+
+	bool ImagePrefetcher::next( Image& image )
+	{
+		if( _imagesPerFrame != 1 )
+			throw CVTException( "ImagePrefetcher: frames consist of more than one image" );
+		Image* images[ 1 ] = { &image };
+		return next( images );
+	}
+
+	bool ImagePrefetcher::next( Image& image0, Image& image1 )
+	{
+		if( _imagesPerFrame != 2 )
+			throw CVTException( "ImagePrefetcher: frames do not consist of two images" );
+		Image* images[ 2 ] = { &image0, &image1 };
+		return next( images );
+	}
+}
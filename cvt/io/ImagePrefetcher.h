@@ -0,0 +1,106 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_IMAGEPREFETCHER_H
+#define CVT_IMAGEPREFETCHER_H
+
+#include <cvt/gfx/Image.h>
+#include <cvt/util/String.h>
+#include <cvt/util/Thread.h>
+#include <cvt/util/Mutex.h>
+#include <cvt/util/Condition.h>
+
+#include <vector>
+
+namespace cvt
+{
+	/**
+	  @brief Decodes the images of a file sequence ahead of time in background threads
+
+	  Every frame consists of imagesPerFrame images, the file list holds the file names of the
+	  frames one after another. Up to ahead frames after the current position are decoded by the
+	  decoder threads, next() returns the frames in order. The images passed to next() are
+	  exchanged with the decoded ones, so their memory is reused for decoding later frames.
+	  Decoding errors are rethrown by next() for the affected frame.
+	 */
+	class ImagePrefetcher
+	{
+		public:
+			ImagePrefetcher( const std::vector<String>& files, size_t imagesPerFrame = 1, size_t ahead = 4, size_t numThreads = 2 );
+			~ImagePrefetcher();
+
+			size_t	size() const { return _numFrames; }
+			/* index of the frame returned by the next call to next() */
+			size_t	position() const;
+			void	seek( size_t frame );
+
+			/* waits for the next frame and swaps its images into images[ 0 ] ... images[ imagesPerFrame - 1 ],
+			   returns false at the end of the sequence */
+			bool	next( Image** images );
+			bool	next( Image& image );
+			bool	next( Image& image0, Image& image1 );
+
+		private:
+			ImagePrefetcher( const ImagePrefetcher& );
+			ImagePrefetcher& operator=( const ImagePrefetcher& );
+
+			enum SlotState {
+				SLOT_EMPTY,
+				SLOT_READY,
+				SLOT_FAILED
+			};
+
+			struct Slot {
+				std::vector<Image>	images;
+				SlotState			state;
+				String				error;
+			};
+
+			class Decoder : public Thread<ImagePrefetcher>
+			{
+				public:
+					void execute( ImagePrefetcher* prefetcher ) { prefetcher->decode(); }
+			};
+
+			void	decode();
+			size_t	scheduleEnd() const;
+
+			std::vector<String>		_files;
+			size_t					_imagesPerFrame;
+			size_t					_numFrames;
+			std::vector<Slot>		_slots;
+			std::vector<Decoder*>	_decoders;
+
+			/* protects everything below */
+			mutable Mutex			_mutex;
+			Condition				_cond;
+			size_t					_next;
+			size_t					_scheduled;
+			size_t					_generation;
+			bool					_stop;
+	};
+
+}
+
+#endif
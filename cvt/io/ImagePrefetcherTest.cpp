@@ -0,0 +1,157 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/io/ImagePrefetcher.h>
+#include <cvt/io/Resources.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/util/Exception.h>
+#include <cvt/util/CVTTest.h>
+
+#include <string.h>
+
+using namespace cvt;
+
+static bool _equal( const Image& a, const Image& b )
+{
+    if( a.width() != b.width() || a.height() != b.height() || a.format() != b.format() )
+        return false;
+    IMapScoped<const uint8_t> ma( a );
+    IMapScoped<const uint8_t> mb( b );
+    size_t n = a.width() * a.bpp();
+    for( size_t y = 0; y < a.height(); y++ ) {
+        if( memcmp( ma.line( y ), mb.line( y ), n ) )
+            return false;
+    }
+    return true;
+}
+
+BEGIN_CVTTEST( ImagePrefetcher )
+    bool result = true;
+    bool b;
+
+    Resources resources;
+    std::vector<String> names;
+    std::vector<Image> refs( 3 );
+    try {
+        names.push_back( resources.find( "logos/cvt.png" ) );
+        names.push_back( resources.find( "logos/cvtsmall.png" ) );
+        names.push_back( resources.find( "Icons/Icons.png" ) );
+        for( size_t i = 0; i < names.size(); i++ )
+            refs[ i ].load( names[ i ] );
+    } catch( const Exception& e ) {
+        CVTTEST_PRINT( "test data", false );
+        return false;
+    }
+
+    /* the frames visit the test images in a fixed pattern, frame i shows image order[ i ] */
+    const size_t order[ 12 ] = { 0, 1, 2, 2, 0, 1, 1, 2, 0, 0, 2, 1 };
+    std::vector<String> files;
+    for( size_t i = 0; i < 12; i++ )
+        files.push_back( names[ order[ i ] ] );
+
+    try {
+        ImagePrefetcher prefetcher( files, 1, 3, 3 );
+        Image img;
+        size_t n = 0;
+        b = prefetcher.size() == 12;
+        while( prefetcher.next( img ) ) {
+            b &= _equal( img, refs[ order[ n ] ] );
+            n++;
+        }
+        b &= n == 12 && prefetcher.position() == 12;
+    } catch( const Exception& e ) {
+        b = false;
+    }
+    CVTTEST_PRINT( "order", b );
+    result &= b;
+
+    try {
+        ImagePrefetcher prefetcher( files, 2, 2, 2 );
+        Image img0, img1;
+        size_t n = 0;
+        b = prefetcher.size() == 6;
+        while( prefetcher.next( img0, img1 ) ) {
+            b &= _equal( img0, refs[ order[ 2 * n ] ] ) && _equal( img1, refs[ order[ 2 * n + 1 ] ] );
+            n++;
+        }
+        b &= n == 6;
+    } catch( const Exception& e ) {
+        b = false;
+    }
+    CVTTEST_PRINT( "image pairs", b );
+    result &= b;
+
+    try {
+        ImagePrefetcher prefetcher( files, 1, 4, 2 );
+        Image img;
+        b = prefetcher.next( img ) && _equal( img, refs[ order[ 0 ] ] );
+        prefetcher.seek( 7 );
+        b &= prefetcher.position() == 7 && prefetcher.next( img ) && _equal( img, refs[ order[ 7 ] ] );
+        prefetcher.seek( 2 );
+        b &= prefetcher.next( img ) && _equal( img, refs[ order[ 2 ] ] );
+    } catch( const Exception& e ) {
+        b = false;
+    }
+    CVTTEST_PRINT( "seek", b );
+    result &= b;
+
+    /* the error of a missing file is raised for its frame only */
+    {
+        std::vector<String> missing( files.begin(), files.begin() + 3 );
+        missing[ 1 ] = "/nonexistent/cvtprefetch.png";
+        ImagePrefetcher prefetcher( missing, 1, 2, 2 );
+        Image img;
+        b = prefetcher.next( img ) && _equal( img, refs[ order[ 0 ] ] );
+        try {
+            prefetcher.next( img );
+            b = false;
+        } catch( const Exception& e ) {
+        }
+        b &= prefetcher.next( img ) && _equal( img, refs[ order[ 2 ] ] );
+        b &= !prefetcher.next( img );
+    }
+    CVTTEST_PRINT( "load error", b );
+    result &= b;
+
+    /* the destructor stops the decoders while loads are still pending */
+    {
+        std::vector<String> many;
+        for( size_t i = 0; i < 64; i++ )
+            many.push_back( names[ i % names.size() ] );
+        {
+            ImagePrefetcher prefetcher( many, 1, 16, 4 );
+        }
+        {
+            ImagePrefetcher prefetcher( many, 1, 16, 4 );
+            Image img;
+            b = prefetcher.next( img ) && _equal( img, refs[ 0 ] );
+            prefetcher.seek( 40 );
+        }
+    }
+    CVTTEST_PRINT( "shutdown", b );
+    result &= b;
+
+    return result;
+END_CVTTEST
@@ -29,7 +29,8 @@ namespace cvt {
     
     ImageSequence::ImageSequence( const String& basename,
                                   const String& ext ) :
-	   _index( 0 )	
+	   _index( 0 ),
+	   _prefetcher( 0 )
     {       
 		std::vector<String> filenames;
 
@@ -48,13 +49,29 @@ namespace cvt {
 		
 		nextFrame();
     }
+
+	ImageSequence::~ImageSequence()
+	{
+		delete _prefetcher;
+	}
+
+	void ImageSequence::enablePrefetching( size_t ahead, size_t numThreads )
+	{
+		delete _prefetcher;
+		_prefetcher = new ImagePrefetcher( _files, 1, ahead, numThreads );
+		_prefetcher->seek( _index );
+	}
     
     bool ImageSequence::nextFrame( size_t )
     {
         // build the string and load the frame
 		if( _index < _files.size() ){
-			_current.load( _files[ _index ] );
-			_index++;
+			/* advance first, the prefetcher has moved on if loading the frame throws */
+			size_t index = _index++;
+			if( _prefetcher )
+				_prefetcher->next( _current );
+			else
+				_current.load( _files[ index ] );
 			return true;
 		} else {
 			return false;
@@ -26,6 +26,7 @@
 #define CVT_IMAGESEQUENCE_H
 
 #include <cvt/io/VideoInput.h>
+#include <cvt/io/ImagePrefetcher.h>
 #include <cvt/util/String.h>
 #include <vector>
 
@@ -37,7 +38,7 @@ namespace cvt
             ImageSequence( const String& basename,
                            const String& ext );
         
-            ~ImageSequence(){}
+            ~ImageSequence();
         
             size_t  width() const { return _current.width(); }
             size_t  height() const { return _current.height(); }
@@ -45,12 +46,19 @@ namespace cvt
             const   Image & frame() const { return _current; }
             bool    nextFrame( size_t timeout = 0 );
 			bool	hasNext() const;
+
+			/* decode the next ahead frames with numThreads background threads */
+			void	enablePrefetching( size_t ahead = 4, size_t numThreads = 2 );
             
         
         private:
+			ImageSequence( const ImageSequence& );
+			ImageSequence& operator=( const ImageSequence& );
+
             Image					_current;   
 			std::vector<String>		_files;
             size_t					_index;
+			ImagePrefetcher*		_prefetcher;
 	
 			bool extractFolder( String& folder, const String& basename ) const;
     };
@@ -33,7 +33,8 @@ namespace cvt {
 
     KittiVOParser::KittiVOParser( const cvt::String& folder, bool useColorCams ) :
         _useColor( useColorCams ),
-        _iter( 0 )
+        _iter( 0 ),
+        _prefetcher( 0 )
     {
         cvt::String leftFolder( folder );
         cvt::String rightFolder( folder );
@@ -114,6 +115,23 @@ namespace cvt {
 
     KittiVOParser::~KittiVOParser()
     {
+        delete _prefetcher;
+    }
+
+    void KittiVOParser::enablePrefetching( size_t ahead, size_t numThreads )
+    {
+        delete _prefetcher;
+
+        std::vector<cvt::String> files;
+        files.reserve( 2 * _sequence.size() );
+        for( size_t i = 0; i < _sequence.size(); i++ ){
+            files.push_back( _sequence[ i ].leftFile );
+            files.push_back( _sequence[ i ].rightFile );
+        }
+
+        // the current frame is already loaded
+        _prefetcher = new ImagePrefetcher( files, 2, ahead, numThreads );
+        _prefetcher->seek( _iter + 1 );
     }
 
 
@@ -122,6 +140,8 @@ namespace cvt {
         if( pos < _sequence.size() ) {
             _iter = pos;
             _curSample = &_sequence[ _iter ];
+            if( _prefetcher )
+                _prefetcher->seek( _iter );
             loadImages();
         }
     }
@@ -153,8 +173,12 @@ namespace cvt {
 
     void KittiVOParser::loadImages()
     {
-        _left.load( _curSample->leftFile );
-        _right.load( _curSample->rightFile );
+        if( _prefetcher ){
+            _prefetcher->next( _left, _right );
+        } else {
+            _left.load( _curSample->leftFile );
+            _right.load( _curSample->rightFile );
+        }
     }
 
     void KittiVOParser::loadImageNames( std::vector<cvt::String>& names, const cvt::String& folder )
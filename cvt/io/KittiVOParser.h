@@ -30,6 +30,7 @@
 #include <cvt/math/Matrix.h>
 #include <cvt/gfx/Image.h>
 #include <cvt/io/StereoInput.h>
+#include <cvt/io/ImagePrefetcher.h>
 
 namespace cvt {
 
@@ -55,7 +56,17 @@ namespace cvt {
 
             void            seek( size_t pos );
 
+            /**
+             * @brief decode the next frames in background threads
+             * @param ahead         number of frames decoded ahead of the current one
+             * @param numThreads    number of decoder threads
+             */
+            void            enablePrefetching( size_t ahead = 4, size_t numThreads = 2 );
+
         private:
+            KittiVOParser( const KittiVOParser& );
+            KittiVOParser& operator=( const KittiVOParser& );
+
             struct Sample {
                 double          timestamp;
                 cvt::String     leftFile;
@@ -74,6 +85,7 @@ namespace cvt {
             Image                   _left;
             Image                   _right;
             Sample*                 _curSample;
+            ImagePrefetcher*        _prefetcher;
 
             void checkFileExistence( const cvt::String& file );
             void loadImageNames( std::vector<cvt::String>& names, const cvt::String& folder );
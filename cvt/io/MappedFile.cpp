@@ -0,0 +1,79 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/io/MappedFile.h>
+#include <cvt/util/Exception.h>
+
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace cvt {
+
+	MappedFile::MappedFile( const String& path ) :
+		_path( path ),
+		_data( NULL ),
+		_size( 0 )
+	{
+		int fd = open( path.c_str(), O_RDONLY );
+		if( fd < 0 ) {
+			String msg( "Could not open file " );
+			msg += path + ": " + strerror( errno );
+			throw CVTException( msg.c_str() );
+		}
+
+		struct stat info;
+		if( fstat( fd, &info ) < 0 ) {
+			String msg( "fstat error: " );
+			msg += strerror( errno );
+			close( fd );
+			throw CVTException( msg.c_str() );
+		}
+
+		_size = info.st_size;
+		if( _size ) {
+			void* map = mmap( 0, _size, PROT_READ, MAP_SHARED, fd, 0 );
+			if( map == MAP_FAILED ) {
+				String msg( "Could not map file " );
+				msg += path + ": " + strerror( errno );
+				close( fd );
+				throw CVTException( msg.c_str() );
+			}
+			_data = ( const uint8_t* ) map;
+		}
+
+		/* the mapping stays valid after closing the descriptor */
+		close( fd );
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if( _data )
+			munmap( ( void* ) _data, _size );
+	}
+
+}
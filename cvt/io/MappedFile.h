@@ -0,0 +1,61 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_MAPPEDFILE_H
+#define CVT_MAPPEDFILE_H
+
+#include <cvt/util/String.h>
+#include <stdint.h>
+#include <stddef.h>
+
+namespace cvt {
+
+	/**
+	  @brief Read-only memory mapping of a whole file
+
+	  The pages are shared with the page cache, so processes mapping the same file share one copy.
+	  Errors throw a CVTException.
+	 */
+	class MappedFile
+	{
+		public:
+			MappedFile( const String& path );
+			~MappedFile();
+
+			const uint8_t* data() const { return _data; }
+			size_t		   size() const { return _size; }
+			const String&  path() const { return _path; }
+
+		private:
+			MappedFile( const MappedFile& );
+			MappedFile& operator=( const MappedFile& );
+
+			String		   _path;
+			const uint8_t* _data;
+			size_t		   _size;
+	};
+
+}
+
+#endif
@@ -0,0 +1,85 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/io/MappedFile.h>
+#include <cvt/util/Exception.h>
+#include <cvt/util/CVTTest.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace cvt;
+
+static bool _throws( const String& path )
+{
+    try {
+        MappedFile file( path );
+    } catch( const Exception& ) {
+        return true;
+    }
+    return false;
+}
+
+BEGIN_CVTTEST( MappedFile )
+    bool result = true;
+    bool b;
+
+    char path[] = "/tmp/cvtmappedXXXXXX";
+    int fd = mkstemp( path );
+    if( fd < 0 )
+        return false;
+
+    {
+        MappedFile empty( path );
+        b = empty.size() == 0 && empty.data() == NULL && empty.path() == path;
+    }
+    CVTTEST_PRINT( "empty file", b );
+    result &= b;
+
+    char content[ 10000 ];
+    for( size_t i = 0; i < sizeof( content ); i++ )
+        content[ i ] = ( char ) ( i * 7 );
+    b = write( fd, content, sizeof( content ) ) == ( ssize_t ) sizeof( content );
+    close( fd );
+    if( b ) {
+        MappedFile file( path );
+        b = file.size() == sizeof( content ) && file.data() != NULL &&
+            memcmp( file.data(), content, sizeof( content ) ) == 0;
+    }
+    CVTTEST_PRINT( "open", b );
+    result &= b;
+
+    unlink( path );
+    b = _throws( path );
+    CVTTEST_PRINT( "missing file", b );
+    result &= b;
+
+    b = _throws( "/tmp" );
+    CVTTEST_PRINT( "directory", b );
+    result &= b;
+
+    return result;
+END_CVTTEST
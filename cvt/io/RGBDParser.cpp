@@ -31,7 +31,8 @@ namespace cvt
     RGBDParser::RGBDParser( const String& folder, double maxStampDiff ) :
         _maxStampDiff( maxStampDiff ), // this is 50ms
         _folder( folder ),
-        _idx( 0 )
+        _idx( 0 ),
+        _prefetcher( 0 )
     {
         if( _folder[ _folder.length() - 1 ] != '/' )
             _folder += "/";
@@ -64,18 +65,49 @@ namespace cvt
         sortOutData( rgbStamps, depthStamps, associated );
     }
 
+    RGBDParser::~RGBDParser()
+    {
+        delete _prefetcher;
+    }
+
+    void RGBDParser::enablePrefetching( size_t ahead, size_t numThreads )
+    {
+        delete _prefetcher;
+
+        std::vector<String> files;
+        files.reserve( 2 * _rgbFiles.size() );
+        for( size_t i = 0; i < _rgbFiles.size(); i++ ){
+            files.push_back( _rgbFiles[ i ] );
+            files.push_back( _depthFiles[ i ] );
+        }
+        _prefetcher = new ImagePrefetcher( files, 2, ahead, numThreads );
+        _prefetcher->seek( _idx );
+    }
+
+    void RGBDParser::setIdx( size_t idx )
+    {
+        _idx = idx;
+        if( _prefetcher )
+            _prefetcher->seek( idx );
+    }
+
     void RGBDParser::next()
     {
         if( _idx >= _stamps.size() ){
             return;
         }
-        _sample.stamp	= _stamps[ _idx ];
-        _sample.rgb.load( _rgbFiles[ _idx ] );
-        _sample.depth.load( _depthFiles[ _idx ] );
-        _sample.orientation = _orientations[ _idx ];
-        _sample.position = _positions[ _idx ];
-        _sample.poseValid = _poseValid[ _idx ];
-        _idx++;
+        /* advance first, the prefetcher has moved on if loading the frame throws */
+        size_t idx = _idx++;
+        _sample.stamp	= _stamps[ idx ];
+        if( _prefetcher ){
+            _prefetcher->next( _sample.rgb, _sample.depth );
+        } else {
+            _sample.rgb.load( _rgbFiles[ idx ] );
+            _sample.depth.load( _depthFiles[ idx ] );
+        }
+        _sample.orientation = _orientations[ idx ];
+        _sample.position = _positions[ idx ];
+        _sample.poseValid = _poseValid[ idx ];
     }
 
     void RGBDParser::loadGroundTruth()
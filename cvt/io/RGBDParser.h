@@ -30,6 +30,7 @@
 #include <cvt/util/DataIterator.h>
 #include <cvt/io/FileSystem.h>
 #include <cvt/io/RGBDInput.h>
+#include <cvt/io/ImagePrefetcher.h>
 #include <cvt/gfx/Image.h>
 #include <cvt/math/Matrix.h>
 
@@ -64,9 +65,17 @@ namespace cvt
             };
 
             RGBDParser( const String& folder, double maxStampDiff = 0.05 );
+            ~RGBDParser();
 
             void next();
 
+            /**
+             * @brief decode the next frames in background threads
+             * @param ahead         number of frames decoded ahead of the current one
+             * @param numThreads    number of decoder threads
+             */
+            void enablePrefetching( size_t ahead = 4, size_t numThreads = 2 );
+
             size_t              iter()    const { return _idx; }
             size_t              size()    const { return _stamps.size(); }
             bool                hasNext() const { return _idx < _stamps.size(); }
@@ -78,11 +87,14 @@ namespace cvt
             double              stamp() const { return _sample.stamp; }
 
             const RGBDSample&   data()  const { return _sample; }
-            void                setIdx( size_t idx ) { _idx = idx; }
+            void                setIdx( size_t idx );
             const String&       rgbFile( size_t idx ) const { return _rgbFiles[ idx ]; }
             const String&       depthFile( size_t idx ) const { return _depthFiles[ idx ]; }
 
         private:
+            RGBDParser( const RGBDParser& );
+            RGBDParser& operator=( const RGBDParser& );
+
             const double             _maxStampDiff;
             String                   _folder;
 
@@ -95,6 +107,7 @@ namespace cvt
 
             RGBDSample              _sample;
             size_t                  _idx;
+            ImagePrefetcher*        _prefetcher;
 
 
             void loadGroundTruth();
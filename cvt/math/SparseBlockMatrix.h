@@ -25,87 +25,276 @@
 #ifndef CVT_SPARSE_BLOCK_MATRIX_H
 #define CVT_SPARSE_BLOCK_MATRIX_H
 
+#include <Eigen/Core>
+#include <Eigen/StdVector>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+
 namespace cvt
 {
+	/**
+	  @brief Sparse matrix of fixed size blocks
+
+	  The blocks are stored contiguously in insertion order and are located via an
+	  open-addressing hash table of the block coordinates, so memory scales with the number of
+	  non-zero blocks and not with the number of block rows times block columns.
+	  A compressed row and column index is rebuilt lazily for the block-row and block-column
+	  iteration after blocks have been inserted. The rebuild is not thread-safe, call
+	  updateIndex() before iterating from multiple threads.
+	 */
 	template<size_t bRows, size_t bCols>
 	class SparseBlockMatrix
 	{
 		public:
 			typedef typename Eigen::Matrix<double, bRows, bCols> BlockMatType;
-			
+
+			struct Entry {
+				size_t index;	/* column for row iteration, row for column iteration */
+				size_t block;	/* index of the block in the block storage */
+			};
+			typedef typename std::vector<Entry>::const_iterator ConstEntryIterator;
+
 			SparseBlockMatrix();
 			~SparseBlockMatrix();
 
-
+			/* removes all blocks */
 			void resize( size_t numRowBlocks, size_t numColBlocks );
+			void reserve( size_t numBlocks );
+			void clear();
 
 			bool containsBlock( size_t row, size_t col ) const;
 
-			BlockMatType&	block( size_t row, size_t col );
+			/* returns the block, a zero block is inserted if not present */
+			BlockMatType&		block( size_t row, size_t col );
+			/* the block has to be present */
+			const BlockMatType& block( size_t row, size_t col ) const;
+
+			BlockMatType&		blockAt( size_t idx )		{ return _blocks[ idx ]; }
+			const BlockMatType& blockAt( size_t idx ) const { return _blocks[ idx ]; }
 
 			size_t			numBlockRows() const { return _numRows; }
 			size_t			numBlockCols() const { return _numCols; }
+			size_t			numBlocks() const { return _blocks.size(); }
+
+			/* iterate the blocks of a block row ordered by column */
+			ConstEntryIterator rowBegin( size_t row ) const;
+			ConstEntryIterator rowEnd( size_t row ) const;
+
+			/* iterate the blocks of a block column ordered by row */
+			ConstEntryIterator colBegin( size_t col ) const;
+			ConstEntryIterator colEnd( size_t col ) const;
+
+			void updateIndex() const;
 
 		private:
-			int*	_filled;
+			SparseBlockMatrix( const SparseBlockMatrix& );
+			SparseBlockMatrix& operator=( const SparseBlockMatrix& );
+
+			static const uint64_t EMPTY = ~( uint64_t ) 0;
+
+			uint64_t	key( size_t row, size_t col ) const { return ( uint64_t ) row * _numCols + col; }
+			size_t		slot( uint64_t key ) const;
+			void		rehash( size_t capacity );
+
 			size_t	_numRows;
 			size_t	_numCols;
+
+			/* hash table: block coordinate key -> block index */
+			std::vector<uint64_t>	_keys;
+			std::vector<size_t>		_slots;
+			size_t					_mask;
+
 			std::vector<BlockMatType, Eigen::aligned_allocator<BlockMatType> >	_blocks;
+			std::vector<uint64_t>	_blockKeys;
+
+			/* compressed row and column index */
+			mutable bool				_indexValid;
+			mutable std::vector<size_t> _rowStart;
+			mutable std::vector<Entry>	_rowEntries;
+			mutable std::vector<size_t> _colStart;
+			mutable std::vector<Entry>	_colEntries;
 	};
 
+	template <size_t bRows, size_t bCols>
+	const uint64_t SparseBlockMatrix<bRows, bCols>::EMPTY;
+
 	template <size_t bRows, size_t bCols>
 	inline SparseBlockMatrix<bRows, bCols>::SparseBlockMatrix() :
-		_filled( 0 ),
 		_numRows( 0 ),
-		_numCols( 0 )
+		_numCols( 0 ),
+		_mask( 0 ),
+		_indexValid( false )
 	{
+		rehash( 16 );
 	}
-	
+
+	template <size_t bRows, size_t bCols>
+	inline SparseBlockMatrix<bRows, bCols>::~SparseBlockMatrix()
+	{
+	}
+
+	template <size_t bRows, size_t bCols>
+	inline size_t SparseBlockMatrix<bRows, bCols>::slot( uint64_t k ) const
+	{
+		/* fibonacci hashing and linear probing */
+		size_t i = ( size_t ) ( ( k * 0x9e3779b97f4a7c15ULL ) >> 32 ) & _mask;
+		while( _keys[ i ] != EMPTY && _keys[ i ] != k )
+			i = ( i + 1 ) & _mask;
+		return i;
+	}
+
 	template <size_t bRows, size_t bCols>
-	inline SparseBlockMatrix<bRows, bCols>::~SparseBlockMatrix() 
+	inline void SparseBlockMatrix<bRows, bCols>::rehash( size_t capacity )
 	{
-		if( _filled ){
-			delete[] _filled;
+		size_t n = 16;
+		while( n < capacity )
+			n <<= 1;
+
+		_keys.assign( n, EMPTY );
+		_slots.resize( n );
+		_mask = n - 1;
+		for( size_t b = 0; b < _blockKeys.size(); b++ ) {
+			size_t i = slot( _blockKeys[ b ] );
+			_keys[ i ]	= _blockKeys[ b ];
+			_slots[ i ] = b;
 		}
 	}
 
 	template <size_t bRows, size_t bCols>
 	inline bool SparseBlockMatrix<bRows, bCols>::containsBlock( size_t row, size_t col ) const
 	{
-		return _filled[ row * _numCols + col ] != -1;
+		return _keys[ slot( key( row, col ) ) ] != EMPTY;
 	}
 
 	template <size_t bRows, size_t bCols>
-	inline Eigen::Matrix<double, bRows, bCols>& SparseBlockMatrix<bRows, bCols>::block( size_t r, size_t c )
+	inline typename SparseBlockMatrix<bRows, bCols>::BlockMatType& SparseBlockMatrix<bRows, bCols>::block( size_t r, size_t c )
 	{
-		int* a = _filled + ( r * _numCols + c );
+		uint64_t k = key( r, c );
+		size_t i = slot( k );
 
-		if( *a == -1 ){
-			*a = _blocks.size();
+		if( _keys[ i ] == EMPTY ){
+			/* keep the load factor below 0.5 */
+			if( 2 * ( _blocks.size() + 1 ) > _keys.size() ) {
+				rehash( 2 * _keys.size() );
+				i = slot( k );
+			}
+			_keys[ i ]	= k;
+			_slots[ i ] = _blocks.size();
 			_blocks.push_back( BlockMatType() );
 			_blocks.back().setZero();
+			_blockKeys.push_back( k );
+			_indexValid = false;
 		}
 
-		return _blocks[ *a ];
+		return _blocks[ _slots[ i ] ];
+	}
+
+	template <size_t bRows, size_t bCols>
+	inline const typename SparseBlockMatrix<bRows, bCols>::BlockMatType& SparseBlockMatrix<bRows, bCols>::block( size_t r, size_t c ) const
+	{
+		return _blocks[ _slots[ slot( key( r, c ) ) ] ];
 	}
-	
+
 	template <size_t bRows, size_t bCols>
-	inline void SparseBlockMatrix<bRows, bCols>::resize( size_t rows, size_t cols ) 	
+	inline void SparseBlockMatrix<bRows, bCols>::resize( size_t rows, size_t cols )
 	{
-		if( _numRows == rows && _numCols == cols ) {
-			_blocks.clear();
-			size_t n = _numRows * _numCols;
-			memset( _filled, -1, sizeof( int ) * n );
+		_numRows = rows;
+		_numCols = cols;
+		clear();
+	}
+
+	template <size_t bRows, size_t bCols>
+	inline void SparseBlockMatrix<bRows, bCols>::reserve( size_t numBlocks )
+	{
+		_blocks.reserve( numBlocks );
+		_blockKeys.reserve( numBlocks );
+		if( 2 * numBlocks > _keys.size() )
+			rehash( 2 * numBlocks );
+	}
+
+	template <size_t bRows, size_t bCols>
+	inline void SparseBlockMatrix<bRows, bCols>::clear()
+	{
+		_blocks.clear();
+		_blockKeys.clear();
+		_keys.assign( _keys.size(), EMPTY );
+		_indexValid = false;
+	}
+
+	template <size_t bRows, size_t bCols>
+	inline void SparseBlockMatrix<bRows, bCols>::updateIndex() const
+	{
+		if( _indexValid )
 			return;
-		} else {
-			delete[] _filled;
-			_numRows = rows; 
-			_numCols = cols;
-			size_t n = _numRows * _numCols;
-			_filled = new int[ n ];
-			memset( _filled, -1, sizeof( int ) * n );
-			_blocks.clear();
+
+		/* counting sort of the blocks by row and by column */
+		_rowStart.assign( _numRows + 1, 0 );
+		_colStart.assign( _numCols + 1, 0 );
+		for( size_t b = 0; b < _blockKeys.size(); b++ ) {
+			_rowStart[ _blockKeys[ b ] / _numCols + 1 ]++;
+			_colStart[ _blockKeys[ b ] % _numCols + 1 ]++;
+		}
+		for( size_t r = 0; r < _numRows; r++ )
+			_rowStart[ r + 1 ] += _rowStart[ r ];
+		for( size_t c = 0; c < _numCols; c++ )
+			_colStart[ c + 1 ] += _colStart[ c ];
+
+		std::vector<size_t> rowPos( _rowStart.begin(), _rowStart.end() - 1 );
+		std::vector<size_t> colPos( _colStart.begin(), _colStart.end() - 1 );
+		_rowEntries.resize( _blockKeys.size() );
+		_colEntries.resize( _blockKeys.size() );
+
+		/* bucket by row, then distribute the rows in order to the columns and the columns in order
+		   back to the rows, this leaves both indices sorted */
+		std::vector<size_t> byRow( _blockKeys.size() );
+		for( size_t b = 0; b < _blockKeys.size(); b++ )
+			byRow[ rowPos[ _blockKeys[ b ] / _numCols ]++ ] = b;
+
+		for( size_t i = 0; i < byRow.size(); i++ ) {
+			uint64_t k = _blockKeys[ byRow[ i ] ];
+			Entry& e = _colEntries[ colPos[ k % _numCols ]++ ];
+			e.index = k / _numCols;
+			e.block = byRow[ i ];
+		}
+
+		std::copy( _rowStart.begin(), _rowStart.end() - 1, rowPos.begin() );
+		for( size_t c = 0; c < _numCols; c++ ) {
+			for( size_t i = _colStart[ c ]; i < _colStart[ c + 1 ]; i++ ) {
+				Entry& e = _rowEntries[ rowPos[ _colEntries[ i ].index ]++ ];
+				e.index = c;
+				e.block = _colEntries[ i ].block;
+			}
 		}
+		_indexValid = true;
+	}
+
+	template <size_t bRows, size_t bCols>
+	inline typename SparseBlockMatrix<bRows, bCols>::ConstEntryIterator SparseBlockMatrix<bRows, bCols>::rowBegin( size_t row ) const
+	{
+		updateIndex();
+		return _rowEntries.begin() + _rowStart[ row ];
+	}
+
+	template <size_t bRows, size_t bCols>
+	inline typename SparseBlockMatrix<bRows, bCols>::ConstEntryIterator SparseBlockMatrix<bRows, bCols>::rowEnd( size_t row ) const
+	{
+		updateIndex();
+		return _rowEntries.begin() + _rowStart[ row + 1 ];
+	}
+
+	template <size_t bRows, size_t bCols>
+	inline typename SparseBlockMatrix<bRows, bCols>::ConstEntryIterator SparseBlockMatrix<bRows, bCols>::colBegin( size_t col ) const
+	{
+		updateIndex();
+		return _colEntries.begin() + _colStart[ col ];
+	}
+
+	template <size_t bRows, size_t bCols>
+	inline typename SparseBlockMatrix<bRows, bCols>::ConstEntryIterator SparseBlockMatrix<bRows, bCols>::colEnd( size_t col ) const
+	{
+		updateIndex();
+		return _colEntries.begin() + _colStart[ col + 1 ];
 	}
 }
 
@@ -0,0 +1,101 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/util/CVTTest.h>
+#include <cvt/math/SparseBlockMatrix.h>
+#include <cvt/math/Math.h>
+
+#include <map>
+
+namespace cvt {
+
+	typedef SparseBlockMatrix<2, 3> TestMatrix;
+
+	static bool checkIteration( const TestMatrix & m, const std::map<std::pair<size_t, size_t>, double> & ref )
+	{
+		size_t n = 0;
+		for( size_t r = 0; r < m.numBlockRows(); r++ ){
+			size_t last = 0;
+			for( TestMatrix::ConstEntryIterator it = m.rowBegin( r ); it != m.rowEnd( r ); ++it, n++ ){
+				if( it != m.rowBegin( r ) && it->index <= last )
+					return false;
+				last = it->index;
+				std::map<std::pair<size_t, size_t>, double>::const_iterator rit = ref.find( std::make_pair( r, it->index ) );
+				if( rit == ref.end() || m.blockAt( it->block )( 1, 2 ) != rit->second )
+					return false;
+			}
+		}
+		if( n != ref.size() )
+			return false;
+
+		n = 0;
+		for( size_t c = 0; c < m.numBlockCols(); c++ ){
+			size_t last = 0;
+			for( TestMatrix::ConstEntryIterator it = m.colBegin( c ); it != m.colEnd( c ); ++it, n++ ){
+				if( it != m.colBegin( c ) && it->index <= last )
+					return false;
+				last = it->index;
+				if( &m.blockAt( it->block ) != &m.block( it->index, c ) )
+					return false;
+			}
+		}
+		return n == ref.size();
+	}
+
+BEGIN_CVTTEST( SparseBlockMatrix )
+	bool ret = true;
+	bool b;
+
+	TestMatrix m;
+	m.resize( 50, 20000 );
+
+	b = !m.containsBlock( 3, 7 ) && m.numBlocks() == 0;
+	m.block( 3, 7 )( 1, 2 ) = 5.0;
+	b &= m.containsBlock( 3, 7 ) && !m.containsBlock( 7, 3 ) && m.numBlocks() == 1;
+	b &= m.block( 3, 7 ).sum() == 5.0;
+	CVTTEST_PRINT( "block()", b );
+	ret &= b;
+
+	std::map<std::pair<size_t, size_t>, double> ref;
+	ref[ std::make_pair( 3, 7 ) ] = 5.0;
+	for( size_t i = 0; i < 10000; i++ ){
+		size_t r = Math::rand( 0, 50 );
+		size_t c = Math::rand( 0, 20000 );
+		double v = Math::rand( -1.0, 1.0 );
+		m.block( r, c )( 1, 2 ) = v;
+		ref[ std::make_pair( r, c ) ] = v;
+	}
+	b = m.numBlocks() == ref.size() && checkIteration( m, ref );
+	CVTTEST_PRINT( "row/column iteration", b );
+	ret &= b;
+
+	m.resize( 50, 20000 );
+	b = m.numBlocks() == 0 && !m.containsBlock( 3, 7 ) && m.rowBegin( 3 ) == m.rowEnd( 3 );
+	CVTTEST_PRINT( "resize()", b );
+	ret &= b;
+
+	return ret;
+END_CVTTEST
+
+}
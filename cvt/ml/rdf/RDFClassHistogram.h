@@ -42,6 +42,7 @@ namespace cvt {
 
 			RDFClassHistogram<N>& operator=( const RDFClassHistogram<N>& other );
 			RDFClassHistogram<N>& operator+=( const RDFClassHistogram<N>& other );
+			RDFClassHistogram<N>& operator-=( const RDFClassHistogram<N>& other );
 
 			float				  probability( size_t ) const;
 			float				  entropy() const;
@@ -98,6 +99,15 @@ namespace cvt {
 		return *this;
 	}
 
+	template<size_t N>
+	inline RDFClassHistogram<N>& RDFClassHistogram<N>::operator-=( const RDFClassHistogram<N>& other )
+	{
+		_numSamples -= other._numSamples;
+		for( size_t i = 0; i < N; i++ )
+			_bin [ i ] -= other._bin[ i ];
+		return *this;
+	}
+
 	template<size_t N>
 	inline size_t RDFClassHistogram<N>::sampleCount() const
 	{
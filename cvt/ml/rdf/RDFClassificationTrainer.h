@@ -26,19 +26,34 @@
 #define CVT_RDFORESTTRAINERCLASSIFICATION_H
 
 #include <vector>
+#include <algorithm>
 #include <cvt/ml/rdf/RDFNode.h>
 #include <cvt/ml/rdf/RDFTest.h>
 #include <cvt/ml/rdf/RDFClassHistogram.h>
 #include <cvt/ml/rdf/RDFClassificationTree.h>
+#include <cvt/ml/rdf/RDFClassifier.h>
+#include <cvt/util/ThreadPool.h>
 
 namespace cvt {
 
+	/**
+	  @brief Trainer for classification trees
+
+	  The trees are grown breadth-first, all nodes of one depth of all trees trained together are
+	  split in one step. Every tree keeps a single array of sample indices, the samples of a node
+	  are a contiguous range of it, which is partitioned in place when the node is split.
+	  The random candidate tests are drawn on the calling thread and scored on the ThreadPool,
+	  nodes with many samples are scored in chunks with one histogram per chunk and candidate.
+
+	  classLabel(), trainingData() and the operator() of the tests are called concurrently from
+	  multiple threads, randomTest() and dataSize() only from the calling thread.
+	 */
 	template<typename DATA, typename DATACOLLECTION, size_t N>
 	class RDFClassificationTrainer
 	{
 		public:
 			RDFClassificationTrainer();
-			~RDFClassificationTrainer();
+			virtual ~RDFClassificationTrainer();
 
 			size_t				   classCount() const { return N; }
 			virtual size_t		   dataSize( const DATACOLLECTION& data ) = 0;
@@ -47,13 +62,44 @@ namespace cvt {
 			virtual DATA&		   trainingData( const DATACOLLECTION& data, size_t index ) = 0;
 
 			RDFClassificationTree<DATA,N>* train( const DATACOLLECTION& data, size_t maxdepth, size_t randTries );
+			/* train numTrees trees concurrently and add them to the classifier */
+			void						   train( RDFClassifier<DATA,N>& classifier, const DATACOLLECTION& data, size_t numTrees, size_t maxdepth, size_t randTries );
 
 		private:
-			RDFNode<DATA,RDFClassHistogram<N> >* trainRecursive( const DATACOLLECTION& data, const RDFClassHistogram<N>& hist, std::vector<size_t>& indices, size_t level, size_t randTries );
+			struct TrainNode {
+				RDFClassHistogram<N> hist;
+				size_t				 tree;
+				/* range of the samples in the index array of the tree */
+				size_t				 begin;
+				size_t				 end;
+				/* NULL for leaves */
+				RDFTest<DATA>*		 test;
+				size_t				 left;
+				size_t				 right;
+			};
+
+			/* scoring of the samples [ begin, end ) of the candidates of a node */
+			struct ScoreTask {
+				size_t node;
+				size_t begin;
+				size_t end;
+				/* first partial histogram of the chunk, NOSLOT if the task covers the whole node */
+				size_t slot;
+			};
+
+			static const size_t NOSLOT = ~( size_t ) 0;
+
+			void trainTrees( std::vector<RDFClassificationTree<DATA,N>*>& trees, const DATACOLLECTION& data, size_t numTrees, size_t maxdepth, size_t randTries );
+			void splitNodes( std::vector<TrainNode>& nodes, size_t nbegin, size_t nend, std::vector<std::vector<size_t> >& indices, const DATACOLLECTION& data, size_t randTries );
+			void score( RDFClassHistogram<N>* right, RDFTest<DATA>* const* tests, size_t numTests, const size_t* indices, size_t n, const DATACOLLECTION& data );
+			static size_t selectBest( const RDFClassHistogram<N>& parent, const RDFClassHistogram<N>* right, size_t numTests );
 
 			static float IG( const RDFClassHistogram<N>& parent, const RDFClassHistogram<N>& left, const RDFClassHistogram<N>& right );
 	};
 
+	template<typename DATA, typename DATACOLLECTION, size_t N>
+	const size_t RDFClassificationTrainer<DATA,DATACOLLECTION,N>::NOSLOT;
+
 	template<typename DATA, typename DATACOLLECTION, size_t N>
 	inline RDFClassificationTrainer<DATA,DATACOLLECTION,N>::RDFClassificationTrainer()
 	{
@@ -79,130 +125,235 @@ namespace cvt {
 	}
 
 	template<typename DATA, typename DATACOLLECTION, size_t N>
-	inline RDFClassificationTree<DATA,N>* RDFClassificationTrainer<DATA,DATACOLLECTION,N>::train( const DATACOLLECTION& data, size_t level, size_t randTries )
+	inline RDFClassificationTree<DATA,N>* RDFClassificationTrainer<DATA,DATACOLLECTION,N>::train( const DATACOLLECTION& data, size_t maxdepth, size_t randTries )
 	{
-		RDFTest<DATA>* best = NULL;
-		RDFNode<DATA,RDFClassHistogram<N> >* left;
-		RDFNode<DATA,RDFClassHistogram<N> >* right;
-		float IGmax = 0.0f;
-		RDFClassHistogram<N> histparent, histleft, histright;
-		RDFClassHistogram<N> histbestleft, histbestright;
+		std::vector<RDFClassificationTree<DATA,N>*> trees;
+		trainTrees( trees, data, 1, maxdepth, randTries );
+		return trees[ 0 ];
+	}
+
+	template<typename DATA, typename DATACOLLECTION, size_t N>
+	inline void RDFClassificationTrainer<DATA,DATACOLLECTION,N>::train( RDFClassifier<DATA,N>& classifier, const DATACOLLECTION& data, size_t numTrees, size_t maxdepth, size_t randTries )
+	{
+		std::vector<RDFClassificationTree<DATA,N>*> trees;
+		trainTrees( trees, data, numTrees, maxdepth, randTries );
+		for( size_t t = 0; t < trees.size(); t++ )
+			classifier.addTree( trees[ t ] );
+	}
+
+	template<typename DATA, typename DATACOLLECTION, size_t N>
+	inline void RDFClassificationTrainer<DATA,DATACOLLECTION,N>::trainTrees( std::vector<RDFClassificationTree<DATA,N>*>& trees, const DATACOLLECTION& data, size_t numTrees, size_t maxdepth, size_t randTries )
+	{
+		typedef RDFNode<DATA,RDFClassHistogram<N> > NodeType;
+		/* bound for the number of candidate tests alive at once */
+		const size_t maxCandidates = 1 << 16;
 
-		// get histogram for the root
 		const size_t size = dataSize( data );
+		std::vector<std::vector<size_t> > indices( numTrees );
+		std::vector<TrainNode> nodes;
+
+		TrainNode root;
+		root.begin = 0;
+		root.end   = size;
+		root.test  = NULL;
 		for( size_t i = 0; i < size; i++ ) {
-			histparent.addSample( classLabel( data, i ) );
+			root.hist.addSample( classLabel( data, i ) );
 		}
 
-		for( size_t t = 0; t < randTries; t++ ) {
-			// new random test
-			RDFTest<DATA>* test = randomTest();
-			histright.clear();
-			histleft.clear();
-
-			for( size_t i = 0; i < size; i++ ) {
-				if( test->operator()( trainingData( data, i ) ) ) {
-					histright.addSample( classLabel( data, i ) );
-				} else {
-					histleft.addSample( classLabel( data, i ) );
-				}
-			}
+		for( size_t t = 0; t < numTrees; t++ ) {
+			indices[ t ].resize( size );
+			for( size_t i = 0; i < size; i++ )
+				indices[ t ][ i ] = i;
+			root.tree = t;
+			nodes.push_back( root );
+		}
 
-			// how good is the information gain
-			// keep the best otherwise die like the rest
-			float ig = IG( histparent, histleft, histright);
-			if( ig > IGmax ) {
-				IGmax = ig;
-				if( best )
-					delete best;
-				best = test;
-				histbestleft = histleft;
-				histbestright = histright;
-				std::cout << ( 100.0f * ( float ) t / ( float ) randTries) << " \%  IG:" << IGmax << std::endl;
-			} else {
-				delete test;
-			}
+		/* the children of the nodes [ levelBegin, levelEnd ) are appended to nodes */
+		size_t levelBegin = 0;
+		const size_t batch = Math::max<size_t>( 1, maxCandidates / Math::max<size_t>( randTries, 1 ) );
+		for( size_t depth = 0; depth < maxdepth && levelBegin < nodes.size(); depth++ ) {
+			size_t levelEnd = nodes.size();
+			for( size_t n = levelBegin; n < levelEnd; n += batch )
+				splitNodes( nodes, n, Math::min( n + batch, levelEnd ), indices, data, randTries );
+			levelBegin = levelEnd;
 		}
 
-		// split the data into two sets containing the indices
-		std::vector<size_t> leftindices, rightindices;
-		for( size_t i = 0; i < size; i++ ) {
-			if( best->operator()( trainingData( data, i ) ) ) {
-				rightindices.push_back( i );
-			} else {
-				leftindices.push_back( i );
-			}
+		/* children are always stored after their parent */
+		std::vector<NodeType*> rdfnodes( nodes.size() );
+		for( size_t n = nodes.size(); n--; ) {
+			const TrainNode& node = nodes[ n ];
+			if( node.test )
+				rdfnodes[ n ] = new NodeType( NULL, node.test, rdfnodes[ node.left ], rdfnodes[ node.right ] );
+			else
+				rdfnodes[ n ] = new NodeType( new RDFClassHistogram<N>( node.hist ), NULL, NULL, NULL );
 		}
 
-		left  = trainRecursive( data, histbestleft, leftindices, level - 1, randTries );
-		right = trainRecursive( data, histbestright, rightindices, level - 1, randTries );
-		return new RDFClassificationTree<DATA,N>( new RDFNode<DATA,RDFClassHistogram<N> >( NULL, best, left, right ) );
+		for( size_t t = 0; t < numTrees; t++ )
+			trees.push_back( new RDFClassificationTree<DATA,N>( rdfnodes[ t ] ) );
 	}
 
 	template<typename DATA, typename DATACOLLECTION, size_t N>
-	inline RDFNode<DATA,RDFClassHistogram<N> >* RDFClassificationTrainer<DATA,DATACOLLECTION,N>::trainRecursive( const DATACOLLECTION& data, const RDFClassHistogram<N>& hist, std::vector<size_t>& indices, size_t level, size_t randTries )
+	inline void RDFClassificationTrainer<DATA,DATACOLLECTION,N>::splitNodes( std::vector<TrainNode>& nodes, size_t nbegin, size_t nend, std::vector<std::vector<size_t> >& indices, const DATACOLLECTION& data, size_t randTries )
 	{
-		RDFTest<DATA>* best = NULL;
-		RDFNode<DATA,RDFClassHistogram<N> >* left;
-		RDFNode<DATA,RDFClassHistogram<N> >* right;
-		float IGmax = 0.0f;
-		RDFClassHistogram<N> histparent, histleft, histright;
-		RDFClassHistogram<N> histbestleft, histbestright;
-
-		if( !level ) {
-			return new RDFNode<DATA,RDFClassHistogram<N> >( new RDFClassHistogram<N>( hist ), NULL, NULL, NULL );
+		/* samples scored by one task */
+		const size_t chunkSize = 8192;
+
+		/* pure nodes stay leaves */
+		std::vector<size_t> active;
+		for( size_t n = nbegin; n < nend; n++ ) {
+			if( nodes[ n ].hist.sampleCount() > 1 && nodes[ n ].hist.entropy() > 0.0f )
+				active.push_back( n );
+		}
+		if( active.empty() || !randTries )
+			return;
+
+		std::vector<RDFTest<DATA>*> tests( active.size() * randTries );
+		for( size_t i = 0; i < tests.size(); i++ )
+			tests[ i ] = randomTest();
+
+		std::vector<ScoreTask> tasks;
+		size_t numSlots = 0;
+		for( size_t a = 0; a < active.size(); a++ ) {
+			const TrainNode& node = nodes[ active[ a ] ];
+			ScoreTask task;
+			task.node = a;
+			if( node.end - node.begin <= chunkSize ) {
+				task.begin = node.begin;
+				task.end   = node.end;
+				task.slot  = NOSLOT;
+				tasks.push_back( task );
+			} else {
+				for( size_t i = node.begin; i < node.end; i += chunkSize ) {
+					task.begin = i;
+					task.end   = Math::min( i + chunkSize, node.end );
+					task.slot  = numSlots;
+					tasks.push_back( task );
+					numSlots += randTries;
+				}
+			}
 		}
 
-		const size_t size = indices.size();
-		for( size_t t = 0; t < randTries; t++ ) {
-			// new random test
-			RDFTest<DATA>* test = randomTest();
-			histright.clear();
-			histleft.clear();
-
-			for( size_t i = 0; i < size; i++ ) {
-				size_t idx = indices[ i ];
-				if( test->operator()( trainingData( data, idx ) ) ) {
-					histright.addSample( classLabel( data, idx ) );
+		std::vector<RDFClassHistogram<N> > partial( numSlots );
+		std::vector<size_t> best( active.size(), NOSLOT );
+		std::vector<RDFClassHistogram<N> > bestRight( active.size() );
+
+		ThreadPool::instance().parallelFor( 0, tasks.size(), 1, [ & ]( size_t tbegin, size_t tend ) {
+			std::vector<RDFClassHistogram<N> > right;
+			for( size_t k = tbegin; k < tend; k++ ) {
+				const ScoreTask& task = tasks[ k ];
+				const TrainNode& node = nodes[ active[ task.node ] ];
+				RDFTest<DATA>* const* nodeTests = &tests[ task.node * randTries ];
+				const size_t* idx = &indices[ node.tree ][ task.begin ];
+
+				if( task.slot != NOSLOT ) {
+					score( &partial[ task.slot ], nodeTests, randTries, idx, task.end - task.begin, data );
 				} else {
-					histleft.addSample( classLabel( data, idx ) );
+					right.resize( randTries );
+					score( &right[ 0 ], nodeTests, randTries, idx, task.end - task.begin, data );
+					best[ task.node ] = selectBest( node.hist, &right[ 0 ], randTries );
+					if( best[ task.node ] != NOSLOT )
+						bestRight[ task.node ] = right[ best[ task.node ] ];
+				}
+			}
+		} );
+
+		/* sum the chunks of the large nodes, the tasks of a node are consecutive */
+		for( size_t k = 0; k < tasks.size(); ) {
+			size_t kend = k + 1;
+			while( kend < tasks.size() && tasks[ kend ].node == tasks[ k ].node )
+				kend++;
+			if( tasks[ k ].slot != NOSLOT ) {
+				RDFClassHistogram<N>* sum = &partial[ tasks[ k ].slot ];
+				for( size_t c = k + 1; c < kend; c++ ) {
+					const RDFClassHistogram<N>* chunk = &partial[ tasks[ c ].slot ];
+					for( size_t i = 0; i < randTries; i++ )
+						sum[ i ] += chunk[ i ];
 				}
+				size_t a = tasks[ k ].node;
+				best[ a ] = selectBest( nodes[ active[ a ] ].hist, sum, randTries );
+				if( best[ a ] != NOSLOT )
+					bestRight[ a ] = sum[ best[ a ] ];
 			}
+			k = kend;
+		}
 
-			// how good is the information gain
-			// keep the best otherwise die like the rest
-			float ig = IG( hist, histleft, histright);
-			if( ig > IGmax ) {
-				IGmax = ig;
-				if( best )
-					delete best;
-				best = test;
-				histbestleft = histleft;
-				histbestright = histright;
-				std::cout << ( 100.0f * ( float ) t / ( float ) randTries) << " \%  IG:" << IGmax << " Level: " << level << std::endl;
-			} else {
-				delete test;
+		for( size_t a = 0; a < active.size(); a++ ) {
+			for( size_t i = 0; i < randTries; i++ ) {
+				if( i != best[ a ] )
+					delete tests[ a * randTries + i ];
 			}
+			if( best[ a ] != NOSLOT )
+				nodes[ active[ a ] ].test = tests[ a * randTries + best[ a ] ];
 		}
 
-		if( !best ) {
-			return new RDFNode<DATA,RDFClassHistogram<N> >( new RDFClassHistogram<N>( hist ), NULL, NULL, NULL );
+		/* in place partition of the samples, the left child gets the samples failing the test */
+		std::vector<size_t> mid( active.size() );
+		ThreadPool::instance().parallelFor( 0, active.size(), 1, [ & ]( size_t abegin, size_t aend ) {
+			for( size_t a = abegin; a < aend; a++ ) {
+				const TrainNode& node = nodes[ active[ a ] ];
+				if( !node.test )
+					continue;
+				RDFTest<DATA>* test = node.test;
+				size_t* idx = &indices[ node.tree ][ 0 ];
+				mid[ a ] = std::partition( idx + node.begin, idx + node.end, [ & ]( size_t i ) {
+					return !( *test )( trainingData( data, i ) );
+				} ) - idx;
+			}
+		} );
+
+		for( size_t a = 0; a < active.size(); a++ ) {
+			if( best[ a ] == NOSLOT )
+				continue;
+			TrainNode left, right;
+			left.tree	= right.tree = nodes[ active[ a ] ].tree;
+			left.test	= right.test = NULL;
+			left.begin	= nodes[ active[ a ] ].begin;
+			left.end	= right.begin = mid[ a ];
+			right.end	= nodes[ active[ a ] ].end;
+			right.hist	= bestRight[ a ];
+			left.hist	= nodes[ active[ a ] ].hist;
+			left.hist  -= bestRight[ a ];
+
+			nodes[ active[ a ] ].left  = nodes.size();
+			nodes.push_back( left );
+			nodes[ active[ a ] ].right = nodes.size();
+			nodes.push_back( right );
 		}
+	}
 
-		// split the data into two sets containing the indices
-		std::vector<size_t> leftindices, rightindices;
-		for( size_t i = 0; i < size; i++ ) {
-			size_t idx = indices[ i ];
-			if( best->operator()( trainingData( data, idx ) ) ) {
-				rightindices.push_back( idx );
-			} else {
-				leftindices.push_back( idx );
+	template<typename DATA, typename DATACOLLECTION, size_t N>
+	inline void RDFClassificationTrainer<DATA,DATACOLLECTION,N>::score( RDFClassHistogram<N>* right, RDFTest<DATA>* const* tests, size_t numTests, const size_t* indices, size_t n, const DATACOLLECTION& data )
+	{
+		for( size_t t = 0; t < numTests; t++ )
+			right[ t ].clear();
+
+		for( size_t i = 0; i < n; i++ ) {
+			size_t label = classLabel( data, indices[ i ] );
+			const DATA& d = trainingData( data, indices[ i ] );
+			for( size_t t = 0; t < numTests; t++ ) {
+				if( ( *tests[ t ] )( d ) )
+					right[ t ].addSample( label );
 			}
 		}
+	}
 
-		left  = trainRecursive( data, histbestleft, leftindices, level - 1, randTries );
-		right = trainRecursive( data, histbestright, rightindices, level - 1, randTries );
-		return new RDFNode<DATA,RDFClassHistogram<N> >( NULL, best, left, right );
+	template<typename DATA, typename DATACOLLECTION, size_t N>
+	inline size_t RDFClassificationTrainer<DATA,DATACOLLECTION,N>::selectBest( const RDFClassHistogram<N>& parent, const RDFClassHistogram<N>* right, size_t numTests )
+	{
+		size_t best = NOSLOT;
+		float IGmax = 0.0f;
+		RDFClassHistogram<N> left;
+
+		for( size_t t = 0; t < numTests; t++ ) {
+			left = parent;
+			left -= right[ t ];
+			float ig = IG( parent, left, right[ t ] );
+			if( ig > IGmax ) {
+				IGmax = ig;
+				best = t;
+			}
+		}
+		return best;
 	}
 
 }
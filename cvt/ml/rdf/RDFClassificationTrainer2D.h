@@ -34,19 +34,37 @@
 
 namespace cvt {
 
+		struct RDFTestLinear2DParams
+		{
+			Vector2f norm;
+			float	 threshold;
+
+			bool operator()( const Vector2f& other ) const
+			{
+				return Math::abs( norm.x *  other.x + norm.y * other.y ) < threshold;
+			}
+		};
+
 		class RDFTestLinear2D : public RDFTest<Vector2f>
 		{
 			public:
-				RDFTestLinear2D( const Vector2f& vec, float threshold  ) : _norm( vec ), _threshold( threshold ) {}
+				typedef RDFTestLinear2DParams ParamType;
+
+				RDFTestLinear2D( const Vector2f& vec, float threshold  )
+				{
+					_params.norm = vec;
+					_params.threshold = threshold;
+				}
 
 				bool operator()( const Vector2f& other )
 				{
-					return Math::abs( _norm.x *  other.x + _norm.y * other.y ) < _threshold;
+					return _params( other );
 				}
 
+				const ParamType& params() const { return _params; }
+
 			private:
-				Vector2f _norm;
-				float	 _threshold;
+				ParamType _params;
 		};
 
 		class RDFClassificationTrainer2D : public RDFClassificationTrainer<Vector2f,std::vector<Vector3f>,2>
@@ -90,7 +108,7 @@ namespace cvt {
 
 
 
-		void RDFClassificationTrainer2D::visualizeClassifier( Image& dst, const RDFClassifier<Vector2f,2>& classifier, const Rectf& rect, size_t width, size_t height )
+		inline void RDFClassificationTrainer2D::visualizeClassifier( Image& dst, const RDFClassifier<Vector2f,2>& classifier, const Rectf& rect, size_t width, size_t height )
 		{
 			dst.reallocate( width, height, IFormat::RGBA_FLOAT );
 			IMapScoped<float> map( dst );
@@ -0,0 +1,88 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/ml/rdf/RDFClassificationTrainer2D.h>
+#include <cvt/util/CVTTest.h>
+
+using namespace cvt;
+
+/* points inside a circle are class 1 */
+static void _circleData( std::vector<Vector3f>& data, size_t n )
+{
+    data.clear();
+    for( size_t i = 0; i < n; i++ ) {
+        float x = Math::rand( -8000.0f, 8000.0f );
+        float y = Math::rand( -8000.0f, 8000.0f );
+        data.push_back( Vector3f( x, y, x * x + y * y < 16000000.0f ? 1.0f : 0.0f ) );
+    }
+}
+
+static float _accuracy( const RDFClassifier<Vector2f,2>& classifier, const std::vector<Vector3f>& data )
+{
+    RDFClassHistogram<2> hist;
+    size_t correct = 0;
+    for( size_t i = 0; i < data.size(); i++ ) {
+        classifier.classify( hist, Vector2f( data[ i ].x, data[ i ].y ) );
+        size_t label = hist.probability( 1 ) > hist.probability( 0 ) ? 1 : 0;
+        if( label == ( size_t ) data[ i ].z )
+            correct++;
+    }
+    return ( float ) correct / ( float ) data.size();
+}
+
+BEGIN_CVTTEST( RDFClassificationTrainer )
+    bool result = true;
+    bool b;
+
+    std::vector<Vector3f> train, test;
+    _circleData( train, 4000 );
+    _circleData( test, 2000 );
+
+    RDFClassificationTrainer2D trainer( 2 );
+
+    RDFClassifier<Vector2f,2> single;
+    single.addTree( trainer.train( train, 8, 50 ) );
+    float acc = _accuracy( single, test );
+    b = single.treeCount() == 1 && acc > 0.85f;
+    CVTTEST_PRINT( "single tree accuracy " << acc, b );
+    result &= b;
+
+    RDFClassifier<Vector2f,2> forest;
+    trainer.train( forest, train, 4, 8, 50 );
+    acc = _accuracy( forest, test );
+    b = forest.treeCount() == 4 && acc > 0.9f;
+    CVTTEST_PRINT( "forest accuracy " << acc, b );
+    result &= b;
+
+    /* a pure node is not split */
+    std::vector<Vector3f> pure( 100, Vector3f( 1.0f, 2.0f, 1.0f ) );
+    RDFClassifier<Vector2f,2> trivial;
+    trainer.train( trivial, pure, 2, 8, 10 );
+    b = trivial.treeCount() == 2 && _accuracy( trivial, pure ) == 1.0f;
+    CVTTEST_PRINT( "pure data", b );
+    result &= b;
+
+    return result;
+END_CVTTEST
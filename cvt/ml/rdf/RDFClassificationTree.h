@@ -37,6 +37,7 @@ namespace cvt {
 			~RDFClassificationTree();
 
 			const RDFClassHistogram<N>& classify( const DATA& d );
+			const RDFNode<DATA,RDFClassHistogram<N> >* root() const;
 		private:
 			RDFClassificationTree( const RDFClassificationTree<DATA,N>& );
 
@@ -55,6 +56,12 @@ namespace cvt {
 	}
 
 
+	template<typename DATA, size_t N>
+	inline const RDFNode<DATA,RDFClassHistogram<N> >* RDFClassificationTree<DATA,N>::root() const
+	{
+		return _root;
+	}
+
 	template<typename DATA, size_t N>
 	inline const RDFClassHistogram<N>& RDFClassificationTree<DATA,N>::classify( const DATA& d )
 	{
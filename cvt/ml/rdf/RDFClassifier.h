@@ -37,6 +37,7 @@ namespace cvt {
 
 			void    addTree( RDFClassificationTree<DATA,N>* tree );
 			size_t  treeCount() const;
+			const RDFClassificationTree<DATA,N>& tree( size_t i ) const;
 
 			void    classify( RDFClassHistogram<N>& classhist, const DATA& data ) const;
 
@@ -66,6 +67,12 @@ namespace cvt {
 		return _trees.size();
 	}
 
+	template<typename DATA, size_t N>
+	inline const RDFClassificationTree<DATA,N>& RDFClassifier<DATA,N>::tree( size_t i ) const
+	{
+		return *_trees[ i ];
+	}
+
 	template<typename DATA, size_t N>
 	inline void RDFClassifier<DATA,N>::classify( RDFClassHistogram<N>& chist, const DATA& data ) const
 	{
@@ -0,0 +1,394 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_RDFCOMPILEDCLASSIFIER_H
+#define CVT_RDFCOMPILEDCLASSIFIER_H
+
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <cvt/ml/rdf/RDFClassifier.h>
+#include <cvt/io/MappedFile.h>
+#include <cvt/util/ThreadPool.h>
+#include <cvt/util/Exception.h>
+
+namespace cvt {
+
+	/**
+	  @brief Inference representation of a RDFClassifier
+
+	  The nodes of all trees are stored breadth-first in one array, the two children of a node are
+	  adjacent. The tests are stored by value as the POD TEST::ParamType, which provides a const
+	  bool operator()( const DATA& ), so classification needs neither pointer chasing through
+	  heap nodes nor virtual calls. TEST is the RDFTest<DATA> subclass the trees were trained with,
+	  it has to provide params().
+
+	  save() writes the arrays unchanged to a binary file, load() maps such a file read-only and
+	  classifies directly from the mapping, so processes loading the same forest share the pages.
+	  The file is in native byte order, all sections start at multiples of 64 bytes:
+
+	  bytes   contents
+	  0-71    FileHeader: magic "CVTRDF", version, byte order mark, N, node and histogram size,
+	          number of trees, nodes and leaves, offsets of the sections
+	  ...     root node index per tree as int32_t
+	  ...     nodes: TEST::ParamType followed by the int32_t child index, as Node
+	  ...     leaf histograms as RDFClassHistogram<N>
+	 */
+	template<typename DATA, size_t N, typename TEST>
+	class RDFCompiledClassifier
+	{
+		public:
+			typedef typename TEST::ParamType TestParams;
+
+			RDFCompiledClassifier();
+			RDFCompiledClassifier( const RDFClassifier<DATA,N>& classifier );
+			~RDFCompiledClassifier();
+
+			void	compile( const RDFClassifier<DATA,N>& classifier );
+
+			/* throw CVTException on errors or if the file does not match DATA, N and TEST */
+			void	save( const String& path ) const;
+			void	load( const String& path );
+
+			size_t	treeCount() const { return _numTrees; }
+			size_t	nodeCount() const { return _numNodes; }
+
+			void	classify( RDFClassHistogram<N>& classhist, const DATA& data ) const;
+			/* classify n samples into out[ 0 ] ... out[ n - 1 ], the samples are distributed over the thread pool */
+			void	classify( RDFClassHistogram<N>* out, const DATA* samples, size_t n ) const;
+
+		private:
+			RDFCompiledClassifier( const RDFCompiledClassifier& );
+			RDFCompiledClassifier& operator=( const RDFCompiledClassifier& );
+
+			static const uint32_t VERSION	 = 1;
+			static const uint32_t BYTEORDER  = 0x01020304;
+			static const size_t	  ALIGNMENT  = 64;
+
+			struct FileHeader {
+				char		magic[ 8 ];
+				uint32_t	version;
+				uint32_t	byteOrder;
+				uint32_t	classes;
+				uint32_t	nodeSize;
+				uint32_t	histSize;
+				uint32_t	reserved;
+				uint64_t	numTrees;
+				uint64_t	numNodes;
+				uint64_t	numLeaves;
+				uint64_t	rootOffset;
+				uint64_t	nodeOffset;
+				uint64_t	leafOffset;
+			};
+
+			struct Node {
+				TestParams	test;
+				/* >= 0: index of the left child, the right child follows it. < 0: leaf with histogram -child - 1 */
+				int32_t		child;
+			};
+
+			const RDFClassHistogram<N>& leaf( size_t root, const DATA& data ) const;
+			void	classifyRange( RDFClassHistogram<N>* out, const DATA* samples, size_t n ) const;
+			void	useOwnedStorage();
+			static size_t align( size_t offset ) { return ( offset + ALIGNMENT - 1 ) & ~( ALIGNMENT - 1 ); }
+
+			/* the arrays are either owned or point into the mapped file */
+			const int32_t*					_roots;
+			const Node*						_nodes;
+			const RDFClassHistogram<N>*		_leaves;
+			size_t							_numTrees;
+			size_t							_numNodes;
+			size_t							_numLeaves;
+
+			std::vector<int32_t>				_rootData;
+			std::vector<Node>					_nodeData;
+			std::vector<RDFClassHistogram<N> >	_leafData;
+			MappedFile*							_file;
+	};
+
+	template<typename DATA, size_t N, typename TEST>
+	const uint32_t RDFCompiledClassifier<DATA,N,TEST>::VERSION;
+
+	template<typename DATA, size_t N, typename TEST>
+	const uint32_t RDFCompiledClassifier<DATA,N,TEST>::BYTEORDER;
+
+	template<typename DATA, size_t N, typename TEST>
+	const size_t RDFCompiledClassifier<DATA,N,TEST>::ALIGNMENT;
+
+	template<typename DATA, size_t N, typename TEST>
+	inline RDFCompiledClassifier<DATA,N,TEST>::RDFCompiledClassifier() :
+		_roots( NULL ),
+		_nodes( NULL ),
+		_leaves( NULL ),
+		_numTrees( 0 ),
+		_numNodes( 0 ),
+		_numLeaves( 0 ),
+		_file( NULL )
+	{
+	}
+
+	template<typename DATA, size_t N, typename TEST>
+	inline RDFCompiledClassifier<DATA,N,TEST>::RDFCompiledClassifier( const RDFClassifier<DATA,N>& classifier ) :
+		_roots( NULL ),
+		_nodes( NULL ),
+		_leaves( NULL ),
+		_numTrees( 0 ),
+		_numNodes( 0 ),
+		_numLeaves( 0 ),
+		_file( NULL )
+	{
+		compile( classifier );
+	}
+
+	template<typename DATA, size_t N, typename TEST>
+	inline RDFCompiledClassifier<DATA,N,TEST>::~RDFCompiledClassifier()
+	{
+		delete _file;
+	}
+
+	template<typename DATA, size_t N, typename TEST>
+	inline void RDFCompiledClassifier<DATA,N,TEST>::useOwnedStorage()
+	{
+		delete _file;
+		_file	   = NULL;
+		_numTrees  = _rootData.size();
+		_numNodes  = _nodeData.size();
+		_numLeaves = _leafData.size();
+		_roots	   = _rootData.empty() ? NULL : &_rootData[ 0 ];
+		_nodes	   = _nodeData.empty() ? NULL : &_nodeData[ 0 ];
+		_leaves	   = _leafData.empty() ? NULL : &_leafData[ 0 ];
+	}
+
+	template<typename DATA, size_t N, typename TEST>
+	inline void RDFCompiledClassifier<DATA,N,TEST>::compile( const RDFClassifier<DATA,N>& classifier )
+	{
+		typedef RDFNode<DATA,RDFClassHistogram<N> > NodeType;
+		std::vector<const NodeType*> order;
+
+		_rootData.clear();
+		_nodeData.clear();
+		_leafData.clear();
+
+		for( size_t t = 0; t < classifier.treeCount(); t++ ) {
+			_rootData.push_back( order.size() );
+			order.push_back( classifier.tree( t ).root() );
+
+			/* breadth-first, order[ i ] becomes _nodes[ i ] */
+			for( size_t i = _nodeData.size(); i < order.size(); i++ ) {
+				const NodeType* node = order[ i ];
+				Node n = Node();
+				if( node->isLeaf() ) {
+					n.child = -( int32_t ) _leafData.size() - 1;
+					_leafData.push_back( *node->data() );
+				} else {
+					const TEST* test = dynamic_cast<const TEST*>( node->test() );
+					if( !test )
+						throw CVTException( "RDFCompiledClassifier: tree contains a test of a different type" );
+					n.test = test->params();
+					n.child = order.size();
+					order.push_back( node->left() );
+					order.push_back( node->right() );
+				}
+				_nodeData.push_back( n );
+			}
+		}
+		useOwnedStorage();
+	}
+
+	template<typename DATA, size_t N, typename TEST>
+	inline void RDFCompiledClassifier<DATA,N,TEST>::save( const String& path ) const
+	{
+		FileHeader header;
+		memset( &header, 0, sizeof( header ) );
+		memcpy( header.magic, "CVTRDF", 6 );
+		header.version	  = VERSION;
+		header.byteOrder  = BYTEORDER;
+		header.classes	  = N;
+		header.nodeSize	  = sizeof( Node );
+		header.histSize	  = sizeof( RDFClassHistogram<N> );
+		header.numTrees	  = _numTrees;
+		header.numNodes	  = _numNodes;
+		header.numLeaves  = _numLeaves;
+		header.rootOffset = align( sizeof( FileHeader ) );
+		header.nodeOffset = align( header.rootOffset + _numTrees * sizeof( int32_t ) );
+		header.leafOffset = align( header.nodeOffset + _numNodes * sizeof( Node ) );
+
+		FILE* stream = fopen( path.c_str(), "wb" );
+		if( !stream )
+			throw CVTException( "RDFCompiledClassifier: could not open " + std::string( path.c_str() ) );
+
+		const uint8_t zero[ ALIGNMENT ] = { 0 };
+		const void* sections[ 3 ]	= { _roots, _nodes, _leaves };
+		const size_t sizes[ 3 ]		= { _numTrees * sizeof( int32_t ), _numNodes * sizeof( Node ), _numLeaves * sizeof( RDFClassHistogram<N> ) };
+		const uint64_t offsets[ 3 ] = { header.rootOffset, header.nodeOffset, header.leafOffset };
+
+		bool ok = fwrite( &header, sizeof( header ), 1, stream ) == 1;
+		size_t pos = sizeof( header );
+		for( size_t i = 0; ok && i < 3; i++ ) {
+			ok = fwrite( zero, 1, offsets[ i ] - pos, stream ) == offsets[ i ] - pos;
+			if( ok && sizes[ i ] )
+				ok = fwrite( sections[ i ], sizes[ i ], 1, stream ) == 1;
+			pos = offsets[ i ] + sizes[ i ];
+		}
+		ok = ( fclose( stream ) == 0 ) && ok;
+
+		if( !ok )
+			throw CVTException( "RDFCompiledClassifier: problem writing " + std::string( path.c_str() ) );
+	}
+
+	template<typename DATA, size_t N, typename TEST>
+	inline void RDFCompiledClassifier<DATA,N,TEST>::load( const String& path )
+	{
+		MappedFile* file = new MappedFile( path );
+		const FileHeader* header = ( const FileHeader* ) file->data();
+		const size_t size = file->size();
+
+		std::string error;
+		if( size < sizeof( FileHeader ) || memcmp( header->magic, "CVTRDF", 6 ) )
+			error = "not a forest file";
+		else if( header->version != VERSION || header->byteOrder != BYTEORDER )
+			error = "unsupported version or byte order";
+		else if( header->classes != N || header->nodeSize != sizeof( Node ) || header->histSize != sizeof( RDFClassHistogram<N> ) )
+			error = "forest does not match the classifier type";
+		else if( header->rootOffset % ALIGNMENT || header->nodeOffset % ALIGNMENT || header->leafOffset % ALIGNMENT ||
+				 header->rootOffset > size || header->numTrees > ( size - header->rootOffset ) / sizeof( int32_t ) ||
+				 header->nodeOffset > size || header->numNodes > ( size - header->nodeOffset ) / sizeof( Node ) ||
+				 header->leafOffset > size || header->numLeaves > ( size - header->leafOffset ) / sizeof( RDFClassHistogram<N> ) )
+			error = "file is truncated";
+
+		if( !error.empty() ) {
+			delete file;
+			throw CVTException( "RDFCompiledClassifier: " + std::string( path.c_str() ) + ": " + error );
+		}
+
+		/* check every index once, classification then follows them unchecked. Children are stored
+		   breadth-first behind their parent, which also rules out cycles in corrupt files */
+		const int32_t* roots = ( const int32_t* ) ( file->data() + header->rootOffset );
+		const Node* nodes = ( const Node* ) ( file->data() + header->nodeOffset );
+		for( size_t t = 0; t < header->numTrees && error.empty(); t++ ) {
+			if( roots[ t ] < 0 || ( uint64_t ) roots[ t ] >= header->numNodes )
+				error = "invalid root node";
+		}
+		for( size_t i = 0; i < header->numNodes && error.empty(); i++ ) {
+			int64_t child = nodes[ i ].child;
+			if( child >= 0 ) {
+				if( ( uint64_t ) child <= i || ( uint64_t ) child + 1 >= header->numNodes )
+					error = "invalid child node";
+			} else if( ( uint64_t ) ( -child - 1 ) >= header->numLeaves )
+				error = "invalid leaf";
+		}
+
+		if( !error.empty() ) {
+			delete file;
+			throw CVTException( "RDFCompiledClassifier: " + std::string( path.c_str() ) + ": " + error );
+		}
+
+		_rootData.clear();
+		_nodeData.clear();
+		_leafData.clear();
+		delete _file;
+		_file	   = file;
+		_numTrees  = header->numTrees;
+		_numNodes  = header->numNodes;
+		_numLeaves = header->numLeaves;
+		_roots	   = roots;
+		_nodes	   = nodes;
+		_leaves	   = ( const RDFClassHistogram<N>* ) ( file->data() + header->leafOffset );
+	}
+
+	template<typename DATA, size_t N, typename TEST>
+	inline const RDFClassHistogram<N>& RDFCompiledClassifier<DATA,N,TEST>::leaf( size_t root, const DATA& data ) const
+	{
+		const Node* nodes = _nodes;
+		int32_t i = _roots[ root ];
+		int32_t child;
+		while( ( child = nodes[ i ].child ) >= 0 )
+			i = child + ( nodes[ i ].test( data ) ? 1 : 0 );
+		return _leaves[ -child - 1 ];
+	}
+
+	template<typename DATA, size_t N, typename TEST>
+	inline void RDFCompiledClassifier<DATA,N,TEST>::classify( RDFClassHistogram<N>& chist, const DATA& data ) const
+	{
+		chist.clear();
+		for( size_t t = 0; t < _numTrees; t++ )
+			chist += leaf( t, data );
+	}
+
+	template<typename DATA, size_t N, typename TEST>
+	inline void RDFCompiledClassifier<DATA,N,TEST>::classifyRange( RDFClassHistogram<N>* out, const DATA* samples, size_t n ) const
+	{
+		/* a block of samples descends a tree interleaved, one step per sample and pass: the traversals
+		   are independent, so the node loads and tests of the samples overlap instead of forming one
+		   long dependency chain */
+		const size_t block = 64;
+		const Node* nodes = _nodes;
+		int32_t idx[ block ];
+		size_t active[ block ];
+
+		for( size_t b = 0; b < n; b += block ) {
+			size_t num = Math::min( block, n - b );
+			const DATA* s = samples + b;
+
+			for( size_t i = 0; i < num; i++ )
+				out[ b + i ].clear();
+
+			for( size_t t = 0; t < _numTrees; t++ ) {
+				for( size_t i = 0; i < num; i++ ) {
+					idx[ i ] = _roots[ t ];
+					active[ i ] = i;
+				}
+
+				/* the samples that reached a leaf are swapped out of the active range */
+				size_t numActive = num;
+				while( numActive ) {
+					for( size_t k = 0; k < numActive; ) {
+						size_t i = active[ k ];
+						const Node& node = nodes[ idx[ i ] ];
+						if( node.child >= 0 ) {
+							idx[ i ] = node.child + ( node.test( s[ i ] ) ? 1 : 0 );
+							k++;
+						} else {
+							active[ k ] = active[ --numActive ];
+						}
+					}
+				}
+
+				for( size_t i = 0; i < num; i++ )
+					out[ b + i ] += _leaves[ -nodes[ idx[ i ] ].child - 1 ];
+			}
+		}
+	}
+
+	template<typename DATA, size_t N, typename TEST>
+	inline void RDFCompiledClassifier<DATA,N,TEST>::classify( RDFClassHistogram<N>* out, const DATA* samples, size_t n ) const
+	{
+		ThreadPool::instance().parallelFor( 0, n, 1024, [ this, out, samples ]( size_t begin, size_t end ) {
+			classifyRange( out + begin, samples + begin, end - begin );
+		} );
+	}
+}
+
+#endif
@@ -0,0 +1,117 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/ml/rdf/RDFCompiledClassifier.h>
+#include <cvt/ml/rdf/RDFClassificationTrainer2D.h>
+#include <cvt/util/CVTTest.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace cvt;
+
+typedef RDFCompiledClassifier<Vector2f,2,RDFTestLinear2D> CompiledForest;
+
+static bool _sameHistogram( const RDFClassHistogram<2>& a, const RDFClassHistogram<2>& b )
+{
+    return a.sampleCount() == b.sampleCount() && a.probability( 0 ) == b.probability( 0 ) && a.probability( 1 ) == b.probability( 1 );
+}
+
+static bool _classifiesLike( const CompiledForest& forest, const RDFClassifier<Vector2f,2>& classifier, const std::vector<Vector2f>& samples )
+{
+    std::vector<RDFClassHistogram<2> > batch( samples.size() );
+    forest.classify( &batch[ 0 ], &samples[ 0 ], samples.size() );
+
+    RDFClassHistogram<2> ref, single;
+    for( size_t i = 0; i < samples.size(); i++ ) {
+        classifier.classify( ref, samples[ i ] );
+        forest.classify( single, samples[ i ] );
+        if( !_sameHistogram( ref, single ) || !_sameHistogram( ref, batch[ i ] ) )
+            return false;
+    }
+    return true;
+}
+
+BEGIN_CVTTEST( RDFCompiledClassifier )
+    bool result = true;
+    bool b;
+
+    /* points inside a circle are class 1 */
+    std::vector<Vector3f> data;
+    std::vector<Vector2f> samples;
+    for( size_t i = 0; i < 4000; i++ ) {
+        float x = Math::rand( -8000.0f, 8000.0f );
+        float y = Math::rand( -8000.0f, 8000.0f );
+        data.push_back( Vector3f( x, y, x * x + y * y < 16000000.0f ? 1.0f : 0.0f ) );
+        samples.push_back( Vector2f( x, y ) );
+    }
+
+    RDFClassificationTrainer2D trainer( 2 );
+    RDFClassifier<Vector2f,2> classifier;
+    trainer.train( classifier, data, 3, 8, 50 );
+
+    CompiledForest forest( classifier );
+    b = forest.treeCount() == 3 && _classifiesLike( forest, classifier, samples );
+    CVTTEST_PRINT( "compile", b );
+    result &= b;
+
+    char path[] = "/tmp/cvtrdfXXXXXX";
+    int fd = mkstemp( path );
+    if( fd < 0 )
+        return false;
+    close( fd );
+
+    CompiledForest loaded;
+    forest.save( path );
+    loaded.load( path );
+    b = loaded.treeCount() == forest.treeCount() && loaded.nodeCount() == forest.nodeCount() &&
+        _classifiesLike( loaded, classifier, samples );
+    CVTTEST_PRINT( "save/load", b );
+    result &= b;
+
+    /* point the child of the first root past the node array, the header stores the node offset at byte 64
+       and the child index follows the test parameters in every node */
+    b = false;
+    FILE* f = fopen( path, "r+b" );
+    uint64_t nodeOffset;
+    int32_t child = 1 << 30;
+    if( f && fseek( f, 64, SEEK_SET ) == 0 && fread( &nodeOffset, sizeof( nodeOffset ), 1, f ) == 1 &&
+        fseek( f, nodeOffset + sizeof( RDFTestLinear2DParams ), SEEK_SET ) == 0 && fwrite( &child, sizeof( child ), 1, f ) == 1 ) {
+        fclose( f );
+        f = NULL;
+        try {
+            loaded.load( path );
+        } catch( const Exception& ) {
+            b = loaded.nodeCount() == forest.nodeCount();
+        }
+    }
+    if( f )
+        fclose( f );
+    unlink( path );
+    CVTTEST_PRINT( "reject corrupt nodes", b );
+    result &= b;
+
+    return result;
+END_CVTTEST
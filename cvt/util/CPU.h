@@ -40,40 +40,69 @@ namespace cvt {
 		CPU_SSE4_1 = ( 1 << 6 ),
 		CPU_SSE4_2 = ( 1 << 7 ),
 		CPU_AVX    = ( 1 << 8 ),
+		CPU_POPCNT = ( 1 << 9 ),
+		CPU_FMA    = ( 1 << 10 ),
+		CPU_AVX2   = ( 1 << 11 ),
+		CPU_AVX512F  = ( 1 << 12 ),
+		CPU_AVX512BW = ( 1 << 13 ),
+		CPU_AVX512VPOPCNTDQ = ( 1 << 14 )
 	};
 
 	CVT_ENUM_TO_FLAGS( CPUFeatureFlags, CPUFeatures )
 
-	static inline CPUFeatures cpuFeatures( void )
+	static inline void _cpuid( uint32_t leaf, uint32_t subleaf, uint32_t& eax, uint32_t& ebx, uint32_t& ecx, uint32_t& edx )
 	{
-		CPUFeatures ret = CPU_BASE;
-		uint32_t eax, ebx, ecx, edx;
-
 #ifdef ARCH_x86_64
 		/* FIXME: what a clusterfuck - this works only for x86_64, we need to save ebx on x86
 				  BUT cpuid on x86_64 destroys rbx and not only ebx
 		 */
 		asm volatile(
-			"movl $1, %%eax;\n\t"
 			"cpuid;\n\t"
 				: "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
-				:
+				: "a"(leaf), "c"(subleaf)
 				:
 			);
 #elif ARCH_x86
 		asm volatile(
 			"movl %%ebx, %%esi;\n\t"
-			"movl $1, %%eax;\n\t"
 			"cpuid;\n\t"
 			"xchgl %%ebx, %%esi;\n\t"
 				: "=a"(eax), "=S"(ebx), "=c"(ecx), "=d"(edx)
-				:
+				: "a"(leaf), "c"(subleaf)
 				:
 			);
-
 #else
+		( void ) leaf;
+		( void ) subleaf;
 		eax = ebx = ecx = edx = 0;
 #endif
+	}
+
+	/* register state enabled by the OS, only valid if cpuid reports OSXSAVE */
+	static inline uint64_t _xgetbv()
+	{
+#if defined( ARCH_x86_64 ) || defined( ARCH_x86 )
+		uint32_t lo, hi;
+		asm volatile(
+			".byte 0x0f, 0x01, 0xd0;\n\t"
+				: "=a"(lo), "=d"(hi)
+				: "c"(0)
+				:
+			);
+		return ( ( uint64_t ) hi << 32 ) | lo;
+#else
+		return 0;
+#endif
+	}
+
+	static inline CPUFeatures cpuFeatures( void )
+	{
+		CPUFeatures ret = CPU_BASE;
+		uint32_t eax, ebx, ecx, edx;
+		uint32_t maxleaf;
+
+		_cpuid( 0, 0, maxleaf, ebx, ecx, edx );
+		_cpuid( 1, 0, eax, ebx, ecx, edx );
 
 		if( edx & ( 1 << 23 ) )
 			ret |= CPU_MMX;
@@ -83,16 +112,37 @@ namespace cvt {
 			ret |= CPU_SSE2;
 		if( ecx & ( 1 <<  0 ) )
 			ret |= CPU_SSE3;
-		if( ecx & ( 1 <<  0 ) )
-			ret |= CPU_SSE3;
 		if( ecx & ( 1 <<  9 ) )
 			ret |= CPU_SSSE3;
 		if( ecx & ( 1 << 19 ) )
 			ret |= CPU_SSE4_1;
 		if( ecx & ( 1 << 20 ) )
 			ret |= CPU_SSE4_2;
-		if( ecx & ( 1 << 28 ) )
+		if( ecx & ( 1 << 23 ) )
+			ret |= CPU_POPCNT;
+
+		/* the wide registers are only usable if the OS saves them on context switches */
+		uint64_t xcr0 = ( ecx & ( 1 << 27 ) ) ? _xgetbv() : 0;
+		bool ymmstate = ( xcr0 & 0x06 ) == 0x06;
+		bool zmmstate = ( xcr0 & 0xe6 ) == 0xe6;
+
+		if( ymmstate && ( ecx & ( 1 << 28 ) ) ) {
 			ret |= CPU_AVX;
+			if( ecx & ( 1 << 12 ) )
+				ret |= CPU_FMA;
+		}
+
+		if( maxleaf >= 7 ) {
+			_cpuid( 7, 0, eax, ebx, ecx, edx );
+			if( ymmstate && ( ebx & ( 1 << 5 ) ) )
+				ret |= CPU_AVX2;
+			if( zmmstate && ( ebx & ( 1 << 16 ) ) )
+				ret |= CPU_AVX512F;
+			if( zmmstate && ( ebx & ( 1 << 30 ) ) )
+				ret |= CPU_AVX512BW;
+			if( zmmstate && ( ecx & ( 1 << 14 ) ) )
+				ret |= CPU_AVX512VPOPCNTDQ;
+		}
 		return ret;
 	}
 
@@ -115,8 +165,20 @@ namespace cvt {
 			std::cout << "SSE4.1 ";
 		if( f & CPU_SSE4_2 )
 			std::cout << "SSE4.2 ";
+		if( f & CPU_POPCNT )
+			std::cout << "POPCNT ";
 		if( f & CPU_AVX )
 			std::cout << "AVX ";
+		if( f & CPU_FMA )
+			std::cout << "FMA ";
+		if( f & CPU_AVX2 )
+			std::cout << "AVX2 ";
+		if( f & CPU_AVX512F )
+			std::cout << "AVX512F ";
+		if( f & CPU_AVX512BW )
+			std::cout << "AVX512BW ";
+		if( f & CPU_AVX512VPOPCNTDQ )
+			std::cout << "AVX512VPOPCNTDQ ";
 		std::cout << std::endl;
 	}
 
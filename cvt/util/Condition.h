@@ -28,6 +28,7 @@
 #include <cvt/util/Exception.h>
 #include <pthread.h>
 #include <errno.h>
+#include <sys/time.h>
 
 namespace cvt {
 	class Condition {
@@ -35,6 +36,8 @@ namespace cvt {
 			Condition();
 			~Condition();
 			void wait( Mutex& mtx );
+			/* returns false if the timeout expired */
+			bool wait( Mutex& mtx, size_t timeoutms );
 			void notify();
 			void notifyAll();
 		private:
@@ -66,6 +69,28 @@ namespace cvt {
 			throw CVTException( err );
 	}
 
+	inline bool Condition::wait( Mutex& mtx, size_t timeoutms )
+	{
+		struct timeval now;
+		struct timespec abstime;
+		int err;
+
+		gettimeofday( &now, NULL );
+		abstime.tv_sec = now.tv_sec + timeoutms / 1000;
+		abstime.tv_nsec = now.tv_usec * 1000 + ( timeoutms % 1000 ) * 1000000;
+		if( abstime.tv_nsec >= 1000000000 ) {
+			abstime.tv_sec++;
+			abstime.tv_nsec -= 1000000000;
+		}
+
+		err = pthread_cond_timedwait( &_tcond, &mtx._tmutex, &abstime );
+		if( err == ETIMEDOUT )
+			return false;
+		if( err )
+			throw CVTException( err );
+		return true;
+	}
+
 	inline void Condition::notify()
 	{
 		int err;
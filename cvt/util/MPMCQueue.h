@@ -0,0 +1,267 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_MPMCQUEUE_H
+#define CVT_MPMCQUEUE_H
+
+#include <cvt/util/QueueWaiter.h>
+
+#include <atomic>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <stdint.h>
+
+namespace cvt {
+
+	/**
+	  @brief Bounded lock-free queue for any number of producer and consumer threads
+
+	  Every cell carries a sequence number telling whether it is free for the producer or
+	  filled for the consumer of the current round, so producers and consumers only contend
+	  on their own position. Batch operations claim consecutive cells with a single
+	  compare-and-swap. The capacity is rounded up to a power of two. The try variants never
+	  block, the other variants wait for space or elements, a full queue blocks the producers
+	  (backpressure). The elements are constructed in the cells by push and moved out and
+	  destroyed by pop, so the queue holds no objects besides the queued ones.
+	 */
+	template<typename T>
+	class MPMCQueue {
+		public:
+			explicit MPMCQueue( size_t capacity );
+			~MPMCQueue();
+
+			size_t	capacity() const { return _mask + 1; }
+			/* number of queued elements, only a snapshot if called concurrently */
+			size_t	size() const;
+			bool	empty() const { return size() == 0; }
+
+			bool	tryPush( const T& value );
+			bool	tryPop( T& value );
+			/* push/pop up to n elements, returns the number of elements transferred */
+			size_t	tryPushBatch( const T* values, size_t n );
+			size_t	tryPopBatch( T* values, size_t n );
+
+			void	push( const T& value );
+			void	pop( T& value );
+			/* wait at most timeoutms milliseconds, returns false on timeout */
+			bool	push( const T& value, size_t timeoutms );
+			bool	pop( T& value, size_t timeoutms );
+			/* push all n elements, waiting for space as necessary */
+			void	pushBatch( const T* values, size_t n );
+			/* wait for at least one element and pop up to n, returns the number of elements */
+			size_t	popBatch( T* values, size_t n );
+
+		private:
+			MPMCQueue( const MPMCQueue& );
+			MPMCQueue& operator=( const MPMCQueue& );
+
+			struct Cell {
+				std::atomic<size_t> seq;
+				typename std::aligned_storage<sizeof( T ), alignof( T )>::type storage;
+
+				T* value() { return reinterpret_cast<T*>( &storage ); }
+			};
+
+			Cell*				_cells;
+			size_t				_mask;
+			QueueWaiter			_notEmpty;
+			QueueWaiter			_notFull;
+
+			uint8_t				_pad0[ 64 ];
+			std::atomic<size_t>	_head;
+			uint8_t				_pad1[ 64 ];
+			std::atomic<size_t>	_tail;
+			uint8_t				_pad2[ 64 ];
+	};
+
+	template<typename T>
+	inline MPMCQueue<T>::MPMCQueue( size_t capacity ) :
+		_head( 0 ),
+		_tail( 0 )
+	{
+		size_t n = 2;
+		while( n < capacity )
+			n <<= 1;
+		_cells = new Cell[ n ];
+		_mask = n - 1;
+		for( size_t i = 0; i < n; i++ )
+			_cells[ i ].seq.store( i, std::memory_order_relaxed );
+	}
+
+	template<typename T>
+	inline MPMCQueue<T>::~MPMCQueue()
+	{
+		size_t tail = _tail.load( std::memory_order_relaxed );
+		for( size_t pos = _head.load( std::memory_order_relaxed ); pos != tail; pos++ )
+			_cells[ pos & _mask ].value()->~T();
+		delete[] _cells;
+	}
+
+	template<typename T>
+	inline size_t MPMCQueue<T>::size() const
+	{
+		size_t head = _head.load( std::memory_order_acquire );
+		size_t tail = _tail.load( std::memory_order_acquire );
+		/* head may pass the loaded tail in between */
+		return tail > head ? tail - head : 0;
+	}
+
+	template<typename T>
+	inline size_t MPMCQueue<T>::tryPushBatch( const T* values, size_t n )
+	{
+		size_t pos = _tail.load( std::memory_order_relaxed );
+		size_t k;
+		for( ;; ) {
+			/* cell pos + i is free in this round if its sequence is pos + i */
+			for( k = 0; k < n && k <= _mask; k++ ) {
+				if( _cells[ ( pos + k ) & _mask ].seq.load( std::memory_order_acquire ) != pos + k )
+					break;
+			}
+
+			if( !k ) {
+				intptr_t diff = ( intptr_t ) _cells[ pos & _mask ].seq.load( std::memory_order_acquire ) - ( intptr_t ) pos;
+				if( diff < 0 )
+					return 0;
+				pos = _tail.load( std::memory_order_relaxed );
+			} else if( _tail.compare_exchange_weak( pos, pos + k, std::memory_order_relaxed ) ) {
+				break;
+			}
+		}
+
+		for( size_t i = 0; i < k; i++ ) {
+			Cell& cell = _cells[ ( pos + i ) & _mask ];
+			new( cell.value() ) T( values[ i ] );
+			cell.seq.store( pos + i + 1, std::memory_order_release );
+		}
+		_notEmpty.notify();
+		return k;
+	}
+
+	template<typename T>
+	inline size_t MPMCQueue<T>::tryPopBatch( T* values, size_t n )
+	{
+		size_t pos = _head.load( std::memory_order_relaxed );
+		size_t k;
+		for( ;; ) {
+			/* cell pos + i is filled in this round if its sequence is pos + i + 1 */
+			for( k = 0; k < n && k <= _mask; k++ ) {
+				if( _cells[ ( pos + k ) & _mask ].seq.load( std::memory_order_acquire ) != pos + k + 1 )
+					break;
+			}
+
+			if( !k ) {
+				intptr_t diff = ( intptr_t ) _cells[ pos & _mask ].seq.load( std::memory_order_acquire ) - ( intptr_t ) ( pos + 1 );
+				if( diff < 0 )
+					return 0;
+				pos = _head.load( std::memory_order_relaxed );
+			} else if( _head.compare_exchange_weak( pos, pos + k, std::memory_order_relaxed ) ) {
+				break;
+			}
+		}
+
+		for( size_t i = 0; i < k; i++ ) {
+			Cell& cell = _cells[ ( pos + i ) & _mask ];
+			values[ i ] = std::move( *cell.value() );
+			cell.value()->~T();
+			cell.seq.store( pos + i + _mask + 1, std::memory_order_release );
+		}
+		_notFull.notify();
+		return k;
+	}
+
+	template<typename T>
+	inline bool MPMCQueue<T>::tryPush( const T& value )
+	{
+		return tryPushBatch( &value, 1 ) == 1;
+	}
+
+	template<typename T>
+	inline bool MPMCQueue<T>::tryPop( T& value )
+	{
+		return tryPopBatch( &value, 1 ) == 1;
+	}
+
+	template<typename T>
+	inline void MPMCQueue<T>::push( const T& value )
+	{
+		while( !tryPush( value ) )
+			_notFull.wait( [ this ]() { return size() < capacity(); } );
+	}
+
+	template<typename T>
+	inline void MPMCQueue<T>::pop( T& value )
+	{
+		while( !tryPop( value ) )
+			_notEmpty.wait( [ this ]() { return size() > 0; } );
+	}
+
+	template<typename T>
+	inline bool MPMCQueue<T>::push( const T& value, size_t timeoutms )
+	{
+		Time start;
+		while( !tryPush( value ) ) {
+			ssize_t left = ( ssize_t ) timeoutms - ( ssize_t ) start.elapsedMilliSeconds();
+			if( left <= 0 || !_notFull.wait( [ this ]() { return size() < capacity(); }, left ) )
+				return tryPush( value );
+		}
+		return true;
+	}
+
+	template<typename T>
+	inline bool MPMCQueue<T>::pop( T& value, size_t timeoutms )
+	{
+		Time start;
+		while( !tryPop( value ) ) {
+			ssize_t left = ( ssize_t ) timeoutms - ( ssize_t ) start.elapsedMilliSeconds();
+			if( left <= 0 || !_notEmpty.wait( [ this ]() { return size() > 0; }, left ) )
+				return tryPop( value );
+		}
+		return true;
+	}
+
+	template<typename T>
+	inline void MPMCQueue<T>::pushBatch( const T* values, size_t n )
+	{
+		while( n ) {
+			size_t pushed = tryPushBatch( values, n );
+			values += pushed;
+			n -= pushed;
+			if( n )
+				_notFull.wait( [ this ]() { return size() < capacity(); } );
+		}
+	}
+
+	template<typename T>
+	inline size_t MPMCQueue<T>::popBatch( T* values, size_t n )
+	{
+		size_t popped = 0;
+		while( n && !( popped = tryPopBatch( values, n ) ) )
+			_notEmpty.wait( [ this ]() { return size() > 0; } );
+		return popped;
+	}
+
+}
+
+#endif
@@ -31,6 +31,7 @@
 #include <cvt/gfx/ILoader.h>
 #include <cvt/gfx/ISaver.h>
 #include <cvt/geom/scene/SceneLoader.h>
+#include <cvt/geom/scene/SceneSaver.h>
 #include <cvt/util/String.h>
 #include <vector>
 #include <map>
@@ -53,6 +54,7 @@ namespace cvt {
 			ISaver* getISaverForFilename( const String& name );
 
 			SceneLoader* getSceneLoaderForFilename( const String& name );
+			SceneSaver* getSceneSaverForFilename( const String& name );
 
 		private:
 			PluginManager();
@@ -66,6 +68,7 @@ namespace cvt {
 			std::vector<ILoader*> _iloaders;
 			std::vector<ISaver*> _isavers;
 			std::vector<SceneLoader*> _sceneloaders;
+			std::vector<SceneSaver*> _scenesavers;
 			std::map< const String, IFilter*> _ifiltermap;
 
 			std::vector<String>	  _pluginPaths;
@@ -92,6 +95,10 @@ namespace cvt {
 			delete *it;
 		_sceneloaders.clear();
 
+		for( std::vector<SceneSaver*>::iterator it = _scenesavers.begin(), end = _scenesavers.end(); it != end; ++it  )
+			delete *it;
+		_scenesavers.clear();
+
 		for( std::vector<PluginFile*>::iterator it = _plugins.begin(), end = _plugins.end(); it != end; ++it  )
 			delete *it;
 		_plugins.clear();
@@ -127,6 +134,11 @@ namespace cvt {
 					_sceneloaders.push_back( ( SceneLoader* ) plugin );
 				}
 				break;
+			case PLUGIN_SCENESAVER:
+				{
+					_scenesavers.push_back( ( SceneSaver* ) plugin );
+				}
+				break;
 			default:
 				break;
 		}
@@ -194,6 +206,17 @@ namespace cvt {
 		return NULL;
 	}
 
+	inline SceneSaver* PluginManager::getSceneSaverForFilename( const String& name )
+	{
+		for( std::vector<SceneSaver*>::iterator it = _scenesavers.begin(), end = _scenesavers.end(); it != end; ++it  ) {
+			for( size_t i = 0, end = ( *it )->sizeExtensions(); i < end; i++ ) {
+				if( name.hasSuffix( ( *it )->extension( i ) ) )
+					return *it;
+			}
+		}
+		return NULL;
+	}
+
 }
 
 #endif
@@ -0,0 +1,237 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/util/SPSCQueue.h>
+#include <cvt/util/MPMCQueue.h>
+#include <cvt/util/TQueue.h>
+#include <cvt/util/Thread.h>
+#include <cvt/util/Time.h>
+#include <cvt/util/CVTTest.h>
+
+#include <memory>
+#include <vector>
+
+using namespace cvt;
+
+static const size_t QUEUETEST_ITEMS = 100000;
+
+template<typename Q>
+class QueueTestProducer : public Thread<Q>
+{
+	public:
+		QueueTestProducer( size_t id ) : _id( id ) {}
+
+		void execute( Q* queue )
+		{
+			size_t values[ 7 ];
+			size_t i = 0;
+			while( i < QUEUETEST_ITEMS ) {
+				/* alternate single and batch pushes, values encode producer and index */
+				if( i % 3 ) {
+					queue->push( _id * QUEUETEST_ITEMS + i );
+					i++;
+				} else {
+					size_t n = Math::min( ( size_t ) 7, QUEUETEST_ITEMS - i );
+					for( size_t k = 0; k < n; k++ )
+						values[ k ] = _id * QUEUETEST_ITEMS + i + k;
+					queue->pushBatch( values, n );
+					i += n;
+				}
+			}
+		}
+
+	private:
+		size_t _id;
+};
+
+template<typename Q>
+class QueueTestConsumer : public Thread<Q>
+{
+	public:
+		QueueTestConsumer( size_t numProducers, size_t count ) :
+			_count( count ), _ordered( true ), _sum( 0 ), _last( numProducers, 0 ), _first( numProducers, true )
+		{
+		}
+
+		void execute( Q* queue )
+		{
+			size_t values[ 5 ];
+			size_t n = 0;
+			while( n < _count ) {
+				size_t num = queue->popBatch( values, Math::min( ( size_t ) 5, _count - n ) );
+				for( size_t k = 0; k < num; k++ )
+					check( values[ k ] );
+				n += num;
+			}
+		}
+
+		bool	ordered() const { return _ordered; }
+		size_t	sum() const { return _sum; }
+
+	private:
+		void check( size_t v )
+		{
+			size_t p = v / QUEUETEST_ITEMS;
+			size_t i = v % QUEUETEST_ITEMS;
+			if( !_first[ p ] && i <= _last[ p ] )
+				_ordered = false;
+			_first[ p ] = false;
+			_last[ p ] = i;
+			_sum += v;
+		}
+
+		size_t				_count;
+		bool				_ordered;
+		size_t				_sum;
+		std::vector<size_t> _last;
+		std::vector<bool>	_first;
+};
+
+template<typename Q>
+static bool _queueProducerConsumer( size_t numProducers, size_t numConsumers )
+{
+	Q queue( 64 );
+	std::vector<QueueTestProducer<Q>*> producers;
+	std::vector<QueueTestConsumer<Q>*> consumers;
+
+	/* the consumers split the items evenly */
+	size_t total = numProducers * QUEUETEST_ITEMS;
+	for( size_t i = 0; i < numConsumers; i++ ) {
+		consumers.push_back( new QueueTestConsumer<Q>( numProducers, total / numConsumers ) );
+		consumers.back()->run( &queue );
+	}
+	for( size_t i = 0; i < numProducers; i++ ) {
+		producers.push_back( new QueueTestProducer<Q>( i ) );
+		producers.back()->run( &queue );
+	}
+
+	bool ordered = true;
+	size_t sum = 0;
+	for( size_t i = 0; i < numProducers; i++ ) {
+		producers[ i ]->join();
+		delete producers[ i ];
+	}
+	for( size_t i = 0; i < numConsumers; i++ ) {
+		consumers[ i ]->join();
+		ordered &= consumers[ i ]->ordered();
+		sum += consumers[ i ]->sum();
+		delete consumers[ i ];
+	}
+
+	return ordered && sum == total * ( total - 1 ) / 2 && queue.empty();
+}
+
+BEGIN_CVTTEST( Queue )
+	bool result = true;
+	bool b;
+
+	{
+		SPSCQueue<int> q( 5 );
+		int v[ 16 ];
+		for( int i = 0; i < 16; i++ )
+			v[ i ] = i;
+		b = q.capacity() == 8;
+		b &= q.tryPushBatch( v, 16 ) == 8;
+		b &= !q.tryPush( 8 );
+		b &= q.tryPopBatch( v, 3 ) == 3 && v[ 0 ] == 0 && v[ 2 ] == 2;
+		b &= q.tryPush( 8 ) && q.size() == 6;
+		int x = -1;
+		while( q.tryPop( x ) )
+			;
+		b &= x == 8 && q.empty();
+		CVTTEST_PRINT( "SPSCQueue try/batch", b );
+		result &= b;
+	}
+
+	{
+		MPMCQueue<int> q( 4 );
+		int v[ 8 ] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+		b = q.tryPushBatch( v, 8 ) == 4;
+		b &= q.tryPopBatch( v, 8 ) == 4 && v[ 3 ] == 3;
+
+		Time t;
+		int x = -1;
+		b &= !q.pop( x, 20 );
+		b &= t.elapsedMilliSeconds() >= 19.0;
+		b &= q.push( 42, 10 ) && q.pop( x, 10 ) && x == 42;
+		CVTTEST_PRINT( "MPMCQueue try/batch/timed", b );
+		result &= b;
+	}
+
+	b = _queueProducerConsumer<SPSCQueue<size_t> >( 1, 1 );
+	CVTTEST_PRINT( "SPSCQueue producer/consumer", b );
+	result &= b;
+
+	b = _queueProducerConsumer<MPMCQueue<size_t> >( 3, 3 );
+	CVTTEST_PRINT( "MPMCQueue 3 producers/3 consumers", b );
+	result &= b;
+
+	{
+		/* more elements than the capacity without a consumer go to the overflow list */
+		TQueue<int> q( 16 );
+		for( int i = 0; i < 1000; i++ )
+			q.enqueue( i );
+		b = true;
+		for( int i = 0; i < 500; i++ )
+			b &= q.waitNext() == i;
+		for( int i = 1000; i < 1100; i++ )
+			q.enqueue( i );
+		for( int i = 500; i < 1100; i++ )
+			b &= q.waitNext() == i;
+		CVTTEST_PRINT( "TQueue order with overflow", b );
+		result &= b;
+	}
+
+	{
+		/* popped elements are not kept alive by the queue, queued ones are released with it */
+		std::shared_ptr<int> value( new int( 42 ) ), out;
+		SPSCQueue<std::shared_ptr<int> >* spsc = new SPSCQueue<std::shared_ptr<int> >( 4 );
+		MPMCQueue<std::shared_ptr<int> >* mpmc = new MPMCQueue<std::shared_ptr<int> >( 4 );
+		TQueue<std::shared_ptr<int> >* tq = new TQueue<std::shared_ptr<int> >( 4 );
+
+		b = spsc->tryPush( value ) && mpmc->tryPush( value ) && value.use_count() == 3;
+		b &= spsc->tryPop( out ) && out == value && value.use_count() == 3;
+		out.reset();
+		b &= mpmc->tryPop( out ) && out == value && value.use_count() == 2;
+		out.reset();
+		b &= value.use_count() == 1;
+
+		spsc->push( value );
+		mpmc->push( value );
+		tq->enqueue( value );
+		b &= value.use_count() == 4;
+		out = tq->waitNext();
+		b &= out == value && value.use_count() == 4;
+		out.reset();
+		b &= value.use_count() == 3;
+		delete spsc;
+		delete mpmc;
+		delete tq;
+		b &= value.use_count() == 1;
+		CVTTEST_PRINT( "release of popped and queued elements", b );
+		result &= b;
+	}
+
+	return result;
+END_CVTTEST
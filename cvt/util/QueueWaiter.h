@@ -0,0 +1,109 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_QUEUEWAITER_H
+#define CVT_QUEUEWAITER_H
+
+#include <cvt/util/Mutex.h>
+#include <cvt/util/Condition.h>
+#include <cvt/util/Time.h>
+
+#include <atomic>
+#include <sys/types.h>
+
+namespace cvt {
+
+	/**
+	  @brief Blocking support for the lock-free queues
+
+	  Waiting threads spin shortly and then sleep on a condition. The mutex is only touched by
+	  notify() while a thread is actually sleeping, so the non-blocking path of the queues stays
+	  lock-free.
+	 */
+	class QueueWaiter {
+		public:
+			QueueWaiter() : _waiters( 0 ) {}
+
+			/* wait until ready() returns true or the timeout in ms expires (-1: no timeout), returns ready() */
+			template<typename PRED>
+			bool wait( PRED ready, ssize_t timeoutms = -1 );
+
+			/* call after the state checked by ready() changed */
+			void notify();
+
+		private:
+			QueueWaiter( const QueueWaiter& );
+			QueueWaiter& operator=( const QueueWaiter& );
+
+			static const size_t SPIN_COUNT = 128;
+
+			std::atomic<int>	_waiters;
+			Mutex				_mutex;
+			Condition			_cond;
+	};
+
+	template<typename PRED>
+	inline bool QueueWaiter::wait( PRED ready, ssize_t timeoutms )
+	{
+		for( size_t i = 0; i < SPIN_COUNT; i++ ) {
+			if( ready() )
+				return true;
+		}
+		if( timeoutms == 0 )
+			return false;
+
+		Time start;
+		bool ret;
+		_mutex.lock();
+		/* register before checking the state, pairs with the fence in notify() */
+		_waiters.fetch_add( 1 );
+		while( !( ret = ready() ) ) {
+			if( timeoutms < 0 ) {
+				_cond.wait( _mutex );
+			} else {
+				double left = ( double ) timeoutms - start.elapsedMilliSeconds();
+				if( left <= 0.0 || !_cond.wait( _mutex, ( size_t ) left + 1 ) ) {
+					ret = ready();
+					break;
+				}
+			}
+		}
+		_waiters.fetch_sub( 1 );
+		_mutex.unlock();
+		return ret;
+	}
+
+	inline void QueueWaiter::notify()
+	{
+		std::atomic_thread_fence( std::memory_order_seq_cst );
+		if( _waiters.load( std::memory_order_relaxed ) ) {
+			_mutex.lock();
+			_cond.notifyAll();
+			_mutex.unlock();
+		}
+	}
+
+}
+
+#endif
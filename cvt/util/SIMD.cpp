@@ -34,6 +34,8 @@
 #include <cvt/util/SIMDSSE41.h>
 #include <cvt/util/SIMDSSE42.h>
 #include <cvt/util/SIMDAVX.h>
+#include <cvt/util/SIMDAVX2.h>
+#include <cvt/util/SIMDAVX512.h>
 #include <cvt/util/CPU.h>
 
 
@@ -751,9 +753,13 @@ namespace cvt {
         if( type == SIMD_BEST ) {
             CPUFeatures cpuf;
             cpuf = cpuFeatures();
-            if( cpuf & CPU_AVX ){
+            if( ( cpuf & CPU_AVX512F ) && ( cpuf & CPU_AVX512BW ) && ( cpuf & CPU_AVX2 ) && ( cpuf & CPU_FMA ) ){
+                return new SIMDAVX512();
+            } else if( ( cpuf & CPU_AVX2 ) && ( cpuf & CPU_FMA ) ){
+                return new SIMDAVX2();
+            } else if( ( cpuf & CPU_AVX ) && ( cpuf & CPU_POPCNT ) ){
                 return new SIMDAVX();
-            } else if( cpuf & CPU_SSE4_2 ){
+            } else if( ( cpuf & CPU_SSE4_2 ) && ( cpuf & CPU_POPCNT ) ){
                 return new SIMDSSE42();
             } else if( cpuf & CPU_SSE4_1 ) {
                 return new SIMDSSE41();
@@ -779,6 +785,8 @@ namespace cvt {
                 case SIMD_SSE41: return new SIMDSSE41();
                 case SIMD_SSE42: return new SIMDSSE42();
                 case SIMD_AVX: return new SIMDAVX();
+                case SIMD_AVX2: return new SIMDAVX2();
+                case SIMD_AVX512: return new SIMDAVX512();
             }
         }
     }
@@ -787,9 +795,13 @@ namespace cvt {
     {
         CPUFeatures cpuf;
         cpuf = cpuFeatures();
-        if( cpuf & CPU_AVX ){
+        if( ( cpuf & CPU_AVX512F ) && ( cpuf & CPU_AVX512BW ) && ( cpuf & CPU_AVX2 ) && ( cpuf & CPU_FMA ) ){
+            return SIMD_AVX512;
+        } else if( ( cpuf & CPU_AVX2 ) && ( cpuf & CPU_FMA ) ){
+            return SIMD_AVX2;
+        } else if( ( cpuf & CPU_AVX ) && ( cpuf & CPU_POPCNT ) ){
             return SIMD_AVX;
-        } else if( cpuf & CPU_SSE4_2 ){
+        } else if( ( cpuf & CPU_SSE4_2 ) && ( cpuf & CPU_POPCNT ) ){
             return SIMD_SSE42;
         } else if( cpuf & CPU_SSE4_1 ) {
             return SIMD_SSE41;
@@ -1242,6 +1254,26 @@ namespace cvt {
         return ssd;
     }
 
+    float SIMD::dot( const float* src1, const float* src2, const size_t n ) const
+    {
+        size_t i = n >> 2;
+
+        float dot = 0.0f;
+        while( i-- ) {
+            dot += *src1++ * *src2++;
+            dot += *src1++ * *src2++;
+            dot += *src1++ * *src2++;
+            dot += *src1++ * *src2++;
+        }
+
+        i = n & 0x03;
+        while( i-- ) {
+            dot += *src1++ * *src2++;
+        }
+
+        return dot;
+    }
+
     float SIMD::SSD( uint8_t const* src1, uint8_t const* src2, const size_t n ) const
     {
         size_t i = n >> 2;
@@ -4530,6 +4562,95 @@ namespace cvt {
         }
     }
 
+    /* index of tap i for the output centered at source pixel c, taps outside [ 0, last ] are mirrored
+       at c like in pyrdownHalfHorizontal_1u8_to_1u16 and clamped for rows shorter than the kernel */
+    static inline size_t _pyrdownTap( ssize_t i, ssize_t c, ssize_t last )
+    {
+        if( i < 0 || i > last )
+            i = Math::clamp<ssize_t>( 2 * c - i, 0, last );
+        return i;
+    }
+
+    void SIMD::pyrdownHalfHorizontal_4u8_to_4u16( uint16_t* dst, const uint8_t* src, size_t n ) const
+    {
+        const ssize_t last = ( ssize_t ) n - 1;
+        size_t n2 = n >> 1;
+
+        for( size_t x = 0; x < n2; x++ ) {
+            const ssize_t xc = 2 * ( ssize_t ) x + 1;
+            const uint8_t* s0 = src + 4 * _pyrdownTap( xc - 2, xc, last );
+            const uint8_t* s1 = src + 4 * ( xc - 1 );
+            const uint8_t* s2 = src + 4 * xc;
+            const uint8_t* s3 = src + 4 * _pyrdownTap( xc + 1, xc, last );
+            const uint8_t* s4 = src + 4 * _pyrdownTap( xc + 2, xc, last );
+            for( size_t c = 0; c < 4; c++ ) {
+                *dst++ = ( uint16_t ) s0[ c ] + ( uint16_t ) s4[ c ] +
+                         ( ( ( uint16_t ) s1[ c ] + ( uint16_t ) s3[ c ] ) << 2 ) + 6 * ( uint16_t ) s2[ c ];
+            }
+        }
+    }
+
+    void SIMD::pyrdownHalfHorizontal_1f( float* dst, const float* src, size_t n ) const
+    {
+        const ssize_t last = ( ssize_t ) n - 1;
+        size_t n2 = n >> 1;
+
+        for( size_t x = 0; x < n2; x++ ) {
+            const ssize_t xc = 2 * ( ssize_t ) x + 1;
+            float s0 = src[ _pyrdownTap( xc - 2, xc, last ) ];
+            float s1 = src[ xc - 1 ];
+            float s2 = src[ xc ];
+            float s3 = src[ _pyrdownTap( xc + 1, xc, last ) ];
+            float s4 = src[ _pyrdownTap( xc + 2, xc, last ) ];
+            *dst++ = ( s0 + s4 + 4.0f * ( s1 + s3 ) + 6.0f * s2 ) * ( 1.0f / 16.0f );
+        }
+    }
+
+    void SIMD::pyrdownHalfHorizontal_4f( float* dst, const float* src, size_t n ) const
+    {
+        const ssize_t last = ( ssize_t ) n - 1;
+        size_t n2 = n >> 1;
+
+        for( size_t x = 0; x < n2; x++ ) {
+            const ssize_t xc = 2 * ( ssize_t ) x + 1;
+            const float* s0 = src + 4 * _pyrdownTap( xc - 2, xc, last );
+            const float* s1 = src + 4 * ( xc - 1 );
+            const float* s2 = src + 4 * xc;
+            const float* s3 = src + 4 * _pyrdownTap( xc + 1, xc, last );
+            const float* s4 = src + 4 * _pyrdownTap( xc + 2, xc, last );
+            for( size_t c = 0; c < 4; c++ )
+                *dst++ = ( s0[ c ] + s4[ c ] + 4.0f * ( s1[ c ] + s3[ c ] ) + 6.0f * s2[ c ] ) * ( 1.0f / 16.0f );
+        }
+    }
+
+    void SIMD::pyrdownHalfVertical_1f( float* dst, float* rows[ 5 ], size_t n ) const
+    {
+        const float* src1 = rows[ 0 ];
+        const float* src2 = rows[ 1 ];
+        const float* src3 = rows[ 2 ];
+        const float* src4 = rows[ 3 ];
+        const float* src5 = rows[ 4 ];
+
+        while( n-- )
+            *dst++ = ( *src1++ + *src5++ + 4.0f * ( *src2++ + *src4++ ) + 6.0f * *src3++ ) * ( 1.0f / 16.0f );
+    }
+
+    uint16_t SIMD::SGMPathStep_u16( uint16_t* dst, uint16_t* sum, const uint16_t* prev, const uint8_t* cost, uint16_t prevmin, uint16_t P1, uint16_t P2, size_t n ) const
+    {
+        uint16_t pmin = 0x7fff;
+        uint16_t jump = prevmin + P2;
+
+        for( size_t d = 0; d < n; d++ ) {
+            uint16_t v = Math::min<uint16_t>( prev[ d ], jump );
+            v = Math::min<uint16_t>( v, Math::min<uint16_t>( prev[ d - 1 ], prev[ d + 1 ] ) + P1 );
+            v = cost[ d ] + v - prevmin;
+            dst[ d ] = v;
+            pmin = Math::min( pmin, v );
+            sum[ d ] = ( uint16_t ) Math::min<uint32_t>( ( uint32_t ) sum[ d ] + v, 0xffff );
+        }
+        return pmin;
+    }
+
     void SIMD::warpLinePerspectiveBilinear1f( float* dst, const float* _src, size_t srcStride, size_t srcWidth, size_t srcHeight, const float* point, const float* direction, const size_t n ) const
     {
         const uint8_t* src = ( const uint8_t* ) _src;
@@ -6688,6 +6809,32 @@ namespace cvt {
         return d;
     }
 
+    void SIMD::hammingDistances( uint32_t* dst, const uint8_t* query, const uint8_t* descs, size_t stride, size_t count, size_t n ) const
+    {
+        while( count-- ) {
+            *dst++ = hammingDistance( query, descs, n );
+            descs += stride;
+        }
+    }
+
+    void SIMD::hammingDistanceMatrix( uint32_t* dst, size_t dstStride, const uint8_t* a, size_t strideA, size_t m,
+                                      const uint8_t* b, size_t strideB, size_t count, size_t n ) const
+    {
+        /* process b in column blocks that stay in the L1 cache while all rows are evaluated */
+        size_t block = Math::max<size_t>( 1, 16384 / Math::max<size_t>( strideB, 1 ) );
+
+        for( size_t c = 0; c < count; c += block ) {
+            size_t num = Math::min( block, count - c );
+            const uint8_t* pa = a;
+            uint8_t* pdst = ( uint8_t* ) ( dst + c );
+            for( size_t r = 0; r < m; r++ ) {
+                hammingDistances( ( uint32_t* ) pdst, pa, b + c * strideB, strideB, num, n );
+                pa += strideA;
+                pdst += dstStride;
+            }
+        }
+    }
+
     /*
     {
         size_t d = 0;
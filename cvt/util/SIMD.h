@@ -45,6 +45,8 @@ namespace cvt {
         SIMD_SSE41,
         SIMD_SSE42,
         SIMD_AVX,
+        SIMD_AVX2,
+        SIMD_AVX512,
         SIMD_BEST
     };
 
@@ -151,6 +153,15 @@ namespace cvt {
             virtual float SSD( const float* src1, const float* src2, const size_t n ) const;
             virtual float SSD( uint8_t const* src1, uint8_t const* src2, const size_t n ) const;
 
+            /**
+             * @brief dot   dot product
+             * @param src1  first input
+             * @param src2  second input
+             * @param n     size of array
+             * @return \sum_i src1[ i ] * src2[ i ]
+             */
+            virtual float dot( const float* src1, const float* src2, const size_t n ) const;
+
             virtual void meanVariance( float& mean, float& variance, const float* src, const size_t n ) const;
 
             /*
@@ -322,6 +333,19 @@ namespace cvt {
             virtual void pyrdownHalfHorizontal_1u8_to_1u16( uint16_t* dst, const uint8_t* src, size_t n ) const;
             /* convolve with vertical gaussian [ 1 4 6 4 1 ] and store the odd rows in u8 dst by >> 8 */
             virtual void pyrdownHalfVertical_1u16_to_1u8( uint8_t* dst, uint16_t* rows[ 5 ], size_t n ) const;
+            /* same as pyrdownHalfHorizontal_1u8_to_1u16 for four interleaved channels, n is the number of pixels */
+            virtual void pyrdownHalfHorizontal_4u8_to_4u16( uint16_t* dst, const uint8_t* src, size_t n ) const;
+            /* normalized horizontal gaussian [ 1 4 6 4 1 ] / 16 of the odd pixels, borders are mirrored like in pyrdownHalfHorizontal_1u8_to_1u16 */
+            virtual void pyrdownHalfHorizontal_1f( float* dst, const float* src, size_t n ) const;
+            virtual void pyrdownHalfHorizontal_4f( float* dst, const float* src, size_t n ) const;
+            /* normalized vertical gaussian [ 1 4 6 4 1 ] / 16 */
+            virtual void pyrdownHalfVertical_1f( float* dst, float* rows[ 5 ], size_t n ) const;
+
+            /* semi-global matching path step over n disparities:
+               dst[ d ] = cost[ d ] + min( prev[ d ], prev[ d - 1 ] + P1, prev[ d + 1 ] + P1, prevmin + P2 ) - prevmin,
+               dst is added to sum with unsigned saturation. prev[ -1 ] and prev[ n ] have to be readable and set to 0x7fff,
+               all path costs have to stay below 0x7fff. Returns the minimum of dst */
+            virtual uint16_t SGMPathStep_u16( uint16_t* dst, uint16_t* sum, const uint16_t* prev, const uint8_t* cost, uint16_t prevmin, uint16_t P1, uint16_t P2, size_t n ) const;
 
             virtual void warpLinePerspectiveBilinear1f( float* dst, const float* src, size_t srcStride, size_t srcWidth, size_t srcHeight,
                                                         const float* point, const float* normal, const size_t n ) const;
@@ -377,6 +401,11 @@ namespace cvt {
             virtual void bayer_RGBAu8_BGu8( uint8_t* dst, const uint32_t* src, size_t n ) const;
 
             virtual size_t hammingDistance( const uint8_t* src1, const uint8_t* src2, size_t n ) const;
+            /* hamming distances of the n byte descriptor query to count descriptors, descriptor i starts at descs + i * stride bytes */
+            virtual void hammingDistances( uint32_t* dst, const uint8_t* query, const uint8_t* descs, size_t stride, size_t count, size_t n ) const;
+            /* m x count distance matrix of the descriptors in a and b, row i of dst starts at dst + i * dstStride bytes */
+            void hammingDistanceMatrix( uint32_t* dst, size_t dstStride, const uint8_t* a, size_t strideA, size_t m,
+                                        const uint8_t* b, size_t strideB, size_t count, size_t n ) const;
 
             // prefix sum for 1 channel images
             virtual void prefixSum1_u8_to_f( float * dst, size_t dstStride, const uint8_t* src, size_t srcStride, size_t width, size_t height ) const;
@@ -116,6 +116,41 @@ namespace cvt
 		return ssd;
 	}
 
+	float SIMDAVX::dot( const float* src1, const float* src2, const size_t n ) const
+	{
+		size_t i = n >> 3;
+
+		__m256 sum = _mm256_setzero_ps( );
+		if( ( ( size_t ) src1 | ( size_t ) src2 ) & 0x1f ) {
+			while( i-- ) {
+				sum = _mm256_add_ps( sum, _mm256_mul_ps( _mm256_loadu_ps( src1 ), _mm256_loadu_ps( src2 ) ) );
+				src1 += 8; src2 += 8;
+			}
+		} else {
+			while( i-- ) {
+				sum = _mm256_add_ps( sum, _mm256_mul_ps( _mm256_load_ps( src1 ), _mm256_load_ps( src2 ) ) );
+				src1 += 8; src2 += 8;
+			}
+		}
+
+		float dot = 0.0f;
+
+        __m128 sum2 = _mm_add_ps( _mm256_castps256_ps128( sum ), _mm256_extractf128_ps( sum, 1 ) );
+        sum2 = _mm_add_ps( sum2, _mm_movehl_ps( sum2, sum2 ) );
+        sum2 = _mm_add_ps( sum2, _mm_shuffle_ps( sum2, sum2, _MM_SHUFFLE( 0, 0, 0, 1 ) ) );
+        _mm_store_ss( &dot, sum2 );
+
+		i = n & 0x7;
+		while( i-- ) {
+			dot += *src1++ * *src2++;
+		}
+
+		// Zero upper half of AVX registers to avoid AVX-SSE transition penalties
+		_mm256_zeroupper( );
+
+		return dot;
+	}
+
 	float SIMDAVX::NCC( float const* src1, float const* src2, const size_t n ) const
 	{
 		size_t i = n >> 3;
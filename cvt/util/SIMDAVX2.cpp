@@ -0,0 +1,809 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/util/SIMDAVX2.h>
+#include <immintrin.h>
+
+namespace cvt
+{
+	/* inclusive prefix sum of the 8 elements */
+	static inline __m256 _mm256_prefixsum_ps( __m256 x )
+	{
+		__m256 t;
+		x = _mm256_add_ps( x, _mm256_castsi256_ps( _mm256_slli_si256( _mm256_castps_si256( x ), 4 ) ) );
+		x = _mm256_add_ps( x, _mm256_castsi256_ps( _mm256_slli_si256( _mm256_castps_si256( x ), 8 ) ) );
+		t = _mm256_permute2f128_ps( x, x, 0x08 );
+		t = _mm256_shuffle_ps( t, t, _MM_SHUFFLE( 3, 3, 3, 3 ) );
+		return _mm256_add_ps( x, t );
+	}
+
+	static inline __m256 _mm256_broadcastlast_ps( __m256 x )
+	{
+		x = _mm256_permute2f128_ps( x, x, 0x11 );
+		return _mm256_shuffle_ps( x, x, _MM_SHUFFLE( 3, 3, 3, 3 ) );
+	}
+
+	/* saturate 2 x 8 int32 to 16 uint8 */
+	static inline __m128i _mm256_pack_epi32_u8( __m256i a, __m256i b )
+	{
+		__m256i p = _mm256_packs_epi32( a, b );
+		p = _mm256_permute4x64_epi64( p, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+		return _mm_packus_epi16( _mm256_castsi256_si128( p ), _mm256_extracti128_si256( p, 1 ) );
+	}
+
+	/* same rounding as the scalar _floor in SIMD.cpp */
+	static inline __m256i _mm256_floor_epi32( __m256 x )
+	{
+		return _mm256_sub_epi32( _mm256_cvttps_epi32( x ), _mm256_srli_epi32( _mm256_castps_si256( x ), 31 ) );
+	}
+
+	void SIMDAVX2::ConvolveHorizontal1f( float* dst, const float* src, const size_t width, float const* weights, const size_t wn, IBorderType btype ) const
+	{
+		if( wn == 1 ) {
+			MulValue1f( dst, src, *weights, width );
+			return;
+		}
+
+		ssize_t b1 = ( wn >> 1 );
+		ssize_t b2 = wn - b1 - 1;
+		ssize_t x;
+
+		for( x = 0; x < b1 && x < ( ssize_t ) width; x++ ) {
+			float tmp = 0;
+			for( size_t k = 0; k < wn; k++ ) {
+				ssize_t pos = IBorder::value<ssize_t>( x - b1 + k, width, btype );
+				tmp += weights[ k ] * src[ pos ];
+			}
+			*dst++ = tmp;
+		}
+
+		for( ; x <= ( ssize_t ) width - b2 - 16; x += 16 ) {
+			__m256 f;
+			__m256 s0 = _mm256_setzero_ps(), s1 = s0;
+			const float* psrc = src + x - b1;
+
+			for( size_t k = 0; k < wn; k++ ) {
+				f = _mm256_broadcast_ss( weights + k );
+				s0 = _mm256_fmadd_ps( _mm256_loadu_ps( psrc + k ), f, s0 );
+				s1 = _mm256_fmadd_ps( _mm256_loadu_ps( psrc + k + 8 ), f, s1 );
+			}
+			_mm256_storeu_ps( dst, s0 );
+			_mm256_storeu_ps( dst + 8, s1 );
+			dst += 16;
+		}
+
+		for( ; x < ( ssize_t ) width - b2; x++ ) {
+			float tmp = 0;
+			for( size_t k = 0; k < wn; k++ ) {
+				ssize_t pos = x - b1 + k;
+				tmp += weights[ k ] * src[ pos ];
+			}
+			*dst++ = tmp;
+		}
+
+		for( ; x < ( ssize_t ) width; x++ ) {
+			float tmp = 0;
+			for( size_t k = 0; k < wn; k++ ) {
+				ssize_t pos = IBorder::value<ssize_t>( x - b1 + k, width, btype );
+				tmp += weights[ k ] * src[ pos ];
+			}
+			*dst++ = tmp;
+		}
+		_mm256_zeroupper();
+	}
+
+	void SIMDAVX2::ConvolveHorizontal4f( float* dst, const float* src, const size_t width, float const* weights, const size_t wn, IBorderType btype ) const
+	{
+		if( wn == 1 ) {
+			MulValue1f( dst, src, *weights, width * 4 );
+			return;
+		}
+
+		ssize_t b1 = ( wn >> 1 );
+		ssize_t b2 = wn - b1 - 1;
+		ssize_t x;
+
+		for( x = 0; x < b1 && x < ( ssize_t ) width; x++ ) {
+			float tmp[ 4 ] = { 0, 0, 0, 0 };
+			for( size_t k = 0; k < wn; k++ ) {
+				ssize_t pos = IBorder::value<ssize_t>( x - b1 + k, width, btype ) << 2;
+				tmp[ 0 ] += weights[ k ] * src[ pos + 0 ];
+				tmp[ 1 ] += weights[ k ] * src[ pos + 1 ];
+				tmp[ 2 ] += weights[ k ] * src[ pos + 2 ];
+				tmp[ 3 ] += weights[ k ] * src[ pos + 3 ];
+			}
+			*dst++ = tmp[ 0 ];
+			*dst++ = tmp[ 1 ];
+			*dst++ = tmp[ 2 ];
+			*dst++ = tmp[ 3 ];
+		}
+
+		/* two pixels per register */
+		for( ; x <= ( ssize_t ) width - b2 - 4; x += 4 ) {
+			__m256 f;
+			__m256 s0 = _mm256_setzero_ps(), s1 = s0;
+			const float* psrc = src + ( ( x - b1 ) << 2 );
+
+			for( size_t k = 0; k < wn; k++ ) {
+				f = _mm256_broadcast_ss( weights + k );
+				s0 = _mm256_fmadd_ps( _mm256_loadu_ps( psrc + ( k << 2 ) ), f, s0 );
+				s1 = _mm256_fmadd_ps( _mm256_loadu_ps( psrc + ( k << 2 ) + 8 ), f, s1 );
+			}
+			_mm256_storeu_ps( dst, s0 );
+			_mm256_storeu_ps( dst + 8, s1 );
+			dst += 16;
+		}
+
+		for( ; x < ( ssize_t ) width; x++ ) {
+			float tmp[ 4 ] = { 0, 0, 0, 0 };
+			for( size_t k = 0; k < wn; k++ ) {
+				ssize_t pos = IBorder::value<ssize_t>( x - b1 + k, width, btype ) << 2;
+				tmp[ 0 ] += weights[ k ] * src[ pos + 0 ];
+				tmp[ 1 ] += weights[ k ] * src[ pos + 1 ];
+				tmp[ 2 ] += weights[ k ] * src[ pos + 2 ];
+				tmp[ 3 ] += weights[ k ] * src[ pos + 3 ];
+			}
+			*dst++ = tmp[ 0 ];
+			*dst++ = tmp[ 1 ];
+			*dst++ = tmp[ 2 ];
+			*dst++ = tmp[ 3 ];
+		}
+		_mm256_zeroupper();
+	}
+
+	void SIMDAVX2::ConvolveHorizontalSym1f( float* dst, const float* src, const size_t width, float const* weights, const size_t wn, IBorderType btype ) const
+	{
+		if( wn == 1 ) {
+			MulValue1f( dst, src, *weights, width );
+			return;
+		}
+
+		ssize_t b1 = ( wn >> 1 );
+		ssize_t b2 = wn - b1 - 1;
+		ssize_t x;
+		const float* wsym = weights + b1;
+
+		for( x = 0; x < b1 && x < ( ssize_t ) width; x++ ) {
+			float tmp = 0;
+			for( size_t k = 0; k < wn; k++ ) {
+				ssize_t pos = IBorder::value<ssize_t>( x - b1 + k, width, btype );
+				tmp += weights[ k ] * src[ pos ];
+			}
+			*dst++ = tmp;
+		}
+
+		for( ; x <= ( ssize_t ) width - b2 - 16; x += 16 ) {
+			__m256 f, s0, s1, x0, x1;
+
+			f = _mm256_broadcast_ss( wsym );
+			s0 = _mm256_mul_ps( _mm256_loadu_ps( src + x ), f );
+			s1 = _mm256_mul_ps( _mm256_loadu_ps( src + x + 8 ), f );
+
+			for( ssize_t k = 1; k <= b1; k++ ) {
+				f = _mm256_broadcast_ss( wsym + k );
+				x0 = _mm256_add_ps( _mm256_loadu_ps( src + x - k ), _mm256_loadu_ps( src + x + k ) );
+				x1 = _mm256_add_ps( _mm256_loadu_ps( src + x - k + 8 ), _mm256_loadu_ps( src + x + k + 8 ) );
+				s0 = _mm256_fmadd_ps( x0, f, s0 );
+				s1 = _mm256_fmadd_ps( x1, f, s1 );
+			}
+			_mm256_storeu_ps( dst, s0 );
+			_mm256_storeu_ps( dst + 8, s1 );
+			dst += 16;
+		}
+
+		for( ; x < ( ssize_t ) width - b2; x++ ) {
+			float tmp = 0;
+			for( size_t k = 0; k < wn; k++ ) {
+				ssize_t pos = x - b1 + k;
+				tmp += weights[ k ] * src[ pos ];
+			}
+			*dst++ = tmp;
+		}
+
+		for( ; x < ( ssize_t ) width; x++ ) {
+			float tmp = 0;
+			for( size_t k = 0; k < wn; k++ ) {
+				ssize_t pos = IBorder::value<ssize_t>( x - b1 + k, width, btype );
+				tmp += weights[ k ] * src[ pos ];
+			}
+			*dst++ = tmp;
+		}
+		_mm256_zeroupper();
+	}
+
+	/* Fixed multiplication ( ( int64 ) a * b + 0x8000 ) >> 16 of eight 16.16 values, bits 16 .. 47 of the product do not depend on the shift type */
+	static inline __m256i _mm256_mul_fixed( __m256i a, __m256i b )
+	{
+		const __m256i rnd = _mm256_set1_epi64x( 0x8000 );
+		__m256i even = _mm256_srli_epi64( _mm256_add_epi64( _mm256_mul_epi32( a, b ), rnd ), 16 );
+		__m256i odd = _mm256_srli_epi64( _mm256_add_epi64( _mm256_mul_epi32( _mm256_srli_epi64( a, 32 ), _mm256_srli_epi64( b, 32 ) ), rnd ), 16 );
+		return _mm256_blend_epi32( even, _mm256_slli_epi64( odd, 32 ), 0xAA );
+	}
+
+	void SIMDAVX2::ConvolveClampVert_fx_to_u8( uint8_t* dst, const Fixed** bufs, const Fixed* weights, size_t numw, size_t width ) const
+	{
+		size_t x;
+		__m256i s0, s1, mul;
+		const __m256i rnd = _mm256_set1_epi32( 0x8000 );
+
+		/* integer arithmetic, the result is identical to the Fixed implementation of SIMD */
+		for( x = 0; x + 16 <= width; x += 16 ) {
+			mul = _mm256_set1_epi32( weights[ 0 ].native() );
+			s0 = _mm256_mul_fixed( _mm256_loadu_si256( ( const __m256i* ) ( bufs[ 0 ] + x ) ), mul );
+			s1 = _mm256_mul_fixed( _mm256_loadu_si256( ( const __m256i* ) ( bufs[ 0 ] + x + 8 ) ), mul );
+
+			for( size_t k = 1; k < numw; k++ ) {
+				mul = _mm256_set1_epi32( weights[ k ].native() );
+				s0 = _mm256_add_epi32( s0, _mm256_mul_fixed( _mm256_loadu_si256( ( const __m256i* ) ( bufs[ k ] + x ) ), mul ) );
+				s1 = _mm256_add_epi32( s1, _mm256_mul_fixed( _mm256_loadu_si256( ( const __m256i* ) ( bufs[ k ] + x + 8 ) ), mul ) );
+			}
+
+			__m256i i0 = _mm256_srai_epi32( _mm256_add_epi32( s0, rnd ), 16 );
+			__m256i i1 = _mm256_srai_epi32( _mm256_add_epi32( s1, rnd ), 16 );
+			_mm_storeu_si128( ( __m128i* ) dst, _mm256_pack_epi32_u8( i0, i1 ) );
+			dst += 16;
+		}
+
+		Fixed tmp;
+		for( ; x < width; x++ ) {
+			tmp = bufs[ 0 ][ x ] * *weights;
+			for( size_t k = 1; k < numw; k++ )
+				tmp += bufs[ k ][ x ] * weights[ k ];
+			*dst++ = ( uint8_t ) Math::clamp( tmp.round(), 0x0, 0xff );
+		}
+		_mm256_zeroupper();
+	}
+
+	void SIMDAVX2::ConvolveClampVert_f( float* dst, const float** bufs, const float* weights, size_t numw, size_t width ) const
+	{
+		size_t x;
+		__m256 s0, s1, s2, s3, mul;
+
+		for( x = 0; x + 32 <= width; x += 32 ) {
+			mul = _mm256_broadcast_ss( weights );
+			s0 = _mm256_mul_ps( _mm256_loadu_ps( bufs[ 0 ] + x ), mul );
+			s1 = _mm256_mul_ps( _mm256_loadu_ps( bufs[ 0 ] + x + 8 ), mul );
+			s2 = _mm256_mul_ps( _mm256_loadu_ps( bufs[ 0 ] + x + 16 ), mul );
+			s3 = _mm256_mul_ps( _mm256_loadu_ps( bufs[ 0 ] + x + 24 ), mul );
+
+			for( size_t k = 1; k < numw; k++ ) {
+				mul = _mm256_broadcast_ss( weights + k );
+				s0 = _mm256_fmadd_ps( _mm256_loadu_ps( bufs[ k ] + x ), mul, s0 );
+				s1 = _mm256_fmadd_ps( _mm256_loadu_ps( bufs[ k ] + x + 8 ), mul, s1 );
+				s2 = _mm256_fmadd_ps( _mm256_loadu_ps( bufs[ k ] + x + 16 ), mul, s2 );
+				s3 = _mm256_fmadd_ps( _mm256_loadu_ps( bufs[ k ] + x + 24 ), mul, s3 );
+			}
+			_mm256_storeu_ps( dst, s0 );
+			_mm256_storeu_ps( dst + 8, s1 );
+			_mm256_storeu_ps( dst + 16, s2 );
+			_mm256_storeu_ps( dst + 24, s3 );
+			dst += 32;
+		}
+
+		for( ; x + 8 <= width; x += 8 ) {
+			mul = _mm256_broadcast_ss( weights );
+			s0 = _mm256_mul_ps( _mm256_loadu_ps( bufs[ 0 ] + x ), mul );
+			for( size_t k = 1; k < numw; k++ )
+				s0 = _mm256_fmadd_ps( _mm256_loadu_ps( bufs[ k ] + x ), _mm256_broadcast_ss( weights + k ), s0 );
+			_mm256_storeu_ps( dst, s0 );
+			dst += 8;
+		}
+
+		float tmp;
+		for( ; x < width; x++ ) {
+			tmp = bufs[ 0 ][ x ] * *weights;
+			for( size_t k = 1; k < numw; k++ )
+				tmp += bufs[ k ][ x ] * weights[ k ];
+			*dst++ = tmp;
+		}
+		_mm256_zeroupper();
+	}
+
+	void SIMDAVX2::ConvolveClampVert_f_to_u8( uint8_t* dst, const float** bufs, const float* weights, size_t numw, size_t width ) const
+	{
+		size_t x;
+		__m256 s0, s1, mul;
+
+		for( x = 0; x + 16 <= width; x += 16 ) {
+			mul = _mm256_broadcast_ss( weights );
+			s0 = _mm256_mul_ps( _mm256_loadu_ps( bufs[ 0 ] + x ), mul );
+			s1 = _mm256_mul_ps( _mm256_loadu_ps( bufs[ 0 ] + x + 8 ), mul );
+
+			for( size_t k = 1; k < numw; k++ ) {
+				mul = _mm256_broadcast_ss( weights + k );
+				s0 = _mm256_fmadd_ps( _mm256_loadu_ps( bufs[ k ] + x ), mul, s0 );
+				s1 = _mm256_fmadd_ps( _mm256_loadu_ps( bufs[ k ] + x + 8 ), mul, s1 );
+			}
+			_mm_storeu_si128( ( __m128i* ) dst, _mm256_pack_epi32_u8( _mm256_cvtps_epi32( s0 ), _mm256_cvtps_epi32( s1 ) ) );
+			dst += 16;
+		}
+
+		float tmp;
+		for( ; x < width; x++ ) {
+			tmp = bufs[ 0 ][ x ] * *weights;
+			for( size_t k = 1; k < numw; k++ )
+				tmp += bufs[ k ][ x ] * weights[ k ];
+			*dst++ = ( uint8_t ) Math::clamp( tmp, 0.0f, 255.0f );
+		}
+		_mm256_zeroupper();
+	}
+
+	void SIMDAVX2::ConvolveClampVertSym_f( float* dst, const float** bufs, const float* weights, size_t numw, size_t width ) const
+	{
+		size_t x;
+		ssize_t b1 = ( numw >> 1 );
+		const float* wsym = weights + b1;
+		__m256 s0, s1, mul;
+
+		for( x = 0; x + 16 <= width; x += 16 ) {
+			mul = _mm256_broadcast_ss( wsym );
+			s0 = _mm256_mul_ps( _mm256_loadu_ps( bufs[ b1 ] + x ), mul );
+			s1 = _mm256_mul_ps( _mm256_loadu_ps( bufs[ b1 ] + x + 8 ), mul );
+
+			for( ssize_t k = 1; k <= b1; k++ ) {
+				mul = _mm256_broadcast_ss( wsym + k );
+				s0 = _mm256_fmadd_ps( _mm256_add_ps( _mm256_loadu_ps( bufs[ b1 - k ] + x ), _mm256_loadu_ps( bufs[ b1 + k ] + x ) ), mul, s0 );
+				s1 = _mm256_fmadd_ps( _mm256_add_ps( _mm256_loadu_ps( bufs[ b1 - k ] + x + 8 ), _mm256_loadu_ps( bufs[ b1 + k ] + x + 8 ) ), mul, s1 );
+			}
+			_mm256_storeu_ps( dst, s0 );
+			_mm256_storeu_ps( dst + 8, s1 );
+			dst += 16;
+		}
+
+		float tmp;
+		for( ; x < width; x++ ) {
+			tmp = bufs[ 0 ][ x ] * *weights;
+			for( size_t k = 1; k < numw; k++ )
+				tmp += bufs[ k ][ x ] * weights[ k ];
+			*dst++ = tmp;
+		}
+		_mm256_zeroupper();
+	}
+
+	void SIMDAVX2::Conv_f_to_u8( uint8_t* dst, float const* src, const size_t n ) const
+	{
+		const __m256 scale = _mm256_set1_ps( 255.0f );
+		const __m256 half = _mm256_set1_ps( 0.5f );
+		const __m256 zero = _mm256_setzero_ps();
+		__m256 f0, f1;
+		size_t i = n >> 4;
+
+		while( i-- ) {
+			f0 = _mm256_add_ps( _mm256_mul_ps( _mm256_loadu_ps( src ), scale ), half );
+			f1 = _mm256_add_ps( _mm256_mul_ps( _mm256_loadu_ps( src + 8 ), scale ), half );
+			f0 = _mm256_min_ps( _mm256_max_ps( f0, zero ), scale );
+			f1 = _mm256_min_ps( _mm256_max_ps( f1, zero ), scale );
+			_mm_storeu_si128( ( __m128i* ) dst, _mm256_pack_epi32_u8( _mm256_cvttps_epi32( f0 ), _mm256_cvttps_epi32( f1 ) ) );
+			src += 16;
+			dst += 16;
+		}
+		_mm256_zeroupper();
+		SIMD::Conv_f_to_u8( dst, src, n & 0xf );
+	}
+
+	void SIMDAVX2::Conv_u8_to_f( float* dst, const uint8_t* src, const size_t n ) const
+	{
+		const __m256 scale = _mm256_set1_ps( 255.0f );
+		size_t i = n >> 4;
+
+		while( i-- ) {
+			__m128i in = _mm_loadu_si128( ( const __m128i* ) src );
+			_mm256_storeu_ps( dst, _mm256_div_ps( _mm256_cvtepi32_ps( _mm256_cvtepu8_epi32( in ) ), scale ) );
+			_mm256_storeu_ps( dst + 8, _mm256_div_ps( _mm256_cvtepi32_ps( _mm256_cvtepu8_epi32( _mm_srli_si128( in, 8 ) ) ), scale ) );
+			src += 16;
+			dst += 16;
+		}
+		_mm256_zeroupper();
+		SIMD::Conv_u8_to_f( dst, src, n & 0xf );
+	}
+
+	void SIMDAVX2::Conv_u16_to_f( float* dst, const uint16_t* src, const size_t n ) const
+	{
+		const __m256 scale = _mm256_set1_ps( 1.0f / ( float ) 0xffff );
+		size_t i = n >> 4;
+
+		while( i-- ) {
+			__m256i in = _mm256_loadu_si256( ( const __m256i* ) src );
+			_mm256_storeu_ps( dst, _mm256_mul_ps( _mm256_cvtepi32_ps( _mm256_cvtepu16_epi32( _mm256_castsi256_si128( in ) ) ), scale ) );
+			_mm256_storeu_ps( dst + 8, _mm256_mul_ps( _mm256_cvtepi32_ps( _mm256_cvtepu16_epi32( _mm256_extracti128_si256( in, 1 ) ) ), scale ) );
+			src += 16;
+			dst += 16;
+		}
+		_mm256_zeroupper();
+		SIMD::Conv_u16_to_f( dst, src, n & 0xf );
+	}
+
+	void SIMDAVX2::Conv_XXXAu8_to_XXXAf( float* dst, uint8_t const* src, const size_t n ) const
+	{
+		/* same sRGB approximation as the SSE4.1 version, two pixels per register */
+		const __m256 A = _mm256_set1_ps( 0.28387f );
+		const __m256 B = _mm256_set1_ps( 1.0f - 0.28387f );
+		const __m256 C = _mm256_set1_ps( 1.0f / 255.0f );
+		__m256 f, forig;
+		size_t i = n >> 1;
+
+		while( i-- ) {
+			forig = _mm256_mul_ps( _mm256_cvtepi32_ps( _mm256_cvtepu8_epi32( _mm_loadl_epi64( ( const __m128i* ) src ) ) ), C );
+			f = _mm256_mul_ps( _mm256_add_ps( _mm256_mul_ps( forig, A ), B ), _mm256_mul_ps( forig, forig ) );
+			_mm256_storeu_ps( dst, _mm256_blend_ps( f, forig, 0x88 ) );
+			src += 8;
+			dst += 8;
+		}
+		_mm256_zeroupper();
+
+		if( n & 1 )
+			SIMDSSE42::Conv_XXXAu8_to_XXXAf( dst, src, 1 );
+	}
+
+	void SIMDAVX2::BoxFilterHorizontal_1f( float* dst, const float* src, size_t radius, size_t width ) const
+	{
+		size_t x;
+		float accum;
+		float invmean = 1.0f / ( float ) ( 2 * radius + 1 );
+		__m256 xf, y;
+		const __m256 mul = _mm256_set1_ps( invmean );
+
+		accum = *src * ( float ) ( radius + 1 );
+		for( x = 1; x <= radius; x++ )
+			accum += ( float ) src[ x ];
+
+		*dst++ = accum * invmean;
+
+		for( x = 1; x <= radius; x++ ) {
+			accum -= src[ 0 ];
+			accum += src[ x + radius ];
+			*dst++ = accum * invmean;
+		}
+
+		y = _mm256_set1_ps( accum );
+		for( ; x + radius + 8 <= width; x += 8 ) {
+			xf = _mm256_sub_ps( _mm256_loadu_ps( src + x + radius ), _mm256_loadu_ps( src + x - radius - 1 ) );
+			xf = _mm256_add_ps( _mm256_prefixsum_ps( xf ), y );
+			_mm256_storeu_ps( dst, _mm256_mul_ps( xf, mul ) );
+			y = _mm256_broadcastlast_ps( xf );
+			dst += 8;
+		}
+		accum = _mm_cvtss_f32( _mm256_castps256_ps128( y ) );
+		_mm256_zeroupper();
+
+		for( ; x < width - radius; x++ ) {
+			accum -= src[ x - radius - 1 ];
+			accum += src[ x + radius ];
+			*dst++ = accum * invmean;
+		}
+
+		for( ; x < width; x++ ) {
+			accum -= src[ x - radius - 1 ];
+			accum += src[ width - 1 ];
+			*dst++ = accum * invmean;
+		}
+	}
+
+	void SIMDAVX2::BoxFilterVert_f_to_u8( uint8_t* dst, float* accum, const float* add, const float* sub, size_t radius, size_t width ) const
+	{
+		size_t x;
+		float invmean = 1.0f / ( float ) ( 2 * radius + 1 );
+		const __m256 mul = _mm256_set1_ps( invmean );
+		__m256 acc0, acc1;
+
+		for( x = 0; x + 16 <= width; x += 16 ) {
+			acc0 = _mm256_sub_ps( _mm256_add_ps( _mm256_loadu_ps( accum ), _mm256_loadu_ps( add ) ), _mm256_loadu_ps( sub ) );
+			acc1 = _mm256_sub_ps( _mm256_add_ps( _mm256_loadu_ps( accum + 8 ), _mm256_loadu_ps( add + 8 ) ), _mm256_loadu_ps( sub + 8 ) );
+			_mm256_storeu_ps( accum, acc0 );
+			_mm256_storeu_ps( accum + 8, acc1 );
+
+			_mm_storeu_si128( ( __m128i* ) dst, _mm256_pack_epi32_u8( _mm256_cvtps_epi32( _mm256_mul_ps( acc0, mul ) ),
+																	 _mm256_cvtps_epi32( _mm256_mul_ps( acc1, mul ) ) ) );
+			accum += 16;
+			add += 16;
+			sub += 16;
+			dst += 16;
+		}
+		_mm256_zeroupper();
+
+		for( ; x < width; x++ ) {
+			float tmp;
+			tmp = *accum + *add++ - *sub++;
+			*accum++ = tmp;
+			*dst++ = ( uint8_t ) Math::clamp( tmp * invmean, 0.0f, 255.0f );
+		}
+	}
+
+	void SIMDAVX2::BoxFilterVert_f( float* dst, float* accum, const float* add, const float* sub, size_t radius, size_t width ) const
+	{
+		size_t x;
+		float invmean = 1.0f / ( float ) ( 2 * radius + 1 );
+		const __m256 mul = _mm256_set1_ps( invmean );
+		__m256 acc0, acc1;
+
+		for( x = 0; x + 16 <= width; x += 16 ) {
+			acc0 = _mm256_sub_ps( _mm256_add_ps( _mm256_loadu_ps( accum ), _mm256_loadu_ps( add ) ), _mm256_loadu_ps( sub ) );
+			acc1 = _mm256_sub_ps( _mm256_add_ps( _mm256_loadu_ps( accum + 8 ), _mm256_loadu_ps( add + 8 ) ), _mm256_loadu_ps( sub + 8 ) );
+			_mm256_storeu_ps( accum, acc0 );
+			_mm256_storeu_ps( accum + 8, acc1 );
+			_mm256_storeu_ps( dst, _mm256_mul_ps( acc0, mul ) );
+			_mm256_storeu_ps( dst + 8, _mm256_mul_ps( acc1, mul ) );
+
+			accum += 16;
+			add += 16;
+			sub += 16;
+			dst += 16;
+		}
+		_mm256_zeroupper();
+
+		for( ; x < width; x++ ) {
+			float tmp;
+			tmp = *accum + *add++ - *sub++;
+			*accum++ = tmp;
+			*dst++ = tmp * invmean;
+		}
+	}
+
+	void SIMDAVX2::warpBilinear1f( float* dst, const float* coords, const float* src, size_t srcStride, size_t srcWidth, size_t srcHeight, float fillcolor, size_t n ) const
+	{
+		const __m256i endx = _mm256_set1_epi32( ( int ) srcWidth - 1 );
+		const __m256i endy = _mm256_set1_epi32( ( int ) srcHeight - 1 );
+		const __m256i minusone = _mm256_set1_epi32( -1 );
+		const __m256i stride = _mm256_set1_epi32( ( int ) srcStride );
+		const __m256i four = _mm256_set1_epi32( sizeof( float ) );
+		size_t i = n >> 3;
+
+		while( i-- ) {
+			__m256 c0 = _mm256_loadu_ps( coords );
+			__m256 c1 = _mm256_loadu_ps( coords + 8 );
+			/* deinterleave x and y, shuffle_ps works per lane so restore the order afterwards */
+			__m256 fx = _mm256_castpd_ps( _mm256_permute4x64_pd( _mm256_castps_pd( _mm256_shuffle_ps( c0, c1, _MM_SHUFFLE( 2, 0, 2, 0 ) ) ), _MM_SHUFFLE( 3, 1, 2, 0 ) ) );
+			__m256 fy = _mm256_castpd_ps( _mm256_permute4x64_pd( _mm256_castps_pd( _mm256_shuffle_ps( c0, c1, _MM_SHUFFLE( 3, 1, 3, 1 ) ) ), _MM_SHUFFLE( 3, 1, 2, 0 ) ) );
+			__m256i lx = _mm256_floor_epi32( fx );
+			__m256i ly = _mm256_floor_epi32( fy );
+
+			/* lx >= 0 && lx < endx && ly >= 0 && ly < endy */
+			__m256i inside = _mm256_and_si256( _mm256_and_si256( _mm256_cmpgt_epi32( lx, minusone ), _mm256_cmpgt_epi32( endx, lx ) ),
+											   _mm256_and_si256( _mm256_cmpgt_epi32( ly, minusone ), _mm256_cmpgt_epi32( endy, ly ) ) );
+
+			if( _mm256_movemask_epi8( inside ) == -1 ) {
+				__m256i offset = _mm256_add_epi32( _mm256_mullo_epi32( ly, stride ), _mm256_mullo_epi32( lx, four ) );
+				const float* src2 = ( const float* ) ( ( const uint8_t* ) src + srcStride );
+				__m256 alpha1 = _mm256_sub_ps( fx, _mm256_cvtepi32_ps( lx ) );
+				__m256 alpha2 = _mm256_sub_ps( fy, _mm256_cvtepi32_ps( ly ) );
+				__m256 a = _mm256_i32gather_ps( src, offset, 1 );
+				__m256 b = _mm256_i32gather_ps( src + 1, offset, 1 );
+				__m256 c = _mm256_i32gather_ps( src2, offset, 1 );
+				__m256 d = _mm256_i32gather_ps( src2 + 1, offset, 1 );
+				a = _mm256_fmadd_ps( _mm256_sub_ps( b, a ), alpha1, a );
+				c = _mm256_fmadd_ps( _mm256_sub_ps( d, c ), alpha1, c );
+				_mm256_storeu_ps( dst, _mm256_fmadd_ps( _mm256_sub_ps( c, a ), alpha2, a ) );
+			} else {
+				_mm256_zeroupper();
+				SIMD::warpBilinear1f( dst, coords, src, srcStride, srcWidth, srcHeight, fillcolor, 8 );
+			}
+			coords += 16;
+			dst += 8;
+		}
+		_mm256_zeroupper();
+		SIMD::warpBilinear1f( dst, coords, src, srcStride, srcWidth, srcHeight, fillcolor, n & 0x7 );
+	}
+
+	void SIMDAVX2::warpBilinear4f( float* dst, const float* coords, const float* src, size_t srcStride, size_t srcWidth, size_t srcHeight, const float* fillcolor, size_t n ) const
+	{
+		const uint8_t* base = ( const uint8_t* ) src;
+		int endx = ( ( int ) srcWidth ) - 1;
+		int endy = ( ( int ) srcHeight ) - 1;
+		Math::_flint32 flx, fly;
+
+		while( n-- ) {
+			flx.f = coords[ 0 ];
+			fly.f = coords[ 1 ];
+			int lx = ( int32_t ) flx.f - ( flx.i >> 31 );
+			int ly = ( int32_t ) fly.f - ( fly.i >> 31 );
+
+			if( lx >= 0 && lx < endx && ly >= 0 && ly < endy ) {
+				const float* ptr1 = ( const float* ) ( base + srcStride * ly + sizeof( float ) * lx * 4 );
+				const float* ptr2 = ( const float* ) ( ( const uint8_t* ) ptr1 + srcStride );
+				/* left and right neighbours of both lines, interpolate horizontally then vertically */
+				__m256 left = _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_loadu_ps( ptr1 ) ), _mm_loadu_ps( ptr2 ), 1 );
+				__m256 right = _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_loadu_ps( ptr1 + 4 ) ), _mm_loadu_ps( ptr2 + 4 ), 1 );
+				__m256 v = _mm256_fmadd_ps( _mm256_sub_ps( right, left ), _mm256_set1_ps( flx.f - ( float ) lx ), left );
+				__m128 v1 = _mm256_castps256_ps128( v );
+				__m128 v2 = _mm256_extractf128_ps( v, 1 );
+				_mm_storeu_ps( dst, _mm_fmadd_ps( _mm_sub_ps( v2, v1 ), _mm_set1_ps( fly.f - ( float ) ly ), v1 ) );
+			} else {
+				_mm256_zeroupper();
+				SIMD::warpBilinear4f( dst, coords, src, srcStride, srcWidth, srcHeight, fillcolor, 1 );
+			}
+			coords += 2;
+			dst += 4;
+		}
+		_mm256_zeroupper();
+	}
+
+	size_t SIMDAVX2::hammingDistance( const uint8_t* src1, const uint8_t* src2, size_t n ) const
+	{
+		const __m256i lut = _mm256_setr_epi8( 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+											  0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 );
+		const __m256i mask = _mm256_set1_epi8( 0x0f );
+		const __m256i zero = _mm256_setzero_si256();
+		__m256i total = zero;
+		size_t n32 = n >> 5;
+		size_t pcount;
+
+		while( n32 ) {
+			/* the 8 bit counters can take 31 iterations of at most 8 bits each */
+			size_t num = Math::min<size_t>( n32, 31 );
+			__m256i cnt = zero;
+			n32 -= num;
+			while( num-- ) {
+				__m256i x = _mm256_xor_si256( _mm256_loadu_si256( ( const __m256i* ) src1 ), _mm256_loadu_si256( ( const __m256i* ) src2 ) );
+				cnt = _mm256_add_epi8( cnt, _mm256_shuffle_epi8( lut, _mm256_and_si256( x, mask ) ) );
+				cnt = _mm256_add_epi8( cnt, _mm256_shuffle_epi8( lut, _mm256_and_si256( _mm256_srli_epi16( x, 4 ), mask ) ) );
+				src1 += 32;
+				src2 += 32;
+			}
+			total = _mm256_add_epi64( total, _mm256_sad_epu8( cnt, zero ) );
+		}
+
+		__m128i sum = _mm_add_epi64( _mm256_castsi256_si128( total ), _mm256_extracti128_si256( total, 1 ) );
+		sum = _mm_add_epi64( sum, _mm_unpackhi_epi64( sum, sum ) );
+		pcount = _mm_cvtsi128_si64( sum );
+		_mm256_zeroupper();
+
+		size_t r = n & 0x1f;
+		while( r >= 8 ) {
+			uint64_t a, b;
+			Memcpy( ( uint8_t* ) &a, src1, 8 );
+			Memcpy( ( uint8_t* ) &b, src2, 8 );
+			pcount += _mm_popcnt_u64( a ^ b );
+			src1 += 8;
+			src2 += 8;
+			r -= 8;
+		}
+
+		if( r ) {
+			uint64_t a = 0, b = 0;
+			Memcpy( ( uint8_t* ) &a, src1, r );
+			Memcpy( ( uint8_t* ) &b, src2, r );
+			pcount += _mm_popcnt_u64( a ^ b );
+		}
+
+		return pcount;
+	}
+
+	/* per byte popcount of the xor of n32 chunks of 32 bytes, n32 <= 31 */
+	static inline __m256i _mm256_popcount_xor_epu8( const uint8_t* src1, const uint8_t* src2, size_t n32, __m256i lut, __m256i mask )
+	{
+		__m256i cnt = _mm256_setzero_si256();
+		while( n32-- ) {
+			__m256i x = _mm256_xor_si256( _mm256_loadu_si256( ( const __m256i* ) src1 ), _mm256_loadu_si256( ( const __m256i* ) src2 ) );
+			cnt = _mm256_add_epi8( cnt, _mm256_shuffle_epi8( lut, _mm256_and_si256( x, mask ) ) );
+			cnt = _mm256_add_epi8( cnt, _mm256_shuffle_epi8( lut, _mm256_and_si256( _mm256_srli_epi16( x, 4 ), mask ) ) );
+			src1 += 32;
+			src2 += 32;
+		}
+		return cnt;
+	}
+
+	void SIMDAVX2::hammingDistances( uint32_t* dst, const uint8_t* query, const uint8_t* descs, size_t stride, size_t count, size_t n ) const
+	{
+		/* the 8 bit counters limit the descriptor length to 31 chunks of 32 bytes */
+		if( ( n & 0x1f ) || n > 31 * 32 ) {
+			SIMDSSE42::hammingDistances( dst, query, descs, stride, count, n );
+			return;
+		}
+
+		const __m256i lut = _mm256_setr_epi8( 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+											  0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 );
+		const __m256i mask = _mm256_set1_epi8( 0x0f );
+		const __m256i zero = _mm256_setzero_si256();
+		size_t n32 = n >> 5;
+
+		/* four descriptors at a time: the 64 bit sums of each descriptor are at most 8 * n,
+		   so they can be packed into the 16 bit fields of one register and reduced together */
+		while( count >= 4 ) {
+			__m256i s0 = _mm256_sad_epu8( _mm256_popcount_xor_epu8( query, descs, n32, lut, mask ), zero );
+			__m256i s1 = _mm256_sad_epu8( _mm256_popcount_xor_epu8( query, descs + stride, n32, lut, mask ), zero );
+			__m256i s2 = _mm256_sad_epu8( _mm256_popcount_xor_epu8( query, descs + 2 * stride, n32, lut, mask ), zero );
+			__m256i s3 = _mm256_sad_epu8( _mm256_popcount_xor_epu8( query, descs + 3 * stride, n32, lut, mask ), zero );
+
+			__m256i s = _mm256_or_si256( _mm256_or_si256( s0, _mm256_slli_epi64( s1, 16 ) ),
+										 _mm256_or_si256( _mm256_slli_epi64( s2, 32 ), _mm256_slli_epi64( s3, 48 ) ) );
+			__m128i sum = _mm_add_epi64( _mm256_castsi256_si128( s ), _mm256_extracti128_si256( s, 1 ) );
+			sum = _mm_add_epi64( sum, _mm_unpackhi_epi64( sum, sum ) );
+			_mm_storeu_si128( ( __m128i* ) dst, _mm_cvtepu16_epi32( sum ) );
+
+			descs += 4 * stride;
+			dst += 4;
+			count -= 4;
+		}
+
+		while( count-- ) {
+			__m256i s = _mm256_sad_epu8( _mm256_popcount_xor_epu8( query, descs, n32, lut, mask ), zero );
+			__m128i sum = _mm_add_epi64( _mm256_castsi256_si128( s ), _mm256_extracti128_si256( s, 1 ) );
+			sum = _mm_add_epi64( sum, _mm_unpackhi_epi64( sum, sum ) );
+			*dst++ = _mm_cvtsi128_si32( sum );
+			descs += stride;
+		}
+		_mm256_zeroupper();
+	}
+
+	void SIMDAVX2::prefixSum1_u8_to_f( float * dst, size_t dstStride, const uint8_t* src, size_t srcStride, size_t width, size_t height ) const
+	{
+		const float* prevRow = NULL;
+
+		while( height-- ) {
+			__m256 y = _mm256_setzero_ps();
+			__m256 xf;
+			size_t x;
+
+			for( x = 0; x + 8 <= width; x += 8 ) {
+				xf = _mm256_cvtepi32_ps( _mm256_cvtepu8_epi32( _mm_loadl_epi64( ( const __m128i* ) ( src + x ) ) ) );
+				xf = _mm256_add_ps( _mm256_prefixsum_ps( xf ), y );
+				y = _mm256_broadcastlast_ps( xf );
+				if( prevRow )
+					xf = _mm256_add_ps( xf, _mm256_loadu_ps( prevRow + x ) );
+				_mm256_storeu_ps( dst + x, xf );
+			}
+
+			float yl = _mm_cvtss_f32( _mm256_castps256_ps128( y ) );
+			for( ; x < width; x++ ) {
+				yl += src[ x ];
+				dst[ x ] = prevRow ? yl + prevRow[ x ] : yl;
+			}
+
+			prevRow = dst;
+			dst += dstStride;
+			src += srcStride;
+		}
+		_mm256_zeroupper();
+	}
+
+	void SIMDAVX2::prefixSum1_f_to_f( float * dst, size_t dstStride, const float* src, size_t srcStride, size_t width, size_t height ) const
+	{
+		const float* prevRow = NULL;
+
+		while( height-- ) {
+			__m256 y = _mm256_setzero_ps();
+			__m256 xf;
+			size_t x;
+
+			for( x = 0; x + 8 <= width; x += 8 ) {
+				xf = _mm256_add_ps( _mm256_prefixsum_ps( _mm256_loadu_ps( src + x ) ), y );
+				y = _mm256_broadcastlast_ps( xf );
+				if( prevRow )
+					xf = _mm256_add_ps( xf, _mm256_loadu_ps( prevRow + x ) );
+				_mm256_storeu_ps( dst + x, xf );
+			}
+
+			float yl = _mm_cvtss_f32( _mm256_castps256_ps128( y ) );
+			for( ; x < width; x++ ) {
+				yl += src[ x ];
+				dst[ x ] = prevRow ? yl + prevRow[ x ] : yl;
+			}
+
+			prevRow = dst;
+			dst += dstStride;
+			src += srcStride;
+		}
+		_mm256_zeroupper();
+	}
+}
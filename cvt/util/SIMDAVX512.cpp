@@ -0,0 +1,430 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+/* the AVX-512 intrinsics of GCC < 12.3 pass _mm512_undefined_* as merge source, which -Wmaybe-uninitialized reports at -O2 */
+#if defined( __GNUC__ ) && !defined( __clang__ ) && ( __GNUC__ < 12 || ( __GNUC__ == 12 && __GNUC_MINOR__ < 3 ) )
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include <immintrin.h>
+#pragma GCC diagnostic pop
+#endif
+
+#include <cvt/util/SIMDAVX512.h>
+#include <immintrin.h>
+
+namespace cvt
+{
+	static inline __mmask16 _tailmask16( size_t n )
+	{
+		return ( __mmask16 ) ( ( 1u << n ) - 1 );
+	}
+
+	/* same rounding as the scalar _floor in SIMD.cpp */
+	static inline __m512i _mm512_floor_epi32( __m512 x )
+	{
+		return _mm512_sub_epi32( _mm512_cvttps_epi32( x ), _mm512_srli_epi32( _mm512_castps_si512( x ), 31 ) );
+	}
+
+	void SIMDAVX512::ConvolveHorizontal1f( float* dst, const float* src, const size_t width, float const* weights, const size_t wn, IBorderType btype ) const
+	{
+		if( wn == 1 ) {
+			MulValue1f( dst, src, *weights, width );
+			return;
+		}
+
+		ssize_t b1 = ( wn >> 1 );
+		ssize_t b2 = wn - b1 - 1;
+		ssize_t x;
+
+		for( x = 0; x < b1 && x < ( ssize_t ) width; x++ ) {
+			float tmp = 0;
+			for( size_t k = 0; k < wn; k++ ) {
+				ssize_t pos = IBorder::value<ssize_t>( x - b1 + k, width, btype );
+				tmp += weights[ k ] * src[ pos ];
+			}
+			*dst++ = tmp;
+		}
+
+		for( ; x <= ( ssize_t ) width - b2 - 32; x += 32 ) {
+			__m512 f;
+			__m512 s0 = _mm512_setzero_ps(), s1 = s0;
+			const float* psrc = src + x - b1;
+
+			for( size_t k = 0; k < wn; k++ ) {
+				f = _mm512_set1_ps( weights[ k ] );
+				s0 = _mm512_fmadd_ps( _mm512_loadu_ps( psrc + k ), f, s0 );
+				s1 = _mm512_fmadd_ps( _mm512_loadu_ps( psrc + k + 16 ), f, s1 );
+			}
+			_mm512_storeu_ps( dst, s0 );
+			_mm512_storeu_ps( dst + 16, s1 );
+			dst += 32;
+		}
+
+		/* remaining inner pixels with a partial vector */
+		if( x < ( ssize_t ) width - b2 ) {
+			size_t rem = Math::min<size_t>( ( size_t ) ( ( ssize_t ) width - b2 - x ), 16 );
+			__mmask16 m = _tailmask16( rem );
+			__m512 s0 = _mm512_setzero_ps();
+			const float* psrc = src + x - b1;
+
+			for( size_t k = 0; k < wn; k++ )
+				s0 = _mm512_fmadd_ps( _mm512_maskz_loadu_ps( m, psrc + k ), _mm512_set1_ps( weights[ k ] ), s0 );
+			_mm512_mask_storeu_ps( dst, m, s0 );
+			dst += rem;
+			x += rem;
+		}
+		_mm256_zeroupper();
+
+		for( ; x < ( ssize_t ) width - b2; x++ ) {
+			float tmp = 0;
+			for( size_t k = 0; k < wn; k++ ) {
+				ssize_t pos = x - b1 + k;
+				tmp += weights[ k ] * src[ pos ];
+			}
+			*dst++ = tmp;
+		}
+
+		for( ; x < ( ssize_t ) width; x++ ) {
+			float tmp = 0;
+			for( size_t k = 0; k < wn; k++ ) {
+				ssize_t pos = IBorder::value<ssize_t>( x - b1 + k, width, btype );
+				tmp += weights[ k ] * src[ pos ];
+			}
+			*dst++ = tmp;
+		}
+	}
+
+	void SIMDAVX512::ConvolveClampVert_f( float* dst, const float** bufs, const float* weights, size_t numw, size_t width ) const
+	{
+		size_t x;
+		__m512 s0, s1, mul;
+
+		for( x = 0; x + 32 <= width; x += 32 ) {
+			mul = _mm512_set1_ps( weights[ 0 ] );
+			s0 = _mm512_mul_ps( _mm512_loadu_ps( bufs[ 0 ] + x ), mul );
+			s1 = _mm512_mul_ps( _mm512_loadu_ps( bufs[ 0 ] + x + 16 ), mul );
+
+			for( size_t k = 1; k < numw; k++ ) {
+				mul = _mm512_set1_ps( weights[ k ] );
+				s0 = _mm512_fmadd_ps( _mm512_loadu_ps( bufs[ k ] + x ), mul, s0 );
+				s1 = _mm512_fmadd_ps( _mm512_loadu_ps( bufs[ k ] + x + 16 ), mul, s1 );
+			}
+			_mm512_storeu_ps( dst + x, s0 );
+			_mm512_storeu_ps( dst + x + 16, s1 );
+		}
+
+		while( x < width ) {
+			size_t rem = Math::min<size_t>( width - x, 16 );
+			__mmask16 m = _tailmask16( rem );
+
+			s0 = _mm512_mul_ps( _mm512_maskz_loadu_ps( m, bufs[ 0 ] + x ), _mm512_set1_ps( weights[ 0 ] ) );
+			for( size_t k = 1; k < numw; k++ )
+				s0 = _mm512_fmadd_ps( _mm512_maskz_loadu_ps( m, bufs[ k ] + x ), _mm512_set1_ps( weights[ k ] ), s0 );
+			_mm512_mask_storeu_ps( dst + x, m, s0 );
+			x += rem;
+		}
+		_mm256_zeroupper();
+	}
+
+	void SIMDAVX512::ConvolveClampVert_f_to_u8( uint8_t* dst, const float** bufs, const float* weights, size_t numw, size_t width ) const
+	{
+		size_t x;
+		__m512 s0;
+		const __m512i zero = _mm512_setzero_si512();
+
+		for( x = 0; x + 16 <= width; x += 16 ) {
+			s0 = _mm512_mul_ps( _mm512_loadu_ps( bufs[ 0 ] + x ), _mm512_set1_ps( weights[ 0 ] ) );
+			for( size_t k = 1; k < numw; k++ )
+				s0 = _mm512_fmadd_ps( _mm512_loadu_ps( bufs[ k ] + x ), _mm512_set1_ps( weights[ k ] ), s0 );
+			/* round and saturate like the SSE2 packs/packus sequence */
+			_mm_storeu_si128( ( __m128i* ) ( dst + x ), _mm512_cvtusepi32_epi8( _mm512_max_epi32( _mm512_cvtps_epi32( s0 ), zero ) ) );
+		}
+		_mm256_zeroupper();
+
+		float tmp;
+		for( ; x < width; x++ ) {
+			tmp = bufs[ 0 ][ x ] * *weights;
+			for( size_t k = 1; k < numw; k++ )
+				tmp += bufs[ k ][ x ] * weights[ k ];
+			dst[ x ] = ( uint8_t ) Math::clamp( tmp, 0.0f, 255.0f );
+		}
+	}
+
+	void SIMDAVX512::ConvolveClampVertSym_f( float* dst, const float** bufs, const float* weights, size_t numw, size_t width ) const
+	{
+		size_t x;
+		ssize_t b1 = ( numw >> 1 );
+		const float* wsym = weights + b1;
+		__m512 s0, mul;
+
+		for( x = 0; x < width; x += 16 ) {
+			__mmask16 m = _tailmask16( Math::min<size_t>( width - x, 16 ) );
+
+			s0 = _mm512_mul_ps( _mm512_maskz_loadu_ps( m, bufs[ b1 ] + x ), _mm512_set1_ps( wsym[ 0 ] ) );
+			for( ssize_t k = 1; k <= b1; k++ ) {
+				mul = _mm512_set1_ps( wsym[ k ] );
+				s0 = _mm512_fmadd_ps( _mm512_add_ps( _mm512_maskz_loadu_ps( m, bufs[ b1 - k ] + x ), _mm512_maskz_loadu_ps( m, bufs[ b1 + k ] + x ) ), mul, s0 );
+			}
+			_mm512_mask_storeu_ps( dst + x, m, s0 );
+		}
+		_mm256_zeroupper();
+	}
+
+	void SIMDAVX512::Conv_f_to_u8( uint8_t* dst, float const* src, const size_t n ) const
+	{
+		const __m512 scale = _mm512_set1_ps( 255.0f );
+		const __m512 half = _mm512_set1_ps( 0.5f );
+		const __m512 zero = _mm512_setzero_ps();
+		size_t i;
+
+		for( i = 0; i < n; i += 16 ) {
+			__mmask16 m = _tailmask16( Math::min<size_t>( n - i, 16 ) );
+			__m512 f = _mm512_add_ps( _mm512_mul_ps( _mm512_maskz_loadu_ps( m, src + i ), scale ), half );
+			f = _mm512_min_ps( _mm512_max_ps( f, zero ), scale );
+			_mm512_mask_cvtepi32_storeu_epi8( dst + i, m, _mm512_cvttps_epi32( f ) );
+		}
+		_mm256_zeroupper();
+	}
+
+	void SIMDAVX512::Conv_u8_to_f( float* dst, const uint8_t* src, const size_t n ) const
+	{
+		const __m512 scale = _mm512_set1_ps( 255.0f );
+		size_t i;
+
+		for( i = 0; i + 16 <= n; i += 16 ) {
+			__m128i in = _mm_loadu_si128( ( const __m128i* ) ( src + i ) );
+			_mm512_storeu_ps( dst + i, _mm512_div_ps( _mm512_cvtepi32_ps( _mm512_cvtepu8_epi32( in ) ), scale ) );
+		}
+		_mm256_zeroupper();
+		SIMD::Conv_u8_to_f( dst + i, src + i, n - i );
+	}
+
+	void SIMDAVX512::Conv_u16_to_f( float* dst, const uint16_t* src, const size_t n ) const
+	{
+		const __m512 scale = _mm512_set1_ps( 1.0f / ( float ) 0xffff );
+		size_t i;
+
+		for( i = 0; i + 16 <= n; i += 16 ) {
+			__m256i in = _mm256_loadu_si256( ( const __m256i* ) ( src + i ) );
+			_mm512_storeu_ps( dst + i, _mm512_mul_ps( _mm512_cvtepi32_ps( _mm512_cvtepu16_epi32( in ) ), scale ) );
+		}
+		_mm256_zeroupper();
+		SIMD::Conv_u16_to_f( dst + i, src + i, n - i );
+	}
+
+	void SIMDAVX512::BoxFilterVert_f( float* dst, float* accum, const float* add, const float* sub, size_t radius, size_t width ) const
+	{
+		const __m512 mul = _mm512_set1_ps( 1.0f / ( float ) ( 2 * radius + 1 ) );
+		size_t x;
+
+		for( x = 0; x < width; x += 16 ) {
+			__mmask16 m = _tailmask16( Math::min<size_t>( width - x, 16 ) );
+			__m512 acc = _mm512_sub_ps( _mm512_add_ps( _mm512_maskz_loadu_ps( m, accum + x ), _mm512_maskz_loadu_ps( m, add + x ) ),
+									   _mm512_maskz_loadu_ps( m, sub + x ) );
+			_mm512_mask_storeu_ps( accum + x, m, acc );
+			_mm512_mask_storeu_ps( dst + x, m, _mm512_mul_ps( acc, mul ) );
+		}
+		_mm256_zeroupper();
+	}
+
+	void SIMDAVX512::warpBilinear1f( float* dst, const float* coords, const float* src, size_t srcStride, size_t srcWidth, size_t srcHeight, float fillcolor, size_t n ) const
+	{
+		const __m512i endx = _mm512_set1_epi32( ( int ) srcWidth - 1 );
+		const __m512i endy = _mm512_set1_epi32( ( int ) srcHeight - 1 );
+		const __m512i zero = _mm512_setzero_si512();
+		const __m512i stride = _mm512_set1_epi32( ( int ) srcStride );
+		const __m512i even = _mm512_setr_epi32( 0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30 );
+		const __m512i odd = _mm512_add_epi32( even, _mm512_set1_epi32( 1 ) );
+		const float* src2 = ( const float* ) ( ( const uint8_t* ) src + srcStride );
+		size_t i = n >> 4;
+
+		while( i-- ) {
+			__m512 c0 = _mm512_loadu_ps( coords );
+			__m512 c1 = _mm512_loadu_ps( coords + 16 );
+			__m512 fx = _mm512_permutex2var_ps( c0, even, c1 );
+			__m512 fy = _mm512_permutex2var_ps( c0, odd, c1 );
+			__m512i lx = _mm512_floor_epi32( fx );
+			__m512i ly = _mm512_floor_epi32( fy );
+
+			__mmask16 inside = _mm512_cmpge_epi32_mask( lx, zero ) & _mm512_cmplt_epi32_mask( lx, endx ) &
+							   _mm512_cmpge_epi32_mask( ly, zero ) & _mm512_cmplt_epi32_mask( ly, endy );
+
+			if( inside == 0xffff ) {
+				__m512i offset = _mm512_add_epi32( _mm512_mullo_epi32( ly, stride ), _mm512_slli_epi32( lx, 2 ) );
+				__m512 alpha1 = _mm512_sub_ps( fx, _mm512_cvtepi32_ps( lx ) );
+				__m512 alpha2 = _mm512_sub_ps( fy, _mm512_cvtepi32_ps( ly ) );
+				__m512 a = _mm512_i32gather_ps( offset, src, 1 );
+				__m512 b = _mm512_i32gather_ps( offset, src + 1, 1 );
+				__m512 c = _mm512_i32gather_ps( offset, src2, 1 );
+				__m512 d = _mm512_i32gather_ps( offset, src2 + 1, 1 );
+				a = _mm512_fmadd_ps( _mm512_sub_ps( b, a ), alpha1, a );
+				c = _mm512_fmadd_ps( _mm512_sub_ps( d, c ), alpha1, c );
+				_mm512_storeu_ps( dst, _mm512_fmadd_ps( _mm512_sub_ps( c, a ), alpha2, a ) );
+			} else {
+				_mm256_zeroupper();
+				SIMDAVX2::warpBilinear1f( dst, coords, src, srcStride, srcWidth, srcHeight, fillcolor, 16 );
+			}
+			coords += 32;
+			dst += 16;
+		}
+		_mm256_zeroupper();
+		SIMDAVX2::warpBilinear1f( dst, coords, src, srcStride, srcWidth, srcHeight, fillcolor, n & 0xf );
+	}
+
+	/* the VPOPCNTQ kernels are compiled for the extension only, they are called after the runtime check */
+	static inline __mmask64 _tailmask64( size_t n )
+	{
+		return n >= 64 ? ~( __mmask64 ) 0 : ( ( __mmask64 ) 1 << n ) - 1;
+	}
+
+	/* horizontal sum of the eight 64 bit lanes, explicit instead of _mm512_reduce_add_epi64 */
+	static inline uint64_t _mm512_hsum_epi64( __m512i x )
+	{
+		__m256i s = _mm256_add_epi64( _mm512_castsi512_si256( x ), _mm512_extracti64x4_epi64( x, 1 ) );
+		__m128i t = _mm_add_epi64( _mm256_castsi256_si128( s ), _mm256_extracti128_si256( s, 1 ) );
+		return ( uint64_t ) _mm_cvtsi128_si64( t ) + ( uint64_t ) _mm_extract_epi64( t, 1 );
+	}
+
+	/* per 64 bit lane popcounts of the xor of two n byte vectors */
+	__attribute__(( target( "avx512vpopcntdq" ) ))
+	static inline __m512i _mm512_popcount_xor_epi64( const uint8_t* src1, const uint8_t* src2, size_t n )
+	{
+		__m512i cnt = _mm512_setzero_si512();
+		while( n >= 64 ) {
+			cnt = _mm512_add_epi64( cnt, _mm512_popcnt_epi64( _mm512_xor_si512( _mm512_loadu_si512( src1 ), _mm512_loadu_si512( src2 ) ) ) );
+			src1 += 64;
+			src2 += 64;
+			n -= 64;
+		}
+		if( n ) {
+			__mmask64 m = _tailmask64( n );
+			__m512i x = _mm512_xor_si512( _mm512_maskz_loadu_epi8( m, src1 ), _mm512_maskz_loadu_epi8( m, src2 ) );
+			cnt = _mm512_add_epi64( cnt, _mm512_popcnt_epi64( x ) );
+		}
+		return cnt;
+	}
+
+	__attribute__(( target( "avx512vpopcntdq" ) ))
+	static size_t hammingDistanceVPOPCNT( const uint8_t* src1, const uint8_t* src2, size_t n )
+	{
+		size_t pcount = _mm512_hsum_epi64( _mm512_popcount_xor_epi64( src1, src2, n ) );
+		_mm256_zeroupper();
+		return pcount;
+	}
+
+	__attribute__(( target( "avx512vpopcntdq" ) ))
+	static void hammingDistancesVPOPCNT( uint32_t* dst, const uint8_t* query, const uint8_t* descs, size_t stride, size_t count, size_t n )
+	{
+		if( n == 32 ) {
+			/* BRIEF32/ORB: eight descriptors at a time, two per register. The 16 bit fields of the
+			   even descriptors end up in lane 0, the odd ones in lane 4 */
+			const __m512i q = _mm512_broadcast_i64x4( _mm256_loadu_si256( ( const __m256i* ) query ) );
+			while( count >= 8 ) {
+				__m512i p[ 4 ];
+				for( size_t i = 0; i < 4; i++ ) {
+					__m512i x = _mm512_inserti64x4( _mm512_castsi256_si512( _mm256_loadu_si256( ( const __m256i* ) ( descs + 2 * i * stride ) ) ),
+													_mm256_loadu_si256( ( const __m256i* ) ( descs + ( 2 * i + 1 ) * stride ) ), 1 );
+					p[ i ] = _mm512_popcnt_epi64( _mm512_xor_si512( x, q ) );
+				}
+				__m512i s = _mm512_or_si512( _mm512_or_si512( p[ 0 ], _mm512_slli_epi64( p[ 1 ], 16 ) ),
+											 _mm512_or_si512( _mm512_slli_epi64( p[ 2 ], 32 ), _mm512_slli_epi64( p[ 3 ], 48 ) ) );
+				s = _mm512_add_epi64( s, _mm512_shuffle_i64x2( s, s, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+				s = _mm512_add_epi64( s, _mm512_shuffle_epi32( s, _MM_PERM_BADC ) );
+				__m128i d = _mm_unpacklo_epi16( _mm512_castsi512_si128( s ), _mm512_extracti32x4_epi32( s, 2 ) );
+				_mm256_storeu_si256( ( __m256i* ) dst, _mm256_cvtepu16_epi32( d ) );
+
+				descs += 8 * stride;
+				dst += 8;
+				count -= 8;
+			}
+		}
+
+		/* four descriptors at a time: the distances are at most 8 * n < 2^16, so the lane sums
+		   of the four descriptors are packed into the 16 bit fields and reduced together */
+		while( count >= 4 ) {
+			__m512i s0 = _mm512_popcount_xor_epi64( query, descs, n );
+			__m512i s1 = _mm512_popcount_xor_epi64( query, descs + stride, n );
+			__m512i s2 = _mm512_popcount_xor_epi64( query, descs + 2 * stride, n );
+			__m512i s3 = _mm512_popcount_xor_epi64( query, descs + 3 * stride, n );
+			__m512i s = _mm512_or_si512( _mm512_or_si512( s0, _mm512_slli_epi64( s1, 16 ) ),
+										 _mm512_or_si512( _mm512_slli_epi64( s2, 32 ), _mm512_slli_epi64( s3, 48 ) ) );
+			uint64_t sum = _mm512_hsum_epi64( s );
+			dst[ 0 ] = sum & 0xffff;
+			dst[ 1 ] = ( sum >> 16 ) & 0xffff;
+			dst[ 2 ] = ( sum >> 32 ) & 0xffff;
+			dst[ 3 ] = sum >> 48;
+
+			descs += 4 * stride;
+			dst += 4;
+			count -= 4;
+		}
+
+		while( count-- ) {
+			*dst++ = _mm512_hsum_epi64( _mm512_popcount_xor_epi64( query, descs, n ) );
+			descs += stride;
+		}
+		_mm256_zeroupper();
+	}
+
+	size_t SIMDAVX512::hammingDistance( const uint8_t* src1, const uint8_t* src2, size_t n ) const
+	{
+		if( _vpopcntdq )
+			return hammingDistanceVPOPCNT( src1, src2, n );
+
+		const __m512i lut = _mm512_set4_epi32( 0x04030302, 0x03020201, 0x03020201, 0x02010100 );
+		const __m512i mask = _mm512_set1_epi8( 0x0f );
+		const __m512i zero = _mm512_setzero_si512();
+		__m512i total = zero;
+		size_t n64 = n >> 6;
+
+		while( n64 ) {
+			/* the 8 bit counters can take 31 iterations of at most 8 bits each */
+			size_t num = Math::min<size_t>( n64, 31 );
+			__m512i cnt = zero;
+			n64 -= num;
+			while( num-- ) {
+				__m512i x = _mm512_xor_si512( _mm512_loadu_si512( src1 ), _mm512_loadu_si512( src2 ) );
+				cnt = _mm512_add_epi8( cnt, _mm512_shuffle_epi8( lut, _mm512_and_si512( x, mask ) ) );
+				cnt = _mm512_add_epi8( cnt, _mm512_shuffle_epi8( lut, _mm512_and_si512( _mm512_srli_epi16( x, 4 ), mask ) ) );
+				src1 += 64;
+				src2 += 64;
+			}
+			total = _mm512_add_epi64( total, _mm512_sad_epu8( cnt, zero ) );
+		}
+
+		size_t pcount = _mm512_hsum_epi64( total );
+		_mm256_zeroupper();
+
+		return pcount + SIMDAVX2::hammingDistance( src1, src2, n & 0x3f );
+	}
+
+	void SIMDAVX512::hammingDistances( uint32_t* dst, const uint8_t* query, const uint8_t* descs, size_t stride, size_t count, size_t n ) const
+	{
+		if( _vpopcntdq && n < 8192 ) {
+			hammingDistancesVPOPCNT( dst, query, descs, stride, count, n );
+			return;
+		}
+		SIMDAVX2::hammingDistances( dst, query, descs, stride, count, n );
+	}
+}
@@ -0,0 +1,79 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef SIMDAVX512_H
+#define SIMDAVX512_H
+
+#include <cvt/util/SIMDAVX2.h>
+#include <cvt/util/CPU.h>
+
+namespace cvt {
+
+	/**
+	  AVX-512 (F + BW) backend, everything not overridden here uses the AVX2 code paths
+	 */
+	class SIMDAVX512 : public SIMDAVX2 {
+		friend class SIMD;
+
+		protected:
+			SIMDAVX512() : _vpopcntdq( cpuFeatures() & CPU_AVX512VPOPCNTDQ ) {}
+
+		public:
+            virtual void ConvolveHorizontal1f( float* dst, const float* src, const size_t width, float const* weights, const size_t wn, IBorderType btype ) const;
+
+			virtual void ConvolveClampVert_f( float* dst, const float** bufs, const float* weights, size_t numw, size_t width ) const;
+			virtual void ConvolveClampVert_f_to_u8( uint8_t* dst, const float** bufs, const float* weights, size_t numw, size_t width ) const;
+			virtual void ConvolveClampVertSym_f( float* dst, const float** bufs, const float* weights, size_t numw, size_t width ) const;
+
+			virtual void Conv_f_to_u8( uint8_t* dst, float const* src, const size_t n ) const;
+			virtual void Conv_u8_to_f( float* dst, const uint8_t* src, const size_t n ) const;
+			virtual void Conv_u16_to_f( float* dst, const uint16_t* src, const size_t n ) const;
+
+			virtual void BoxFilterVert_f( float* dst, float* accum, const float* add, const float* sub, size_t radius, size_t width ) const;
+
+			virtual void warpBilinear1f( float* dst, const float* coords, const float* src, size_t srcStride, size_t srcWidth, size_t srcHeight, float fillcolor, size_t n ) const;
+
+			virtual size_t hammingDistance( const uint8_t* src1, const uint8_t* src2, size_t n ) const;
+			virtual void hammingDistances( uint32_t* dst, const uint8_t* query, const uint8_t* descs, size_t stride, size_t count, size_t n ) const;
+
+			virtual std::string name() const;
+			virtual SIMDType type() const;
+
+		private:
+			/* VPOPCNTQ is not part of F + BW, the hamming distances check for it at runtime */
+			bool _vpopcntdq;
+	};
+
+	inline std::string SIMDAVX512::name() const
+	{
+		return "SIMD-AVX512";
+	}
+
+	inline SIMDType SIMDAVX512::type() const
+	{
+		return SIMD_AVX512;
+	}
+}
+
+#endif
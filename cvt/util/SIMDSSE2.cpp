@@ -220,6 +220,38 @@ namespace cvt
     }
 
 
+    float SIMDSSE2::dot( float const* src1, float const* src2, const size_t n ) const
+    {
+        size_t i = n >> 2;
+
+        __m128 sum = _mm_setzero_ps( );
+
+        if( ( ( size_t ) src1 | ( size_t ) src2 ) & 0xf ) {
+            while( i-- ) {
+                sum = _mm_add_ps( sum, _mm_mul_ps( _mm_loadu_ps( src1 ), _mm_loadu_ps( src2 ) ) );
+                src1 += 4; src2 += 4;
+            }
+        } else {
+            while( i-- ) {
+                sum = _mm_add_ps( sum, _mm_mul_ps( _mm_load_ps( src1 ), _mm_load_ps( src2 ) ) );
+                src1 += 4; src2 += 4;
+            }
+        }
+
+        float dot = 0.0f;
+
+        sum = _mm_add_ps( sum, _mm_movehl_ps( sum, sum ) );
+        sum = _mm_add_ps( sum, _mm_shuffle_ps( sum, sum, _MM_SHUFFLE( 0, 0, 0, 1 ) ) );
+        _mm_store_ss( &dot, sum );
+
+        i = n & 0x3;
+        while( i-- ) {
+            dot += *src1++ * *src2++;
+        }
+
+        return dot;
+    }
+
     size_t SIMDSSE2::SAD( uint8_t const* src1, uint8_t const* src2, const size_t n ) const
     {
         size_t i = n >> 4;
@@ -3937,6 +3969,52 @@ namespace cvt
         }
     }
 
+    uint16_t SIMDSSE2::SGMPathStep_u16( uint16_t* dst, uint16_t* sum, const uint16_t* prev, const uint8_t* cost, uint16_t prevmin, uint16_t P1, uint16_t P2, size_t n ) const
+    {
+        /* all path costs are below 0x7fff, so the signed 16 bit min/max can be used */
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i p1 = _mm_set1_epi16( P1 );
+        const __m128i pmin = _mm_set1_epi16( prevmin );
+        const __m128i jump = _mm_set1_epi16( prevmin + P2 );
+        __m128i vmin = _mm_set1_epi16( 0x7fff );
+        __m128i v, t;
+
+        size_t n2 = n >> 3;
+        while( n2-- ) {
+            v = _mm_min_epi16( _mm_loadu_si128( ( __m128i* ) prev ), jump );
+            t = _mm_min_epi16( _mm_loadu_si128( ( __m128i* ) ( prev - 1 ) ), _mm_loadu_si128( ( __m128i* ) ( prev + 1 ) ) );
+            v = _mm_min_epi16( v, _mm_adds_epi16( t, p1 ) );
+            t = _mm_unpacklo_epi8( _mm_loadl_epi64( ( __m128i* ) cost ), zero );
+            v = _mm_sub_epi16( _mm_add_epi16( v, t ), pmin );
+            _mm_storeu_si128( ( __m128i* ) dst, v );
+            vmin = _mm_min_epi16( vmin, v );
+            _mm_storeu_si128( ( __m128i* ) sum, _mm_adds_epu16( _mm_loadu_si128( ( __m128i* ) sum ), v ) );
+
+            prev += 8;
+            cost += 8;
+            dst  += 8;
+            sum  += 8;
+        }
+
+        vmin = _mm_min_epi16( vmin, _mm_srli_si128( vmin, 8 ) );
+        vmin = _mm_min_epi16( vmin, _mm_srli_si128( vmin, 4 ) );
+        vmin = _mm_min_epi16( vmin, _mm_srli_si128( vmin, 2 ) );
+        uint16_t ret = ( uint16_t ) _mm_extract_epi16( vmin, 0 );
+
+        n &= 0x7;
+        while( n-- ) {
+            uint16_t w = Math::min<uint16_t>( *prev, prevmin + P2 );
+            w = Math::min<uint16_t>( w, Math::min<uint16_t>( *( prev - 1 ), *( prev + 1 ) ) + P1 );
+            w = *cost++ + w - prevmin;
+            *dst++ = w;
+            ret = Math::min( ret, w );
+            *sum = ( uint16_t ) Math::min<uint32_t>( ( uint32_t ) *sum + w, 0xffff );
+            sum++;
+            prev++;
+        }
+        return ret;
+    }
+
     void SIMDSSE2::harrisScore1f( float* dst, const float* boxdx2, const float* boxdy2, const float* boxdxy, float k, size_t width ) const
     {
         size_t x;
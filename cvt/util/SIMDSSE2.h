@@ -46,6 +46,7 @@ namespace cvt {
 
 			using SIMDSSE::SSD;
             virtual float SSD( const float* src1, const float* src2, const size_t n ) const;
+            virtual float dot( const float* src1, const float* src2, const size_t n ) const;
 
             virtual float NCC( float const* src1, float const* src2, const size_t n ) const;
 
@@ -110,6 +111,8 @@ namespace cvt {
 			virtual void pyrdownHalfHorizontal_1u8_to_1u16( uint16_t* dst, const uint8_t* src, size_t n ) const;
 			virtual void pyrdownHalfVertical_1u16_to_1u8( uint8_t* dst, uint16_t* rows[ 5 ], size_t n ) const;
 
+			virtual uint16_t SGMPathStep_u16( uint16_t* dst, uint16_t* sum, const uint16_t* prev, const uint8_t* cost, uint16_t prevmin, uint16_t P1, uint16_t P2, size_t n ) const;
+
 			virtual void harrisScore1f( float* dst, const float* boxdx2, const float* boxdy2, const float* boxdxdy, float kappa, size_t width ) const;
 
 			virtual float harrisResponse1u8( const uint8_t* _src, size_t srcStride, size_t w, size_t h, const float k ) const;
@@ -26,33 +26,63 @@
 
 #include <xmmintrin.h>
 #include <smmintrin.h>
+#include <nmmintrin.h>
+#include <string.h>
 
 namespace cvt
 {
-    /*
-	size_t SIMDSSE42::hammingDistance( const uint8_t* src1, const uint8_t* src2, size_t n ) const
-    {
-        size_t pcount = 0;
+	static inline uint64_t load64( const uint8_t* src )
+	{
+		uint64_t ret;
+		/* unaligned load, compiles to a single mov */
+		memcpy( &ret, src, sizeof( uint64_t ) );
+		return ret;
+	}
+
+	static inline size_t popcountXor( const uint8_t* src1, const uint8_t* src2, size_t n )
+	{
+		size_t pcount = 0;
 
-        size_t n8 = n >> 3;
-        size_t r  = n - ( n8 << 3 );
+		while( n >= 8 ) {
+			pcount += _mm_popcnt_u64( load64( src1 ) ^ load64( src2 ) );
+			src1 += 8;
+			src2 += 8;
+			n -= 8;
+		}
 
-        while ( n8-- ) {
-            pcount += _mm_popcnt_u64( *(uint64_t*)src1 ^ *(uint64_t*)src2 );
-            src1 += 8;
-            src2 += 8;
-        }
+		if( n ){
+			uint64_t  a = 0, b = 0;
 
-        if( r ){
-            uint64_t  a = 0, b = 0;
+			memcpy( &a, src1, n );
+			memcpy( &b, src2, n );
 
-            Memcpy( ( uint8_t* ) &a, src1, r );
-            Memcpy( ( uint8_t* ) &b, src2, r );
+			pcount += _mm_popcnt_u64( a ^ b );
+		}
 
-            pcount += _mm_popcnt_u64( a ^ b );
-        }
+		return pcount;
+	}
+
+	size_t SIMDSSE42::hammingDistance( const uint8_t* src1, const uint8_t* src2, size_t n ) const
+	{
+		return popcountXor( src1, src2, n );
+	}
 
-        return pcount;
-    }*/
+	void SIMDSSE42::hammingDistances( uint32_t* dst, const uint8_t* query, const uint8_t* descs, size_t stride, size_t count, size_t n ) const
+	{
+		if( n == 32 ) {
+			/* BRIEF32/ORB: keep the query in registers */
+			const uint64_t q0 = load64( query ), q1 = load64( query + 8 ), q2 = load64( query + 16 ), q3 = load64( query + 24 );
+			while( count-- ) {
+				*dst++ = _mm_popcnt_u64( q0 ^ load64( descs ) ) + _mm_popcnt_u64( q1 ^ load64( descs + 8 ) ) +
+						 _mm_popcnt_u64( q2 ^ load64( descs + 16 ) ) + _mm_popcnt_u64( q3 ^ load64( descs + 24 ) );
+				descs += stride;
+			}
+			return;
+		}
 
+		while( count-- ) {
+			*dst++ = popcountXor( query, descs, n );
+			descs += stride;
+		}
+	}
 }
@@ -36,7 +36,8 @@ namespace cvt {
 			SIMDSSE42()	{}
 
 		public:
-//			virtual size_t hammingDistance(const uint8_t* src1, const uint8_t* src2, size_t n) const;
+			virtual size_t hammingDistance( const uint8_t* src1, const uint8_t* src2, size_t n ) const;
+			virtual void hammingDistances( uint32_t* dst, const uint8_t* query, const uint8_t* descs, size_t stride, size_t count, size_t n ) const;
 
 			virtual std::string name() const;
 			virtual SIMDType type() const;
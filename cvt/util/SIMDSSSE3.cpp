@@ -149,12 +149,17 @@ namespace cvt {
 		_mm_storel_epi64( ( __m128i* ) &tmp, sum );
         bitcount += tmp;
 
-        if( r ){
+        // the remaining up to 15 bytes in at most two 8 byte words
+        while( r ){
             uint64_t a = 0, b = 0;
             uint64_t xored;
+            size_t len = r > 8 ? 8 : r;
 
-            Memcpy( ( uint8_t* )( &a ), src1, r );
-			Memcpy( ( uint8_t* )( &b ), src2, r );
+            Memcpy( ( uint8_t* )( &a ), src1, len );
+			Memcpy( ( uint8_t* )( &b ), src2, len );
+            src1 += len;
+            src2 += len;
+            r -= len;
 
             xored = ( a^b );
             xored = ( ( xored & 0xAAAAAAAAAAAAAAAAll ) >> 1 ) + ( xored & 0x5555555555555555ll );
@@ -27,7 +27,9 @@
 #include <cvt/util/Time.h>
 #include <cvt/util/CVTTest.h>
 #include <cvt/math/Math.h>
+#include <cvt/math/Fixed.h>
 #include <sstream>
+#include <vector>
 
 using namespace cvt;
 
@@ -142,6 +144,52 @@ static bool _hammingTest()
     return result;
 }
 
+static bool _hammingBatchTest()
+{
+    bool result = true;
+
+    const size_t sizes[] = { 13, 32, 64, 100, 992, 1000 };
+    const size_t count = 23;
+    const size_t rows = 5;
+    SIMD* ref = SIMD::get( SIMD_BASE );
+
+    SIMDType bestType = SIMD::bestSupportedType();
+    for( int st = SIMD_BASE; st <= bestType; st++ ) {
+        SIMD* simd = SIMD::get( ( SIMDType ) st );
+        bool tRes = true;
+
+        for( size_t s = 0; s < sizeof( sizes ) / sizeof( sizes[ 0 ] ); s++ ) {
+            size_t n = sizes[ s ];
+            // odd stride, the descriptors are not aligned
+            size_t stride = n + 7;
+            std::vector<uint8_t> descs( stride * count );
+            std::vector<uint32_t> dist( rows * ( count + 1 ) );
+
+            for( size_t i = 0; i < descs.size(); i++ )
+                descs[ i ] = ( uint8_t ) rand();
+
+            // the first rows descriptors of descs against all of them
+            simd->hammingDistanceMatrix( &dist[ 0 ], ( count + 1 ) * sizeof( uint32_t ), &descs[ 0 ], stride, rows, &descs[ 0 ], stride, count, n );
+            for( size_t r = 0; r < rows; r++ ) {
+                for( size_t k = 0; k < count; k++ ) {
+                    size_t expected = ref->hammingDistance( &descs[ r * stride ], &descs[ k * stride ], n );
+                    if( dist[ r * ( count + 1 ) + k ] != expected ) {
+                        std::cout << "n = " << n << " ( " << r << ", " << k << " ): " << dist[ r * ( count + 1 ) + k ] << " expected " << expected << std::endl;
+                        tRes = false;
+                    }
+                }
+            }
+        }
+
+        result &= tRes;
+        CVTTEST_PRINT( "HammingDistances " + simd->name() + ": ", tRes );
+        delete simd;
+    }
+
+    delete ref;
+    return result;
+}
+
 static bool _medianApproxTest()
 {
     float values[ 10000 ];
@@ -305,6 +353,32 @@ static void _SSDTest( float* src1, float* src2, size_t n )
     }
 }
 
+static void _dotTest( float* src1, float* src2, size_t n )
+{
+    float reference = 0.0f;
+    for( size_t i = 0; i < n; i++ ) {
+        src1[ i ] = Math::rand( 0.0f, 100.0f );
+        src2[ i ] = Math::rand( 0.0f, 100.0f );
+        reference += src1[ i ] * src2[ i ];
+    }
+
+    SIMDType bestType = SIMD::bestSupportedType( );
+    for( int st = SIMD_BASE; st <= bestType; st++ ) {
+        SIMD* simd = SIMD::get( ( SIMDType ) st );
+        float result = simd->dot( &src1[ 0 ], &src2[ 0 ], n );
+        bool fail = false;
+        if( Math::abs( reference - result ) / reference > 0.0001 ) {
+            fail = true;
+            std::cout << "Error: dot: Reference: " << reference << ", " << simd->name( ) << ": " << result << std::endl;
+        }
+        std::stringstream ss;
+        ss << simd->name( );
+        ss << " dot (float)";
+        CVTTEST_PRINT( ss.str( ), !fail );
+        delete simd;
+    }
+}
+
 static void _NCCTest( float* src1, float* src2, size_t n )
 {
     float *constval = new float[ n ];
@@ -356,6 +430,224 @@ static void _NCCTest( float* src1, float* src2, size_t n )
     delete[] constval;
 }
 
+static bool _compareFloats( const float* a, const float* b, size_t n, float eps )
+{
+    for( size_t i = 0; i < n; i++ ) {
+        if( Math::abs( a[ i ] - b[ i ] ) > eps * ( 1.0f + Math::abs( b[ i ] ) ) )
+            return false;
+    }
+    return true;
+}
+
+static bool _compareU8( const uint8_t* a, const uint8_t* b, size_t n, int tolerance )
+{
+    for( size_t i = 0; i < n; i++ ) {
+        if( Math::abs( ( int ) a[ i ] - ( int ) b[ i ] ) > tolerance )
+            return false;
+    }
+    return true;
+}
+
+/* compare the kernels overridden by the AVX2 and AVX-512 backends against the SIMD base implementation */
+static bool _avxKernelTest( SIMDType type )
+{
+    const size_t width = 1031;
+    const size_t height = 7;
+    const size_t numw = 7;
+    SIMD* base = SIMD::get( SIMD_BASE );
+    SIMD* simd = SIMD::get( type );
+    bool result = true;
+    bool b;
+
+    std::vector<float> src( 4 * width * height ), ref( 4 * width * height ), out( 4 * width * height );
+    std::vector<uint8_t> src8( 4 * width * height ), ref8( 4 * width * height ), out8( 4 * width * height );
+    std::vector<uint16_t> src16( width );
+    std::vector<Fixed> fxbufmem( numw * width );
+    std::vector<const Fixed*> fxbufs( numw );
+    std::vector<const float*> bufs( numw );
+    float weights[ numw ] = { 0.05f, -0.1f, 0.2f, 0.4f, 0.2f, 0.15f, 0.1f };
+    float symweights[ numw ] = { 0.05f, 0.1f, 0.2f, 0.3f, 0.2f, 0.1f, 0.05f };
+    Fixed fxweights[ numw ];
+
+    for( size_t i = 0; i < src.size(); i++ ) {
+        src[ i ] = Math::rand( -0.2f, 1.2f );
+        src8[ i ] = Math::rand( 0, 256 );
+    }
+    for( size_t i = 0; i < width; i++ )
+        src16[ i ] = Math::rand( 0, 65536 );
+    for( size_t k = 0; k < numw; k++ ) {
+        fxweights[ k ] = Fixed( symweights[ k ] );
+        bufs[ k ] = &src[ k * width ];
+        fxbufs[ k ] = &fxbufmem[ k * width ];
+        for( size_t i = 0; i < width; i++ )
+            fxbufmem[ k * width + i ] = Fixed( Math::rand( 0.0f, 255.0f ) );
+    }
+
+#define AVXCOMPARE( kernel, cmp )                                        \
+    result &= b = cmp;                                                   \
+    CVTTEST_PRINT( simd->name() + " " + kernel, b );
+
+    base->ConvolveHorizontal1f( &ref[ 0 ], &src[ 0 ], width, weights, numw, IBORDER_CLAMP );
+    simd->ConvolveHorizontal1f( &out[ 0 ], &src[ 0 ], width, weights, numw, IBORDER_CLAMP );
+    b = _compareFloats( &out[ 0 ], &ref[ 0 ], width, 1e-5f );
+    base->ConvolveHorizontal1f( &ref[ 0 ], &src[ 0 ], width, weights, numw, IBORDER_MIRROR );
+    simd->ConvolveHorizontal1f( &out[ 0 ], &src[ 0 ], width, weights, numw, IBORDER_MIRROR );
+    AVXCOMPARE( "ConvolveHorizontal1f", b && _compareFloats( &out[ 0 ], &ref[ 0 ], width, 1e-5f ) )
+
+    base->ConvolveHorizontal4f( &ref[ 0 ], &src[ 0 ], width, weights, numw, IBORDER_CLAMP );
+    simd->ConvolveHorizontal4f( &out[ 0 ], &src[ 0 ], width, weights, numw, IBORDER_CLAMP );
+    AVXCOMPARE( "ConvolveHorizontal4f", _compareFloats( &out[ 0 ], &ref[ 0 ], 4 * width, 1e-5f ) )
+
+    base->ConvolveHorizontalSym1f( &ref[ 0 ], &src[ 0 ], width, symweights, numw, IBORDER_CLAMP );
+    simd->ConvolveHorizontalSym1f( &out[ 0 ], &src[ 0 ], width, symweights, numw, IBORDER_CLAMP );
+    AVXCOMPARE( "ConvolveHorizontalSym1f", _compareFloats( &out[ 0 ], &ref[ 0 ], width, 1e-5f ) )
+
+    base->ConvolveClampVert_fx_to_u8( &ref8[ 0 ], &fxbufs[ 0 ], fxweights, numw, width );
+    simd->ConvolveClampVert_fx_to_u8( &out8[ 0 ], &fxbufs[ 0 ], fxweights, numw, width );
+    AVXCOMPARE( "ConvolveClampVert_fx_to_u8", _compareU8( &out8[ 0 ], &ref8[ 0 ], width, 0 ) )
+
+    base->ConvolveClampVert_f( &ref[ 0 ], &bufs[ 0 ], weights, numw, width );
+    simd->ConvolveClampVert_f( &out[ 0 ], &bufs[ 0 ], weights, numw, width );
+    AVXCOMPARE( "ConvolveClampVert_f", _compareFloats( &out[ 0 ], &ref[ 0 ], width, 1e-5f ) )
+
+    for( size_t i = 0; i < numw * width; i++ )
+        ref[ i ] = src[ i ] * 255.0f;
+    for( size_t k = 0; k < numw; k++ )
+        bufs[ k ] = &ref[ k * width ];
+    base->ConvolveClampVert_f_to_u8( &ref8[ 0 ], &bufs[ 0 ], weights, numw, width );
+    simd->ConvolveClampVert_f_to_u8( &out8[ 0 ], &bufs[ 0 ], weights, numw, width );
+    AVXCOMPARE( "ConvolveClampVert_f_to_u8", _compareU8( &out8[ 0 ], &ref8[ 0 ], width, 1 ) )
+    for( size_t k = 0; k < numw; k++ )
+        bufs[ k ] = &src[ k * width ];
+
+    base->ConvolveClampVertSym_f( &ref[ 0 ], &bufs[ 0 ], symweights, numw, width );
+    simd->ConvolveClampVertSym_f( &out[ 0 ], &bufs[ 0 ], symweights, numw, width );
+    AVXCOMPARE( "ConvolveClampVertSym_f", _compareFloats( &out[ 0 ], &ref[ 0 ], width, 1e-5f ) )
+
+    base->Conv_f_to_u8( &ref8[ 0 ], &src[ 0 ], width );
+    simd->Conv_f_to_u8( &out8[ 0 ], &src[ 0 ], width );
+    AVXCOMPARE( "Conv_f_to_u8", _compareU8( &out8[ 0 ], &ref8[ 0 ], width, 1 ) )
+
+    base->Conv_u8_to_f( &ref[ 0 ], &src8[ 0 ], width );
+    simd->Conv_u8_to_f( &out[ 0 ], &src8[ 0 ], width );
+    AVXCOMPARE( "Conv_u8_to_f", _compareFloats( &out[ 0 ], &ref[ 0 ], width, 1e-6f ) )
+
+    base->Conv_u16_to_f( &ref[ 0 ], &src16[ 0 ], width );
+    simd->Conv_u16_to_f( &out[ 0 ], &src16[ 0 ], width );
+    AVXCOMPARE( "Conv_u16_to_f", _compareFloats( &out[ 0 ], &ref[ 0 ], width, 1e-6f ) )
+
+    {
+        /* the SSE4.1 sRGB approximation instead of the table of the base implementation */
+        SIMD* sse41 = SIMD::get( SIMD_SSE41 );
+        sse41->Conv_XXXAu8_to_XXXAf( &ref[ 0 ], &src8[ 0 ], width );
+        simd->Conv_XXXAu8_to_XXXAf( &out[ 0 ], &src8[ 0 ], width );
+        AVXCOMPARE( "Conv_XXXAu8_to_XXXAf", _compareFloats( &out[ 0 ], &ref[ 0 ], 4 * width, 1e-5f ) )
+        delete sse41;
+    }
+
+    base->BoxFilterHorizontal_1f( &ref[ 0 ], &src[ 0 ], 5, width );
+    simd->BoxFilterHorizontal_1f( &out[ 0 ], &src[ 0 ], 5, width );
+    AVXCOMPARE( "BoxFilterHorizontal_1f", _compareFloats( &out[ 0 ], &ref[ 0 ], width, 1e-4f ) )
+
+    {
+        /* the accumulators are updated in place */
+        std::vector<float> accumref( src.begin(), src.begin() + width ), accum( accumref );
+        for( size_t i = 0; i < width; i++ )
+            accumref[ i ] = accum[ i ] = src[ i ] * 2000.0f;
+        base->BoxFilterVert_f( &ref[ 0 ], &accumref[ 0 ], &src[ width ], &src[ 2 * width ], 3, width );
+        simd->BoxFilterVert_f( &out[ 0 ], &accum[ 0 ], &src[ width ], &src[ 2 * width ], 3, width );
+        b = _compareFloats( &out[ 0 ], &ref[ 0 ], width, 1e-5f ) && _compareFloats( &accum[ 0 ], &accumref[ 0 ], width, 1e-5f );
+        base->BoxFilterVert_f_to_u8( &ref8[ 0 ], &accumref[ 0 ], &src[ width ], &src[ 2 * width ], 3, width );
+        simd->BoxFilterVert_f_to_u8( &out8[ 0 ], &accum[ 0 ], &src[ width ], &src[ 2 * width ], 3, width );
+        b &= _compareU8( &out8[ 0 ], &ref8[ 0 ], width, 1 ) && _compareFloats( &accum[ 0 ], &accumref[ 0 ], width, 1e-5f );
+        AVXCOMPARE( "BoxFilterVert_f/f_to_u8", b )
+    }
+
+    {
+        /* coordinates inside, on the border and outside of a 64 x 48 image */
+        const size_t n = 1001;
+        const size_t iw = 64, ih = 48;
+        const float fill[ 4 ] = { 0.1f, 0.2f, 0.3f, 0.4f };
+        std::vector<float> coords( 2 * n );
+        for( size_t i = 0; i < n; i++ ) {
+            coords[ 2 * i ] = Math::rand( -2.0f, ( float ) iw + 1.0f );
+            coords[ 2 * i + 1 ] = Math::rand( -2.0f, ( float ) ih + 1.0f );
+        }
+        coords[ 0 ] = 0.0f; coords[ 1 ] = 0.0f;
+        coords[ 2 ] = iw - 1; coords[ 3 ] = ih - 1;
+        coords[ 4 ] = -0.5f; coords[ 5 ] = 3.0f;
+
+        base->warpBilinear1f( &ref[ 0 ], &coords[ 0 ], &src[ 0 ], iw * sizeof( float ), iw, ih, fill[ 0 ], n );
+        simd->warpBilinear1f( &out[ 0 ], &coords[ 0 ], &src[ 0 ], iw * sizeof( float ), iw, ih, fill[ 0 ], n );
+        AVXCOMPARE( "warpBilinear1f", _compareFloats( &out[ 0 ], &ref[ 0 ], n, 1e-5f ) )
+
+        base->warpBilinear4f( &ref[ 0 ], &coords[ 0 ], &src[ 0 ], 4 * iw * sizeof( float ), iw, ih, fill, n );
+        simd->warpBilinear4f( &out[ 0 ], &coords[ 0 ], &src[ 0 ], 4 * iw * sizeof( float ), iw, ih, fill, n );
+        AVXCOMPARE( "warpBilinear4f", _compareFloats( &out[ 0 ], &ref[ 0 ], 4 * n, 1e-5f ) )
+    }
+
+    base->prefixSum1_u8_to_f( &ref[ 0 ], width, &src8[ 0 ], width, width, height );
+    simd->prefixSum1_u8_to_f( &out[ 0 ], width, &src8[ 0 ], width, width, height );
+    AVXCOMPARE( "prefixSum1_u8_to_f", _compareFloats( &out[ 0 ], &ref[ 0 ], width * height, 1e-5f ) )
+
+    base->prefixSum1_f_to_f( &ref[ 0 ], width, &src[ 0 ], width, width, height );
+    simd->prefixSum1_f_to_f( &out[ 0 ], width, &src[ 0 ], width, width, height );
+    AVXCOMPARE( "prefixSum1_f_to_f", _compareFloats( &out[ 0 ], &ref[ 0 ], width * height, 1e-4f ) )
+
+#undef AVXCOMPARE
+
+    delete base;
+    delete simd;
+    return result;
+}
+
+/* compare SGMPathStep_u16 of all backends against the SIMD base with P2 at the largest value SGMStereo accepts */
+static bool _sgmPathStepTest()
+{
+    const int maxcost = 64;
+    const uint16_t P2 = 0x7fff - maxcost - 1;
+    const size_t sizes[] = { 1, 7, 8, 37, 64, 129 };
+    SIMD* base = SIMD::get( SIMD_BASE );
+    bool result = true;
+
+    SIMDType bestType = SIMD::bestSupportedType();
+    for( int st = SIMD_BASE + 1; st <= bestType; st++ ) {
+        SIMD* simd = SIMD::get( ( SIMDType ) st );
+        bool b = true;
+        for( size_t s = 0; s < sizeof( sizes ) / sizeof( sizes[ 0 ] ); s++ ) {
+            const size_t n = sizes[ s ];
+            for( size_t iter = 0; iter < 50; iter++ ) {
+                const uint16_t P1 = Math::rand( P2 / 2, P2 + 1 );
+                /* the path costs are surrounded by 0x7fff as in SGMStereo */
+                std::vector<uint16_t> prev( n + 2, 0x7fff );
+                std::vector<uint16_t> ref( n ), out( n ), refsum( n ), outsum( n );
+                std::vector<uint8_t> cost( n );
+
+                /* the previous step returned its minimum, which is bounded by the largest matching cost */
+                uint16_t prevmin = Math::rand( 0, maxcost + 1 );
+                for( size_t d = 0; d < n; d++ ) {
+                    prev[ d + 1 ] = Math::rand( prevmin, maxcost + P2 + 1 );
+                    cost[ d ] = Math::rand( 0, maxcost + 1 );
+                    refsum[ d ] = outsum[ d ] = Math::rand( 0xff00, 0x10000 );
+                }
+                prev[ Math::rand( 1, n + 1 ) ] = prevmin;
+
+                uint16_t refmin = base->SGMPathStep_u16( &ref[ 0 ], &refsum[ 0 ], &prev[ 1 ], &cost[ 0 ], prevmin, P1, P2, n );
+                uint16_t outmin = simd->SGMPathStep_u16( &out[ 0 ], &outsum[ 0 ], &prev[ 1 ], &cost[ 0 ], prevmin, P1, P2, n );
+                if( refmin != outmin || ref != out || refsum != outsum ) {
+                    std::cout << "Error: " << simd->name() << " SGMPathStep_u16 n = " << n << " P1 = " << P1 << std::endl;
+                    b = false;
+                }
+            }
+        }
+        CVTTEST_PRINT( simd->name() + " SGMPathStep_u16", b );
+        result &= b;
+        delete simd;
+    }
+    delete base;
+    return result;
+}
+
 BEGIN_CVTTEST( simd )
         float* fdst;
         float* fsrc1;
@@ -383,6 +675,7 @@ BEGIN_CVTTEST( simd )
 
         _SADTest( fsrc1, fsrc2, TESTSIZE );
         _SSDTest( fsrc1, fsrc2, TESTSIZE );
+        _dotTest( fsrc1, fsrc2, TESTSIZE );
         _NCCTest( fsrc1, fsrc2, TESTSIZE );
 
         delete[] fdst;
@@ -393,12 +686,24 @@ BEGIN_CVTTEST( simd )
         bool testResult = _hammingTest();
         CVTTEST_PRINT( "HammingDistance", testResult );
 
+        testResult = _hammingBatchTest();
+        CVTTEST_PRINT( "HammingDistances", testResult );
+
         testResult = _medianApproxTest();
         CVTTEST_PRINT( "medianBinApproximate", testResult );
 
         testResult = _projectTest();
         CVTTEST_PRINT( "Project Points 3d->2d", testResult );
 
+        /* the differential tests only run for the backends the CPU supports */
+        for( int st = SIMD_AVX2; st <= bestType; st++ ) {
+            testResult = _avxKernelTest( ( SIMDType ) st );
+            CVTTEST_PRINT( "AVX kernels against SIMD base", testResult );
+        }
+
+        testResult = _sgmPathStepTest();
+        CVTTEST_PRINT( "SGMPathStep_u16 against SIMD base", testResult );
+
 #define TESTSIZE ( 2048 * 2048 )
         fdst = new float[ TESTSIZE ];
         fsrc1 = new float[ TESTSIZE ];
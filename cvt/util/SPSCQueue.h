@@ -0,0 +1,237 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_SPSCQUEUE_H
+#define CVT_SPSCQUEUE_H
+
+#include <cvt/util/QueueWaiter.h>
+#include <cvt/math/Math.h>
+
+#include <atomic>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <stdint.h>
+
+namespace cvt {
+
+	/**
+	  @brief Bounded lock-free queue for exactly one producer and one consumer thread
+
+	  The capacity is rounded up to a power of two. Producer and consumer only share the two
+	  positions, each side caches the position of the other side and reloads it only if the
+	  queue looks full or empty. The try variants never block, the other variants wait for
+	  space or elements, a full queue blocks the producer (backpressure). The elements are
+	  constructed in the buffer by push and moved out and destroyed by pop.
+	 */
+	template<typename T>
+	class SPSCQueue {
+		public:
+			explicit SPSCQueue( size_t capacity );
+			~SPSCQueue();
+
+			size_t	capacity() const { return _mask + 1; }
+			/* number of queued elements, only a snapshot if called concurrently */
+			size_t	size() const;
+			bool	empty() const { return size() == 0; }
+
+			bool	tryPush( const T& value );
+			bool	tryPop( T& value );
+			/* push/pop up to n elements, returns the number of elements transferred */
+			size_t	tryPushBatch( const T* values, size_t n );
+			size_t	tryPopBatch( T* values, size_t n );
+
+			void	push( const T& value );
+			void	pop( T& value );
+			/* wait at most timeoutms milliseconds, returns false on timeout */
+			bool	push( const T& value, size_t timeoutms );
+			bool	pop( T& value, size_t timeoutms );
+			/* push all n elements, waiting for space as necessary */
+			void	pushBatch( const T* values, size_t n );
+			/* wait for at least one element and pop up to n, returns the number of elements */
+			size_t	popBatch( T* values, size_t n );
+
+		private:
+			SPSCQueue( const SPSCQueue& );
+			SPSCQueue& operator=( const SPSCQueue& );
+
+			typedef typename std::aligned_storage<sizeof( T ), alignof( T )>::type Storage;
+
+			T* slot( size_t pos ) { return reinterpret_cast<T*>( &_buffer[ pos & _mask ] ); }
+
+			Storage*			_buffer;
+			size_t				_mask;
+			QueueWaiter			_notEmpty;
+			QueueWaiter			_notFull;
+
+			/* consumer and producer data on separate cache lines */
+			uint8_t				_pad0[ 64 ];
+			std::atomic<size_t>	_head;
+			size_t				_tailCache;
+			uint8_t				_pad1[ 64 ];
+			std::atomic<size_t>	_tail;
+			size_t				_headCache;
+			uint8_t				_pad2[ 64 ];
+	};
+
+	template<typename T>
+	inline SPSCQueue<T>::SPSCQueue( size_t capacity ) :
+		_head( 0 ),
+		_tailCache( 0 ),
+		_tail( 0 ),
+		_headCache( 0 )
+	{
+		size_t n = 2;
+		while( n < capacity )
+			n <<= 1;
+		_buffer = new Storage[ n ];
+		_mask = n - 1;
+	}
+
+	template<typename T>
+	inline SPSCQueue<T>::~SPSCQueue()
+	{
+		size_t tail = _tail.load( std::memory_order_relaxed );
+		for( size_t pos = _head.load( std::memory_order_relaxed ); pos != tail; pos++ )
+			slot( pos )->~T();
+		delete[] _buffer;
+	}
+
+	template<typename T>
+	inline size_t SPSCQueue<T>::size() const
+	{
+		size_t head = _head.load( std::memory_order_acquire );
+		size_t tail = _tail.load( std::memory_order_acquire );
+		return tail - head;
+	}
+
+	template<typename T>
+	inline size_t SPSCQueue<T>::tryPushBatch( const T* values, size_t n )
+	{
+		size_t tail = _tail.load( std::memory_order_relaxed );
+		size_t space = capacity() - ( tail - _headCache );
+		if( space < n ) {
+			_headCache = _head.load( std::memory_order_acquire );
+			space = capacity() - ( tail - _headCache );
+		}
+
+		n = Math::min( n, space );
+		if( !n )
+			return 0;
+		for( size_t i = 0; i < n; i++ )
+			new( slot( tail + i ) ) T( values[ i ] );
+		_tail.store( tail + n, std::memory_order_release );
+		_notEmpty.notify();
+		return n;
+	}
+
+	template<typename T>
+	inline size_t SPSCQueue<T>::tryPopBatch( T* values, size_t n )
+	{
+		size_t head = _head.load( std::memory_order_relaxed );
+		size_t avail = _tailCache - head;
+		if( avail < n ) {
+			_tailCache = _tail.load( std::memory_order_acquire );
+			avail = _tailCache - head;
+		}
+
+		n = Math::min( n, avail );
+		if( !n )
+			return 0;
+		for( size_t i = 0; i < n; i++ ) {
+			T* value = slot( head + i );
+			values[ i ] = std::move( *value );
+			value->~T();
+		}
+		_head.store( head + n, std::memory_order_release );
+		_notFull.notify();
+		return n;
+	}
+
+	template<typename T>
+	inline bool SPSCQueue<T>::tryPush( const T& value )
+	{
+		return tryPushBatch( &value, 1 ) == 1;
+	}
+
+	template<typename T>
+	inline bool SPSCQueue<T>::tryPop( T& value )
+	{
+		return tryPopBatch( &value, 1 ) == 1;
+	}
+
+	template<typename T>
+	inline void SPSCQueue<T>::push( const T& value )
+	{
+		while( !tryPush( value ) )
+			_notFull.wait( [ this ]() { return size() < capacity(); } );
+	}
+
+	template<typename T>
+	inline void SPSCQueue<T>::pop( T& value )
+	{
+		while( !tryPop( value ) )
+			_notEmpty.wait( [ this ]() { return size() > 0; } );
+	}
+
+	template<typename T>
+	inline bool SPSCQueue<T>::push( const T& value, size_t timeoutms )
+	{
+		if( tryPush( value ) )
+			return true;
+		return _notFull.wait( [ this ]() { return size() < capacity(); }, timeoutms ) && tryPush( value );
+	}
+
+	template<typename T>
+	inline bool SPSCQueue<T>::pop( T& value, size_t timeoutms )
+	{
+		if( tryPop( value ) )
+			return true;
+		return _notEmpty.wait( [ this ]() { return size() > 0; }, timeoutms ) && tryPop( value );
+	}
+
+	template<typename T>
+	inline void SPSCQueue<T>::pushBatch( const T* values, size_t n )
+	{
+		while( n ) {
+			size_t pushed = tryPushBatch( values, n );
+			values += pushed;
+			n -= pushed;
+			if( n )
+				_notFull.wait( [ this ]() { return size() < capacity(); } );
+		}
+	}
+
+	template<typename T>
+	inline size_t SPSCQueue<T>::popBatch( T* values, size_t n )
+	{
+		size_t popped = 0;
+		while( n && !( popped = tryPopBatch( values, n ) ) )
+			_notEmpty.wait( [ this ]() { return size() > 0; } );
+		return popped;
+	}
+
+}
+
+#endif
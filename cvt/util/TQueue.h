@@ -26,46 +26,84 @@
 #define CVTTQUEUE_H
 
 #include <deque>
+#include <cvt/util/MPMCQueue.h>
 #include <cvt/util/Mutex.h>
-#include <cvt/util/Condition.h>
 
 namespace cvt {
+	/**
+	  @brief Unbounded queue, kept for compatibility on top of MPMCQueue
+
+	  Elements go through the lock-free queue, only if it is full they are appended to an
+	  overflow list guarded by a mutex. While the overflow list is not empty new elements are
+	  appended to it as well, so the order is preserved.
+	 */
 	template<typename T>
 	class TQueue {
 		public:
-			TQueue() {};
+			TQueue( size_t capacity = 1024 ) : _queue( capacity ), _overflowSize( 0 ) {};
 			~TQueue() {};
 			void enqueue( T a );
 			T waitNext();
 
 		private:
-			std::deque<T> _queue;
-			Mutex _mutex;
-			Condition _cond;
+			bool tryNext( T& e );
+
+			MPMCQueue<T>		_queue;
+			std::deque<T>		_overflow;
+			std::atomic<size_t>	_overflowSize;
+			Mutex				_mutex;
+			QueueWaiter			_waiter;
 	};
 
 	template<typename T>
 	void TQueue<T>::enqueue( T e )
 	{
+		if( !_overflowSize.load( std::memory_order_acquire ) && _queue.tryPush( e ) ) {
+			_waiter.notify();
+			return;
+		}
+
 		_mutex.lock();
-		_queue.push_back( e );
-		_cond.notify();
+		if( _overflow.empty() && _queue.tryPush( e ) ) {
+			_mutex.unlock();
+			_waiter.notify();
+			return;
+		}
+		_overflow.push_back( e );
+		_overflowSize.store( _overflow.size(), std::memory_order_release );
 		_mutex.unlock();
+		_waiter.notify();
 	}
 
 	template<typename T>
-	T TQueue<T>::waitNext()
+	bool TQueue<T>::tryNext( T& e )
 	{
-		T ret;
+		/* the lock-free queue only holds elements older than the overflow list */
+		if( _queue.tryPop( e ) )
+			return true;
+		if( !_overflowSize.load( std::memory_order_acquire ) )
+			return false;
+
 		_mutex.lock();
-		while( _queue.empty() )
-			_cond.wait( _mutex );
-		ret = _queue.front();
-		_queue.pop_front();
+		bool ret = !_overflow.empty();
+		if( ret ) {
+			e = std::move( _overflow.front() );
+			_overflow.pop_front();
+			_overflowSize.store( _overflow.size(), std::memory_order_release );
+		}
 		_mutex.unlock();
 		return ret;
 	}
 
+	template<typename T>
+	T TQueue<T>::waitNext()
+	{
+		T ret;
+		while( !tryNext( ret ) )
+			_waiter.wait( [ this ]() { return !_queue.empty() || _overflowSize.load( std::memory_order_acquire ); } );
+		return ret;
+	}
+
 }
 
 
@@ -0,0 +1,154 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/util/TaskGraph.h>
+#include <cvt/util/Time.h>
+
+namespace cvt {
+
+	TaskGraph::TaskGraph( ThreadPool& pool ) : _pool( pool ), _time( 0.0 )
+	{
+	}
+
+	TaskGraph::~TaskGraph()
+	{
+		clear();
+	}
+
+	size_t TaskGraph::addTask( const String& name, const std::function<void()>& func )
+	{
+		Node* node = new Node();
+		node->name = name;
+		node->func = func;
+		node->numPredecessors = 0;
+		node->pending = 0;
+		node->time = 0.0;
+		_nodes.push_back( node );
+		return _nodes.size() - 1;
+	}
+
+	void TaskGraph::addDependency( size_t before, size_t after )
+	{
+		if( before >= _nodes.size() || after >= _nodes.size() )
+			throw CVTException( "Invalid task id" );
+		_nodes[ before ]->successors.push_back( after );
+		_nodes[ after ]->numPredecessors++;
+	}
+
+	void TaskGraph::clear()
+	{
+		for( size_t i = 0; i < _nodes.size(); i++ )
+			delete _nodes[ i ];
+		_nodes.clear();
+		_time = 0.0;
+	}
+
+	void TaskGraph::execute()
+	{
+		checkAcyclic();
+
+		Time t;
+		std::vector<size_t> roots;
+		for( size_t i = 0; i < _nodes.size(); i++ ) {
+			_nodes[ i ]->pending = _nodes[ i ]->numPredecessors;
+			_nodes[ i ]->time = 0.0;
+			if( !_nodes[ i ]->numPredecessors )
+				roots.push_back( i );
+		}
+
+		try {
+			runNodes( roots );
+		} catch( ... ) {
+			_time = t.elapsedMilliSeconds();
+			throw;
+		}
+		_time = t.elapsedMilliSeconds();
+	}
+
+	void TaskGraph::runNodes( const std::vector<size_t>& ids )
+	{
+		std::vector<NodeTask> tasks;
+		std::vector<ThreadPoolTask*> ptrs;
+		tasks.reserve( ids.size() );
+		ptrs.reserve( ids.size() );
+		for( size_t i = 0; i < ids.size(); i++ ) {
+			tasks.push_back( NodeTask( this, ids[ i ] ) );
+			ptrs.push_back( &tasks.back() );
+		}
+		if( !ptrs.empty() )
+			_pool.run( &ptrs[ 0 ], ptrs.size() );
+	}
+
+	void TaskGraph::runNode( size_t id )
+	{
+		std::vector<size_t> ready;
+		while( true ) {
+			Node* node = _nodes[ id ];
+
+			Time t;
+			node->func();
+			node->time = t.elapsedMilliSeconds();
+
+			/* the last finishing predecessor starts a task */
+			ready.clear();
+			for( size_t i = 0; i < node->successors.size(); i++ ) {
+				size_t s = node->successors[ i ];
+				if( --_nodes[ s ]->pending == 0 )
+					ready.push_back( s );
+			}
+
+			if( ready.size() != 1 )
+				break;
+			/* continue a chain on this thread */
+			id = ready[ 0 ];
+		}
+
+		runNodes( ready );
+	}
+
+	void TaskGraph::checkAcyclic() const
+	{
+		std::vector<size_t> indegree( _nodes.size() );
+		std::vector<size_t> stack;
+		for( size_t i = 0; i < _nodes.size(); i++ ) {
+			indegree[ i ] = _nodes[ i ]->numPredecessors;
+			if( !indegree[ i ] )
+				stack.push_back( i );
+		}
+
+		size_t visited = 0;
+		while( !stack.empty() ) {
+			const Node* node = _nodes[ stack.back() ];
+			stack.pop_back();
+			visited++;
+			for( size_t i = 0; i < node->successors.size(); i++ ) {
+				if( !--indegree[ node->successors[ i ] ] )
+					stack.push_back( node->successors[ i ] );
+			}
+		}
+
+		if( visited != _nodes.size() )
+			throw CVTException( "TaskGraph contains a cycle" );
+	}
+}
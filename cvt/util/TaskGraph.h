@@ -0,0 +1,124 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_TASKGRAPH_H
+#define CVT_TASKGRAPH_H
+
+#include <cvt/util/ThreadPool.h>
+#include <cvt/util/String.h>
+
+#include <vector>
+#include <functional>
+#include <atomic>
+
+namespace cvt {
+
+	/**
+	  @brief Dependency graph of tasks executed on a ThreadPool
+
+	  A task is started as soon as all of its predecessors have finished, so independent
+	  chains of tasks run concurrently. The execution time of every task and of the whole
+	  graph is measured in each execute() call.
+	 */
+	class TaskGraph {
+		public:
+			TaskGraph( ThreadPool& pool = ThreadPool::instance() );
+			~TaskGraph();
+
+			/**
+			  @return id of the new task
+			 */
+			size_t			addTask( const String& name, const std::function<void()>& func );
+
+			/**
+			  @brief The task after is not started before the task before has finished
+			 */
+			void			addDependency( size_t before, size_t after );
+
+			/* removes all tasks */
+			void			clear();
+
+			/**
+			  @brief Execute all tasks and wait for them to finish
+			  Throws if the graph contains a cycle. The first exception thrown by a task is rethrown
+			  as cvt::Exception, the successors of a failed task are not executed.
+			 */
+			void			execute();
+
+			size_t			numTasks() const { return _nodes.size(); }
+			const String&	taskName( size_t id ) const;
+
+			/* duration of the task in milliseconds in the last execute() call */
+			double			taskTime( size_t id ) const;
+
+			/* duration of the last execute() call in milliseconds */
+			double			time() const { return _time; }
+
+		private:
+			TaskGraph( const TaskGraph& );
+			TaskGraph& operator=( const TaskGraph& );
+
+			struct Node {
+				String					name;
+				std::function<void()>	func;
+				std::vector<size_t>		successors;
+				size_t					numPredecessors;
+				std::atomic<size_t>		pending;
+				double					time;
+			};
+
+			class NodeTask : public ThreadPoolTask {
+				public:
+					NodeTask( TaskGraph* graph, size_t id ) : _graph( graph ), _id( id ) {}
+					void execute() { _graph->runNode( _id ); }
+				private:
+					TaskGraph*	_graph;
+					size_t		_id;
+			};
+
+			void			runNode( size_t id );
+			void			runNodes( const std::vector<size_t>& ids );
+			void			checkAcyclic() const;
+
+			ThreadPool&			_pool;
+			std::vector<Node*>	_nodes;
+			double				_time;
+	};
+
+	inline const String& TaskGraph::taskName( size_t id ) const
+	{
+		if( id >= _nodes.size() )
+			throw CVTException( "Invalid task id" );
+		return _nodes[ id ]->name;
+	}
+
+	inline double TaskGraph::taskTime( size_t id ) const
+	{
+		if( id >= _nodes.size() )
+			throw CVTException( "Invalid task id" );
+		return _nodes[ id ]->time;
+	}
+}
+
+#endif
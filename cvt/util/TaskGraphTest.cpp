@@ -0,0 +1,144 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/util/TaskGraph.h>
+#include <cvt/util/CVTTest.h>
+
+#include <vector>
+
+using namespace cvt;
+
+/* tasks live outside of the test body, extracttests.sh registers every symbol containing "_test" */
+class TaskGraphTestRecord
+{
+	public:
+		TaskGraphTestRecord( std::vector<int>& order, std::atomic<int>& counter, size_t idx ) :
+			_order( order ), _counter( counter ), _idx( idx )
+		{
+		}
+
+		void operator()() const { _order[ _idx ] = _counter++; }
+
+	private:
+		std::vector<int>&	_order;
+		std::atomic<int>&	_counter;
+		size_t				_idx;
+};
+
+class TaskGraphTestFlag
+{
+	public:
+		TaskGraphTestFlag( bool& flag ) : _flag( flag ) {}
+
+		void operator()() const { _flag = true; }
+
+	private:
+		bool& _flag;
+};
+
+static void _taskGraphNop()
+{
+}
+
+static void _taskGraphFail()
+{
+	throw CVTException( "task failure" );
+}
+
+BEGIN_CVTTEST( TaskGraph )
+	bool result = true;
+	bool b;
+
+	ThreadPool pool( 4 );
+
+	{
+		/* two chains of length 50 joined by a final task */
+		TaskGraph graph( pool );
+		std::vector<int> order( 101, -1 );
+		std::atomic<int> counter( 0 );
+
+		size_t prev[ 2 ];
+		for( size_t c = 0; c < 2; c++ ) {
+			for( size_t i = 0; i < 50; i++ ) {
+				size_t idx = c * 50 + i;
+				size_t id = graph.addTask( "chain", TaskGraphTestRecord( order, counter, idx ) );
+				if( i )
+					graph.addDependency( prev[ c ], id );
+				prev[ c ] = id;
+			}
+		}
+		size_t join = graph.addTask( "join", TaskGraphTestRecord( order, counter, 100 ) );
+		graph.addDependency( prev[ 0 ], join );
+		graph.addDependency( prev[ 1 ], join );
+
+		b = true;
+		for( size_t run = 0; run < 2; run++ ) {
+			counter = 0;
+			graph.execute();
+			b &= order[ 100 ] == 100;
+			for( size_t c = 0; c < 2; c++ ) {
+				for( size_t i = 1; i < 50; i++ )
+					b &= order[ c * 50 + i - 1 ] < order[ c * 50 + i ];
+			}
+		}
+		b &= graph.taskName( join ) == "join";
+		CVTTEST_PRINT( "dependency order", b );
+		result &= b;
+	}
+
+	{
+		TaskGraph graph( pool );
+		size_t a = graph.addTask( "a", _taskGraphNop );
+		size_t c = graph.addTask( "b", _taskGraphNop );
+		graph.addDependency( a, c );
+		graph.addDependency( c, a );
+		b = false;
+		try {
+			graph.execute();
+		} catch( const Exception& ) {
+			b = true;
+		}
+		CVTTEST_PRINT( "cycle detection", b );
+		result &= b;
+	}
+
+	{
+		TaskGraph graph( pool );
+		bool executed = false;
+		size_t a = graph.addTask( "fail", _taskGraphFail );
+		size_t c = graph.addTask( "successor", TaskGraphTestFlag( executed ) );
+		graph.addDependency( a, c );
+		b = false;
+		try {
+			graph.execute();
+		} catch( const Exception& ) {
+			b = true;
+		}
+		b &= !executed;
+		CVTTEST_PRINT( "exception propagation", b );
+		result &= b;
+	}
+
+	return result;
+END_CVTTEST
@@ -0,0 +1,225 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_TEXTPARSER_H
+#define CVT_TEXTPARSER_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+
+namespace cvt {
+
+	/**
+	  @brief Bounded number and line scanning for bulk text formats
+
+	  In contrast to strtod/strtol the parsers never read past the end pointer, so they
+	  can be used on memory mapped files that are not null terminated. Floats with up
+	  to 19 significant digits are parsed without calling into the C library.
+	 */
+	class TextParser {
+		public:
+			static inline bool		  parseFloat( const char*& pos, const char* end, float& value );
+			static inline bool		  parseInt( const char*& pos, const char* end, long& value );
+			/* skip spaces, tabs and carriage returns */
+			static inline void		  skipBlank( const char*& pos, const char* end );
+			/* the position after the next newline or end */
+			static inline const char* nextLine( const char* pos, const char* end );
+			/* true if the line contains nothing but blanks */
+			static inline bool		  isBlankLine( const char* pos, const char* end );
+			/* splits [begin, end) into at most n chunks starting at line beginnings, bounds gets
+			   the chunk starts followed by end */
+			static inline void		  splitLines( std::vector<const char*>& bounds, const char* begin, const char* end, size_t n );
+
+		private:
+			static inline bool		  isDigit( char c ) { return ( unsigned char ) ( c - '0' ) < 10; }
+			static inline bool		  parseFloatSlow( const char*& pos, const char* end, float& value );
+	};
+
+	inline void TextParser::skipBlank( const char*& pos, const char* end )
+	{
+		while( pos < end && ( *pos == ' ' || *pos == '\t' || *pos == '\r' ) )
+			pos++;
+	}
+
+	inline const char* TextParser::nextLine( const char* pos, const char* end )
+	{
+		const char* nl = ( const char* ) memchr( pos, '\n', end - pos );
+		return nl ? nl + 1 : end;
+	}
+
+	inline bool TextParser::isBlankLine( const char* pos, const char* end )
+	{
+		skipBlank( pos, end );
+		return pos == end || *pos == '\n';
+	}
+
+	inline void TextParser::splitLines( std::vector<const char*>& bounds, const char* begin, const char* end, size_t n )
+	{
+		size_t len = end - begin;
+		if( !n )
+			n = 1;
+
+		bounds.clear();
+		bounds.push_back( begin );
+		for( size_t i = 1; i < n; i++ ) {
+			const char* pos = begin + ( len * i ) / n;
+			if( pos <= bounds.back() )
+				continue;
+			/* a chunk starts at a line beginning */
+			if( pos[ -1 ] != '\n' )
+				pos = nextLine( pos, end );
+			if( pos > bounds.back() && pos < end )
+				bounds.push_back( pos );
+		}
+		bounds.push_back( end );
+	}
+
+	inline bool TextParser::parseInt( const char*& pos, const char* end, long& value )
+	{
+		const char* p = pos;
+		bool neg = false;
+
+		while( p < end && ( *p == ' ' || *p == '\t' ) )
+			p++;
+		if( p < end && ( *p == '-' || *p == '+' ) )
+			neg = *p++ == '-';
+		if( p == end || !isDigit( *p ) )
+			return false;
+
+		long v = 0;
+		while( p < end && isDigit( *p ) )
+			v = v * 10 + ( *p++ - '0' );
+
+		value = neg ? -v : v;
+		pos = p;
+		return true;
+	}
+
+	inline bool TextParser::parseFloat( const char*& pos, const char* end, float& value )
+	{
+		static const double pow10[] = {
+			1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+		const char* p = pos;
+		bool neg = false;
+		bool any = false;
+		uint64_t mant = 0;
+		int digits = 0;
+		int exp10 = 0;
+
+		while( p < end && ( *p == ' ' || *p == '\t' ) )
+			p++;
+		if( p < end && ( *p == '-' || *p == '+' ) )
+			neg = *p++ == '-';
+
+		/* significant digits beyond the 19th only change the exponent */
+		while( p < end && isDigit( *p ) ) {
+			if( digits < 19 ) {
+				mant = mant * 10 + ( *p - '0' );
+				digits += mant != 0;
+			} else
+				exp10++;
+			p++;
+			any = true;
+		}
+		if( p < end && *p == '.' ) {
+			p++;
+			while( p < end && isDigit( *p ) ) {
+				if( digits < 19 ) {
+					mant = mant * 10 + ( *p - '0' );
+					digits += mant != 0;
+					exp10--;
+				}
+				p++;
+				any = true;
+			}
+		}
+
+		/* inf, nan and friends */
+		if( !any )
+			return parseFloatSlow( pos, end, value );
+
+		if( p < end && ( *p == 'e' || *p == 'E' ) ) {
+			const char* e = p + 1;
+			bool eneg = false;
+			if( e < end && ( *e == '-' || *e == '+' ) )
+				eneg = *e++ == '-';
+			if( e < end && isDigit( *e ) ) {
+				int ev = 0;
+				while( e < end && isDigit( *e ) ) {
+					if( ev < 10000 )
+						ev = ev * 10 + ( *e - '0' );
+					e++;
+				}
+				exp10 += eneg ? -ev : ev;
+				p = e;
+			}
+		}
+
+		double v = ( double ) mant;
+		if( mant ) {
+			if( exp10 < 0 ) {
+				if( exp10 >= -22 )
+					v /= pow10[ -exp10 ];
+				else
+					v *= pow( 10.0, exp10 );
+			} else if( exp10 > 0 ) {
+				if( exp10 <= 22 )
+					v *= pow10[ exp10 ];
+				else
+					v *= pow( 10.0, exp10 );
+			}
+		}
+
+		value = ( float ) ( neg ? -v : v );
+		pos = p;
+		return true;
+	}
+
+	inline bool TextParser::parseFloatSlow( const char*& pos, const char* end, float& value )
+	{
+		char buf[ 64 ];
+		size_t n = 0;
+
+		while( pos + n < end && n < sizeof( buf ) - 1 && pos[ n ] != '\n' ) {
+			buf[ n ] = pos[ n ];
+			n++;
+		}
+		buf[ n ] = '\0';
+
+		char* ep;
+		value = strtof( buf, &ep );
+		if( ep == buf )
+			return false;
+		pos += ep - buf;
+		return true;
+	}
+
+}
+
+#endif
@@ -0,0 +1,111 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/util/TextParser.h>
+#include <cvt/util/CVTTest.h>
+#include <cvt/util/String.h>
+#include <cvt/math/Math.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+
+using namespace cvt;
+
+static bool _parseAll( const char* str, float* values, size_t n )
+{
+	const char* pos = str;
+	const char* end = str + strlen( str );
+	for( size_t i = 0; i < n; i++ ) {
+		if( !TextParser::parseFloat( pos, end, values[ i ] ) )
+			return false;
+	}
+	return true;
+}
+
+BEGIN_CVTTEST( TextParser )
+	bool result = true;
+	bool b;
+
+	{
+		const char* str = "0 -1.5 +2.25e3 1e-5 .5 -0.000123456789 3.4028235e38 1234567890123456789012 -7E+2";
+		float values[ 9 ];
+		b = _parseAll( str, values, 9 );
+
+		/* compare with strtof */
+		char* pos = ( char* ) str;
+		for( size_t i = 0; i < 9 && b; i++ ) {
+			float ref = strtof( pos, &pos );
+			b &= Math::abs( values[ i ] - ref ) <= Math::abs( ref ) * Math::EPSILONF;
+		}
+		CVTTEST_PRINT( "parseFloat", b );
+		result &= b;
+
+		b = true;
+		char buf[ 64 ];
+		srand( 1 );
+		for( size_t i = 0; i < 10000 && b; i++ ) {
+			float ref = ( ( float ) rand() / RAND_MAX - 0.5f ) * powf( 10.0f, ( rand() % 20 ) - 10 );
+			float val;
+			snprintf( buf, sizeof( buf ), "%.9g", ref );
+			b &= _parseAll( buf, &val, 1 ) && Math::abs( val - ref ) <= Math::abs( ref ) * Math::EPSILONF;
+		}
+		CVTTEST_PRINT( "parseFloat round trip", b );
+		result &= b;
+	}
+
+	{
+		/* the parsers must stop at the end pointer */
+		const char* str = "12345";
+		const char* pos = str;
+		float fval;
+		long ival;
+		b = TextParser::parseFloat( pos, str + 3, fval ) && fval == 123.0f && pos == str + 3;
+		pos = str;
+		b &= TextParser::parseInt( pos, str + 2, ival ) && ival == 12 && pos == str + 2;
+		pos = str;
+		b &= !TextParser::parseInt( pos, str, ival ) && pos == str;
+		pos = "x";
+		b &= !TextParser::parseFloat( pos, pos + 1, fval );
+		CVTTEST_PRINT( "bounded parsing", b );
+		result &= b;
+	}
+
+	{
+		String text;
+		for( size_t i = 0; i < 1000; i++ )
+			text += "line\n";
+		const char* begin = text.c_str();
+		const char* end = begin + text.length();
+		std::vector<const char*> bounds;
+		TextParser::splitLines( bounds, begin, end, 7 );
+
+		b = bounds.size() >= 2 && bounds.front() == begin && bounds.back() == end;
+		for( size_t i = 1; i + 1 < bounds.size(); i++ )
+			b &= bounds[ i ] > bounds[ i - 1 ] && bounds[ i ][ -1 ] == '\n';
+		CVTTEST_PRINT( "splitLines", b );
+		result &= b;
+	}
+
+	return result;
+END_CVTTEST
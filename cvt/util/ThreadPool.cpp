@@ -0,0 +1,292 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/util/ThreadPool.h>
+#include <cvt/util/Util.h>
+#include <cvt/util/String.h>
+
+#include <unistd.h>
+#include <stdlib.h>
+
+namespace cvt {
+
+	class ThreadPoolTaskGroup {
+		public:
+			ThreadPoolTaskGroup( size_t n ) : pending( n ), failed( false ) {}
+
+			Mutex		mutex;
+			Condition	cond;
+			size_t		pending;
+			bool		failed;
+			std::string error;
+	};
+
+	/* the pool and queue index of the worker running on this thread */
+	static __thread const ThreadPool* _tlsPool = NULL;
+	static __thread size_t _tlsWorker = 0;
+
+	ThreadPool::ThreadPool() : _queued( 0 ), _next( 0 ), _stop( false )
+	{
+		size_t hw = hardwareConcurrency();
+		init( hw > 1 ? hw - 1 : 0 );
+	}
+
+	ThreadPool::ThreadPool( size_t numThreads ) : _queued( 0 ), _next( 0 ), _stop( false )
+	{
+		init( numThreads );
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		_mutex.lock();
+		_stop = true;
+		_cond.notifyAll();
+		_mutex.unlock();
+
+		for( size_t i = 0; i < _workers.size(); i++ ) {
+			_workers[ i ]->join();
+			delete _workers[ i ];
+		}
+
+		for( size_t i = 0; i < _queues.size(); i++ )
+			delete _queues[ i ];
+	}
+
+	void ThreadPool::init( size_t numThreads )
+	{
+		for( size_t i = 0; i < numThreads; i++ )
+			_queues.push_back( new TaskQueue() );
+
+		for( size_t i = 0; i < numThreads; i++ ) {
+			_workers.push_back( new Worker( i ) );
+			_workers.back()->run( this );
+		}
+	}
+
+	ThreadPool& ThreadPool::instance()
+	{
+		static Mutex _instanceMutex;
+		static ThreadPool* _pool = NULL;
+
+		ScopeLock lock( &_instanceMutex );
+		if( !_pool ) {
+			String env;
+			long n;
+			/* CVT_NUM_THREADS counts the calling thread as well */
+			if( Util::getEnv( env, "CVT_NUM_THREADS" ) && ( n = atol( env.c_str() ) ) > 0 )
+				_pool = new ThreadPool( ( size_t ) n - 1 );
+			else
+				_pool = new ThreadPool();
+		}
+		return *_pool;
+	}
+
+	size_t ThreadPool::hardwareConcurrency()
+	{
+		long n = sysconf( _SC_NPROCESSORS_ONLN );
+		return n > 0 ? ( size_t ) n : 1;
+	}
+
+	ssize_t ThreadPool::currentWorker() const
+	{
+		if( _tlsPool == this )
+			return ( ssize_t ) _tlsWorker;
+		return -1;
+	}
+
+	void ThreadPool::run( ThreadPoolTask** tasks, size_t n )
+	{
+		if( !n )
+			return;
+
+		ThreadPoolTaskGroup group( n );
+		for( size_t i = 0; i < n; i++ )
+			tasks[ i ]->_group = &group;
+
+		if( _workers.empty() ) {
+			for( size_t i = 0; i < n; i++ )
+				executeTask( tasks[ i ] );
+		} else {
+			/* count the tasks before publishing them, a worker may pop them right away */
+			_mutex.lock();
+			_queued += n;
+			_mutex.unlock();
+
+			ssize_t self = currentWorker();
+			if( self >= 0 ) {
+				/* keep nested work local, idle workers will steal it */
+				TaskQueue* q = _queues[ self ];
+				q->mutex.lock();
+				for( size_t i = 0; i < n; i++ )
+					q->tasks.push_back( tasks[ i ] );
+				q->mutex.unlock();
+			} else {
+				_mutex.lock();
+				size_t next = _next;
+				_next = ( _next + n ) % _queues.size();
+				_mutex.unlock();
+
+				for( size_t i = 0; i < n; i++ ) {
+					TaskQueue* q = _queues[ ( next + i ) % _queues.size() ];
+					q->mutex.lock();
+					q->tasks.push_back( tasks[ i ] );
+					q->mutex.unlock();
+				}
+			}
+
+			_mutex.lock();
+			_cond.notifyAll();
+			_mutex.unlock();
+
+			/* help until all tasks of this group are done */
+			while( true ) {
+				ThreadPoolTask* task = NULL;
+				if( self >= 0 )
+					task = popTask( self );
+				if( !task )
+					task = stealTask( self >= 0 ? self : 0 );
+
+				if( task ) {
+					executeTask( task );
+					continue;
+				}
+
+				group.mutex.lock();
+				while( group.pending )
+					group.cond.wait( group.mutex );
+				group.mutex.unlock();
+				break;
+			}
+		}
+
+		/* make sure the last finishing task released the group */
+		group.mutex.lock();
+		bool failed = group.failed;
+		std::string error = group.error;
+		group.mutex.unlock();
+
+		if( failed )
+			throw CVTException( error );
+	}
+
+	ThreadPoolTask* ThreadPool::popTask( size_t id )
+	{
+		ThreadPoolTask* task = NULL;
+		TaskQueue* q = _queues[ id ];
+
+		q->mutex.lock();
+		if( !q->tasks.empty() ) {
+			task = q->tasks.back();
+			q->tasks.pop_back();
+		}
+		q->mutex.unlock();
+
+		if( task ) {
+			_mutex.lock();
+			_queued--;
+			_mutex.unlock();
+		}
+		return task;
+	}
+
+	ThreadPoolTask* ThreadPool::stealTask( size_t id )
+	{
+		size_t nqueues = _queues.size();
+		for( size_t i = 0; i < nqueues; i++ ) {
+			ThreadPoolTask* task = NULL;
+			TaskQueue* q = _queues[ ( id + i ) % nqueues ];
+
+			q->mutex.lock();
+			if( !q->tasks.empty() ) {
+				task = q->tasks.front();
+				q->tasks.pop_front();
+			}
+			q->mutex.unlock();
+
+			if( task ) {
+				_mutex.lock();
+				_queued--;
+				_mutex.unlock();
+				return task;
+			}
+		}
+		return NULL;
+	}
+
+	void ThreadPool::executeTask( ThreadPoolTask* task )
+	{
+		ThreadPoolTaskGroup* group = task->_group;
+		bool failed = false;
+		std::string error;
+
+		try {
+			task->execute();
+		} catch( const Exception& e ) {
+			failed = true;
+			error = e.what();
+		} catch( const std::exception& e ) {
+			failed = true;
+			error = e.what();
+		} catch( ... ) {
+			failed = true;
+			error = "Unknown exception in ThreadPool task";
+		}
+
+		/* the group lives on the stack of the submitting thread, do not touch it after the unlock */
+		group->mutex.lock();
+		if( failed && !group->failed ) {
+			group->failed = true;
+			group->error = error;
+		}
+		if( !--group->pending )
+			group->cond.notifyAll();
+		group->mutex.unlock();
+	}
+
+	void ThreadPool::workerLoop( size_t id )
+	{
+		_tlsPool = this;
+		_tlsWorker = id;
+
+		while( true ) {
+			ThreadPoolTask* task = popTask( id );
+			if( !task )
+				task = stealTask( id + 1 );
+
+			if( task ) {
+				executeTask( task );
+				continue;
+			}
+
+			_mutex.lock();
+			while( !_queued && !_stop )
+				_cond.wait( _mutex );
+			bool stop = _stop && !_queued;
+			_mutex.unlock();
+
+			if( stop )
+				break;
+		}
+	}
+}
@@ -0,0 +1,181 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_THREADPOOL_H
+#define CVT_THREADPOOL_H
+
+#include <cvt/util/Thread.h>
+#include <cvt/util/Mutex.h>
+#include <cvt/util/Condition.h>
+#include <cvt/util/Exception.h>
+#include <cvt/math/Math.h>
+
+#include <deque>
+#include <vector>
+#include <string>
+
+namespace cvt {
+	class ThreadPool;
+	class ThreadPoolTaskGroup;
+
+	/**
+	  @brief Unit of work executed by a ThreadPool
+	 */
+	class ThreadPoolTask {
+		friend class ThreadPool;
+		public:
+			ThreadPoolTask() : _group( NULL ) {}
+			virtual ~ThreadPoolTask() {}
+			virtual void execute() = 0;
+
+		private:
+			ThreadPoolTaskGroup* _group;
+	};
+
+	/**
+	  @brief Persistent pool of worker threads with per-worker work-stealing queues
+
+	  Every worker owns a task queue. Tasks submitted by a worker are pushed to its own queue,
+	  tasks submitted from other threads are distributed round-robin. Idle workers steal from the
+	  front of the other queues. The submitting thread takes part in the work until all its tasks
+	  are done, so nested parallel calls from within tasks do not deadlock.
+	 */
+	class ThreadPool {
+		public:
+			/**
+			  @brief Pool with hardwareConcurrency() - 1 workers, the calling thread is the remaining one
+			 */
+			ThreadPool();
+
+			/**
+			  @param numThreads number of worker threads, with 0 workers all tasks run on the calling thread
+			 */
+			explicit ThreadPool( size_t numThreads );
+			~ThreadPool();
+
+			size_t numThreads() const;
+
+			/**
+			  @brief Execute the tasks and wait for all of them to finish
+			  The first exception thrown by a task is rethrown as cvt::Exception after all tasks finished.
+			 */
+			void run( ThreadPoolTask** tasks, size_t n );
+
+			/**
+			  @brief Split [begin, end) into chunks of at least grain elements and call func( start, end ) for every chunk in parallel
+			 */
+			template<typename FUNC>
+			void parallelFor( size_t begin, size_t end, size_t grain, FUNC func );
+
+			/**
+			  @brief The global pool, the number of workers can be overridden by the CVT_NUM_THREADS environment variable
+			 */
+			static ThreadPool& instance();
+			static size_t hardwareConcurrency();
+
+		private:
+			ThreadPool( const ThreadPool& );
+			ThreadPool& operator=( const ThreadPool& );
+
+			class Worker : public Thread<ThreadPool> {
+				public:
+					Worker( size_t id ) : _id( id ) {}
+					void execute( ThreadPool* pool ) { pool->workerLoop( _id ); }
+
+				private:
+					size_t _id;
+			};
+
+			struct TaskQueue {
+				Mutex						 mutex;
+				std::deque<ThreadPoolTask*> tasks;
+			};
+
+			template<typename FUNC>
+			class RangeTask : public ThreadPoolTask {
+				public:
+					RangeTask( FUNC& func, size_t start, size_t end ) : _func( func ), _start( start ), _end( end ) {}
+					void execute() { _func( _start, _end ); }
+
+				private:
+					FUNC&  _func;
+					size_t _start;
+					size_t _end;
+			};
+
+			void			init( size_t numThreads );
+			void			workerLoop( size_t id );
+			ThreadPoolTask* popTask( size_t id );
+			ThreadPoolTask* stealTask( size_t id );
+			void			executeTask( ThreadPoolTask* task );
+			ssize_t			currentWorker() const;
+
+			std::vector<TaskQueue*> _queues;
+			std::vector<Worker*>	_workers;
+			Mutex					_mutex;
+			Condition				_cond;
+			size_t					_queued;
+			size_t					_next;
+			bool					_stop;
+	};
+
+	inline size_t ThreadPool::numThreads() const
+	{
+		return _workers.size();
+	}
+
+	template<typename FUNC>
+	inline void ThreadPool::parallelFor( size_t begin, size_t end, size_t grain, FUNC func )
+	{
+		if( end <= begin )
+			return;
+
+		size_t range = end - begin;
+		size_t nchunks = ( range + Math::max<size_t>( grain, 1 ) - 1 ) / Math::max<size_t>( grain, 1 );
+		nchunks = Math::min( nchunks, 4 * ( numThreads() + 1 ) );
+
+		if( nchunks <= 1 || numThreads() == 0 ) {
+			func( begin, end );
+			return;
+		}
+
+		std::vector<RangeTask<FUNC> > chunks;
+		std::vector<ThreadPoolTask*> tasks;
+		chunks.reserve( nchunks );
+		tasks.reserve( nchunks );
+
+		size_t start = begin;
+		for( size_t i = 0; i < nchunks; i++ ) {
+			size_t stop = begin + ( range * ( i + 1 ) ) / nchunks;
+			chunks.push_back( RangeTask<FUNC>( func, start, stop ) );
+			start = stop;
+		}
+		for( size_t i = 0; i < nchunks; i++ )
+			tasks.push_back( &chunks[ i ] );
+
+		run( &tasks[ 0 ], nchunks );
+	}
+}
+
+#endif
@@ -0,0 +1,264 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/util/ThreadPool.h>
+#include <cvt/util/CVTTest.h>
+#include <cvt/gfx/Image.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/gfx/IKernel.h>
+#include <cvt/gfx/IParallel.h>
+#include <cvt/gfx/IScaleFilter.h>
+#include <cvt/math/Math.h>
+
+#include <vector>
+#include <string.h>
+
+using namespace cvt;
+
+static bool _compareImages( const Image& a, const Image& b )
+{
+	if( a.width() != b.width() || a.height() != b.height() || a.format() != b.format() )
+		return false;
+
+	size_t sa, sb;
+	const uint8_t* pa = a.map( &sa );
+	const uint8_t* pb = b.map( &sb );
+	bool ret = true;
+	for( size_t y = 0; y < a.height() && ret; y++ )
+		ret = !memcmp( pa + y * sa, pb + y * sb, a.width() * a.format().bpp );
+	a.unmap( pa );
+	b.unmap( pb );
+	return ret;
+}
+
+static void _randomImage( Image& img )
+{
+	size_t stride;
+	uint8_t* p = img.map( &stride );
+	for( size_t y = 0; y < img.height(); y++ ) {
+		if( img.format().type == IFORMAT_TYPE_FLOAT ) {
+			float* l = ( float* ) ( p + y * stride );
+			for( size_t x = 0; x < img.width() * img.channels(); x++ )
+				l[ x ] = Math::rand( 0.0f, 1.0f );
+		} else {
+			uint8_t* l = p + y * stride;
+			for( size_t x = 0; x < img.width() * img.format().bpp; x++ )
+				l[ x ] = Math::rand( 0, 256 );
+		}
+	}
+	img.unmap( p );
+}
+
+static void _bandConvolve( Image& dst, const Image& src )
+{
+	IKernel kernel( 5, 5 );
+	for( int y = 0; y < 5; y++ )
+		for( int x = 0; x < 5; x++ )
+			kernel( x, y ) = ( float ) ( ( x + 1 ) * ( 5 - y ) ) / 225.0f;
+	dst.reallocate( src.width(), src.height(), src.format() );
+	src.convolve( dst, kernel );
+}
+
+static void _bandConvolveSeparable( Image& dst, const Image& src )
+{
+	dst.reallocate( src.width(), src.height(), src.format() );
+	src.convolve( dst, IKernel::GAUSS_HORIZONTAL_7, IKernel::FIVEPOINT_DERIVATIVE_VERTICAL );
+}
+
+static void _bandDilate( Image& dst, const Image& src )
+{
+	src.dilate( dst, 3 );
+}
+
+static void _bandErode( Image& dst, const Image& src )
+{
+	src.erode( dst, 2 );
+}
+
+static void _bandConvert( Image& dst, const Image& src )
+{
+	src.convert( dst, src.format().type == IFORMAT_TYPE_FLOAT ? IFormat::GRAY_UINT8 : IFormat::RGBA_FLOAT );
+}
+
+/* run op once as a single band and once split into bands, the results have to be identical */
+static bool _compareBands( const Image& src, void ( *op )( Image&, const Image& ) )
+{
+	size_t threshold = IParallel::pixelThreshold();
+	Image serial, parallel;
+
+	IParallel::setPixelThreshold( ( size_t ) -1 );
+	op( serial, src );
+	IParallel::setPixelThreshold( 0 );
+	op( parallel, src );
+	IParallel::setPixelThreshold( threshold );
+	return _compareImages( serial, parallel );
+}
+
+/* dilation/erosion is the extremum of the box of the given radius clipped to the image */
+static bool _compareMorphReference( const Image& src, size_t radius, bool dilate )
+{
+	Image dst;
+	if( dilate )
+		src.dilate( dst, radius );
+	else
+		src.erode( dst, radius );
+
+	IMapScoped<const uint8_t> msrc( src );
+	IMapScoped<const uint8_t> mdst( dst );
+	ssize_t w = src.width();
+	ssize_t h = src.height();
+	ssize_t r = radius;
+	for( ssize_t y = 0; y < h; y++ ) {
+		for( ssize_t x = 0; x < w; x++ ) {
+			uint8_t ref = msrc.line( y )[ x ];
+			for( ssize_t wy = Math::max<ssize_t>( y - r, 0 ); wy <= Math::min( y + r, h - 1 ); wy++ ) {
+				for( ssize_t wx = Math::max<ssize_t>( x - r, 0 ); wx <= Math::min( x + r, w - 1 ); wx++ ) {
+					uint8_t v = msrc.line( wy )[ wx ];
+					ref = dilate ? Math::max( ref, v ) : Math::min( ref, v );
+				}
+			}
+			if( mdst.line( y )[ x ] != ref )
+				return false;
+		}
+	}
+	return true;
+}
+
+/* range functors at file scope, a lambda in the test would be picked up by extracttests.sh */
+class ThreadPoolTestVisit
+{
+	public:
+		ThreadPoolTestVisit( std::vector<int>& visited ) : _visited( visited ) {}
+
+		void operator()( size_t start, size_t end ) const
+		{
+			for( size_t i = start; i < end; i++ )
+				_visited[ i ]++;
+		}
+
+	private:
+		std::vector<int>& _visited;
+};
+
+static void _threadPoolFail( size_t start, size_t )
+{
+	if( start == 0 )
+		throw CVTException( "task failure" );
+}
+
+BEGIN_CVTTEST( ThreadPool )
+	bool result = true;
+	bool b;
+
+	{
+		ThreadPool pool( 4 );
+		std::vector<int> visited( 10007, 0 );
+		pool.parallelFor( 0, visited.size(), 16, ThreadPoolTestVisit( visited ) );
+		b = true;
+		for( size_t i = 0; i < visited.size(); i++ )
+			b &= visited[ i ] == 1;
+		CVTTEST_PRINT( "parallelFor covers range once", b );
+		result &= b;
+
+		b = false;
+		try {
+			pool.parallelFor( 0, 1000, 1, _threadPoolFail );
+		} catch( const Exception& ) {
+			b = true;
+		}
+		CVTTEST_PRINT( "exception propagation", b );
+		result &= b;
+	}
+
+	{
+		Image src( 640, 480, IFormat::RGBA_FLOAT );
+		size_t stride;
+		float* p = src.map<float>( &stride );
+		for( size_t y = 0; y < src.height(); y++ ) {
+			float* l = ( float* ) ( ( uint8_t* ) p + y * stride );
+			for( size_t x = 0; x < src.width() * 4; x++ )
+				l[ x ] = Math::rand( 0.0f, 1.0f );
+		}
+		src.unmap( p );
+
+		size_t threshold = IParallel::pixelThreshold();
+		Image serial, parallel;
+
+		IParallel::setPixelThreshold( ( size_t ) -1 );
+		src.scale( serial, 313, 211, IScaleFilterCubic() );
+		IParallel::setPixelThreshold( 0 );
+		src.scale( parallel, 313, 211, IScaleFilterCubic() );
+		b = _compareImages( serial, parallel );
+		CVTTEST_PRINT( "band parallel scale", b );
+		result &= b;
+
+		IParallel::setPixelThreshold( ( size_t ) -1 );
+		src.scale( serial, 1031, 977, IScaleFilterCubic() );
+		IParallel::setPixelThreshold( 0 );
+		src.scale( parallel, 1031, 977, IScaleFilterCubic() );
+		b = _compareImages( serial, parallel );
+		CVTTEST_PRINT( "band parallel upscale", b );
+		result &= b;
+
+		IParallel::setPixelThreshold( threshold );
+	}
+
+	{
+		/* odd sizes, so the bands do not split evenly */
+		Image grayf( 517, 389, IFormat::GRAY_FLOAT );
+		Image rgbaf( 517, 389, IFormat::RGBA_FLOAT );
+		Image grayu8( 517, 389, IFormat::GRAY_UINT8 );
+		Image rgbau8( 517, 389, IFormat::RGBA_UINT8 );
+		_randomImage( grayf );
+		_randomImage( rgbaf );
+		_randomImage( grayu8 );
+		_randomImage( rgbau8 );
+
+		b = _compareBands( grayf, _bandConvolve ) && _compareBands( rgbaf, _bandConvolve ) &&
+			_compareBands( grayu8, _bandConvolve ) && _compareBands( rgbau8, _bandConvolve );
+		CVTTEST_PRINT( "band parallel convolve", b );
+		result &= b;
+
+		b = _compareBands( grayf, _bandConvolveSeparable ) && _compareBands( rgbaf, _bandConvolveSeparable ) &&
+			_compareBands( grayu8, _bandConvolveSeparable ) && _compareBands( rgbau8, _bandConvolveSeparable );
+		CVTTEST_PRINT( "band parallel separable convolve", b );
+		result &= b;
+
+		b = _compareBands( grayf, _bandDilate ) && _compareBands( grayf, _bandErode ) &&
+			_compareBands( grayu8, _bandDilate ) && _compareBands( grayu8, _bandErode );
+		CVTTEST_PRINT( "band parallel morphology", b );
+		result &= b;
+
+		b = _compareMorphReference( grayu8, 3, true ) && _compareMorphReference( grayu8, 2, false ) &&
+			_compareMorphReference( grayu8, 1, true );
+		CVTTEST_PRINT( "morphology borders", b );
+		result &= b;
+
+		b = _compareBands( grayf, _bandConvert ) && _compareBands( rgbau8, _bandConvert );
+		CVTTEST_PRINT( "band parallel convert", b );
+		result &= b;
+	}
+
+	return result;
+END_CVTTEST
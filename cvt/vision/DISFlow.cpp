@@ -0,0 +1,500 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/vision/DISFlow.h>
+#include <cvt/gfx/IParallel.h>
+#include <cvt/util/ThreadPool.h>
+#include <cvt/util/SIMD.h>
+#include <cvt/util/Exception.h>
+#include <cvt/math/Math.h>
+
+namespace cvt {
+
+	/* read-only view of a mapped float image, safe to share between threads */
+	struct DISImageView {
+		const uint8_t* base;
+		size_t		   stride;
+		ssize_t		   width;
+		ssize_t		   height;
+
+		const float* line( size_t y ) const { return ( const float* ) ( base + y * stride ); }
+
+		/* bilinear lookup of n interleaved x, y coordinates with clamping to the image, the coordinates are clamped in place.
+		   On the last row or column the fill value of warpBilinear1f gets a zero weight */
+		void warp( float* dst, float* coords, size_t n, SIMD* simd ) const
+		{
+			const float xmax = ( float ) ( width - 1 );
+			const float ymax = ( float ) ( height - 1 );
+			for( size_t i = 0; i < n; i++ ) {
+				coords[ 2 * i ] = Math::clamp( coords[ 2 * i ], 0.0f, xmax );
+				coords[ 2 * i + 1 ] = Math::clamp( coords[ 2 * i + 1 ], 0.0f, ymax );
+			}
+			simd->warpBilinear1f( dst, coords, ( const float* ) base, stride, width, height, 0.0f, n );
+		}
+	};
+
+	/* patch origins are spaced by the stride, the last patch is aligned to the image border */
+	static inline size_t DISPatchCount( size_t size, size_t psize, size_t stride )
+	{
+		return ( size - psize + stride - 1 ) / stride + 1;
+	}
+
+	static inline size_t DISPatchPos( size_t i, size_t size, size_t psize, size_t stride )
+	{
+		return Math::min( i * stride, size - psize );
+	}
+
+	DISFlow::Params::Params( Preset preset ) :
+		patchSize( 8 ),
+		patchStride( 4 ),
+		iterations( 16 ),
+		coarsestLevel( 0 ),
+		finestLevel( 2 ),
+		refineIterations( 5 ),
+		refineAlpha( 0.1f )
+	{
+		switch( preset ) {
+			case PRESET_ULTRAFAST:
+				patchStride = 6;
+				iterations = 12;
+				refineIterations = 0;
+				break;
+			case PRESET_FAST:
+				break;
+			case PRESET_MEDIUM:
+				patchSize = 12;
+				patchStride = 4;
+				iterations = 25;
+				finestLevel = 1;
+				refineIterations = 10;
+				break;
+		}
+	}
+
+	DISFlow::DISFlow( const Params& params ) :
+		_kernelGx( IKernel::HAAR_HORIZONTAL_3 ),
+		_kernelGy( IKernel::HAAR_VERTICAL_3 )
+	{
+		/* central differences ( I( x + 1 ) - I( x - 1 ) ) / 2 */
+		_kernelGx.scale( -0.5f );
+		_kernelGy.scale( -0.5f );
+		_pyr[ 0 ] = _pyr[ 1 ] = NULL;
+		setParams( params );
+	}
+
+	DISFlow::~DISFlow()
+	{
+		delete _pyr[ 0 ];
+		delete _pyr[ 1 ];
+	}
+
+	void DISFlow::setParams( const Params& params )
+	{
+		if( params.patchSize < 2 || !params.patchStride || params.patchStride > params.patchSize )
+			throw CVTException( "Invalid DISFlow patch size or stride" );
+		_params = params;
+	}
+
+	size_t DISFlow::levels( size_t width, size_t height ) const
+	{
+		size_t coarsest = _params.coarsestLevel;
+		if( !coarsest ) {
+			float lvl = Math::log2( ( float ) Math::max( width, height ) / ( 4.0f * _params.patchSize ) );
+			coarsest = ( size_t ) Math::max( lvl + 0.5f, 0.0f );
+		}
+		/* every level needs room for at least two patches per dimension */
+		while( coarsest && Math::min( width >> coarsest, height >> coarsest ) < 2 * _params.patchSize )
+			coarsest--;
+		return coarsest + 1;
+	}
+
+	void DISFlow::apply( Image& flow, const Image& src1, const Image& src2, bool useInitial )
+	{
+		if( src1.width() != src2.width() || src1.height() != src2.height() )
+			throw CVTException( "DISFlow: images need to have the same size" );
+		if( Math::min( src1.width(), src1.height() ) < _params.patchSize )
+			throw CVTException( "DISFlow: image is smaller than the patch size" );
+
+		const size_t width = src1.width();
+		const size_t height = src1.height();
+		const Image* src[ 2 ] = { &src1, &src2 };
+
+		for( size_t i = 0; i < 2; i++ ) {
+			if( src[ i ]->format() != IFormat::GRAY_FLOAT ) {
+				src[ i ]->convert( _gray[ i ], IFormat::GRAY_FLOAT );
+				src[ i ] = &_gray[ i ];
+			}
+		}
+
+		size_t nlevels = levels( width, height );
+		if( !_pyr[ 0 ] || _pyr[ 0 ]->octaves() != nlevels ) {
+			delete _pyr[ 0 ];
+			delete _pyr[ 1 ];
+			_pyr[ 0 ] = new ImagePyramid( nlevels, 0.5f );
+			_pyr[ 1 ] = new ImagePyramid( nlevels, 0.5f );
+			_plans.clear();
+			_plans.resize( nlevels + 1 );
+		}
+		_pyr[ 0 ]->update( *src[ 0 ] );
+		_pyr[ 1 ]->update( *src[ 1 ] );
+
+		const size_t coarsest = nlevels - 1;
+		const size_t finest = Math::min( _params.finestLevel, coarsest );
+		bool initial = useInitial && flow.width() == width && flow.height() == height && flow.format() == IFormat::GRAYALPHA_FLOAT;
+		size_t cur = 0;
+
+		for( ssize_t l = coarsest; l >= ( ssize_t ) finest; l-- ) {
+			const Image& i0 = ( *_pyr[ 0 ] )[ l ];
+			const Image& i1 = ( *_pyr[ 1 ] )[ l ];
+			const size_t w = i0.width();
+			const size_t h = i0.height();
+
+			_gx.reallocate( w, h, IFormat::GRAY_FLOAT );
+			_gy.reallocate( w, h, IFormat::GRAY_FLOAT );
+			i0.convolve( _gx, _kernelGx );
+			i0.convolve( _gy, _kernelGy );
+
+			Image& U = _flow[ cur ];
+			if( ( size_t ) l == coarsest ) {
+				if( initial ) {
+					resample( U, flow, w, h, _plans[ l ] );
+				} else {
+					U.reallocate( w, h, IFormat::GRAYALPHA_FLOAT );
+					U.fill( Color( 0.0f, 0.0f ) );
+				}
+			} else {
+				resample( U, _flow[ 1 - cur ], w, h, _plans[ l ] );
+			}
+
+			size_t pcols = DISPatchCount( w, _params.patchSize, _params.patchStride );
+			size_t prows = DISPatchCount( h, _params.patchSize, _params.patchStride );
+			patchSearch( _patchFlow, pcols, prows, U, i0, i1, _gx, _gy );
+			densify( U, _patchFlow, pcols, prows, i0, i1 );
+			if( _params.refineIterations )
+				refine( U, i0, i1, _gx, _gy );
+
+			cur = 1 - cur;
+		}
+
+		const Image& result = _flow[ 1 - cur ];
+		if( finest )
+			resample( flow, result, width, height, _plans[ nlevels ] );
+		else {
+			flow.reallocate( result );
+			flow = result;
+		}
+	}
+
+	void DISFlow::resample( Image& dst, const Image& src, size_t width, size_t height, IScalePlan& plan ) const
+	{
+		plan.apply( dst, src, width, height, IScaleFilterBilinear() );
+
+		/* the displacements scale with the image */
+		const float sx = ( float ) width / ( float ) src.width();
+		const float sy = ( float ) height / ( float ) src.height();
+		size_t stride;
+		uint8_t* base = dst.map( &stride );
+		parallelForRows( dst, [&]( size_t ystart, size_t yend ) {
+			for( size_t y = ystart; y < yend; y++ ) {
+				float* p = ( float* ) ( base + y * stride );
+				for( size_t x = 0; x < width; x++ ) {
+					p[ 2 * x ]	   *= sx;
+					p[ 2 * x + 1 ] *= sy;
+				}
+			}
+		} );
+		dst.unmap( base );
+	}
+
+	void DISFlow::patchSearch( std::vector<float>& pflow, size_t pcols, size_t prows, const Image& flow, const Image& i0, const Image& i1,
+							   const Image& igx, const Image& igy ) const
+	{
+		const size_t ps = _params.patchSize;
+		const size_t pn = ps * ps;
+		const size_t stride = _params.patchStride;
+		const size_t iterations = _params.iterations;
+		const size_t w = i0.width();
+		const size_t h = i0.height();
+		SIMD* simd = SIMD::instance();
+
+		DISImageView v0, v1, vgx, vgy, vflow;
+		v0.base = i0.map( &v0.stride );
+		v1.base = i1.map( &v1.stride );
+		vgx.base = igx.map( &vgx.stride );
+		vgy.base = igy.map( &vgy.stride );
+		vflow.base = flow.map( &vflow.stride );
+		v0.width = v1.width = vgx.width = vgy.width = vflow.width = w;
+		v0.height = v1.height = vgx.height = vgy.height = vflow.height = h;
+
+		pflow.resize( pcols * prows * 2 );
+
+		ThreadPool::instance().parallelFor( 0, prows, 1, [&]( size_t rstart, size_t rend ) {
+			/* template, template gradients, warped patch, residual and warp coordinates */
+			std::vector<float> buf( 7 * pn );
+			float* T  = &buf[ 0 ];
+			float* GX = T + pn;
+			float* GY = GX + pn;
+			float* W  = GY + pn;
+			float* E  = W + pn;
+			float* C  = E + pn;
+
+			for( size_t py = rstart; py < rend; py++ ) {
+				size_t y0 = DISPatchPos( py, h, ps, stride );
+				for( size_t px = 0; px < pcols; px++ ) {
+					size_t x0 = DISPatchPos( px, w, ps, stride );
+
+					float tmean = 0.0f;
+					for( size_t y = 0; y < ps; y++ ) {
+						const float* l0 = v0.line( y0 + y ) + x0;
+						simd->Memcpy( ( uint8_t* ) ( T + y * ps ), ( const uint8_t* ) l0, ps * sizeof( float ) );
+						simd->Memcpy( ( uint8_t* ) ( GX + y * ps ), ( const uint8_t* ) ( vgx.line( y0 + y ) + x0 ), ps * sizeof( float ) );
+						simd->Memcpy( ( uint8_t* ) ( GY + y * ps ), ( const uint8_t* ) ( vgy.line( y0 + y ) + x0 ), ps * sizeof( float ) );
+						for( size_t x = 0; x < ps; x++ )
+							tmean += l0[ x ];
+					}
+					tmean /= ( float ) pn;
+					simd->SubValue1f( T, T, tmean, pn );
+					float hxx = simd->dot( GX, GX, pn );
+					float hxy = simd->dot( GX, GY, pn );
+					float hyy = simd->dot( GY, GY, pn );
+
+					const float* fc = vflow.line( y0 + ps / 2 ) + 2 * ( x0 + ps / 2 );
+					float u = fc[ 0 ];
+					float v = fc[ 1 ];
+					float* pf = &pflow[ ( py * pcols + px ) * 2 ];
+					pf[ 0 ] = u;
+					pf[ 1 ] = v;
+
+					float det = hxx * hyy - hxy * hxy;
+					if( det < 1e-8f )
+						continue;
+					float ixx = hyy / det;
+					float ixy = -hxy / det;
+					float iyy = hxx / det;
+
+					/* inverse compositional Lucas-Kanade, zero mean residuals for robustness to brightness changes */
+					float best = -1.0f;
+					for( size_t it = 0; it <= iterations; it++ ) {
+						float* c = C;
+						for( size_t y = 0; y < ps; y++ ) {
+							for( size_t x = 0; x < ps; x++ ) {
+								*c++ = x0 + x + u;
+								*c++ = y0 + y + v;
+							}
+						}
+						v1.warp( W, C, pn, simd );
+						float wmean = 0.0f;
+						for( size_t i = 0; i < pn; i++ )
+							wmean += W[ i ];
+						simd->SubValue1f( W, W, wmean / ( float ) pn, pn );
+						simd->Sub( E, W, T, pn );
+
+						float err = simd->dot( E, E, pn );
+						if( best < 0.0f || err < best ) {
+							best = err;
+							pf[ 0 ] = u;
+							pf[ 1 ] = v;
+						}
+						if( it == iterations )
+							break;
+
+						float bx = simd->dot( GX, E, pn );
+						float by = simd->dot( GY, E, pn );
+						float du = ixx * bx + ixy * by;
+						float dv = ixy * bx + iyy * by;
+						u -= du;
+						v -= dv;
+						if( du * du + dv * dv < 1e-4f )
+							break;
+					}
+				}
+			}
+		} );
+
+		flow.unmap( vflow.base );
+		igy.unmap( vgy.base );
+		igx.unmap( vgx.base );
+		i1.unmap( v1.base );
+		i0.unmap( v0.base );
+	}
+
+	void DISFlow::densify( Image& flow, const std::vector<float>& pflow, size_t pcols, size_t prows, const Image& i0, const Image& i1 ) const
+	{
+		const size_t ps = _params.patchSize;
+		const size_t stride = _params.patchStride;
+		const size_t w = i0.width();
+		const size_t h = i0.height();
+
+		SIMD* simd = SIMD::instance();
+
+		DISImageView v0, v1;
+		v0.base = i0.map( &v0.stride );
+		v1.base = i1.map( &v1.stride );
+		v0.width = v1.width = w;
+		v0.height = v1.height = h;
+		size_t fstride;
+		uint8_t* fbase = flow.map( &fstride );
+
+		parallelForRows( flow, [&]( size_t ystart, size_t yend ) {
+			std::vector<float> acc( 3 * w );
+			std::vector<float> warped( 3 * ps );
+			float* W = &warped[ 0 ];
+			float* C = W + ps;
+			for( size_t y = ystart; y < yend; y++ ) {
+				const float* l0 = v0.line( y );
+				float* pdst = ( float* ) ( fbase + y * fstride );
+				std::fill( acc.begin(), acc.end(), 0.0f );
+
+				/* every patch covering the row votes with the inverse of its photometric error */
+				size_t pylo = y + 1 > ps ? ( y + 1 - ps ) / stride : 0;
+				for( size_t py = pylo; py < prows; py++ ) {
+					size_t y0 = DISPatchPos( py, h, ps, stride );
+					if( y0 > y )
+						break;
+					if( y >= y0 + ps )
+						continue;
+					for( size_t px = 0; px < pcols; px++ ) {
+						size_t x0 = DISPatchPos( px, w, ps, stride );
+						const float* pf = &pflow[ ( py * pcols + px ) * 2 ];
+						for( size_t x = 0; x < ps; x++ ) {
+							C[ 2 * x ] = x0 + x + pf[ 0 ];
+							C[ 2 * x + 1 ] = y + pf[ 1 ];
+						}
+						v1.warp( W, C, ps, simd );
+						for( size_t x = x0; x < x0 + ps; x++ ) {
+							float diff = Math::abs( W[ x - x0 ] - l0[ x ] );
+							float weight = 1.0f / Math::max( 1.0f, 255.0f * diff );
+							acc[ 3 * x ]	 += weight * pf[ 0 ];
+							acc[ 3 * x + 1 ] += weight * pf[ 1 ];
+							acc[ 3 * x + 2 ] += weight;
+						}
+					}
+				}
+
+				for( size_t x = 0; x < w; x++ ) {
+					if( acc[ 3 * x + 2 ] > 0.0f ) {
+						pdst[ 2 * x ]	  = acc[ 3 * x ] / acc[ 3 * x + 2 ];
+						pdst[ 2 * x + 1 ] = acc[ 3 * x + 1 ] / acc[ 3 * x + 2 ];
+					}
+				}
+			}
+		} );
+
+		flow.unmap( fbase );
+		i1.unmap( v1.base );
+		i0.unmap( v0.base );
+	}
+
+	void DISFlow::refine( Image& flow, const Image& i0, const Image& i1, const Image& igx, const Image& igy )
+	{
+		const size_t w = i0.width();
+		const size_t h = i0.height();
+		const float alpha2 = _params.refineAlpha * _params.refineAlpha;
+
+		/*
+		   Horn-Schunck iterations on the brightness constancy linearized at the current flow F:
+		   gx * u + gy * v + c = 0 with c = I1( x + F ) - I0( x ) - gx * F.u - gy * F.v
+		 */
+		std::vector<float> c( w * h );
+		{
+			DISImageView v0, v1, vgx, vgy, vflow;
+			v0.base = i0.map( &v0.stride );
+			v1.base = i1.map( &v1.stride );
+			vgx.base = igx.map( &vgx.stride );
+			vgy.base = igy.map( &vgy.stride );
+			vflow.base = flow.map( &vflow.stride );
+			v0.width = v1.width = w;
+			v0.height = v1.height = h;
+
+			SIMD* simd = SIMD::instance();
+			parallelForRows( flow, [&]( size_t ystart, size_t yend ) {
+				std::vector<float> coords( 2 * w );
+				for( size_t y = ystart; y < yend; y++ ) {
+					const float* l0 = v0.line( y );
+					const float* lgx = vgx.line( y );
+					const float* lgy = vgy.line( y );
+					const float* lf = vflow.line( y );
+					float* lc = &c[ y * w ];
+					for( size_t x = 0; x < w; x++ ) {
+						coords[ 2 * x ] = x + lf[ 2 * x ];
+						coords[ 2 * x + 1 ] = y + lf[ 2 * x + 1 ];
+					}
+					v1.warp( lc, &coords[ 0 ], w, simd );
+					for( size_t x = 0; x < w; x++ )
+						lc[ x ] -= l0[ x ] + lgx[ x ] * lf[ 2 * x ] + lgy[ x ] * lf[ 2 * x + 1 ];
+				}
+			} );
+
+			flow.unmap( vflow.base );
+			igy.unmap( vgy.base );
+			igx.unmap( vgx.base );
+			i1.unmap( v1.base );
+			i0.unmap( v0.base );
+		}
+
+		_tmp.reallocate( w, h, IFormat::GRAYALPHA_FLOAT );
+		size_t gxstride, gystride;
+		const uint8_t* gxbase = igx.map( &gxstride );
+		const uint8_t* gybase = igy.map( &gystride );
+
+		for( size_t it = 0; it < _params.refineIterations; it++ ) {
+			size_t sstride, dstride;
+			const uint8_t* sbase = flow.map( &sstride );
+			uint8_t* dbase = _tmp.map( &dstride );
+
+			parallelForRows( flow, [&]( size_t ystart, size_t yend ) {
+				for( size_t y = ystart; y < yend; y++ ) {
+					const float* lc = ( const float* ) ( sbase + y * sstride );
+					const float* lu = ( const float* ) ( sbase + ( y ? y - 1 : 0 ) * sstride );
+					const float* ld = ( const float* ) ( sbase + Math::min( y + 1, h - 1 ) * sstride );
+					const float* lgx = ( const float* ) ( gxbase + y * gxstride );
+					const float* lgy = ( const float* ) ( gybase + y * gystride );
+					const float* lcc = &c[ y * w ];
+					float* pdst = ( float* ) ( dbase + y * dstride );
+
+					for( size_t x = 0; x < w; x++ ) {
+						size_t xl = 2 * ( x ? x - 1 : 0 );
+						size_t xr = 2 * Math::min( x + 1, w - 1 );
+						float ubar = 0.25f * ( lc[ xl ] + lc[ xr ] + lu[ 2 * x ] + ld[ 2 * x ] );
+						float vbar = 0.25f * ( lc[ xl + 1 ] + lc[ xr + 1 ] + lu[ 2 * x + 1 ] + ld[ 2 * x + 1 ] );
+						float gx = lgx[ x ];
+						float gy = lgy[ x ];
+						float r = ( gx * ubar + gy * vbar + lcc[ x ] ) / ( alpha2 + gx * gx + gy * gy );
+						pdst[ 2 * x ]	  = ubar - gx * r;
+						pdst[ 2 * x + 1 ] = vbar - gy * r;
+					}
+				}
+			} );
+
+			_tmp.unmap( dbase );
+			flow.unmap( sbase );
+			flow.swap( _tmp );
+		}
+
+		igy.unmap( gybase );
+		igx.unmap( gxbase );
+	}
+
+}
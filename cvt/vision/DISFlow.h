@@ -0,0 +1,115 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_DISFLOW_H
+#define CVT_DISFLOW_H
+
+#include <cvt/gfx/Image.h>
+#include <cvt/gfx/IKernel.h>
+#include <cvt/gfx/IScalePlan.h>
+#include <cvt/vision/ImagePyramid.h>
+
+#include <vector>
+
+namespace cvt {
+
+	/**
+	  @brief Dense optical flow on the CPU by dense inverse search
+
+	  Coarse-to-fine flow estimation in the style of DIS (Kroeger et al., ECCV 2016):
+	  on every pyramid level the flow of overlapping patches is estimated by inverse compositional
+	  Lucas-Kanade, the patch flows are blended into a dense field weighted by their photometric
+	  error and optionally refined by a few Horn-Schunck style variational iterations.
+	  Patches and image rows are processed in parallel by the ThreadPool.
+
+	  The flow is stored as GRAYALPHA_FLOAT image with the horizontal and vertical displacement,
+	  the format used by Flow::AEE and FloFile.
+
+	  At 640x480 on a single core PRESET_ULTRAFAST and PRESET_FAST take about 12 - 20 ms per frame and
+	  reach 30 fps, PRESET_MEDIUM takes about 100 ms and does not. DISFlowTest prints the timings.
+	 */
+	class DISFlow {
+		public:
+			enum Preset {
+				PRESET_ULTRAFAST,
+				PRESET_FAST,
+				PRESET_MEDIUM
+			};
+
+			struct Params {
+				Params( Preset preset = PRESET_FAST );
+
+				size_t	patchSize;
+				size_t	patchStride;
+				/* inverse search iterations per patch */
+				size_t	iterations;
+				/* coarsest pyramid level, 0 selects it from the image and patch size */
+				size_t	coarsestLevel;
+				/* finest level the flow is estimated on, the result is upsampled to full resolution */
+				size_t	finestLevel;
+				/* variational refinement iterations per level and smoothness weight */
+				size_t	refineIterations;
+				float	refineAlpha;
+			};
+
+			DISFlow( const Params& params = Params() );
+			~DISFlow();
+
+			const Params& params() const { return _params; }
+			void setParams( const Params& params );
+
+			/**
+			  @brief Compute the flow from src1 to src2, src2( x + flow( x ) ) = src1( x )
+			  If flow has the size of src1 and the GRAYALPHA_FLOAT format and useInitial is set,
+			  it is used as initialisation of the coarsest level.
+			 */
+			void apply( Image& flow, const Image& src1, const Image& src2, bool useInitial = false );
+
+		private:
+			DISFlow( const DISFlow& );
+			DISFlow& operator=( const DISFlow& );
+
+			size_t levels( size_t width, size_t height ) const;
+			void patchSearch( std::vector<float>& pflow, size_t pcols, size_t prows, const Image& flow, const Image& i0, const Image& i1,
+							  const Image& gx, const Image& gy ) const;
+			void densify( Image& flow, const std::vector<float>& pflow, size_t pcols, size_t prows, const Image& i0, const Image& i1 ) const;
+			void refine( Image& flow, const Image& i0, const Image& i1, const Image& gx, const Image& gy );
+			void resample( Image& dst, const Image& src, size_t width, size_t height, IScalePlan& plan ) const;
+
+			Params					_params;
+			IKernel					_kernelGx;
+			IKernel					_kernelGy;
+			ImagePyramid*			_pyr[ 2 ];
+			std::vector<IScalePlan> _plans;
+			Image					_gx, _gy;
+			Image					_flow[ 2 ];
+			Image					_gray[ 2 ];
+			Image					_tmp;
+			std::vector<float>		_patchFlow;
+	};
+
+}
+
+#endif
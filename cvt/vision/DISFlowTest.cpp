@@ -0,0 +1,133 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/vision/DISFlow.h>
+#include <cvt/vision/Flow.h>
+#include <cvt/io/FloFile.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/util/Exception.h>
+#include <cvt/util/Time.h>
+#include <cvt/util/CVTTest.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace cvt;
+
+/* smooth random texture, the second image is the first one moved by ( dx, dy ) */
+static void _flowPair( Image& img0, Image& img1, Image& gt, size_t dx, size_t dy, size_t w = 256, size_t h = 192 )
+{
+    Image noise( w + dx, h + dy, IFormat::GRAY_FLOAT );
+    Image tex( w + dx, h + dy, IFormat::GRAY_FLOAT );
+    {
+        IMapScoped<float> map( noise );
+        for( size_t y = 0; y < noise.height(); y++ ) {
+            for( size_t x = 0; x < noise.width(); x++ )
+                map.ptr()[ x ] = Math::rand( 0.0f, 1.0f );
+            map++;
+        }
+    }
+    noise.convolve( tex, IKernel::GAUSS_HORIZONTAL_5, IKernel::GAUSS_VERTICAL_5 );
+
+    img0.reallocate( w, h, IFormat::GRAY_FLOAT );
+    img1.reallocate( w, h, IFormat::GRAY_FLOAT );
+    gt.reallocate( w, h, IFormat::GRAYALPHA_FLOAT );
+    img0.copyRect( 0, 0, tex, Recti( dx, dy, w, h ) );
+    img1.copyRect( 0, 0, tex, Recti( 0, 0, w, h ) );
+    gt.fill( Color( ( float ) dx, ( float ) dy ) );
+}
+
+static bool _flowTest( DISFlow::Preset preset )
+{
+    Image img0, img1, gt, flow;
+    _flowPair( img0, img1, gt, 3, 2 );
+
+    DISFlow dis( preset );
+    dis.apply( flow, img0, img1 );
+    return Flow::AEE( flow, gt ) < 0.5f;
+}
+
+/* average time per VGA frame, the target is 30 fps for the fast presets */
+static void _vgaTiming( DISFlow::Preset preset, const std::string& name )
+{
+    Image img0, img1, gt, flow;
+    _flowPair( img0, img1, gt, 3, 2, 640, 480 );
+
+    DISFlow dis( preset );
+    dis.apply( flow, img0, img1 );
+
+    const size_t iter = 20;
+    Time tmr;
+    for( size_t i = 0; i < iter; i++ )
+        dis.apply( flow, img0, img1 );
+    std::cout << "DISFlow " << name << " 640x480 " << tmr.elapsedMilliSeconds() / ( double ) iter << " ms" << std::endl;
+}
+
+BEGIN_CVTTEST( DISFlow )
+    bool result = true;
+    bool b;
+
+    b = _flowTest( DISFlow::PRESET_ULTRAFAST );
+    CVTTEST_PRINT( "ultrafast", b );
+    result &= b;
+
+    b = _flowTest( DISFlow::PRESET_FAST );
+    CVTTEST_PRINT( "fast", b );
+    result &= b;
+
+    b = _flowTest( DISFlow::PRESET_MEDIUM );
+    CVTTEST_PRINT( "medium", b );
+    result &= b;
+
+    {
+        Image img0, img1, gt, flow, flowread;
+        _flowPair( img0, img1, gt, 3, 2 );
+        DISFlow dis;
+        dis.apply( flow, img0, img1 );
+
+        char path[] = "/tmp/cvtdisflowXXXXXX.flo";
+        int fd = mkstemps( path, 4 );
+        b = fd >= 0;
+        if( b ) {
+            close( fd );
+            try {
+                FloFile::FloWriteFile( flow, path );
+                FloFile::FloReadFile( flowread, path );
+                b = Flow::AEE( flowread, flow ) < 1e-6f;
+            } catch( const Exception& ) {
+                b = false;
+            }
+            unlink( path );
+        }
+    }
+    CVTTEST_PRINT( "flo file round trip", b );
+    result &= b;
+
+    _vgaTiming( DISFlow::PRESET_ULTRAFAST, "ultrafast" );
+    _vgaTiming( DISFlow::PRESET_FAST, "fast" );
+    _vgaTiming( DISFlow::PRESET_MEDIUM, "medium" );
+
+    return result;
+END_CVTTEST
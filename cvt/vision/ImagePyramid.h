@@ -27,6 +27,7 @@
 
 #include <cvt/gfx/Image.h>
 #include <cvt/gfx/IScaleFilter.h>
+#include <cvt/gfx/IScalePlan.h>
 
 namespace cvt
 {
@@ -78,6 +79,7 @@ namespace cvt
 
         private:
             std::vector<Image>       _image;
+            std::vector<IScalePlan>  _plans;
             float                    _scaleFactor;
 
             /* recompute the scale space from the first octave */
@@ -88,6 +90,7 @@ namespace cvt
         _scaleFactor( scaleFactor )
     {
         _image.resize( octaves );
+        _plans.resize( octaves );
     }
 
     inline void ImagePyramid::update( const Image& img, const IScaleFilter& sfilter )
@@ -102,10 +105,11 @@ namespace cvt
         float w = _image[ 0 ].width();
         float h = _image[ 0 ].height();
 
+        /* the plans keep weights and row buffers of every octave for the next update */
         for( size_t i = 1; i < _image.size(); i++ ){
             w *= _scaleFactor;
             h *= _scaleFactor;
-            _image[ i - 1 ].scale( _image[ i ], ( size_t )w, ( size_t )h, sfilter );
+            _plans[ i ].apply( _image[ i ], _image[ i - 1 ], ( size_t )w, ( size_t )h, sfilter );
         }
     }
 
@@ -27,6 +27,9 @@
 #include <cvt/util/CVTTest.h>
 #include <cvt/io/Resources.h>
 #include <cvt/gfx/IScaleFilter.h>
+#include <cvt/gfx/IMapScoped.h>
+
+#include <vector>
 
 using namespace cvt;
 
@@ -75,6 +78,137 @@ static bool _funcTest( const cvt::Image& img )
     return true;
 }
 
+/* naive separable resampler applying the filter weights directly, horizontal pass first */
+static void _scaleReference( std::vector<float>& out, const cvt::Image& in, size_t width, size_t height, const cvt::IScaleFilter& filter )
+{
+    IConvolveAdaptivef cx, cy;
+    filter.getAdaptiveConvolutionWeights( width, in.width(), cx, false );
+    filter.getAdaptiveConvolutionWeights( height, in.height(), cy, true );
+
+    std::vector<float> tmp( in.height() * width, 0.0f );
+    IMapScoped<const float> src( in );
+    for( size_t y = 0; y < in.height(); y++ ) {
+        const float* line = src.line( y );
+        const float* w = cx.weights;
+        ssize_t sx = 0;
+        for( size_t x = 0; x < width; x++ ) {
+            sx += cx.size[ x ].incr;
+            for( size_t k = 0; k < cx.size[ x ].numw; k++ )
+                tmp[ y * width + x ] += line[ sx + k ] * *w++;
+        }
+    }
+
+    out.assign( width * height, 0.0f );
+    const float* w = cy.weights;
+    ssize_t sy = 0;
+    for( size_t y = 0; y < height; y++ ) {
+        sy += cy.size[ y ].incr;
+        for( size_t k = 0; k < cy.size[ y ].numw; k++, w++ ) {
+            for( size_t x = 0; x < width; x++ )
+                out[ y * width + x ] += tmp[ ( sy + k ) * width + x ] * *w;
+        }
+    }
+
+    delete[] cx.size;
+    delete[] cx.weights;
+    delete[] cy.size;
+    delete[] cy.weights;
+}
+
+static bool _planTest( const cvt::Image& img )
+{
+    cvt::ImagePyramid pyr( 4, 0.6f );
+    std::vector<float> ref;
+
+    /* second update reuses the cached plans, both have to match the reference resampler */
+    for( size_t iter = 0; iter < 2; iter++ ){
+        pyr.update( img );
+        for( size_t i = 1; i < pyr.octaves(); i++ ){
+            _scaleReference( ref, pyr[ i - 1 ], pyr[ i ].width(), pyr[ i ].height(), IScaleFilterGauss() );
+            IMapScoped<const float> map( pyr[ i ] );
+            for( size_t y = 0; y < pyr[ i ].height(); y++ ) {
+                const float* line = map.line( y );
+                for( size_t x = 0; x < pyr[ i ].width(); x++ ) {
+                    if( Math::abs( line[ x ] - ref[ y * pyr[ i ].width() + x ] ) > 1e-5f )
+                        return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/* scalar pyrdown reference: horizontal taps outside the row are mirrored at the center pixel,
+   rows are clamped to the image. uint8 images keep the unnormalized sums and shift by 8 at the end */
+template<typename T>
+static bool _pyrdownCompare( const cvt::Image& in, const cvt::Image& out, float norm, float eps )
+{
+    static const float weights[ 5 ] = { 1.0f, 4.0f, 6.0f, 4.0f, 1.0f };
+    const ssize_t w = in.width();
+    const ssize_t h = in.height();
+    const size_t ch = in.channels();
+    const size_t n = out.width() * ch;
+    std::vector<float> rows( h * n, 0.0f );
+
+    IMapScoped<const T> src( in );
+    for( ssize_t y = 0; y < h; y++ ) {
+        const T* line = src.line( y );
+        for( size_t x = 0; x < out.width(); x++ ) {
+            ssize_t xc = 2 * ( ssize_t ) x + 1;
+            for( ssize_t k = 0; k < 5; k++ ) {
+                ssize_t i = xc - 2 + k;
+                if( i < 0 || i >= w )
+                    i = Math::clamp<ssize_t>( 2 * xc - i, 0, w - 1 );
+                for( size_t c = 0; c < ch; c++ )
+                    rows[ y * n + x * ch + c ] += weights[ k ] * ( float ) line[ i * ch + c ] * norm;
+            }
+        }
+    }
+
+    IMapScoped<const T> dst( out );
+    for( size_t y = 0; y < out.height(); y++ ) {
+        const T* line = dst.line( y );
+        for( size_t x = 0; x < n; x++ ) {
+            float v = 0.0f;
+            for( ssize_t k = 0; k < 5; k++ )
+                v += weights[ k ] * rows[ Math::clamp<ssize_t>( 2 * ( ssize_t ) y - 1 + k, 0, h - 1 ) * n + x ];
+            if( norm == 1.0f )
+                v = ( float ) ( ( int ) v >> 8 );
+            else
+                v *= norm;
+            if( Math::abs( v - ( float ) line[ x ] ) > eps )
+                return false;
+        }
+    }
+    return true;
+}
+
+static bool _pyrdownTest( const cvt::Image& img, const IFormat& format )
+{
+    try {
+        /* odd and even widths take different border paths */
+        for( size_t i = 0; i < 2; i++ ) {
+            cvt::Image in, out;
+            Recti roi( 3, 5, 101 + i, 77 + i );
+            cvt::Image crop( img, &roi );
+            crop.convert( in, format );
+            in.pyrdown( out );
+            if( out.width() != in.width() / 2 || out.height() != in.height() / 2 || out.format() != format )
+                return false;
+            if( format.type == IFORMAT_TYPE_UINT8 ) {
+                if( !_pyrdownCompare<uint8_t>( in, out, 1.0f, 0.0f ) )
+                    return false;
+            } else {
+                if( !_pyrdownCompare<float>( in, out, 1.0f / 16.0f, 1e-5f ) )
+                    return false;
+            }
+        }
+    } catch( const cvt::Exception& e ){
+        return false;
+    }
+    return true;
+}
+
 BEGIN_CVTTEST( ImagePyramid )
 
 cvt::Resources resources;
@@ -103,6 +237,15 @@ b = _funcTest( lenagf );
 CVTTEST_PRINT( "apply(...)", b );
 result &= b;
 
+b = _planTest( lenagf );
+CVTTEST_PRINT( "IScalePlan reuse", b );
+result &= b;
+
+b = _pyrdownTest( lena, IFormat::GRAY_UINT8 ) && _pyrdownTest( lena, IFormat::RGBA_UINT8 ) &&
+    _pyrdownTest( lena, IFormat::GRAY_FLOAT ) && _pyrdownTest( lena, IFormat::RGBA_FLOAT );
+CVTTEST_PRINT( "pyrdown", b );
+result &= b;
+
 return result;
 
 END_CVTTEST
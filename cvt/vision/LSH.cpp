@@ -0,0 +1,231 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/vision/LSH.h>
+#include <cvt/util/SIMD.h>
+#include <algorithm>
+#include <string.h>
+
+namespace cvt {
+
+    LSH::LSH( size_t numTables, size_t keyBits, uint32_t seed ) :
+        _numTables( numTables ),
+        _keyBits( keyBits ),
+        _seed( seed ),
+        _length( 0 ),
+        _numRemoved( 0 ),
+        _numIndexed( 0 )
+    {
+        if( !numTables || !keyBits || keyBits > 24 )
+            throw CVTException( "LSH: invalid number of tables or key bits" );
+    }
+
+    void LSH::selectBits()
+    {
+        /* random bit sampling, the tables draw from one permutation of the descriptor bits so they
+           sample different bits as long as there are enough of them */
+        size_t numBits = _length * 8;
+        std::vector<uint16_t> perm( numBits );
+        for( size_t i = 0; i < numBits; i++ )
+            perm[ i ] = i;
+
+        uint32_t state = _seed ? _seed : 1;
+        size_t pos = numBits;
+        _bits.resize( _numTables * _keyBits );
+        for( size_t t = 0; t < _numTables; t++ ) {
+            if( pos + _keyBits > numBits ) {
+                /* xorshift fisher-yates shuffle */
+                for( size_t i = numBits - 1; i > 0; i-- ) {
+                    state ^= state << 13;
+                    state ^= state >> 17;
+                    state ^= state << 5;
+                    std::swap( perm[ i ], perm[ state % ( i + 1 ) ] );
+                }
+                pos = 0;
+            }
+            for( size_t b = 0; b < _keyBits; b++ )
+                _bits[ t * _keyBits + b ] = perm[ pos++ ];
+        }
+    }
+
+    uint32_t LSH::key( const uint8_t* desc, size_t table ) const
+    {
+        const uint16_t* bits = &_bits[ table * _keyBits ];
+        uint32_t ret = 0;
+        for( size_t i = 0; i < _keyBits; i++ )
+            ret |= ( uint32_t ) ( ( desc[ bits[ i ] >> 3 ] >> ( bits[ i ] & 0x07 ) ) & 1 ) << i;
+        return ret;
+    }
+
+    void LSH::insert( const uint8_t* desc, size_t id )
+    {
+        remove( id );
+
+        size_t slot = _slotId.size();
+        _data.insert( _data.end(), desc, desc + _length );
+        _slotId.push_back( id );
+        _idSlot[ id ] = slot;
+
+        /* the pending range is scanned linearly by every query */
+        size_t numPending = _slotId.size() - _numIndexed;
+        if( numPending > 256 && numPending * 8 > _numIndexed )
+            rebuild();
+    }
+
+    bool LSH::remove( size_t id )
+    {
+        std::unordered_map<size_t, size_t>::iterator it = _idSlot.find( id );
+        if( it == _idSlot.end() )
+            return false;
+
+        _slotId[ it->second ] = REMOVED;
+        _idSlot.erase( it );
+        _numRemoved++;
+        return true;
+    }
+
+    void LSH::clear()
+    {
+        _data.clear();
+        _slotId.clear();
+        _idSlot.clear();
+        _numRemoved = 0;
+        _numIndexed = 0;
+        _bucketStart.clear();
+        _entries.clear();
+    }
+
+    void LSH::rebuild()
+    {
+        /* compact the storage if there are many removed descriptors */
+        if( _numRemoved * 4 > _slotId.size() ) {
+            size_t n = 0;
+            for( size_t s = 0; s < _slotId.size(); s++ ) {
+                if( _slotId[ s ] == REMOVED )
+                    continue;
+                if( n != s ) {
+                    memmove( &_data[ n * _length ], &_data[ s * _length ], _length );
+                    _slotId[ n ] = _slotId[ s ];
+                    _idSlot[ _slotId[ n ] ] = n;
+                }
+                n++;
+            }
+            _slotId.resize( n );
+            _data.resize( n * _length );
+            _numRemoved = 0;
+        }
+
+        /* counting sort of the slots by key, removed slots stay in the tables and are skipped by the queries */
+        size_t numSlots = _slotId.size();
+        size_t numKeys = ( size_t ) 1 << _keyBits;
+        std::vector<uint32_t> keys( numSlots );
+
+        _numIndexed = numSlots;
+        _bucketStart.assign( _numTables * ( numKeys + 1 ), 0 );
+        _entries.resize( _numTables * numSlots );
+
+        for( size_t t = 0; t < _numTables; t++ ) {
+            uint32_t* start = &_bucketStart[ t * ( numKeys + 1 ) ];
+            uint32_t* entries = numSlots ? &_entries[ t * numSlots ] : NULL;
+
+            for( size_t s = 0; s < numSlots; s++ ) {
+                keys[ s ] = key( &_data[ s * _length ], t );
+                start[ keys[ s ] + 1 ]++;
+            }
+            for( size_t k = 0; k < numKeys; k++ )
+                start[ k + 1 ] += start[ k ];
+            for( size_t s = 0; s < numSlots; s++ )
+                entries[ start[ keys[ s ] ]++ ] = s;
+            /* the increments moved each start to the end of its bucket */
+            for( size_t k = numKeys; k > 0; k-- )
+                start[ k ] = start[ k - 1 ];
+            start[ 0 ] = 0;
+        }
+    }
+
+    void LSH::addCandidates( std::vector<uint32_t>& candidates, size_t table, uint32_t k ) const
+    {
+        const uint32_t* start = &_bucketStart[ table * ( ( ( size_t ) 1 << _keyBits ) + 1 ) ];
+        const uint32_t* entries = &_entries[ table * _numIndexed ];
+        candidates.insert( candidates.end(), entries + start[ k ], entries + start[ k + 1 ] );
+    }
+
+    void LSH::knn( std::vector<Neighbour>& result, const uint8_t* query, size_t k, uint32_t maxDistance, size_t probeRadius ) const
+    {
+        result.clear();
+        if( !k || _idSlot.empty() )
+            return;
+
+        SIMD* simd = SIMD::instance();
+        Neighbour n;
+
+        if( _numIndexed ) {
+            std::vector<uint32_t> candidates;
+            for( size_t t = 0; t < _numTables; t++ ) {
+                uint32_t qkey = key( query, t );
+                addCandidates( candidates, t, qkey );
+                if( probeRadius ) {
+                    for( size_t b = 0; b < _keyBits; b++ )
+                        addCandidates( candidates, t, qkey ^ ( 1u << b ) );
+                }
+            }
+
+            /* the same descriptor is usually found in several tables */
+            std::sort( candidates.begin(), candidates.end() );
+            candidates.erase( std::unique( candidates.begin(), candidates.end() ), candidates.end() );
+
+            for( size_t i = 0; i < candidates.size(); i++ ) {
+                size_t s = candidates[ i ];
+                if( _slotId[ s ] == REMOVED )
+                    continue;
+                n.distance = simd->hammingDistance( query, &_data[ s * _length ], _length );
+                if( n.distance <= maxDistance ) {
+                    n.id = _slotId[ s ];
+                    result.push_back( n );
+                }
+            }
+        }
+
+        /* the pending descriptors are contiguous */
+        size_t numPending = _slotId.size() - _numIndexed;
+        if( numPending ) {
+            std::vector<uint32_t> dist( numPending );
+            simd->hammingDistances( &dist[ 0 ], query, &_data[ _numIndexed * _length ], _length, numPending, _length );
+            for( size_t i = 0; i < numPending; i++ ) {
+                if( dist[ i ] <= maxDistance && _slotId[ _numIndexed + i ] != REMOVED ) {
+                    n.id = _slotId[ _numIndexed + i ];
+                    n.distance = dist[ i ];
+                    result.push_back( n );
+                }
+            }
+        }
+
+        if( result.size() > k ) {
+            std::partial_sort( result.begin(), result.begin() + k, result.end() );
+            result.resize( k );
+        } else {
+            std::sort( result.begin(), result.end() );
+        }
+    }
+}
@@ -22,197 +22,116 @@
    THE SOFTWARE.
 */
 
-/*
- * File:   LSH.h
- * Author: sebi
- *
- * Created on July 22, 2011, 3:56 PM
- */
-
-#ifndef LSH_H
-#define	LSH_H
+#ifndef CVT_LSH_H
+#define CVT_LSH_H
 
-#include <cvt/vision/ORB.h>
-#include <algorithm>
-#include <list>
+#include <cvt/vision/features/FeatureDescriptor.h>
+#include <cvt/util/Exception.h>
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
 
 namespace cvt {
 
-    template <size_t NumBits = 8, size_t NumTables = 4>
-    class LSH {
-      public:
-        LSH( const std::vector<ORBFeature> * features );
-        int find( const ORBFeature& feature, size_t& dist, size_t maxDistance = 30 );
+    /**
+      @brief Multi-table locality sensitive hashing index for binary descriptors
 
-        void updateFeatures( const std::vector<ORBFeature> * features );
+      Each table hashes a descriptor to a key of keyBits sampled descriptor bits. The buckets of
+      a table are stored flat: the slots of all buckets are sorted by key into one array and
+      located via the bucket start offsets. Inserted descriptors are appended to a pending range
+      that is scanned linearly and merged into the tables once it grows too large. Removed
+      descriptors are skipped until the next merge compacts the storage.
 
-      private:
-        struct HistPos
-        {
-            int accum;
-            size_t pos;
-            static int halfOrbSize;
+      The queries are const and can run concurrently, insert and remove must not run in parallel
+      to queries.
+     */
+    class LSH {
+      public:
+        struct Neighbour {
+            size_t      id;
+            uint32_t    distance;
 
-            bool operator<( const HistPos & other ) const
+            bool operator<( const Neighbour& other ) const
             {
-                return ::abs( accum * 2 - halfOrbSize ) <= ::abs( other.accum * 2 - halfOrbSize );
+                return distance < other.distance || ( distance == other.distance && id < other.id );
             }
         };
 
-        void hashORBFeatures();
-
-        void entropy();
-
-        size_t hash( const ORBFeature & ft, size_t table ) const;
-
-        const std::vector<ORBFeature> * _features;
-
-        size_t _bitPos[ NumTables ][ NumBits ];
-
-        std::list<int> _htable[ NumTables ][ ( 1 << NumBits ) ];
-    };
-
-    template<size_t NumBits, size_t NumTables>
-    int LSH<NumBits, NumTables>::HistPos::halfOrbSize;
-
-    template <size_t NumBits, size_t NumTables>
-    inline LSH<NumBits, NumTables>::LSH( const std::vector<ORBFeature>* orb ) : _features( orb )
-    {
-        entropy();
-        hashORBFeatures();
-    }
-
-    template <size_t NumBits, size_t NumTables>
-    inline void LSH<NumBits, NumTables>::updateFeatures( const std::vector<ORBFeature> * features )
-    {
-        _features = features;
-        for( size_t i = 0; i < NumTables; i++ ){
-            for( size_t k = 0; k < ( 1 << NumBits ); k++ ){
-                _htable[ i ][ k ].clear();
-            }
-        }
-
-        entropy();
-        hashORBFeatures();
-    }
-
-    #define GETBIT( ft, n ) ( ( ft.desc[ n >> 3 ] >> ( n & 0x07 ) ) & 1 )
-    template <size_t NumBits, size_t NumTables>
-    inline void LSH<NumBits, NumTables>::entropy()
-    {
-        std::vector<HistPos> hist;
-		hist.reserve( 256 );
-
-        HistPos::halfOrbSize = _features->size();
-
-        for( size_t i = 0; i < 256; i++ ){
-            hist[ i ].accum = 0;
-            hist[ i ].pos = i;
-        }
-
-        for ( size_t i = 0, end = _features->size( ); i < end; i++ ) {
-            const ORBFeature& feature = ( *_features )[ i ];
+        /* keyBits: number of sampled bits per table, at most 24 */
+        LSH( size_t numTables = 6, size_t keyBits = 16, uint32_t seed = 1 );
 
-            for( size_t b = 0; b < 0xFF; b++ ){
-                if( GETBIT( feature, b ) )
-                    hist[ b ].accum++;
-            }
-        }
+        /* only hamming comparable descriptors can be inserted, the descriptor length is fixed
+           by the first insertion. Reinserting an id replaces the descriptor */
+        void    insert( const FeatureDescriptor& desc, size_t id );
+        bool    remove( size_t id );
+        bool    contains( size_t id ) const { return _idSlot.find( id ) != _idSlot.end(); }
+        void    clear();
 
-        std::sort( hist.begin(), hist.end() );
+        size_t  size() const { return _idSlot.size(); }
+        size_t  descriptorLength() const { return _length; }
 
-        // save the NumBits best bit positions for hash generation
-        for ( size_t n = 0; n < NumTables; n++ ) {
-            for ( size_t i = 0; i < NumBits; i++ ) {
-                _bitPos[ n ][ i ] = hist[ n * NumBits + i ].pos;
-            }
-        }
+        /**
+          @brief approximate k nearest neighbours, query has descriptorLength() bytes
 
-        /*
-        for( size_t b = 0; b < 0xFF; b++ ){
-            std::cout << ( float )hist[ b ].accum / ( float )_features->size()  << " " << hist[ b ].pos << " acuum: " << hist[ b ].accum << " abs:"<< ::abs( hist[ b ].accum * 2 - HistPos::halfOrbSize ) <<"\n";
-        }
-        std::cout << std::endl;
+          @param result         the at most k neighbours with a distance <= maxDistance, sorted by distance
+          @param probeRadius    0: probe the query bucket, 1: additionally probe all keys with one flipped bit
          */
-    }
+        void    knn( std::vector<Neighbour>& result, const uint8_t* query, size_t k, uint32_t maxDistance, size_t probeRadius = 1 ) const;
+        void    knn( std::vector<Neighbour>& result, const FeatureDescriptor& query, size_t k, uint32_t maxDistance, size_t probeRadius = 1 ) const;
 
-    template <size_t NumBits, size_t NumTables>
-    inline size_t LSH<NumBits, NumTables>::hash( const ORBFeature & ft, size_t table ) const
-    {
-        size_t ret = 0;
-
-        for( size_t i = 0; i < NumBits; i++ ){
-            ret |= GETBIT( ft, _bitPos[ table ][ i ] ) << i;
-        }
-
-        return ret;
-    }
+        /* merge the pending descriptors into the tables, done automatically on insert */
+        void    rebuild();
 
+      private:
+        static const size_t REMOVED = ~( size_t ) 0;
+
+        void        insert( const uint8_t* desc, size_t id );
+        void        selectBits();
+        uint32_t    key( const uint8_t* desc, size_t table ) const;
+        void        addCandidates( std::vector<uint32_t>& candidates, size_t table, uint32_t key ) const;
+
+        size_t                  _numTables;
+        size_t                  _keyBits;
+        uint32_t                _seed;
+        size_t                  _length;
+
+        /* sampled bit positions, keyBits per table */
+        std::vector<uint16_t>   _bits;
+
+        /* descriptor storage, slot s at _data[ s * _length ] */
+        std::vector<uint8_t>    _data;
+        std::vector<size_t>     _slotId;
+        std::unordered_map<size_t, size_t> _idSlot;
+        size_t                  _numRemoved;
+
+        /* slots [ 0, _numIndexed ) are in the tables, the rest is pending */
+        size_t                  _numIndexed;
+        /* per table: 2^keyBits + 1 bucket offsets into _entries[ table * _numIndexed ] */
+        std::vector<uint32_t>   _bucketStart;
+        std::vector<uint32_t>   _entries;
+    };
 
-    template <size_t NumBits, size_t NumTables>
-    inline void LSH<NumBits, NumTables>::hashORBFeatures()
+    inline void LSH::insert( const FeatureDescriptor& desc, size_t id )
     {
-        for ( size_t i = 0, end = _features->size( ); i < end; i++ ) {
-            const ORBFeature& feature = ( *_features )[ i ];
-
-            for( size_t n = 0; n < NumTables; n++ ){
-                size_t idx = hash( feature, n );
-                _htable[ n ][ idx ].push_back( i );
-            }
-        }
-
-        /*
-        for( size_t i = 0; i < ( 1 << NumBits ) - 1; i++ ){
-            std::cout << _htable[ i ].size() << std::endl;
+        if( desc.compareType() != FEATUREDESC_CMP_HAMMING )
+            throw CVTException( "LSH: only binary descriptors can be indexed" );
+        if( !_length ) {
+            if( desc.length() * 8 < _keyBits )
+                throw CVTException( "LSH: more key bits than descriptor bits" );
+            _length = desc.length();
+            selectBits();
+        } else if( desc.length() != _length ) {
+            throw CVTException( "LSH: descriptor length mismatch" );
         }
-         */
-
-
-        /*		for( size_t k = 0; k < MAXIDX; k++ ) {
-                    for( size_t l = 0; l < 256; l++ ) {
-                        std::cout << k << " " << l << " " << _htable[ k ][ l ].size() << std::endl;
-                    }
-                }*/
+        insert( desc.ptr(), id );
     }
 
-    template <size_t NumBits, size_t NumTables>
-    inline int LSH<NumBits, NumTables>::find( const ORBFeature& feature, size_t& dist, size_t maxDistance )
+    inline void LSH::knn( std::vector<Neighbour>& result, const FeatureDescriptor& query, size_t k, uint32_t maxDistance, size_t probeRadius ) const
     {
-        int ret = -1;
-        size_t retdist = maxDistance;
-
-        for ( size_t n = 0; n < NumTables; n++ ) {
-            /* Simple test without any descriptor bit twiddling */
-            size_t idx = hash( feature, n );
-
-            for ( std::list<int>::iterator it = _htable[ n ][ idx ].begin( ), end = _htable[ n ][ idx ].end( ); it != end; ++it ) {
-                const ORBFeature& current = ( *_features )[ *it ];
-                size_t d = feature.distance( current );
-                if ( d < retdist ) {
-                    retdist = d;
-                    ret = *it;
-                }
-            }
-
-            /* toggle one bit at each position and probe */
-            for ( size_t i = 0; i < NumBits; i++ ) {
-                size_t index = idx ^ ( 1 << i );
-                for ( std::list<int>::iterator it = _htable[ n ][ index ].begin( ), end = _htable[ n ][ index ].end( ); it != end; ++it ) {
-                    const ORBFeature& current = ( *_features )[ *it ];
-                    size_t d = feature.distance( current );
-                    if ( d < retdist ) {
-                        retdist = d;
-                        ret = *it;
-                    }
-                }
-            }
-        }
-
-        dist = retdist;
-        return ret;
+        if( _length && query.length() != _length )
+            throw CVTException( "LSH: descriptor length mismatch" );
+        knn( result, query.ptr(), k, maxDistance, probeRadius );
     }
 }
 
-
-#endif	/* LSH_H */
-
+#endif
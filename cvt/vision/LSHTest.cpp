@@ -0,0 +1,101 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/vision/LSH.h>
+#include <cvt/util/SIMD.h>
+#include <cvt/util/CVTTest.h>
+#include <cstdlib>
+
+using namespace cvt;
+
+typedef FeatureDescriptorInternal<32, uint8_t, FEATUREDESC_CMP_HAMMING> Descriptor;
+
+static void _randomDescriptor( Descriptor& d )
+{
+	for( size_t i = 0; i < 32; i++ )
+		d.desc[ i ] = rand();
+}
+
+static bool _lshKnnTest()
+{
+	const size_t num = 20000;
+	std::vector<Descriptor> db( num, Descriptor( Feature() ) );
+	LSH lsh;
+
+	for( size_t i = 0; i < num; i++ ) {
+		_randomDescriptor( db[ i ] );
+		lsh.insert( db[ i ], 3 * i );
+	}
+
+	bool result = lsh.size() == num;
+
+	// queries: database descriptors with 12 flipped bits, the unique nearest neighbour by far
+	size_t found = 0;
+	const size_t numQueries = 500;
+	std::vector<LSH::Neighbour> nn;
+	for( size_t q = 0; q < numQueries; q++ ) {
+		size_t idx = rand() % num;
+		Descriptor query( db[ idx ] );
+		for( size_t b = 0; b < 12; b++ ) {
+			size_t bit = rand() % 256;
+			query.desc[ bit >> 3 ] ^= 1 << ( bit & 0x7 );
+		}
+
+		lsh.knn( nn, query, 5, 256 );
+		for( size_t i = 1; i < nn.size(); i++ )
+			result &= !( nn[ i ] < nn[ i - 1 ] );
+		if( nn.size() && nn[ 0 ].id == 3 * idx ) {
+			found++;
+			result &= nn[ 0 ].distance == SIMD::instance()->hammingDistance( query.desc, db[ idx ].desc, 32 );
+		}
+	}
+
+	bool recall = found > 0.9 * numQueries;
+	if( !recall )
+		std::cout << "recall: " << found << " / " << numQueries << std::endl;
+
+	// removed descriptors are not returned
+	for( size_t i = 0; i < num; i += 2 )
+		result &= lsh.remove( 3 * i );
+	result &= !lsh.remove( 0 );
+	result &= lsh.size() == num / 2;
+	for( size_t i = 0; i < 100; i++ ) {
+		lsh.knn( nn, db[ i ], 1, 0 );
+		result &= ( i & 1 ) ? ( nn.size() == 1 && nn[ 0 ].id == 3 * i ) : nn.empty();
+	}
+
+	return result && recall;
+}
+
+BEGIN_CVTTEST( LSH )
+
+	bool testResult = true;
+	bool b = false;
+
+	b = _lshKnnTest();
+	CVTTEST_PRINT( "LSH knn", b );
+	testResult &= b;
+
+	return testResult;
+END_CVTTEST
@@ -0,0 +1,148 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/vision/SBAReducedSolver.h>
+#include <cvt/math/Math.h>
+
+#include <Eigen/Cholesky>
+
+namespace cvt {
+
+    void SBACholeskySolver::analyzePattern( const MatrixType & A )
+    {
+        _solver.analyzePattern( A );
+    }
+
+    bool SBACholeskySolver::solve( Eigen::VectorXd & x, const MatrixType & A, const Eigen::VectorXd & b )
+    {
+        _solver.factorize( A );
+        if( _solver.info() != Eigen::Success )
+            return false;
+        x = _solver.solve( b );
+        return _solver.info() == Eigen::Success;
+    }
+
+    SBAPCGSolver::SBAPCGSolver( size_t blockSize, size_t maxIterations, double tolerance ) :
+        _blockSize( blockSize ),
+        _maxIterations( maxIterations ),
+        _tolerance( tolerance ),
+        _iterations( 0 )
+    {
+    }
+
+    void SBAPCGSolver::analyzePattern( const MatrixType & A )
+    {
+        _invDiag.resize( _blockSize, A.cols() );
+    }
+
+    bool SBAPCGSolver::solve( Eigen::VectorXd & x, const MatrixType & A, const Eigen::VectorXd & b )
+    {
+        size_t n = b.rows();
+        Eigen::VectorXd r( b ), z( n ), p( n ), q( n );
+
+        updatePreconditioner( A );
+
+        x.setZero( n );
+        _iterations = 0;
+
+        double thresh = Math::sqr( _tolerance ) * b.squaredNorm();
+        if( r.squaredNorm() <= thresh )
+            return true;
+
+        applyPreconditioner( z, r );
+        p = z;
+        double rz = r.dot( z );
+
+        while( _iterations < _maxIterations ){
+            q.noalias() = A.selfadjointView<Eigen::Lower>() * p;
+
+            double pq = p.dot( q );
+            // the damped system is positive definite, anything else is numerical breakdown
+            if( !( pq > 0.0 ) )
+                return _iterations > 0;
+
+            double alpha = rz / pq;
+            x += alpha * p;
+            r -= alpha * q;
+            _iterations++;
+
+            if( r.squaredNorm() <= thresh )
+                break;
+
+            applyPreconditioner( z, r );
+            double rzNext = r.dot( z );
+            p = z + ( rzNext / rz ) * p;
+            rz = rzNext;
+        }
+        return true;
+    }
+
+    void SBAPCGSolver::updatePreconditioner( const MatrixType & A )
+    {
+        size_t n = A.cols();
+        if( ( size_t )_invDiag.cols() != n )
+            _invDiag.resize( _blockSize, n );
+
+        Eigen::MatrixXd D( _blockSize, _blockSize );
+        for( size_t start = 0; start < n; start += _blockSize ){
+            size_t bs = Math::min( _blockSize, n - start );
+            D.setZero();
+
+            // gather the diagonal block from the lower triangle
+            for( size_t j = 0; j < bs; j++ ){
+                for( MatrixType::InnerIterator it( A, start + j ); it; ++it ){
+                    size_t row = it.row();
+                    if( row < start + j )
+                        continue;
+                    if( row >= start + bs )
+                        break;
+                    D( row - start, j ) = it.value();
+                    D( j, row - start ) = it.value();
+                }
+            }
+
+            Eigen::LLT<Eigen::MatrixXd> llt( D.topLeftCorner( bs, bs ) );
+            if( llt.info() == Eigen::Success ){
+                _invDiag.block( 0, start, bs, bs ) = llt.solve( Eigen::MatrixXd::Identity( bs, bs ) );
+            } else {
+                // fall back to plain Jacobi for indefinite blocks
+                _invDiag.block( 0, start, bs, bs ).setZero();
+                for( size_t i = 0; i < bs; i++ ){
+                    double d = D( i, i );
+                    _invDiag( i, start + i ) = d != 0.0 ? 1.0 / d : 1.0;
+                }
+            }
+        }
+    }
+
+    void SBAPCGSolver::applyPreconditioner( Eigen::VectorXd & z, const Eigen::VectorXd & r ) const
+    {
+        size_t n = r.rows();
+        for( size_t start = 0; start < n; start += _blockSize ){
+            size_t bs = Math::min( _blockSize, n - start );
+            z.segment( start, bs ).noalias() = _invDiag.block( 0, start, bs, bs ) * r.segment( start, bs );
+        }
+    }
+
+}
@@ -0,0 +1,101 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_SBA_REDUCED_SOLVER_H
+#define CVT_SBA_REDUCED_SOLVER_H
+
+#define EIGEN_YES_I_KNOW_SPARSE_MODULE_IS_NOT_STABLE_YET
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+
+namespace cvt {
+
+	/**
+	  @brief Solver for the reduced camera system of the SparseBundleAdjustment
+
+	  The reduced system is symmetric and only its lower triangle is stored (the
+	  diagonal blocks are stored completely). analyzePattern() is called once the
+	  sparsity pattern is known, solve() in every iteration with the new values.
+	 */
+	class SBAReducedSolver
+	{
+		public:
+			typedef Eigen::SparseMatrix<double, Eigen::ColMajor> MatrixType;
+
+			virtual ~SBAReducedSolver() {}
+
+			virtual void analyzePattern( const MatrixType & A ) = 0;
+
+			/* solves A * x = b, returns false if the system could not be solved */
+			virtual bool solve( Eigen::VectorXd & x, const MatrixType & A, const Eigen::VectorXd & b ) = 0;
+	};
+
+	/**
+	  @brief Direct sparse Cholesky (LDLt) factorisation of the reduced system
+	 */
+	class SBACholeskySolver : public SBAReducedSolver
+	{
+		public:
+			void analyzePattern( const MatrixType & A );
+			bool solve( Eigen::VectorXd & x, const MatrixType & A, const Eigen::VectorXd & b );
+
+		private:
+			Eigen::SimplicialCholesky<MatrixType, Eigen::Lower> _solver;
+	};
+
+	/**
+	  @brief Conjugate gradients with a block Jacobi preconditioner
+
+	  Avoids the fill-in of the factorisation, preferable for large maps with many
+	  covisible keyframes. The preconditioner inverts the diagonal blocks of size blockSize.
+	 */
+	class SBAPCGSolver : public SBAReducedSolver
+	{
+		public:
+			SBAPCGSolver( size_t blockSize = 6, size_t maxIterations = 500, double tolerance = 1e-10 );
+
+			void analyzePattern( const MatrixType & A );
+			bool solve( Eigen::VectorXd & x, const MatrixType & A, const Eigen::VectorXd & b );
+
+			/* number of cg iterations of the last solve */
+			size_t iterations() const { return _iterations; }
+
+			void setMaxIterations( size_t n ) { _maxIterations = n; }
+			/* termination threshold on the residual norm relative to |b| */
+			void setTolerance( double tol ) { _tolerance = tol; }
+
+		private:
+			void updatePreconditioner( const MatrixType & A );
+			void applyPreconditioner( Eigen::VectorXd & z, const Eigen::VectorXd & r ) const;
+
+			size_t			_blockSize;
+			size_t			_maxIterations;
+			double			_tolerance;
+			size_t			_iterations;
+			/* inverted diagonal blocks side by side: blockSize x dim */
+			Eigen::MatrixXd _invDiag;
+	};
+}
+
+#endif
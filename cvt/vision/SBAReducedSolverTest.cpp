@@ -0,0 +1,194 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/vision/SparseBundleAdjustment.h>
+#include <cvt/vision/SBAReducedSolver.h>
+#include <cvt/util/CVTTest.h>
+
+#include <Eigen/Dense>
+
+using namespace cvt;
+
+/* points in front of a row of slightly rotated keyframes, every point is seen by all keyframes.
+   The keyframe poses and the points are perturbed, the measurements are the exact projections */
+static void _syntheticMap( SlamMap& map, size_t numCams, size_t numPoints )
+{
+    Eigen::Matrix3d K;
+    K << 500.0,   0.0, 320.0,
+           0.0, 500.0, 240.0,
+           0.0,   0.0,   1.0;
+    map.clear();
+    map.setIntrinsics( K );
+
+    Math::srand( 1234 );
+    std::vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d> > poses;
+    for( size_t c = 0; c < numCams; c++ ) {
+        Eigen::Matrix4d pose = Eigen::Matrix4d::Identity();
+        double angle = 0.02 * c;
+        pose.block<3, 3>( 0, 0 ) = Eigen::AngleAxisd( angle, Eigen::Vector3d::UnitY() ).toRotationMatrix();
+        pose( 0, 3 ) = -0.3 * c;
+        poses.push_back( pose );
+
+        Eigen::Matrix4d noisy = pose;
+        noisy.block<3, 3>( 0, 0 ) = Eigen::AngleAxisd( 0.005 * c, Eigen::Vector3d::UnitX() ).toRotationMatrix() * noisy.block<3, 3>( 0, 0 );
+        noisy( 1, 3 ) += 0.01 * c;
+        map.addKeyframe( noisy );
+    }
+
+    for( size_t i = 0; i < numPoints; i++ ) {
+        Eigen::Vector4d p( Math::rand( -2.0f, 2.0f ), Math::rand( -1.5f, 1.5f ), Math::rand( 4.0f, 8.0f ), 1.0 );
+        Eigen::Vector4d noisy = p;
+        noisy.head<3>() += Eigen::Vector3d( Math::rand( -0.05f, 0.05f ), Math::rand( -0.05f, 0.05f ), Math::rand( -0.05f, 0.05f ) );
+        size_t id = map.addFeature( MapFeature( noisy, Eigen::Matrix4d::Identity() ) );
+
+        for( size_t c = 0; c < numCams; c++ ) {
+            Eigen::Vector3d pc = K * ( poses[ c ] * p ).head<3>();
+            MapMeasurement meas;
+            meas.point = pc.head<2>() / pc[ 2 ];
+            map.addMeasurement( id, c, meas );
+        }
+    }
+}
+
+/* mean squared reprojection error in pixels */
+static double _reprojectionError( const SlamMap& map )
+{
+    double error = 0.0;
+    for( size_t i = 0; i < map.numFeatures(); i++ ) {
+        const MapFeature& feature = map.featureForId( i );
+        Eigen::Vector3d p = feature.estimate().head<3>() / feature.estimate()[ 3 ];
+        for( MapFeature::ConstPointTrackIterator it = feature.pointTrackBegin(); it != feature.pointTrackEnd(); ++it ) {
+            const Keyframe& kf = map.keyframeForId( *it );
+            Eigen::Matrix4d T = kf.pose().transformation();
+            Eigen::Vector3d pc = map.intrinsics() * ( T.block<3, 3>( 0, 0 ) * p + T.block<3, 1>( 0, 3 ) );
+            error += ( kf.measurementForId( i ).point - pc.head<2>() / pc[ 2 ] ).squaredNorm();
+        }
+    }
+    return error / map.numMeasurements();
+}
+
+/* eliminates the points from the dense damped normal equations and solves the camera part */
+static void _denseSchurSolve( Eigen::MatrixXd& S, Eigen::VectorXd& x, SparseBundleAdjustment& sba, const SlamMap& map )
+{
+    const size_t nc = map.numKeyframes();
+    const size_t np = map.numFeatures();
+    const double damping = 1.0 + sba.lambda();
+
+    Eigen::MatrixXd U = Eigen::MatrixXd::Zero( 6 * nc, 6 * nc );
+    Eigen::MatrixXd W = Eigen::MatrixXd::Zero( 6 * nc, 3 * np );
+    Eigen::MatrixXd V = Eigen::MatrixXd::Zero( 3 * np, 3 * np );
+    Eigen::VectorXd rc( 6 * nc ), rp( 3 * np );
+
+    for( size_t c = 0; c < nc; c++ ) {
+        U.block<6, 6>( 6 * c, 6 * c ) = *sba.getCJTJDiagonalElement( c );
+        U.block<6, 6>( 6 * c, 6 * c ).diagonal() *= damping;
+        rc.segment<6>( 6 * c ) = *sba.getCamResidual( c );
+    }
+    for( size_t i = 0; i < np; i++ ) {
+        V.block<3, 3>( 3 * i, 3 * i ) = *sba.getPJTJDiagonalElement( i );
+        V.block<3, 3>( 3 * i, 3 * i ).diagonal() *= damping;
+        rp.segment<3>( 3 * i ) = *sba.getPointResudual( i );
+        const MapFeature& feature = map.featureForId( i );
+        for( MapFeature::ConstPointTrackIterator it = feature.pointTrackBegin(); it != feature.pointTrackEnd(); ++it )
+            W.block<6, 3>( 6 * *it, 3 * i ) = *sba.getElementOfCamPointJTJ( *it, i );
+    }
+
+    Eigen::MatrixXd WVinv = W * V.inverse();
+    S = U - WVinv * W.transpose();
+    x = S.ldlt().solve( rc - WVinv * rp );
+}
+
+static bool _solverTest( SBAReducedSolver& solver, const Eigen::VectorXd& xref, SparseBundleAdjustment& sba )
+{
+    Eigen::VectorXd x;
+    solver.analyzePattern( *sba.getSparseReduced() );
+    if( !solver.solve( x, *sba.getSparseReduced(), *sba.getReducedRHS() ) )
+        return false;
+    return ( x - xref ).norm() <= 1e-6 * xref.norm();
+}
+
+BEGIN_CVTTEST( SBAReducedSolver )
+    bool result = true;
+    bool b;
+
+    SlamMap map;
+    _syntheticMap( map, 6, 80 );
+
+    /* the reduced system of the first iteration against the dense Schur complement */
+    {
+        SparseBundleAdjustment sba;
+        sba.resize( map.numKeyframes(), map.numFeatures(), map.numMeasurements() );
+        sba.buildStructure( map );
+        sba.prepareSparseMatrix( map.numKeyframes() );
+        sba.setIterations( 0 );
+        sba.buildReducedCameraSystem( map );
+
+        Eigen::MatrixXd S;
+        Eigen::VectorXd xref;
+        _denseSchurSolve( S, xref, sba, map );
+
+        /* only the lower triangle of the reduced system is stored */
+        Eigen::MatrixXd reduced( *sba.getSparseReduced() );
+        Eigen::MatrixXd lower = S.triangularView<Eigen::Lower>();
+        b = ( reduced.triangularView<Eigen::Lower>().toDenseMatrix() - lower ).norm() <= 1e-9 * S.norm();
+        CVTTEST_PRINT( "reduced camera system", b );
+        result &= b;
+
+        SBACholeskySolver cholesky;
+        b = _solverTest( cholesky, xref, sba );
+        CVTTEST_PRINT( "SBACholeskySolver", b );
+        result &= b;
+
+        SBAPCGSolver pcg( 6, 1000, 1e-14 );
+        b = _solverTest( pcg, xref, sba ) && pcg.iterations() > 0;
+        CVTTEST_PRINT( "SBAPCGSolver", b );
+        result &= b;
+    }
+
+    /* both solvers reduce the reprojection error of the perturbed map */
+    for( size_t s = 0; s < 2; s++ ) {
+        SlamMap noisy;
+        _syntheticMap( noisy, 6, 80 );
+        double before = _reprojectionError( noisy );
+
+        SparseBundleAdjustment sba;
+        if( s )
+            sba.setReducedSolver( new SBAPCGSolver() );
+        TerminationCriteria<double> criteria( TERM_COSTS_THRESH | TERM_MAX_ITER );
+        criteria.setCostThreshold( 1e-8 );
+        criteria.setMaxIterations( 20 );
+        sba.optimize( noisy, criteria );
+
+        double after = _reprojectionError( noisy );
+        b = before > 1.0 && after < 1e-2 * before && sba.iterations() > 0;
+        if( s )
+            CVTTEST_PRINT( "optimize PCG", b );
+        else
+            CVTTEST_PRINT( "optimize Cholesky", b );
+        result &= b;
+    }
+
+    return result;
+END_CVTTEST
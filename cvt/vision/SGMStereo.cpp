@@ -0,0 +1,365 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/vision/SGMStereo.h>
+#include <cvt/gfx/IParallel.h>
+#include <cvt/util/ThreadPool.h>
+#include <cvt/util/SIMD.h>
+#include <cvt/util/Exception.h>
+#include <cvt/math/Math.h>
+
+namespace cvt {
+
+	/* census window 9 x 7 without the center, 62 bits */
+	#define SGM_CENSUS_RX 4
+	#define SGM_CENSUS_RY 3
+	#define SGM_BRIEF_PAIRS 64
+	#define SGM_MAXCOST 64
+
+	SGMStereo::SGMStereo( const Params& params ) :
+		_numDisp( 0 )
+	{
+		setParams( params );
+
+		/* fixed pseudo random pairs inside the census window, identical for every instance */
+		uint32_t seed = 0x2545f491;
+		_briefPattern.resize( SGM_BRIEF_PAIRS * 4 );
+		for( size_t i = 0; i < _briefPattern.size(); i += 2 ) {
+			seed = seed * 1664525u + 1013904223u;
+			_briefPattern[ i ] = ( int ) ( ( seed >> 16 ) % ( 2 * SGM_CENSUS_RX + 1 ) ) - SGM_CENSUS_RX;
+			seed = seed * 1664525u + 1013904223u;
+			_briefPattern[ i + 1 ] = ( int ) ( ( seed >> 16 ) % ( 2 * SGM_CENSUS_RY + 1 ) ) - SGM_CENSUS_RY;
+		}
+	}
+
+	SGMStereo::~SGMStereo()
+	{
+	}
+
+	void SGMStereo::setParams( const Params& params )
+	{
+		if( params.paths != 8 && params.paths != 16 )
+			throw CVTException( "SGMStereo supports 8 or 16 paths" );
+		/* path costs are bounded by SGM_MAXCOST + P2 and have to fit into 15 bits */
+		if( params.P1 > params.P2 || ( size_t ) params.P2 + SGM_MAXCOST >= 0x7fff )
+			throw CVTException( "Invalid SGMStereo penalties" );
+		_params = params;
+		_params.maxDisparity = Math::max<size_t>( _params.maxDisparity, 1 );
+	}
+
+	void SGMStereo::disparityMap( Image& dmap, const Image& left, const Image& right )
+	{
+		if( left.width() != right.width() || left.height() != right.height() )
+			throw CVTException( "Left and right image need to have the same size" );
+
+		const size_t width = left.width();
+		const size_t height = left.height();
+		_numDisp = Math::min( _params.maxDisparity, width );
+
+		descriptors( _descLeft, left );
+		descriptors( _descRight, right );
+
+		dmap.reallocate( width, height, IFormat::GRAY_FLOAT );
+		size_t dstride;
+		float* dst = dmap.map<float>( &dstride );
+
+		const size_t tile = _params.tileHeight ? _params.tileHeight : height;
+		const size_t overlap = _params.tileHeight ? _params.tileOverlap : 0;
+		try {
+			for( size_t ty = 0; ty < height; ty += tile ) {
+				size_t ty1 = Math::min( height, ty + tile );
+				size_t sy0 = ty > overlap ? ty - overlap : 0;
+				size_t sy1 = Math::min( height, ty1 + overlap );
+
+				matchingCost( sy0, sy1, width );
+				aggregate( sy1 - sy0, width );
+				selectDisparities( dst, dstride, ty, ty1, sy0, width );
+			}
+		} catch( ... ) {
+			dmap.unmap( dst );
+			throw;
+		}
+
+		dmap.unmap( dst );
+	}
+
+	void SGMStereo::descriptors( std::vector<uint64_t>& desc, const Image& img ) const
+	{
+		Image gray;
+		const Image* in = &img;
+		if( img.format() != IFormat::GRAY_UINT8 ) {
+			img.convert( gray, IFormat::GRAY_UINT8 );
+			in = &gray;
+		}
+
+		const size_t width = in->width();
+		const size_t height = in->height();
+		size_t stride;
+		const uint8_t* src = in->map( &stride );
+
+		desc.resize( width * height );
+
+		if( _params.cost == COST_CENSUS ) {
+			parallelForRows( *in, [&]( size_t ystart, size_t yend ) {
+				for( size_t y = ystart; y < yend; y++ )
+					censusRow( &desc[ y * width ], src, stride, y, width, height );
+			} );
+		} else {
+			/* BRIEF compares 3 x 3 box filtered intensities */
+			std::vector<uint16_t> smooth( width * height );
+			parallelForRows( *in, [&]( size_t ystart, size_t yend ) {
+				for( size_t y = ystart; y < yend; y++ ) {
+					const uint8_t* rows[ 3 ] = { src + ( y ? y - 1 : 0 ) * stride, src + y * stride, src + Math::min( y + 1, height - 1 ) * stride };
+					uint16_t* pdst = &smooth[ y * width ];
+					for( size_t x = 0; x < width; x++ ) {
+						size_t xl = x ? x - 1 : 0;
+						size_t xr = Math::min( x + 1, width - 1 );
+						uint16_t s = 0;
+						for( size_t k = 0; k < 3; k++ )
+							s += rows[ k ][ xl ] + rows[ k ][ x ] + rows[ k ][ xr ];
+						pdst[ x ] = s;
+					}
+				}
+			} );
+			parallelForRows( *in, [&]( size_t ystart, size_t yend ) {
+				for( size_t y = ystart; y < yend; y++ )
+					briefRow( &desc[ y * width ], &smooth[ 0 ], y, width, height );
+			} );
+		}
+
+		in->unmap( src );
+	}
+
+	void SGMStereo::censusRow( uint64_t* dst, const uint8_t* src, size_t stride, size_t y, size_t width, size_t height ) const
+	{
+		const uint8_t* rows[ 2 * SGM_CENSUS_RY + 1 ];
+		for( int k = -SGM_CENSUS_RY; k <= SGM_CENSUS_RY; k++ )
+			rows[ k + SGM_CENSUS_RY ] = src + Math::clamp<ssize_t>( ( ssize_t ) y + k, 0, height - 1 ) * stride;
+
+		const ssize_t xmax = width - 1;
+		const uint8_t* center = rows[ SGM_CENSUS_RY ];
+		for( size_t x = 0; x < width; x++ ) {
+			uint64_t bits = 0;
+			uint8_t c = center[ x ];
+			if( x >= SGM_CENSUS_RX && x + SGM_CENSUS_RX < width ) {
+				for( size_t k = 0; k < 2 * SGM_CENSUS_RY + 1; k++ ) {
+					const uint8_t* p = rows[ k ] + x - SGM_CENSUS_RX;
+					for( size_t i = 0; i < 2 * SGM_CENSUS_RX + 1; i++ ) {
+						if( k == SGM_CENSUS_RY && i == SGM_CENSUS_RX )
+							continue;
+						bits = ( bits << 1 ) | ( p[ i ] < c );
+					}
+				}
+			} else {
+				for( size_t k = 0; k < 2 * SGM_CENSUS_RY + 1; k++ ) {
+					for( int i = -SGM_CENSUS_RX; i <= SGM_CENSUS_RX; i++ ) {
+						if( k == SGM_CENSUS_RY && i == 0 )
+							continue;
+						bits = ( bits << 1 ) | ( rows[ k ][ Math::clamp<ssize_t>( ( ssize_t ) x + i, 0, xmax ) ] < c );
+					}
+				}
+			}
+			dst[ x ] = bits;
+		}
+	}
+
+	void SGMStereo::briefRow( uint64_t* dst, const uint16_t* smooth, size_t y, size_t width, size_t height ) const
+	{
+		const ssize_t xmax = width - 1;
+		const ssize_t ymax = height - 1;
+		const int* pattern = &_briefPattern[ 0 ];
+
+		for( size_t x = 0; x < width; x++ ) {
+			uint64_t bits = 0;
+			for( size_t i = 0; i < SGM_BRIEF_PAIRS; i++ ) {
+				const int* p = pattern + 4 * i;
+				ssize_t x1 = Math::clamp<ssize_t>( ( ssize_t ) x + p[ 0 ], 0, xmax );
+				ssize_t y1 = Math::clamp<ssize_t>( ( ssize_t ) y + p[ 1 ], 0, ymax );
+				ssize_t x2 = Math::clamp<ssize_t>( ( ssize_t ) x + p[ 2 ], 0, xmax );
+				ssize_t y2 = Math::clamp<ssize_t>( ( ssize_t ) y + p[ 3 ], 0, ymax );
+				bits = ( bits << 1 ) | ( smooth[ y1 * width + x1 ] < smooth[ y2 * width + x2 ] );
+			}
+			dst[ x ] = bits;
+		}
+	}
+
+	void SGMStereo::matchingCost( size_t y0, size_t y1, size_t width )
+	{
+		const size_t D = _numDisp;
+		SIMD* simd = SIMD::instance();
+
+		_cost.resize( ( y1 - y0 ) * width * D );
+
+		IParallel::forRows( width, y1 - y0, [&]( size_t ystart, size_t yend ) {
+			std::vector<uint32_t> dist( D );
+			for( size_t y = ystart; y < yend; y++ ) {
+				const uint64_t* dleft = &_descLeft[ ( y + y0 ) * width ];
+				const uint64_t* dright = &_descRight[ ( y + y0 ) * width ];
+				uint8_t* pcost = &_cost[ y * width * D ];
+
+				for( size_t x = 0; x < width; x++ ) {
+					/* distances to the right descriptors x - count + 1 ... x, i.e. in descending disparity order */
+					size_t count = Math::min( x + 1, D );
+					simd->hammingDistances( &dist[ 0 ], ( const uint8_t* ) ( dleft + x ), ( const uint8_t* ) ( dright + x + 1 - count ),
+											sizeof( uint64_t ), count, sizeof( uint64_t ) );
+					for( size_t d = 0; d < count; d++ )
+						pcost[ d ] = ( uint8_t ) dist[ count - 1 - d ];
+					for( size_t d = count; d < D; d++ )
+						pcost[ d ] = SGM_MAXCOST;
+					pcost += D;
+				}
+			}
+		} );
+	}
+
+	void SGMStereo::aggregate( size_t rows, size_t width )
+	{
+		static const int dirs[ 16 ][ 2 ] = {
+			{  1,  0 }, { -1,  0 }, {  0,  1 }, {  0, -1 },
+			{  1,  1 }, { -1,  1 }, {  1, -1 }, { -1, -1 },
+			{  1,  2 }, { -1,  2 }, {  1, -2 }, { -1, -2 },
+			{  2,  1 }, { -2,  1 }, {  2, -1 }, { -2, -1 }
+		};
+
+		const size_t D = _numDisp;
+		const uint16_t P1 = _params.P1;
+		const uint16_t P2 = _params.P2;
+		const ssize_t w = width;
+		const ssize_t h = rows;
+		SIMD* simd = SIMD::instance();
+		ThreadPool& pool = ThreadPool::instance();
+		std::vector<size_t> starts;
+
+		_sum.assign( rows * width * D, 0 );
+
+		for( size_t r = 0; r < _params.paths; r++ ) {
+			const ssize_t dx = dirs[ r ][ 0 ];
+			const ssize_t dy = dirs[ r ][ 1 ];
+
+			/* every pixel whose predecessor is outside of the image starts an independent path */
+			starts.clear();
+			for( ssize_t y = 0; y < h; y++ ) {
+				bool rowstart = y - dy < 0 || y - dy >= h;
+				for( ssize_t x = 0; x < w; x++ ) {
+					if( rowstart || x - dx < 0 || x - dx >= w )
+						starts.push_back( y * w + x );
+				}
+			}
+
+			pool.parallelFor( 0, starts.size(), 64, [&]( size_t sbegin, size_t send ) {
+				std::vector<uint16_t> lbuf( 2 * ( D + 2 ), 0x7fff );
+				for( size_t s = sbegin; s < send; s++ ) {
+					uint16_t* prev = &lbuf[ 1 ];
+					uint16_t* cur = &lbuf[ D + 3 ];
+					for( size_t d = 0; d < D; d++ )
+						prev[ d ] = 0;
+					uint16_t prevmin = 0;
+
+					ssize_t x = starts[ s ] % width;
+					ssize_t y = starts[ s ] / width;
+					while( x >= 0 && x < w && y >= 0 && y < h ) {
+						size_t idx = ( y * width + x ) * D;
+						prevmin = simd->SGMPathStep_u16( cur, &_sum[ idx ], prev, &_cost[ idx ], prevmin, P1, P2, D );
+						uint16_t* tmp = prev;
+						prev = cur;
+						cur = tmp;
+						x += dx;
+						y += dy;
+					}
+				}
+			} );
+		}
+	}
+
+	void SGMStereo::selectDisparities( float* dmap, size_t dstride, size_t y0, size_t y1, size_t yoffset, size_t width )
+	{
+		const size_t D = _numDisp;
+		const float uniqueness = _params.uniqueness;
+		const ssize_t lrthres = _params.lrThreshold;
+
+		IParallel::forRows( width, y1 - y0, [&]( size_t ystart, size_t yend ) {
+			std::vector<ssize_t> dright( width );
+
+			for( size_t y = ystart + y0; y < yend + y0; y++ ) {
+				const uint16_t* sum = &_sum[ ( y - yoffset ) * width * D ];
+				float* pdst = dmap + y * dstride;
+
+				/* right disparities from the same aggregated costs: right pixel xr matches left pixel xr + d */
+				for( size_t xr = 0; xr < width; xr++ ) {
+					size_t dmax = Math::min( D, width - xr );
+					uint16_t best = 0xffff;
+					ssize_t bestd = -1;
+					for( size_t d = 0; d < dmax; d++ ) {
+						uint16_t s = sum[ ( xr + d ) * D + d ];
+						if( s < best ) {
+							best = s;
+							bestd = d;
+						}
+					}
+					dright[ xr ] = bestd;
+				}
+
+				for( size_t x = 0; x < width; x++ ) {
+					const uint16_t* s = sum + x * D;
+					size_t dmax = Math::min( D, x + 1 );
+					size_t bestd = 0;
+					for( size_t d = 1; d < dmax; d++ ) {
+						if( s[ d ] < s[ bestd ] )
+							bestd = d;
+					}
+					pdst[ x ] = 0.0f;
+
+					if( uniqueness < 1.0f ) {
+						uint16_t second = 0xffff;
+						for( size_t d = 0; d < dmax; d++ ) {
+							if( ( d + 1 < bestd || d > bestd + 1 ) && s[ d ] < second )
+								second = s[ d ];
+						}
+						if( s[ bestd ] > uniqueness * second )
+							continue;
+					}
+
+					if( _params.lrCheck ) {
+						ssize_t diff = dright[ x - bestd ] - ( ssize_t ) bestd;
+						if( diff > lrthres || -diff > lrthres )
+							continue;
+					}
+
+					float disp = bestd;
+					if( _params.subpixel && bestd > 0 && bestd + 1 < dmax ) {
+						float c0 = s[ bestd - 1 ];
+						float c1 = s[ bestd ];
+						float c2 = s[ bestd + 1 ];
+						float denom = c0 + c2 - 2.0f * c1;
+						if( denom > 0.0f )
+							disp += ( c0 - c2 ) / ( 2.0f * denom );
+					}
+					pdst[ x ] = disp;
+				}
+			}
+		} );
+	}
+
+}
@@ -0,0 +1,130 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_SGMSTEREO_H
+#define CVT_SGMSTEREO_H
+
+#include <cvt/gfx/Image.h>
+
+#include <vector>
+
+namespace cvt {
+
+	/**
+	  @brief Semi-global matching on the CPU
+
+	  Dense disparity estimation for rectified stereo pairs, e.g. the output of StereoRectification.
+	  The matching cost is the hamming distance of 64 bit census or BRIEF descriptors. The costs are
+	  aggregated along 8 or 16 paths with saturating 16 bit arithmetic, every path direction is processed
+	  in parallel over its independent scanlines. The winner takes all disparities can be verified by a
+	  left-right check and refined to subpixel accuracy.
+
+	  The cost volume needs width x height x disparities x 3 bytes. With a tile height set, the image is
+	  processed in horizontal stripes that overlap by tileOverlap rows, only the stripe is kept in memory.
+	  The result is a GRAY_FLOAT disparity map of the left image, invalid pixels are set to zero
+	  (see Disparity::evaluateError).
+	 */
+	class SGMStereo {
+		public:
+			enum CostType {
+				COST_CENSUS,
+				COST_BRIEF
+			};
+
+			struct Params {
+				Params() :
+					maxDisparity( 64 ),
+					P1( 7 ),
+					P2( 86 ),
+					cost( COST_CENSUS ),
+					paths( 8 ),
+					uniqueness( 0.95f ),
+					lrCheck( true ),
+					lrThreshold( 1 ),
+					subpixel( true ),
+					tileHeight( 0 ),
+					tileOverlap( 32 )
+				{
+				}
+
+				/* disparities 0 ... maxDisparity - 1 are evaluated */
+				size_t		maxDisparity;
+				/* penalties for disparity changes of one and of more than one */
+				uint16_t	P1;
+				uint16_t	P2;
+				CostType	cost;
+				/* 8 or 16 aggregation paths */
+				size_t		paths;
+				/* the best cost has to be below uniqueness times the best cost outside of the neighbourhood, 1 disables the test */
+				float		uniqueness;
+				bool		lrCheck;
+				size_t		lrThreshold;
+				bool		subpixel;
+				/* rows per stripe in the low memory mode, 0 processes the whole image at once */
+				size_t		tileHeight;
+				size_t		tileOverlap;
+			};
+
+			SGMStereo( const Params& params = Params() );
+			~SGMStereo();
+
+			const Params& params() const { return _params; }
+			void setParams( const Params& params );
+
+			/**
+			  @brief Compute the disparity map of the rectified left image
+			  The images need to have the same size, formats other than GRAY_UINT8 are converted.
+			 */
+			void disparityMap( Image& dmap, const Image& left, const Image& right );
+
+		private:
+			SGMStereo( const SGMStereo& );
+			SGMStereo& operator=( const SGMStereo& );
+
+			void descriptors( std::vector<uint64_t>& desc, const Image& img ) const;
+			void censusRow( uint64_t* dst, const uint8_t* src, size_t stride, size_t y, size_t width, size_t height ) const;
+			void briefRow( uint64_t* dst, const uint16_t* smooth, size_t y, size_t width, size_t height ) const;
+
+			void matchingCost( size_t y0, size_t y1, size_t width );
+			void aggregate( size_t rows, size_t width );
+			void selectDisparities( float* dmap, size_t dstride, size_t y0, size_t y1, size_t yoffset, size_t width );
+
+			Params					_params;
+			size_t					_numDisp;
+
+			/* random comparison pairs of the BRIEF descriptor */
+			std::vector<int>		_briefPattern;
+
+			std::vector<uint64_t>	_descLeft;
+			std::vector<uint64_t>	_descRight;
+
+			/* cost volume and aggregated costs of the current stripe, rows x width x disparities */
+			std::vector<uint8_t>	_cost;
+			std::vector<uint16_t>	_sum;
+	};
+
+}
+
+#endif
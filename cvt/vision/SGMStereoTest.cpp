@@ -0,0 +1,138 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/vision/SGMStereo.h>
+#include <cvt/vision/Disparity.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/util/CVTTest.h>
+
+using namespace cvt;
+
+/* random texture where the right image is the left one shifted by disp pixels */
+static void _stereoPair( Image& left, Image& right, Image& gt, size_t disp )
+{
+    const size_t w = 160;
+    const size_t h = 120;
+    std::vector<uint8_t> tex( ( w + disp ) * h );
+    for( size_t i = 0; i < tex.size(); i++ )
+        tex[ i ] = Math::rand( 0, 255 );
+
+    left.reallocate( w, h, IFormat::GRAY_UINT8 );
+    right.reallocate( w, h, IFormat::GRAY_UINT8 );
+    gt.reallocate( w, h, IFormat::GRAY_FLOAT );
+
+    IMapScoped<uint8_t> lmap( left );
+    IMapScoped<uint8_t> rmap( right );
+    IMapScoped<float> gtmap( gt );
+    for( size_t y = 0; y < h; y++ ) {
+        for( size_t x = 0; x < w; x++ ) {
+            lmap.ptr()[ x ] = tex[ y * ( w + disp ) + x ];
+            rmap.ptr()[ x ] = tex[ y * ( w + disp ) + x + disp ];
+            gtmap.ptr()[ x ] = x >= 2 * disp ? ( float ) disp : 0.0f;
+        }
+        lmap++;
+        rmap++;
+        gtmap++;
+    }
+}
+
+static bool _sgmTest( const SGMStereo::Params& params )
+{
+    Image left, right, gt, disparity;
+    _stereoPair( left, right, gt, 8 );
+
+    SGMStereo sgm( params );
+    sgm.disparityMap( disparity, left, right );
+
+    float error, density;
+    Disparity::evaluateError( error, density, disparity, gt, 0.5f, 0.0f );
+    return error < 0.05f && density > 0.9f;
+}
+
+/* fraction of pixels where the tiled disparity map equals the one computed in a single stripe */
+static float _tiledAgreement( const SGMStereo::Params& params )
+{
+    Image left, right, gt, disparity, tiled;
+    _stereoPair( left, right, gt, 8 );
+
+    SGMStereo::Params untiled = params;
+    untiled.tileHeight = 0;
+    SGMStereo sgm( untiled );
+    sgm.disparityMap( disparity, left, right );
+
+    SGMStereo sgmtiled( params );
+    sgmtiled.disparityMap( tiled, left, right );
+
+    IMapScoped<const float> dmap( disparity );
+    IMapScoped<const float> tmap( tiled );
+    size_t equal = 0;
+    for( size_t y = 0; y < disparity.height(); y++ ) {
+        for( size_t x = 0; x < disparity.width(); x++ ) {
+            if( dmap.ptr()[ x ] == tmap.ptr()[ x ] )
+                equal++;
+        }
+        dmap++;
+        tmap++;
+    }
+    return ( float ) equal / ( float ) ( disparity.width() * disparity.height() );
+}
+
+BEGIN_CVTTEST( SGMStereo )
+    bool result = true;
+    bool b;
+
+    SGMStereo::Params params;
+    params.maxDisparity = 32;
+
+    b = _sgmTest( params );
+    CVTTEST_PRINT( "census, 8 paths", b );
+    result &= b;
+
+    params.paths = 16;
+    params.cost = SGMStereo::COST_BRIEF;
+    b = _sgmTest( params );
+    CVTTEST_PRINT( "BRIEF, 16 paths", b );
+    result &= b;
+
+    params.tileHeight = 32;
+    params.tileOverlap = 16;
+    b = _sgmTest( params );
+    CVTTEST_PRINT( "tiled", b );
+    result &= b;
+
+    /* with an overlap covering the whole image every stripe sees all rows */
+    params.tileOverlap = 120;
+    b = _tiledAgreement( params ) == 1.0f;
+    CVTTEST_PRINT( "tiled with full overlap equals untiled", b );
+    result &= b;
+
+    /* the vertical and diagonal paths are cut at the stripe borders, the overlap hides this */
+    params.tileOverlap = 16;
+    b = _tiledAgreement( params ) > 0.99f;
+    CVTTEST_PRINT( "tiled equals untiled", b );
+    result &= b;
+
+    return result;
+END_CVTTEST
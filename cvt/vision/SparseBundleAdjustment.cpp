@@ -29,6 +29,8 @@
 #include <cvt/math/Math.h>
 #include <cvt/math/SE3.h>
 #include <cvt/vision/Vision.h>
+#include <cvt/util/ThreadPool.h>
+#include <cvt/util/Exception.h>
 
 #include <cstring>
 
@@ -42,7 +44,8 @@ namespace cvt {
         _invAugPJTJ( 0 ),
         _camsJTJ( 0 ),
         _camResiduals( 0 ),
-        _pointResiduals( 0 )
+        _pointResiduals( 0 ),
+        _solver( new SBACholeskySolver() )
     {
     }
 
@@ -58,6 +61,23 @@ namespace cvt {
             delete[] _camResiduals;
         if( _pointResiduals )
             delete[] _pointResiduals;
+        delete _solver;
+    }
+
+    void SparseBundleAdjustment::setReducedSolver( SBAReducedSolver* solver )
+    {
+        if( !solver )
+            throw CVTException( "Reduced system solver must not be NULL" );
+        if( solver == _solver )
+            return;
+        delete _solver;
+        _solver = solver;
+    }
+
+    /* number of point ranges processed as separate tasks, each with its own reduction buffer */
+    static size_t _numReductionTasks( size_t n )
+    {
+        return Math::max<size_t>( Math::min<size_t>( 4 * ( ThreadPool::instance().numThreads() + 1 ), n ), 1 );
     }
 
     static bool _vectorHasNaNOrInf( Eigen::VectorXd& v )
@@ -85,25 +105,18 @@ namespace cvt {
         Eigen::VectorXd	deltaCam( camParamDim * numCams );
         Eigen::VectorXd	deltaPoint( pointParamDim * numPoints );
 
-        // TODO: modularize on the solver:
-        // SimplicialCholesky -> LDLt by default, can also set LLt
-        Eigen::SimplicialCholesky<Eigen::SparseMatrix<double, Eigen::ColMajor>, Eigen::Lower> solver;
+        // the sparsity pattern does not change during the optimization
+        buildStructure( map );
+        prepareSparseMatrix( numCams );
+        _solver->analyzePattern( _sparseReduced );
 
         double lastCosts = 1e20;
         while( true ){
             // build the reduced system: in first iteration, eval costs
             buildReducedCameraSystem( map );
 
-            if( _iterations == 0 ){
-                // solve symbolic
-                solver.analyzePattern( _sparseReduced );
-            }
-
-            solver.factorize( _sparseReduced );
-            deltaCam = solver.solve( _reducedRHS );
-
             // safety check on computed delta
-            if( _vectorHasNaNOrInf( deltaCam ) ){
+            if( !_solver->solve( deltaCam, _sparseReduced, _reducedRHS ) || _vectorHasNaNOrInf( deltaCam ) ){
                 // increase lambda and try again
                 _lambda *= 5.0f;
                 continue;
@@ -148,106 +161,144 @@ namespace cvt {
     {
         evaluateApproxHessians( map );
         updateInverseAugmentedPointHessians();
+        fillSparseMatrix( map );
+    }
+
+    void SparseBundleAdjustment::buildStructure( const SlamMap & map )
+    {
+        _jointMeasures.resize( _nCams );
+        _camPointJTJ.clear();
 
-        if( _iterations == 0 ){
-            // prepare the sparse matrix (storage allocation) <- need jointMeasures to be filled
-            prepareSparseMatrix( map.numKeyframes() );
+        for( size_t i = 0; i < _nPts; i++ ){
+            const MapFeature & feature = map.featureForId( i );
+
+            MapFeature::ConstPointTrackIterator camIterCurr = feature.pointTrackBegin();
+            const MapFeature::ConstPointTrackIterator camIterEnd  = feature.pointTrackEnd();
+            while( camIterCurr != camIterEnd ){
+                _camPointJTJ.block( *camIterCurr, i );
+
+                MapFeature::ConstPointTrackIterator camIter = camIterCurr;
+                camIter++;
+                while( camIter != camIterEnd ) {
+                    _jointMeasures.addMeasurementForEntity( *camIterCurr, *camIter, i );
+                    ++camIter;
+                }
+                ++camIterCurr;
+            }
         }
 
-        fillSparseMatrix( map );
+        // the block index is shared read-only by the worker threads afterwards
+        _camPointJTJ.updateIndex();
     }
 
     void SparseBundleAdjustment::evaluateApproxHessians( const SlamMap & map )
     {
-        CamScreenJacType	screenJacCam;
-        PointScreenJacType	screenJacPoint;
-        Eigen::Matrix<double, 6, 2> jCamTCovInv;
-        Eigen::Matrix<double, 3, 2> jPointTCovInv;
-        Eigen::Matrix<double, 3, 1> point3d, pCam;
-        Eigen::Matrix<double, 2, 1> residual;
-        Eigen::Matrix<double, 2, 1> reproj;
-
         const Eigen::Matrix3d & K = map.intrinsics();
-
-        size_t currMeas = 0;
-        double avgDiag = 0.0;
+        const CamPointMatrix & camPoint = _camPointJTJ;
         bool firstIter = ( _iterations == 0 );
 
-        // for all 3D Points
-        clear();
-        _costs = 0.0;
-        for( size_t i = 0; i < _nPts; i++ ){
-            _pointsJTJ[ i ].setZero();
-            _pointResiduals[ i ].setZero();
-
-            // get the MapFeature:
-            const MapFeature & feature = map.featureForId( i );
-            const Eigen::Vector4d & ptmp = feature.estimate();
-            point3d = ptmp.head<3>() / ptmp[ 3 ];
+        // the points are split into ranges, the camera sums of each range go to a separate
+        // buffer and are reduced afterwards
+        ThreadPool & pool = ThreadPool::instance();
+        size_t numTasks = _numReductionTasks( _nPts );
+        _camAccum.resize( numTasks );
+
+        pool.parallelFor( 0, numTasks, 1, [&]( size_t tbegin, size_t tend ) {
+            CamScreenJacType	screenJacCam;
+            PointScreenJacType	screenJacPoint;
+            Eigen::Matrix<double, 6, 2> jCamTCovInv;
+            Eigen::Matrix<double, 3, 2> jPointTCovInv;
+            Eigen::Matrix<double, 3, 1> point3d, pCam;
+            Eigen::Matrix<double, 2, 1> residual;
+            Eigen::Matrix<double, 2, 1> reproj;
+
+            for( size_t t = tbegin; t < tend; t++ ){
+                CamAccumulator & acc = _camAccum[ t ];
+                acc.jtj.resize( _nCams );
+                acc.residuals.resize( _nCams );
+                for( size_t c = 0; c < _nCams; c++ ){
+                    acc.jtj[ c ].setZero();
+                    acc.residuals[ c ].setZero();
+                }
+                acc.costs = 0.0;
+                acc.diagSum = 0.0;
 
+                size_t iEnd = ( _nPts * ( t + 1 ) ) / numTasks;
+                for( size_t i = ( _nPts * t ) / numTasks; i < iEnd; i++ ){
+                    _pointsJTJ[ i ].setZero();
+                    _pointResiduals[ i ].setZero();
 
-            // for all point tracks (meas. in the cams) of this point
-            MapFeature::ConstPointTrackIterator camIterCurr = feature.pointTrackBegin();
-            const MapFeature::ConstPointTrackIterator camIterEnd  = feature.pointTrackEnd();
+                    // get the MapFeature:
+                    const MapFeature & feature = map.featureForId( i );
+                    const Eigen::Vector4d & ptmp = feature.estimate();
+                    point3d = ptmp.head<3>() / ptmp[ 3 ];
 
-            /* update the joint meas structure: -> only needed in first iteration! */
-            if( firstIter ){
-                while( camIterCurr != camIterEnd ){
-                    MapFeature::ConstPointTrackIterator camIter = camIterCurr;
-                    camIter++;
-                    while( camIter != camIterEnd ) {
-                        _jointMeasures.addMeasurementForEntity( *camIterCurr, *camIter, i );
-                        ++camIter;
-                    }
-                    ++camIterCurr;
-                }
-            }
+                    // for all cams with a measurement of this point
+                    CamPointMatrix::ConstEntryIterator camBlock = camPoint.colBegin( i );
+                    const CamPointMatrix::ConstEntryIterator camBlockEnd = camPoint.colEnd( i );
+                    for( ; camBlock != camBlockEnd; ++camBlock ){
+                        size_t camId = camBlock->index;
 
-            for( MapFeature::ConstPointTrackIterator camIter = feature.pointTrackBegin();
-                 camIter != camIterEnd;
-                 camIter++, currMeas++ ){
-                // get the keyframe:
-                const Keyframe & keyframe = map.keyframeForId( *camIter );
+                        // get the keyframe:
+                        const Keyframe & keyframe = map.keyframeForId( camId );
 
-                // screen jacobian for this 3D point in that camera
-                const Eigen::Matrix4d & trans = keyframe.pose().transformation();
-                const Eigen::Matrix<double, 3, 3> & R = trans.block<3, 3>( 0, 0 );
-                pCam = R * point3d + trans.block<3, 1>( 0, 3 );
+                        // screen jacobian for this 3D point in that camera
+                        const Eigen::Matrix4d & trans = keyframe.pose().transformation();
+                        const Eigen::Matrix<double, 3, 3> & R = trans.block<3, 3>( 0, 0 );
+                        pCam = R * point3d + trans.block<3, 1>( 0, 3 );
 
-                // screen jacobian for this camera
-                keyframe.pose().screenJacobian( screenJacCam, pCam, K );
+                        // screen jacobian for this camera
+                        keyframe.pose().screenJacobian( screenJacCam, pCam, K );
 
-                // point jacobian for this point in this cam:
-                evalScreenJacWrtPoint( reproj, screenJacPoint, pCam, K, R );
+                        // point jacobian for this point in this cam:
+                        evalScreenJacWrtPoint( reproj, screenJacPoint, pCam, K, R );
 
-                const MapMeasurement & mm = keyframe.measurementForId( i );
-                residual = mm.point - reproj;
+                        const MapMeasurement & mm = keyframe.measurementForId( i );
+                        residual = mm.point - reproj;
 
-                // J^T * Cov^-1
-                jCamTCovInv = screenJacCam.transpose() * mm.information;
-                jPointTCovInv = screenJacPoint.transpose() * mm.information;
+                        // J^T * Cov^-1
+                        jCamTCovInv = screenJacCam.transpose() * mm.information;
+                        jPointTCovInv = screenJacPoint.transpose() * mm.information;
 
-                // accumulate the jacobians
-                _pointsJTJ[ i ]			+= jPointTCovInv * screenJacPoint;
-                _camsJTJ[ *camIter ]	+= jCamTCovInv * screenJacCam;
+                        // accumulate the jacobians
+                        _pointsJTJ[ i ]		+= jPointTCovInv * screenJacPoint;
+                        acc.jtj[ camId ]	+= jCamTCovInv * screenJacCam;
 
-                // accumulate the residuals
-                _pointResiduals[ i ]		+= ( jPointTCovInv * residual );
-                _camResiduals[ *camIter ]   += ( jCamTCovInv   * residual );
+                        // accumulate the residuals
+                        _pointResiduals[ i ]		+= ( jPointTCovInv * residual );
+                        acc.residuals[ camId ]	+= ( jCamTCovInv   * residual );
 
-                _costs += residual.transpose() * mm.information * residual;
+                        acc.costs += residual.transpose() * mm.information * residual;
 
-                /* camPointJacobian */
-                _camPointJTJ.block( *camIter, i ) = ( jCamTCovInv * screenJacPoint );
+                        /* camPointJacobian */
+                        _camPointJTJ.blockAt( camBlock->block ) = ( jCamTCovInv * screenJacPoint );
+                    }
 
+                    // the pointjac JTJ & pointResidual sums for pt i are complete now
+                    if( firstIter )
+                        acc.diagSum += _pointsJTJ[ i ].diagonal().array().sum();
+                }
             }
+        } );
+
+        // reduce the camera sums
+        pool.parallelFor( 0, _nCams, 16, [&]( size_t cbegin, size_t cend ) {
+            for( size_t c = cbegin; c < cend; c++ ){
+                _camsJTJ[ c ]	   = _camAccum[ 0 ].jtj[ c ];
+                _camResiduals[ c ] = _camAccum[ 0 ].residuals[ c ];
+                for( size_t t = 1; t < numTasks; t++ ){
+                    _camsJTJ[ c ]	   += _camAccum[ t ].jtj[ c ];
+                    _camResiduals[ c ] += _camAccum[ t ].residuals[ c ];
+                }
+            }
+        } );
 
-            // the pointjac JTJ & pointResidual sums for pt i are complete now
-            if( firstIter )
-                avgDiag += _pointsJTJ[ i ].diagonal().array().sum();
-
+        double avgDiag = 0.0;
+        _costs = 0.0;
+        for( size_t t = 0; t < numTasks; t++ ){
+            _costs	+= _camAccum[ t ].costs;
+            avgDiag += _camAccum[ t ].diagSum;
         }
-
         _costs /= _nMeas;
 
         // compute initial lambda on first iteration
@@ -274,6 +325,7 @@ namespace cvt {
     void SparseBundleAdjustment::prepareSparseMatrix( size_t numCams )
     {
         // according to the joint Point tracks, we can create the matrix once
+        _sparseReduced.setZero();
         _sparseReduced.reserve( camParamDim * camParamDim * _jointMeasures.numBlocks() );
 
         size_t c2;
@@ -313,73 +365,79 @@ namespace cvt {
 
     void SparseBundleAdjustment::fillSparseMatrix( const SlamMap & map )
     {
-        // according to the joint Point tracks, we can now fill our matrix:
-        CamJTJ tmpBlock;
-        Eigen::Matrix<double, camParamDim, pointParamDim> tmpEval;
-        CamResidualType tmpRes;
-
+        const CamPointMatrix & camPoint = _camPointJTJ;
         size_t numCams = map.numKeyframes();
-        for( size_t c = 0; c < numCams; c++ ){
-            // first create block for this cam:
-            tmpBlock = _camsJTJ[ c ];
-            tmpRes   = _camResiduals[ c ];
-
-			// augment the jacobian diagonal
-            //tmpBlock.diagonal().array() += _lambda;
-            tmpBlock.diagonal().array() *= ( 1.0 + _lambda );
-
-            // go over all point measures:
-            const Keyframe & k = map.keyframeForId( c );
-            Keyframe::MeasurementIterator measIter = k.measurementsBegin();
-            Keyframe::MeasurementIterator measEnd  = k.measurementsEnd();
-            while( measIter != measEnd ){
-                size_t pointId = measIter->first;
-
-                const Eigen::Matrix<double, camParamDim, pointParamDim> & cp = _camPointJTJ.block( c, pointId );
-                tmpEval = cp * _invAugPJTJ[ pointId ];
-                tmpBlock -= tmpEval * cp.transpose();
-                tmpRes   -= tmpEval * _pointResiduals[ pointId ];
-
-                ++measIter;
-            }
-
-            // set the block in the sparse matrix:
-            setBlockInReducedSparse( tmpBlock, c, c );
-            _reducedRHS.segment<camParamDim>( camParamDim * c ) = tmpRes;
 
+        // camera c only writes the block column c of the (lower) reduced system and its
+        // part of the rhs, the pattern is fixed so the columns can be filled concurrently
+        ThreadPool::instance().parallelFor( 0, numCams, 1, [&]( size_t cbegin, size_t cend ) {
+            // according to the joint Point tracks, we can now fill our matrix:
+            CamJTJ tmpBlock;
+            Eigen::Matrix<double, camParamDim, pointParamDim> tmpEval;
+            CamResidualType tmpRes;
+
+            for( size_t c = cbegin; c < cend; c++ ){
+                // first create block for this cam:
+                tmpBlock = _camsJTJ[ c ];
+                tmpRes   = _camResiduals[ c ];
+
+                // augment the jacobian diagonal
+                //tmpBlock.diagonal().array() += _lambda;
+                tmpBlock.diagonal().array() *= ( 1.0 + _lambda );
+
+                // go over all point measures of this cam:
+                CamPointMatrix::ConstEntryIterator measIter = camPoint.rowBegin( c );
+                const CamPointMatrix::ConstEntryIterator measEnd = camPoint.rowEnd( c );
+                while( measIter != measEnd ){
+                    size_t pointId = measIter->index;
+
+                    const CamPointJTJ & cp = camPoint.blockAt( measIter->block );
+                    tmpEval = cp * _invAugPJTJ[ pointId ];
+                    tmpBlock -= tmpEval * cp.transpose();
+                    tmpRes   -= tmpEval * _pointResiduals[ pointId ];
+
+                    ++measIter;
+                }
 
-            JointMeasurements::ConstMapIterType iter   = _jointMeasures.secondEntityIteratorBegin( c );
-            JointMeasurements::ConstMapIterType iStop  = _jointMeasures.secondEntityIteratorEnd( c );
-            while( iter != iStop ){
-                size_t c2 = iter->first; // id of second cam:
+                // set the block in the sparse matrix:
+                setBlockInReducedSparse( tmpBlock, c, c );
+                _reducedRHS.segment<camParamDim>( camParamDim * c ) = tmpRes;
+
+                JointMeasurements::ConstMapIterType iter   = _jointMeasures.secondEntityIteratorBegin( c );
+                JointMeasurements::ConstMapIterType iStop  = _jointMeasures.secondEntityIteratorEnd( c );
+                while( iter != iStop ){
+                    size_t c2 = iter->first; // id of second cam:
+
+                    // iterate over the joint measurements of the two cameras
+                    std::set<size_t>::const_iterator pIdIter = iter->second.begin();
+                    std::set<size_t>::const_iterator pEnd    = iter->second.end();
+                    tmpBlock.setZero();
+                    while( pIdIter != pEnd ){
+                        size_t pId = *pIdIter;
+                        tmpBlock -= camPoint.block( c, pId ) * _invAugPJTJ[ pId ] * camPoint.block( c2, pId ).transpose();
+                        ++pIdIter;
+                    }
+                    ++iter;
 
-                // iterate over the joint measurements of the two cameras
-                std::set<size_t>::const_iterator pIdIter = iter->second.begin();
-                std::set<size_t>::const_iterator pEnd    = iter->second.end();
-                tmpBlock.setZero();
-                while( pIdIter != pEnd ){
-                    size_t pId = *pIdIter;
-                    tmpBlock -= _camPointJTJ.block( c, pId ) * _invAugPJTJ[ pId ] * _camPointJTJ.block( c2, pId ).transpose();
-                    ++pIdIter;
+                    setBlockInReducedSparse( tmpBlock.transpose(), c2, c );
                 }
-                ++iter;
-
-                setBlockInReducedSparse( tmpBlock.transpose(), c2, c );
             }
-        }
+        } );
     }
 
     void SparseBundleAdjustment::updateInverseAugmentedPointHessians()
     {
-        PointJTJ inv;
-        for( size_t i = 0; i < _nPts; i++ ){
-            inv = _pointsJTJ[ i ];
-            // augment the diagonal:
-            //inv.diagonal().array() += _lambda;
-            inv.diagonal().array() *= ( 1.0 + _lambda );
-            // TODO: is there a way to exploit symmetry when inverting with Eigen?
-            _invAugPJTJ[ i ] = inv.inverse();
-        }
+        ThreadPool::instance().parallelFor( 0, _nPts, 256, [&]( size_t begin, size_t end ) {
+            PointJTJ inv;
+            for( size_t i = begin; i < end; i++ ){
+                inv = _pointsJTJ[ i ];
+                // augment the diagonal:
+                //inv.diagonal().array() += _lambda;
+                inv.diagonal().array() *= ( 1.0 + _lambda );
+                // TODO: is there a way to exploit symmetry when inverting with Eigen?
+                _invAugPJTJ[ i ] = inv.inverse();
+            }
+        } );
     }
 
     void SparseBundleAdjustment::setBlockInReducedSparse( const CamJTJ & m,
@@ -407,47 +465,60 @@ namespace cvt {
                                                  SlamMap & map )
     {
         size_t nPts = map.numFeatures();
-        Eigen::Vector3d res;
-        Eigen::Vector3d tmp;
-        Eigen::Vector2d pp, r;
-
         const Eigen::Matrix3d & K = map.intrinsics();
+        const CamPointMatrix & camPoint = _camPointJTJ;
+
+        size_t numTasks = _numReductionTasks( nPts );
+        std::vector<double> taskCosts( numTasks, 0.0 );
+
+        ThreadPool::instance().parallelFor( 0, numTasks, 1, [&]( size_t tbegin, size_t tend ) {
+            Eigen::Vector3d res;
+            Eigen::Vector3d tmp;
+            Eigen::Vector2d pp, r;
+
+            for( size_t t = tbegin; t < tend; t++ ){
+                size_t iEnd = ( nPts * ( t + 1 ) ) / numTasks;
+                for( size_t i = ( nPts * t ) / numTasks; i < iEnd; i++ ){
+                    MapFeature& f = map.featureForId( i );
+
+                    res = _pointResiduals[ i ];
+                    CamPointMatrix::ConstEntryIterator camBlock = camPoint.colBegin( i );
+                    const CamPointMatrix::ConstEntryIterator camBlockEnd = camPoint.colEnd( i );
+                    while( camBlock != camBlockEnd ){
+                        res -= camPoint.blockAt( camBlock->block ).transpose() * deltaCam.segment<camParamDim>( camBlock->index * camParamDim );
+                        ++camBlock;
+                    }
 
-        _costs = 0.0;
-        for( size_t i = 0; i < nPts; i++ ){
-            MapFeature& f = map.featureForId( i );
-            MapFeature::ConstPointTrackIterator camIter = f.pointTrackBegin();
-            const MapFeature::ConstPointTrackIterator itEnd = f.pointTrackEnd();
-
-            res = _pointResiduals[ i ];
-            while( camIter != itEnd ){
-                res -= _camPointJTJ.block( *camIter, i ).transpose() * deltaCam.segment<camParamDim>( *camIter * camParamDim );
-                ++camIter;
-            }
-
-            tmp = _invAugPJTJ[ i ] * res;
-            deltaStruct.segment<pointParamDim>( pointParamDim * i ) = tmp;
+                    tmp = _invAugPJTJ[ i ] * res;
+                    deltaStruct.segment<pointParamDim>( pointParamDim * i ) = tmp;
 
-            // apply the delta:
-            f.estimate().head<pointParamDim>() += tmp;
+                    // apply the delta:
+                    f.estimate().head<pointParamDim>() += tmp;
 
-            // evaluate the current costs again:
-            camIter = f.pointTrackBegin();
-            while( camIter != itEnd ){
-                const Keyframe & kf = map.keyframeForId( *camIter );
+                    // evaluate the current costs again:
+                    MapFeature::ConstPointTrackIterator camIter = f.pointTrackBegin();
+                    const MapFeature::ConstPointTrackIterator itEnd = f.pointTrackEnd();
+                    while( camIter != itEnd ){
+                        const Keyframe & kf = map.keyframeForId( *camIter );
 
-                Vision::project( pp,
-                                 K,
-                                 kf.pose().transformation(),
-                                 f.estimate() );
+                        Vision::project( pp,
+                                         K,
+                                         kf.pose().transformation(),
+                                         f.estimate() );
 
-                // get the measurement of point i in keyframe *camIter:
-                const MapMeasurement & meas = kf.measurementForId( i );
-                r = ( meas.point - pp );
-                _costs += ( r.transpose() * meas.information * r );
-                ++camIter;
+                        // get the measurement of point i in keyframe *camIter:
+                        const MapMeasurement & meas = kf.measurementForId( i );
+                        r = ( meas.point - pp );
+                        taskCosts[ t ] += ( r.transpose() * meas.information * r );
+                        ++camIter;
+                    }
+                }
             }
-        }
+        } );
+
+        _costs = 0.0;
+        for( size_t t = 0; t < numTasks; t++ )
+            _costs += taskCosts[ t ];
         _costs /= _nMeas;
     }
 
@@ -480,6 +551,7 @@ namespace cvt {
             _pointResiduals = new PointResidualType[ numPoints ];
 
             _camPointJTJ.resize( numCams, numPoints );
+            _camPointJTJ.reserve( numMeas );
 
             _nPts = numPoints;
         }
@@ -497,8 +569,10 @@ namespace cvt {
             _sparseReduced.resize( camParamDim * numCams, camParamDim * numCams );
             _reducedRHS.resize( camParamDim * numCams );
 
-            if( _camPointJTJ.numBlockRows() != numCams )
+            if( _camPointJTJ.numBlockRows() != numCams ) {
                 _camPointJTJ.resize( numCams, numPoints );
+                _camPointJTJ.reserve( numMeas );
+            }
 
             _nCams = numCams;
         }
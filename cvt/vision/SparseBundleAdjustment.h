@@ -36,6 +36,7 @@
 #include <cvt/math/SparseBlockMatrix.h>
 #include <cvt/math/JointMeasurements.h>
 #include <cvt/math/TerminationCriteria.h>
+#include <cvt/vision/SBAReducedSolver.h>
 
 namespace cvt {
 	class SparseBundleAdjustment
@@ -55,6 +56,10 @@ namespace cvt {
 			double lambda( ) const { return _lambda; }
 			void setLambda( double newValue ) { _lambda = newValue; }
 
+			/* solver for the reduced camera system, takes ownership. Default: SBACholeskySolver */
+			void setReducedSolver( SBAReducedSolver* solver );
+			SBAReducedSolver& reducedSolver() { return *_solver; }
+
 //		private:
 			/* jacobians for each point */		
 			static const size_t pointParamDim = 3;
@@ -66,6 +71,7 @@ namespace cvt {
 			typedef Eigen::Matrix<double, camParamDim, 1>				CamResidualType;
 			typedef Eigen::Matrix<double, pointParamDim, 1>				PointResidualType;			
 			typedef Eigen::Matrix<double, camParamDim, pointParamDim>   CamPointJTJ;
+			typedef SparseBlockMatrix<camParamDim, pointParamDim>		CamPointMatrix;
 
 			const PointJTJ* getPJTJDiagonalElement( int index ){ return ( const PointJTJ* ) &( _pointsJTJ[ index ] ); }
 			const PointJTJ* getInvAugPJTJDiagonalElement( int index ){ return ( const PointJTJ* ) &( _invAugPJTJ[ index ] ); }
@@ -100,12 +106,23 @@ namespace cvt {
 			PointResidualType*	_pointResiduals;
 			
 			/* Sparse Upper Left of the approx. Hessian */
-			SparseBlockMatrix<camParamDim, pointParamDim>			_camPointJTJ;
+			CamPointMatrix											_camPointJTJ;
 			JointMeasurements										_jointMeasures;
 			
 			Eigen::SparseMatrix<double, Eigen::ColMajor>			_sparseReduced;
 			Eigen::VectorXd											_reducedRHS;
 
+			/* per task sums of the camera blocks, reduced after the parallel point loop */
+			struct CamAccumulator {
+				std::vector<CamJTJ, Eigen::aligned_allocator<CamJTJ> >						jtj;
+				std::vector<CamResidualType, Eigen::aligned_allocator<CamResidualType> >	residuals;
+				double																		costs;
+				double																		diagSum;
+			};
+			std::vector<CamAccumulator>								_camAccum;
+
+			SBAReducedSolver*										_solver;
+
 			// levenberg marquard damping
 			double _lambda;
 			size_t _iterations;
@@ -113,6 +130,8 @@ namespace cvt {
 
 		public:
 			void buildReducedCameraSystem( const SlamMap & map );
+			/* joint measurements and cam/point blocks, only needed in the first iteration */
+			void buildStructure( const SlamMap & map );
 			void evaluateApproxHessians( const SlamMap & map );
 			void fillSparseMatrix( const SlamMap & map );
 
@@ -0,0 +1,708 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/vision/TSDFVHCPU.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/gfx/IParallel.h>
+#include <cvt/util/ThreadPool.h>
+#include <cvt/util/SIMD.h>
+#include <cvt/util/Exception.h>
+
+#include <algorithm>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sched.h>
+
+namespace cvt
+{
+#include <cvt/vision/TSDFVH.inl>
+
+    static inline const Image& _withFormat( Image& tmp, const Image& src, const IFormat& format )
+    {
+        if( src.format() == format )
+            return src;
+        src.convert( tmp, format, IALLOCATOR_MEM );
+        return tmp;
+    }
+
+    /* bilinear sample of a RGBA_FLOAT image with clamp to edge */
+    static inline Vector3f _sampleRGB( const uint8_t* base, size_t stride, size_t width, size_t height, float x, float y )
+    {
+        size_t ix = ( size_t ) x;
+        size_t iy = ( size_t ) y;
+        float ax = x - ( float ) ix;
+        float ay = y - ( float ) iy;
+        size_t ix1 = Math::min( ix + 1, width - 1 );
+        size_t iy1 = Math::min( iy + 1, height - 1 );
+        const float* l0 = ( const float* ) ( base + stride * iy );
+        const float* l1 = ( const float* ) ( base + stride * iy1 );
+
+        Vector3f ret;
+        for( size_t c = 0; c < 3; c++ ) {
+            ret[ c ] = Math::mix( Math::mix( l0[ ix * 4 + c ], l0[ ix1 * 4 + c ], ax ),
+                                  Math::mix( l1[ ix * 4 + c ], l1[ ix1 * 4 + c ], ax ), ay );
+        }
+        return ret;
+    }
+
+    static inline void vertexColorInterp( Vector3f& vtx, const Vector3f& p1, const Vector3f& p2,
+                                          Vector3f& col, const Vector3f& col1, const Vector3f& col2,
+                                          float val1, float val2 )
+    {
+        const float ISO_EPSILON = 1e-8f;
+        float alpha;
+
+        if( Math::abs( val1 ) <  ISO_EPSILON )
+            alpha = 0.0f;
+        else if( Math::abs( val2 ) <  ISO_EPSILON )
+            alpha = 1.0f;
+        else if( Math::abs( val1 - val2 ) <  ISO_EPSILON )
+            alpha = 0.0f;
+        else
+            alpha = -val1 / ( val2 - val1 );
+
+        col.mix( col1, col2, alpha );
+        vtx.mix( p1, p2, alpha );
+    }
+
+    TSDFVHCPU::TSDFVHCPU( float truncation, float dmax, size_t maxblocks ) :
+        _trunc( truncation ),
+        _dmax( dmax ),
+        _maxblocks( maxblocks ),
+        _streamAge( 0 ),
+        _frame( 0 ),
+        _table( NULL ),
+        _tablemask( 0 ),
+        _chunks( NULL ),
+        _numchunks( ( maxblocks + CHUNKBLOCKS ) >> CHUNKSHIFT ),
+        _lastseen( NULL ),
+        _nextblock( 1 ),
+        _resident( 0 ),
+        _freetop( 0 ),
+        _exhausted( false ),
+        _streamfile( NULL ),
+        _streamend( 0 )
+    {
+        if( !maxblocks || maxblocks >= BLOCK_NONE )
+            throw CVTException( "Invalid number of blocks" );
+
+        /* keep the load factor of the table below 0.5 */
+        size_t tsize = 1;
+        while( tsize < 2 * maxblocks )
+            tsize <<= 1;
+        _table = new HashSlot[ tsize ];
+        _tablemask = tsize - 1;
+
+        _chunks = new std::atomic<Block*>[ _numchunks ];
+        for( size_t i = 0; i < _numchunks; i++ )
+            _chunks[ i ].store( NULL );
+
+        _lastseen = new uint32_t[ _maxblocks + 1 ];
+        clear();
+    }
+
+    TSDFVHCPU::~TSDFVHCPU()
+    {
+        for( size_t i = 0; i < _numchunks; i++ )
+            free( _chunks[ i ].load() );
+        delete[] _chunks;
+        delete[] _table;
+        delete[] _lastseen;
+        if( _streamfile )
+            fclose( _streamfile );
+    }
+
+    void TSDFVHCPU::clear()
+    {
+        for( size_t i = 0; i <= _tablemask; i++ ) {
+            _table[ i ].key.store( 0 );
+            _table[ i ].block.store( 0 );
+        }
+        for( size_t i = 0; i <= _maxblocks; i++ )
+            _lastseen[ i ] = 0;
+
+        _frame = 0;
+        _nextblock = 1;
+        _resident = 0;
+        _freeblocks.clear();
+        _freetop = 0;
+        _exhausted = false;
+
+        if( _streamfile ) {
+            fclose( _streamfile );
+            _streamfile = NULL;
+        }
+        _streamed.clear();
+        _streamfree.clear();
+        _streamedin.clear();
+        _streamfailed.clear();
+        _streamend = 0;
+    }
+
+    uint32_t TSDFVHCPU::find( uint64_t key ) const
+    {
+        size_t i = hash( key );
+        for( ;; ) {
+            uint64_t k = _table[ i ].key.load( std::memory_order_acquire );
+            if( k == key ) {
+                uint32_t idx;
+                /* the key is published before the block, wait for the inserting thread */
+                while( !( idx = _table[ i ].block.load( std::memory_order_acquire ) ) )
+                    sched_yield();
+                return idx == BLOCK_NONE ? 0 : idx;
+            }
+            if( !k )
+                return 0;
+            i = ( i + 1 ) & _tablemask;
+        }
+    }
+
+    uint32_t TSDFVHCPU::findOrAllocate( uint64_t key, uint32_t frame )
+    {
+        size_t i = hash( key );
+        for( size_t probes = 0; probes <= _tablemask; probes++ ) {
+            uint64_t k = _table[ i ].key.load( std::memory_order_acquire );
+            /* failed allocations occupy a slot until the end of the frame, stop inserting once the pool is exhausted */
+            if( !k && _exhausted.load( std::memory_order_relaxed ) )
+                return 0;
+            if( !k && _table[ i ].key.compare_exchange_strong( k, key, std::memory_order_acq_rel ) ) {
+                /* we own the slot */
+                uint32_t idx = allocate( key, frame );
+                _table[ i ].block.store( idx, std::memory_order_release );
+                return idx == BLOCK_NONE ? 0 : idx;
+            }
+            if( k == key ) {
+                uint32_t idx;
+                while( !( idx = _table[ i ].block.load( std::memory_order_acquire ) ) )
+                    sched_yield();
+                return idx == BLOCK_NONE ? 0 : idx;
+            }
+            i = ( i + 1 ) & _tablemask;
+        }
+        _exhausted = true;
+        return 0;
+    }
+
+    uint32_t TSDFVHCPU::allocate( uint64_t key, uint32_t frame )
+    {
+        uint32_t idx;
+
+        /* the free list is only modified between the parallel phases */
+        ssize_t top = _freetop.fetch_sub( 1 );
+        if( top > 0 ) {
+            idx = _freeblocks[ top - 1 ];
+        } else {
+            idx = _nextblock.fetch_add( 1 );
+            if( idx > _maxblocks ) {
+                _exhausted = true;
+                return BLOCK_NONE;
+            }
+
+            size_t c = idx >> CHUNKSHIFT;
+            if( !_chunks[ c ].load( std::memory_order_acquire ) ) {
+                _chunkmutex.lock();
+                if( !_chunks[ c ].load( std::memory_order_acquire ) )
+                    _chunks[ c ].store( ( Block* ) malloc( sizeof( Block ) * CHUNKBLOCKS ), std::memory_order_release );
+                _chunkmutex.unlock();
+                if( !_chunks[ c ].load( std::memory_order_acquire ) ) {
+                    _exhausted = true;
+                    return BLOCK_NONE;
+                }
+            }
+        }
+
+        Block* b = block( idx );
+        StreamIndex::const_iterator it = _streamfile ? _streamed.find( key ) : _streamed.end();
+        if( it != _streamed.end() ) {
+            /* a block that can not be read back stays streamed out, its slot is marked as failed and
+               the block is returned to the free list after the allocation phase */
+            bool restored = pread( fileno( _streamfile ), b, sizeof( Block ), it->second ) == ( ssize_t ) sizeof( Block );
+            _streammutex.lock();
+            if( restored )
+                _streamedin.push_back( key );
+            else
+                _streamfailed.push_back( idx );
+            _streammutex.unlock();
+            if( !restored )
+                return BLOCK_NONE;
+        } else {
+            keyToBlock( b->vposi, key );
+            for( size_t i = 0; i < BLOCKVOXELS; i++ ) {
+                b->v[ i ].gumm.init( 1.0f, 1.0f, 0.8f, 1.0f );
+                b->v[ i ].weight = 0;
+                b->v[ i ].red = b->v[ i ].green = b->v[ i ].blue = 0;
+            }
+        }
+
+        _lastseen[ idx ] = frame;
+        _resident++;
+        return idx;
+    }
+
+    void TSDFVHCPU::remove( size_t slot )
+    {
+        /* backward shift deletion, only called between the parallel phases */
+        size_t i = slot;
+        size_t j = slot;
+        for( ;; ) {
+            j = ( j + 1 ) & _tablemask;
+            uint64_t k = _table[ j ].key.load( std::memory_order_relaxed );
+            if( !k )
+                break;
+            size_t h = hash( k );
+            /* the entry stays if its home slot is cyclically in ( i, j ] */
+            bool stays = i <= j ? ( i < h && h <= j ) : ( i < h || h <= j );
+            if( stays )
+                continue;
+            _table[ i ].key.store( k, std::memory_order_relaxed );
+            _table[ i ].block.store( _table[ j ].block.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+            i = j;
+        }
+        _table[ i ].key.store( 0, std::memory_order_relaxed );
+        _table[ i ].block.store( 0, std::memory_order_relaxed );
+    }
+
+    void TSDFVHCPU::purgeFailed()
+    {
+        for( size_t i = 0; i <= _tablemask; i++ ) {
+            while( _table[ i ].key.load() && _table[ i ].block.load() == BLOCK_NONE )
+                remove( i );
+        }
+    }
+
+    void TSDFVHCPU::add( const Matrix4f& KRT, const Image& depthmap, const Image& rgb )
+    {
+        Image dtmp, ctmp;
+        const Image& dmap = _withFormat( dtmp, depthmap, IFormat::GRAY_FLOAT );
+        bool color = rgb.width() == depthmap.width() && rgb.height() == depthmap.height();
+        const Image& cmap = color ? _withFormat( ctmp, rgb, IFormat::RGBA_FLOAT ) : rgb;
+
+        _frame++;
+
+        allocateBlocks( KRT.inverse(), dmap, _frame );
+
+        /* restore the state of the allocators */
+        ssize_t top = Math::max<ssize_t>( _freetop.load(), 0 );
+        _freeblocks.resize( top );
+        _freetop = top;
+        if( _nextblock.load() > _maxblocks + 1 )
+            _nextblock = _maxblocks + 1;
+        bool readfailed = !_streamfailed.empty();
+        _freeblocks.insert( _freeblocks.end(), _streamfailed.begin(), _streamfailed.end() );
+        _freetop = _freeblocks.size();
+        _streamfailed.clear();
+
+        /* release the file slots of the streamed in blocks */
+        for( size_t i = 0; i < _streamedin.size(); i++ ) {
+            StreamIndex::iterator it = _streamed.find( _streamedin[ i ] );
+            _streamfree.push_back( it->second );
+            _streamed.erase( it );
+        }
+        _streamedin.clear();
+
+        integrateBlocks( KRT, dmap, cmap, _frame );
+
+        bool exhausted = _exhausted;
+        if( exhausted || readfailed ) {
+            purgeFailed();
+            _exhausted = false;
+        }
+
+        if( _streamAge )
+            streamOut( _streamAge );
+
+        if( exhausted )
+            throw CVTException( "No free blocks left, increase the number of blocks or enable streaming" );
+    }
+
+    void TSDFVHCPU::allocateBlocks( const Matrix4f& KRTinv, const Image& depthmap, uint32_t frame )
+    {
+        IMapScoped<const float> map( depthmap );
+        const uint8_t* base = ( const uint8_t* ) map.base();
+        const size_t stride = map.stride();
+        const size_t width  = depthmap.width();
+        const Vector3f origin = KRTinv * Vector3f( 0.0f, 0.0f, 0.0f );
+        /* sample the truncation band along the ray at half the block size */
+        const int nsteps = Math::max( 1, ( int ) Math::ceil( _trunc / ( 0.5f * BLOCKSIZE ) ) );
+        const float step = _trunc / ( float ) nsteps;
+        const float invbs = 1.0f / ( float ) BLOCKSIZE;
+
+        parallelForRows( depthmap, [&]( size_t ystart, size_t yend ) {
+            uint64_t prev = 0;
+            for( size_t y = ystart; y < yend; y++ ) {
+                const float* line = ( const float* ) ( base + stride * y );
+                for( size_t x = 0; x < width; x++ ) {
+                    float d = line[ x ];
+                    if( !( d > 0.0f && d < _dmax ) )
+                        continue;
+
+                    Vector3f pt = KRTinv * Vector3f( d * ( float ) x, d * ( float ) y, d );
+                    Vector3f dir = pt - origin;
+                    dir.normalize();
+
+                    for( int s = -nsteps; s <= nsteps; s++ ) {
+                        Vector3f p = pt + dir * ( step * ( float ) s );
+                        uint64_t k = key( ( int ) Math::floor( p.x * invbs ),
+                                          ( int ) Math::floor( p.y * invbs ),
+                                          ( int ) Math::floor( p.z * invbs ) );
+                        /* neighbouring samples mostly hit the same block */
+                        if( k == prev )
+                            continue;
+                        prev = k;
+                        findOrAllocate( k, frame );
+                    }
+                }
+            }
+        }, 4 );
+    }
+
+    void TSDFVHCPU::integrateBlocks( const Matrix4f& KRT, const Image& depthmap, const Image& rgb, uint32_t frame )
+    {
+        IMapScoped<const float> map( depthmap );
+        const uint8_t* dbase = ( const uint8_t* ) map.base();
+        const size_t dstride = map.stride();
+        const uint8_t* cbase = NULL;
+        size_t cstride = 0;
+        bool color = rgb.width() == depthmap.width() && rgb.height() == depthmap.height();
+        if( color )
+            cbase = rgb.map( &cstride );
+
+        const int iwidth   = ( int ) depthmap.width();
+        const int iheight  = ( int ) depthmap.height();
+        const float fwidth  = ( float ) iwidth;
+        const float fheight = ( float ) iheight;
+        const size_t nblocks = Math::min<size_t>( _nextblock.load(), _maxblocks + 1 );
+        SIMD* simd = SIMD::instance();
+
+        /* voxel positions inside a block relative to the block origin */
+        Vector3f local[ BLOCKVOXELS ];
+        for( size_t z = 0, i = 0; z < BLOCKSIZE; z++ )
+            for( size_t y = 0; y < BLOCKSIZE; y++ )
+                for( size_t x = 0; x < BLOCKSIZE; x++, i++ )
+                    local[ i ].set( x, y, z );
+
+        ThreadPool::instance().parallelFor( 1, nblocks, 64, [&]( size_t start, size_t end ) {
+            Vector3f cam[ BLOCKVOXELS ];
+            Matrix4f bproj( KRT );
+
+            for( size_t idx = start; idx < end; idx++ ) {
+                if( !_lastseen[ idx ] )
+                    continue;
+
+                Block* b = block( idx );
+                Vector3f origin( BLOCKSIZE * b->vposi.x, BLOCKSIZE * b->vposi.y, BLOCKSIZE * b->vposi.z );
+
+                /* cull blocks behind the camera, outside of the image or behind the measured surface */
+                bool behind = true, partial = false;
+                float xmin = fwidth, xmax = -1.0f, ymin = fheight, ymax = -1.0f, zmin = _dmax;
+                for( size_t c = 0; c < 8; c++ ) {
+                    Vector3f corner( origin.x + ( c & 1 ? BLOCKSIZE : 0 ),
+                                     origin.y + ( c & 2 ? BLOCKSIZE : 0 ),
+                                     origin.z + ( c & 4 ? BLOCKSIZE : 0 ) );
+                    Vector3f pc = KRT * corner;
+                    if( pc.z <= 0.0f ) {
+                        partial = true;
+                        continue;
+                    }
+                    behind = false;
+                    xmin = Math::min( xmin, pc.x / pc.z );
+                    xmax = Math::max( xmax, pc.x / pc.z );
+                    ymin = Math::min( ymin, pc.y / pc.z );
+                    ymax = Math::max( ymax, pc.y / pc.z );
+                    zmin = Math::min( zmin, pc.z );
+                }
+                if( behind || zmin >= _dmax + _trunc )
+                    continue;
+                if( !partial ) {
+                    if( xmax < 0.0f || ymax < 0.0f || xmin >= fwidth || ymin >= fheight )
+                        continue;
+                    /* the block is occluded only if it lies behind the farthest depth of its whole footprint,
+                       a single sample misses the surface at depth discontinuities. Large footprints are
+                       not worth the scan, the voxel loop below rejects the same voxels anyway */
+                    int fx0 = Math::clamp( ( int ) xmin, 0, iwidth - 1 );
+                    int fx1 = Math::clamp( ( int ) xmax + 1, 0, iwidth - 1 );
+                    int fy0 = Math::clamp( ( int ) ymin, 0, iheight - 1 );
+                    int fy1 = Math::clamp( ( int ) ymax + 1, 0, iheight - 1 );
+                    if( ( fx1 - fx0 + 1 ) * ( fy1 - fy0 + 1 ) <= ( int ) BLOCKVOXELS ) {
+                        float dfar = 0.0f;
+                        for( int fy = fy0; fy <= fy1; fy++ ) {
+                            const float* line = ( const float* ) ( dbase + dstride * fy );
+                            for( int fx = fx0; fx <= fx1; fx++ ) {
+                                if( line[ fx ] > 0.0f && line[ fx ] < _dmax )
+                                    dfar = Math::max( dfar, line[ fx ] );
+                            }
+                        }
+                        if( zmin > dfar + _trunc )
+                            continue;
+                    }
+                }
+
+                for( size_t r = 0; r < 3; r++ )
+                    bproj[ r ][ 3 ] = KRT[ r ][ 0 ] * origin.x + KRT[ r ][ 1 ] * origin.y + KRT[ r ][ 2 ] * origin.z + KRT[ r ][ 3 ];
+                simd->transformPoints( cam, bproj, local, BLOCKVOXELS );
+
+                bool updated = false;
+                for( size_t i = 0; i < BLOCKVOXELS; i++ ) {
+                    const Vector3f& pc = cam[ i ];
+                    if( pc.z <= 0.0f )
+                        continue;
+                    float ix = pc.x / pc.z;
+                    float iy = pc.y / pc.z;
+                    if( !( ix >= 0.0f && iy >= 0.0f && ix < fwidth && iy < fheight ) )
+                        continue;
+
+                    int dx = Math::min( ( int ) ( ix + 0.5f ), iwidth - 1 );
+                    int dy = Math::min( ( int ) ( iy + 0.5f ), iheight - 1 );
+                    float d = ( ( const float* ) ( dbase + dstride * dy ) )[ dx ];
+                    if( !( d > 0.0f && d < _dmax ) )
+                        continue;
+
+                    float sdf = d - pc.z;
+                    if( sdf < -_trunc )
+                        continue;
+                    float tsdf = Math::clamp( sdf / _trunc, -1.0f, 1.0f );
+
+                    Voxel& v = b->v[ i ];
+                    float wn = Math::exp( Math::sqr( 1.0f - d / _dmax ) * 3.0f );
+                    float weight = v.gumm.update( tsdf, wn, 0.5f );
+                    if( color ) {
+                        Vector3f rgbnew = _sampleRGB( cbase, cstride, iwidth, iheight, ix, iy );
+                        Vector3f rgbold( v.red, v.green, v.blue );
+                        rgbold *= 1.0f / 255.0f;
+                        Vector3f rgbn = ( rgbold * ( v.gumm.accumg - weight ) + rgbnew * weight ) * ( 255.0f / v.gumm.accumg );
+                        v.red   = ( cl_uchar ) Math::clamp( rgbn.x + 0.5f, 0.0f, 255.0f );
+                        v.green = ( cl_uchar ) Math::clamp( rgbn.y + 0.5f, 0.0f, 255.0f );
+                        v.blue  = ( cl_uchar ) Math::clamp( rgbn.z + 0.5f, 0.0f, 255.0f );
+                    }
+                    if( v.weight < 255 )
+                        v.weight++;
+                    updated = true;
+                }
+
+                if( updated )
+                    _lastseen[ idx ] = frame;
+            }
+        } );
+
+        if( color )
+            rgb.unmap( cbase );
+    }
+
+    size_t TSDFVHCPU::streamOut( size_t age )
+    {
+        size_t n = 0;
+
+        for( size_t i = 0; i <= _tablemask; i++ ) {
+            /* remove shifts the following entries into slot i */
+            uint64_t k;
+            while( ( k = _table[ i ].key.load() ) != 0 ) {
+                uint32_t idx = _table[ i ].block.load();
+                if( _frame - _lastseen[ idx ] <= age )
+                    break;
+
+                if( !_streamfile ) {
+                    _streamfile = tmpfile();
+                    if( !_streamfile )
+                        throw CVTException( "Could not create block stream file" );
+                }
+
+                off_t offset;
+                if( !_streamfree.empty() ) {
+                    offset = _streamfree.back();
+                    _streamfree.pop_back();
+                } else {
+                    offset = _streamend;
+                    _streamend += sizeof( Block );
+                }
+                if( pwrite( fileno( _streamfile ), block( idx ), sizeof( Block ), offset ) != ( ssize_t ) sizeof( Block ) )
+                    throw CVTException( "Could not stream out block" );
+
+                _streamed[ k ] = offset;
+                remove( i );
+                _lastseen[ idx ] = 0;
+                _freeblocks.push_back( idx );
+                _resident--;
+                n++;
+            }
+        }
+        _freetop = _freeblocks.size();
+        return n;
+    }
+
+    const TSDFVHCPU::Block* TSDFVHCPU::fetch( uint64_t key, Block& tmp ) const
+    {
+        uint32_t idx = find( key );
+        if( idx )
+            return block( idx );
+        if( _streamfile ) {
+            StreamIndex::const_iterator it = _streamed.find( key );
+            if( it != _streamed.end() &&
+                pread( fileno( _streamfile ), &tmp, sizeof( Block ), it->second ) == ( ssize_t ) sizeof( Block ) )
+                return &tmp;
+        }
+        return NULL;
+    }
+
+    float TSDFVHCPU::distance( const Vector3f& pos ) const
+    {
+        int x = ( int ) Math::floor( pos.x );
+        int y = ( int ) Math::floor( pos.y );
+        int z = ( int ) Math::floor( pos.z );
+
+        Block tmp;
+        const Block* b = fetch( key( x >> 3, y >> 3, z >> 3 ), tmp );
+        if( !b )
+            return 1.0f;
+        const Voxel& v = b->v[ ( ( z & 0x7 ) * 8 + ( y & 0x7 ) ) * 8 + ( x & 0x7 ) ];
+        return v.weight ? v.gumm.mu : 1.0f;
+    }
+
+    void TSDFVHCPU::toSceneMesh( SceneMesh& mesh ) const
+    {
+        struct MeshPart {
+            std::vector<Vector3f> vertices;
+            std::vector<Vector3f> colors;
+        };
+
+        std::vector<uint64_t> keys;
+        keys.reserve( blocksUsed() + blocksStreamed() );
+        for( size_t i = 0; i <= _tablemask; i++ ) {
+            uint64_t k = _table[ i ].key.load();
+            if( k && _table[ i ].block.load() != BLOCK_NONE )
+                keys.push_back( k );
+        }
+        for( StreamIndex::const_iterator it = _streamed.begin(); it != _streamed.end(); ++it )
+            keys.push_back( it->first );
+        std::sort( keys.begin(), keys.end() );
+
+        std::map<size_t, MeshPart> parts;
+        Mutex partsmutex;
+
+        ThreadPool::instance().parallelFor( 0, keys.size(), 16, [&]( size_t start, size_t end ) {
+            std::vector<Block> tmp( 8 );
+            const Block* nb[ 2 ][ 2 ][ 2 ];
+            float    gridval[ 8 ];
+            Vector3f gridvtx[ 8 ];
+            Vector3f gridcol[ 8 ];
+            Vector3f vertlist[ 12 ];
+            Vector3f collist[ 12 ];
+            MeshPart part;
+
+            for( size_t n = start; n < end; n++ ) {
+                cl_int3 vposi;
+                keyToBlock( vposi, keys[ n ] );
+
+                for( int z = 0; z <= 1; z++ )
+                    for( int y = 0; y <= 1; y++ )
+                        for( int x = 0; x <= 1; x++ )
+                            nb[ z ][ y ][ x ] = fetch( key( vposi.x + x, vposi.y + y, vposi.z + z ), tmp[ ( z * 2 + y ) * 2 + x ] );
+
+                Vector3f base_pos( BLOCKSIZE * vposi.x, BLOCKSIZE * vposi.y, BLOCKSIZE * vposi.z );
+
+                for( int z = 0; z < BLOCKSIZE; z++  ) {
+                    for( int y = 0; y < BLOCKSIZE; y++ ) {
+                        for( int x = 0; x < BLOCKSIZE; x++ ) {
+
+#define VOXEL( a, b, c ) ( nb[ ( c ) >> 3 ][ ( b ) >> 3 ][ ( a ) >> 3 ]->v[ ( ( ( c ) & 0x7 ) * 8 + ( ( b ) & 0x7 ) ) * 8 + ( ( a ) & 0x7 ) ] )
+                            /* skip cells touching missing blocks or unobserved voxels */
+                            const Voxel* cell[ 8 ];
+                            bool valid = true;
+                            for( int c = 0; c < 8 && valid; c++ ) {
+                                int cx = x + ( ( c & 1 ) ^ ( ( c >> 1 ) & 1 ) );
+                                int cy = y + ( ( c >> 1 ) & 1 );
+                                int cz = z + ( ( c >> 2 ) & 1 );
+                                if( !nb[ cz >> 3 ][ cy >> 3 ][ cx >> 3 ] ) {
+                                    valid = false;
+                                    break;
+                                }
+                                cell[ c ] = &VOXEL( cx, cy, cz );
+                                valid = cell[ c ]->weight != 0;
+                            }
+#undef VOXEL
+                            if( !valid )
+                                continue;
+
+                            int cubeindex = 0;
+                            for( int c = 0; c < 8; c++ ) {
+                                gridval[ c ] = cell[ c ]->gumm.mu;
+                                if( gridval[ c ] < 0.0f )
+                                    cubeindex |= 1 << c;
+                            }
+
+                            /* Cube is entirely in/out of the surface */
+                            if( _edgeTable[ cubeindex ] == 0 )
+                                continue;
+
+                            Vector3f vpos = base_pos + Vector3f( x, y, z );
+                            for( int c = 0; c < 8; c++ ) {
+                                gridvtx[ c ] = vpos + Vector3f( ( c & 1 ) ^ ( ( c >> 1 ) & 1 ), ( c >> 1 ) & 1, ( c >> 2 ) & 1 );
+                                gridcol[ c ] = Vector3f( cell[ c ]->red, cell[ c ]->green, cell[ c ]->blue ) * ( 1.0f / 255.0f );
+                            }
+
+                            /* Find the vertices where the surface intersects the cube */
+                            static const int edges[ 12 ][ 2 ] = { { 0, 1 }, { 1, 2 }, { 2, 3 }, { 3, 0 },
+                                                                  { 4, 5 }, { 5, 6 }, { 6, 7 }, { 7, 4 },
+                                                                  { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 } };
+                            for( int e = 0; e < 12; e++ ) {
+                                if( _edgeTable[ cubeindex ] & ( 1 << e ) )
+                                    vertexColorInterp( vertlist[ e ], gridvtx[ edges[ e ][ 0 ] ], gridvtx[ edges[ e ][ 1 ] ],
+                                                       collist[ e ], gridcol[ edges[ e ][ 0 ] ], gridcol[ edges[ e ][ 1 ] ],
+                                                       gridval[ edges[ e ][ 0 ] ], gridval[ edges[ e ][ 1 ] ] );
+                            }
+
+                            /* Create the triangles */
+                            for( int i = 0; _triTable[ cubeindex ][ i ] != -1; i++ ) {
+                                part.vertices.push_back( vertlist[ _triTable[ cubeindex ][ i ] ] );
+                                part.colors.push_back( collist[ _triTable[ cubeindex ][ i ] ] );
+                            }
+                        }
+                    }
+                }
+            }
+
+            partsmutex.lock();
+            parts[ start ].vertices.swap( part.vertices );
+            parts[ start ].colors.swap( part.colors );
+            partsmutex.unlock();
+        } );
+
+        std::vector<Vector3f> vertices;
+        std::vector<Vector3f> colors;
+        for( std::map<size_t, MeshPart>::iterator it = parts.begin(); it != parts.end(); ++it ) {
+            vertices.insert( vertices.end(), it->second.vertices.begin(), it->second.vertices.end() );
+            colors.insert( colors.end(), it->second.colors.begin(), it->second.colors.end() );
+        }
+
+        std::vector<unsigned int> faces( vertices.size() );
+        for( size_t i = 0; i < faces.size(); i++ )
+            faces[ i ] = i;
+
+        mesh.clear();
+        if( vertices.empty() )
+            return;
+        mesh.setVertices( &vertices[ 0 ], vertices.size() );
+        mesh.setColors( &colors[ 0 ], colors.size() );
+        mesh.setFaces( &faces[ 0 ], faces.size(), SCENEMESH_TRIANGLES );
+    }
+}
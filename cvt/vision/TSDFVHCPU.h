@@ -0,0 +1,226 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_TSDFVHCPU_H
+#define CVT_TSDFVHCPU_H
+
+#include <cvt/math/Math.h>
+#include <cvt/math/Matrix.h>
+#include <cvt/cl/OpenCL.h>
+#include <cvt/cl/CLGUMM.h>
+#include <cvt/gfx/Image.h>
+#include <cvt/util/Mutex.h>
+#include <cvt/geom/scene/SceneMesh.h>
+
+#include <atomic>
+#include <map>
+#include <vector>
+#include <stdio.h>
+
+namespace cvt
+{
+    /**
+      @brief CPU implementation of the TSDFVH voxel hashing volume
+
+      The volume uses the same 8x8x8 Block and Voxel layout as TSDFVH with a resolution of 1 mm per voxel.
+      Blocks are addressed by a lock-free open-addressing hash table with linear probing, allocation of the
+      blocks around the measured surface and the fusion of the blocks inside the view frustum are processed
+      in parallel for every depth map.
+
+      Blocks that were not visible for a given number of frames can be streamed out to a temporary file
+      and are streamed in again as soon as they are allocated by a later depth map.
+     */
+    class TSDFVHCPU
+    {
+        public:
+            /**
+              @param truncation truncation distance in mm
+              @param dmax       depth values above dmax are ignored
+              @param maxblocks  maximal number of blocks resident in memory
+             */
+            TSDFVHCPU( float truncation = 24.0f, float dmax = 5000.0f, size_t maxblocks = ( 1 << 18 ) );
+            ~TSDFVHCPU();
+
+            void clear();
+
+            /**
+              @brief Fuse the depth map in mm
+              @param KRT projection from world to image coordinates
+              @param rgb color image, ignored if its size differs from the depth map
+             */
+            void add( const Matrix4f& KRT, const Image& depthmap, const Image& rgb );
+            void toSceneMesh( SceneMesh& mesh ) const;
+
+            float truncation() const { return _trunc; }
+
+            /**
+              @brief Mean of the voxel containing pos or 1 if the voxel was never observed
+             */
+            float distance( const Vector3f& pos ) const;
+
+            size_t blocksUsed() const;
+            size_t blocksUsedSize() const;
+            size_t blocksStreamed() const;
+            size_t hashtableSize() const;
+
+            /**
+              @brief Stream out blocks not visible for more than frames depth maps after every add, 0 disables streaming
+             */
+            void   setStreamingAge( size_t frames ) { _streamAge = frames; }
+            size_t streamingAge() const { return _streamAge; }
+
+            /**
+              @brief Stream out all blocks not visible for more than age depth maps
+              @return the number of streamed out blocks
+             */
+            size_t streamOut( size_t age );
+
+        private:
+            TSDFVHCPU( const TSDFVHCPU& );
+            TSDFVHCPU& operator=( const TSDFVHCPU& );
+
+            enum {
+                BLOCKSIZE    = 8,
+                BLOCKVOXELS  = BLOCKSIZE * BLOCKSIZE * BLOCKSIZE,
+                CHUNKSHIFT   = 8,
+                CHUNKBLOCKS  = 1 << CHUNKSHIFT
+            };
+
+            static const uint32_t BLOCK_NONE = 0xffffffff;
+
+            typedef struct {
+                CLGUMM    gumm;
+                cl_uchar  weight;
+                cl_uchar  red, green, blue;
+            } Voxel;
+
+            typedef struct {
+                cl_int3 vposi;
+                Voxel v[ BLOCKVOXELS ];
+            } Block;
+
+            struct HashSlot {
+                std::atomic<uint64_t> key;
+                std::atomic<uint32_t> block;
+            };
+
+            typedef std::map<uint64_t, off_t> StreamIndex;
+
+            static uint64_t key( int x, int y, int z );
+            static void     keyToBlock( cl_int3& vposi, uint64_t key );
+            size_t          hash( uint64_t key ) const;
+
+            Block*   block( uint32_t idx ) const;
+            uint32_t find( uint64_t key ) const;
+            uint32_t findOrAllocate( uint64_t key, uint32_t frame );
+            uint32_t allocate( uint64_t key, uint32_t frame );
+            void     remove( size_t slot );
+            void     purgeFailed();
+            void     allocateBlocks( const Matrix4f& KRTinv, const Image& depthmap, uint32_t frame );
+            void     integrateBlocks( const Matrix4f& KRT, const Image& depthmap, const Image& rgb, uint32_t frame );
+            const Block* fetch( uint64_t key, Block& tmp ) const;
+
+            float                   _trunc;
+            float                   _dmax;
+            size_t                  _maxblocks;
+            size_t                  _streamAge;
+            uint32_t                _frame;
+
+            HashSlot*               _table;
+            size_t                  _tablemask;
+
+            std::atomic<Block*>*    _chunks;
+            size_t                  _numchunks;
+            Mutex                   _chunkmutex;
+            uint32_t*               _lastseen;
+            std::atomic<uint32_t>   _nextblock;
+            std::atomic<size_t>     _resident;
+            std::vector<uint32_t>   _freeblocks;
+            std::atomic<ssize_t>    _freetop;
+            std::atomic<bool>       _exhausted;
+
+            FILE*                   _streamfile;
+            StreamIndex             _streamed;
+            std::vector<off_t>      _streamfree;
+            off_t                   _streamend;
+            std::vector<uint64_t>   _streamedin;
+            std::vector<uint32_t>   _streamfailed;
+            Mutex                   _streammutex;
+    };
+
+    inline uint64_t TSDFVHCPU::key( int x, int y, int z )
+    {
+        /* 21 bits per coordinate, the top bit marks a used key */
+        return ( ( uint64_t ) 1 << 63 ) |
+               ( ( ( uint64_t ) ( x + ( 1 << 20 ) ) & 0x1fffff ) << 42 ) |
+               ( ( ( uint64_t ) ( y + ( 1 << 20 ) ) & 0x1fffff ) << 21 ) |
+                 ( ( uint64_t ) ( z + ( 1 << 20 ) ) & 0x1fffff );
+    }
+
+    inline void TSDFVHCPU::keyToBlock( cl_int3& vposi, uint64_t key )
+    {
+        vposi.x = ( int ) ( ( key >> 42 ) & 0x1fffff ) - ( 1 << 20 );
+        vposi.y = ( int ) ( ( key >> 21 ) & 0x1fffff ) - ( 1 << 20 );
+        vposi.z = ( int ) (   key         & 0x1fffff ) - ( 1 << 20 );
+    }
+
+    inline size_t TSDFVHCPU::hash( uint64_t key ) const
+    {
+        // See Teschner et al. and Nießner et al.
+        const uint32_t p0 = 73856093;
+        const uint32_t p1 = 19349669;
+        const uint32_t p2 = 83492791;
+        uint32_t hash = ( ( uint32_t ) ( ( key >> 42 ) & 0x1fffff ) * p0 ) ^
+                        ( ( uint32_t ) ( ( key >> 21 ) & 0x1fffff ) * p1 ) ^
+                        ( ( uint32_t ) (   key         & 0x1fffff ) * p2 );
+        return hash & _tablemask;
+    }
+
+    inline TSDFVHCPU::Block* TSDFVHCPU::block( uint32_t idx ) const
+    {
+        return _chunks[ idx >> CHUNKSHIFT ].load( std::memory_order_acquire ) + ( idx & ( CHUNKBLOCKS - 1 ) );
+    }
+
+    inline size_t TSDFVHCPU::blocksUsed() const
+    {
+        return _resident.load();
+    }
+
+    inline size_t TSDFVHCPU::blocksUsedSize() const
+    {
+        return blocksUsed() * sizeof( Block );
+    }
+
+    inline size_t TSDFVHCPU::blocksStreamed() const
+    {
+        return _streamed.size();
+    }
+
+    inline size_t TSDFVHCPU::hashtableSize() const
+    {
+        return ( _tablemask + 1 ) * sizeof( HashSlot );
+    }
+}
+
+#endif
@@ -0,0 +1,111 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/vision/TSDFVHCPU.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/util/CVTTest.h>
+
+using namespace cvt;
+
+BEGIN_CVTTEST( TSDFVHCPU )
+    bool result = true;
+    bool b;
+
+    /* fronto-parallel plane at 200 mm seen by a camera at the origin */
+    Matrix3f K( 100.0f,   0.0f, 32.0f,
+                  0.0f, 100.0f, 24.0f,
+                  0.0f,   0.0f,  1.0f );
+    Matrix4f KRT = K.toMatrix4();
+
+    Image depth( 64, 48, IFormat::GRAY_FLOAT );
+    depth.fill( Color( 200.0f ) );
+    Image rgb( 64, 48, IFormat::RGBA_FLOAT );
+    rgb.fill( Color( 1.0f, 0.0f, 0.0f, 1.0f ) );
+
+    TSDFVHCPU volume( 24.0f, 5000.0f, 4096 );
+    volume.add( KRT, depth, rgb );
+    volume.add( KRT, depth, rgb );
+
+    b = volume.blocksUsed() > 0 &&
+        volume.distance( Vector3f( 0.0f, 0.0f, 190.0f ) ) > 0.0f &&
+        volume.distance( Vector3f( 0.0f, 0.0f, 210.0f ) ) < 0.0f &&
+        volume.distance( Vector3f( 0.0f, 0.0f, 100.0f ) ) == 1.0f;
+    CVTTEST_PRINT( "add", b );
+    result &= b;
+
+    SceneMesh mesh( "tsdfvh" );
+    volume.toSceneMesh( mesh );
+    size_t nvertices = mesh.vertexSize();
+    b = nvertices > 0;
+    for( size_t i = 0; b && i < nvertices; i++ )
+        b &= Math::abs( mesh.vertices()[ i ].z - 200.0f ) < 2.0f;
+    CVTTEST_PRINT( "toSceneMesh", b );
+    result &= b;
+
+    /* an empty depth map does not observe any block */
+    size_t nblocks = volume.blocksUsed();
+    float dist = volume.distance( Vector3f( 0.0f, 0.0f, 190.0f ) );
+    depth.fill( Color( 0.0f ) );
+    volume.add( KRT, depth, rgb );
+    b = volume.streamOut( 0 ) == nblocks &&
+        volume.blocksUsed() == 0 &&
+        volume.blocksStreamed() == nblocks &&
+        volume.distance( Vector3f( 0.0f, 0.0f, 190.0f ) ) == dist;
+    volume.toSceneMesh( mesh );
+    b &= mesh.vertexSize() == nvertices;
+    CVTTEST_PRINT( "streamOut", b );
+    result &= b;
+
+    depth.fill( Color( 200.0f ) );
+    volume.add( KRT, depth, rgb );
+    b = volume.blocksUsed() == nblocks && volume.blocksStreamed() == 0;
+    CVTTEST_PRINT( "stream in", b );
+    result &= b;
+
+    /* a foreground patch covering the center of the block spanning [0,8)x[0,8)x[200,208),
+       the remaining footprint of the block still observes the surface */
+    {
+        TSDFVHCPU edge( 24.0f, 5000.0f, 4096 );
+        depth.fill( Color( 200.0f ) );
+        edge.add( KRT, depth, rgb );
+        float before = edge.distance( Vector3f( 1.0f, 1.0f, 205.0f ) );
+
+        depth.fill( Color( 210.0f ) );
+        {
+            IMapScoped<float> map( depth );
+            for( size_t y = 25; y <= 27; y++ ) {
+                float* line = map.line( y );
+                for( size_t x = 33; x <= 35; x++ )
+                    line[ x ] = 100.0f;
+            }
+        }
+        for( size_t i = 0; i < 4; i++ )
+            edge.add( KRT, depth, rgb );
+        b = before < 0.0f && edge.distance( Vector3f( 1.0f, 1.0f, 205.0f ) ) > before;
+        CVTTEST_PRINT( "depth discontinuity", b );
+        result &= b;
+    }
+
+    return result;
+END_CVTTEST
@@ -0,0 +1,657 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+#include <cvt/vision/TSDFVolumeCPU.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/gfx/IParallel.h>
+#include <cvt/util/ThreadPool.h>
+#include <cvt/util/SIMD.h>
+#include <cvt/util/Exception.h>
+
+#include <algorithm>
+#include <limits>
+#include <stdlib.h>
+#include <stdio.h>
+
+namespace cvt
+{
+    static const size_t RAYCAST_TILE = 16;
+
+    static inline bool _isFinite( float v )
+    {
+        return Math::abs( v ) <= std::numeric_limits<float>::max();
+    }
+
+    /* bilinear sample of a GRAY_FLOAT image at ( x, y ) with 0 <= x < width and 0 <= y < height, taps outside
+       are clamped to the edge. The OpenCL kernels sample with CLK_ADDRESS_CLAMP and read zero there instead. */
+    static inline float _sampleBilinear( const uint8_t* base, size_t stride, size_t width, size_t height, float x, float y )
+    {
+        size_t ix = ( size_t ) x;
+        size_t iy = ( size_t ) y;
+        float ax = x - ( float ) ix;
+        float ay = y - ( float ) iy;
+        size_t ix1 = ix + 1 < width ? ix + 1 : ix;
+        const float* line0 = ( const float* ) ( base + stride * iy );
+        const float* line1 = iy + 1 < height ? ( const float* ) ( base + stride * ( iy + 1 ) ) : line0;
+
+        return Math::mix( Math::mix( line0[ ix ], line0[ ix1 ], ax ), Math::mix( line1[ ix ], line1[ ix1 ], ax ), ay );
+    }
+
+    static inline const Image& _withFormat( Image& tmp, const Image& src, const IFormat& format )
+    {
+        if( src.format() == format )
+            return src;
+        src.convert( tmp, format, IALLOCATOR_MEM );
+        return tmp;
+    }
+
+    TSDFVolumeCPU::TSDFVolumeCPU( const Matrix4f& gridtoworld, size_t width, size_t height, size_t depth, float truncation ) :
+        _volume( NULL ),
+        _width( width ),
+        _height( height ),
+        _depth( depth ),
+        _trunc( truncation ),
+        _g2w( gridtoworld )
+    {
+        allocate();
+    }
+
+    TSDFVolumeCPU::TSDFVolumeCPU( const Vector3f& boxpt1, const Vector3f& boxpt2, float resolution, size_t voxeltruncation ) :
+        _volume( NULL )
+    {
+        float x1 = Math::min( boxpt1.x, boxpt2.x );
+        float x2 = Math::max( boxpt1.x, boxpt2.x );
+        float y1 = Math::min( boxpt1.y, boxpt2.y );
+        float y2 = Math::max( boxpt1.y, boxpt2.y );
+        float z1 = Math::min( boxpt1.z, boxpt2.z );
+        float z2 = Math::max( boxpt1.z, boxpt2.z );
+
+        float width  = ( x2 - x1 ) / resolution;
+        float height = ( y2 - y1 ) / resolution;
+        float depth  = ( z2 - z1 ) / resolution;
+
+        _width  = 2 + ( size_t ) Math::ceil( width );
+        _height = 2 + ( size_t ) Math::ceil( height );
+        _depth  = 2 + ( size_t ) Math::ceil( depth );
+
+        float xoff = resolution * ( float ) _width  - ( x2 - x1 );
+        float yoff = resolution * ( float ) _height - ( y2 - y1 );
+        float zoff = resolution * ( float ) _depth  - ( z2 - z1 );
+
+        _g2w = Matrix4f( resolution,       0.0f,       0.0f, x1 - 0.5f * xoff,
+                               0.0f, resolution,       0.0f, y1 - 0.5f * yoff,
+                               0.0f,       0.0f, resolution, z1 - 0.5f * zoff,
+                               0.0f,       0.0f,       0.0f,             1.0f );
+
+        _trunc = voxeltruncation * resolution;
+
+        allocate();
+    }
+
+    TSDFVolumeCPU::~TSDFVolumeCPU()
+    {
+        free( _volume );
+    }
+
+    void TSDFVolumeCPU::allocate()
+    {
+        _bwidth  = ( _width + BLOCKMASK ) >> BLOCKSHIFT;
+        _bheight = ( _height + BLOCKMASK ) >> BLOCKSHIFT;
+        _bdepth  = ( _depth + BLOCKMASK ) >> BLOCKSHIFT;
+
+        size_t n = _bwidth * _bheight * _bdepth * 2 * BLOCKVOXELS;
+        if( !n || posix_memalign( ( void** ) &_volume, 64, sizeof( float ) * n ) )
+            throw CVTException( "TSDFVolumeCPU: allocation of the voxel blocks failed" );
+        clear();
+    }
+
+    void TSDFVolumeCPU::clear( float value, float weight )
+    {
+        ThreadPool::instance().parallelFor( 0, _bwidth * _bheight * _bdepth, 64, [&]( size_t start, size_t end ) {
+            float* ptr = _volume + start * 2 * BLOCKVOXELS;
+            for( size_t b = start; b < end; b++ ) {
+                std::fill( ptr, ptr + BLOCKVOXELS, value );
+                std::fill( ptr + BLOCKVOXELS, ptr + 2 * BLOCKVOXELS, weight );
+                ptr += 2 * BLOCKVOXELS;
+            }
+        } );
+    }
+
+    void TSDFVolumeCPU::setWeight( float weight )
+    {
+        ThreadPool::instance().parallelFor( 0, _bwidth * _bheight * _bdepth, 64, [&]( size_t start, size_t end ) {
+            float* ptr = _volume + start * 2 * BLOCKVOXELS + BLOCKVOXELS;
+            for( size_t b = start; b < end; b++ ) {
+                std::fill( ptr, ptr + BLOCKVOXELS, weight );
+                ptr += 2 * BLOCKVOXELS;
+            }
+        } );
+    }
+
+    void TSDFVolumeCPU::scaleWeight( float scale )
+    {
+        SIMD* simd = SIMD::instance();
+        ThreadPool::instance().parallelFor( 0, _bwidth * _bheight * _bdepth, 64, [&]( size_t start, size_t end ) {
+            float* ptr = _volume + start * 2 * BLOCKVOXELS + BLOCKVOXELS;
+            for( size_t b = start; b < end; b++ ) {
+                simd->MulValue1f( ptr, ptr, scale, BLOCKVOXELS );
+                ptr += 2 * BLOCKVOXELS;
+            }
+        } );
+    }
+
+    template<typename FUNC>
+    void TSDFVolumeCPU::integrate( const Matrix4f& proj, size_t iwidth, size_t iheight, FUNC func )
+    {
+        const Matrix4f projall = proj * _g2w;
+        const float fwidth  = ( float ) iwidth;
+        const float fheight = ( float ) iheight;
+        SIMD* simd = SIMD::instance();
+
+        /* voxel positions inside a block relative to the block origin */
+        Vector3f local[ BLOCKVOXELS ];
+        for( size_t z = 0, i = 0; z < BLOCKSIZE; z++ )
+            for( size_t y = 0; y < BLOCKSIZE; y++ )
+                for( size_t x = 0; x < BLOCKSIZE; x++, i++ )
+                    local[ i ].set( x, y, z );
+
+        /* every task processes slabs of blocks along x */
+        ThreadPool::instance().parallelFor( 0, _bdepth * _bheight, 1, [&]( size_t start, size_t end ) {
+            Vector3f cam[ BLOCKVOXELS ];
+            Matrix4f bproj( projall );
+
+            for( size_t slab = start; slab < end; slab++ ) {
+                size_t bz = slab / _bheight;
+                size_t by = slab % _bheight;
+                for( size_t bx = 0; bx < _bwidth; bx++ ) {
+                    Vector3f origin( bx * BLOCKSIZE, by * BLOCKSIZE, bz * BLOCKSIZE );
+
+                    /* cull blocks behind the camera or outside of the image */
+                    bool behind = true, partial = false;
+                    float xmin = fwidth, xmax = -1.0f, ymin = fheight, ymax = -1.0f;
+                    for( size_t c = 0; c < 8; c++ ) {
+                        Vector3f corner( origin.x + ( c & 1 ? BLOCKSIZE : 0 ),
+                                         origin.y + ( c & 2 ? BLOCKSIZE : 0 ),
+                                         origin.z + ( c & 4 ? BLOCKSIZE : 0 ) );
+                        Vector3f pc = projall * corner;
+                        if( pc.z <= 0.0f ) {
+                            partial = true;
+                            continue;
+                        }
+                        behind = false;
+                        xmin = Math::min( xmin, pc.x / pc.z );
+                        xmax = Math::max( xmax, pc.x / pc.z );
+                        ymin = Math::min( ymin, pc.y / pc.z );
+                        ymax = Math::max( ymax, pc.y / pc.z );
+                    }
+                    if( behind || ( !partial && ( xmax < 0.0f || ymax < 0.0f || xmin >= fwidth || ymin >= fheight ) ) )
+                        continue;
+
+                    for( size_t r = 0; r < 3; r++ )
+                        bproj[ r ][ 3 ] = projall[ r ][ 0 ] * origin.x + projall[ r ][ 1 ] * origin.y + projall[ r ][ 2 ] * origin.z + projall[ r ][ 3 ];
+                    simd->transformPoints( cam, bproj, local, BLOCKVOXELS );
+
+                    /* the fusion stays scalar, it is bound by the bilinear gathers from the maps */
+                    float* values  = _volume + ( slab * _bwidth + bx ) * 2 * BLOCKVOXELS;
+                    float* weights = values + BLOCKVOXELS;
+                    for( size_t i = 0; i < BLOCKVOXELS; i++ ) {
+                        const Vector3f& pc = cam[ i ];
+                        if( pc.z <= 0.0f )
+                            continue;
+                        float ix = pc.x / pc.z;
+                        float iy = pc.y / pc.z;
+                        if( ix >= 0.0f && iy >= 0.0f && ix < fwidth && iy < fheight )
+                            func( values[ i ], weights[ i ], ix, iy, pc.z );
+                    }
+                }
+            }
+        } );
+    }
+
+    void TSDFVolumeCPU::addDepthMap( const Matrix4f& proj, const Image& depthmap, float scale )
+    {
+        Image tmp;
+        const Image& dmap = _withFormat( tmp, depthmap, IFormat::GRAY_FLOAT );
+
+        IMapScoped<const float> map( dmap );
+        const uint8_t* base = ( const uint8_t* ) map.base();
+        size_t stride = map.stride();
+        size_t iwidth = dmap.width();
+        size_t iheight = dmap.height();
+        const float trunc = _trunc;
+
+        integrate( proj, iwidth, iheight, [=]( float& value, float& weight, float ix, float iy, float z ) {
+            float d = _sampleBilinear( base, stride, iwidth, iheight, ix, iy ) * scale;
+            if( d <= 0.0f )
+                return;
+            float sdf = d - z;
+            if( sdf < -trunc )
+                return;
+            float tsdf = Math::clamp( sdf / trunc, -1.0f, 1.0f );
+            value = ( value * weight + tsdf ) / ( weight + 1.0f );
+            weight += 1.0f;
+        } );
+    }
+
+    void TSDFVolumeCPU::addDepthMapWeighted( const Matrix4f& proj, const Image& depthmap, float scale, const Image& weightmap )
+    {
+        Image tmpd, tmpw;
+        const Image& dmap = _withFormat( tmpd, depthmap, IFormat::GRAY_FLOAT );
+        const Image& wmap = _withFormat( tmpw, weightmap, IFormat::GRAY_FLOAT );
+
+        if( wmap.width() != dmap.width() || wmap.height() != dmap.height() )
+            throw CVTException( "TSDFVolumeCPU: depth and weight map size mismatch" );
+
+        IMapScoped<const float> map( dmap );
+        IMapScoped<const float> mapw( wmap );
+        const uint8_t* base = ( const uint8_t* ) map.base();
+        const uint8_t* basew = ( const uint8_t* ) mapw.base();
+        size_t stride = map.stride();
+        size_t stridew = mapw.stride();
+        size_t iwidth = dmap.width();
+        size_t iheight = dmap.height();
+        const float trunc = _trunc;
+
+        integrate( proj, iwidth, iheight, [=]( float& value, float& weight, float ix, float iy, float z ) {
+            float d = _sampleBilinear( base, stride, iwidth, iheight, ix, iy ) * scale;
+            if( d <= 0.0f )
+                return;
+            float sdf = d - z;
+            if( sdf < -trunc )
+                return;
+            float w = _sampleBilinear( basew, stridew, iwidth, iheight, ix, iy );
+            float tsdf = Math::clamp( sdf * 8.0f / trunc, -8.0f, 8.0f );
+            float diff = tsdf - value;
+            w *= Math::exp( -diff * diff * 0.1f ) * 0.95f + 0.05f;
+            value = ( value * weight + tsdf * w ) / ( weight + w );
+            weight += w;
+        } );
+    }
+
+    void TSDFVolumeCPU::addDepthMap( const Matrix3f& intrinsics, const Matrix4f& extrinsics, const Image& depthmap, float scale )
+    {
+        Matrix4f proj = intrinsics.toMatrix4();
+        proj *= extrinsics;
+        addDepthMap( proj, depthmap, scale );
+    }
+
+    void TSDFVolumeCPU::addDepthMapWeighted( const Matrix3f& intrinsics, const Matrix4f& extrinsics, const Image& depthmap, float scale, const Image& weight )
+    {
+        Matrix4f proj = intrinsics.toMatrix4();
+        proj *= extrinsics;
+        addDepthMapWeighted( proj, depthmap, scale, weight );
+    }
+
+    void TSDFVolumeCPU::addDepthMapNormalWeighted( const Matrix4f& proj, const Image& depthmap, float scale, const Image& normal )
+    {
+        Image weight;
+        normalToWeight( weight, normal );
+
+        addDepthMapWeighted( proj, depthmap, scale, weight );
+    }
+
+    void TSDFVolumeCPU::addDepthMapNormalWeighted( const Matrix3f& intrinsics, const Matrix4f& extrinsics, const Image& depthmap, float scale, const Image& normal )
+    {
+        Matrix4f proj = intrinsics.toMatrix4();
+        proj *= extrinsics;
+        addDepthMapNormalWeighted( proj, depthmap, scale, normal );
+    }
+
+    void TSDFVolumeCPU::addSilhouette( const Matrix3f& intrinsics, const Matrix4f& extrinsics, const Image& silhouette )
+    {
+        Matrix4f proj = intrinsics.toMatrix4();
+        proj *= extrinsics;
+        addSilhouette( proj, silhouette );
+    }
+
+    void TSDFVolumeCPU::addSilhouette( const Matrix4f& proj, const Image& silhouette )
+    {
+        Image tmp;
+        const Image& smap = _withFormat( tmp, silhouette, IFormat::GRAY_FLOAT );
+
+        IMapScoped<const float> map( smap );
+        const uint8_t* base = ( const uint8_t* ) map.base();
+        size_t stride = map.stride();
+        size_t iwidth = smap.width();
+        size_t iheight = smap.height();
+
+        integrate( proj, iwidth, iheight, [=]( float& value, float& weight, float ix, float iy, float ) {
+            float d = _sampleBilinear( base, stride, iwidth, iheight, ix, iy ) > 0.0f ? 1.0f : 0.0f;
+            // geometric mean, gm = \prod_{i=0}{N} a_i -> a_k = 0 with k \in (0...N) -> gm = 0
+            // GMT: ( 0...1 ) -> -1 ... 1 and GMTINV( GMT( x ) ) = x
+            float old = -0.5f * ( value - 1.0f );
+            float gm = Math::pow( old, weight / ( weight + 1.0f ) ) * Math::pow( d, 1.0f / ( weight + 1.0f ) );
+            value = -2.0f * gm + 1.0f;
+            weight += 1.0f;
+        } );
+    }
+
+    void TSDFVolumeCPU::trilinearFetch( float* values, const Vector3f& pos, Vector3f& alpha, size_t channel ) const
+    {
+        float px = Math::clamp( pos.x, 0.0f, ( float ) ( _width - 2 ) );
+        float py = Math::clamp( pos.y, 0.0f, ( float ) ( _height - 2 ) );
+        float pz = Math::clamp( pos.z, 0.0f, ( float ) ( _depth - 2 ) );
+        size_t x = ( size_t ) px;
+        size_t y = ( size_t ) py;
+        size_t z = ( size_t ) pz;
+
+        alpha.set( px - ( float ) x, py - ( float ) y, pz - ( float ) z );
+
+        if( ( x & BLOCKMASK ) != BLOCKMASK && ( y & BLOCKMASK ) != BLOCKMASK && ( z & BLOCKMASK ) != BLOCKMASK ) {
+            /* all eight samples are inside the same block */
+            const float* ptr = _volume + offset( x, y, z ) + channel;
+            const size_t dy = BLOCKSIZE;
+            const size_t dz = BLOCKSIZE * BLOCKSIZE;
+            values[ 0 ] = ptr[ 0 ];
+            values[ 1 ] = ptr[ 1 ];
+            values[ 2 ] = ptr[ dy ];
+            values[ 3 ] = ptr[ dy + 1 ];
+            values[ 4 ] = ptr[ dz ];
+            values[ 5 ] = ptr[ dz + 1 ];
+            values[ 6 ] = ptr[ dz + dy ];
+            values[ 7 ] = ptr[ dz + dy + 1 ];
+        } else {
+            const float* ptr = _volume + channel;
+            values[ 0 ] = ptr[ offset( x    , y    , z     ) ];
+            values[ 1 ] = ptr[ offset( x + 1, y    , z     ) ];
+            values[ 2 ] = ptr[ offset( x    , y + 1, z     ) ];
+            values[ 3 ] = ptr[ offset( x + 1, y + 1, z     ) ];
+            values[ 4 ] = ptr[ offset( x    , y    , z + 1 ) ];
+            values[ 5 ] = ptr[ offset( x + 1, y    , z + 1 ) ];
+            values[ 6 ] = ptr[ offset( x    , y + 1, z + 1 ) ];
+            values[ 7 ] = ptr[ offset( x + 1, y + 1, z + 1 ) ];
+        }
+    }
+
+    float TSDFVolumeCPU::trilinearValue( const Vector3f& pos ) const
+    {
+        float v[ 8 ];
+        Vector3f alpha;
+
+        trilinearFetch( v, pos, alpha, 0 );
+        return Math::mix( Math::mix( Math::mix( v[ 0 ], v[ 4 ], alpha.z ), Math::mix( v[ 1 ], v[ 5 ], alpha.z ), alpha.x ),
+                          Math::mix( Math::mix( v[ 2 ], v[ 6 ], alpha.z ), Math::mix( v[ 3 ], v[ 7 ], alpha.z ), alpha.x ), alpha.y );
+    }
+
+    float TSDFVolumeCPU::trilinearWeight( const Vector3f& pos ) const
+    {
+        float v[ 8 ];
+        Vector3f alpha;
+
+        trilinearFetch( v, pos, alpha, BLOCKVOXELS );
+        for( size_t i = 0; i < 8; i++ ) {
+            if( v[ i ] < 1.0f )
+                return 0.0f;
+        }
+        return Math::mix( Math::mix( Math::mix( v[ 0 ], v[ 4 ], alpha.z ), Math::mix( v[ 1 ], v[ 5 ], alpha.z ), alpha.x ),
+                          Math::mix( Math::mix( v[ 2 ], v[ 6 ], alpha.z ), Math::mix( v[ 3 ], v[ 7 ], alpha.z ), alpha.x ), alpha.y );
+    }
+
+    template<typename FUNC>
+    void TSDFVolumeCPU::rayCast( size_t iwidth, size_t iheight, const Matrix3f& intrinsics, const Matrix4f& extrinsics, FUNC func ) const
+    {
+        const Matrix4f MV  = extrinsics * _g2w;
+        const Matrix4f MVP = intrinsics.toMatrix4() * MV;
+        const Matrix4f cam2grid = MVP.inverse();
+        const Vector3f origin = cam2grid * Vector3f( 0.0f, 0.0f, 0.0f );
+        const Matrix3f rot = MV.toMatrix3();
+        const float fwidth  = ( float ) _width;
+        const float fheight = ( float ) _height;
+        const float fdepth  = ( float ) _depth;
+        size_t tilesx = ( iwidth + RAYCAST_TILE - 1 ) / RAYCAST_TILE;
+        size_t tilesy = ( iheight + RAYCAST_TILE - 1 ) / RAYCAST_TILE;
+
+        ThreadPool::instance().parallelFor( 0, tilesx * tilesy, 1, [&]( size_t start, size_t end ) {
+            for( size_t tile = start; tile < end; tile++ ) {
+                size_t x0 = ( tile % tilesx ) * RAYCAST_TILE;
+                size_t y0 = ( tile / tilesx ) * RAYCAST_TILE;
+                size_t x1 = Math::min( x0 + RAYCAST_TILE, iwidth );
+                size_t y1 = Math::min( y0 + RAYCAST_TILE, iheight );
+
+                for( size_t y = y0; y < y1; y++ ) {
+                    for( size_t x = x0; x < x1; x++ ) {
+                        Vector3f dir = cam2grid * Vector3f( ( float ) x, ( float ) y, 1.0f ) - origin;
+                        dir.normalize();
+
+                        /* intersect the ray with the volume bounding box, the slab test also handles zero components of dir */
+                        float raystart = -std::numeric_limits<float>::max();
+                        float rayend   =  std::numeric_limits<float>::max();
+                        const float bounds[ 3 ] = { fwidth, fheight, fdepth };
+                        for( size_t i = 0; i < 3; i++ ) {
+                            float t0 = ( 0.0f - origin[ i ] ) / dir[ i ];
+                            float t1 = ( bounds[ i ] - origin[ i ] ) / dir[ i ];
+                            raystart = Math::max( raystart, Math::min( t0, t1 ) );
+                            rayend   = Math::min( rayend, Math::max( t0, t1 ) );
+                        }
+                        raystart = Math::max( raystart, 0.0f );
+
+                        if( !( raystart < rayend ) || !_isFinite( raystart ) || !_isFinite( rayend ) ||
+                            !_isFinite( dir.x ) || !_isFinite( dir.y ) || !_isFinite( dir.z ) ) {
+                            func( x, y, false, false, dir, origin, rot );
+                            continue;
+                        }
+
+                        float vec[ 3 ] = { Math::abs( dir.x ), Math::abs( dir.y ), Math::abs( dir.z ) };
+                        float step = 0.5f / Math::max( vec[ 0 ], Math::max( vec[ 1 ], vec[ 2 ] ) );
+
+                        Vector3f pos = origin + dir * raystart;
+                        float val, valprev = trilinearValue( pos );
+                        bool hit = false;
+
+                        for( float lambda = raystart + step; lambda <= rayend; lambda += step ) {
+                            pos = origin + dir * lambda;
+                            val = trilinearValue( pos );
+
+                            if( valprev < 0.0f && val > 0.0f )
+                                break;
+
+                            if( valprev > 0.0f && val <= 0.0f ) {
+                                /* linear interpolation of the zero crossing */
+                                pos += dir * ( step * val / ( valprev - val ) );
+                                hit = true;
+                                break;
+                            }
+                            valprev = val;
+                        }
+                        func( x, y, true, hit, dir, pos, rot );
+                    }
+                }
+            }
+        } );
+    }
+
+    void TSDFVolumeCPU::rayCastDepthMap( Image& depthmap, const Matrix3f& intrinsics, const Matrix4f& extrinsics, float scale )
+    {
+        const Matrix4f MV = extrinsics * _g2w;
+
+        depthmap.reallocate( depthmap.width(), depthmap.height(), IFormat::GRAY_FLOAT, IALLOCATOR_MEM );
+        IMapScoped<float> map( depthmap );
+
+        rayCast( depthmap.width(), depthmap.height(), intrinsics, extrinsics,
+                 [&]( size_t x, size_t y, bool valid, bool hit, const Vector3f&, const Vector3f& gpos, const Matrix3f& ) {
+            float* out = map.line( y ) + x;
+            if( !valid )
+                *out = 0.0f;
+            else if( !hit )
+                *out = 1e10f;
+            else
+                *out = ( MV * gpos ).z * scale;
+        } );
+    }
+
+    void TSDFVolumeCPU::rayCastDepthNormalMap( Image& depthmap, const Matrix3f& intrinsics, const Matrix4f& extrinsics, float scale )
+    {
+        const Matrix4f MV = extrinsics * _g2w;
+
+        depthmap.reallocate( depthmap.width(), depthmap.height(), IFormat::RGBA_FLOAT, IALLOCATOR_MEM );
+        IMapScoped<float> map( depthmap );
+
+        rayCast( depthmap.width(), depthmap.height(), intrinsics, extrinsics,
+                 [&]( size_t x, size_t y, bool, bool hit, const Vector3f&, const Vector3f& gpos, const Matrix3f& rot ) {
+            float* out = map.line( y ) + 4 * x;
+            if( !hit ) {
+                out[ 0 ] = out[ 1 ] = out[ 2 ] = out[ 3 ] = 0.0f;
+                return;
+            }
+
+            const float delta = 0.5f;
+            Vector3f grad( trilinearValue( gpos + Vector3f( delta, 0.0f, 0.0f ) ) - trilinearValue( gpos - Vector3f( delta, 0.0f, 0.0f ) ),
+                           trilinearValue( gpos + Vector3f( 0.0f, delta, 0.0f ) ) - trilinearValue( gpos - Vector3f( 0.0f, delta, 0.0f ) ),
+                           trilinearValue( gpos + Vector3f( 0.0f, 0.0f, delta ) ) - trilinearValue( gpos - Vector3f( 0.0f, 0.0f, delta ) ) );
+            Vector3f normal = rot * grad;
+            normal.normalize();
+
+            out[ 0 ] = ( MV * gpos ).z * scale;
+            out[ 1 ] = normal.x;
+            out[ 2 ] = normal.y;
+            out[ 3 ] = normal.z;
+        } );
+    }
+
+    void TSDFVolumeCPU::rayCastDepthNormalMapSlope( Image& depthmap, Image& slope, const Matrix3f& intrinsics, const Matrix4f& extrinsics, float scale )
+    {
+        const Matrix4f MV = extrinsics * _g2w;
+        const float FAR = 1e4f;
+
+        depthmap.reallocate( depthmap.width(), depthmap.height(), IFormat::RGBA_FLOAT, IALLOCATOR_MEM );
+        slope.reallocate( depthmap.width(), depthmap.height(), IFormat::GRAY_FLOAT, IALLOCATOR_MEM );
+        IMapScoped<float> map( depthmap );
+        IMapScoped<float> mapslope( slope );
+
+        rayCast( depthmap.width(), depthmap.height(), intrinsics, extrinsics,
+                 [&]( size_t x, size_t y, bool, bool hit, const Vector3f& dir, const Vector3f& gpos, const Matrix3f& rot ) {
+            float* out = map.line( y ) + 4 * x;
+            float* outslope = mapslope.line( y ) + x;
+            if( !hit ) {
+                out[ 0 ] = FAR;
+                out[ 1 ] = out[ 2 ] = 0.0f;
+                out[ 3 ] = 1.0f;
+                *outslope = 0.0f;
+                return;
+            }
+
+            const float delta = 1.0f;
+            float s = ( trilinearValue( gpos + dir * delta ) - trilinearValue( gpos - dir * delta ) ) / ( 2.0f * delta );
+            float w = trilinearWeight( gpos );
+            Vector3f grad( trilinearValue( gpos + Vector3f( delta, 0.0f, 0.0f ) ) - trilinearValue( gpos - Vector3f( delta, 0.0f, 0.0f ) ),
+                           trilinearValue( gpos + Vector3f( 0.0f, delta, 0.0f ) ) - trilinearValue( gpos - Vector3f( 0.0f, delta, 0.0f ) ),
+                           trilinearValue( gpos + Vector3f( 0.0f, 0.0f, delta ) ) - trilinearValue( gpos - Vector3f( 0.0f, 0.0f, delta ) ) );
+            Vector3f normal = rot * grad;
+            normal.normalize();
+
+            out[ 0 ] = ( MV * gpos ).z * scale;
+            out[ 1 ] = normal.x;
+            out[ 2 ] = normal.y;
+            out[ 3 ] = normal.z;
+            *outslope = Math::clamp( -s, 0.0f, 4.0f ) / 4.0f * ( 1.0f - Math::exp( -0.1f * w * w ) );
+        } );
+    }
+
+    void TSDFVolumeCPU::normalToWeight( Image& weight, const Image& normals )
+    {
+        Image tmp;
+        const Image& nmap = _withFormat( tmp, normals, IFormat::RGBA_FLOAT );
+
+        weight.reallocate( nmap.width(), nmap.height(), IFormat::GRAY_FLOAT, IALLOCATOR_MEM );
+
+        IMapScoped<const float> src( nmap );
+        IMapScoped<float> dst( weight );
+        size_t w = nmap.width();
+
+        parallelForRows( weight, [&]( size_t ystart, size_t yend ) {
+            for( size_t y = ystart; y < yend; y++ ) {
+                const float* pn = src.line( y );
+                float* pw = dst.line( y );
+                for( size_t x = 0; x < w; x++ )
+                    pw[ x ] = 0.5f + 0.5f * Math::abs( pn[ 4 * x + 2 ] ) + 1e-5f;
+            }
+        } );
+    }
+
+    void TSDFVolumeCPU::toSceneMesh( SceneMesh& mesh, float minweight ) const
+    {
+        MarchingCubes mc( _volume, _width, _height, _depth, true, minweight );
+        mc.setBlockLayout( BLOCKSHIFT );
+        mc.triangulateWithNormals( mesh, 0.0f );
+    }
+
+    void TSDFVolumeCPU::sliceX( Image& img ) const
+    {
+        size_t x = _width / 2;
+        img.reallocate( _height, _depth, IFormat::GRAY_FLOAT, IALLOCATOR_MEM );
+        IMapScoped<float> map( img );
+        for( size_t z = 0; z < _depth; z++ ) {
+            float* dst = map.line( z );
+            for( size_t y = 0; y < _height; y++ )
+                dst[ y ] = Math::clamp( value( x, y, z ) + 0.5f, 0.0f, 1.0f );
+        }
+    }
+
+    void TSDFVolumeCPU::sliceY( Image& img ) const
+    {
+        size_t y = _height / 2;
+        img.reallocate( _width, _depth, IFormat::GRAY_FLOAT, IALLOCATOR_MEM );
+        IMapScoped<float> map( img );
+        for( size_t z = 0; z < _depth; z++ ) {
+            float* dst = map.line( z );
+            for( size_t x = 0; x < _width; x++ )
+                dst[ x ] = Math::clamp( value( x, y, z ) + 0.5f, 0.0f, 1.0f );
+        }
+    }
+
+    void TSDFVolumeCPU::sliceZ( Image& img ) const
+    {
+        size_t z = _depth / 2;
+        img.reallocate( _width, _height, IFormat::GRAY_FLOAT, IALLOCATOR_MEM );
+        IMapScoped<float> map( img );
+        for( size_t y = 0; y < _height; y++ ) {
+            float* dst = map.line( y );
+            for( size_t x = 0; x < _width; x++ )
+                dst[ x ] = Math::clamp( value( x, y, z ) + 0.5f, 0.0f, 1.0f );
+        }
+    }
+
+    void TSDFVolumeCPU::saveRaw( const String& path, bool weighted ) const
+    {
+        FILE* f;
+        f = fopen( path.c_str(),"wb");
+        if( !f )
+            throw CVTException( "TSDFVolumeCPU: unable to open file for writing" );
+
+        /* write in the linear layout of TSDFVolume */
+        std::vector<float> line( 2 * _width );
+        size_t channels = weighted ? 2 : 1;
+        for( size_t z = 0; z < _depth; z++ ) {
+            for( size_t y = 0; y < _height; y++ ) {
+                for( size_t x = 0; x < _width; x++ ) {
+                    size_t off = offset( x, y, z );
+                    line[ x * channels ] = _volume[ off ];
+                    if( weighted )
+                        line[ x * channels + 1 ] = _volume[ off + BLOCKVOXELS ];
+                }
+                fwrite( &line[ 0 ], sizeof( float ), channels * _width, f );
+            }
+        }
+        fclose( f );
+    }
+}
@@ -0,0 +1,149 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_TSDFVOLUMECPU_H
+#define CVT_TSDFVOLUMECPU_H
+
+#include <cvt/gfx/Image.h>
+#include <cvt/math/Matrix.h>
+#include <cvt/util/String.h>
+#include <cvt/geom/MarchingCubes.h>
+
+namespace cvt
+{
+    /**
+      @brief CPU implementation of the TSDFVolume interface
+
+      The voxels are stored in blocks of 8x8x8 voxels, every block holds the 512 distance values followed
+      by the 512 weights. Depth map fusion is processed in parallel over slabs of blocks, blocks outside of the
+      view frustum are skipped. Raycasting is processed in parallel over image tiles.
+     */
+    class TSDFVolumeCPU
+    {
+        public:
+            TSDFVolumeCPU( const Matrix4f& gridtoworld, size_t width, size_t height, size_t depth, float truncation = 0.1f );
+            TSDFVolumeCPU( const Vector3f& boxpt1, const Vector3f& boxpt2, float resolution, size_t voxeltruncation = 10 );
+            ~TSDFVolumeCPU();
+
+            void clear( float value = 1.0f, float weight = 0.0f );
+
+            void setWeight( float weight = 1.0f );
+            void scaleWeight( float scale );
+
+            void addDepthMap( const Matrix4f& proj, const Image& depthmap, float scale );
+            void addDepthMap( const Matrix3f& intrinsics, const Matrix4f& extrinsics, const Image& depthmap, float scale = 1.0f );
+
+            void addDepthMapWeighted( const Matrix4f& proj, const Image& depthmap, float scale, const Image& weight );
+            void addDepthMapWeighted( const Matrix3f& intrinsics, const Matrix4f& extrinsics, const Image& depthmap, float scale, const Image& weight );
+
+            void addDepthMapNormalWeighted( const Matrix4f& proj, const Image& depthmap, float scale, const Image& normal );
+            void addDepthMapNormalWeighted( const Matrix3f& intrinsics, const Matrix4f& extrinsics, const Image& depthmap, float scale, const Image& normal );
+
+            void addSilhouette( const Matrix3f& intrinsics, const Matrix4f& extrinsics, const Image& silhouette );
+            void addSilhouette( const Matrix4f& proj, const Image& silhouette );
+
+            void rayCastDepthMap( Image& depthmap, const Matrix3f& intrinsics, const Matrix4f& extrinsics, float scale = 1.0f );
+            void rayCastDepthNormalMap( Image& depthmap, const Matrix3f& intrinsics, const Matrix4f& extrinsics, float scale = 1.0f );
+            void rayCastDepthNormalMapSlope( Image& depthmap, Image& slope, const Matrix3f& intrinsics, const Matrix4f& extrinsics, float scale = 1.0f );
+
+            void normalToWeight( Image& weight, const Image& normals );
+
+            size_t width() const { return _width; }
+            size_t height() const { return _height; }
+            size_t depth() const { return _depth; }
+
+            float value( size_t x, size_t y, size_t z ) const;
+            float weight( size_t x, size_t y, size_t z ) const;
+
+            void toSceneMesh( SceneMesh& mesh, float minweight = 1.0f ) const;
+
+            float truncation() const { return _trunc; }
+            float& truncation() { return _trunc; }
+
+            void sliceX( Image& img ) const;
+            void sliceY( Image& img ) const;
+            void sliceZ( Image& img ) const;
+
+            const Matrix4f& gridToWorld() const;
+
+            void saveRaw( const String& path, bool weighted ) const;
+
+        private:
+            TSDFVolumeCPU( const TSDFVolumeCPU& );
+            TSDFVolumeCPU& operator=( const TSDFVolumeCPU& );
+
+            enum {
+                BLOCKSHIFT  = 3,
+                BLOCKSIZE   = 1 << BLOCKSHIFT,
+                BLOCKMASK   = BLOCKSIZE - 1,
+                BLOCKVOXELS = BLOCKSIZE * BLOCKSIZE * BLOCKSIZE
+            };
+
+            void   allocate();
+            size_t offset( size_t x, size_t y, size_t z ) const;
+            float  trilinearValue( const Vector3f& pos ) const;
+            float  trilinearWeight( const Vector3f& pos ) const;
+            void   trilinearFetch( float* values, const Vector3f& pos, Vector3f& alpha, size_t channel ) const;
+
+            template<typename FUNC>
+            void   integrate( const Matrix4f& proj, size_t iwidth, size_t iheight, FUNC func );
+
+            template<typename FUNC>
+            void   rayCast( size_t iwidth, size_t iheight, const Matrix3f& intrinsics, const Matrix4f& extrinsics, FUNC func ) const;
+
+            float*   _volume;
+            size_t   _width;
+            size_t   _height;
+            size_t   _depth;
+            size_t   _bwidth;
+            size_t   _bheight;
+            size_t   _bdepth;
+            float    _trunc;
+            Matrix4f _g2w;
+    };
+
+    inline const Matrix4f& TSDFVolumeCPU::gridToWorld() const
+    {
+        return _g2w;
+    }
+
+    inline size_t TSDFVolumeCPU::offset( size_t x, size_t y, size_t z ) const
+    {
+        size_t block = ( ( z >> BLOCKSHIFT ) * _bheight + ( y >> BLOCKSHIFT ) ) * _bwidth + ( x >> BLOCKSHIFT );
+        return block * 2 * BLOCKVOXELS + ( ( ( z & BLOCKMASK ) * BLOCKSIZE + ( y & BLOCKMASK ) ) * BLOCKSIZE + ( x & BLOCKMASK ) );
+    }
+
+    inline float TSDFVolumeCPU::value( size_t x, size_t y, size_t z ) const
+    {
+        return _volume[ offset( x, y, z ) ];
+    }
+
+    inline float TSDFVolumeCPU::weight( size_t x, size_t y, size_t z ) const
+    {
+        return _volume[ offset( x, y, z ) + BLOCKVOXELS ];
+    }
+}
+
+#endif
@@ -0,0 +1,103 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+#include <cvt/vision/TSDFVolumeCPU.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/util/CVTTest.h>
+
+using namespace cvt;
+
+BEGIN_CVTTEST( TSDFVolumeCPU )
+    bool result = true;
+    bool b;
+
+    /* fronto-parallel plane at depth 1 seen by a camera at the origin */
+    Matrix3f K( 100.0f,   0.0f, 32.0f,
+                  0.0f, 100.0f, 24.0f,
+                  0.0f,   0.0f,  1.0f );
+    Matrix4f T;
+    T.setIdentity();
+
+    Image depth( 64, 48, IFormat::GRAY_FLOAT );
+    depth.fill( Color( 1.0f ) );
+
+    TSDFVolumeCPU volume( Vector3f( -0.2f, -0.2f, 0.7f ), Vector3f( 0.2f, 0.2f, 1.3f ), 0.01f, 5 );
+    volume.clear();
+    volume.addDepthMap( K, T, depth );
+    volume.addDepthMap( K, T, depth );
+
+    Vector3f gcenter = volume.gridToWorld().inverse() * Vector3f( 0.0f, 0.0f, 0.9f );
+    b = Math::abs( volume.value( gcenter.x, gcenter.y, gcenter.z ) - 1.0f ) < 1e-4f &&
+        volume.weight( gcenter.x, gcenter.y, gcenter.z ) == 2.0f;
+    CVTTEST_PRINT( "addDepthMap", b );
+    result &= b;
+
+    Image raycast( 64, 48, IFormat::GRAY_FLOAT );
+    volume.rayCastDepthMap( raycast, K, T );
+    {
+        IMapScoped<const float> map( raycast );
+        b = Math::abs( map.line( 24 )[ 32 ] - 1.0f ) < 0.01f;
+    }
+    CVTTEST_PRINT( "rayCastDepthMap", b );
+    result &= b;
+
+    SceneMesh mesh( "tsdf" );
+    volume.toSceneMesh( mesh, 1.0f );
+    b = mesh.vertexSize() > 0;
+    for( size_t i = 0; b && i < mesh.vertexSize(); i++ ) {
+        /* the depth map is zero outside of the image, skip the border of the view frustum */
+        Vector3f pt = volume.gridToWorld() * mesh.vertices()[ i ];
+        if( Math::abs( pt.x ) < 0.1f && Math::abs( pt.y ) < 0.1f )
+            b &= Math::abs( pt.z - 1.0f ) < 0.01f;
+    }
+    CVTTEST_PRINT( "toSceneMesh", b );
+    result &= b;
+
+    /* voxels projecting into the last column and row sample the edge of the depth map */
+    {
+        Image border( 33, 25, IFormat::GRAY_FLOAT );
+        border.fill( Color( 1.0f ) );
+        volume.clear();
+        volume.addDepthMap( K, T, border );
+
+        size_t n = 0;
+        b = true;
+        size_t gz = ( size_t ) ( gcenter.z + 0.5f );
+        for( size_t gy = 0; gy < volume.height(); gy++ ) {
+            for( size_t gx = 0; gx < volume.width(); gx++ ) {
+                Vector3f pt = K * ( volume.gridToWorld() * Vector3f( gx, gy, gz ) );
+                float ix = pt.x / pt.z;
+                float iy = pt.y / pt.z;
+                if( ix < 32.0f || iy < 24.0f || ix >= 33.0f || iy >= 25.0f )
+                    continue;
+                b &= volume.weight( gx, gy, gz ) == 1.0f && Math::abs( volume.value( gx, gy, gz ) - 1.0f ) < 1e-4f;
+                n++;
+            }
+        }
+        b &= n > 0;
+    }
+    CVTTEST_PRINT( "image border", b );
+    result &= b;
+
+    return result;
+END_CVTTEST
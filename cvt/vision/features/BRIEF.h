@@ -93,6 +93,19 @@ namespace cvt {
 					return _simd->hammingDistance( a.desc, b.desc, N );
 				}
 
+				/* distances of a to the count descriptors starting at b */
+				void operator()( uint32_t* dst, const Descriptor& a, const Descriptor* b, size_t count ) const
+				{
+					_simd->hammingDistances( dst, a.desc, b->desc, sizeof( Descriptor ), count, N );
+				}
+
+				/* m x count distance matrix, dstStride in elements */
+				void operator()( uint32_t* dst, size_t dstStride, const Descriptor* a, size_t m, const Descriptor* b, size_t count ) const
+				{
+					_simd->hammingDistanceMatrix( dst, dstStride * sizeof( uint32_t ), a->desc, sizeof( Descriptor ), m,
+												  b->desc, sizeof( Descriptor ), count, N );
+				}
+
 				SIMD* _simd;
 			};
 
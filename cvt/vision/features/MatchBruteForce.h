@@ -26,33 +26,63 @@
 #define CVT_FEATURE_MATCHER_INL
 
 #include <cvt/vision/features/RowLookupTable.h>
+#include <cvt/math/Math.h>
+#include <stdint.h>
 
 namespace cvt {
 
+	/*
+	   The distance functors compute the descriptor distances batched:
+		dfunc( dst, query, first, count ): distances of query to the count descriptors starting at first
+		dfunc( dst, dstStride, a, m, b, count ): m x count distance matrix, dstStride in elements
+	 */
 	namespace FeatureMatcher {
+		/* distances of query to set[ begin ] ... set[ end - 1 ], keeps the first strict minimum in idx and distance */
+		template<typename T, typename DFUNC>
+		static inline void minDistance( size_t& idx, float& distance, uint32_t* buf, const T& query, const std::vector<T>& set, size_t begin, size_t end, DFUNC& dfunc )
+		{
+			dfunc( buf, query, &set[ begin ], end - begin );
+			for( size_t k = begin; k < end; k++ ) {
+				if( ( float ) buf[ k - begin ] < distance ) {
+					idx = k;
+					distance = buf[ k - begin ];
+				}
+			}
+		}
+
 		template<typename T, typename DFUNC>
 		static inline void matchBruteForce( std::vector<FeatureMatch>& matches, const std::vector<T>& seta, const std::vector<T>& setb, DFUNC dfunc, float distThreshold )
 		{
+			if( seta.empty() || setb.empty() )
+				return;
+
+			/* the distance matrix is evaluated in blocks of rows */
+			const size_t rowBlock = 16;
+			const size_t nb = setb.size();
+			std::vector<uint32_t> dist( rowBlock * nb );
+
 			matches.reserve( seta.size() );
-			for( size_t i = 0; i < seta.size(); i++ ) {
-				FeatureMatch m;
-				const T& d0 = seta[ i ];
+			for( size_t i0 = 0; i0 < seta.size(); i0 += rowBlock ) {
+				size_t rows = Math::min( rowBlock, seta.size() - i0 );
+				dfunc( &dist[ 0 ], nb, &seta[ i0 ], rows, &setb[ 0 ], nb );
 
-				m.feature0 = &d0;
-				m.feature1 = 0;
-				m.distance = distThreshold;
-				for( size_t k = 0; k < setb.size(); k++ ) {
-					const T& d1 = setb[ k ];
-					float distance = dfunc( d0, d1 );
-
-					if( distance < m.distance ) {
-						m.feature1 = &d1;
-						m.distance = distance;
+				for( size_t r = 0; r < rows; r++ ) {
+					const uint32_t* drow = &dist[ r * nb ];
+					FeatureMatch m;
+
+					m.feature0 = &seta[ i0 + r ];
+					m.feature1 = 0;
+					m.distance = distThreshold;
+					for( size_t k = 0; k < nb; k++ ) {
+						if( ( float ) drow[ k ] < m.distance ) {
+							m.feature1 = &setb[ k ];
+							m.distance = drow[ k ];
+						}
 					}
-				}
 
-				if( m.feature1 )
-					matches.push_back( m );
+					if( m.feature1 )
+						matches.push_back( m );
+				}
 			}
 		}
 
@@ -64,31 +94,37 @@ namespace cvt {
 										  float maxFeatureDist,
 										  float maxDescDistance )
 		{
+			if( setB.empty() )
+				return;
+
 			matches.reserve( setA.size() );
 			MatchingIndices m;
+			std::vector<uint32_t> dist( setB.size() );
 			float distanceSquare = Math::sqr( maxFeatureDist );
 			for( size_t i = 0; i < setA.size(); ++i ) {
 				const T& d0 = *( ( const T* )setA[ i ] );
 				m.srcIdx = i;
 				m.dstIdx = 0;
 				m.distance = maxDescDistance;
-				for( size_t k = 0; k < setB.size(); ++k ) {
-					const T& d1 = setB[ k ];
+
+				/* batch the runs of consecutive features within the window */
+				size_t k = 0;
+				while( k < setB.size() ) {
 					// euclidean distance
-					float ptDist = ( d1.pt - d0.pt ).lengthSqr();
-					if( ptDist > distanceSquare )
+					if( ( setB[ k ].pt - d0.pt ).lengthSqr() > distanceSquare ) {
+						k++;
 						continue;
-					// descriptor distance
-					float distance = dfunc( d0, d1 );
-
-					if( distance < m.distance ) {
-						m.dstIdx = k;
-						m.distance = distance;
 					}
-				}
+					size_t kEnd = k + 1;
+					while( kEnd < setB.size() && ( setB[ kEnd ].pt - d0.pt ).lengthSqr() <= distanceSquare )
+						kEnd++;
 
-				if( m.distance < maxDescDistance ){					
+					// descriptor distance
+					minDistance( m.dstIdx, m.distance, &dist[ 0 ], d0, setB, k, kEnd, dfunc );
+					k = kEnd;
+				}
 
+				if( m.distance < maxDescDistance ){
 					matches.push_back( m );
 				}
 			}
@@ -103,8 +139,12 @@ namespace cvt {
 										  float maxFeatureDist,
 										  float maxDescDistance )
 		{
+			if( setB.empty() )
+				return;
+
 			matches.reserve( setA.size() );
 			MatchingIndices m;
+			std::vector<uint32_t> dist( setB.size() );
 			for( size_t i = 0; i < setA.size(); ++i ) {
 				const T& d0 = *( ( const T* )setA[ i ] );
 				m.srcIdx = i;
@@ -118,23 +158,17 @@ namespace cvt {
 
 				for( int y = minY; y < maxY; ++y ){
 					if( rlt.isValidRow( y ) ){
-						// match all features of this row
+						// match all features of this row within [ minX, maxX ], the rows are sorted by x
 						const RowLookupTable::Row& row = rlt.row( y );
-						int k = row.start;
+						size_t k = row.start;
 						size_t rEnd = k + row.len;
-						for( size_t k = row.start; k < rEnd; ++k ){
-							const T& d1 = setB[ k ];
-							if( d1.pt.x < minX )
-								continue;
-							if( d1.pt.x > maxX )
-								break;
-							// Match
-							float distance = dfunc( d0, d1 );
-							if( distance < m.distance ) {
-								m.dstIdx = k;
-								m.distance = distance;
-							}
-						}
+						while( k < rEnd && setB[ k ].pt.x < minX )
+							k++;
+						size_t kEnd = k;
+						while( kEnd < rEnd && setB[ kEnd ].pt.x <= maxX )
+							kEnd++;
+						if( kEnd > k )
+							minDistance( m.dstIdx, m.distance, &dist[ 0 ], d0, setB, k, kEnd, dfunc );
 					}
 				}
 
@@ -144,6 +178,19 @@ namespace cvt {
 			}
 		}
 
+		template<typename T>
+		static inline bool scanLineCandidate( const T& d, const T& dr, float minDisp, float maxDisp, float maxLineDist )
+		{
+			float yDist = Math::abs( d.pt[ 1 ] - dr.pt[ 1 ] );
+			if( yDist < maxLineDist &&
+				d.octave == dr.octave /*&&
+				Math::abs( d.angle - dr.angle ) < 0.1f*/ ){
+				float disp = d.pt[ 0 ] - dr.pt[ 0 ];
+				return disp > minDisp && disp < maxDisp;
+			}
+			return false;
+		}
+
 		template<typename T, typename DFUNC>
 		static inline void scanLineMatch( std::vector<FeatureMatch>& matches,
 										  const std::vector<const FeatureDescriptor*>& left,
@@ -154,31 +201,36 @@ namespace cvt {
 										  float maxDescDist,
 										  float maxLineDist )
 		{
+			if( right.empty() )
+				return;
+
 			matches.reserve( left.size() );
 			FeatureMatch m;
+			std::vector<uint32_t> dist( right.size() );
 			for( size_t i = 0; i < left.size(); ++i ){
 				const T* d = ( const T* )left[ i ];
+				size_t idx = 0;
 				m.distance = maxDescDist;
 				m.feature0 = d;
 				m.feature1 = 0;
 
-				for( size_t k = 0; k < right.size(); ++k ){
-					const T& dr = right[ k ];
-					float yDist = Math::abs( d->pt[ 1 ] - dr.pt[ 1 ] );
-					if( yDist < maxLineDist &&
-                        d->octave == dr.octave /*&&
-                        Math::abs( d->angle - dr.angle ) < 0.1f*/ ){
-						float disp = d->pt[ 0 ] - dr.pt[ 0 ];
-						if( disp > minDisp && disp < maxDisp ){
-							float descDist = dfunc( *d, dr );
-							if( descDist < m.distance ){
-								m.distance = descDist;
-								m.feature1 = &dr;
-							}
-						}
-                    }
+				/* batch the runs of consecutive candidates */
+				size_t k = 0;
+				while( k < right.size() ) {
+					if( !scanLineCandidate( *d, right[ k ], minDisp, maxDisp, maxLineDist ) ) {
+						k++;
+						continue;
+					}
+					size_t kEnd = k + 1;
+					while( kEnd < right.size() && scanLineCandidate( *d, right[ kEnd ], minDisp, maxDisp, maxLineDist ) )
+						kEnd++;
+
+					minDistance( idx, m.distance, &dist[ 0 ], *d, right, k, kEnd, dfunc );
+					k = kEnd;
 				}
+
 				if( m.distance < maxDescDist ){
+					m.feature1 = &right[ idx ];
 					matches.push_back( m );
 				}
 			}
@@ -195,10 +247,15 @@ namespace cvt {
                                           float maxDescDist,
                                           float maxLineDist )
         {
+            if( right.empty() )
+                return;
+
             matches.reserve( left.size() );
             FeatureMatch m;
+            std::vector<uint32_t> dist( right.size() );
             for( size_t i = 0; i < left.size(); ++i ){
                 const T* d = ( const T* )left[ i ];
+                size_t idx = 0;
                 m.distance = maxDescDist;
                 m.feature0 = d;
                 m.feature1 = 0;
@@ -210,26 +267,21 @@ namespace cvt {
 
                 for( int y = minY; y < maxY; ++y ){
                     if( rlt.isValidRow( y ) ){
+                        // the rows are sorted by x
                         const RowLookupTable::Row& row = rlt.row( y );
-                        int k = row.start;
+                        size_t k = row.start;
                         size_t rEnd = k + row.len;
-                        for( size_t k = row.start; k < rEnd; ++k ){
-                            const T& dr = right[ k ];
-                            if( dr.pt.x < minX )
-                                continue;
-                            if( dr.pt.x > maxX )
-                                break;
-
-                            // Match
-                            float distance = dfunc( *d, dr );
-                            if( distance < m.distance ) {
-                                m.feature1 = &dr;
-                                m.distance = distance;
-                            }
-                        }
+                        while( k < rEnd && right[ k ].pt.x < minX )
+                            k++;
+                        size_t kEnd = k;
+                        while( kEnd < rEnd && right[ kEnd ].pt.x <= maxX )
+                            kEnd++;
+                        if( kEnd > k )
+                            minDistance( idx, m.distance, &dist[ 0 ], *d, right, k, kEnd, dfunc );
                     }
                 }
                 if( m.distance < maxDescDist ){
+                    m.feature1 = &right[ idx ];
                     matches.push_back( m );
                 }
             }
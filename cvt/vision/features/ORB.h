@@ -90,6 +90,19 @@ namespace cvt {
 					return _simd->hammingDistance( a.desc, b.desc, 32 );
 				}
 
+				/* distances of a to the count descriptors starting at b */
+				void operator()( uint32_t* dst, const Descriptor& a, const Descriptor* b, size_t count ) const
+				{
+					_simd->hammingDistances( dst, a.desc, b->desc, sizeof( Descriptor ), count, 32 );
+				}
+
+				/* m x count distance matrix, dstStride in elements */
+				void operator()( uint32_t* dst, size_t dstStride, const Descriptor* a, size_t m, const Descriptor* b, size_t count ) const
+				{
+					_simd->hammingDistanceMatrix( dst, dstStride * sizeof( uint32_t ), a->desc, sizeof( Descriptor ), m,
+												  b->desc, sizeof( Descriptor ), count, 32 );
+				}
+
 				SIMD* _simd;
 			};
 
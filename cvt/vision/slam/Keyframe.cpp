@@ -60,6 +60,24 @@ namespace cvt
             _img = new Image( *other._img );
     }
 
+    Keyframe& Keyframe::operator=( const Keyframe & other )
+    {
+        if( this == &other )
+            return *this;
+
+        _id		  = other._id;
+        _pose	  = other._pose;
+        _featMeas = other._featMeas;
+
+        if( other._img ){
+            setImage( *other._img );
+        } else if( _img ){
+            delete _img;
+            _img = 0;
+        }
+        return *this;
+    }
+
     void Keyframe::setImage( const Image& img )
     {
         if( !hasImage() ){
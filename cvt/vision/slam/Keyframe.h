@@ -42,7 +42,7 @@ namespace cvt
 		public:
 			EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
-			typedef std::pair<size_t, MapMeasurement> MapPairType;
+			typedef std::pair<const size_t, MapMeasurement> MapPairType;
 			typedef std::map<size_t, MapMeasurement, std::less<size_t>, Eigen::aligned_allocator<MapPairType> > MapType;
 			typedef MapType::const_iterator MeasurementIterator;
 			typedef MapType::iterator MeasurementAlterableIterator;
@@ -52,6 +52,7 @@ namespace cvt
 			~Keyframe();
 			
 			Keyframe( const Keyframe & other );
+			Keyframe& operator=( const Keyframe & other );
 
 			void	setId( size_t id )  { _id = id; }
 			size_t  id() const			{ return _id; }
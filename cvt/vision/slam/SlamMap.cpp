@@ -76,6 +76,30 @@ namespace cvt
         _numMeas++;
     }
 
+    void SlamMap::mergeOptimized( const SlamMap& optimized )
+    {
+        size_t nKF   = Math::min( optimized.numKeyframes(), _keyframes.size() );
+        size_t nFeat = Math::min( optimized.numFeatures(), _features.size() );
+        if( nKF == 0 )
+            return;
+
+        // correction of the newest optimized keyframe, newer data was created relative to it
+        const Eigen::Matrix4d & oldPose = _keyframes[ nKF - 1 ].pose().transformation();
+        const Eigen::Matrix4d & optPose = optimized.keyframeForId( nKF - 1 ).pose().transformation();
+        Eigen::Matrix4d pointCorrection = optPose.inverse() * oldPose;
+        Eigen::Matrix4d poseCorrection  = oldPose.inverse() * optPose;
+
+        for( size_t i = nKF; i < _keyframes.size(); i++ )
+            _keyframes[ i ].setPose( _keyframes[ i ].pose().transformation() * poseCorrection );
+        for( size_t i = nFeat; i < _features.size(); i++ )
+            _features[ i ].estimate() = pointCorrection * _features[ i ].estimate();
+
+        for( size_t i = 0; i < nKF; i++ )
+            _keyframes[ i ].setPose( optimized.keyframeForId( i ).pose().transformation() );
+        for( size_t i = 0; i < nFeat; i++ )
+            _features[ i ].estimate() = optimized.featureForId( i ).estimate();
+    }
+
     int SlamMap::findClosestKeyframe( const Eigen::Matrix4d& worldT ) const
     {
         double nearest = Math::MAXF;
@@ -78,6 +78,15 @@ namespace cvt
                               const MapMeasurement& meas );
 
 
+         /**
+          *	\brief	take over the optimized poses and feature estimates of an optimized copy of this map
+          *	\param	optimized	copy of an earlier state of this map with the same keyframe and feature ids
+          *
+          *	Keyframes and features that have been added to this map after the copy was taken are kept,
+          *	they are moved along with the correction of the last keyframe of the optimized map.
+          */
+         void mergeOptimized( const SlamMap& optimized );
+
          int findClosestKeyframe( const Eigen::Matrix4d& worldT ) const;
 
          /**
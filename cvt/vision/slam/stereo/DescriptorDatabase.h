@@ -29,6 +29,7 @@
 #include <cvt/vision/features/FeatureDescriptor.h>
 #include <cvt/vision/KLTPatch.h>
 #include <cvt/math/GA2.h>
+#include <cvt/vision/LSH.h>
 
 namespace cvt
 {
@@ -56,9 +57,17 @@ namespace cvt
 											  std::vector<PatchType*>& patches,
 											  const std::vector<size_t>& ids );
 
+			/* approximate k nearest stored binary descriptors, e.g. for relocalization */
+			void nearestDescriptors( std::vector<LSH::Neighbour>& neighbours,
+									 const FeatureDescriptor& query,
+									 size_t k,
+									 uint32_t maxDistance ) const;
+
 		private:
 			std::vector<FeatureDescriptor*>	_descriptors;
 			std::vector<PatchType*>			_patches;
+			/* index of the binary descriptors */
+			LSH								_index;
 	};
 
 	inline DescriptorDatabase::DescriptorDatabase()
@@ -78,10 +87,14 @@ namespace cvt
 	inline void DescriptorDatabase::clear()
 	{
 		_descriptors.clear();
+		_index.clear();
 	}
 
 	inline void DescriptorDatabase::addDescriptor( const FeatureDescriptor& d, size_t id )
 	{
+		if( d.compareType() == FEATUREDESC_CMP_HAMMING )
+			_index.insert( d, id );
+
 		size_t numDesc = _descriptors.size();
 		if( id < numDesc ){
 			// already have this id -> update this descriptor
@@ -179,6 +192,14 @@ namespace cvt
 			descriptors[ i ] = _descriptors[ idx ];
 		}
 	}
+
+	inline void DescriptorDatabase::nearestDescriptors( std::vector<LSH::Neighbour>& neighbours,
+														const FeatureDescriptor& query,
+														size_t k,
+														uint32_t maxDistance ) const
+	{
+		_index.knn( neighbours, query, k, maxDistance );
+	}
 }
 
 #endif
@@ -27,27 +27,63 @@
 
 #include <cvt/vision/SparseBundleAdjustment.h>
 #include <cvt/util/Thread.h>
+#include <cvt/util/Mutex.h>
 
 namespace cvt
 {
+    /**
+     *  \brief  Bundle adjustment of a SlamMap in a background thread
+     *
+     *  The optimizer works on a private copy of the map, so the caller can keep on
+     *  reading and extending its map while the optimization is running. The result
+     *  is taken over with mergeResult() at a point of the callers choosing.
+     */
     class MapOptimizer : public Thread<SlamMap>
     {
         public:
             MapOptimizer();
             ~MapOptimizer();
 
-            void execute( SlamMap* map );
+            /**
+             *  \brief  copy the map and start the optimization of the copy
+             *  \return false if an optimization is still running or its result has not been
+             *          merged yet, nothing is started then
+             */
+            bool optimize( const SlamMap& map );
+
+            /**
+             *  \brief  merge the result of a finished optimization into map
+             *  \return true if a result was merged, false if there is none (yet)
+             */
+            bool mergeResult( SlamMap& map );
+
+            /* wait for a running optimization and throw its result away */
+            void discard();
+
             bool isRunning() const;
 
             void setMaxIterations( size_t iters ) { _termCrit.setMaxIterations( iters ); }
 
-        private:            
+        private:
+            enum State {
+                IDLE,
+                RUNNING,
+                FINISHED
+            };
+
+            void execute( SlamMap* map );
+            void joinThread();
+
             TerminationCriteria<double>	_termCrit;
-            bool						_isRunning;
+            SlamMap						_working;
+            mutable Mutex				_mutex;
+            State						_state;
+            bool						_joinable;
     };
 
     inline MapOptimizer::MapOptimizer() :
-        _isRunning( false )
+        _state( IDLE ),
+        _joinable( false )
     {
         _termCrit.setCostThreshold( 0.1 );
         _termCrit.setMaxIterations( 5 );
@@ -55,21 +91,71 @@ namespace cvt
 
     inline MapOptimizer::~MapOptimizer()
     {
-        if( _isRunning )
-            join();
+        joinThread();
+    }
+
+    inline bool MapOptimizer::optimize( const SlamMap& map )
+    {
+        {
+            ScopeLock lock( &_mutex );
+            if( _state != IDLE )
+                return false;
+        }
+
+        joinThread();
+        _working = map;
+        {
+            ScopeLock lock( &_mutex );
+            _state = RUNNING;
+        }
+        _joinable = true;
+        run( &_working );
+        return true;
+    }
+
+    inline bool MapOptimizer::mergeResult( SlamMap& map )
+    {
+        {
+            ScopeLock lock( &_mutex );
+            if( _state != FINISHED )
+                return false;
+        }
+
+        joinThread();
+        map.mergeOptimized( _working );
+        ScopeLock lock( &_mutex );
+        _state = IDLE;
+        return true;
+    }
+
+    inline void MapOptimizer::discard()
+    {
+        joinThread();
+        ScopeLock lock( &_mutex );
+        _state = IDLE;
     }
 
     inline void MapOptimizer::execute( SlamMap* map )
     {
         SparseBundleAdjustment sba;
-        _isRunning = true;
         sba.optimize( *map, _termCrit );
-        _isRunning = false;
+
+        ScopeLock lock( &_mutex );
+        _state = FINISHED;
     }
 
     inline bool MapOptimizer::isRunning() const
     {
-        return _isRunning;
+        ScopeLock lock( &_mutex );
+        return _state == RUNNING;
+    }
+
+    inline void MapOptimizer::joinThread()
+    {
+        if( _joinable ){
+            join();
+            _joinable = false;
+        }
     }
 }
 
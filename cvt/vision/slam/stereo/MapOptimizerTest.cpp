@@ -0,0 +1,150 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/vision/slam/stereo/MapOptimizer.h>
+#include <cvt/util/CVTTest.h>
+
+#include <sched.h>
+
+using namespace cvt;
+
+/* points in front of a row of keyframes, the keyframe poses and the points are perturbed,
+   the measurements are the exact projections */
+static void _mapOptimizerMap( SlamMap& map, size_t numCams, size_t numPoints )
+{
+    Eigen::Matrix3d K;
+    K << 500.0,   0.0, 320.0,
+           0.0, 500.0, 240.0,
+           0.0,   0.0,   1.0;
+    map.clear();
+    map.setIntrinsics( K );
+
+    Math::srand( 4321 );
+    std::vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d> > poses;
+    for( size_t c = 0; c < numCams; c++ ) {
+        Eigen::Matrix4d pose = Eigen::Matrix4d::Identity();
+        pose.block<3, 3>( 0, 0 ) = Eigen::AngleAxisd( 0.03 * c, Eigen::Vector3d::UnitY() ).toRotationMatrix();
+        pose( 0, 3 ) = -0.25 * c;
+        poses.push_back( pose );
+
+        Eigen::Matrix4d noisy = pose;
+        noisy.block<3, 3>( 0, 0 ) = Eigen::AngleAxisd( 0.004 * c, Eigen::Vector3d::UnitX() ).toRotationMatrix() * noisy.block<3, 3>( 0, 0 );
+        noisy( 1, 3 ) += 0.01 * c;
+        map.addKeyframe( noisy );
+    }
+
+    for( size_t i = 0; i < numPoints; i++ ) {
+        Eigen::Vector4d p( Math::rand( -2.0f, 2.0f ), Math::rand( -1.5f, 1.5f ), Math::rand( 4.0f, 8.0f ), 1.0 );
+        Eigen::Vector4d noisy = p;
+        noisy.head<3>() += Eigen::Vector3d( Math::rand( -0.05f, 0.05f ), Math::rand( -0.05f, 0.05f ), Math::rand( -0.05f, 0.05f ) );
+        size_t id = map.addFeature( MapFeature( noisy, Eigen::Matrix4d::Identity() ) );
+
+        for( size_t c = 0; c < numCams; c++ ) {
+            Eigen::Vector3d pc = K * ( poses[ c ] * p ).head<3>();
+            MapMeasurement meas;
+            meas.point = pc.head<2>() / pc[ 2 ];
+            map.addMeasurement( id, c, meas );
+        }
+    }
+}
+
+/* mean squared reprojection error of the first numPoints features */
+static double _mapReprojectionError( const SlamMap& map, size_t numPoints )
+{
+    double error = 0.0;
+    size_t n = 0;
+    for( size_t i = 0; i < numPoints; i++ ) {
+        const MapFeature& feature = map.featureForId( i );
+        Eigen::Vector3d p = feature.estimate().head<3>() / feature.estimate()[ 3 ];
+        for( MapFeature::ConstPointTrackIterator it = feature.pointTrackBegin(); it != feature.pointTrackEnd(); ++it ) {
+            const Keyframe& kf = map.keyframeForId( *it );
+            Eigen::Matrix4d T = kf.pose().transformation();
+            Eigen::Vector3d pc = map.intrinsics() * ( T.block<3, 3>( 0, 0 ) * p + T.block<3, 1>( 0, 3 ) );
+            error += ( kf.measurementForId( i ).point - pc.head<2>() / pc[ 2 ] ).squaredNorm();
+            n++;
+        }
+    }
+    return error / n;
+}
+
+BEGIN_CVTTEST( MapOptimizer )
+    bool result = true;
+    bool b;
+
+    const size_t numCams = 5;
+    const size_t numPoints = 60;
+    SlamMap map;
+    _mapOptimizerMap( map, numCams, numPoints );
+    double errorBefore = _mapReprojectionError( map, numPoints );
+    Eigen::Matrix4d lastPoseBefore = map.keyframeForId( numCams - 1 ).pose().transformation();
+
+    MapOptimizer optimizer;
+    optimizer.setMaxIterations( 10 );
+    b = optimizer.optimize( map );
+
+    /* tracking goes on while the copy is optimized: a new keyframe with a new feature */
+    Eigen::Matrix4d newPose = lastPoseBefore;
+    newPose( 0, 3 ) -= 0.25;
+    size_t newKF = map.addKeyframe( newPose );
+    Eigen::Vector4d newPoint( 0.5, 0.2, 6.0, 1.0 );
+    MapMeasurement meas;
+    Eigen::Vector3d pc = map.intrinsics() * ( newPose * newPoint ).head<3>();
+    meas.point = pc.head<2>() / pc[ 2 ];
+    size_t newFeature = map.addFeatureToKeyframe( MapFeature( newPoint, Eigen::Matrix4d::Identity() ), meas, newKF );
+
+    b &= !optimizer.optimize( map );
+    while( optimizer.isRunning() )
+        sched_yield();
+    CVTTEST_PRINT( "optimize", b );
+    result &= b;
+
+    b = optimizer.mergeResult( map );
+    b &= !optimizer.mergeResult( map );
+    b &= map.numKeyframes() == numCams + 1 && map.numFeatures() == numPoints + 1;
+    CVTTEST_PRINT( "mergeResult", b );
+    result &= b;
+
+    /* the optimized part of the map is updated */
+    double errorAfter = _mapReprojectionError( map, numPoints );
+    Eigen::Matrix4d lastPoseAfter = map.keyframeForId( numCams - 1 ).pose().transformation();
+    b = errorAfter < 0.1 * errorBefore && !lastPoseAfter.isApprox( lastPoseBefore, 1e-9 );
+    CVTTEST_PRINT( "optimized poses merged", b );
+    result &= b;
+
+    /* data added meanwhile is kept and moves along with the correction of the last optimized keyframe */
+    Eigen::Matrix4d poseCorrection = lastPoseBefore.inverse() * lastPoseAfter;
+    Eigen::Matrix4d pointCorrection = lastPoseAfter.inverse() * lastPoseBefore;
+    b = map.keyframeForId( newKF ).pose().transformation().isApprox( newPose * poseCorrection, 1e-9 );
+    b &= map.featureForId( newFeature ).estimate().isApprox( pointCorrection * newPoint, 1e-9 );
+    b &= map.keyframeForId( newKF ).numMeasurements() == 1;
+    /* the new keyframe still observes the new feature where it was measured */
+    Eigen::Vector4d p = map.featureForId( newFeature ).estimate();
+    pc = map.intrinsics() * ( map.keyframeForId( newKF ).pose().transformation() * p ).head<3>();
+    b &= ( pc.head<2>() / pc[ 2 ] - meas.point ).norm() < 1e-6;
+    CVTTEST_PRINT( "new keyframes kept", b );
+    result &= b;
+
+    return result;
+END_CVTTEST
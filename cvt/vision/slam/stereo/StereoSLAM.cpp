@@ -43,6 +43,7 @@ namespace cvt
                             const StereoCameraCalibration &calib ,
                             const Params &params ):
        _detector( detector ),
+       _detectorRight( NULL ),
        _descExtractorLeft( descExtractor ),
        _descExtractorRight( descExtractor->clone() ),
        _pyrLeft( _params.pyramidOctaves, _params.pyramidScaleFactor ),
@@ -73,6 +74,11 @@ namespace cvt
         CVT_ASSERT( imgLeftGray.format() == IFormat::GRAY_UINT8, "INPUT IMAGES NEED TO BE GRAY_UINT8" );
         CVT_ASSERT( imgRightGray.format() == IFormat::GRAY_UINT8, "INPUT IMAGES NEED TO BE GRAY_UINT8" );
 
+        // take over the result of a finished bundle adjustment, the optimizer only modifies
+        // the map here and right before a new optimization is started in the keyframe code
+        if( _bundler.mergeResult( _map ) )
+            mapChanged.notify( _map );
+
         // prepare debug image
         imgLeftGray.convert( _debugMono, IFormat::RGBA_UINT8 );
 
@@ -165,53 +171,78 @@ namespace cvt
 
    void StereoSLAM::extractFeatures( const Image& left, const Image& right )
    {
-       // update image pyramid(s)
-       _pyrLeft.update( left );
-       _pyrRight.update( right );
-
-       // detect features in current left frame
+       // the left and right half are independent, the stages of both run concurrently
        FeatureSet leftFeatures, rightFeatures;
-       _detector->detect( leftFeatures, _pyrLeft );
-       _detector->detect( rightFeatures, _pyrRight );
+       FeatureDetector* detectorRight = _detectorRight ? _detectorRight : _detector;
+
+       _frameGraph.clear();
+       size_t pyrL = _frameGraph.addTask( "pyramid left", [&]() { _pyrLeft.update( left ); } );
+       size_t pyrR = _frameGraph.addTask( "pyramid right", [&]() { _pyrRight.update( right ); } );
+
+       // float version for the KLT tracking
+       size_t pyrLf = _frameGraph.addTask( "float pyramid left", [&]() { _pyrLeft.convert( _pyrLeftf, IFormat::GRAY_FLOAT ); } );
+       _frameGraph.addDependency( pyrL, pyrLf );
+
+       size_t detL = _frameGraph.addTask( "detect left", [&]() {
+           detectFeatures( leftFeatures, _pyrLeft, _detector, true );
+       } );
+       size_t detR = _frameGraph.addTask( "detect right", [&]() {
+           detectFeatures( rightFeatures, _pyrRight, detectorRight, false );
+       } );
+       _frameGraph.addDependency( pyrL, detL );
+       _frameGraph.addDependency( pyrR, detR );
+       if( detectorRight == _detector )
+           _frameGraph.addDependency( detL, detR );
+
+       // extract the descriptors
+       size_t extL = _frameGraph.addTask( "extract left", [&]() {
+           _descExtractorLeft->clear();
+           _descExtractorLeft->extract( _pyrLeft, leftFeatures );
+       } );
+       size_t extR = _frameGraph.addTask( "extract right", [&]() {
+           _descExtractorRight->clear();
+           _descExtractorRight->extract( _pyrRight, rightFeatures );
+       } );
+       _frameGraph.addDependency( detL, extL );
+       _frameGraph.addDependency( detR, extR );
+
+       _frameGraph.execute();
+
+       std::cout << "Left: "<< leftFeatures.size() << " - Right: " << rightFeatures.size() << std::endl;
+   }
+
+   void StereoSLAM::detectFeatures( FeatureSet& features,
+                                    const ImagePyramid& pyramid,
+                                    FeatureDetector* detector,
+                                    bool debugDraw )
+   {
+       detector->detect( features, pyramid );
 
-       if ( _params.dbgShowFeatures ) {
-           debugImageDrawFeatures( _debugMono, leftFeatures, Color::BLUE );
+       if ( debugDraw && _params.dbgShowFeatures ) {
+           debugImageDrawFeatures( _debugMono, features, Color::BLUE );
        }
 
        const int NMS_RADIUS( _params.nonMaximumSuppressionRadius );
-       leftFeatures.filterNMS( NMS_RADIUS, true );
-       rightFeatures.filterNMS( NMS_RADIUS, true );
+       features.filterNMS( NMS_RADIUS, true );
 
-       if ( _params.dbgShowNMSFilteredFeatures ) {
-           debugImageDrawFeatures( _debugMono, leftFeatures, Color::BLACK );
+       if ( debugDraw && _params.dbgShowNMSFilteredFeatures ) {
+           debugImageDrawFeatures( _debugMono, features, Color::BLACK );
        }
 
        const int X_CELLS = _params.gridFilteringCellsX;
        const int Y_CELLS = _params.gridFilteringCellsY;
        const int MAX_CELL_FEATURES = _params.maxFeaturesPerCell;
        if ( _params.useGridFiltering ) {
-           leftFeatures.filterGrid( _pyrLeft[ 0 ].width(), _pyrLeft[ 0 ].height(), X_CELLS, Y_CELLS, MAX_CELL_FEATURES );
-           rightFeatures.filterGrid( _pyrLeft[ 0 ].width(), _pyrLeft[ 0 ].height(), X_CELLS, Y_CELLS, MAX_CELL_FEATURES );
+           features.filterGrid( pyramid[ 0 ].width(), pyramid[ 0 ].height(), X_CELLS, Y_CELLS, MAX_CELL_FEATURES );
        } else {
-            leftFeatures.filterBest( _params.bestFeaturesCount, true );
-            rightFeatures.filterBest( _params.bestFeaturesCount, true );
+           features.filterBest( _params.bestFeaturesCount, true );
        }
 
-       leftFeatures.sortPosition();
-       rightFeatures.sortPosition();
+       features.sortPosition();
 
-       if ( _params.dbgShowBest3kFeatures ) {
-           debugImageDrawFeatures( _debugMono, leftFeatures, Color::GRAY );
+       if ( debugDraw && _params.dbgShowBest3kFeatures ) {
+           debugImageDrawFeatures( _debugMono, features, Color::GRAY );
        }
-
-       std::cout << "Left: "<< leftFeatures.size() << " - Right: " << rightFeatures.size() << std::endl;
-
-       // extract the descriptors
-       _descExtractorLeft->clear();
-       _descExtractorLeft->extract( _pyrLeft, leftFeatures );
-
-       _descExtractorRight->clear();
-       _descExtractorRight->extract( _pyrRight, rightFeatures );
    }
 
    void StereoSLAM::predictVisibleFeatures( std::vector<Vector2f>& imgPositions,
@@ -241,8 +272,7 @@ namespace cvt
                                              std::vector<StereoSLAM::PatchType*>& predictedPatches,
                                              const std::vector<size_t>& predictedIds )
     {
-        _pyrLeft.convert( _pyrLeftf, IFormat::GRAY_FLOAT  );
-
+        // _pyrLeftf has been updated in extractFeatures
 
         // match with current left features
         RowLookupTable rlt( *_descExtractorLeft );
@@ -359,9 +389,11 @@ namespace cvt
        }
 
        // left is already converted to float
-       _pyrLeftf.convolve( _gradXl, _kernelGx );
-       _pyrLeftf.convolve( _gradYl, _kernelGy );
-       _pyrRight.convert( _pyrRightf, IFormat::GRAY_FLOAT );
+       TaskGraph gradients;
+       gradients.addTask( "gradient x left", [&]() { _pyrLeftf.convolve( _gradXl, _kernelGx ); } );
+       gradients.addTask( "gradient y left", [&]() { _pyrLeftf.convolve( _gradYl, _kernelGy ); } );
+       gradients.addTask( "float pyramid right", [&]() { _pyrRight.convert( _pyrRightf, IFormat::GRAY_FLOAT ); } );
+       gradients.execute();
        // maybe also update the patches of the currently tracked features
 
        // subpixel refinement of the stereo matches
@@ -438,8 +470,7 @@ namespace cvt
 
    void StereoSLAM::clear()
    {
-      if( _bundler.isRunning() )
-         _bundler.join();
+      _bundler.discard();
 
       _map.clear();
 
@@ -466,11 +497,6 @@ namespace cvt
           std::cout << "Could only triangulate " << newPoints3d.size() << " new features " << std::endl;
           return;
       }
-      // wait until current ba thread is ready
-      if( _bundler.isRunning() ){
-          _bundler.join();
-      }
-
       keyframeAdded.notify();
       mapChanged.notify( _map );
       std::cout << "Triangulated: " << newPoints3d.size() << std::endl;
@@ -516,10 +542,15 @@ namespace cvt
 
        /* bundle adjust */
        static size_t lastNKF = 0;
-       if( _params.useSBA && ( _map.numKeyframes() - lastNKF ) > _params.sbaDeltaKeyframes ){
+       if( _params.useSBA && ( _map.numKeyframes() - lastNKF ) > _params.sbaDeltaKeyframes && !_bundler.isRunning() ){
+           // a pending result has to be taken over before the next run
+           if( _bundler.mergeResult( _map ) )
+               mapChanged.notify( _map );
+
            _bundler.setMaxIterations( _params.sbaIterations );
            lastNKF = _map.numKeyframes();
-           _bundler.run( &_map );
+           // optimizes a copy, tracking continues on _map
+           _bundler.optimize( _map );
        }
    }
 
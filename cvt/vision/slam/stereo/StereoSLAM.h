@@ -28,6 +28,7 @@
 #include <cvt/gfx/Image.h>
 #include <cvt/math/SE3.h>
 #include <cvt/util/Signal.h>
+#include <cvt/util/TaskGraph.h>
 #include <cvt/vision/slam/SlamMap.h>
 #include <cvt/vision/slam/Keyframe.h>
 #include <cvt/vision/slam/stereo/DescriptorDatabase.h>
@@ -147,6 +148,18 @@ namespace cvt
          void               setConfig( const Params& configParams );
          const Params&      config() const { return _params; }
 
+		 /**
+		  * @brief detector for the right image, so that left and right detection can run concurrently
+		  *		   Detectors with internal state must not be shared between the two, without a right detector
+		  *		   the detector of the left image is used for both one after the other
+		  */
+		 void               setRightDetector( FeatureDetector* detector ) { _detectorRight = detector; }
+
+		 /**
+		  * @brief the per frame feature pipeline of the last frame, with the timings of its stages
+		  */
+		 const TaskGraph&   frameGraph() const { return _frameGraph; }
+
 		 Signal<const Image&>       newStereoView;
 		 Signal<const Image&>       trackedFeatureImage;
 		 Signal<void>               keyframeAdded;
@@ -178,6 +191,7 @@ namespace cvt
 		 typedef DescriptorDatabase::PatchType	PatchType;
 		 Params						 _params;
 		 FeatureDetector*			 _detector;
+		 FeatureDetector*			 _detectorRight;
 		 FeatureDescriptorExtractor* _descExtractorLeft;
 		 FeatureDescriptorExtractor* _descExtractorRight;
 		 DescriptorDatabase			 _descriptorDatabase;
@@ -201,10 +215,15 @@ namespace cvt
          Eigen::Matrix4d             _keyframeRelativePose;
 		 SlamMap					 _map;
 		 MapOptimizer				 _bundler;
+		 TaskGraph					 _frameGraph;
 		 Image						 _lastImage;
 		 Image						 _debugMono;
 
 		 void extractFeatures( const Image& left, const Image& right );
+		 void detectFeatures( FeatureSet& features,
+							  const ImagePyramid& pyramid,
+							  FeatureDetector* detector,
+							  bool debugDraw );
 
 		 void predictVisibleFeatures( std::vector<Vector2f>& imgPositions,
 									  std::vector<size_t>& ids,
@@ -1,53 +1,52 @@
 #include "ObjLoader.h"
 
 #include <cvt/io/FileSystem.h>
+#include <cvt/io/MappedFile.h>
 #include <cvt/util/DataIterator.h>
+#include <cvt/util/TextParser.h>
+#include <cvt/util/ThreadPool.h>
 #include <cvt/util/Util.h>
 
+#include <atomic>
+#include <string.h>
+
 namespace cvt {
 
 	String ObjLoader::_name = "OBJ";
 	String ObjLoader::_extensions[ 2 ] = { ".obj", ".OBJ" };
 
-	struct ObjFace {
-		ObjFace( unsigned int v1, unsigned int v2, unsigned int v3, unsigned int v4,
-				 unsigned int vn1, unsigned int vn2, unsigned int vn3, unsigned int vn4,
-				 unsigned int vt1, unsigned int vt2, unsigned int vt3, unsigned int vt4 )
-		{
-			vidx[ 0 ] = v1;
-			vidx[ 1 ] = v2;
-			vidx[ 2 ] = v3;
-			vidx[ 3 ] = v4;
-
-			vtidx[ 0 ] = vt1;
-			vtidx[ 1 ] = vt2;
-			vtidx[ 2 ] = vt3;
-			vtidx[ 3 ] = vt4;
-
-			vnidx[ 0 ] = vn1;
-			vnidx[ 1 ] = vn2;
-			vnidx[ 2 ] = vn3;
-			vnidx[ 3 ] = vn4;
-		}
+	/* 1-based indices of a face corner, 0 if not present */
+	struct ObjCorner {
+		unsigned int v;
+		unsigned int vt;
+		unsigned int vn;
+	};
 
-		bool isTriangle() const
-		{
-			return vidx[ 3 ] == 0;
-		}
+	enum ObjStatementType { OBJ_GROUP, OBJ_MTLLIB, OBJ_USEMTL };
+	enum ObjElement { OBJ_ELEMENT_OTHER, OBJ_ELEMENT_VERTEX, OBJ_ELEMENT_TEXCOORD, OBJ_ELEMENT_NORMAL };
 
-		bool hasNormals() const
-		{
-			return vnidx[ 0 ] != 0 && vnidx[ 1 ] != 0 && vnidx[ 2 ] != 0 && ( isTriangle() || vnidx[ 3 ] != 0 );
-		}
+	/* statements changing the current mesh, replayed in file order after the parallel parse */
+	struct ObjStatement {
+		ObjStatementType type;
+		String			 name;
+		size_t			 corner; /* face corners of the chunk preceding the statement */
+	};
 
-		bool hasTexcoords() const
-		{
-			return vtidx[ 0 ] != 0 && vtidx[ 1 ] != 0 && vtidx[ 2 ] != 0 && ( isTriangle() || vtidx[ 3 ] != 0 );
-		}
+	/* a line aligned part of the file */
+	struct ObjChunk {
+		const char*					begin;
+		const char*					end;
+		/* number and, after the prefix sum, offset of the chunk's vertices, texcoords and normals */
+		size_t						vertices;
+		size_t						texcoords;
+		size_t						normals;
+		std::vector<ObjCorner>		corners; /* triangulated faces */
+		std::vector<ObjStatement>	statements;
+	};
 
-		unsigned int vidx[ 4 ];
-		unsigned int vtidx[ 4 ];
-		unsigned int vnidx[ 4 ];
+	struct ObjRange {
+		const ObjCorner* begin;
+		const ObjCorner* end;
 	};
 
 	static void ObjReadMaterialColor3( DataIterator& d, Color& c )
@@ -189,89 +188,64 @@ namespace cvt {
 		return true;
 	}
 
-	static bool ObjFacesToMesh( SceneMesh& mesh, std::vector<ObjFace>& faces,
+	static bool ObjFacesToMesh( SceneMesh& mesh, const std::vector<ObjRange>& ranges,
 						 const std::vector<Vector3f>& vertices,
 						 const std::vector<Vector3f>& normals,
 						 const std::vector<Vector2f>& texcoords )
 	{
-		std::vector<Vector3f> mvertices;
-		std::vector<Vector3f> mnormals;
-		std::vector<Vector2f> mtexcoords;
-		std::vector<unsigned int> mfaces;
-		unsigned int idx = 0;
-		bool hasTex = false, hasNormal = false;
-
-		if( normals.size() )
-			hasNormal = true;
-		if( texcoords.size() )
-			hasTex = true;
-
-		for( std::vector<ObjFace>::iterator it = faces.begin(); it != faces.end() && ( hasTex || hasNormal ); ++it ) {
-			if( !it->hasTexcoords() ) hasTex = false;
-			if( !it->hasNormals() ) hasNormal = false;
-		}
-
-		for( std::vector<ObjFace>::iterator it = faces.begin(); it != faces.end(); ++it ) {
-			if( !it->isTriangle() ) {
-				unsigned int table[] = { 0, 1, 2, 2, 3, 0 };
-				// Convert quad to triangle
-				for( int i = 0; i < 6; i++ ) {
-					unsigned int lidx;
-					unsigned int ti = table[ i ];
-					lidx = it->vidx[ ti ];
-					if( lidx && lidx <= vertices.size() ) {
-						mvertices.push_back( vertices[ lidx - 1 ] );
-						// texcoords
-						if( hasTex ) {
-							lidx = it->vtidx[ ti ];
-							if( lidx && lidx <= texcoords.size() ) {
-								mtexcoords.push_back( texcoords[ lidx - 1 ] );
-							} else
-								return false;
-						}
-						// normals
-						if( hasNormal ) {
-							lidx = it->vnidx[ ti ];
-							if( lidx && lidx <= normals.size() ) {
-								mnormals.push_back( normals[ lidx - 1 ] );
-							} else
-								return false;
-						}
-
-						mfaces.push_back( idx++ );
-					} else
-						return false;
-				}
-			} else {
-				for( int i = 0; i < 3; i++ ) {
-					unsigned int lidx;
-					lidx = it->vidx[ i ];
-					if( lidx && lidx <= vertices.size() ) {
-						mvertices.push_back( vertices[ lidx - 1 ] );
-						// texcoords
-						if( hasTex ) {
-							lidx = it->vtidx[ i ];
-							if( lidx && lidx <= texcoords.size() ) {
-								mtexcoords.push_back( texcoords[ lidx - 1 ] );
-							} else
-								return false;
-						}
-						// normals
-						if( hasNormal ) {
-							lidx = it->vnidx[ i ];
-							if( lidx && lidx <= normals.size() ) {
-								mnormals.push_back( normals[ lidx - 1 ] );
-							} else
-								return false;
-						}
-
-						mfaces.push_back( idx++ );
-					} else
-						return false;
+		size_t n = 0;
+		for( size_t r = 0; r < ranges.size(); r++ )
+			n += ranges[ r ].end - ranges[ r ].begin;
+		if( !n )
+			return false;
+
+		std::vector<Vector3f> mvertices( n );
+		std::vector<Vector3f> mnormals( normals.size() ? n : 0 );
+		std::vector<Vector2f> mtexcoords( texcoords.size() ? n : 0 );
+		std::vector<unsigned int> mfaces( n );
+		std::atomic<bool> valid( true ), hasTex( texcoords.size() != 0 ), hasNormal( normals.size() != 0 );
+		std::atomic<bool> badTex( false ), badNormal( false );
+
+		/* every corner gets its own vertex, texcoords and normals are only used if all corners have them */
+		size_t offset = 0;
+		for( size_t r = 0; r < ranges.size(); r++ ) {
+			const ObjCorner* corners = ranges[ r ].begin;
+			ThreadPool::instance().parallelFor( 0, ranges[ r ].end - corners, 16384, [&]( size_t start, size_t end ) {
+				for( size_t i = start; i < end; i++ ) {
+					const ObjCorner& c = corners[ i ];
+					size_t idx = offset + i;
+
+					if( !c.v || c.v > vertices.size() ) {
+						valid = false;
+						return;
+					}
+					mvertices[ idx ] = vertices[ c.v - 1 ];
+					mfaces[ idx ] = idx;
+
+					if( mtexcoords.size() ) {
+						if( !c.vt )
+							hasTex = false;
+						else if( c.vt > texcoords.size() )
+							badTex = true;
+						else
+							mtexcoords[ idx ] = texcoords[ c.vt - 1 ];
+					}
+					if( mnormals.size() ) {
+						if( !c.vn )
+							hasNormal = false;
+						else if( c.vn > normals.size() )
+							badNormal = true;
+						else
+							mnormals[ idx ] = normals[ c.vn - 1 ];
+					}
 				}
-			}
+			} );
+			offset += ranges[ r ].end - corners;
 		}
 
+		if( !valid || ( hasTex && badTex ) || ( hasNormal && badNormal ) )
+			return false;
+
 		mesh.setVertices( &mvertices[ 0 ], mvertices.size() );
 		mesh.setFaces( &mfaces[ 0 ], mfaces.size(), SCENEMESH_TRIANGLES );
 		if( hasTex )
@@ -282,240 +256,267 @@ namespace cvt {
 		return true;
 	}
 
-	static void ObjReadVertices( DataIterator& d, std::vector<Vector3f>& vertices )
+	/* the next blank separated token of the line */
+	static inline void ObjToken( String& token, const char*& pos, const char* end )
 	{
-		String ws( " \r\n\t" );
-		String token;
-		Vector3f v;
+		TextParser::skipBlank( pos, end );
+		const char* start = pos;
+		while( pos < end && *pos != ' ' && *pos != '\t' && *pos != '\r' && *pos != '\n' )
+			pos++;
+		token.assign( start, pos - start );
+	}
 
-		while( d.peekNextToken( token, ws ) ) {
-			if( token != "v" )
-				return;
-
-			d.nextToken( token, ws );
-			v.x = d.nextDouble();
-			v.y = d.nextDouble();
-			v.z = d.nextDouble();
-			vertices.push_back( v );
-			d.skipInverse( "\n" );
-		}
+	static inline bool ObjIsEntryEnd( const char* pos, const char* end )
+	{
+		return pos == end || *pos == ' ' || *pos == '\t' || *pos == '\r' || *pos == '\n';
 	}
 
-	static void ObjReadTexcoords( DataIterator& d, std::vector<Vector2f>& texcoords )
+	/* negative indices are relative to the current end of the list */
+	static inline unsigned int ObjResolveIndex( long idx, size_t count )
 	{
-		String ws( " \r\n\t" );
-		String token;
-		Vector2f t;
+		if( idx < 0 )
+			idx += ( long ) count + 1;
+		return idx > 0 ? ( unsigned int ) idx : 0;
+	}
 
-		while( d.peekNextToken( token, ws ) ) {
-			if( token != "vt" )
-				return;
-
-			d.nextToken( token, ws );
-			t.x = d.nextDouble();
-			// inverse the y coordinate
-			t.y = 1.0 - d.nextDouble();
-			d.skipInverse("\n");
-			d.skip( ws );
-			texcoords.push_back( t );
+	static inline bool ObjParseCorner( const char*& pos, const char* end, size_t nv, size_t nt, size_t nn, ObjCorner& c )
+	{
+		long idx;
+
+		c.vt = c.vn = 0;
+		if( !TextParser::parseInt( pos, end, idx ) )
+			return false;
+		c.v = ObjResolveIndex( idx, nv );
+
+		// optional vt and or vn
+		if( pos < end && *pos == '/' ) {
+			pos++;
+			if( !ObjIsEntryEnd( pos, end ) && *pos != '/' ) {
+				if( !TextParser::parseInt( pos, end, idx ) )
+					return false;
+				c.vt = ObjResolveIndex( idx, nt );
+			}
+			if( pos < end && *pos == '/' ) {
+				pos++;
+				if( !ObjIsEntryEnd( pos, end ) ) {
+					if( !TextParser::parseInt( pos, end, idx ) )
+						return false;
+					c.vn = ObjResolveIndex( idx, nn );
+				}
+			}
 		}
+		return ObjIsEntryEnd( pos, end );
 	}
 
-	static void ObjReadNormals( DataIterator& d, std::vector<Vector3f>& normals )
+	/* polygons are triangulated as fans */
+	static bool ObjParseFace( const char* pos, const char* end, size_t nv, size_t nt, size_t nn, std::vector<ObjCorner>& corners )
 	{
-		String ws( " \r\n\t" );
-		String token;
-		Vector3f n;
-
-		while( d.peekNextToken( token, ws ) ) {
-			if( token != "vn" )
-				return;
-
-			d.nextToken( token, ws );
-			n.x = d.nextDouble();
-			n.y = d.nextDouble();
-			n.z = d.nextDouble();
-			normals.push_back( n );
+		ObjCorner first, prev, cur;
+		size_t k = 0;
+
+		while( 1 ) {
+			TextParser::skipBlank( pos, end );
+			if( pos == end || *pos == '\n' )
+				break;
+			if( !ObjParseCorner( pos, end, nv, nt, nn, cur ) )
+				return false;
+			if( k >= 2 ) {
+				corners.push_back( first );
+				corners.push_back( prev );
+				corners.push_back( cur );
+			} else if( k == 0 )
+				first = cur;
+			prev = cur;
+			k++;
 		}
+		return k >= 3;
+	}
+
+	/* classifies the line starting at pos, counting and parsing must agree on every line
+	   since the counts are the offsets of the chunks into the shared arrays */
+	static inline ObjElement ObjLineElement( const char* pos, const char* end )
+	{
+		TextParser::skipBlank( pos, end );
+		if( pos == end || *pos != 'v' )
+			return OBJ_ELEMENT_OTHER;
+		if( ObjIsEntryEnd( pos + 1, end ) )
+			return OBJ_ELEMENT_VERTEX;
+		if( pos[ 1 ] == 't' && ObjIsEntryEnd( pos + 2, end ) )
+			return OBJ_ELEMENT_TEXCOORD;
+		if( pos[ 1 ] == 'n' && ObjIsEntryEnd( pos + 2, end ) )
+			return OBJ_ELEMENT_NORMAL;
+		return OBJ_ELEMENT_OTHER;
 	}
 
-	static inline bool ObjReadFaceEntry( DataIterator& d, unsigned int& v, unsigned int& vt, unsigned int& vn )
+	static void ObjCountChunk( ObjChunk& chunk )
 	{
-		d.skip( " \r\t" );
-		// empty entry
-		if( *d.pos() == '\n' ) {
-			v = vt = vn = 0;
-			return true;
+		chunk.vertices = chunk.texcoords = chunk.normals = 0;
+		for( const char* pos = chunk.begin; pos < chunk.end; pos = TextParser::nextLine( pos, chunk.end ) ) {
+			switch( ObjLineElement( pos, chunk.end ) ) {
+				case OBJ_ELEMENT_VERTEX:   chunk.vertices++; break;
+				case OBJ_ELEMENT_TEXCOORD: chunk.texcoords++; break;
+				case OBJ_ELEMENT_NORMAL:   chunk.normals++; break;
+				default: break;
+			}
 		}
+	}
 
-		v = d.nextLong();
-		vt = 0;
-		vn = 0;
-		if( *d.pos() != ' ' && *d.pos() != '\n' && *d.pos() != '\r' && *d.pos() != '\t' ) {
-				// must be followed by vt and or vn
-				// parse vt
-				if( *d.pos() != '/' )
+	static bool ObjParseChunk( ObjChunk& chunk, std::vector<Vector3f>& vertices, std::vector<Vector3f>& normals, std::vector<Vector2f>& texcoords )
+	{
+		size_t nv = chunk.vertices, nt = chunk.texcoords, nn = chunk.normals;
+		String token;
+		const char* next;
+
+		for( const char* pos = chunk.begin; pos < chunk.end; pos = next ) {
+			next = TextParser::nextLine( pos, chunk.end );
+			ObjElement element = ObjLineElement( pos, next );
+			ObjToken( token, pos, next );
+
+			if( element == OBJ_ELEMENT_VERTEX ) { // vertices
+				Vector3f& v = vertices[ nv++ ];
+				if( !TextParser::parseFloat( pos, next, v.x ) ||
+				    !TextParser::parseFloat( pos, next, v.y ) ||
+				    !TextParser::parseFloat( pos, next, v.z ) )
 					return false;
-
-				d.skip( 1 );
-				// check if empty
-				if( *d.pos() == '/' ) {
-					vt = 0;
-				} else
-					vt = d.nextLong();
-
-				// parse vn
-				if( *d.pos() == ' ' || *d.pos() == '\t' || *d.pos() == '\r' || *d.pos() == '\n' ) // check if empty
-					vn = 0;
-				else if( *d.pos() == '/' ) {
-					d.skip( 1 );
-					if( *d.pos() == ' ' || *d.pos() == '\t' || *d.pos() == '\r' || *d.pos() == '\n' ) // check if empty
-						vn = 0;
-					else
-						vn = d.nextLong();
-				} else // error
+			} else if( element == OBJ_ELEMENT_TEXCOORD ) { // texcoords
+				Vector2f& t = texcoords[ nt++ ];
+				float v = 0.0f;
+				if( !TextParser::parseFloat( pos, next, t.x ) )
+					return false;
+				TextParser::parseFloat( pos, next, v );
+				// inverse the y coordinate
+				t.y = 1.0f - v;
+			} else if( element == OBJ_ELEMENT_NORMAL ) { // normals
+				Vector3f& n = normals[ nn++ ];
+				if( !TextParser::parseFloat( pos, next, n.x ) ||
+				    !TextParser::parseFloat( pos, next, n.y ) ||
+				    !TextParser::parseFloat( pos, next, n.z ) )
+					return false;
+			} else if( token == "f" ) { // faces
+				if( !ObjParseFace( pos, next, nv, nt, nn, chunk.corners ) )
 					return false;
+			} else if( token == "g" || token == "o" || token == "mtllib" || token == "usemtl" ) {
+				ObjStatement s;
+				s.type = token == "mtllib" ? OBJ_MTLLIB : ( token == "usemtl" ? OBJ_USEMTL : OBJ_GROUP );
+				ObjToken( s.name, pos, next );
+				s.corner = chunk.corners.size();
+				if( s.name.isEmpty() )
+					return false;
+				chunk.statements.push_back( s );
+			}
+			// discard everything else, e.g. smooth groups
 		}
-
 		return true;
 	}
 
-	static bool ObjReadFaces( DataIterator& d, std::vector<ObjFace>& faces )
+	/* converts the collected faces, the mesh is added to the scene or deleted if empty */
+	static void ObjAddMesh( Scene& scene, SceneMesh* mesh, std::vector<ObjRange>& ranges,
+							const std::vector<Vector3f>& vertices,
+							const std::vector<Vector3f>& normals,
+							const std::vector<Vector2f>& texcoords )
 	{
-		String ws( " \r\n\t" );
-		String token;
-		unsigned int v1, v2, v3, v4;
-		unsigned int vn1, vn2, vn3, vn4;
-		unsigned int vt1, vt2, vt3, vt4;
-
-		while( d.peekNextToken( token, ws ) ) {
-			if( token != "f" )
-				return true;
-
-			d.nextToken( token, ws );
-
-			// FIXME what about higher dimensional polygons ?
-			if( !ObjReadFaceEntry( d, v1, vt1, vn1 ) )
-				return false;
-			if( !ObjReadFaceEntry( d, v2, vt2, vn2 ) )
-				return false;
-			if( !ObjReadFaceEntry( d, v3, vt3, vn3 ) )
-				return false;
-			if( !ObjReadFaceEntry( d, v4, vt4, vn4 ))
-				return false;
-			d.skip( " \r\t" );
-			if( *d.pos() != '\n' )
-				return false;
+		if( ranges.size() )
+			ObjFacesToMesh( *mesh, ranges, vertices, normals, texcoords );
+		ranges.clear();
 
-			faces.push_back( ObjFace( v1, v2, v3, v4,
-									 vn1, vn2, vn3, vn4,
-									 vt1, vt2, vt3, vt4 ) );
+		if( mesh->isEmpty() ) {
+			delete mesh;
+			return;
 		}
-
-		return true;
+		if( !mesh->normalSize() )
+			mesh->calculateNormals();
+		scene.addGeometry( mesh );
 	}
 
-
 	void ObjLoader::load( Scene& scene, const String& filename )
 	{
-		String ws( " \r\n\t" );
-		String token;
+		MappedFile file( filename );
+		const char* data = ( const char* ) file.data();
+		ThreadPool& pool = ThreadPool::instance();
+
+		std::vector<const char*> bounds;
+		TextParser::splitLines( bounds, data, data + file.size(),
+							    Math::min<size_t>( file.size() / ( 1 << 20 ) + 1, 4 * ( pool.numThreads() + 1 ) ) );
+		std::vector<ObjChunk> chunks( bounds.size() - 1 );
+		for( size_t c = 0; c < chunks.size(); c++ ) {
+			chunks[ c ].begin = bounds[ c ];
+			chunks[ c ].end = bounds[ c + 1 ];
+		}
 
-		Data data;
-		FileSystem::load( data, filename );
-		SceneMesh* cur = new SceneMesh( "_NONAME_" );
-		std::vector<Vector3f> vertices;
-		std::vector<Vector3f> normals;
-		std::vector<Vector2f> texcoords;
-		std::vector<ObjFace> faces;
+		/* the vertex, texcoord and normal counts of the preceding chunks are the offsets of a chunk
+		   into the shared arrays and resolve relative face indices, so all chunks parse in parallel */
+		pool.parallelFor( 0, chunks.size(), 1, [&]( size_t start, size_t end ) {
+			for( size_t c = start; c < end; c++ )
+				ObjCountChunk( chunks[ c ] );
+		} );
+
+		size_t nv = 0, nt = 0, nn = 0;
+		for( size_t c = 0; c < chunks.size(); c++ ) {
+			std::swap( nv, chunks[ c ].vertices );
+			std::swap( nt, chunks[ c ].texcoords );
+			std::swap( nn, chunks[ c ].normals );
+			nv += chunks[ c ].vertices;
+			nt += chunks[ c ].texcoords;
+			nn += chunks[ c ].normals;
+		}
 
-		DataIterator d( data );
-		while( d.peekNextToken( token, ws ) ) {
-			if( token == "g" || token == "o" ) { // group
-				if( faces.size() ) {
-					ObjFacesToMesh( *cur, faces, vertices, normals, texcoords );
-					if( !cur->isEmpty() ) {
-						if( !cur->normalSize() )
-							cur->calculateNormals();
-						scene.addGeometry( cur );
-					}
-					faces.clear();
-				} else
-					delete cur;
+		std::vector<Vector3f> vertices( nv );
+		std::vector<Vector3f> normals( nn );
+		std::vector<Vector2f> texcoords( nt );
+		std::atomic<bool> valid( true );
 
-				d.nextToken( token, ws );
-				if( ! d.nextToken( token, ws ) ) {
-					scene.clear();
-					return;
-				}
-				cur = new SceneMesh( token );
-			}  else if( token == "mtllib" ) { // material library
-				d.nextToken( token, ws );
-				if( !d.nextToken( token, ws ) ) {
-					scene.clear();
-					return;
-				}
-				//FIXME: process all files
-				if( !ObjLoadMaterial( scene, token, Util::getDirectoryFromPath( filename ) ) ) {
-					scene.clear();
-					return;
-				}
-				d.skipInverse( "\n" );
-				d.skip( ws );
+		pool.parallelFor( 0, chunks.size(), 1, [&]( size_t start, size_t end ) {
+			for( size_t c = start; c < end && valid; c++ ) {
+				if( !ObjParseChunk( chunks[ c ], vertices, normals, texcoords ) )
+					valid = false;
+			}
+		} );
 
-			} else if( token == "usemtl" ) { // reference material
-				d.nextToken( token, ws );
-				if( !d.nextToken( token, ws ) ) {
-					scene.clear();
-					return;
-				}
+		if( !valid ) {
+			scene.clear();
+			return;
+		}
 
-				//fix this shit
-				if( faces.size() && cur->material() != "" ) {
-					ObjFacesToMesh( *cur, faces, vertices, normals, texcoords );
-					if( !cur->normalSize() )
-						cur->calculateNormals();
-					scene.addGeometry( cur );
-					faces.clear();
-					cur = new SceneMesh( "XXX" );
+		SceneMesh* cur = new SceneMesh( "_NONAME_" );
+		std::vector<ObjRange> ranges;
+
+		for( size_t c = 0; c < chunks.size(); c++ ) {
+			const ObjChunk& chunk = chunks[ c ];
+			const ObjCorner* corners = chunk.corners.empty() ? NULL : &chunk.corners[ 0 ];
+			size_t pos = 0;
+
+			for( size_t i = 0; i <= chunk.statements.size(); i++ ) {
+				size_t corner = i < chunk.statements.size() ? chunk.statements[ i ].corner : chunk.corners.size();
+				if( corner > pos ) {
+					ObjRange r = { corners + pos, corners + corner };
+					ranges.push_back( r );
+					pos = corner;
 				}
-				cur->setMaterial( token );
-			} else if( token == "v" ) { // vertices
-				ObjReadVertices( d, vertices );
-			} else if( token == "vn" ) { // normals
-				ObjReadNormals( d, normals );
-			} else if( token == "vt" ) { // texcoords
-				ObjReadTexcoords( d, texcoords );
-			} else if( token == "f" ) { // faces
-				if( !ObjReadFaces( d, faces ) ) {
-					scene.clear();
-					return;
+				if( i == chunk.statements.size() )
+					break;
+
+				const ObjStatement& s = chunk.statements[ i ];
+				if( s.type == OBJ_GROUP ) { // group
+					ObjAddMesh( scene, cur, ranges, vertices, normals, texcoords );
+					cur = new SceneMesh( s.name );
+				} else if( s.type == OBJ_MTLLIB ) { // material library
+					//FIXME: process all files
+					if( !ObjLoadMaterial( scene, s.name, Util::getDirectoryFromPath( filename ) ) ) {
+						delete cur;
+						scene.clear();
+						return;
+					}
+				} else { // reference material
+					if( ranges.size() && cur->material() != "" ) {
+						ObjAddMesh( scene, cur, ranges, vertices, normals, texcoords );
+						cur = new SceneMesh( "XXX" );
+					}
+					cur->setMaterial( s.name );
 				}
-			} else if( token == "s" ) { // smooth group
-				// discard
-				d.skipInverse( "\n" );
-				d.skip( ws );
-			} else {
-				// discard line, FIXME
-				d.skipInverse( "\n" );
-				d.skip( ws );
 			}
 		}
 
-		//std::cout << "Vertices: " << vertices.size() << std::endl;
-		//std::cout << "Normals: " << normals.size() << std::endl;
-		//std::cout << "Texcoords: " << texcoords.size() << std::endl;
-
-		if( faces.size() ) {
-			ObjFacesToMesh( *cur, faces, vertices, normals, texcoords );
-			if( !cur->isEmpty() ) {
-				if( !cur->normalSize() )
-					cur->calculateNormals();
-				scene.addGeometry( cur );
-			}
-		} else
-			delete cur;
-
+		ObjAddMesh( scene, cur, ranges, vertices, normals, texcoords );
 	}
 
 
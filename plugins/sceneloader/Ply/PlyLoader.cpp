@@ -1,7 +1,14 @@
 #include "PlyLoader.h"
+#include "PlySaver.h"
 
-#include <cvt/io/FileSystem.h>
+#include <cvt/io/MappedFile.h>
 #include <cvt/util/DataIterator.h>
+#include <cvt/util/TextParser.h>
+#include <cvt/util/ThreadPool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string.h>
 
 namespace cvt {
 
@@ -14,6 +21,9 @@ namespace cvt {
 		PLY_S8, PLY_S16, PLY_S32,
 		PLY_FLOAT, PLY_DOUBLE, PLY_LIST };
 
+	/* the vertex properties we keep */
+	enum PlyVertexTarget { PLY_X, PLY_Y, PLY_Z, PLY_NX, PLY_NY, PLY_NZ, PLY_DISCARD };
+
 	struct PlyProperty {
 		String name;
 		PlyPropertyType type;
@@ -52,153 +62,50 @@ namespace cvt {
 		}
 	}
 
-	static bool PlyDiscardPropertyAscii( DataIterator& d, const PlyProperty& p )
-	{
-		String ws( " \r\n\t" ), dummy;
-
-		if( p.type != PLY_LIST ) {
-			/* discard single token */
-			if( !d.nextToken( dummy, ws ) )
-				return false;
-		} else {
-			/* discard list elements */
-			long nlist;
-
-			nlist = d.nextLong();
-			if( nlist < 0 )
-				return 0;
-			while( nlist-- ) {
-				if( !d.nextToken( dummy, ws ) )
-					return false;
-			}
-		}
-		return true;
-	}
-
-	static bool PlyDiscardElementAscii( DataIterator& d, const PlyElement& e )
+	static bool PlyParseType( const String& str, PlyPropertyType& type )
 	{
-		bool fastdiscard = true;
-		String ws( " \r\n\t" ), dummy;
-
-		for( std::vector<PlyProperty>::const_iterator it = e.properties.begin();
-			it != e.properties.end(); ++it ) {
-			if( ( *it ).type == PLY_LIST ) {
-				fastdiscard = false;
-				break;
-			}
-		}
-
-		if( fastdiscard ) {
-			size_t n = e.properties.size() * e.size;
-			while( n-- ) {
-				if( !d.nextToken( dummy, ws ) )
-					return false;
-			}
-		} else {
-			size_t n = e.size;
-			while( n-- ) {
-				for( std::vector<PlyProperty>::const_iterator it = e.properties.begin();
-					it != e.properties.end(); ++it )
-					if( !PlyDiscardPropertyAscii( d, *it ) )
-						return false;
-			}
-		}
+		if( str == "uchar" || str == "uint8" )
+			type  = PLY_U8;
+		else if( str == "ushort" || str == "uint16" )
+			type  = PLY_U16;
+		else if( str == "uint" || str == "uint32" )
+			type  = PLY_U32;
+		else if( str == "char" || str == "int8" )
+			type  = PLY_S8;
+		else if( str == "short" || str == "int16" )
+			type  = PLY_S16;
+		else if( str == "int" || str == "int32" )
+			type  = PLY_S32;
+		else if( str == "float" || str == "float32" )
+			type  = PLY_FLOAT;
+		else if( str == "double" || str == "float64" )
+			type  = PLY_DOUBLE;
+		else
+			return false;
 		return true;
 	}
 
-
 	static bool PlyReadProperty( DataIterator& d, PlyProperty& p )
 	{
 		String strtype;
-		String strname;
 		String ws( " \r\n\t" );
 
 		if( !d.nextToken( strtype, ws ) )
 			return false;
 
-
-		/* type */
-		if( strtype == "uchar" )
-			p.type  = PLY_U8;
-		else if( strtype == "ushort" )
-			p.type  = PLY_U16;
-		else if( strtype == "uint" )
-			p.type  = PLY_U32;
-		else if( strtype == "char" )
-			p.type  = PLY_S8;
-		else if( strtype == "short" )
-			p.type  = PLY_S16;
-		else if( strtype == "int" )
-			p.type  = PLY_S32;
-		else if( strtype == "float" )
-			p.type  = PLY_FLOAT;
-		else if( strtype == "double" )
-			p.type  = PLY_DOUBLE;
-		else if( strtype == "list" )
-			p.type  = PLY_LIST;
-		else
-			return false;
-
-
-		if( p.type != PLY_LIST ) {
-			/* name */
-			if( !d.nextToken( p.name, ws ) )
-				return false;
-		} else {
-			/* list type and name */
-			PlyPropertyType type;
-
-			if( !d.nextToken( strtype, ws ) )
-				return false;
-
-			if( strtype == "uchar" )
-				type  = PLY_U8;
-			else if( strtype == "ushort" )
-				type  = PLY_U16;
-			else if( strtype == "uint" )
-				type  = PLY_U32;
-			else if( strtype == "char" )
-				type  = PLY_S8;
-			else if( strtype == "short" )
-				type  = PLY_S16;
-			else if( strtype == "int" )
-				type  = PLY_S32;
-			else
+		if( strtype == "list" ) {
+			/* list size type and element type */
+			p.type = PLY_LIST;
+			if( !d.nextToken( strtype, ws ) || !PlyParseType( strtype, p.lsizetype ) ||
+			    p.lsizetype == PLY_FLOAT || p.lsizetype == PLY_DOUBLE )
 				return false;
-
-			p.lsizetype = type;
-
-			if( !d.nextToken( strtype, ws ) )
-				return false;
-
-			if( strtype == "uchar" )
-				type  = PLY_U8;
-			else if( strtype == "ushort" )
-				type  = PLY_U16;
-			else if( strtype == "uint" )
-				type  = PLY_U32;
-			else if( strtype == "char" )
-				type  = PLY_S8;
-			else if( strtype == "short" )
-				type  = PLY_S16;
-			else if( strtype == "int" )
-				type  = PLY_S32;
-			else if( strtype == "float" )
-				type  = PLY_FLOAT;
-			else if( strtype == "double" )
-				type  = PLY_DOUBLE;
-			else
-				return false;
-
-			p.ltype = type;
-
-			if( !d.nextToken( p.name, ws ) )
+			if( !d.nextToken( strtype, ws ) || !PlyParseType( strtype, p.ltype ) )
 				return false;
-		}
-
-		//std::cout << p.name << std::endl;
+		} else if( !PlyParseType( strtype, p.type ) )
+			return false;
 
-		return true;
+		/* name */
+		return d.nextToken( p.name, ws );
 	}
 
 	static bool PlyReadElement( DataIterator& d, PlyElement& e )
@@ -288,94 +195,444 @@ namespace cvt {
 		return true;
 	}
 
-	static bool PlyReadVertexAscii( DataIterator& d, std::vector<Vector3f>& vertices, std::vector<Vector3f>& normals, const PlyElement& e )
+	static PlyVertexTarget PlyVertexTargetForName( const String& name )
 	{
-		size_t n = e.size;
-		String dummy;
-		String ws( " \r\n\t" );
-		double x , y, z, nx, ny, nz;
-
-		x = y = z = nx = ny = nz = 0;
-
-		while( n-- ) {
-			for( std::vector<PlyProperty>::const_iterator it = e.properties.begin();
-				it != e.properties.end(); ++it ) {
-				if( it->name == "x" ) {
-					x = d.nextDouble();
-				} else if( it->name == "y" ) {
-					y = d.nextDouble();
-				} else if( it->name == "z" ) {
-					z = d.nextDouble();
-				} else	if( it->name == "nx" ) {
-					nx = d.nextDouble();
-				} else if( it->name == "ny" ) {
-					ny = d.nextDouble();
-				} else if( it->name == "nz" ) {
-					nz = d.nextDouble();
-				} else {
-					/* discard */
-					if( !d.nextToken( dummy, ws ) )
-						return false;
-				}
+		if( name == "x" ) return PLY_X;
+		if( name == "y" ) return PLY_Y;
+		if( name == "z" ) return PLY_Z;
+		if( name == "nx" ) return PLY_NX;
+		if( name == "ny" ) return PLY_NY;
+		if( name == "nz" ) return PLY_NZ;
+		return PLY_DISCARD;
+	}
+
+	/* the list holding the vertex indices of a face */
+	static int PlyFaceIndexProperty( const PlyElement& e )
+	{
+		for( size_t i = 0; i < e.properties.size(); i++ ) {
+			if( e.properties[ i ].type == PLY_LIST &&
+			   ( e.properties[ i ].name == "vertex_indices" || e.properties[ i ].name == "vertex_index" ) )
+				return ( int ) i;
+		}
+		return -1;
+	}
+
+	static inline bool PlyHostIsLittleEndian()
+	{
+		const uint16_t one = 1;
+		return *( const uint8_t* ) &one == 1;
+	}
+
+	template<typename T>
+	static inline T PlyLoadBinary( const uint8_t* ptr, bool swap )
+	{
+		uint8_t buf[ sizeof( T ) ];
+		T v;
+
+		if( swap ) {
+			for( size_t i = 0; i < sizeof( T ); i++ )
+				buf[ i ] = ptr[ sizeof( T ) - 1 - i ];
+			ptr = buf;
+		}
+		memcpy( &v, ptr, sizeof( T ) );
+		return v;
+	}
+
+	static inline double PlyBinaryValue( const uint8_t* ptr, PlyPropertyType type, bool swap )
+	{
+		switch( type ) {
+			case PLY_U8:	 return *ptr;
+			case PLY_S8:	 return ( int8_t ) *ptr;
+			case PLY_U16:	 return PlyLoadBinary<uint16_t>( ptr, swap );
+			case PLY_S16:	 return PlyLoadBinary<int16_t>( ptr, swap );
+			case PLY_U32:	 return PlyLoadBinary<uint32_t>( ptr, swap );
+			case PLY_S32:	 return PlyLoadBinary<int32_t>( ptr, swap );
+			case PLY_FLOAT:	 return PlyLoadBinary<float>( ptr, swap );
+			case PLY_DOUBLE: return PlyLoadBinary<double>( ptr, swap );
+			default:		 return 0;
+		}
+	}
+
+	static inline int64_t PlyBinaryIndex( const uint8_t* ptr, PlyPropertyType type, bool swap )
+	{
+		switch( type ) {
+			case PLY_U8:	 return *ptr;
+			case PLY_S8:	 return ( int8_t ) *ptr;
+			case PLY_U16:	 return PlyLoadBinary<uint16_t>( ptr, swap );
+			case PLY_S16:	 return PlyLoadBinary<int16_t>( ptr, swap );
+			case PLY_U32:	 return PlyLoadBinary<uint32_t>( ptr, swap );
+			case PLY_S32:	 return PlyLoadBinary<int32_t>( ptr, swap );
+			case PLY_FLOAT:	 return ( int64_t ) PlyLoadBinary<float>( ptr, swap );
+			case PLY_DOUBLE: return ( int64_t ) PlyLoadBinary<double>( ptr, swap );
+			default:		 return -1;
+		}
+	}
+
+	/* byte offset of every property, only for elements without lists */
+	static bool PlyRecordLayout( const PlyElement& e, std::vector<size_t>& offsets, size_t& stride )
+	{
+		offsets.clear();
+		stride = 0;
+		for( std::vector<PlyProperty>::const_iterator it = e.properties.begin(); it != e.properties.end(); ++it ) {
+			if( it->type == PLY_LIST )
+				return false;
+			offsets.push_back( stride );
+			stride += PlyTypeSize( it->type );
+		}
+		return true;
+	}
+
+	static bool PlySkipPropertyBinary( const uint8_t*& pos, const uint8_t* end, const PlyProperty& p, bool swap )
+	{
+		if( p.type != PLY_LIST ) {
+			size_t size = PlyTypeSize( p.type );
+			if( ( size_t ) ( end - pos ) < size )
+				return false;
+			pos += size;
+			return true;
+		}
+
+		size_t lsize = PlyTypeSize( p.lsizetype );
+		if( ( size_t ) ( end - pos ) < lsize )
+			return false;
+		int64_t n = PlyBinaryIndex( pos, p.lsizetype, swap );
+		pos += lsize;
+		if( n < 0 || ( size_t ) ( end - pos ) / PlyTypeSize( p.ltype ) < ( size_t ) n )
+			return false;
+		pos += n * PlyTypeSize( p.ltype );
+		return true;
+	}
+
+	static bool PlySkipElementBinary( const uint8_t*& pos, const uint8_t* end, const PlyElement& e, bool swap )
+	{
+		std::vector<size_t> offsets;
+		size_t stride;
+
+		if( PlyRecordLayout( e, offsets, stride ) ) {
+			if( stride && ( size_t ) ( end - pos ) / stride < e.size )
+				return false;
+			pos += e.size * stride;
+			return true;
+		}
+
+		for( size_t n = 0; n < e.size; n++ ) {
+			for( std::vector<PlyProperty>::const_iterator it = e.properties.begin(); it != e.properties.end(); ++it ) {
+				if( !PlySkipPropertyBinary( pos, end, *it, swap ) )
+					return false;
+			}
+		}
+		return true;
+	}
+
+	static bool PlyReadVertexBinary( const uint8_t*& pos, const uint8_t* end, const PlyElement& e, bool swap,
+									 std::vector<Vector3f>& vertices, std::vector<Vector3f>& normals )
+	{
+		std::vector<size_t> offsets;
+		size_t stride;
+		size_t off[ PLY_DISCARD ];
+		PlyPropertyType type[ PLY_DISCARD ];
+		bool found[ PLY_DISCARD ] = { false, false, false, false, false, false };
+
+		if( !PlyRecordLayout( e, offsets, stride ) || !stride || ( size_t ) ( end - pos ) / stride < e.size )
+			return false;
+
+		for( size_t i = 0; i < e.properties.size(); i++ ) {
+			PlyVertexTarget t = PlyVertexTargetForName( e.properties[ i ].name );
+			if( t != PLY_DISCARD ) {
+				off[ t ]   = offsets[ i ];
+				type[ t ]  = e.properties[ i ].type;
+				found[ t ] = true;
 			}
-			vertices.push_back( Vector3f( x, y, z ) );
-			normals.push_back( Vector3f( nx, ny, nz ) );
+		}
+		if( !found[ PLY_X ] || !found[ PLY_Y ] || !found[ PLY_Z ] )
+			return false;
+		bool hasNormals = found[ PLY_NX ] && found[ PLY_NY ] && found[ PLY_NZ ];
+
+		vertices.resize( e.size );
+		if( hasNormals )
+			normals.resize( e.size );
+		if( !e.size )
+			return true;
+
+		const uint8_t* base = pos;
+		if( !swap && stride == sizeof( Vector3f ) && !hasNormals &&
+		    type[ PLY_X ] == PLY_FLOAT && type[ PLY_Y ] == PLY_FLOAT && type[ PLY_Z ] == PLY_FLOAT &&
+		    off[ PLY_X ] == 0 && off[ PLY_Y ] == 4 && off[ PLY_Z ] == 8 ) {
+			/* packed float positions, the block already is the vertex array */
+			memcpy( ( void* ) &vertices[ 0 ], base, e.size * stride );
+		} else {
+			ThreadPool::instance().parallelFor( 0, e.size, 8192, [&]( size_t start, size_t stop ) {
+				for( size_t i = start; i < stop; i++ ) {
+					const uint8_t* rec = base + i * stride;
+					vertices[ i ].x = PlyBinaryValue( rec + off[ PLY_X ], type[ PLY_X ], swap );
+					vertices[ i ].y = PlyBinaryValue( rec + off[ PLY_Y ], type[ PLY_Y ], swap );
+					vertices[ i ].z = PlyBinaryValue( rec + off[ PLY_Z ], type[ PLY_Z ], swap );
+					if( hasNormals ) {
+						normals[ i ].x = PlyBinaryValue( rec + off[ PLY_NX ], type[ PLY_NX ], swap );
+						normals[ i ].y = PlyBinaryValue( rec + off[ PLY_NY ], type[ PLY_NY ], swap );
+						normals[ i ].z = PlyBinaryValue( rec + off[ PLY_NZ ], type[ PLY_NZ ], swap );
+					}
+				}
+			} );
 		}
 
+		pos += e.size * stride;
 		return true;
 	}
 
-	static bool PlyReadVertexAscii( DataIterator& d, std::vector<Vector3f>& vertices, const PlyElement& e )
+	static bool PlyReadFacesBinary( const uint8_t*& pos, const uint8_t* end, const PlyElement& e, bool swap,
+									std::vector<unsigned int>& faces )
 	{
-		size_t n = e.size;
-		String dummy;
-		String ws( " \r\n\t" );
-		double x , y, z, nx, ny, nz;
-
-		x = y = z = nx = ny = nz = 0;
-
-		while( n-- ) {
-			for( std::vector<PlyProperty>::const_iterator it = e.properties.begin();
-				it != e.properties.end(); ++it ) {
-				if( it->name == "x" ) {
-					x = d.nextDouble();
-				} else if( it->name == "y" ) {
-					y = d.nextDouble();
-				} else if( it->name == "z" ) {
-					z = d.nextDouble();
-				} else {
-					/* discard */
-					if( !d.nextToken( dummy, ws ) )
-						return false;
+		int iprop = PlyFaceIndexProperty( e );
+		if( iprop < 0 )
+			return false;
+
+		/* a lone index list of triangles has a fixed record size and is read in parallel,
+		   anything else falls back to the sequential reader */
+		if( e.properties.size() == 1 ) {
+			const PlyProperty& p = e.properties[ 0 ];
+			size_t lsize = PlyTypeSize( p.lsizetype );
+			size_t isize = PlyTypeSize( p.ltype );
+			size_t stride = lsize + 3 * isize;
+
+			if( ( size_t ) ( end - pos ) / stride >= e.size ) {
+				const uint8_t* base = pos;
+				std::atomic<bool> triangles( true );
+
+				faces.resize( 3 * e.size );
+				ThreadPool::instance().parallelFor( 0, e.size, 8192, [&]( size_t start, size_t stop ) {
+					for( size_t i = start; i < stop; i++ ) {
+						const uint8_t* rec = base + i * stride;
+						if( PlyBinaryIndex( rec, p.lsizetype, swap ) != 3 ) {
+							triangles = false;
+							return;
+						}
+						rec += lsize;
+						faces[ 3 * i + 0 ] = ( unsigned int ) PlyBinaryIndex( rec, p.ltype, swap );
+						faces[ 3 * i + 1 ] = ( unsigned int ) PlyBinaryIndex( rec + isize, p.ltype, swap );
+						faces[ 3 * i + 2 ] = ( unsigned int ) PlyBinaryIndex( rec + 2 * isize, p.ltype, swap );
+					}
+				} );
+
+				if( triangles ) {
+					pos += e.size * stride;
+					return true;
 				}
+				faces.clear();
 			}
-			vertices.push_back( Vector3f( x, y, z ) );
 		}
 
+		faces.reserve( 3 * e.size );
+		for( size_t n = 0; n < e.size; n++ ) {
+			for( size_t i = 0; i < e.properties.size(); i++ ) {
+				const PlyProperty& p = e.properties[ i ];
+				const uint8_t* list = pos;
+
+				if( !PlySkipPropertyBinary( pos, end, p, swap ) )
+					return false;
+				if( ( int ) i != iprop )
+					continue;
+
+				/* polygons are triangulated as fans */
+				size_t isize = PlyTypeSize( p.ltype );
+				int64_t count = PlyBinaryIndex( list, p.lsizetype, swap );
+				list += PlyTypeSize( p.lsizetype );
+				for( int64_t k = 2; k < count; k++ ) {
+					faces.push_back( ( unsigned int ) PlyBinaryIndex( list, p.ltype, swap ) );
+					faces.push_back( ( unsigned int ) PlyBinaryIndex( list + ( k - 1 ) * isize, p.ltype, swap ) );
+					faces.push_back( ( unsigned int ) PlyBinaryIndex( list + k * isize, p.ltype, swap ) );
+				}
+			}
+		}
 		return true;
 	}
 
+	static bool PlyReadBinary( const uint8_t* pos, const uint8_t* end, const std::vector<PlyElement>& elements, bool swap,
+							   std::vector<Vector3f>& vertices, std::vector<Vector3f>& normals, std::vector<unsigned int>& faces )
+	{
+		for( std::vector<PlyElement>::const_iterator it = elements.begin(); it != elements.end(); ++it ) {
+			if( it->name == "vertex" ) {
+				if( !PlyReadVertexBinary( pos, end, *it, swap, vertices, normals ) )
+					return false;
+			} else if( it->name == "face" ) {
+				if( !PlyReadFacesBinary( pos, end, *it, swap, faces ) )
+					return false;
+			} else {
+				if( !PlySkipElementBinary( pos, end, *it, swap ) )
+					return false;
+			}
+		}
+		return true;
+	}
 
-	static bool PlyReadFacesAscii( DataIterator& d, std::vector<unsigned int>& faces, const PlyElement& e )
+	static inline void PlySkipTokenAscii( const char*& pos, const char* end )
 	{
-		size_t n = e.size;
-		String dummy;
-		String ws( " \r\n\t" );
+		TextParser::skipBlank( pos, end );
+		while( pos < end && *pos != ' ' && *pos != '\t' && *pos != '\r' && *pos != '\n' )
+			pos++;
+	}
+
+	static bool PlyParseVertexAscii( const char* pos, const char* end, const PlyElement& e,
+									 const std::vector<PlyVertexTarget>& targets, float* values )
+	{
+		for( size_t i = 0; i < e.properties.size(); i++ ) {
+			if( e.properties[ i ].type == PLY_LIST ) {
+				long n;
+				if( !TextParser::parseInt( pos, end, n ) || n < 0 )
+					return false;
+				while( n-- )
+					PlySkipTokenAscii( pos, end );
+			} else if( targets[ i ] != PLY_DISCARD ) {
+				if( !TextParser::parseFloat( pos, end, values[ targets[ i ] ] ) )
+					return false;
+			} else
+				PlySkipTokenAscii( pos, end );
+		}
+		return true;
+	}
+
+	static bool PlyParseFaceAscii( const char* pos, const char* end, const PlyElement& e, int iprop,
+								   std::vector<unsigned int>& faces )
+	{
+		for( size_t i = 0; i < e.properties.size(); i++ ) {
+			if( e.properties[ i ].type != PLY_LIST ) {
+				PlySkipTokenAscii( pos, end );
+				continue;
+			}
 
+			long n;
+			if( !TextParser::parseInt( pos, end, n ) || n < 0 )
+				return false;
+
+			if( ( int ) i != iprop ) {
+				while( n-- )
+					PlySkipTokenAscii( pos, end );
+				continue;
+			}
 
-		while( n-- ) {
-			//FIXME: check for only tris or quads
-			long nn = d.nextLong();
-			while( nn-- ) {
-				long i = d.nextLong();
-				if( i < 0 )
+			/* polygons are triangulated as fans */
+			long first = 0, prev = 0, cur;
+			for( long k = 0; k < n; k++ ) {
+				if( !TextParser::parseInt( pos, end, cur ) )
 					return false;
-				faces.push_back( ( unsigned int ) i );
+				if( k >= 2 ) {
+					faces.push_back( ( unsigned int ) first );
+					faces.push_back( ( unsigned int ) prev );
+					faces.push_back( ( unsigned int ) cur );
+				} else if( k == 0 )
+					first = cur;
+				prev = cur;
 			}
 		}
 		return true;
 	}
 
+	/* every element occupies one non-blank line per entry. The data is split into line aligned
+	   chunks, the line count of the preceding chunks tells every chunk which element entries
+	   it holds, so the chunks can be parsed independently */
+	static bool PlyReadAscii( const char* begin, const char* end, const std::vector<PlyElement>& elements,
+							  std::vector<Vector3f>& vertices, std::vector<Vector3f>& normals, std::vector<unsigned int>& faces )
+	{
+		ThreadPool& pool = ThreadPool::instance();
+		std::vector<const char*> bounds;
+
+		TextParser::splitLines( bounds, begin, end,
+							    Math::min<size_t>( ( end - begin ) / ( 1 << 20 ) + 1, 4 * ( pool.numThreads() + 1 ) ) );
+		size_t nchunks = bounds.size() - 1;
+
+		std::vector<size_t> lines( nchunks + 1, 0 );
+		pool.parallelFor( 0, nchunks, 1, [&]( size_t start, size_t stop ) {
+			for( size_t c = start; c < stop; c++ ) {
+				size_t n = 0;
+				for( const char* pos = bounds[ c ]; pos < bounds[ c + 1 ]; pos = TextParser::nextLine( pos, bounds[ c + 1 ] ) )
+					n += !TextParser::isBlankLine( pos, bounds[ c + 1 ] );
+				lines[ c + 1 ] = n;
+			}
+		} );
+		for( size_t c = 0; c < nchunks; c++ )
+			lines[ c + 1 ] += lines[ c ];
+
+		/* first line of every element */
+		std::vector<size_t> first( elements.size() + 1, 0 );
+		size_t vertexElement = elements.size(), faceElement = elements.size();
+		for( size_t e = 0; e < elements.size(); e++ ) {
+			first[ e + 1 ] = first[ e ] + elements[ e ].size;
+			if( elements[ e ].name == "vertex" )
+				vertexElement = e;
+			else if( elements[ e ].name == "face" )
+				faceElement = e;
+		}
+		if( lines[ nchunks ] < first.back() )
+			return false;
+
+		std::vector<PlyVertexTarget> targets;
+		bool hasNormals = false;
+		if( vertexElement < elements.size() ) {
+			const PlyElement& ve = elements[ vertexElement ];
+			for( size_t i = 0; i < ve.properties.size(); i++ )
+				targets.push_back( PlyVertexTargetForName( ve.properties[ i ].name ) );
+			if( !ve.hasProperty( "x" ) || !ve.hasProperty( "y" ) || !ve.hasProperty( "z" ) )
+				return false;
+			hasNormals = ve.hasProperty( "nx" ) && ve.hasProperty( "ny" ) && ve.hasProperty( "nz" );
+			vertices.resize( ve.size );
+			if( hasNormals )
+				normals.resize( ve.size );
+		}
+
+		int iprop = -1;
+		if( faceElement < elements.size() && ( iprop = PlyFaceIndexProperty( elements[ faceElement ] ) ) < 0 )
+			return false;
+
+		std::vector<std::vector<unsigned int> > chunkFaces( nchunks );
+		std::atomic<bool> valid( true );
+
+		pool.parallelFor( 0, nchunks, 1, [&]( size_t start, size_t stop ) {
+			for( size_t c = start; c < stop && valid; c++ ) {
+				const char* cend = bounds[ c + 1 ];
+				size_t line = lines[ c ];
+				size_t e = std::upper_bound( first.begin(), first.end(), line ) - first.begin() - 1;
+				const char* next;
+
+				for( const char* pos = bounds[ c ]; pos < cend && line < first.back(); pos = next ) {
+					next = TextParser::nextLine( pos, cend );
+					if( TextParser::isBlankLine( pos, next ) )
+						continue;
+					while( line >= first[ e + 1 ] )
+						e++;
+
+					if( e == vertexElement ) {
+						float values[ PLY_DISCARD ] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+						if( !PlyParseVertexAscii( pos, next, elements[ e ], targets, values ) ) {
+							valid = false;
+							return;
+						}
+						size_t i = line - first[ e ];
+						vertices[ i ].set( values[ PLY_X ], values[ PLY_Y ], values[ PLY_Z ] );
+						if( hasNormals )
+							normals[ i ].set( values[ PLY_NX ], values[ PLY_NY ], values[ PLY_NZ ] );
+					} else if( e == faceElement ) {
+						if( !PlyParseFaceAscii( pos, next, elements[ e ], iprop, chunkFaces[ c ] ) ) {
+							valid = false;
+							return;
+						}
+					}
+					line++;
+				}
+			}
+		} );
+
+		if( !valid )
+			return false;
+
+		size_t nfaces = 0;
+		for( size_t c = 0; c < nchunks; c++ )
+			nfaces += chunkFaces[ c ].size();
+		faces.reserve( nfaces );
+		for( size_t c = 0; c < nchunks; c++ )
+			faces.insert( faces.end(), chunkFaces[ c ].begin(), chunkFaces[ c ].end() );
+		return true;
+	}
+
 	void PlyLoader::load( Scene& scene, const String& filename )
 	{
 		std::vector<PlyElement> elements;
@@ -384,52 +641,36 @@ namespace cvt {
 		std::vector<Vector3f> normals;
 		std::vector<unsigned int> faces;
 
-
 		scene.clear();
 
-		Data data;
-		FileSystem::load( data, filename );
+		/* the header is tokenized, the data is read straight from the mapping */
+		MappedFile file( filename );
+		Data header( ( uint8_t* ) file.data(), file.size(), false );
+		DataIterator d( header );
+		if( !PlyReadHeader( d, elements, format ) )
+			throw CVTException( ( String( "Invalid PLY header in " ) + filename ).c_str() );
 
-		DataIterator d( data );
-		PlyReadHeader( d, elements, format );
+		const char* end = ( const char* ) file.data() + file.size();
+		const char* body = TextParser::nextLine( ( const char* ) d.pos(), end );
 
 		// FIXME: add support for u,v and red, green, blue properties
-		switch( format )
-		{
-			case PLY_ASCII:
-				{
-					for( std::vector<PlyElement>::iterator it = elements.begin();it != elements.end(); ++it ) {
-						if( it->name == "vertex" ) {
-							if( it->hasProperty( "nx" ) && it->hasProperty( "ny" ) && it->hasProperty( "nz" ) ) {
-								if( !PlyReadVertexAscii( d, vertices, normals, *it ) )
-									return;
-							} else {
-								if( !PlyReadVertexAscii( d, vertices, *it ) )
-									return;
-							}
-						} else if( it->name == "face" ) {
-							if( !PlyReadFacesAscii( d, faces, *it ) )
-								return;
-						} else {
-							if( !PlyDiscardElementAscii( d, *it ) )
-								return;
-						}
-					}
-				}
-				break;
-			case PLY_BIN_LE:
-			case PLY_BIN_BE:
-				{
-					throw CVTException( "Only ASCII PLY supported" );
-				}
-				break;
+		bool valid;
+		if( format == PLY_ASCII )
+			valid = PlyReadAscii( body, end, elements, vertices, normals, faces );
+		else
+			valid = PlyReadBinary( ( const uint8_t* ) body, ( const uint8_t* ) end, elements,
+								   ( format == PLY_BIN_LE ) != PlyHostIsLittleEndian(), vertices, normals, faces );
+		if( !valid )
+			throw CVTException( ( String( "Invalid PLY data in " ) + filename ).c_str() );
+
+		for( size_t i = 0; i < faces.size(); i++ ) {
+			if( faces[ i ] >= vertices.size() )
+				throw CVTException( ( String( "Invalid PLY face index in " ) + filename ).c_str() );
 		}
 
-		std::cout << vertices.size() << " " << faces.size() << std::endl;
 		if( vertices.size() && faces.size() ) {
 			SceneMesh* mesh = new SceneMesh( "PLY" );
 			mesh->setVertices( &vertices[ 0 ], vertices.size() );
-			// FIXME: correct mesh type - either tris or quads
 			mesh->setFaces( &faces[ 0 ], faces.size(), SCENEMESH_TRIANGLES );
 			if( normals.size() )
 				mesh->setNormals( &normals[ 0 ], normals.size() );
@@ -443,6 +684,8 @@ static void _init( cvt::PluginManager* pm )
 {
 	cvt::SceneLoader* ply = new cvt::PlyLoader();
 	pm->registerPlugin( ply );
+	cvt::SceneSaver* plysaver = new cvt::PlySaver();
+	pm->registerPlugin( plysaver );
 }
 
 CVT_PLUGIN( _init )
@@ -0,0 +1,118 @@
+#include "PlySaver.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sstream>
+
+namespace cvt {
+
+	String PlySaver::_name = "PLY";
+	String PlySaver::_extensions[ 2 ] = { ".ply", ".PLY" };
+
+	static void PlyWrite( FILE* f, const void* data, size_t size )
+	{
+		if( size && fwrite( data, 1, size, f ) != size ) {
+			fclose( f );
+			throw CVTException( "Could not write PLY data" );
+		}
+	}
+
+	void PlySaver::save( const String& filename, const Scene& scene )
+	{
+		std::vector<const SceneMesh*> meshes;
+		size_t nvertices = 0, nfaces = 0;
+		bool normals = true;
+
+		for( size_t i = 0; i < scene.geometrySize(); i++ ) {
+			const SceneGeometry* geometry = scene.geometry( i );
+			if( geometry->type() != SCENEGEOMETRY_MESH )
+				continue;
+			const SceneMesh* mesh = ( const SceneMesh* ) geometry;
+			meshes.push_back( mesh );
+			nvertices += mesh->vertexSize();
+			nfaces += mesh->faceSize();
+			normals &= mesh->normalSize() == mesh->vertexSize();
+		}
+
+		if( meshes.empty() )
+			throw CVTException( "No mesh in scene" );
+
+		const uint16_t one = 1;
+		std::ostringstream header;
+		header << "ply\n";
+		header << "format " << ( *( const uint8_t* ) &one == 1 ? "binary_little_endian" : "binary_big_endian" ) << " 1.0\n";
+		header << "element vertex " << nvertices << "\n";
+		header << "property float x\nproperty float y\nproperty float z\n";
+		if( normals )
+			header << "property float nx\nproperty float ny\nproperty float nz\n";
+		header << "element face " << nfaces << "\n";
+		header << "property list uchar uint vertex_indices\n";
+		header << "end_header\n";
+
+		FILE* f = fopen( filename.c_str(), "wb" );
+		if( !f ) {
+			String msg( "Could not open file " );
+			msg += filename;
+			throw CVTException( msg.c_str() );
+		}
+
+		const std::string& str = header.str();
+		PlyWrite( f, str.c_str(), str.length() );
+
+		/* the records are assembled in blocks, positions without normals are written as they are */
+		const size_t block = 1 << 16;
+		std::vector<uint8_t> buffer;
+
+		for( size_t m = 0; m < meshes.size(); m++ ) {
+			const SceneMesh* mesh = meshes[ m ];
+			if( !normals ) {
+				PlyWrite( f, mesh->vertices(), mesh->vertexSize() * sizeof( Vector3f ) );
+				continue;
+			}
+
+			buffer.resize( block * 2 * sizeof( Vector3f ) );
+			for( size_t start = 0; start < mesh->vertexSize(); start += block ) {
+				size_t n = Math::min( block, mesh->vertexSize() - start );
+				uint8_t* dst = &buffer[ 0 ];
+				for( size_t i = start; i < start + n; i++ ) {
+					memcpy( dst, &mesh->vertex( i ), sizeof( Vector3f ) );
+					memcpy( dst + sizeof( Vector3f ), &mesh->normal( i ), sizeof( Vector3f ) );
+					dst += 2 * sizeof( Vector3f );
+				}
+				PlyWrite( f, &buffer[ 0 ], dst - &buffer[ 0 ] );
+			}
+		}
+
+		uint32_t offset = 0;
+		for( size_t m = 0; m < meshes.size(); m++ ) {
+			const SceneMesh* mesh = meshes[ m ];
+			const unsigned int* faces = mesh->faces();
+			uint8_t cnt = mesh->meshType() == SCENEMESH_QUADS ? 4 : 3;
+			size_t record = 1 + cnt * sizeof( uint32_t );
+			size_t n = mesh->faceSize();
+
+			buffer.resize( block * record );
+			for( size_t start = 0; start < n; start += block ) {
+				size_t end = Math::min( n, start + block );
+				uint8_t* dst = &buffer[ 0 ];
+				for( size_t i = start; i < end; i++ ) {
+					*dst++ = cnt;
+					for( size_t k = 0; k < cnt; k++ ) {
+						uint32_t idx = faces[ i * cnt + k ] + offset;
+						memcpy( dst, &idx, sizeof( uint32_t ) );
+						dst += sizeof( uint32_t );
+					}
+				}
+				PlyWrite( f, &buffer[ 0 ], dst - &buffer[ 0 ] );
+			}
+			offset += mesh->vertexSize();
+		}
+
+		if( fclose( f ) ) {
+			String msg( "Could not write file " );
+			msg += filename;
+			throw CVTException( msg.c_str() );
+		}
+	}
+
+}
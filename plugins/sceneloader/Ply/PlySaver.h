@@ -0,0 +1,26 @@
+#ifndef CVT_PLYSAVER_H
+#define CVT_PLYSAVER_H
+
+#include <cvt/util/PluginManager.h>
+#include <cvt/geom/scene/Scene.h>
+
+namespace cvt {
+	/* writes all meshes of the scene as one binary PLY in the byte order of the host */
+	class PlySaver : public SceneSaver {
+		public:
+			PlySaver() {}
+			~PlySaver() {}
+			void save( const String& filename, const Scene& scene );
+
+			const String& extension( size_t i ) const { return _extensions[ i ]; }
+			size_t sizeExtensions() const { return 2; }
+			const String& name() const { return _name; }
+
+		private:
+			static String _name;
+			static String _extensions[ 2 ];
+	};
+
+}
+
+#endif